@@ -67,6 +67,7 @@ check_include_file("stdint.h" HAVE_STDINT_H)
 check_include_file("sys/time.h" HAVE_SYS_TIME_H)
 check_include_file("sys/stat.h" HAVE_SYS_STAT_H)
 check_include_file("sys/types.h" HAVE_SYS_TYPES_H)
+check_include_file("sys/mman.h" HAVE_SYS_MMAN_H)
 check_include_file("unistd.h" HAVE_UNISTD_H)
 
 set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES} ${SQLITE3_INCLUDE_DIRS})
@@ -371,7 +371,6 @@ init_splite_internal_cache (struct splite_internal_cache *cache)
     gaiaOutBufferPtr out;
     int i;
     const char *tinyPoint;
-    struct splite_geos_cache_item *p;
     struct splite_xmlSchema_cache_item *p_xmlSchema;
     if (cache == NULL)
 	return;
@@ -383,12 +382,14 @@ init_splite_internal_cache (struct splite_internal_cache *cache)
     cache->decimal_precision = -1;
     cache->GEOS_handle = NULL;
     cache->PROJ_handle = NULL;
-    cache->proj6_cached = 0;
-    cache->proj6_cached_pj = NULL;
-    cache->proj6_cached_string_1 = NULL;
-    cache->proj6_cached_string_2 = NULL;
-    cache->proj6_cached_area = NULL;
+    splite_init_proj_cache (&(cache->projCache));
     cache->is_pause_enabled = 0;
+    cache->geom_arena = NULL;
+    cache->geom_arena_busy = 0;
+    cache->max_threads = 1;
+    cache->deferred_rtree_mode = 0;
+    cache->deferred_rtree_txn = 0;
+    cache->first_deferred_rtree = NULL;
     cache->RTTOPO_handle = NULL;
     cache->cutterMessage = NULL;
     cache->storedProcError = NULL;
@@ -449,18 +450,7 @@ init_splite_internal_cache (struct splite_internal_cache *cache)
     gaiaOutBufferInitialize (out);
     cache->xmlXPathErrors = out;
 /* initializing the GEOS cache */
-    p = &(cache->cacheItem1);
-    memset (p->gaiaBlob, '\0', 64);
-    p->gaiaBlobSize = 0;
-    p->crc32 = 0;
-    p->geosGeom = NULL;
-    p->preparedGeosGeom = NULL;
-    p = &(cache->cacheItem2);
-    memset (p->gaiaBlob, '\0', 64);
-    p->gaiaBlobSize = 0;
-    p->crc32 = 0;
-    p->geosGeom = NULL;
-    p->preparedGeosGeom = NULL;
+    splite_init_geos_cache (&(cache->geosCache));
     for (i = 0; i < MAX_XMLSCHEMA_CACHE; i++)
       {
 	  /* initializing the XmlSchema cache */
@@ -838,7 +828,6 @@ SPATIALITE_PRIVATE void
 free_internal_cache (struct splite_internal_cache *cache)
 {
 /* freeing an internal cache */
-    struct splite_geos_cache_item *p;
 #ifndef OMIT_GEOS
     GEOSContextHandle_t handle = NULL;
 #endif
@@ -857,6 +846,13 @@ free_internal_cache (struct splite_internal_cache *cache)
     if (cache->SqlProcRetValue != NULL)
 	gaia_free_variant (cache->SqlProcRetValue);
     cache->SqlProcRetValue = NULL;
+    if (cache->geom_arena != NULL)
+	gaiaFreeGeomArena (cache->geom_arena);
+    cache->geom_arena = NULL;
+    splite_free_deferred_rtree (cache);
+
+/* freeing the GEOS cache (before finishing the GEOS handle) */
+    splite_free_geos_cache (cache);
 
 #ifndef OMIT_GEOS
     handle = cache->GEOS_handle;
@@ -872,22 +868,10 @@ free_internal_cache (struct splite_internal_cache *cache)
 
 #ifndef OMIT_PROJ
 #ifdef PROJ_NEW			/* supporting new PROJ.6 */
-    if (cache->proj6_cached_string_1 != NULL)
-	free (cache->proj6_cached_string_1);
-    if (cache->proj6_cached_string_2 != NULL)
-	free (cache->proj6_cached_string_2);
-    if (cache->proj6_cached_area != NULL)
-	free (cache->proj6_cached_area);
-    if (cache->proj6_cached_pj != NULL)
-	proj_destroy (cache->proj6_cached_pj);
+    splite_free_proj_cache (cache);
     if (cache->PROJ_handle != NULL)
 	proj_context_destroy (cache->PROJ_handle);
     cache->PROJ_handle = NULL;
-    cache->proj6_cached = 0;
-    cache->proj6_cached_pj = NULL;
-    cache->proj6_cached_string_1 = NULL;
-    cache->proj6_cached_string_2 = NULL;
-    cache->proj6_cached_area = NULL;
 #else /* supporting old PROJ.4 */
     if (cache->PROJ_handle != NULL)
 	pj_ctx_free (cache->PROJ_handle);
@@ -920,12 +904,6 @@ free_internal_cache (struct splite_internal_cache *cache)
     free (cache->xmlParsingErrors);
     free (cache->xmlSchemaValidationErrors);
     free (cache->xmlXPathErrors);
-
-/* freeing the GEOS cache */
-    p = &(cache->cacheItem1);
-    splite_free_geos_cache_item_r (cache, p);
-    p = &(cache->cacheItem2);
-    splite_free_geos_cache_item_r (cache, p);
 #ifdef ENABLE_LIBXML2
     for (i = 0; i < MAX_XMLSCHEMA_CACHE; i++)
       {
@@ -1280,6 +1258,80 @@ splite_cache_semaphore_unlock (void)
 #endif
 }
 
+struct splite_thread
+{
+/* a worker thread */
+#if defined(_WIN32) && !defined(__MINGW32__)
+    HANDLE handle;
+#else
+    pthread_t tid;
+#endif
+    void (*func) (void *arg);
+    void *arg;
+};
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+static DWORD WINAPI
+splite_thread_main (void *arg)
+#else
+static void *
+splite_thread_main (void *arg)
+#endif
+{
+/* the worker thread entry point */
+    struct splite_thread *thread = (struct splite_thread *) arg;
+    thread->func (thread->arg);
+#if defined(_WIN32) && !defined(__MINGW32__)
+    return 0;
+#else
+    pthread_exit (NULL);
+    return NULL;
+#endif
+}
+
+SPATIALITE_PRIVATE void *
+splite_thread_create (void (*func) (void *arg), void *arg)
+{
+/* starting a new worker thread - NULL on failure */
+    struct splite_thread *thread = malloc (sizeof (struct splite_thread));
+    if (thread == NULL)
+	return NULL;
+    thread->func = func;
+    thread->arg = arg;
+#if defined(_WIN32) && !defined(__MINGW32__)
+    thread->handle =
+	CreateThread (NULL, 0, splite_thread_main, thread, 0, NULL);
+    if (thread->handle == NULL)
+      {
+	  free (thread);
+	  return NULL;
+      }
+#else
+    if (pthread_create (&(thread->tid), NULL, splite_thread_main, thread) != 0)
+      {
+	  free (thread);
+	  return NULL;
+      }
+#endif
+    return thread;
+}
+
+SPATIALITE_PRIVATE void
+splite_thread_join (void *p_thread)
+{
+/* waiting for a worker thread to terminate, then destroying it */
+    struct splite_thread *thread = (struct splite_thread *) p_thread;
+    if (thread == NULL)
+	return;
+#if defined(_WIN32) && !defined(__MINGW32__)
+    WaitForSingleObject (thread->handle, INFINITE);
+    CloseHandle (thread->handle);
+#else
+    pthread_join (thread->tid, NULL);
+#endif
+    free (thread);
+}
+
 SPATIALITE_DECLARE void
 spatialite_initialize (void)
 {
@@ -1524,6 +1576,19 @@ gaia_set_variant_blob (struct gaia_variant_value *variant,
     return 1;
 }
 
+SPATIALITE_PRIVATE void
+splite_init_proj_cache (struct splite_proj_cache *p)
+{
+/* initializing the LRU cache of PROJ transformation objects */
+    p->maxItems = SPLITE_PROJ_CACHE_DEFAULT;
+    p->count = 0;
+    p->first = NULL;
+    p->last = NULL;
+    p->hits = 0;
+    p->misses = 0;
+    p->evictions = 0;
+}
+
 #ifdef PROJ_NEW			/* only when using new PROJ.6 */
 SPATIALITE_DECLARE const void *
 gaiaGetCurrentProjContext (const void *p_cache)
@@ -1540,15 +1605,155 @@ gaiaGetCurrentProjContext (const void *p_cache)
     return NULL;
 }
 
+static unsigned int
+projCacheHash (const char *proj_string_1, const char *proj_string_2,
+	       gaiaProjAreaPtr bbox)
+{
+/* computing the FNV-1a hash of a PROJ cache key */
+    unsigned int hash = 2166136261u;
+    const unsigned char *p;
+    double area[4];
+    int i;
+    for (p = (const unsigned char *) proj_string_1; *p != '\0'; p++)
+	hash = (hash ^ *p) * 16777619u;
+    hash = (hash ^ 0xff) * 16777619u;
+    if (proj_string_2 != NULL)
+      {
+	  for (p = (const unsigned char *) proj_string_2; *p != '\0'; p++)
+	      hash = (hash ^ *p) * 16777619u;
+      }
+    if (bbox != NULL)
+      {
+	  area[0] = bbox->WestLongitude;
+	  area[1] = bbox->SouthLatitude;
+	  area[2] = bbox->EastLongitude;
+	  area[3] = bbox->NorthLatitude;
+	  p = (const unsigned char *) area;
+	  for (i = 0; i < (int) sizeof (area); i++)
+	      hash = (hash ^ p[i]) * 16777619u;
+      }
+    return hash;
+}
+
+static int
+projCacheItemMatches (struct splite_proj_cache_item *p,
+		      const char *proj_string_1, const char *proj_string_2,
+		      gaiaProjAreaPtr bbox_1)
+{
+/* checking if a cached PROJ object matches all definitions */
+    if (strcmp (proj_string_1, p->proj_string_1) != 0)
+	return 0;		/* mismatching string #1 */
+    if (proj_string_2 == NULL && p->proj_string_2 == NULL)
+	;
+    else if (proj_string_2 != NULL && p->proj_string_2 != NULL)
+      {
+	  if (strcmp (proj_string_2, p->proj_string_2) != 0)
+	      return 0;		/* mismatching string #2 */
+      }
+    else
+	return 0;		/* mismatching string #2 */
+    if (bbox_1 == NULL && p->area == NULL)
+	;
+    else if (bbox_1 != NULL && p->area != NULL)
+      {
+	  gaiaProjAreaPtr bbox_2 = (gaiaProjAreaPtr) (p->area);
+	  if (bbox_1->WestLongitude != bbox_2->WestLongitude)
+	      return 0;
+	  if (bbox_1->SouthLatitude != bbox_2->SouthLatitude)
+	      return 0;
+	  if (bbox_1->EastLongitude != bbox_2->EastLongitude)
+	      return 0;
+	  if (bbox_1->NorthLatitude != bbox_2->NorthLatitude)
+	      return 0;
+      }
+    else
+	return 0;		/* mismatching area */
+    return 1;
+}
+
+static void
+projCacheUnlink (struct splite_proj_cache *pc,
+		 struct splite_proj_cache_item *p)
+{
+/* removing an item from the LRU list */
+    if (p->prev != NULL)
+	p->prev->next = p->next;
+    else
+	pc->first = p->next;
+    if (p->next != NULL)
+	p->next->prev = p->prev;
+    else
+	pc->last = p->prev;
+    p->prev = NULL;
+    p->next = NULL;
+    pc->count -= 1;
+}
+
+static void
+projCachePushFront (struct splite_proj_cache *pc,
+		    struct splite_proj_cache_item *p)
+{
+/* inserting an item as the most recently used one */
+    p->prev = NULL;
+    p->next = pc->first;
+    if (pc->first != NULL)
+	pc->first->prev = p;
+    pc->first = p;
+    if (pc->last == NULL)
+	pc->last = p;
+    pc->count += 1;
+}
+
+static void
+projCacheDiscard (struct splite_proj_cache *pc,
+		  struct splite_proj_cache_item *p)
+{
+/* removing an item from the cache and destroying it */
+    projCacheUnlink (pc, p);
+    if (p->proj_string_1 != NULL)
+	free (p->proj_string_1);
+    if (p->proj_string_2 != NULL)
+	free (p->proj_string_2);
+    if (p->area != NULL)
+	free (p->area);
+    if (p->pj != NULL)
+	proj_destroy (p->pj);
+    free (p);
+}
+
+static void
+projCacheTrim (struct splite_proj_cache *pc)
+{
+/* evicting the least recently used items exceeding the cache size */
+    while (pc->count > pc->maxItems)
+      {
+	  projCacheDiscard (pc, pc->last);
+	  pc->evictions += 1;
+      }
+}
+
+SPATIALITE_PRIVATE void
+splite_free_proj_cache (const void *p_cache)
+{
+/* destroying all items stored into the PROJ cache */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    if (cache == NULL)
+	return;
+    while (cache->projCache.last != NULL)
+	projCacheDiscard (&(cache->projCache), cache->projCache.last);
+}
+
 SPATIALITE_DECLARE int
 gaiaSetCurrentCachedProj (const void
 			  *p_cache, void *pj,
 			  const char *proj_string_1,
 			  const char *proj_string_2, void *area)
 {
-/* updates the PROJ6 internal cache */
+/* inserting a PROJ object into the PROJ6 internal cache */
     int ok = 0;
     int len;
+    struct splite_proj_cache_item *p;
     gaiaProjAreaPtr bbox_in = (gaiaProjAreaPtr) area;
     struct splite_internal_cache *cache =
 	(struct splite_internal_cache *) p_cache;
@@ -1562,53 +1767,44 @@ gaiaSetCurrentCachedProj (const void
 	return 0;		/* invalid cache */
     if (proj_string_1 == NULL || pj == NULL)
 	return 0;
+    if (cache->projCache.maxItems <= 0)
+	return 0;		/* the cache is disabled */
 
-/* resetting the PROJ6 internal cache */
-    if (cache->proj6_cached_string_1 != NULL)
-	free (cache->proj6_cached_string_1);
-    if (cache->proj6_cached_string_2 != NULL)
-	free (cache->proj6_cached_string_2);
-    if (cache->proj6_cached_area != NULL)
-	free (cache->proj6_cached_area);
-    if (cache->proj6_cached_pj != NULL)
-	proj_destroy (cache->proj6_cached_pj);
-
-/* updating the PROJ6 internal cache */
-    cache->proj6_cached = 1;
-    cache->proj6_cached_pj = pj;
+/* the new item will become the most recently used one */
+    p = malloc (sizeof (struct splite_proj_cache_item));
+    p->pj = pj;
     len = strlen (proj_string_1);
-    cache->proj6_cached_string_1 = malloc (len + 1);
-    strcpy (cache->proj6_cached_string_1, proj_string_1);
+    p->proj_string_1 = malloc (len + 1);
+    strcpy (p->proj_string_1, proj_string_1);
     if (proj_string_2 == NULL)
-	cache->proj6_cached_string_2 = NULL;
+	p->proj_string_2 = NULL;
     else
       {
 	  len = strlen (proj_string_2);
-	  cache->proj6_cached_string_2 = malloc (len + 1);
-	  strcpy (cache->proj6_cached_string_2, proj_string_2);
+	  p->proj_string_2 = malloc (len + 1);
+	  strcpy (p->proj_string_2, proj_string_2);
       }
     if (bbox_in == NULL)
-	cache->proj6_cached_area = NULL;
+	p->area = NULL;
     else
       {
-	  gaiaProjAreaPtr bbox_out =
-	      (gaiaProjAreaPtr) (cache->proj6_cached_area);
-	  if (bbox_out != NULL)
-	      free (bbox_out);
-	  bbox_out = malloc (sizeof (gaiaProjArea));
+	  gaiaProjAreaPtr bbox_out = malloc (sizeof (gaiaProjArea));
 	  bbox_out->WestLongitude = bbox_in->WestLongitude;
 	  bbox_out->SouthLatitude = bbox_in->SouthLatitude;
 	  bbox_out->EastLongitude = bbox_in->EastLongitude;
 	  bbox_out->NorthLatitude = bbox_in->NorthLatitude;
-	  cache->proj6_cached_area = bbox_out;
+	  p->area = bbox_out;
       }
+    p->hash = projCacheHash (proj_string_1, proj_string_2, bbox_in);
+    projCachePushFront (&(cache->projCache), p);
+    projCacheTrim (&(cache->projCache));
     return 1;
 }
 
 SPATIALITE_DECLARE void *
 gaiaGetCurrentCachedProj (const void *p_cache)
 {
-/* returning the currently cached PROJ6 object */
+/* returning the most recently used PROJ6 object */
     struct splite_internal_cache *cache =
 	(struct splite_internal_cache *) p_cache;
     if (cache != NULL)
@@ -1616,8 +1812,8 @@ gaiaGetCurrentCachedProj (const void *p_cache)
 	  if (cache->magic1 == SPATIALITE_CACHE_MAGIC1
 	      && cache->magic2 == SPATIALITE_CACHE_MAGIC2)
 	    {
-		if (cache->proj6_cached)
-		    return cache->proj6_cached_pj;
+		if (cache->projCache.first != NULL)
+		    return cache->projCache.first->pj;
 		else
 		    return NULL;
 	    }
@@ -1631,8 +1827,13 @@ gaiaCurrentCachedProjMatches (const void *p_cache,
 			      *proj_string_1,
 			      const char *proj_string_2, void *area)
 {
-/* checking if the currently cached PROJ6 object matches */
+/* 
+/ searching the PROJ6 internal cache for a matching object
+/ the matching object (if any) becomes the current one
+*/
     int ok = 0;
+    unsigned int hash;
+    struct splite_proj_cache_item *p;
     gaiaProjAreaPtr bbox_1 = (gaiaProjAreaPtr) area;
     struct splite_internal_cache *cache =
 	(struct splite_internal_cache *) p_cache;
@@ -1646,38 +1847,47 @@ gaiaCurrentCachedProjMatches (const void *p_cache,
 	return 0;		/* invalid cache */
     if (proj_string_1 == NULL)
 	return 0;		/* invalid request */
-    if (cache->proj6_cached == 0)
-	return 0;		/* there is no PROJ6 object currently cached */
 
-/* checking all definitions */
-    if (strcmp (proj_string_1, cache->proj6_cached_string_1) != 0)
-	return 0;		/* mismatching string #1 */
-    if (proj_string_2 == NULL && cache->proj6_cached_string_2 == NULL)
-	;
-    else if (proj_string_2 != NULL && cache->proj6_cached_string_2 != NULL)
+    hash = projCacheHash (proj_string_1, proj_string_2, bbox_1);
+    p = cache->projCache.first;
+    while (p != NULL)
       {
-	  if (strcmp (proj_string_2, cache->proj6_cached_string_2) != 0)
-	      return 0;		/* mismatching string #2 */
-      }
-    else
-	return 0;		/* mismatching string #2 */
-    if (bbox_1 == NULL && cache->proj6_cached_area == NULL)
-	;
-    else if (bbox_1 != NULL && cache->proj6_cached_area != NULL)
-      {
-	  gaiaProjAreaPtr bbox_2 = (gaiaProjAreaPtr) (cache->proj6_cached_area);
-	  if (bbox_1->WestLongitude != bbox_2->WestLongitude)
-	      return 0;
-	  if (bbox_1->SouthLatitude != bbox_2->SouthLatitude)
-	      return 0;
-	  if (bbox_1->EastLongitude != bbox_2->EastLongitude)
-	      return 0;
-	  if (bbox_1->NorthLatitude != bbox_2->NorthLatitude)
-	      return 0;
+	  if (p->hash == hash
+	      && projCacheItemMatches (p, proj_string_1, proj_string_2,
+				       bbox_1))
+	    {
+		if (p != cache->projCache.first)
+		  {
+		      projCacheUnlink (&(cache->projCache), p);
+		      projCachePushFront (&(cache->projCache), p);
+		  }
+		cache->projCache.hits += 1;
+		return 1;	/* anything nicely matches */
+	    }
+	  p = p->next;
       }
-    else
-	return 0;		/* mismatching area */
-
-    return 1;			/* anything nicely matches */
+    cache->projCache.misses += 1;
+    return 0;
 }
 #endif
+
+SPATIALITE_PRIVATE void
+splite_proj_cache_set_size (const void *p_cache, int max_items)
+{
+/* changing the max number of items stored into the PROJ cache
+/ a negative value identifies the default setting
+/ ZERO disables the cache at all
+*/
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    if (cache == NULL)
+	return;
+    if (max_items < 0)
+	max_items = SPLITE_PROJ_CACHE_DEFAULT;
+    if (max_items > SPLITE_PROJ_CACHE_MAX)
+	max_items = SPLITE_PROJ_CACHE_MAX;
+    cache->projCache.maxItems = max_items;
+#ifdef PROJ_NEW			/* only when using new PROJ.6 */
+    projCacheTrim (&(cache->projCache));
+#endif
+}
@@ -649,7 +649,7 @@ do_print_message3 (char **ptr, const char *message, const char *prefix,
 static int
 do_check_input (sqlite3 * handle, const char *db_prefix, const char *table,
 		const char *xgeometry, char **geometry, int *srid, int *type,
-		char **message)
+		int require_pk, char **message)
 {
 /* checking the input table for validity */
     char *sql;
@@ -699,7 +699,7 @@ do_check_input (sqlite3 * handle, const char *db_prefix, const char *table,
 			     db_prefix, table);
 	  goto error;
       }
-    if (pk == 0)
+    if (pk == 0 && require_pk)
       {
 	  do_print_message2 (message,
 			     "ERROR: table %s.%s lacks any Primary Key",
@@ -1663,7 +1663,7 @@ do_create_output_table (struct output_table *tbl, sqlite3 * handle,
 static int
 do_create_output_geometry (sqlite3 * handle, const char *table,
 			   const char *geometry, int srid, int geom_type,
-			   char **message)
+			   int multi, char **message)
 {
 /* attempting to create the Output Geometry */
     int ret;
@@ -1683,7 +1683,7 @@ do_create_output_geometry (sqlite3 * handle, const char *table,
       case GAIA_MULTIPOINTZ:
       case GAIA_MULTIPOINTM:
       case GAIA_MULTIPOINTZM:
-	  type = "POINT";
+	  type = (multi) ? "MULTIPOINT" : "POINT";
 	  break;
       case GAIA_LINESTRING:
       case GAIA_LINESTRINGZ:
@@ -1693,7 +1693,7 @@ do_create_output_geometry (sqlite3 * handle, const char *table,
       case GAIA_MULTILINESTRINGZ:
       case GAIA_MULTILINESTRINGM:
       case GAIA_MULTILINESTRINGZM:
-	  type = "LINESTRING";
+	  type = (multi) ? "MULTILINESTRING" : "LINESTRING";
 	  break;
       case GAIA_POLYGON:
       case GAIA_POLYGONZ:
@@ -1703,7 +1703,7 @@ do_create_output_geometry (sqlite3 * handle, const char *table,
       case GAIA_MULTIPOLYGONZ:
       case GAIA_MULTIPOLYGONM:
       case GAIA_MULTIPOLYGONZM:
-	  type = "POLYGON";
+	  type = (multi) ? "MULTIPOLYGON" : "POLYGON";
 	  break;
       };
     switch (geom_type)
@@ -7583,7 +7583,7 @@ gaiaCutter (sqlite3 * handle, const void *cache, const char *xin_db_prefix,
       }
     if (!do_check_input
 	(handle, in_db_prefix, input_table, xinput_geom, &input_geom,
-	 &input_srid, &input_type, message))
+	 &input_srid, &input_type, 1, message))
 	goto end;
     if (!do_check_blade
 	(handle, blade_db_prefix, blade_table, xblade_geom, &blade_geom,
@@ -7670,7 +7670,7 @@ gaiaCutter (sqlite3 * handle, const void *cache, const char *xin_db_prefix,
 	goto end;
 /* adding the Output Geometry */
     if (!do_create_output_geometry
-	(handle, out_table, input_geom, input_srid, input_type, message))
+	(handle, out_table, input_geom, input_srid, input_type, 0, message))
 	goto end;
 /* verifying the Blade Spatial Index */
     if (!do_verify_blade_spatial_index
@@ -7815,4 +7815,913 @@ gaiaCutter (sqlite3 * handle, const void *cache, const char *xin_db_prefix,
     return retcode;
 }
 
+#define DISSOLVE_BATCH	4096	/* max buffered rows before uniting */
+
+struct dissolve_row
+{
+/* a BLOB-Geometry waiting to be united */
+    unsigned char *blob;
+    int size;
+};
+
+struct dissolve_group
+{
+/* a group of input rows sharing the same key values */
+    sqlite3_value **keys;
+    struct dissolve_row *rows;
+    int count;
+    int max;
+    gaiaGeomCollPtr result;
+};
+
+struct dissolve_worker
+{
+/* a slice of the pending groups, processed by a single thread */
+    const void *cache;		/* owning the GEOS handle */
+    struct dissolve_group **groups;
+    int count;
+    void *thread;
+};
+
+struct dissolve_context
+{
+/* a struct wrapping the current Dissolve state */
+    const void *cache;
+    sqlite3_stmt *stmt_out;
+    int n_keys;
+    int srid;
+    int geom_class;
+    int has_z;
+    int tiny_point;
+    int max_threads;
+    struct dissolve_worker *workers;
+    int n_workers;
+    struct dissolve_group *current;
+    void *reducer;		/* only when the current group is a large one */
+    struct dissolve_group *pending[DISSOLVE_BATCH];
+    int n_pending;
+    int pending_rows;
+    char **message;
+};
+
+static struct dissolve_group *
+alloc_dissolve_group (sqlite3_stmt * stmt, int n_keys)
+{
+/* creating a new group - the key values are copied from the current row */
+    int i;
+    struct dissolve_group *group = malloc (sizeof (struct dissolve_group));
+    if (group == NULL)
+	return NULL;
+    group->keys = calloc (n_keys + 1, sizeof (sqlite3_value *));
+    group->rows = NULL;
+    group->count = 0;
+    group->max = 0;
+    group->result = NULL;
+    for (i = 0; i < n_keys; i++)
+	group->keys[i] = sqlite3_value_dup (sqlite3_column_value (stmt, i));
+    return group;
+}
+
+static void
+destroy_dissolve_group (struct dissolve_group *group, int n_keys)
+{
+/* memory cleanup - destroying a group */
+    int i;
+    if (group == NULL)
+	return;
+    for (i = 0; i < n_keys; i++)
+	sqlite3_value_free (group->keys[i]);
+    free (group->keys);
+    for (i = 0; i < group->count; i++)
+      {
+	  if (group->rows[i].blob != NULL)
+	      free (group->rows[i].blob);
+      }
+    if (group->rows != NULL)
+	free (group->rows);
+    if (group->result != NULL)
+	gaiaFreeGeomColl (group->result);
+    free (group);
+}
+
+static int
+dissolve_same_number (sqlite3_int64 int_value, double dbl_value)
+{
+/* checks if an INTEGER and a REAL value are numerically equal */
+    if (dbl_value < -9223372036854775808.0
+	|| dbl_value >= 9223372036854775808.0)
+	return 0;
+    if ((double) int_value != dbl_value)
+	return 0;
+    return (sqlite3_int64) dbl_value == int_value;
+}
+
+static int
+dissolve_same_value (sqlite3_value * value1, sqlite3_value * value2)
+{
+/* 
+/ checks if two key values are the same, consistently with the
+/ ORDER BY ... COLLATE BINARY used for sorting the input rows
+/ (INTEGER and REAL values comparing equal belong to the same group)
+*/
+    int type = sqlite3_value_type (value1);
+    int len;
+    if (value2 == NULL)
+	return 0;
+    if (type == SQLITE_INTEGER && sqlite3_value_type (value2) == SQLITE_FLOAT)
+	return dissolve_same_number (sqlite3_value_int64 (value1),
+				     sqlite3_value_double (value2));
+    if (type == SQLITE_FLOAT && sqlite3_value_type (value2) == SQLITE_INTEGER)
+	return dissolve_same_number (sqlite3_value_int64 (value2),
+				     sqlite3_value_double (value1));
+    if (sqlite3_value_type (value2) != type)
+	return 0;
+    switch (type)
+      {
+      case SQLITE_INTEGER:
+	  return sqlite3_value_int64 (value1) == sqlite3_value_int64 (value2);
+      case SQLITE_FLOAT:
+	  return sqlite3_value_double (value1) == sqlite3_value_double (value2);
+      case SQLITE_TEXT:
+	  len = sqlite3_value_bytes (value1);
+	  if (len != sqlite3_value_bytes (value2))
+	      return 0;
+	  return memcmp (sqlite3_value_text (value1),
+			 sqlite3_value_text (value2), len) == 0;
+      case SQLITE_BLOB:
+	  len = sqlite3_value_bytes (value1);
+	  if (len != sqlite3_value_bytes (value2))
+	      return 0;
+	  if (len == 0)
+	      return 1;
+	  return memcmp (sqlite3_value_blob (value1),
+			 sqlite3_value_blob (value2), len) == 0;
+      };
+    return 1;
+}
+
+static int
+dissolve_same_group (struct dissolve_group *group, sqlite3_stmt * stmt,
+		     int n_keys)
+{
+/* checks if the current row belongs to the current group */
+    int i;
+    for (i = 0; i < n_keys; i++)
+      {
+	  if (!dissolve_same_value
+	      (sqlite3_column_value (stmt, i), group->keys[i]))
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+dissolve_add_row (struct dissolve_group *group, const unsigned char *blob,
+		  int size)
+{
+/* appending a copy of some BLOB-Geometry to a group */
+    struct dissolve_row *row;
+    if (group->count == group->max)
+      {
+	  int max = (group->max == 0) ? 16 : group->max * 2;
+	  struct dissolve_row *rows =
+	      realloc (group->rows, sizeof (struct dissolve_row) * max);
+	  if (rows == NULL)
+	      return 0;
+	  group->rows = rows;
+	  group->max = max;
+      }
+    row = group->rows + group->count;
+    row->blob = malloc (size);
+    if (row->blob == NULL)
+	return 0;
+    memcpy (row->blob, blob, size);
+    row->size = size;
+    group->count++;
+    return 1;
+}
+
+static void
+dissolve_work (void *arg)
+{
+/* uniting all groups belonging to a slice */
+    struct dissolve_worker *worker = (struct dissolve_worker *) arg;
+    int i;
+    int j;
+    for (i = 0; i < worker->count; i++)
+      {
+	  struct dissolve_group *group = worker->groups[i];
+	  void *reducer = gaiaUnionReducerCreate (worker->cache, 1);
+	  if (reducer == NULL)
+	      continue;
+	  for (j = 0; j < group->count; j++)
+	    {
+		struct dissolve_row *row = group->rows + j;
+		gaiaUnionReducerAdd (reducer,
+				     gaiaFromSpatiaLiteBlobWkb (row->blob,
+								row->size));
+		free (row->blob);
+		row->blob = NULL;
+	    }
+	  group->result = gaiaUnionReducerFinish (reducer);
+	  gaiaUnionReducerDestroy (reducer);
+      }
+}
+
+static gaiaGeomCollPtr
+dissolve_prepare (struct dissolve_context *ctx, gaiaGeomCollPtr geom)
+{
+/* casting a united Geometry to the Output Geometry Type */
+    gaiaGeomCollPtr elems;
+    gaiaGeomCollPtr result;
+    if (geom == NULL)
+	return NULL;
+    if (ctx->geom_class == GAIA_CUTTER_POINT)
+	elems = gaiaCloneGeomCollPoints (geom);
+    else if (ctx->geom_class == GAIA_CUTTER_LINESTRING)
+	elems = gaiaCloneGeomCollLinestrings (geom);
+    else
+	elems = gaiaCloneGeomCollPolygons (geom);
+    if (elems == NULL)
+	return NULL;
+    if (gaiaIsEmpty (elems))
+      {
+	  gaiaFreeGeomColl (elems);
+	  return NULL;
+      }
+    if (ctx->has_z)
+	result = gaiaCastGeomCollToXYZ (elems);
+    else
+	result = gaiaCastGeomCollToXY (elems);
+    gaiaFreeGeomColl (elems);
+    if (result == NULL)
+	return NULL;
+    result->Srid = ctx->srid;
+    if (ctx->geom_class == GAIA_CUTTER_POINT)
+	result->DeclaredType = GAIA_MULTIPOINT;
+    else if (ctx->geom_class == GAIA_CUTTER_LINESTRING)
+	result->DeclaredType = GAIA_MULTILINESTRING;
+    else
+	result->DeclaredType = GAIA_MULTIPOLYGON;
+    return result;
+}
+
+static int
+dissolve_write (struct dissolve_context *ctx, struct dissolve_group *group)
+{
+/* inserting a dissolved group into the Output Table */
+    int i;
+    int ret;
+    gaiaGeomCollPtr geom = dissolve_prepare (ctx, group->result);
+    sqlite3_reset (ctx->stmt_out);
+    sqlite3_clear_bindings (ctx->stmt_out);
+    for (i = 0; i < ctx->n_keys; i++)
+	sqlite3_bind_value (ctx->stmt_out, i + 1, group->keys[i]);
+    if (geom == NULL)
+	sqlite3_bind_null (ctx->stmt_out, ctx->n_keys + 1);
+    else
+      {
+	  unsigned char *blob;
+	  int size;
+	  gaiaToSpatiaLiteBlobWkbEx2 (geom, &blob, &size, 0, ctx->tiny_point);
+	  gaiaFreeGeomColl (geom);
+	  sqlite3_bind_blob (ctx->stmt_out, ctx->n_keys + 1, blob, size, free);
+      }
+    ret = sqlite3_step (ctx->stmt_out);
+    if (ret == SQLITE_DONE || ret == SQLITE_ROW)
+	return 1;
+    do_update_sql_error (ctx->message, "INSERT INTO Output",
+			 sqlite3_errmsg (sqlite3_db_handle (ctx->stmt_out)));
+    return 0;
+}
+
+static int
+dissolve_flush (struct dissolve_context *ctx)
+{
+/* uniting all pending groups, then writing them in key order */
+    int i;
+    int base = 0;
+    int n_workers = 0;
+    int retcode = 1;
+    if (ctx->n_pending == 0)
+	return 1;
+
+/* splitting the pending groups into slices of about the same row count */
+    while (base < ctx->n_pending && n_workers < ctx->n_workers)
+      {
+	  struct dissolve_worker *worker = ctx->workers + n_workers;
+	  int rows = 0;
+	  int target = ctx->pending_rows / ctx->n_workers;
+	  worker->groups = ctx->pending + base;
+	  worker->count = 0;
+	  worker->thread = NULL;
+	  while (base < ctx->n_pending)
+	    {
+		rows += ctx->pending[base]->count;
+		worker->count++;
+		base++;
+		if (rows >= target && n_workers < ctx->n_workers - 1)
+		    break;
+	    }
+	  n_workers++;
+      }
+    for (i = 1; i < n_workers; i++)
+      {
+	  struct dissolve_worker *worker = ctx->workers + i;
+	  worker->thread = splite_thread_create (dissolve_work, worker);
+	  if (worker->thread == NULL)
+	      dissolve_work (worker);	/* falling back to serial */
+      }
+/* the current thread always processes the first slice */
+    dissolve_work (ctx->workers);
+    for (i = 1; i < n_workers; i++)
+      {
+	  if (ctx->workers[i].thread != NULL)
+	      splite_thread_join (ctx->workers[i].thread);
+	  ctx->workers[i].thread = NULL;
+      }
+
+    for (i = 0; i < ctx->n_pending; i++)
+      {
+	  if (retcode && !dissolve_write (ctx, ctx->pending[i]))
+	      retcode = 0;
+	  destroy_dissolve_group (ctx->pending[i], ctx->n_keys);
+	  ctx->pending[i] = NULL;
+      }
+    ctx->n_pending = 0;
+    ctx->pending_rows = 0;
+    return retcode;
+}
+
+static int
+dissolve_large_group (struct dissolve_context *ctx)
+{
+/* 
+/ the current group is too big to be buffered: all other pending
+/ groups are flushed, and its rows will be incrementally reduced
+/ (using all worker threads) as they are read
+*/
+    int i;
+    struct dissolve_group *group = ctx->current;
+    if (!dissolve_flush (ctx))
+	return 0;
+    ctx->reducer = gaiaUnionReducerCreate (ctx->cache, ctx->max_threads);
+    if (ctx->reducer == NULL)
+      {
+	  do_update_message (ctx->message, "ERROR: insufficient memory");
+	  return 0;
+      }
+    for (i = 0; i < group->count; i++)
+      {
+	  struct dissolve_row *row = group->rows + i;
+	  gaiaUnionReducerAdd (ctx->reducer,
+			       gaiaFromSpatiaLiteBlobWkb (row->blob,
+							  row->size));
+	  free (row->blob);
+      }
+    free (group->rows);
+    group->rows = NULL;
+    group->count = 0;
+    group->max = 0;
+    return 1;
+}
+
+static int
+dissolve_end_group (struct dissolve_context *ctx)
+{
+/* the current group is now complete */
+    struct dissolve_group *group = ctx->current;
+    int ret;
+    if (group == NULL)
+	return 1;
+    ctx->current = NULL;
+    if (ctx->reducer != NULL)
+      {
+	  /* a large group: immediately written */
+	  group->result = gaiaUnionReducerFinish (ctx->reducer);
+	  gaiaUnionReducerDestroy (ctx->reducer);
+	  ctx->reducer = NULL;
+	  ret = dissolve_write (ctx, group);
+	  destroy_dissolve_group (group, ctx->n_keys);
+	  return ret;
+      }
+    ctx->pending[ctx->n_pending++] = group;
+    ctx->pending_rows += group->count;
+    if (ctx->pending_rows >= DISSOLVE_BATCH || ctx->n_pending == DISSOLVE_BATCH)
+	return dissolve_flush (ctx);
+    return 1;
+}
+
+static int
+dissolve_read_row (struct dissolve_context *ctx, sqlite3_stmt * stmt)
+{
+/* processing an input row */
+    int geom_idx = ctx->n_keys;
+    const unsigned char *blob;
+    int size;
+    if (ctx->current != NULL
+	&& !dissolve_same_group (ctx->current, stmt, ctx->n_keys))
+      {
+	  if (!dissolve_end_group (ctx))
+	      return 0;
+      }
+    if (ctx->current == NULL)
+      {
+	  ctx->current = alloc_dissolve_group (stmt, ctx->n_keys);
+	  if (ctx->current == NULL)
+	    {
+		do_update_message (ctx->message, "ERROR: insufficient memory");
+		return 0;
+	    }
+      }
+    if (sqlite3_column_type (stmt, geom_idx) != SQLITE_BLOB)
+	return 1;
+    blob = sqlite3_column_blob (stmt, geom_idx);
+    size = sqlite3_column_bytes (stmt, geom_idx);
+    if (ctx->reducer != NULL)
+      {
+	  gaiaUnionReducerAdd (ctx->reducer,
+			       gaiaFromSpatiaLiteBlobWkb (blob, size));
+	  return 1;
+      }
+    if (!dissolve_add_row (ctx->current, blob, size))
+      {
+	  do_update_message (ctx->message, "ERROR: insufficient memory");
+	  return 0;
+      }
+    if (ctx->current->count > DISSOLVE_BATCH)
+	return dissolve_large_group (ctx);
+    return 1;
+}
+
+static int
+do_get_dissolve_keys (struct output_table *tbl, sqlite3 * handle,
+		      const char *table, const char *geometry,
+		      const char *group_by, int *n_keys, char **message)
+{
+/* parsing the comma separated list of Group By columns */
+    int ret;
+    char *sql;
+    char *xtable;
+    char **results;
+    int rows;
+    int columns;
+    char *errMsg = NULL;
+    const char *p = group_by;
+    int i;
+    int count = 0;
+
+    *n_keys = 0;
+    xtable = gaiaDoubleQuotedSql (table);
+    sql = sqlite3_mprintf ("PRAGMA MAIN.table_info(\"%s\")", xtable);
+    free (xtable);
+    ret = sqlite3_get_table (handle, sql, &results, &rows, &columns, &errMsg);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  do_update_sql_error (message, "PRAGMA table_info", errMsg);
+	  sqlite3_free (errMsg);
+	  return 0;
+      }
+    while (p != NULL && *p != '\0')
+      {
+	  /* extracting the next column name */
+	  const char *start;
+	  const char *end;
+	  char *name;
+	  int len;
+	  int found = 0;
+	  struct output_column *col;
+	  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+	      p++;
+	  start = p;
+	  while (*p != ',' && *p != '\0')
+	      p++;
+	  end = p;
+	  if (*p == ',')
+	      p++;
+	  while (end > start
+		 && (*(end - 1) == ' ' || *(end - 1) == '\t'
+		     || *(end - 1) == '\n' || *(end - 1) == '\r'))
+	      end--;
+	  len = end - start;
+	  if (len == 0)
+	    {
+		do_update_message (message,
+				   "ERROR: invalid Group By columns list");
+		goto error;
+	    }
+	  name = malloc (len + 1);
+	  memcpy (name, start, len);
+	  *(name + len) = '\0';
+	  for (i = 1; i <= rows; i++)
+	    {
+		const char *col_name = results[(i * columns) + 1];
+		const char *col_type = results[(i * columns) + 2];
+		if (strcasecmp (col_name, name) != 0)
+		    continue;
+		found = 1;
+		if (strcasecmp (col_name, geometry) == 0
+		    || strcasecmp (col_name, "PK_UID") == 0)
+		  {
+		      do_print_message2 (message,
+					 "ERROR: column %s.%s can't be used for grouping",
+					 table, col_name);
+		      free (name);
+		      goto error;
+		  }
+		col = tbl->first;
+		while (col != NULL)
+		  {
+		      if (strcasecmp (col->base_name, col_name) == 0)
+			{
+			    do_print_message2 (message,
+					       "ERROR: column %s.%s is listed twice",
+					       table, col_name);
+			    free (name);
+			    goto error;
+			}
+		      col = col->next;
+		  }
+		if (add_column_to_output_table
+		    (tbl, col_name, (col_type == NULL) ? "" : col_type, 0,
+		     GAIA_CUTTER_NORMAL, count) == NULL)
+		  {
+		      do_update_message (message,
+					 "ERROR: insufficient memory (OutputTable wrapper)");
+		      free (name);
+		      goto error;
+		  }
+		count++;
+		break;
+	    }
+	  if (!found)
+	    {
+		do_print_message2 (message,
+				   "ERROR: table %s has no column named %s",
+				   table, name);
+		free (name);
+		goto error;
+	    }
+	  free (name);
+      }
+    sqlite3_free_table (results);
+    *n_keys = count;
+    return 1;
+
+  error:
+    sqlite3_free_table (results);
+    return 0;
+}
+
+static int
+do_dissolve_rows (struct dissolve_context *ctx, struct output_table *tbl,
+		  sqlite3 * handle, const char *input_table,
+		  const char *input_geom, const char *out_table,
+		  const char *out_geom)
+{
+/* reading all input rows sorted by key, and uniting each group */
+    int ret;
+    int retcode = 0;
+    sqlite3_stmt *stmt_in = NULL;
+    char *sql;
+    char *prev;
+    char *select_list;
+    char *order_by;
+    char *insert_list;
+    char *values;
+    char *xcolumn;
+    char *xtable;
+    struct output_column *col;
+    int comma = 0;
+
+/* composing the column lists */
+    select_list = sqlite3_mprintf ("");
+    order_by = sqlite3_mprintf ("");
+    insert_list = sqlite3_mprintf ("");
+    values = sqlite3_mprintf ("");
+    col = tbl->first;
+    while (col != NULL)
+      {
+	  if (col->role == GAIA_CUTTER_NORMAL)
+	    {
+		xcolumn = gaiaDoubleQuotedSql (col->base_name);
+		prev = select_list;
+		select_list = sqlite3_mprintf ("%s\"%s\", ", prev, xcolumn);
+		sqlite3_free (prev);
+		prev = order_by;
+		order_by =
+		    sqlite3_mprintf ("%s%s\"%s\" COLLATE BINARY", prev,
+				     (comma) ? ", " : "", xcolumn);
+		sqlite3_free (prev);
+		prev = insert_list;
+		insert_list = sqlite3_mprintf ("%s\"%s\", ", prev, xcolumn);
+		sqlite3_free (prev);
+		prev = values;
+		values = sqlite3_mprintf ("%s?, ", prev);
+		sqlite3_free (prev);
+		free (xcolumn);
+		comma = 1;
+	    }
+	  col = col->next;
+      }
+
+/* preparing the INPUT statement */
+    xtable = gaiaDoubleQuotedSql (input_table);
+    xcolumn = gaiaDoubleQuotedSql (input_geom);
+    if (comma)
+	sql =
+	    sqlite3_mprintf ("SELECT %s\"%s\" FROM MAIN.\"%s\" ORDER BY %s",
+			     select_list, xcolumn, xtable, order_by);
+    else
+	sql =
+	    sqlite3_mprintf ("SELECT \"%s\" FROM MAIN.\"%s\"", xcolumn,
+			     xtable);
+    free (xtable);
+    free (xcolumn);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt_in, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  do_update_sql_error (ctx->message, "SELECT FROM Input",
+			       sqlite3_errmsg (handle));
+	  goto end;
+      }
+
+/* preparing the OUTPUT statement */
+    xtable = gaiaDoubleQuotedSql (out_table);
+    xcolumn = gaiaDoubleQuotedSql (out_geom);
+    sql =
+	sqlite3_mprintf ("INSERT INTO MAIN.\"%s\" (%s\"%s\") VALUES (%s?)",
+			 xtable, insert_list, xcolumn, values);
+    free (xtable);
+    free (xcolumn);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &(ctx->stmt_out),
+			      NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  do_update_sql_error (ctx->message, "INSERT INTO Output",
+			       sqlite3_errmsg (handle));
+	  goto end;
+      }
+
+    while (1)
+      {
+	  /* scrolling the result set rows */
+	  ret = sqlite3_step (stmt_in);
+	  if (ret == SQLITE_DONE)
+	      break;		/* end of result set */
+	  if (ret != SQLITE_ROW)
+	    {
+		do_update_sql_error (ctx->message, "SELECT FROM Input",
+				     sqlite3_errmsg (handle));
+		goto end;
+	    }
+	  if (!dissolve_read_row (ctx, stmt_in))
+	      goto end;
+      }
+    if (!dissolve_end_group (ctx))
+	goto end;
+    if (!dissolve_flush (ctx))
+	goto end;
+    retcode = 1;
+
+  end:
+    sqlite3_free (select_list);
+    sqlite3_free (order_by);
+    sqlite3_free (insert_list);
+    sqlite3_free (values);
+    if (stmt_in != NULL)
+	sqlite3_finalize (stmt_in);
+    if (ctx->stmt_out != NULL)
+	sqlite3_finalize (ctx->stmt_out);
+    ctx->stmt_out = NULL;
+    return retcode;
+}
+
+static int
+do_dissolve_exec (sqlite3 * handle, const char *sql, const char *title,
+		  char **message)
+{
+/* executing some SQL statement */
+    char *errMsg = NULL;
+    int ret = sqlite3_exec (handle, sql, NULL, NULL, &errMsg);
+    if (ret != SQLITE_OK)
+      {
+	  do_update_sql_error (message, title, errMsg);
+	  sqlite3_free (errMsg);
+	  return 0;
+      }
+    return 1;
+}
+
+SPATIALITE_DECLARE int
+gaiaDissolveTable (sqlite3 * handle, const void *p_cache,
+		   const char *input_table, const char *xinput_geom,
+		   const char *group_by, const char *out_table,
+		   int max_threads, char **message)
+{
+/* main Dissolve tool implementation */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    char *input_geom = NULL;
+    char *out_geom = NULL;
+    int input_type;
+    int input_srid;
+    int retcode = 0;
+    int pending = 0;
+    int i;
+    char *sql;
+    struct output_table *tbl = NULL;
+    struct dissolve_context ctx;
+
+    memset (&ctx, 0, sizeof (struct dissolve_context));
+    ctx.message = message;
+
+/* testing and validating the arguments */
+    do_reset_message (message);
+    if (cache == NULL)
+      {
+	  do_update_message (message, "ERROR: invalid connection cache");
+	  goto end;
+      }
+    if (input_table == NULL)
+      {
+	  do_update_message (message,
+			     "ERROR: input table name can't be NULL");
+	  goto end;
+      }
+    if (out_table == NULL)
+      {
+	  do_update_message (message,
+			     "ERROR: output table name can't be NULL");
+	  goto end;
+      }
+    if (!do_check_input
+	(handle, "MAIN", input_table, xinput_geom, &input_geom,
+	 &input_srid, &input_type, 0, message))
+	goto end;
+    if (!do_check_output (handle, "MAIN", out_table, input_geom, message))
+	goto end;
+
+/* determining the Output Table layout */
+    tbl = alloc_output_table ();
+    if (tbl == NULL)
+      {
+	  do_update_message (message,
+			     "ERROR: insufficient memory (OutputTable wrapper)");
+	  goto end;
+      }
+    if (add_column_to_output_table
+	(tbl, "PK_UID", "INTEGER", 0, GAIA_CUTTER_OUTPUT_PK, 0) == NULL)
+      {
+	  do_update_message (message,
+			     "ERROR: insufficient memory (OutputTable wrapper)");
+	  goto end;
+      }
+    if (!do_get_dissolve_keys
+	(tbl, handle, input_table, input_geom, group_by, &(ctx.n_keys),
+	 message))
+	goto end;
+
+    ctx.cache = cache;
+    ctx.srid = input_srid;
+    ctx.tiny_point = cache->tinyPointEnabled;
+    switch (input_type)
+      {
+      case GAIA_POINT:
+      case GAIA_POINTZ:
+      case GAIA_POINTM:
+      case GAIA_POINTZM:
+      case GAIA_MULTIPOINT:
+      case GAIA_MULTIPOINTZ:
+      case GAIA_MULTIPOINTM:
+      case GAIA_MULTIPOINTZM:
+	  ctx.geom_class = GAIA_CUTTER_POINT;
+	  break;
+      case GAIA_LINESTRING:
+      case GAIA_LINESTRINGZ:
+      case GAIA_LINESTRINGM:
+      case GAIA_LINESTRINGZM:
+      case GAIA_MULTILINESTRING:
+      case GAIA_MULTILINESTRINGZ:
+      case GAIA_MULTILINESTRINGM:
+      case GAIA_MULTILINESTRINGZM:
+	  ctx.geom_class = GAIA_CUTTER_LINESTRING;
+	  break;
+      default:
+	  ctx.geom_class = GAIA_CUTTER_POLYGON;
+	  break;
+      };
+    switch (input_type)
+      {
+      case GAIA_POINTZ:
+      case GAIA_LINESTRINGZ:
+      case GAIA_POLYGONZ:
+      case GAIA_MULTIPOINTZ:
+      case GAIA_MULTILINESTRINGZ:
+      case GAIA_MULTIPOLYGONZ:
+      case GAIA_POINTZM:
+      case GAIA_LINESTRINGZM:
+      case GAIA_POLYGONZM:
+      case GAIA_MULTIPOINTZM:
+      case GAIA_MULTILINESTRINGZM:
+      case GAIA_MULTIPOLYGONZM:
+	  ctx.has_z = 1;
+	  break;
+      };
+
+/* each worker thread needs a GEOS handle of its own */
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    ctx.max_threads = max_threads;
+    ctx.workers = calloc (max_threads, sizeof (struct dissolve_worker));
+    if (ctx.workers == NULL)
+      {
+	  do_update_message (message, "ERROR: insufficient memory");
+	  goto end;
+      }
+    for (i = 0; i < max_threads; i++)
+      {
+	  struct dissolve_worker *worker = ctx.workers + i;
+	  if (i == 0)
+	      worker->cache = cache;
+	  else
+	    {
+		worker->cache = spatialite_alloc_connection ();
+		if (worker->cache == NULL)
+		    break;	/* no more free connection slots */
+	    }
+	  ctx.n_workers++;
+      }
+
+    if (!do_dissolve_exec
+	(handle, "SAVEPOINT dissolve_table", "SAVEPOINT", message))
+	goto end;
+    pending = 1;
+
+/* creating the Output Table */
+    if (!do_create_output_table
+	(tbl, handle, out_table, input_table, NULL, message))
+	goto end;
+/* adding the Output Geometry */
+    if (!do_create_output_geometry
+	(handle, out_table, input_geom, input_srid, input_type, 1, message))
+	goto end;
+    out_geom = sqlite3_mprintf ("%s", input_geom);
+    make_lowercase (out_geom);
+
+    if (!do_dissolve_rows
+	(&ctx, tbl, handle, input_table, input_geom, out_table, out_geom))
+	goto end;
+
+/* the Spatial Index is built just once, after inserting all rows */
+    sql =
+	sqlite3_mprintf ("SELECT CreateSpatialIndex(Lower(%Q), Lower(%Q))",
+			 out_table, input_geom);
+    i = do_dissolve_exec (handle, sql, "CreateSpatialIndex", message);
+    sqlite3_free (sql);
+    if (!i)
+	goto end;
+
+    if (!do_dissolve_exec
+	(handle, "RELEASE SAVEPOINT dissolve_table", "RELEASE SAVEPOINT",
+	 message))
+	goto end;
+    pending = 0;
+    retcode = 1;
+
+  end:
+    if (pending)
+      {
+	  /* rolling back everything */
+	  do_dissolve_exec (handle, "ROLLBACK TO SAVEPOINT dissolve_table",
+			    "ROLLBACK TO SAVEPOINT", message);
+	  do_dissolve_exec (handle, "RELEASE SAVEPOINT dissolve_table",
+			    "RELEASE SAVEPOINT", message);
+      }
+    if (ctx.reducer != NULL)
+	gaiaUnionReducerDestroy (ctx.reducer);
+    if (ctx.current != NULL)
+	destroy_dissolve_group (ctx.current, ctx.n_keys);
+    for (i = 0; i < ctx.n_pending; i++)
+	destroy_dissolve_group (ctx.pending[i], ctx.n_keys);
+    if (ctx.workers != NULL)
+      {
+	  for (i = 1; i < ctx.n_workers; i++)
+	      spatialite_cleanup_ex (ctx.workers[i].cache);
+	  free (ctx.workers);
+      }
+    if (input_geom != NULL)
+	free (input_geom);
+    if (out_geom != NULL)
+	sqlite3_free (out_geom);
+    if (tbl != NULL)
+	destroy_output_table (tbl);
+    return retcode;
+}
+
 #endif /* end GEOS conditionals */
@@ -2360,6 +2360,62 @@ gaiaExifTagGetHumanReadable (const gaiaExifTagPtr tag, char *str, int len,
     *ok = 0;
 }
 
+static int
+skip_quantized_varint (const unsigned char *blob, int size, int *offset,
+		       int *value)
+{
+/* skipping a varint; small values (counts) are returned as well */
+    int shift = 0;
+    int v = 0;
+    while (*offset < size && shift < 70)
+      {
+	  unsigned char c = *(blob + *offset);
+	  *offset += 1;
+	  if (shift < 28)
+	      v |= (c & 0x7f) << shift;
+	  if ((c & 0x80) == 0)
+	    {
+		*value = (shift < 28) ? v : -1;
+		return 1;
+	    }
+	  shift += 7;
+      }
+    return 0;
+}
+
+static int
+skip_quantized_item (const unsigned char *blob, int size, int *offset,
+		     int n_coords, int polygon)
+{
+/* skipping a quantized LINESTRING or POLYGON */
+    int rings = 1;
+    int points;
+    int ib;
+    int iv;
+    int dummy;
+    *offset += n_coords - 1;	/* precisions */
+    if (polygon)
+      {
+	  if (!skip_quantized_varint (blob, size, offset, &rings))
+	      return 0;
+	  if (rings < 0)
+	      return 0;
+      }
+    for (ib = 0; ib < rings; ib++)
+      {
+	  if (!skip_quantized_varint (blob, size, offset, &points))
+	      return 0;
+	  if (points < 0 || points > (size - *offset) / n_coords)
+	      return 0;
+	  for (iv = 0; iv < points * n_coords; iv++)
+	    {
+		if (!skip_quantized_varint (blob, size, offset, &dummy))
+		    return 0;
+	    }
+      }
+    return 1;
+}
+
 static int
 parse_multi_geom (const unsigned char *blob, int size, int endian,
 		  int endian_arch, int *is_compr)
@@ -2583,6 +2639,46 @@ parse_multi_geom (const unsigned char *blob, int size, int endian,
 		  }
 		compressed = 1;
 		break;
+	    case GAIA_QUANTIZED_LINESTRING:
+		if (!skip_quantized_item (blob, size, &offset, 2, 0))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGZ:
+		if (!skip_quantized_item (blob, size, &offset, 3, 0))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGM:
+		if (!skip_quantized_item (blob, size, &offset, 3, 0))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGZM:
+		if (!skip_quantized_item (blob, size, &offset, 4, 0))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_POLYGON:
+		if (!skip_quantized_item (blob, size, &offset, 2, 1))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_POLYGONZ:
+		if (!skip_quantized_item (blob, size, &offset, 3, 1))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_POLYGONM:
+		if (!skip_quantized_item (blob, size, &offset, 3, 1))
+		    return 0;
+		compressed = 1;
+		break;
+	    case GAIA_QUANTIZED_POLYGONZM:
+		if (!skip_quantized_item (blob, size, &offset, 4, 1))
+		    return 0;
+		compressed = 1;
+		break;
 	    default:
 		return 0;
 	    };
@@ -2813,6 +2909,14 @@ gaiaGuessBlobType (const unsigned char *blob, int size)
 	    case GAIA_COMPRESSED_POLYGONZ:
 	    case GAIA_COMPRESSED_POLYGONM:
 	    case GAIA_COMPRESSED_POLYGONZM:
+	    case GAIA_QUANTIZED_LINESTRING:
+	    case GAIA_QUANTIZED_LINESTRINGZ:
+	    case GAIA_QUANTIZED_LINESTRINGM:
+	    case GAIA_QUANTIZED_LINESTRINGZM:
+	    case GAIA_QUANTIZED_POLYGON:
+	    case GAIA_QUANTIZED_POLYGONZ:
+	    case GAIA_QUANTIZED_POLYGONM:
+	    case GAIA_QUANTIZED_POLYGONZM:
 		return GAIA_COMPRESSED_GEOMETRY_BLOB;
 	    case GAIA_MULTILINESTRING:
 	    case GAIA_MULTILINESTRINGZ:
@@ -58,6 +58,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite/debug.h>
 
 #include <spatialite/gaiageo.h>
+#include <spatialite_private.h>
 
 #ifdef _WIN32
 #define strcasecmp	_stricmp
@@ -1847,7 +1848,7 @@ findEwktSrid (const char *buffer, int *base_offset)
 	    }
 	  in++;
       }
-    if (end < 0)
+    if (end < 0 || end >= (int) sizeof (dummy))
 	return -1;
     in = buffer;
     out = dummy;
@@ -1883,16 +1884,33 @@ findEwktSrid (const char *buffer, int *base_offset)
 gaiaGeomCollPtr
 gaiaParseEWKT (const unsigned char *dirty_buffer)
 {
-    void *pParser = ParseAlloc (malloc);
+    void *pParser;
     /* Linked-list of token values */
-    ewktFlexToken *tokens = malloc (sizeof (ewktFlexToken));
+    ewktFlexToken *tokens;
     /* Pointer to the head of the list */
-    ewktFlexToken *head = tokens;
+    ewktFlexToken *head;
     int yv;
     int srid;
     int base_offset;
     yyscan_t scanner;
     struct ewkt_data str_data;
+    gaiaGeomCollPtr geom;
+
+    srid = findEwktSrid ((char *) dirty_buffer, &base_offset);
+
+/* attempting first to use the fast single-pass reader */
+    geom = wkt_fast_parse (dirty_buffer + base_offset, 1);
+    if (geom != NULL)
+      {
+	  gaiaMbrGeometry (geom);
+	  geom->Srid = srid;
+	  return geom;
+      }
+
+/* falling back to the Lemon parser */
+    pParser = ParseAlloc (malloc);
+    tokens = malloc (sizeof (ewktFlexToken));
+    head = tokens;
 
 /* initializing the helper structs */
     str_data.ewkt_line = 1;
@@ -1906,7 +1924,6 @@ gaiaParseEWKT (const unsigned char *dirty_buffer)
     Ewktlex_init_extra (&str_data, &scanner);
     tokens->Next = NULL;
 
-    srid = findEwktSrid ((char *) dirty_buffer, &base_offset);
     Ewkt_scan_string ((char *) dirty_buffer + base_offset, scanner);
 
     /*
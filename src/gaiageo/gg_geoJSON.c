@@ -64,6 +64,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite/debug.h>
 
 #include <spatialite/gaiageo.h>
+#include <spatialite_private.h>
 
 #define GEOJSON_DYN_NONE	0
 #define GEOJSON_DYN_POINT	1
@@ -1474,7 +1475,11 @@ geoJSONnormalize (const char *dirty)
     n_crs = geoJSONlen (i_crs, i_coordinates, i_type, i_bbox, i_end, len);
     n_bbox = geoJSONlen (i_bbox, i_coordinates, i_type, i_crs, i_end, len);
 
-    clean = malloc (len + 1);
+/* 
+/ the normalized expression could be slightly longer than the original one:
+/ a COMMA is always appended to type, crs and bbox, and a closing brace too
+*/
+    clean = malloc (len + 5);
 
     if (i_end < 0)
       {
@@ -1577,15 +1582,30 @@ geoJSONnormalize (const char *dirty)
 gaiaGeomCollPtr
 gaiaParseGeoJSON (const unsigned char *dirty_buffer)
 {
-    void *pParser = ParseAlloc (malloc);
+    void *pParser;
     /* Linked-list of token values */
-    geoJsonFlexToken *tokens = malloc (sizeof (geoJsonFlexToken));
+    geoJsonFlexToken *tokens;
     /* Pointer to the head of the list */
-    geoJsonFlexToken *head = tokens;
+    geoJsonFlexToken *head;
     int yv;
     yyscan_t scanner;
     struct geoJson_data str_data;
-    char *normalized_buffer = geoJSONnormalize ((const char *) dirty_buffer);
+    char *normalized_buffer;
+    gaiaGeomCollPtr geom;
+
+/* attempting first the fast single-pass reader */
+    geom = geojson_fast_parse (dirty_buffer);
+    if (geom != NULL)
+      {
+	  gaiaMbrGeometry (geom);
+	  return geom;
+      }
+
+/* falling back to the Lemon parser */
+    pParser = ParseAlloc (malloc);
+    tokens = malloc (sizeof (geoJsonFlexToken));
+    head = tokens;
+    normalized_buffer = geoJSONnormalize ((const char *) dirty_buffer);
 
 /* initializing the helper structs */
     str_data.geoJson_line = 1;
@@ -0,0 +1,920 @@
+/*
+
+ gg_geojsonread.c -- Gaia fast single-pass GeoJSON reader
+  
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Klaus Foerster klaus.foerster@svg.cc
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+/*
+ a recursive-descent reader accepting the same GeoJSON geometries as the
+ Flex/Lemon parser, but building the Geometry in a single pass: the
+ vertices of each Linestring or Ring are counted in advance, so that
+ coordinates are directly stored into their final Coords array without
+ any intermediate token, point or dynamic allocation list
+
+ any input not strictly matching the supported syntax simply makes the
+ reader to give up, so that the Lemon parser will then handle it (and
+ eventually report the error)
+
+ the same JSON scanning primitives are used by VirtualGeoJSON in order
+ to read the members of each Feature's "properties" object
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite/geojson.h>
+#include <spatialite_private.h>
+
+#define GEOJSONREAD_TYPE	1
+#define GEOJSONREAD_COORDS	2
+#define GEOJSONREAD_GEOMS	3
+#define GEOJSONREAD_BBOX	4
+#define GEOJSONREAD_CRS		5
+
+#define GEOJSONREAD_MAX_SRID_DIGITS	9
+#define GEOJSONREAD_MAX_INT_DIGITS	18
+
+struct geojson_reader
+{
+/* a struct wrapping the fast GeoJSON reader status */
+    const char *p;		/* current position */
+    int dims;			/* how many coordinates for each vertex */
+    gaiaGeomCollPtr geom;	/* the Geometry being built */
+};
+
+static const char *geojson_class_names[] = {
+    "Point", "LineString", "Polygon", "MultiPoint", "MultiLineString",
+    "MultiPolygon", "GeometryCollection"
+};
+
+static const char *geojson_member_names[] = {
+    "type", "coordinates", "geometries", "bbox", "crs"
+};
+
+static int
+geojson_is_blank (char c)
+{
+/* the whitespaces ignored by the Flex lexer */
+    if (c == ' ' || c == '\t' || c == '\n')
+	return 1;
+    return 0;
+}
+
+static const char *
+geojson_skip_json_blanks (const char *p)
+{
+/* skipping any JSON whitespace */
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+	p++;
+    return p;
+}
+
+static void
+geojson_skip_blanks (struct geojson_reader *rd)
+{
+/* skipping any whitespace */
+    while (geojson_is_blank (*rd->p))
+	rd->p++;
+}
+
+static int
+geojson_expect (struct geojson_reader *rd, char c)
+{
+/* consuming the expected punctuation char */
+    geojson_skip_blanks (rd);
+    if (*rd->p != c)
+	return 0;
+    rd->p++;
+    return 1;
+}
+
+static int
+geojson_expect_string (struct geojson_reader *rd, const char *str)
+{
+/* consuming the expected quoted string */
+    int len = strlen (str);
+    geojson_skip_blanks (rd);
+    if (*rd->p != '"' || strncmp (rd->p + 1, str, len) != 0
+	|| *(rd->p + len + 1) != '"')
+	return 0;
+    rd->p += len + 2;
+    return 1;
+}
+
+static int
+geojson_member_key (struct geojson_reader *rd)
+{
+/* parsing the key of a Geometry member; returns 0 if unsupported */
+    int ik;
+    for (ik = 0; ik < 5; ik++)
+      {
+	  if (geojson_expect_string (rd, geojson_member_names[ik]))
+	    {
+		if (!geojson_expect (rd, ':'))
+		    return 0;
+		return ik + 1;
+	    }
+      }
+    return 0;
+}
+
+static int
+geojson_class (struct geojson_reader *rd)
+{
+/* parsing a Geometry class name; returns 0 on failure */
+    int ic;
+    for (ic = 0; ic < 7; ic++)
+      {
+	  if (geojson_expect_string (rd, geojson_class_names[ic]))
+	      return ic + 1;
+      }
+    return 0;
+}
+
+static const char *
+geojson_skip_value (const char *p)
+{
+/* 
+/ skipping a whole JSON object or array, quoted strings included
+/ returns NULL if the brackets are unbalanced
+*/
+    int depth = 0;
+    if (*p != '[' && *p != '{')
+	return NULL;
+    while (*p != '\0')
+      {
+	  if (*p == '"')
+	    {
+		p++;
+		while (*p != '"')
+		  {
+		      if (*p == '\0')
+			  return NULL;
+		      if (*p == '\\' && *(p + 1) != '\0')
+			  p++;
+		      p++;
+		  }
+	    }
+	  else if (*p == '[' || *p == '{')
+	      depth++;
+	  else if (*p == ']' || *p == '}')
+	    {
+		depth--;
+		if (depth == 0)
+		    return p + 1;
+	    }
+	  p++;
+      }
+    return NULL;
+}
+
+static int
+geojson_number (struct geojson_reader *rd, double *value)
+{
+/* 
+/ parsing a number; the Flex lexer would split a token such as "1-2", 
+/ so a whitespace, a comma or a bracket is strictly required to follow
+*/
+    const char *p;
+    geojson_skip_blanks (rd);
+    p = wkt_scan_number (rd->p, value);
+    if (p == NULL)
+	return 0;
+    if (!geojson_is_blank (*p) && *p != ',' && *p != ']')
+	return 0;
+    rd->p = p;
+    return 1;
+}
+
+static int
+geojson_probe_dims (const char *p)
+{
+/* 
+/ counting the coordinates of the first position
+/ returns -1 if no well formed XY or XYZ position is found
+*/
+    int count = 1;
+    while (geojson_is_blank (*p) || *p == '[')
+	p++;
+    while (*p != ']')
+      {
+	  if (*p == '\0' || *p == '[' || *p == '{' || *p == '"')
+	      return -1;
+	  if (*p == ',')
+	      count++;
+	  p++;
+      }
+    if (count == 2 || count == 3)
+	return count;
+    return -1;
+}
+
+static int
+geojson_count_items (const char *p)
+{
+/* counting the bracketed items of an array up to its closing bracket */
+    int count = 0;
+    int depth = 0;
+    while (*p != '\0')
+      {
+	  if (*p == '[')
+	    {
+		if (depth == 0)
+		    count++;
+		depth++;
+	    }
+	  else if (*p == ']')
+	    {
+		if (depth == 0)
+		    return count;
+		depth--;
+	    }
+	  else if (*p == '{' || *p == '}' || *p == '"')
+	      return 0;
+	  p++;
+      }
+    return 0;
+}
+
+static int
+geojson_position (struct geojson_reader *rd, double *coords)
+{
+/* parsing a position, as in "[x, y]" or "[x, y, z]" */
+    int ic;
+    if (!geojson_expect (rd, '['))
+	return 0;
+    for (ic = 0; ic < rd->dims; ic++)
+      {
+	  if (ic > 0 && !geojson_expect (rd, ','))
+	      return 0;
+	  if (!geojson_number (rd, coords + ic))
+	      return 0;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_coords (struct geojson_reader *rd, double *coords, int points)
+{
+/* parsing a list of positions straight into their Coords array */
+    int iv;
+    for (iv = 0; iv < points; iv++)
+      {
+	  if (iv > 0 && !geojson_expect (rd, ','))
+	      return 0;
+	  if (!geojson_position (rd, coords))
+	      return 0;
+	  coords += rd->dims;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_point (struct geojson_reader *rd)
+{
+/* parsing a position and adding it as a POINT */
+    double c[3];
+    if (!geojson_position (rd, c))
+	return 0;
+    if (rd->dims == 3)
+	gaiaAddPointToGeomCollXYZ (rd->geom, c[0], c[1], c[2]);
+    else
+	gaiaAddPointToGeomColl (rd->geom, c[0], c[1]);
+    return 1;
+}
+
+static int
+geojson_linestring (struct geojson_reader *rd)
+{
+/* parsing the positions of a LINESTRING */
+    gaiaLinestringPtr ln;
+    int points;
+    if (!geojson_expect (rd, '['))
+	return 0;
+    points = geojson_count_items (rd->p);
+    if (points < 2)
+	return 0;
+    ln = gaiaAddLinestringToGeomColl (rd->geom, points);
+    return geojson_coords (rd, ln->Coords, points);
+}
+
+static int
+geojson_polygon (struct geojson_reader *rd)
+{
+/* parsing the Rings of a POLYGON */
+    gaiaPolygonPtr pg;
+    gaiaRingPtr rng;
+    int rings;
+    int points;
+    int ib;
+    if (!geojson_expect (rd, '['))
+	return 0;
+    rings = geojson_count_items (rd->p);
+    if (rings < 1 || !geojson_expect (rd, '['))
+	return 0;
+    points = geojson_count_items (rd->p);
+    if (points < 4)
+	return 0;
+    pg = gaiaAddPolygonToGeomColl (rd->geom, points, rings - 1);
+    if (!geojson_coords (rd, pg->Exterior->Coords, points))
+	return 0;
+    for (ib = 0; ib < rings - 1; ib++)
+      {
+	  if (!geojson_expect (rd, ',') || !geojson_expect (rd, '['))
+	      return 0;
+	  points = geojson_count_items (rd->p);
+	  if (points < 4)
+	      return 0;
+	  rng = gaiaAddInteriorRing (pg, ib, points);
+	  if (!geojson_coords (rd, rng->Coords, points))
+	      return 0;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_multi (struct geojson_reader *rd,
+	       int (*item) (struct geojson_reader *))
+{
+/* parsing a MULTIPOINT, MULTILINESTRING or MULTIPOLYGON */
+    if (!geojson_expect (rd, '['))
+	return 0;
+    while (1)
+      {
+	  if (!item (rd))
+	      return 0;
+	  if (!geojson_expect (rd, ','))
+	      break;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_geometry (struct geojson_reader *rd, int cls)
+{
+/* parsing the "coordinates" of some Geometry class */
+    switch (cls)
+      {
+      case GAIA_POINT:
+	  return geojson_point (rd);
+      case GAIA_LINESTRING:
+	  return geojson_linestring (rd);
+      case GAIA_POLYGON:
+	  return geojson_polygon (rd);
+      case GAIA_MULTIPOINT:
+	  return geojson_multi (rd, geojson_point);
+      case GAIA_MULTILINESTRING:
+	  return geojson_multi (rd, geojson_linestring);
+      case GAIA_MULTIPOLYGON:
+	  return geojson_multi (rd, geojson_polygon);
+      }
+    return 0;
+}
+
+static int
+geojson_collection (struct geojson_reader *rd)
+{
+/* 
+/ parsing the "geometries" of a GEOMETRYCOLLECTION
+/ just like the Lemon parser, only supports plain "type" + "coordinates"
+/ POINT, LINESTRING and POLYGON items with XY dimensions
+*/
+    int cls;
+    if (!geojson_expect (rd, '['))
+	return 0;
+    while (1)
+      {
+	  if (!geojson_expect (rd, '{') || !geojson_expect_string (rd, "type")
+	      || !geojson_expect (rd, ':'))
+	      return 0;
+	  cls = geojson_class (rd);
+	  if (cls != GAIA_POINT && cls != GAIA_LINESTRING
+	      && cls != GAIA_POLYGON)
+	      return 0;
+	  if (!geojson_expect (rd, ',')
+	      || !geojson_expect_string (rd, "coordinates")
+	      || !geojson_expect (rd, ':'))
+	      return 0;
+	  geojson_skip_blanks (rd);
+	  if (geojson_probe_dims (rd->p) != 2)
+	      return 0;
+	  if (!geojson_geometry (rd, cls) || !geojson_expect (rd, '}'))
+	      return 0;
+	  if (!geojson_expect (rd, ','))
+	      break;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_bbox (struct geojson_reader *rd)
+{
+/* parsing a "bbox" member; its four values are simply ignored */
+    double value;
+    int i;
+    if (!geojson_expect (rd, '['))
+	return 0;
+    for (i = 0; i < 4; i++)
+      {
+	  if (i > 0 && !geojson_expect (rd, ','))
+	      return 0;
+	  if (!geojson_number (rd, &value))
+	      return 0;
+      }
+    return geojson_expect (rd, ']');
+}
+
+static int
+geojson_crs (struct geojson_reader *rd, int *srid)
+{
+/* 
+/ parsing a "crs" member; only the short named form is supported, as in
+/ {"type": "name", "properties": {"name": "EPSG:4326"}}
+*/
+    const char *p;
+    int digits = 0;
+    int value = 0;
+    if (!geojson_expect (rd, '{') || !geojson_expect_string (rd, "type")
+	|| !geojson_expect (rd, ':') || !geojson_expect_string (rd, "name")
+	|| !geojson_expect (rd, ',')
+	|| !geojson_expect_string (rd, "properties")
+	|| !geojson_expect (rd, ':') || !geojson_expect (rd, '{')
+	|| !geojson_expect_string (rd, "name") || !geojson_expect (rd, ':'))
+	return 0;
+    geojson_skip_blanks (rd);
+    if (strncmp (rd->p, "\"EPSG:", 6) != 0)
+	return 0;
+    p = rd->p + 6;
+    while (*p >= '0' && *p <= '9')
+      {
+	  if (++digits > GEOJSONREAD_MAX_SRID_DIGITS)
+	      return 0;
+	  value = (value * 10) + (*p - '0');
+	  p++;
+      }
+    if (digits == 0 || *p != '"')
+	return 0;
+    rd->p = p + 1;
+    *srid = value;
+    if (!geojson_expect (rd, '}'))
+	return 0;
+    return geojson_expect (rd, '}');
+}
+
+static gaiaGeomCollPtr
+geojson_body (struct geojson_reader *rd, int cls, int key)
+{
+/* parsing the "coordinates" or "geometries" member of some Geometry */
+    gaiaGeomCollPtr geom;
+    int ok;
+    geojson_skip_blanks (rd);
+    if (cls == GAIA_GEOMETRYCOLLECTION)
+      {
+	  if (key != GEOJSONREAD_GEOMS)
+	      return NULL;
+	  rd->dims = 2;
+      }
+    else
+      {
+	  if (key != GEOJSONREAD_COORDS)
+	      return NULL;
+	  rd->dims = geojson_probe_dims (rd->p);
+	  if (rd->dims < 0)
+	      return NULL;
+      }
+    if (rd->dims == 3)
+	geom = gaiaAllocGeomCollXYZ ();
+    else
+	geom = gaiaAllocGeomColl ();
+    rd->geom = geom;
+    if (cls == GAIA_GEOMETRYCOLLECTION)
+	ok = geojson_collection (rd);
+    else
+	ok = geojson_geometry (rd, cls);
+    if (!ok)
+      {
+	  gaiaFreeGeomColl (geom);
+	  return NULL;
+      }
+    return geom;
+}
+
+SPATIALITE_PRIVATE void *
+geojson_fast_parse (const unsigned char *text)
+{
+/* 
+/ attempting to parse a GeoJSON Geometry in a single pass
+/ returns NULL on failure; the caller is expected to fall back 
+/ to the Lemon parser in this case
+*/
+    struct geojson_reader rd;
+    struct lconv *lc;
+    const char *deferred = NULL;
+    int cls = 0;
+    int body_key = 0;
+    int key;
+    int has_bbox = 0;
+    int has_crs = 0;
+    int srid = 0;
+    gaiaGeomCollPtr geom = NULL;
+
+    if (text == NULL)
+	return NULL;
+    lc = localeconv ();
+    if (strcmp (lc->decimal_point, ".") != 0)
+      {
+	  /* atof() in the Flex lexer depends on the current locale */
+	  return NULL;
+      }
+    rd.p = (const char *) text;
+    if (!geojson_expect (&rd, '{'))
+	return NULL;
+    while (1)
+      {
+	  /* parsing the Geometry members, whatever is their order */
+	  key = geojson_member_key (&rd);
+	  switch (key)
+	    {
+	    case GEOJSONREAD_TYPE:
+		if (cls)
+		    goto error;
+		cls = geojson_class (&rd);
+		if (!cls)
+		    goto error;
+		break;
+	    case GEOJSONREAD_COORDS:
+	    case GEOJSONREAD_GEOMS:
+		if (body_key)
+		    goto error;
+		body_key = key;
+		if (cls)
+		  {
+		      geom = geojson_body (&rd, cls, body_key);
+		      if (geom == NULL)
+			  goto error;
+		  }
+		else
+		  {
+		      /* the class is still unknown: parsing it later */
+		      geojson_skip_blanks (&rd);
+		      deferred = rd.p;
+		      rd.p = geojson_skip_value (rd.p);
+		      if (rd.p == NULL)
+			  goto error;
+		  }
+		break;
+	    case GEOJSONREAD_BBOX:
+		if (has_bbox || !geojson_bbox (&rd))
+		    goto error;
+		has_bbox = 1;
+		break;
+	    case GEOJSONREAD_CRS:
+		if (has_crs || !geojson_crs (&rd, &srid))
+		    goto error;
+		has_crs = 1;
+		break;
+	    default:
+		goto error;
+	    }
+	  if (!geojson_expect (&rd, ','))
+	      break;
+      }
+    if (!geojson_expect (&rd, '}'))
+	goto error;
+    geojson_skip_blanks (&rd);
+    if (*rd.p != '\0' || !cls || !body_key)
+	goto error;
+    if (geom == NULL)
+      {
+	  rd.p = deferred;
+	  geom = geojson_body (&rd, cls, body_key);
+	  if (geom == NULL)
+	      return NULL;
+      }
+
+/* same as the Lemon parser: a qualified POINT type, and no SRID at all */
+/* for unreferenced POINTs and LINESTRINGs */
+    if (cls == GAIA_POINT && rd.dims == 3)
+	geom->DeclaredType = GAIA_POINTZ;
+    else
+	geom->DeclaredType = cls;
+    if (has_crs)
+	geom->Srid = srid;
+    else if (cls == GAIA_POINT || cls == GAIA_LINESTRING)
+	geom->Srid = -1;
+    return geom;
+
+  error:
+    if (geom != NULL)
+	gaiaFreeGeomColl (geom);
+    return NULL;
+}
+
+static char *
+geojson_read_string (const char **text)
+{
+/* 
+/ decoding a JSON quoted string, escape sequences included
+/ returns a newly allocated buffer, or NULL on failure
+*/
+    const char *p = *text + 1;
+    const char *start = p;
+    char *out;
+    char *o;
+    int cp;
+    int lo;
+    int i;
+    while (*p != '"')
+      {
+	  /* searching the closing quote */
+	  if (*p == '\0')
+	      return NULL;
+	  if (*p == '\\' && *(p + 1) != '\0')
+	      p++;
+	  p++;
+      }
+/* the decoded string is never longer than its escaped form */
+    out = malloc ((p - start) + 1);
+    o = out;
+    p = start;
+    while (*p != '"')
+      {
+	  if (*p != '\\')
+	    {
+		*o++ = *p++;
+		continue;
+	    }
+	  p++;
+	  switch (*p)
+	    {
+	    case '"':
+	    case '\\':
+	    case '/':
+		*o++ = *p;
+		break;
+	    case 'b':
+		*o++ = '\b';
+		break;
+	    case 'f':
+		*o++ = '\f';
+		break;
+	    case 'n':
+		*o++ = '\n';
+		break;
+	    case 'r':
+		*o++ = '\r';
+		break;
+	    case 't':
+		*o++ = '\t';
+		break;
+	    case 'u':
+		cp = 0;
+		for (i = 1; i <= 4; i++)
+		  {
+		      char c = *(p + i);
+		      cp <<= 4;
+		      if (c >= '0' && c <= '9')
+			  cp += c - '0';
+		      else if (c >= 'a' && c <= 'f')
+			  cp += c - 'a' + 10;
+		      else if (c >= 'A' && c <= 'F')
+			  cp += c - 'A' + 10;
+		      else
+			  goto error;
+		  }
+		p += 4;
+		if (cp >= 0xD800 && cp <= 0xDBFF && *(p + 1) == '\\'
+		    && *(p + 2) == 'u')
+		  {
+		      /* a surrogate pair */
+		      lo = 0;
+		      for (i = 3; i <= 6; i++)
+			{
+			    char c = *(p + i);
+			    lo <<= 4;
+			    if (c >= '0' && c <= '9')
+				lo += c - '0';
+			    else if (c >= 'a' && c <= 'f')
+				lo += c - 'a' + 10;
+			    else if (c >= 'A' && c <= 'F')
+				lo += c - 'A' + 10;
+			    else
+			      {
+				  lo = -1;
+				  break;
+			      }
+			}
+		      if (lo >= 0xDC00 && lo <= 0xDFFF)
+			{
+			    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+			    p += 6;
+			}
+		  }
+		if (cp == 0)
+		    goto error;
+		if (cp >= 0xD800 && cp <= 0xDFFF)
+		    cp = 0xFFFD;	/* unpaired surrogate */
+		if (cp < 0x80)
+		    *o++ = cp;
+		else if (cp < 0x800)
+		  {
+		      *o++ = 0xC0 | (cp >> 6);
+		      *o++ = 0x80 | (cp & 0x3F);
+		  }
+		else if (cp < 0x10000)
+		  {
+		      *o++ = 0xE0 | (cp >> 12);
+		      *o++ = 0x80 | ((cp >> 6) & 0x3F);
+		      *o++ = 0x80 | (cp & 0x3F);
+		  }
+		else
+		  {
+		      *o++ = 0xF0 | (cp >> 18);
+		      *o++ = 0x80 | ((cp >> 12) & 0x3F);
+		      *o++ = 0x80 | ((cp >> 6) & 0x3F);
+		      *o++ = 0x80 | (cp & 0x3F);
+		  }
+		break;
+	    default:
+		/* not a valid JSON escape: copied as is */
+		*o++ = '\\';
+		*o++ = *p;
+		break;
+	    }
+	  p++;
+      }
+    *o = '\0';
+    *text = p + 1;
+    return out;
+
+  error:
+    free (out);
+    return NULL;
+}
+
+static int
+geojson_is_integer (const char *start, const char *end)
+{
+/* testing if a number token can be safely stored as an Int64 */
+    int digits = 0;
+    const char *p;
+    for (p = start; p < end; p++)
+      {
+	  if (*p == '.' || *p == 'e' || *p == 'E')
+	      return 0;
+	  if (*p >= '0' && *p <= '9')
+	      digits++;
+      }
+    if (digits > GEOJSONREAD_MAX_INT_DIGITS)
+	return 0;
+    return 1;
+}
+
+SPATIALITE_PRIVATE int
+geojson_read_member (const char **text, void *property)
+{
+/* 
+/ reading the next member of a JSON object (e.g. a Feature's "properties") 
+/ into a GeoJSON Property; nested objects and arrays are returned as Text 
+/ containing their JSON representation
+/ returns 1 on success, -1 once the object has been completely read
+/ and 0 on failure
+*/
+    geojson_property_ptr prop = (geojson_property_ptr) property;
+    const char *p = geojson_skip_json_blanks (*text);
+    const char *end;
+    double value;
+    int len;
+
+    if (*p == ',')
+	p = geojson_skip_json_blanks (p + 1);
+    if (*p == '\0' || *p == '}')
+      {
+	  *text = p;
+	  return -1;
+      }
+    if (*p != '"')
+	return 0;
+    prop->name = geojson_read_string (&p);
+    if (prop->name == NULL)
+	return 0;
+    p = geojson_skip_json_blanks (p);
+    if (*p != ':')
+	return 0;
+    p = geojson_skip_json_blanks (p + 1);
+    switch (*p)
+      {
+      case '"':
+	  prop->txt_value = geojson_read_string (&p);
+	  if (prop->txt_value == NULL)
+	      return 0;
+	  prop->type = GEOJSON_TEXT;
+	  break;
+      case '{':
+      case '[':
+	  end = geojson_skip_value (p);
+	  if (end == NULL)
+	      return 0;
+	  len = end - p;
+	  prop->txt_value = malloc (len + 1);
+	  memcpy (prop->txt_value, p, len);
+	  *(prop->txt_value + len) = '\0';
+	  prop->type = GEOJSON_TEXT;
+	  p = end;
+	  break;
+      case 't':
+	  if (strncmp (p, "true", 4) != 0)
+	      return 0;
+	  prop->type = GEOJSON_TRUE;
+	  p += 4;
+	  break;
+      case 'f':
+	  if (strncmp (p, "false", 5) != 0)
+	      return 0;
+	  prop->type = GEOJSON_FALSE;
+	  p += 5;
+	  break;
+      case 'n':
+	  if (strncmp (p, "null", 4) != 0)
+	      return 0;
+	  prop->type = GEOJSON_NULL;
+	  p += 4;
+	  break;
+      default:
+	  if (*p != '-' && (*p < '0' || *p > '9'))
+	      return 0;
+	  end = wkt_scan_number (p, &value);
+	  if (end == NULL)
+	      return 0;
+	  if (geojson_is_integer (p, end))
+	    {
+		prop->int_value = atoll (p);
+		prop->type = GEOJSON_INTEGER;
+	    }
+	  else
+	    {
+		prop->dbl_value = value;
+		prop->type = GEOJSON_DOUBLE;
+	    }
+	  p = end;
+	  break;
+      }
+    p = geojson_skip_json_blanks (p);
+    if (*p != ',' && *p != '}' && *p != '\0')
+	return 0;
+    *text = p;
+    return 1;
+}
@@ -60,6 +60,191 @@ the terms of any one of the MPL, the GPL or the LGPL.
 
 #include <spatialite/gaiageo.h>
 
+#define GAIA_ARENA_BLOCK	65536	/* default Arena block size */
+#define GAIA_ARENA_ALIGN(n)	(((n) + 7) & ~((size_t) 7))
+
+struct gaiaArenaBlockStruct
+{
+/* a memory block belonging to some Geometry Arena */
+    size_t size;		/* usable bytes */
+    size_t used;		/* already allocated bytes */
+    struct gaiaArenaBlockStruct *next;
+};
+
+struct gaiaGeomArenaStruct
+{
+/* a Geometry memory Arena */
+    struct gaiaArenaBlockStruct *first;	/* blocks linked list - first */
+    struct gaiaArenaBlockStruct *last;	/* blocks linked list - last */
+    void **foreign;		/* adopted heap allocations */
+    int n_foreign;
+    int max_foreign;
+};
+
+#define GAIA_ARENA_HEADER \
+	GAIA_ARENA_ALIGN (sizeof (struct gaiaArenaBlockStruct))
+
+static void *
+arenaMalloc (struct gaiaGeomArenaStruct *arena, size_t size)
+{
+/* bump-allocating some memory from the Arena */
+    struct gaiaArenaBlockStruct *blk = arena->last;
+    unsigned char *ptr;
+    size = GAIA_ARENA_ALIGN (size);
+    if (size == 0)
+	size = 8;
+    if (blk == NULL || blk->used + size > blk->size)
+      {
+	  /* a further block is required */
+	  size_t blk_size = GAIA_ARENA_BLOCK;
+	  if (size > blk_size)
+	      blk_size = size;	/* oversized request: dedicated block */
+	  blk = malloc (GAIA_ARENA_HEADER + blk_size);
+	  if (blk == NULL)
+	      return NULL;
+	  blk->size = blk_size;
+	  blk->used = 0;
+	  blk->next = NULL;
+	  if (arena->first == NULL)
+	      arena->first = blk;
+	  if (arena->last != NULL)
+	      arena->last->next = blk;
+	  arena->last = blk;
+      }
+    ptr = (unsigned char *) blk + GAIA_ARENA_HEADER + blk->used;
+    blk->used += size;
+    return ptr;
+}
+
+static void
+arenaAdopt (struct gaiaGeomArenaStruct *arena, void *ptr)
+{
+/* the Arena takes ownership of some ordinary heap allocation */
+    if (ptr == NULL)
+	return;
+    if (arena->n_foreign >= arena->max_foreign)
+      {
+	  int max = arena->max_foreign + 64;
+	  void **save = realloc (arena->foreign, sizeof (void *) * max);
+	  if (save == NULL)
+	      return;
+	  arena->foreign = save;
+	  arena->max_foreign = max;
+      }
+    arena->foreign[arena->n_foreign++] = ptr;
+}
+
+static int
+arenaCoordsPerVertex (int dimension_model)
+{
+/* number of doubles required by each vertex */
+    if (dimension_model == GAIA_XY_Z || dimension_model == GAIA_XY_M)
+	return 3;
+    if (dimension_model == GAIA_XY_Z_M)
+	return 4;
+    return 2;
+}
+
+static gaiaPointPtr
+arenaAllocPoint (struct gaiaGeomArenaStruct *arena, int dimension_model,
+		 double x, double y, double z, double m)
+{
+/* POINT object constructor [Arena] */
+    gaiaPointPtr p = arenaMalloc (arena, sizeof (gaiaPoint));
+    if (p == NULL)
+	return NULL;
+    p->X = x;
+    p->Y = y;
+    p->Z = z;
+    p->M = m;
+    p->DimensionModel = dimension_model;
+    p->Next = NULL;
+    p->Prev = NULL;
+    return p;
+}
+
+static gaiaLinestringPtr
+arenaAllocLinestring (struct gaiaGeomArenaStruct *arena, int vert,
+		      int dimension_model)
+{
+/* LINESTRING object constructor [Arena] */
+    gaiaLinestringPtr p = arenaMalloc (arena, sizeof (gaiaLinestring));
+    if (p == NULL)
+	return NULL;
+    p->Coords =
+	arenaMalloc (arena,
+		     sizeof (double) * (vert *
+					arenaCoordsPerVertex (dimension_model)));
+    if (p->Coords == NULL)
+	return NULL;		/* the Arena will release the LINESTRING */
+    p->Points = vert;
+    p->MinX = DBL_MAX;
+    p->MinY = DBL_MAX;
+    p->MaxX = -DBL_MAX;
+    p->MaxY = -DBL_MAX;
+    p->DimensionModel = dimension_model;
+    p->Next = NULL;
+    return p;
+}
+
+static gaiaPolygonPtr
+arenaAllocPolygon (struct gaiaGeomArenaStruct *arena, int vert, int excl,
+		   int dimension_model)
+{
+/* POLYGON object constructor [Arena] */
+    gaiaPolygonPtr p;
+    gaiaRingPtr pP;
+    int ind;
+    p = arenaMalloc (arena, sizeof (gaiaPolygon));
+    if (p == NULL)
+	return NULL;
+    p->Exterior = arenaMalloc (arena, sizeof (gaiaRing));
+    if (p->Exterior == NULL)
+	return NULL;
+    pP = p->Exterior;
+    pP->Coords =
+	arenaMalloc (arena,
+		     sizeof (double) * (vert *
+					arenaCoordsPerVertex (dimension_model)));
+    if (pP->Coords == NULL)
+	return NULL;
+    pP->Points = vert;
+    pP->Link = NULL;
+    pP->Clockwise = 0;
+    pP->MinX = DBL_MAX;
+    pP->MinY = DBL_MAX;
+    pP->MaxX = -DBL_MAX;
+    pP->MaxY = -DBL_MAX;
+    pP->DimensionModel = dimension_model;
+    pP->Next = NULL;
+    p->NumInteriors = excl;
+    p->NextInterior = 0;
+    p->Next = NULL;
+    p->Arena = arena;
+    if (excl == 0)
+	p->Interiors = NULL;
+    else
+      {
+	  p->Interiors = arenaMalloc (arena, sizeof (gaiaRing) * excl);
+	  if (p->Interiors == NULL)
+	      return NULL;
+      }
+    for (ind = 0; ind < p->NumInteriors; ind++)
+      {
+	  pP = p->Interiors + ind;
+	  pP->Points = 0;
+	  pP->Coords = NULL;
+	  pP->Next = NULL;
+	  pP->Link = 0;
+      }
+    p->MinX = DBL_MAX;
+    p->MinY = DBL_MAX;
+    p->MaxX = -DBL_MAX;
+    p->MaxY = -DBL_MAX;
+    p->DimensionModel = dimension_model;
+    return p;
+}
+
 GAIAGEO_DECLARE gaiaPointPtr
 gaiaAllocPoint (double x, double y)
 {
@@ -966,6 +1151,7 @@ gaiaAllocPolygon (int vert, int excl)
     p->NumInteriors = excl;
     p->NextInterior = 0;
     p->Next = NULL;
+    p->Arena = NULL;
     if (excl == 0)
 	p->Interiors = NULL;
     else
@@ -998,6 +1184,7 @@ gaiaAllocPolygonXYZ (int vert, int excl)
     p->NumInteriors = excl;
     p->NextInterior = 0;
     p->Next = NULL;
+    p->Arena = NULL;
     if (excl == 0)
 	p->Interiors = NULL;
     else
@@ -1030,6 +1217,7 @@ gaiaAllocPolygonXYM (int vert, int excl)
     p->NumInteriors = excl;
     p->NextInterior = 0;
     p->Next = NULL;
+    p->Arena = NULL;
     if (excl == 0)
 	p->Interiors = NULL;
     else
@@ -1062,6 +1250,7 @@ gaiaAllocPolygonXYZM (int vert, int excl)
     p->NumInteriors = excl;
     p->NextInterior = 0;
     p->Next = NULL;
+    p->Arena = NULL;
     if (excl == 0)
 	p->Interiors = NULL;
     else
@@ -1100,6 +1289,7 @@ gaiaCreatePolygon (gaiaRingPtr ring)
     p->NumInteriors = 0;
     p->NextInterior = 0;
     p->Next = NULL;
+    p->Arena = NULL;
     p->Interiors = NULL;
     gaiaCopyRingCoords (p->Exterior, ring);
     p->MinX = DBL_MAX;
@@ -1115,6 +1305,8 @@ gaiaFreePolygon (gaiaPolygonPtr p)
 /* POLYGON object destructor */
     gaiaRingPtr pP;
     int ind;
+    if (p->Arena != NULL)
+	return;			/* owned by some Arena */
     if (p->Exterior)
 	gaiaFreeRing (p->Exterior);
     for (ind = 0; ind < p->NumInteriors; ind++)
@@ -1740,6 +1932,7 @@ gaiaAllocGeomColl ()
     p->DimensionModel = GAIA_XY;
     p->DeclaredType = GAIA_UNKNOWN;
     p->Next = NULL;
+    p->Arena = NULL;
     return p;
 }
 
@@ -1764,6 +1957,7 @@ gaiaAllocGeomCollXYZ ()
     p->DimensionModel = GAIA_XY_Z;
     p->DeclaredType = GAIA_UNKNOWN;
     p->Next = NULL;
+    p->Arena = NULL;
     return p;
 }
 
@@ -1788,6 +1982,7 @@ gaiaAllocGeomCollXYM ()
     p->DimensionModel = GAIA_XY_M;
     p->DeclaredType = GAIA_UNKNOWN;
     p->Next = NULL;
+    p->Arena = NULL;
     return p;
 }
 
@@ -1812,6 +2007,108 @@ gaiaAllocGeomCollXYZM ()
     p->DimensionModel = GAIA_XY_Z_M;
     p->DeclaredType = GAIA_UNKNOWN;
     p->Next = NULL;
+    p->Arena = NULL;
+    return p;
+}
+
+GAIAGEO_DECLARE gaiaGeomArenaPtr
+gaiaCreateGeomArena (void)
+{
+/* Geometry Arena constructor */
+    struct gaiaGeomArenaStruct *arena =
+	malloc (sizeof (struct gaiaGeomArenaStruct));
+    if (arena == NULL)
+	return NULL;
+    arena->first = NULL;
+    arena->last = NULL;
+    arena->foreign = NULL;
+    arena->n_foreign = 0;
+    arena->max_foreign = 0;
+    return arena;
+}
+
+GAIAGEO_DECLARE void
+gaiaResetGeomArena (gaiaGeomArenaPtr arena)
+{
+/* releasing all Geometries allocated from the Arena */
+    struct gaiaArenaBlockStruct *blk;
+    struct gaiaArenaBlockStruct *blk_n;
+    int i;
+    if (arena == NULL)
+	return;
+    for (i = 0; i < arena->n_foreign; i++)
+	free (arena->foreign[i]);
+    arena->n_foreign = 0;
+    blk = arena->first;
+    arena->first = NULL;
+    arena->last = NULL;
+    while (blk != NULL)
+      {
+	  blk_n = blk->next;
+	  if (arena->first == NULL && blk->size == GAIA_ARENA_BLOCK)
+	    {
+		/* recycling the first ordinary block */
+		blk->used = 0;
+		blk->next = NULL;
+		arena->first = blk;
+		arena->last = blk;
+	    }
+	  else
+	      free (blk);
+	  blk = blk_n;
+      }
+}
+
+GAIAGEO_DECLARE void
+gaiaFreeGeomArena (gaiaGeomArenaPtr arena)
+{
+/* Geometry Arena destructor */
+    if (arena == NULL)
+	return;
+    gaiaResetGeomArena (arena);
+    if (arena->first != NULL)
+	free (arena->first);
+    if (arena->foreign != NULL)
+	free (arena->foreign);
+    free (arena);
+}
+
+GAIAGEO_DECLARE gaiaGeomCollPtr
+gaiaAllocGeomCollArena (gaiaGeomArenaPtr arena, int dimension_model)
+{
+/* GEOMETRYCOLLECTION object constructor [Arena] */
+    gaiaGeomCollPtr p;
+    if (arena == NULL)
+      {
+	  /* ordinary heap allocation */
+	  if (dimension_model == GAIA_XY_Z)
+	      return gaiaAllocGeomCollXYZ ();
+	  if (dimension_model == GAIA_XY_M)
+	      return gaiaAllocGeomCollXYM ();
+	  if (dimension_model == GAIA_XY_Z_M)
+	      return gaiaAllocGeomCollXYZM ();
+	  return gaiaAllocGeomColl ();
+      }
+    p = arenaMalloc (arena, sizeof (gaiaGeomColl));
+    if (p == NULL)
+	return NULL;
+    p->Srid = 0;
+    p->endian = ' ';
+    p->offset = 0;
+    p->FirstPoint = NULL;
+    p->LastPoint = NULL;
+    p->FirstLinestring = NULL;
+    p->LastLinestring = NULL;
+    p->FirstPolygon = NULL;
+    p->LastPolygon = NULL;
+    p->MinX = DBL_MAX;
+    p->MinY = DBL_MAX;
+    p->MaxX = -DBL_MAX;
+    p->MaxY = -DBL_MAX;
+    p->DimensionModel = dimension_model;
+    p->DeclaredType = GAIA_UNKNOWN;
+    p->Next = NULL;
+    p->Arena = arena;
     return p;
 }
 
@@ -1827,6 +2124,8 @@ gaiaFreeGeomColl (gaiaGeomCollPtr p)
     gaiaPolygonPtr pAn;
     if (!p)
 	return;
+    if (p->Arena != NULL)
+	return;			/* owned by some Arena */
     pP = p->FirstPoint;
     while (pP != NULL)
       {
@@ -1855,7 +2154,13 @@ GAIAGEO_DECLARE void
 gaiaAddPointToGeomColl (gaiaGeomCollPtr p, double x, double y)
 {
 /* adding a POINT to this GEOMETRYCOLLECTION */
-    gaiaPointPtr point = gaiaAllocPoint (x, y);
+    gaiaPointPtr point;
+    if (p->Arena != NULL)
+	point = arenaAllocPoint (p->Arena, GAIA_XY, x, y, 0.0, 0.0);
+    else
+	point = gaiaAllocPoint (x, y);
+    if (point == NULL)
+	return;
     if (p->FirstPoint == NULL)
 	p->FirstPoint = point;
     if (p->LastPoint != NULL)
@@ -1867,7 +2172,13 @@ GAIAGEO_DECLARE void
 gaiaAddPointToGeomCollXYZ (gaiaGeomCollPtr p, double x, double y, double z)
 {
 /* adding a POINT to this GEOMETRYCOLLECTION */
-    gaiaPointPtr point = gaiaAllocPointXYZ (x, y, z);
+    gaiaPointPtr point;
+    if (p->Arena != NULL)
+	point = arenaAllocPoint (p->Arena, GAIA_XY_Z, x, y, z, 0.0);
+    else
+	point = gaiaAllocPointXYZ (x, y, z);
+    if (point == NULL)
+	return;
     if (p->FirstPoint == NULL)
 	p->FirstPoint = point;
     if (p->LastPoint != NULL)
@@ -1879,7 +2190,13 @@ GAIAGEO_DECLARE void
 gaiaAddPointToGeomCollXYM (gaiaGeomCollPtr p, double x, double y, double m)
 {
 /* adding a POINT to this GEOMETRYCOLLECTION */
-    gaiaPointPtr point = gaiaAllocPointXYM (x, y, m);
+    gaiaPointPtr point;
+    if (p->Arena != NULL)
+	point = arenaAllocPoint (p->Arena, GAIA_XY_M, x, y, 0.0, m);
+    else
+	point = gaiaAllocPointXYM (x, y, m);
+    if (point == NULL)
+	return;
     if (p->FirstPoint == NULL)
 	p->FirstPoint = point;
     if (p->LastPoint != NULL)
@@ -1892,7 +2209,13 @@ gaiaAddPointToGeomCollXYZM (gaiaGeomCollPtr p, double x, double y, double z,
 			    double m)
 {
 /* adding a POINT to this GEOMETRYCOLLECTION */
-    gaiaPointPtr point = gaiaAllocPointXYZM (x, y, z, m);
+    gaiaPointPtr point;
+    if (p->Arena != NULL)
+	point = arenaAllocPoint (p->Arena, GAIA_XY_Z_M, x, y, z, m);
+    else
+	point = gaiaAllocPointXYZM (x, y, z, m);
+    if (point == NULL)
+	return;
     if (p->FirstPoint == NULL)
 	p->FirstPoint = point;
     if (p->LastPoint != NULL)
@@ -1905,7 +2228,9 @@ gaiaAddLinestringToGeomColl (gaiaGeomCollPtr p, int vert)
 {
 /* adding a LINESTRING to this GEOMETRYCOLLECTION */
     gaiaLinestringPtr line;
-    if (p->DimensionModel == GAIA_XY_Z)
+    if (p->Arena != NULL)
+	line = arenaAllocLinestring (p->Arena, vert, p->DimensionModel);
+    else if (p->DimensionModel == GAIA_XY_Z)
 	line = gaiaAllocLinestringXYZ (vert);
     else if (p->DimensionModel == GAIA_XY_M)
 	line = gaiaAllocLinestringXYM (vert);
@@ -1913,6 +2238,8 @@ gaiaAddLinestringToGeomColl (gaiaGeomCollPtr p, int vert)
 	line = gaiaAllocLinestringXYZM (vert);
     else
 	line = gaiaAllocLinestring (vert);
+    if (line == NULL)
+	return NULL;
     if (p->FirstLinestring == NULL)
 	p->FirstLinestring = line;
     if (p->LastLinestring != NULL)
@@ -1925,6 +2252,12 @@ GAIAGEO_DECLARE void
 gaiaInsertLinestringInGeomColl (gaiaGeomCollPtr p, gaiaLinestringPtr line)
 {
 /* adding an existing LINESTRING to this GEOMETRYCOLLECTION */
+    if (p->Arena != NULL)
+      {
+	  /* the Arena will take care of releasing this LINESTRING */
+	  arenaAdopt (p->Arena, line->Coords);
+	  arenaAdopt (p->Arena, line);
+      }
     if (p->FirstLinestring == NULL)
 	p->FirstLinestring = line;
     if (p->LastLinestring != NULL)
@@ -1937,7 +2270,10 @@ gaiaAddPolygonToGeomColl (gaiaGeomCollPtr p, int vert, int interiors)
 {
 /* adding a POLYGON to this GEOMETRYCOLLECTION */
     gaiaPolygonPtr polyg;
-    if (p->DimensionModel == GAIA_XY_Z)
+    if (p->Arena != NULL)
+	polyg =
+	    arenaAllocPolygon (p->Arena, vert, interiors, p->DimensionModel);
+    else if (p->DimensionModel == GAIA_XY_Z)
 	polyg = gaiaAllocPolygonXYZ (vert, interiors);
     else if (p->DimensionModel == GAIA_XY_M)
 	polyg = gaiaAllocPolygonXYM (vert, interiors);
@@ -1945,6 +2281,8 @@ gaiaAddPolygonToGeomColl (gaiaGeomCollPtr p, int vert, int interiors)
 	polyg = gaiaAllocPolygonXYZM (vert, interiors);
     else
 	polyg = gaiaAllocPolygon (vert, interiors);
+    if (polyg == NULL)
+	return NULL;
     if (p->FirstPolygon == NULL)
 	p->FirstPolygon = polyg;
     if (p->LastPolygon != NULL)
@@ -1958,12 +2296,23 @@ gaiaInsertPolygonInGeomColl (gaiaGeomCollPtr p, gaiaRingPtr ring)
 {
 /* adding a POLYGON to this GEOMETRYCOLLECTION */
     gaiaPolygonPtr polyg;
-    polyg = malloc (sizeof (gaiaPolygon));
+    if (p->Arena != NULL)
+      {
+	  /* the Arena will take care of releasing this RING */
+	  polyg = arenaMalloc (p->Arena, sizeof (gaiaPolygon));
+	  if (polyg == NULL)
+	      return NULL;
+	  arenaAdopt (p->Arena, ring->Coords);
+	  arenaAdopt (p->Arena, ring);
+      }
+    else
+	polyg = malloc (sizeof (gaiaPolygon));
     polyg->Exterior = ring;
     polyg->NumInteriors = 0;
     polyg->NextInterior = 0;
     polyg->DimensionModel = ring->DimensionModel;
     polyg->Next = NULL;
+    polyg->Arena = p->Arena;
     polyg->Interiors = NULL;
     polyg->MinX = DBL_MAX;
     polyg->MinY = DBL_MAX;
@@ -1984,7 +2333,17 @@ gaiaAddInteriorRing (gaiaPolygonPtr p, int pos, int vert)
     gaiaRingPtr pP = p->Interiors + pos;
     pP->Points = vert;
     pP->DimensionModel = p->DimensionModel;
-    if (pP->DimensionModel == GAIA_XY_Z)
+    if (p->Arena != NULL)
+      {
+	  pP->Coords =
+	      arenaMalloc (p->Arena,
+			   sizeof (double) * (vert *
+					      arenaCoordsPerVertex
+					      (pP->DimensionModel)));
+	  if (pP->Coords == NULL)
+	      pP->Points = 0;
+      }
+    else if (pP->DimensionModel == GAIA_XY_Z)
 	pP->Coords = malloc (sizeof (double) * (vert * 3));
     else if (pP->DimensionModel == GAIA_XY_M)
 	pP->Coords = malloc (sizeof (double) * (vert * 3));
@@ -2003,23 +2362,50 @@ gaiaInsertInteriorRing (gaiaPolygonPtr p, gaiaRingPtr ring)
     if (p->NumInteriors == 0)
       {
 	  /* this one is the first interior ring */
+	  if (p->Arena != NULL)
+	    {
+		p->Interiors = arenaMalloc (p->Arena, sizeof (gaiaRing));
+		if (p->Interiors == NULL)
+		    return;
+	    }
+	  else
+	      p->Interiors = malloc (sizeof (gaiaRing));
 	  p->NumInteriors++;
-	  p->Interiors = malloc (sizeof (gaiaRing));
 	  hole = p->Interiors;
       }
     else
       {
 	  /* some interior ring is already defined */
 	  gaiaRingPtr save = p->Interiors;
-	  p->Interiors = malloc (sizeof (gaiaRing) * (p->NumInteriors + 1));
+	  if (p->Arena != NULL)
+	    {
+		p->Interiors =
+		    arenaMalloc (p->Arena,
+				 sizeof (gaiaRing) * (p->NumInteriors + 1));
+		if (p->Interiors == NULL)
+		  {
+		      p->Interiors = save;
+		      return;
+		  }
+	    }
+	  else
+	      p->Interiors =
+		  malloc (sizeof (gaiaRing) * (p->NumInteriors + 1));
 	  memcpy (p->Interiors, save, (sizeof (gaiaRing) * p->NumInteriors));
-	  free (save);
+	  if (p->Arena == NULL)
+	      free (save);
 	  hole = p->Interiors + p->NumInteriors;
 	  p->NumInteriors++;
       }
     hole->Points = ring->Points;
     hole->DimensionModel = p->DimensionModel;
-    if (hole->DimensionModel == GAIA_XY_Z)
+    if (p->Arena != NULL)
+	hole->Coords =
+	    arenaMalloc (p->Arena,
+			 sizeof (double) * (hole->Points *
+					    arenaCoordsPerVertex
+					    (hole->DimensionModel)));
+    else if (hole->DimensionModel == GAIA_XY_Z)
 	hole->Coords = malloc (sizeof (double) * (hole->Points * 3));
     else if (hole->DimensionModel == GAIA_XY_M)
 	hole->Coords = malloc (sizeof (double) * (hole->Points * 3));
@@ -2040,6 +2426,33 @@ gaiaAddRingToPolyg (gaiaPolygonPtr polyg, gaiaRingPtr ring)
 	  /* this one is the first interior ring */
 	  polyg->Interiors = ring;
 	  polyg->NumInteriors = 1;
+	  if (polyg->Arena != NULL)
+	    {
+		/* the Arena will take care of releasing this RING */
+		arenaAdopt (polyg->Arena, ring->Coords);
+		arenaAdopt (polyg->Arena, ring);
+	    }
+      }
+    else if (polyg->Arena != NULL)
+      {
+	  /* adding another interior ring [Arena] */
+	  old_interiors = polyg->Interiors;
+	  polyg->Interiors =
+	      arenaMalloc (polyg->Arena,
+			   sizeof (gaiaRing) * (polyg->NumInteriors + 1));
+	  if (polyg->Interiors == NULL)
+	    {
+		polyg->Interiors = old_interiors;
+		gaiaFreeRing (ring);
+		return;
+	    }
+	  memcpy (polyg->Interiors, old_interiors,
+		  (sizeof (gaiaRing) * polyg->NumInteriors));
+	  memcpy (polyg->Interiors + polyg->NumInteriors, ring,
+		  sizeof (gaiaRing));
+	  (polyg->NumInteriors)++;
+	  arenaAdopt (polyg->Arena, ring->Coords);
+	  free (ring);
       }
     else
       {
@@ -123,6 +123,159 @@ splite_free_geos_cache_item_r (const void *p_cache,
     p->preparedGeosGeom = NULL;
 }
 
+SPATIALITE_PRIVATE void
+splite_init_geos_cache (struct splite_geos_cache *p)
+{
+/* initializing the LRU cache of GEOS Prepared Geometries */
+    p->maxItems = SPLITE_GEOS_CACHE_DEFAULT;
+    p->preparedCount = 0;
+    p->candidateCount = 0;
+    p->buckets = NULL;
+    p->firstPrepared = NULL;
+    p->lastPrepared = NULL;
+    p->firstCandidate = NULL;
+    p->lastCandidate = NULL;
+    p->hits = 0;
+    p->misses = 0;
+    p->evictions = 0;
+}
+
+static void
+geosCacheUnlink (struct splite_geos_cache *gc,
+		 struct splite_geos_cache_item *p)
+{
+/* removing an item from its own LRU list */
+    struct splite_geos_cache_item **first;
+    struct splite_geos_cache_item **last;
+    if (p->preparedGeosGeom != NULL)
+      {
+	  first = &(gc->firstPrepared);
+	  last = &(gc->lastPrepared);
+	  gc->preparedCount -= 1;
+      }
+    else
+      {
+	  first = &(gc->firstCandidate);
+	  last = &(gc->lastCandidate);
+	  gc->candidateCount -= 1;
+      }
+    if (p->prev != NULL)
+	p->prev->next = p->next;
+    else
+	*first = p->next;
+    if (p->next != NULL)
+	p->next->prev = p->prev;
+    else
+	*last = p->prev;
+    p->prev = NULL;
+    p->next = NULL;
+}
+
+#ifndef OMIT_GEOS		/* including GEOS */
+static void
+geosCachePushFront (struct splite_geos_cache *gc,
+		    struct splite_geos_cache_item *p)
+{
+/* inserting an item as the most recently used one of its LRU list */
+    struct splite_geos_cache_item **first;
+    struct splite_geos_cache_item **last;
+    if (p->preparedGeosGeom != NULL)
+      {
+	  first = &(gc->firstPrepared);
+	  last = &(gc->lastPrepared);
+	  gc->preparedCount += 1;
+      }
+    else
+      {
+	  first = &(gc->firstCandidate);
+	  last = &(gc->lastCandidate);
+	  gc->candidateCount += 1;
+      }
+    p->prev = NULL;
+    p->next = *first;
+    if (*first != NULL)
+	(*first)->prev = p;
+    *first = p;
+    if (*last == NULL)
+	*last = p;
+}
+#endif
+
+static void
+geosCacheDiscard (struct splite_internal_cache *cache,
+		  struct splite_geos_cache_item *p)
+{
+/* removing an item from the cache and destroying it */
+    struct splite_geos_cache *gc = &(cache->geosCache);
+    struct splite_geos_cache_item **pp;
+    geosCacheUnlink (gc, p);
+    pp = gc->buckets + (p->crc32 & (SPLITE_GEOS_CACHE_BUCKETS - 1));
+    while (*pp != NULL)
+      {
+	  if (*pp == p)
+	    {
+		*pp = p->hashNext;
+		break;
+	    }
+	  pp = &((*pp)->hashNext);
+      }
+    splite_free_geos_cache_item_r (cache, p);
+    free (p->gaiaBlob);
+    free (p);
+}
+
+static void
+geosCacheTrim (struct splite_internal_cache *cache)
+{
+/* evicting the least recently used items exceeding the cache size */
+    struct splite_geos_cache *gc = &(cache->geosCache);
+    while (gc->preparedCount > gc->maxItems)
+      {
+	  geosCacheDiscard (cache, gc->lastPrepared);
+	  gc->evictions += 1;
+      }
+    while (gc->candidateCount > gc->maxItems)
+	geosCacheDiscard (cache, gc->lastCandidate);
+}
+
+SPATIALITE_PRIVATE void
+splite_free_geos_cache (const void *p_cache)
+{
+/* destroying all items stored into the GEOS cache */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    struct splite_geos_cache *gc;
+    if (cache == NULL)
+	return;
+    gc = &(cache->geosCache);
+    while (gc->lastPrepared != NULL)
+	geosCacheDiscard (cache, gc->lastPrepared);
+    while (gc->lastCandidate != NULL)
+	geosCacheDiscard (cache, gc->lastCandidate);
+    if (gc->buckets != NULL)
+	free (gc->buckets);
+    gc->buckets = NULL;
+}
+
+SPATIALITE_PRIVATE void
+splite_geos_cache_set_size (const void *p_cache, int max_items)
+{
+/* changing the max number of items stored into the GEOS cache
+/ a negative value identifies the default setting
+/ ZERO disables the cache at all
+*/
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    if (cache == NULL)
+	return;
+    if (max_items < 0)
+	max_items = SPLITE_GEOS_CACHE_DEFAULT;
+    if (max_items > SPLITE_GEOS_CACHE_MAX)
+	max_items = SPLITE_GEOS_CACHE_MAX;
+    cache->geosCache.maxItems = max_items;
+    geosCacheTrim (cache);
+}
+
 GAIAGEO_DECLARE void
 gaiaResetGeosMsg ()
 {
@@ -371,14 +524,93 @@ evalGeosCacheItem (unsigned char *blob, int blob_size, uLong crc,
 	  return 0;
       }
 
-/* the first 46 bytes of the BLOB contain the MBR,
-   the SRID and the Type; so are assumed to represent 
-   a valid signature */
-    if (memcmp (blob, p->gaiaBlob, 46) == 0)
+/* same size and CRC32: the whole BLOB must match */
+    if (memcmp (blob, p->gaiaBlob, blob_size) == 0)
 	return 1;
     return 0;
 }
 
+static struct splite_geos_cache_item *
+geosCacheFind (struct splite_geos_cache *gc, unsigned char *blob,
+	       int blob_size, uLong crc)
+{
+/* searching the GEOS cache for an item matching this BLOB */
+    struct splite_geos_cache_item *p;
+    if (gc->buckets == NULL)
+	return NULL;
+    p = *(gc->buckets + (crc & (SPLITE_GEOS_CACHE_BUCKETS - 1)));
+    while (p != NULL)
+      {
+	  if (evalGeosCacheItem (blob, blob_size, crc, p))
+	      return p;
+	  p = p->hashNext;
+      }
+    return NULL;
+}
+
+static void
+geosCacheAddCandidate (struct splite_internal_cache *cache,
+		       unsigned char *blob, int blob_size, uLong crc)
+{
+/* registering a BLOB seen for the first time */
+    struct splite_geos_cache *gc = &(cache->geosCache);
+    struct splite_geos_cache_item *p;
+    struct splite_geos_cache_item **bucket;
+    if (gc->buckets == NULL)
+      {
+	  gc->buckets =
+	      calloc (SPLITE_GEOS_CACHE_BUCKETS,
+		      sizeof (struct splite_geos_cache_item *));
+	  if (gc->buckets == NULL)
+	      return;
+      }
+    p = malloc (sizeof (struct splite_geos_cache_item));
+    if (p == NULL)
+	return;
+    p->gaiaBlob = malloc (blob_size);
+    if (p->gaiaBlob == NULL)
+      {
+	  free (p);
+	  return;
+      }
+    memcpy (p->gaiaBlob, blob, blob_size);
+    p->gaiaBlobSize = blob_size;
+    p->crc32 = crc;
+    p->geosGeom = NULL;
+    p->preparedGeosGeom = NULL;
+    bucket = gc->buckets + (crc & (SPLITE_GEOS_CACHE_BUCKETS - 1));
+    p->hashNext = *bucket;
+    *bucket = p;
+    geosCachePushFront (gc, p);
+    geosCacheTrim (cache);
+}
+
+static int
+geosCachePrepare (struct splite_internal_cache *cache,
+		  struct splite_geos_cache_item *p, gaiaGeomCollPtr geom)
+{
+/* promoting a candidate item to a GEOS Prepared Geometry */
+    struct splite_geos_cache *gc = &(cache->geosCache);
+    GEOSContextHandle_t handle = cache->GEOS_handle;
+    geosCacheUnlink (gc, p);
+    p->geosGeom = gaiaToGeos_r (cache, geom);
+    if (p->geosGeom)
+      {
+	  p->preparedGeosGeom = (void *) GEOSPrepare_r (handle, p->geosGeom);
+	  if (p->preparedGeosGeom == NULL)
+	    {
+		/* unexpected failure */
+		GEOSGeom_destroy_r (handle, p->geosGeom);
+		p->geosGeom = NULL;
+	    }
+      }
+    geosCachePushFront (gc, p);
+    if (p->preparedGeosGeom == NULL)
+	return 0;
+    geosCacheTrim (cache);
+    return 1;
+}
+
 static int
 sniffTinyPointBlob (const unsigned char *blob, const int size)
 {
@@ -531,8 +763,9 @@ evalGeosCache (struct splite_internal_cache *cache, gaiaGeomCollPtr geom1,
 	       gaiaGeomCollPtr * geom)
 {
 /* handling the internal GEOS cache */
-    struct splite_geos_cache_item *p1 = &(cache->cacheItem1);
-    struct splite_geos_cache_item *p2 = &(cache->cacheItem2);
+    struct splite_geos_cache *gc;
+    struct splite_geos_cache_item *p1;
+    struct splite_geos_cache_item *p2;
     uLong crc1;
     uLong crc2;
     unsigned char *tiny1 = NULL;
@@ -552,6 +785,9 @@ evalGeosCache (struct splite_internal_cache *cache, gaiaGeomCollPtr geom1,
     handle = cache->GEOS_handle;
     if (handle == NULL)
 	return 0;
+    gc = &(cache->geosCache);
+    if (gc->maxItems <= 0)
+	return 0;
 
     if (sniffTinyPointBlob (blob1, size1))
       {
@@ -577,30 +813,39 @@ evalGeosCache (struct splite_internal_cache *cache, gaiaGeomCollPtr geom1,
       }
     crc1 = crc32 (0L, p_blob1, sz1);
     crc2 = crc32 (0L, p_blob2, sz2);
+    p1 = geosCacheFind (gc, p_blob1, sz1, crc1);
+    p2 = geosCacheFind (gc, p_blob2, sz2, crc2);
 
-/* checking the first cache item */
-    if (evalGeosCacheItem (p_blob1, sz1, crc1, p1))
+/* checking for an already prepared item */
+    if (p1 != NULL && p1->preparedGeosGeom != NULL)
       {
-	  /* found a matching item */
-	  if (p1->preparedGeosGeom == NULL)
-	    {
-		/* preparing the GeosGeometries */
-		p1->geosGeom = gaiaToGeos_r (cache, geom1);
-		if (p1->geosGeom)
-		  {
-		      p1->preparedGeosGeom =
-			  (void *) GEOSPrepare_r (handle, p1->geosGeom);
-		      if (p1->preparedGeosGeom == NULL)
-			{
-			    /* unexpected failure */
-			    GEOSGeom_destroy_r (handle, p1->geosGeom);
-			    p1->geosGeom = NULL;
-			}
-		  }
-	    }
-	  if (p1->preparedGeosGeom)
+	  /* returning the corresponding GeosPreparedGeometry */
+	  geosCacheUnlink (gc, p1);
+	  geosCachePushFront (gc, p1);
+	  gc->hits += 1;
+	  *gPrep = p1->preparedGeosGeom;
+	  *geom = geom2;
+	  retcode = 1;
+	  goto end;
+      }
+    if (p2 != NULL && p2->preparedGeosGeom != NULL)
+      {
+	  /* returning the corresponding GeosPreparedGeometry */
+	  geosCacheUnlink (gc, p2);
+	  geosCachePushFront (gc, p2);
+	  gc->hits += 1;
+	  *gPrep = p2->preparedGeosGeom;
+	  *geom = geom1;
+	  retcode = 1;
+	  goto end;
+      }
+    gc->misses += 1;
+
+/* checking for a candidate item seen for the second time */
+    if (p1 != NULL)
+      {
+	  if (geosCachePrepare (cache, p1, geom1))
 	    {
-		/* returning the corresponding GeosPreparedGeometry */
 		*gPrep = p1->preparedGeosGeom;
 		*geom = geom2;
 		retcode = 1;
@@ -609,30 +854,10 @@ evalGeosCache (struct splite_internal_cache *cache, gaiaGeomCollPtr geom1,
 	  retcode = 0;
 	  goto end;
       }
-
-/* checking the second cache item */
-    if (evalGeosCacheItem (p_blob2, sz2, crc2, p2))
+    if (p2 != NULL)
       {
-	  /* found a matching item */
-	  if (p2->preparedGeosGeom == NULL)
-	    {
-		/* preparing the GeosGeometries */
-		p2->geosGeom = gaiaToGeos_r (cache, geom2);
-		if (p2->geosGeom)
-		  {
-		      p2->preparedGeosGeom =
-			  (void *) GEOSPrepare_r (handle, p2->geosGeom);
-		      if (p2->preparedGeosGeom == NULL)
-			{
-			    /* unexpected failure */
-			    GEOSGeom_destroy_r (handle, p2->geosGeom);
-			    p2->geosGeom = NULL;
-			}
-		  }
-	    }
-	  if (p2->preparedGeosGeom)
+	  if (geosCachePrepare (cache, p2, geom2))
 	    {
-		/* returning the corresponding GeosPreparedGeometry */
 		*gPrep = p2->preparedGeosGeom;
 		*geom = geom1;
 		retcode = 1;
@@ -642,27 +867,10 @@ evalGeosCache (struct splite_internal_cache *cache, gaiaGeomCollPtr geom1,
 	  goto end;
       }
 
-/* updating the GEOS cache item#1 */
-    memcpy (p1->gaiaBlob, p_blob1, 46);
-    p1->gaiaBlobSize = sz1;
-    p1->crc32 = crc1;
-    if (p1->preparedGeosGeom)
-	GEOSPreparedGeom_destroy_r (handle, p1->preparedGeosGeom);
-    if (p1->geosGeom)
-	GEOSGeom_destroy_r (handle, p1->geosGeom);
-    p1->geosGeom = NULL;
-    p1->preparedGeosGeom = NULL;
-
-/* updating the GEOS cache item#2 */
-    memcpy (p2->gaiaBlob, p_blob2, 46);
-    p2->gaiaBlobSize = sz2;
-    p2->crc32 = crc2;
-    if (p2->preparedGeosGeom)
-	GEOSPreparedGeom_destroy_r (handle, p2->preparedGeosGeom);
-    if (p2->geosGeom)
-	GEOSGeom_destroy_r (handle, p2->geosGeom);
-    p2->geosGeom = NULL;
-    p2->preparedGeosGeom = NULL;
+/* registering both BLOBs as candidate items */
+    geosCacheAddCandidate (cache, p_blob1, sz1, crc1);
+    if (geosCacheFind (gc, p_blob2, sz2, crc2) == NULL)
+	geosCacheAddCandidate (cache, p_blob2, sz2, crc2);
     retcode = 0;
 
   end:
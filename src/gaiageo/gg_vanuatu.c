@@ -61,6 +61,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite/debug.h>
 
 #include <spatialite/gaiageo.h>
+#include <spatialite_private.h>
 
 #if defined(_WIN32) || defined(WIN32)
 #include <io.h>
@@ -1859,14 +1860,34 @@ vanuatu_cleanup (vanuatuFlexToken * token)
 gaiaGeomCollPtr
 gaiaParseWkt (const unsigned char *dirty_buffer, short type)
 {
-    void *pParser = ParseAlloc (malloc);
+    void *pParser;
     /* Linked-list of token values */
-    vanuatuFlexToken *tokens = malloc (sizeof (vanuatuFlexToken));
+    vanuatuFlexToken *tokens;
     /* Pointer to the head of the list */
-    vanuatuFlexToken *head = tokens;
+    vanuatuFlexToken *head;
     int yv;
     yyscan_t scanner;
     struct vanuatu_data str_data;
+    gaiaGeomCollPtr geom;
+
+/* attempting first to use the fast single-pass reader */
+    geom = wkt_fast_parse (dirty_buffer, 0);
+    if (geom != NULL)
+      {
+	  if (type >= 0 && geom->DeclaredType != type)
+	    {
+		/* invalid CLASS TYPE for request */
+		gaiaFreeGeomColl (geom);
+		return NULL;
+	    }
+	  gaiaMbrGeometry (geom);
+	  return geom;
+      }
+
+/* falling back to the Lemon parser */
+    pParser = ParseAlloc (malloc);
+    tokens = malloc (sizeof (vanuatuFlexToken));
+    head = tokens;
 
 /* initializing the helper structs */
     str_data.vanuatu_line = 1;
@@ -48,6 +48,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <stdio.h>
 #include <float.h>
 #include <string.h>
+#include <math.h>
 
 #if defined(_WIN32) && !defined(__MINGW32__)
 #include "config-msvc.h"
@@ -149,6 +150,8 @@ ParseWkbLine (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (16 * points))
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -178,6 +181,8 @@ ParseWkbLineZ (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (24 * points))
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -209,6 +214,8 @@ ParseWkbLineM (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (24 * points))
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -241,6 +248,8 @@ ParseWkbLineZM (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (32 * points))
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -286,10 +295,14 @@ ParseWkbPolygon (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -333,10 +346,14 @@ ParseWkbPolygonZ (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -382,10 +399,14 @@ ParseWkbPolygonM (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -432,10 +453,14 @@ ParseWkbPolygonZM (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		x = gaiaImport64 (geo->blob + geo->offset, geo->endian,
@@ -473,6 +498,8 @@ ParseCompressedWkbLine (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (8 * points) + 16)
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  if (iv == 0 || iv == (points - 1))
@@ -525,6 +552,8 @@ ParseCompressedWkbLineZ (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (12 * points) + 24)
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  if (iv == 0 || iv == (points - 1))
@@ -581,6 +610,8 @@ ParseCompressedWkbLineM (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (16 * points) + 16)
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  if (iv == 0 || iv == (points - 1))
@@ -638,6 +669,8 @@ ParseCompressedWkbLineZM (gaiaGeomCollPtr geo)
     if (geo->size < geo->offset + (20 * points) + 24)
 	return;
     line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
     for (iv = 0; iv < points; iv++)
       {
 	  if (iv == 0 || iv == (points - 1))
@@ -710,10 +743,14 @@ ParseCompressedWkbPolygon (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		if (iv == 0 || iv == (nverts - 1))
@@ -780,10 +817,14 @@ ParseCompressedWkbPolygonZ (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		if (iv == 0 || iv == (nverts - 1))
@@ -854,10 +895,14 @@ ParseCompressedWkbPolygonM (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		if (iv == 0 || iv == (nverts - 1))
@@ -929,10 +974,14 @@ ParseCompressedWkbPolygonZM (gaiaGeomCollPtr geo)
 	  if (ib == 0)
 	    {
 		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
 		ring = polyg->Exterior;
 	    }
 	  else
 	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
 	  for (iv = 0; iv < nverts; iv++)
 	    {
 		if (iv == 0 || iv == (nverts - 1))
@@ -972,6 +1021,232 @@ ParseCompressedWkbPolygonZM (gaiaGeomCollPtr geo)
       }
 }
 
+static const double quantized_scales[] = {
+    1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0,
+    100000000.0, 1000000000.0, 10000000000.0, 100000000000.0,
+    1000000000000.0, 10000000000000.0, 100000000000000.0,
+    1000000000000000.0
+};
+
+struct quantized_coords
+{
+/* the current status of a quantized LINESTRING or POLYGON */
+    int has_z;
+    int has_m;
+    int n_coords;
+    int xy_precision;
+    int z_precision;
+    int m_precision;
+    sqlite3_int64 x;
+    sqlite3_int64 y;
+    sqlite3_int64 z;
+    sqlite3_int64 m;
+};
+
+static double
+quantizedValue (sqlite3_int64 q, int precision)
+{
+/* converting a quantized integer back into a coordinate value */
+    if (precision >= 0)
+	return (double) q / quantized_scales[precision];
+    return (double) q *quantized_scales[-precision];
+}
+
+static int
+quantizedPrecision (gaiaGeomCollPtr geo, int *precision)
+{
+/* reading a quantization precision (signed decimal digits) */
+    int p;
+    if (geo->size < geo->offset + 1)
+	return 0;
+    p = (signed char) *(geo->blob + geo->offset);
+    geo->offset += 1;
+    if (p < GAIA_QUANTIZED_MIN_PRECISION || p > GAIA_QUANTIZED_MAX_PRECISION)
+	return 0;
+    *precision = p;
+    return 1;
+}
+
+static int
+quantizedVarint (gaiaGeomCollPtr geo, sqlite3_uint64 * value)
+{
+/* decoding an unsigned varint (7 bits per byte, low order bits first) */
+    sqlite3_uint64 v = 0;
+    int shift = 0;
+    unsigned char c;
+    while (geo->offset < geo->size && shift < 64)
+      {
+	  c = *(geo->blob + geo->offset);
+	  geo->offset += 1;
+	  v |= (sqlite3_uint64) (c & 0x7f) << shift;
+	  if ((c & 0x80) == 0)
+	    {
+		*value = v;
+		return 1;
+	    }
+	  shift += 7;
+      }
+/* truncated or malformed: any further read will fail as well */
+    geo->offset = geo->size;
+    return 0;
+}
+
+static sqlite3_int64
+quantizedDelta (gaiaGeomCollPtr geo, sqlite3_int64 last)
+{
+/* decoding a zigzag delta; a broken BLOB simply repeats the last value */
+    sqlite3_uint64 u;
+    sqlite3_uint64 delta;
+    if (!quantizedVarint (geo, &u))
+	return last;
+    delta = (u >> 1) ^ (0 - (u & 1));
+    return (sqlite3_int64) ((sqlite3_uint64) last + delta);
+}
+
+static int
+ParseQuantizedHeader (gaiaGeomCollPtr geo, int dims,
+		      struct quantized_coords *qc)
+{
+/* decodes the precisions of a QUANTIZED item */
+    memset (qc, 0, sizeof (struct quantized_coords));
+    qc->has_z = (dims == GAIA_XY_Z || dims == GAIA_XY_Z_M);
+    qc->has_m = (dims == GAIA_XY_M || dims == GAIA_XY_Z_M);
+    qc->n_coords = 2 + qc->has_z + qc->has_m;
+    if (!quantizedPrecision (geo, &(qc->xy_precision)))
+	return 0;
+    if (qc->has_z && !quantizedPrecision (geo, &(qc->z_precision)))
+	return 0;
+    if (qc->has_m && !quantizedPrecision (geo, &(qc->m_precision)))
+	return 0;
+    return 1;
+}
+
+static int
+ParseQuantizedCount (gaiaGeomCollPtr geo, int min_bytes)
+{
+/* 
+/ decodes a count of vertices or rings 
+/ each one of them surely requires at least min_bytes
+/ returns 0 on failure
+*/
+    sqlite3_uint64 n;
+    if (!quantizedVarint (geo, &n))
+	return 0;
+    if (n > (sqlite3_uint64) (geo->size - geo->offset) / min_bytes)
+      {
+	  geo->offset = geo->size;
+	  return 0;
+      }
+    return (int) n;
+}
+
+static void
+ParseQuantizedVertices (gaiaGeomCollPtr geo, struct quantized_coords *qc,
+			double *coords, int points)
+{
+/* decodes the delta-encoded vertices of a QUANTIZED LINESTRING or RING */
+    int iv;
+    double x;
+    double y;
+    double z = 0.0;
+    double m = 0.0;
+    for (iv = 0; iv < points; iv++)
+      {
+	  qc->x = quantizedDelta (geo, qc->x);
+	  qc->y = quantizedDelta (geo, qc->y);
+	  x = quantizedValue (qc->x, qc->xy_precision);
+	  y = quantizedValue (qc->y, qc->xy_precision);
+	  if (qc->has_z)
+	    {
+		qc->z = quantizedDelta (geo, qc->z);
+		z = quantizedValue (qc->z, qc->z_precision);
+	    }
+	  if (qc->has_m)
+	    {
+		qc->m = quantizedDelta (geo, qc->m);
+		m = quantizedValue (qc->m, qc->m_precision);
+	    }
+	  if (qc->has_z && qc->has_m)
+	    {
+		gaiaSetPointXYZM (coords, iv, x, y, z, m);
+	    }
+	  else if (qc->has_z)
+	    {
+		gaiaSetPointXYZ (coords, iv, x, y, z);
+	    }
+	  else if (qc->has_m)
+	    {
+		gaiaSetPointXYM (coords, iv, x, y, m);
+	    }
+	  else
+	    {
+		gaiaSetPoint (coords, iv, x, y);
+	    }
+      }
+}
+
+static void
+ParseQuantizedWkbLine (gaiaGeomCollPtr geo, int dims)
+{
+/* decodes a QUANTIZED LINESTRING from SpatiaLite BLOB */
+    struct quantized_coords qc;
+    int points;
+    gaiaLinestringPtr line;
+    if (!ParseQuantizedHeader (geo, dims, &qc))
+	return;
+    points = ParseQuantizedCount (geo, qc.n_coords);
+    if (points <= 0)
+	return;
+    line = gaiaAddLinestringToGeomColl (geo, points);
+    if (line == NULL)
+	return;
+    ParseQuantizedVertices (geo, &qc, line->Coords, points);
+}
+
+static void
+ParseQuantizedWkbPolygon (gaiaGeomCollPtr geo, int dims)
+{
+/* decodes a QUANTIZED POLYGON from SpatiaLite BLOB */
+    struct quantized_coords qc;
+    int rings;
+    int nverts;
+    int ib;
+    gaiaPolygonPtr polyg = NULL;
+    gaiaRingPtr ring;
+    if (!ParseQuantizedHeader (geo, dims, &qc))
+	return;
+    rings = ParseQuantizedCount (geo, 1);
+    if (rings <= 0)
+	return;
+    for (ib = 0; ib < rings; ib++)
+      {
+	  /* deltas are never reset between adjacent rings */
+	  nverts = ParseQuantizedCount (geo, qc.n_coords);
+	  if (nverts < 4)
+	    {
+		/* a ring always requires at least 4 points */
+		if (polyg != NULL)
+		  {
+		      /* dropping all rings not yet parsed */
+		      polyg->NumInteriors = ib - 1;
+		  }
+		return;
+	    }
+	  if (ib == 0)
+	    {
+		polyg = gaiaAddPolygonToGeomColl (geo, nverts, rings - 1);
+		if (polyg == NULL)
+		    return;
+		ring = polyg->Exterior;
+	    }
+	  else
+	      ring = gaiaAddInteriorRing (polyg, ib - 1, nverts);
+	  if (ring->Coords == NULL)
+	      return;
+	  ParseQuantizedVertices (geo, &qc, ring->Coords, nverts);
+      }
+}
+
 static void
 ParseWkbGeometry (gaiaGeomCollPtr geo, int isWKB)
 {
@@ -1065,6 +1340,30 @@ ParseWkbGeometry (gaiaGeomCollPtr geo, int isWKB)
 	    case GAIA_COMPRESSED_POLYGONZM:
 		ParseCompressedWkbPolygonZM (geo);
 		break;
+	    case GAIA_QUANTIZED_LINESTRING:
+		ParseQuantizedWkbLine (geo, GAIA_XY);
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGZ:
+		ParseQuantizedWkbLine (geo, GAIA_XY_Z);
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGM:
+		ParseQuantizedWkbLine (geo, GAIA_XY_M);
+		break;
+	    case GAIA_QUANTIZED_LINESTRINGZM:
+		ParseQuantizedWkbLine (geo, GAIA_XY_Z_M);
+		break;
+	    case GAIA_QUANTIZED_POLYGON:
+		ParseQuantizedWkbPolygon (geo, GAIA_XY);
+		break;
+	    case GAIA_QUANTIZED_POLYGONZ:
+		ParseQuantizedWkbPolygon (geo, GAIA_XY_Z);
+		break;
+	    case GAIA_QUANTIZED_POLYGONM:
+		ParseQuantizedWkbPolygon (geo, GAIA_XY_M);
+		break;
+	    case GAIA_QUANTIZED_POLYGONZM:
+		ParseQuantizedWkbPolygon (geo, GAIA_XY_Z_M);
+		break;
 	    default:
 		break;
 	    };
@@ -1148,9 +1447,9 @@ doParseTinyPointBlob (const unsigned char *blob, unsigned int size)
     return geo;
 }
 
-GAIAGEO_DECLARE gaiaGeomCollPtr
-gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
-			     int gpkg_mode, int gpkg_amphibious)
+static gaiaGeomCollPtr
+doParseSpatiaLiteBlob (gaiaGeomArenaPtr arena, const unsigned char *blob,
+		       unsigned int size, int gpkg_mode, int gpkg_amphibious)
 {
 /* decoding from SpatiaLite BLOB to GEOMETRY */
     int type;
@@ -1199,7 +1498,9 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
     else
 	return NULL;		/* unknown encoding; nor little-endian neither big-endian */
     type = gaiaImport32 (blob + 39, little_endian, endian_arch);
-    geo = gaiaAllocGeomColl ();
+    geo = gaiaAllocGeomCollArena (arena, GAIA_XY);
+    if (geo == NULL)
+	return NULL;
     geo->Srid = gaiaImport32 (blob + 2, little_endian, endian_arch);
     geo->endian_arch = (char) endian_arch;
     geo->endian = (char) little_endian;
@@ -1218,6 +1519,8 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_GEOMETRYCOLLECTIONZ:
       case GAIA_COMPRESSED_LINESTRINGZ:
       case GAIA_COMPRESSED_POLYGONZ:
+      case GAIA_QUANTIZED_LINESTRINGZ:
+      case GAIA_QUANTIZED_POLYGONZ:
 	  geo->DimensionModel = GAIA_XY_Z;
 	  break;
       case GAIA_POINTM:
@@ -1229,6 +1532,8 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_GEOMETRYCOLLECTIONM:
       case GAIA_COMPRESSED_LINESTRINGM:
       case GAIA_COMPRESSED_POLYGONM:
+      case GAIA_QUANTIZED_LINESTRINGM:
+      case GAIA_QUANTIZED_POLYGONM:
 	  geo->DimensionModel = GAIA_XY_M;
 	  break;
       case GAIA_POINTZM:
@@ -1240,6 +1545,8 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_GEOMETRYCOLLECTIONZM:
       case GAIA_COMPRESSED_LINESTRINGZM:
       case GAIA_COMPRESSED_POLYGONZM:
+      case GAIA_QUANTIZED_LINESTRINGZM:
+      case GAIA_QUANTIZED_POLYGONZM:
 	  geo->DimensionModel = GAIA_XY_Z_M;
 	  break;
       default:
@@ -1309,6 +1616,30 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_COMPRESSED_POLYGONZM:
 	  ParseCompressedWkbPolygonZM (geo);
 	  break;
+      case GAIA_QUANTIZED_LINESTRING:
+	  ParseQuantizedWkbLine (geo, GAIA_XY);
+	  break;
+      case GAIA_QUANTIZED_LINESTRINGZ:
+	  ParseQuantizedWkbLine (geo, GAIA_XY_Z);
+	  break;
+      case GAIA_QUANTIZED_LINESTRINGM:
+	  ParseQuantizedWkbLine (geo, GAIA_XY_M);
+	  break;
+      case GAIA_QUANTIZED_LINESTRINGZM:
+	  ParseQuantizedWkbLine (geo, GAIA_XY_Z_M);
+	  break;
+      case GAIA_QUANTIZED_POLYGON:
+	  ParseQuantizedWkbPolygon (geo, GAIA_XY);
+	  break;
+      case GAIA_QUANTIZED_POLYGONZ:
+	  ParseQuantizedWkbPolygon (geo, GAIA_XY_Z);
+	  break;
+      case GAIA_QUANTIZED_POLYGONM:
+	  ParseQuantizedWkbPolygon (geo, GAIA_XY_M);
+	  break;
+      case GAIA_QUANTIZED_POLYGONZM:
+	  ParseQuantizedWkbPolygon (geo, GAIA_XY_Z_M);
+	  break;
       case GAIA_MULTIPOINT:
       case GAIA_MULTIPOINTZ:
       case GAIA_MULTIPOINTM:
@@ -1351,6 +1682,10 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_COMPRESSED_LINESTRINGZ:
       case GAIA_COMPRESSED_LINESTRINGM:
       case GAIA_COMPRESSED_LINESTRINGZM:
+      case GAIA_QUANTIZED_LINESTRING:
+      case GAIA_QUANTIZED_LINESTRINGZ:
+      case GAIA_QUANTIZED_LINESTRINGM:
+      case GAIA_QUANTIZED_LINESTRINGZM:
 	  geo->DeclaredType = GAIA_LINESTRING;
 	  break;
       case GAIA_POLYGON:
@@ -1361,6 +1696,10 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
       case GAIA_COMPRESSED_POLYGONZ:
       case GAIA_COMPRESSED_POLYGONM:
       case GAIA_COMPRESSED_POLYGONZM:
+      case GAIA_QUANTIZED_POLYGON:
+      case GAIA_QUANTIZED_POLYGONZ:
+      case GAIA_QUANTIZED_POLYGONM:
+      case GAIA_QUANTIZED_POLYGONZM:
 	  geo->DeclaredType = GAIA_POLYGON;
 	  break;
       case GAIA_MULTIPOINT:
@@ -1394,6 +1733,25 @@ gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
     return geo;
 }
 
+GAIAGEO_DECLARE gaiaGeomCollPtr
+gaiaFromSpatiaLiteBlobWkbEx (const unsigned char *blob, unsigned int size,
+			     int gpkg_mode, int gpkg_amphibious)
+{
+/* decoding from SpatiaLite BLOB to GEOMETRY */
+    return doParseSpatiaLiteBlob (NULL, blob, size, gpkg_mode,
+				  gpkg_amphibious);
+}
+
+GAIAGEO_DECLARE gaiaGeomCollPtr
+gaiaFromSpatiaLiteBlobWkbArena (gaiaGeomArenaPtr arena,
+				const unsigned char *blob, unsigned int size,
+				int gpkg_mode, int gpkg_amphibious)
+{
+/* decoding from SpatiaLite BLOB to GEOMETRY [Arena] */
+    return doParseSpatiaLiteBlob (arena, blob, size, gpkg_mode,
+				  gpkg_amphibious);
+}
+
 GAIAGEO_DECLARE gaiaGeomCollPtr
 gaiaFromSpatiaLiteBlobWkb (const unsigned char *blob, unsigned int size)
 {
@@ -1443,56 +1801,602 @@ doParseTinyPointBlobMbr (const unsigned char *blob, unsigned int size)
     return geo;
 }
 
-GAIAGEO_DECLARE gaiaGeomCollPtr
-gaiaFromSpatiaLiteBlobMbr (const unsigned char *blob, unsigned int size)
+GAIAGEO_DECLARE gaiaGeomCollPtr
+gaiaFromSpatiaLiteBlobMbr (const unsigned char *blob, unsigned int size)
+{
+/* decoding from SpatiaLite BLOB to GEOMETRY [MBR only] */
+    int little_endian;
+    int endian_arch = gaiaEndianArch ();
+    double minx;
+    double miny;
+    double maxx;
+    double maxy;
+    gaiaGeomCollPtr geo = NULL;
+    gaiaPolygonPtr polyg;
+    gaiaRingPtr ring;
+
+    if (size == 24 || size == 32 || size == 40)
+      {
+	  /* testing for a possible TinyPoint BLOB */
+	  if (*(blob + 0) == GAIA_MARK_START &&
+	      (*(blob + 1) == GAIA_TINYPOINT_LITTLE_ENDIAN
+	       || *(blob + 1) == GAIA_TINYPOINT_BIG_ENDIAN)
+	      && *(blob + (size - 1)) == GAIA_MARK_END)
+	      return doParseTinyPointBlobMbr (blob, size);
+      }
+    if (size < 45)
+	return NULL;		/* cannot be an internal BLOB WKB geometry */
+    if (*(blob + 0) != GAIA_MARK_START)
+	return NULL;		/* failed to recognize START signature */
+    if (*(blob + (size - 1)) != GAIA_MARK_END)
+	return NULL;		/* failed to recognize END signature */
+    if (*(blob + 38) != GAIA_MARK_MBR)
+	return NULL;		/* failed to recognize MBR signature */
+    if (*(blob + 1) == GAIA_LITTLE_ENDIAN)
+	little_endian = 1;
+    else if (*(blob + 1) == GAIA_BIG_ENDIAN)
+	little_endian = 0;
+    else
+	return NULL;		/* unknown encoding; nor litte-endian neither big-endian */
+    geo = gaiaAllocGeomColl ();
+    polyg = gaiaAddPolygonToGeomColl (geo, 5, 0);
+    ring = polyg->Exterior;
+    minx = gaiaImport64 (blob + 6, little_endian, endian_arch);
+    miny = gaiaImport64 (blob + 14, little_endian, endian_arch);
+    maxx = gaiaImport64 (blob + 22, little_endian, endian_arch);
+    maxy = gaiaImport64 (blob + 30, little_endian, endian_arch);
+    gaiaSetPoint (ring->Coords, 0, minx, miny);	/* vertex # 1 */
+    gaiaSetPoint (ring->Coords, 1, maxx, miny);	/* vertex # 2 */
+    gaiaSetPoint (ring->Coords, 2, maxx, maxy);	/* vertex # 3 */
+    gaiaSetPoint (ring->Coords, 3, minx, maxy);	/* vertex # 4 */
+    gaiaSetPoint (ring->Coords, 4, minx, miny);	/* vertex # 5 [same as vertex # 1 to close the polygon] */
+    return geo;
+}
+
+static int
+blobViewElementary (int type, int in_collection, int *class, int *dims,
+		    int *compressed)
+{
+/* identifying an elementary item stored within a BLOB-Geometry */
+    *compressed = 0;
+    switch (type)
+      {
+      case GAIA_POINT:
+	  *class = GAIA_POINT;
+	  *dims = GAIA_XY;
+	  break;
+      case GAIA_POINTZ:
+	  *class = GAIA_POINT;
+	  *dims = GAIA_XY_Z;
+	  break;
+      case GAIA_POINTM:
+	  *class = GAIA_POINT;
+	  *dims = GAIA_XY_M;
+	  break;
+      case GAIA_POINTZM:
+	  *class = GAIA_POINT;
+	  *dims = GAIA_XY_Z_M;
+	  break;
+      case GAIA_LINESTRING:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY;
+	  break;
+      case GAIA_LINESTRINGZ:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_Z;
+	  break;
+      case GAIA_LINESTRINGM:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_M;
+	  break;
+      case GAIA_LINESTRINGZM:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_Z_M;
+	  break;
+      case GAIA_POLYGON:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY;
+	  break;
+      case GAIA_POLYGONZ:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_Z;
+	  break;
+      case GAIA_POLYGONM:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_M;
+	  break;
+      case GAIA_POLYGONZM:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_Z_M;
+	  break;
+      case GAIA_COMPRESSED_LINESTRING:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_LINESTRINGZ:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_Z;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_LINESTRINGM:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_M;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_LINESTRINGZM:
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_Z_M;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_POLYGON:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_POLYGONZ:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_Z;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_POLYGONM:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_M;
+	  *compressed = 1;
+	  break;
+      case GAIA_COMPRESSED_POLYGONZM:
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_Z_M;
+	  *compressed = 1;
+	  break;
+      case GAIA_GEOSWKB_POINTZ:
+	  if (!in_collection)
+	      return 0;
+	  *class = GAIA_POINT;
+	  *dims = GAIA_XY_Z;
+	  break;
+      case GAIA_GEOSWKB_LINESTRINGZ:
+	  if (!in_collection)
+	      return 0;
+	  *class = GAIA_LINESTRING;
+	  *dims = GAIA_XY_Z;
+	  break;
+      case GAIA_GEOSWKB_POLYGONZ:
+	  if (!in_collection)
+	      return 0;
+	  *class = GAIA_POLYGON;
+	  *dims = GAIA_XY_Z;
+	  break;
+      default:
+	  return 0;
+      };
+    return 1;
+}
+
+static int
+blobViewVertexBytes (gaiaBlobViewPtr view, int points, unsigned int *bytes)
+{
+/* 
+/ computing how many bytes are required by the vertices of the current item
+/ exactly applying the same size checks as the BLOB decoder
+*/
+    unsigned int full;
+    unsigned int delta;
+    unsigned int extra;
+    unsigned int required;
+    if (points < 0 || points > (int) (view->size / 8))
+	return 0;
+    switch (view->PartDimensionModel)
+      {
+      case GAIA_XY_Z:
+	  full = 24;
+	  delta = 12;
+	  extra = 24;
+	  break;
+      case GAIA_XY_M:
+	  full = 24;
+	  delta = 16;
+	  extra = 16;
+	  break;
+      case GAIA_XY_Z_M:
+	  full = 32;
+	  delta = 20;
+	  extra = 24;
+	  break;
+      default:
+	  full = 16;
+	  delta = 8;
+	  extra = 16;
+	  break;
+      };
+    if (!view->compressed)
+      {
+	  required = full * points;
+	  *bytes = required;
+      }
+    else
+      {
+	  /* first and last vertices are uncompressed */
+	  required = (delta * points) + extra;
+	  if (points == 0)
+	      *bytes = 0;
+	  else if (points == 1)
+	      *bytes = full;
+	  else
+	      *bytes = (full * 2) + (delta * (points - 2));
+      }
+    if (view->size < view->offset + required)
+	return 0;
+    if (view->size < view->offset + *bytes)
+	return 0;
+    return 1;
+}
+
+static int
+blobViewStep (gaiaBlobViewPtr view)
+{
+/* 
+/ positioning the cursor on the next elementary item
+/ returns 1 on success, 0 when no further item exists, -1 on failure
+*/
+    int type;
+    int class;
+    int points;
+    unsigned int bytes;
+    while (1)
+      {
+	  if (view->rings > 0)
+	    {
+		/* next RING of the current POLYGON */
+		if (view->size < view->offset + 4)
+		    return -1;
+		points =
+		    gaiaImport32 (view->blob + view->offset, view->endian,
+				  view->endian_arch);
+		view->offset += 4;
+		if (!blobViewVertexBytes (view, points, &bytes))
+		    return -1;
+		view->PartType = GAIA_POLYGON;
+		view->PartPoints = points;
+		view->PartRing += 1;
+		view->vertex_offset = view->offset;
+		view->vertex = 0;
+		view->offset += bytes;
+		view->rings -= 1;
+		return 1;
+	    }
+	  if (view->entities <= 0)
+	      return 0;
+	  if (view->collection)
+	    {
+		if (view->size < view->offset + 5)
+		    return -1;
+		type =
+		    gaiaImport32 (view->blob + view->offset + 1, view->endian,
+				  view->endian_arch);
+		view->offset += 5;
+	    }
+	  else
+	      type = view->elem_type;
+	  view->entities -= 1;
+	  view->elem_type = type;
+	  if (!blobViewElementary
+	      (type, view->collection, &class, &(view->PartDimensionModel),
+	       &(view->compressed)))
+	      return -1;
+	  view->PartRing = -1;
+	  if (class == GAIA_POINT)
+	    {
+		view->compressed = 0;
+		if (!blobViewVertexBytes (view, 1, &bytes))
+		    return -1;
+		view->PartType = GAIA_POINT;
+		view->PartPoints = 1;
+		view->vertex_offset = view->offset;
+		view->vertex = 0;
+		view->offset += bytes;
+		return 1;
+	    }
+	  if (view->size < view->offset + 4)
+	      return -1;
+	  points =
+	      gaiaImport32 (view->blob + view->offset, view->endian,
+			    view->endian_arch);
+	  view->offset += 4;
+	  if (class == GAIA_LINESTRING)
+	    {
+		if (!blobViewVertexBytes (view, points, &bytes))
+		    return -1;
+		view->PartType = GAIA_LINESTRING;
+		view->PartPoints = points;
+		view->vertex_offset = view->offset;
+		view->vertex = 0;
+		view->offset += bytes;
+		return 1;
+	    }
+	  /* POLYGON: the next step will return its first RING */
+	  if (points < 0)
+	      return -1;
+	  view->rings = points;
+      }
+}
+
+static void
+blobViewRewind (gaiaBlobViewPtr view, int type, int tiny_point)
+{
+/* positioning the cursor before the first elementary item */
+    view->rings = 0;
+    view->vertex = 0;
+    view->PartType = GAIA_UNKNOWN;
+    view->PartPoints = 0;
+    view->PartRing = -1;
+    view->PartDimensionModel = view->DimensionModel;
+    view->last_x = 0.0;
+    view->last_y = 0.0;
+    view->last_z = 0.0;
+    if (tiny_point)
+	view->offset = 7;
+    else
+	view->offset = 43;
+    if (view->collection)
+      {
+	  view->entities =
+	      gaiaImport32 (view->blob + view->offset, view->endian,
+			    view->endian_arch);
+	  view->offset += 4;
+	  view->elem_type = GAIA_UNKNOWN;
+      }
+    else
+      {
+	  view->entities = 1;
+	  view->elem_type = type;
+      }
+}
+
+GAIAGEO_DECLARE int
+gaiaBlobViewInit (gaiaBlobViewPtr view, const unsigned char *blob,
+		  unsigned int size)
+{
+/* initializing a read-only view of a SpatiaLite BLOB-Geometry */
+    int type;
+    int little_endian;
+    int tiny_point = 0;
+    int endian_arch = gaiaEndianArch ();
+    int ret;
+
+    if (view == NULL || blob == NULL)
+	return 0;
+    memset (view, 0, sizeof (gaiaBlobView));
+    if (size == 24 || size == 32 || size == 40)
+      {
+	  /* testing for a possible TinyPoint BLOB */
+	  if (*(blob + 0) == GAIA_MARK_START &&
+	      (*(blob + 1) == GAIA_TINYPOINT_LITTLE_ENDIAN
+	       || *(blob + 1) == GAIA_TINYPOINT_BIG_ENDIAN)
+	      && *(blob + (size - 1)) == GAIA_MARK_END)
+	      tiny_point = 1;
+      }
+    if (tiny_point)
+      {
+	  little_endian =
+	      (*(blob + 1) == GAIA_TINYPOINT_LITTLE_ENDIAN) ? 1 : 0;
+	  switch (*(blob + 6))
+	    {
+	    case GAIA_TINYPOINT_XYZ:
+		type = GAIA_POINTZ;
+		break;
+	    case GAIA_TINYPOINT_XYM:
+		type = GAIA_POINTM;
+		break;
+	    case GAIA_TINYPOINT_XYZM:
+		type = GAIA_POINTZM;
+		break;
+	    default:
+		type = GAIA_POINT;
+		break;
+	    };
+      }
+    else
+      {
+	  if (size < 45)
+	      return 0;		/* cannot be an internal BLOB WKB geometry */
+	  if (*(blob + 0) != GAIA_MARK_START)
+	      return 0;		/* failed to recognize START signature */
+	  if (*(blob + (size - 1)) != GAIA_MARK_END)
+	      return 0;		/* failed to recognize END signature */
+	  if (*(blob + 38) != GAIA_MARK_MBR)
+	      return 0;		/* failed to recognize MBR signature */
+	  if (*(blob + 1) == GAIA_LITTLE_ENDIAN)
+	      little_endian = 1;
+	  else if (*(blob + 1) == GAIA_BIG_ENDIAN)
+	      little_endian = 0;
+	  else
+	      return 0;		/* unknown encoding; nor little-endian neither big-endian */
+	  type = gaiaImport32 (blob + 39, little_endian, endian_arch);
+      }
+    view->blob = blob;
+    view->size = size;
+    view->endian = little_endian;
+    view->endian_arch = endian_arch;
+    view->Type = type;
+    view->Srid = gaiaImport32 (blob + 2, little_endian, endian_arch);
+    switch (type)
+      {
+	  /* setting up DimensionModel and DeclaredType */
+      case GAIA_MULTIPOINT:
+      case GAIA_MULTILINESTRING:
+      case GAIA_MULTIPOLYGON:
+      case GAIA_GEOMETRYCOLLECTION:
+	  view->collection = 1;
+	  view->DimensionModel = GAIA_XY;
+	  view->DeclaredType = type;
+	  break;
+      case GAIA_MULTIPOINTZ:
+      case GAIA_MULTILINESTRINGZ:
+      case GAIA_MULTIPOLYGONZ:
+      case GAIA_GEOMETRYCOLLECTIONZ:
+	  view->collection = 1;
+	  view->DimensionModel = GAIA_XY_Z;
+	  view->DeclaredType = type - 1000;
+	  break;
+      case GAIA_MULTIPOINTM:
+      case GAIA_MULTILINESTRINGM:
+      case GAIA_MULTIPOLYGONM:
+      case GAIA_GEOMETRYCOLLECTIONM:
+	  view->collection = 1;
+	  view->DimensionModel = GAIA_XY_M;
+	  view->DeclaredType = type - 2000;
+	  break;
+      case GAIA_MULTIPOINTZM:
+      case GAIA_MULTILINESTRINGZM:
+      case GAIA_MULTIPOLYGONZM:
+      case GAIA_GEOMETRYCOLLECTIONZM:
+	  view->collection = 1;
+	  view->DimensionModel = GAIA_XY_Z_M;
+	  view->DeclaredType = type - 3000;
+	  break;
+      default:
+	  if (!blobViewElementary
+	      (type, 0, &(view->DeclaredType), &(view->DimensionModel),
+	       &(view->compressed)))
+	      return 0;		/* unsupported Geometry class */
+	  break;
+      };
+    if (view->collection && size < 47)
+	return 0;
+
+    /* walking the whole BLOB so to validate it and to set the counters */
+    blobViewRewind (view, type, tiny_point);
+    while ((ret = blobViewStep (view)) == 1)
+      {
+	  if (view->PartType == GAIA_POINT)
+	      view->NumPoints += 1;
+	  else if (view->PartType == GAIA_LINESTRING)
+	      view->NumLinestrings += 1;
+	  else
+	    {
+		if (view->PartRing == 0)
+		    view->NumPolygons += 1;
+		view->NumRings += 1;
+	    }
+	  view->NumVertices += view->PartPoints;
+      }
+    if (ret < 0)
+	return 0;		/* malformed or truncated BLOB */
+
+    if (tiny_point)
+      {
+	  view->MinX = gaiaImport64 (blob + 7, little_endian, endian_arch);
+	  view->MinY = gaiaImport64 (blob + 15, little_endian, endian_arch);
+	  view->MaxX = view->MinX;
+	  view->MaxY = view->MinY;
+      }
+    else
+      {
+	  view->MinX = gaiaImport64 (blob + 6, little_endian, endian_arch);
+	  view->MinY = gaiaImport64 (blob + 14, little_endian, endian_arch);
+	  view->MaxX = gaiaImport64 (blob + 22, little_endian, endian_arch);
+	  view->MaxY = gaiaImport64 (blob + 30, little_endian, endian_arch);
+      }
+    blobViewRewind (view, type, tiny_point);
+    return 1;
+}
+
+GAIAGEO_DECLARE int
+gaiaBlobViewNextPart (gaiaBlobViewPtr view)
 {
-/* decoding from SpatiaLite BLOB to GEOMETRY [MBR only] */
-    int little_endian;
-    int endian_arch = gaiaEndianArch ();
-    double minx;
-    double miny;
-    double maxx;
-    double maxy;
-    gaiaGeomCollPtr geo = NULL;
-    gaiaPolygonPtr polyg;
-    gaiaRingPtr ring;
+/* moving the cursor to the next elementary item */
+    if (view == NULL)
+	return 0;
+    if (blobViewStep (view) == 1)
+	return 1;
+    view->PartType = GAIA_UNKNOWN;
+    view->PartPoints = 0;
+    view->vertex = 0;
+    return 0;
+}
 
-    if (size == 24 || size == 32 || size == 40)
+GAIAGEO_DECLARE int
+gaiaBlobViewNextVertex (gaiaBlobViewPtr view, double *x, double *y,
+			double *z, double *m)
+{
+/* reading the next vertex from the current item */
+    const unsigned char *p;
+    double xx;
+    double yy;
+    double zz = 0.0;
+    double mm = 0.0;
+    unsigned int step;
+    if (view == NULL)
+	return 0;
+    if (view->vertex >= view->PartPoints)
+	return 0;
+    p = view->blob + view->vertex_offset;
+    if (!view->compressed || view->vertex == 0
+	|| view->vertex == (view->PartPoints - 1))
       {
-	  /* testing for a possible TinyPoint BLOB */
-	  if (*(blob + 0) == GAIA_MARK_START &&
-	      (*(blob + 1) == GAIA_TINYPOINT_LITTLE_ENDIAN
-	       || *(blob + 1) == GAIA_TINYPOINT_BIG_ENDIAN)
-	      && *(blob + (size - 1)) == GAIA_MARK_END)
-	      return doParseTinyPointBlobMbr (blob, size);
+	  /* uncompressed vertex */
+	  xx = gaiaImport64 (p, view->endian, view->endian_arch);
+	  yy = gaiaImport64 (p + 8, view->endian, view->endian_arch);
+	  switch (view->PartDimensionModel)
+	    {
+	    case GAIA_XY_Z:
+		zz = gaiaImport64 (p + 16, view->endian, view->endian_arch);
+		step = 24;
+		break;
+	    case GAIA_XY_M:
+		mm = gaiaImport64 (p + 16, view->endian, view->endian_arch);
+		step = 24;
+		break;
+	    case GAIA_XY_Z_M:
+		zz = gaiaImport64 (p + 16, view->endian, view->endian_arch);
+		mm = gaiaImport64 (p + 24, view->endian, view->endian_arch);
+		step = 32;
+		break;
+	    default:
+		step = 16;
+		break;
+	    };
       }
-    if (size < 45)
-	return NULL;		/* cannot be an internal BLOB WKB geometry */
-    if (*(blob + 0) != GAIA_MARK_START)
-	return NULL;		/* failed to recognize START signature */
-    if (*(blob + (size - 1)) != GAIA_MARK_END)
-	return NULL;		/* failed to recognize END signature */
-    if (*(blob + 38) != GAIA_MARK_MBR)
-	return NULL;		/* failed to recognize MBR signature */
-    if (*(blob + 1) == GAIA_LITTLE_ENDIAN)
-	little_endian = 1;
-    else if (*(blob + 1) == GAIA_BIG_ENDIAN)
-	little_endian = 0;
     else
-	return NULL;		/* unknown encoding; nor litte-endian neither big-endian */
-    geo = gaiaAllocGeomColl ();
-    polyg = gaiaAddPolygonToGeomColl (geo, 5, 0);
-    ring = polyg->Exterior;
-    minx = gaiaImport64 (blob + 6, little_endian, endian_arch);
-    miny = gaiaImport64 (blob + 14, little_endian, endian_arch);
-    maxx = gaiaImport64 (blob + 22, little_endian, endian_arch);
-    maxy = gaiaImport64 (blob + 30, little_endian, endian_arch);
-    gaiaSetPoint (ring->Coords, 0, minx, miny);	/* vertex # 1 */
-    gaiaSetPoint (ring->Coords, 1, maxx, miny);	/* vertex # 2 */
-    gaiaSetPoint (ring->Coords, 2, maxx, maxy);	/* vertex # 3 */
-    gaiaSetPoint (ring->Coords, 3, minx, maxy);	/* vertex # 4 */
-    gaiaSetPoint (ring->Coords, 4, minx, miny);	/* vertex # 5 [same as vertex # 1 to close the polygon] */
-    return geo;
+      {
+	  /* compressed vertex: float deltas */
+	  xx = view->last_x +
+	      gaiaImportF32 (p, view->endian, view->endian_arch);
+	  yy = view->last_y +
+	      gaiaImportF32 (p + 4, view->endian, view->endian_arch);
+	  switch (view->PartDimensionModel)
+	    {
+	    case GAIA_XY_Z:
+		zz = view->last_z +
+		    gaiaImportF32 (p + 8, view->endian, view->endian_arch);
+		step = 12;
+		break;
+	    case GAIA_XY_M:
+		mm = gaiaImport64 (p + 8, view->endian, view->endian_arch);
+		step = 16;
+		break;
+	    case GAIA_XY_Z_M:
+		zz = view->last_z +
+		    gaiaImportF32 (p + 8, view->endian, view->endian_arch);
+		mm = gaiaImport64 (p + 12, view->endian, view->endian_arch);
+		step = 20;
+		break;
+	    default:
+		step = 8;
+		break;
+	    };
+      }
+    view->last_x = xx;
+    view->last_y = yy;
+    view->last_z = zz;
+    view->vertex += 1;
+    view->vertex_offset += step;
+    *x = xx;
+    *y = yy;
+    *z = zz;
+    *m = mm;
+    return 1;
 }
 
 GAIAGEO_DECLARE void
@@ -3706,6 +4610,436 @@ gaiaToCompressedBlobWkb (gaiaGeomCollPtr geom, unsigned char **result,
       };
 }
 
+static int
+quantizeValue (double value, int precision, sqlite3_int64 * q)
+{
+/* converting a coordinate value into a quantized integer */
+    double v;
+    if (precision >= 0)
+	v = value * quantized_scales[precision];
+    else
+	v = value / quantized_scales[-precision];
+    if (v < 0.0)
+	v = ceil (v - 0.5);	/* rounding half away from zero */
+    else
+	v = floor (v + 0.5);
+    if (!(v >= -9007199254740992.0 && v <= 9007199254740992.0))
+	return 0;		/* NaN, Infinite or not exactly representable */
+    *q = (sqlite3_int64) v;
+    return 1;
+}
+
+static void
+quantizedGetVertex (double *coords, int iv, int dims, double *x, double *y,
+		    double *z, double *m)
+{
+/* fetching a vertex from a LINESTRING or RING */
+    *z = 0.0;
+    *m = 0.0;
+    if (dims == GAIA_XY_Z)
+      {
+	  gaiaGetPointXYZ (coords, iv, x, y, z);
+      }
+    else if (dims == GAIA_XY_M)
+      {
+	  gaiaGetPointXYM (coords, iv, x, y, m);
+      }
+    else if (dims == GAIA_XY_Z_M)
+      {
+	  gaiaGetPointXYZM (coords, iv, x, y, z, m);
+      }
+    else
+      {
+	  gaiaGetPoint (coords, iv, x, y);
+      }
+}
+
+static int
+quantizedCheckCoords (struct quantized_coords *qc, double *coords, int points,
+		      int dims, double *mbr)
+{
+/* 
+/ checking if all vertices can be safely quantized
+/ the MBR is updated accordingly to the quantized vertices
+*/
+    int iv;
+    double x;
+    double y;
+    double z;
+    double m;
+    sqlite3_int64 q;
+    for (iv = 0; iv < points; iv++)
+      {
+	  quantizedGetVertex (coords, iv, dims, &x, &y, &z, &m);
+	  if (!quantizeValue (x, qc->xy_precision, &q))
+	      return 0;
+	  x = quantizedValue (q, qc->xy_precision);
+	  if (!quantizeValue (y, qc->xy_precision, &q))
+	      return 0;
+	  y = quantizedValue (q, qc->xy_precision);
+	  if (qc->has_z && !quantizeValue (z, qc->z_precision, &q))
+	      return 0;
+	  if (qc->has_m && !quantizeValue (m, qc->m_precision, &q))
+	      return 0;
+	  if (x < mbr[0])
+	      mbr[0] = x;
+	  if (y < mbr[1])
+	      mbr[1] = y;
+	  if (x > mbr[2])
+	      mbr[2] = x;
+	  if (y > mbr[3])
+	      mbr[3] = y;
+      }
+    return 1;
+}
+
+static unsigned char *
+quantizedExportVarint (unsigned char *p, sqlite3_uint64 value)
+{
+/* encoding an unsigned varint (7 bits per byte, low order bits first) */
+    while (value >= 0x80)
+      {
+	  *p++ = (unsigned char) ((value & 0x7f) | 0x80);
+	  value >>= 7;
+      }
+    *p++ = (unsigned char) value;
+    return p;
+}
+
+static unsigned char *
+quantizedExportDelta (unsigned char *p, double value, int precision,
+		      sqlite3_int64 * last)
+{
+/* encoding the zigzag delta between two consecutive quantized values */
+    sqlite3_int64 q = 0;
+    sqlite3_int64 delta;
+    sqlite3_uint64 zigzag;
+    quantizeValue (value, precision, &q);
+    delta = q - *last;
+    *last = q;
+    zigzag = (sqlite3_uint64) delta << 1;
+    if (delta < 0)
+	zigzag = ~zigzag;
+    return quantizedExportVarint (p, zigzag);
+}
+
+static unsigned char *
+quantizedExportCoords (unsigned char *p, struct quantized_coords *qc,
+		       double *coords, int points, int dims)
+{
+/* encoding the vertices of a LINESTRING or RING */
+    int iv;
+    double x;
+    double y;
+    double z;
+    double m;
+    p = quantizedExportVarint (p, (sqlite3_uint64) points);
+    for (iv = 0; iv < points; iv++)
+      {
+	  quantizedGetVertex (coords, iv, dims, &x, &y, &z, &m);
+	  p = quantizedExportDelta (p, x, qc->xy_precision, &(qc->x));
+	  p = quantizedExportDelta (p, y, qc->xy_precision, &(qc->y));
+	  if (qc->has_z)
+	      p = quantizedExportDelta (p, z, qc->z_precision, &(qc->z));
+	  if (qc->has_m)
+	      p = quantizedExportDelta (p, m, qc->m_precision, &(qc->m));
+      }
+    return p;
+}
+
+static unsigned char *
+quantizedExportHeader (unsigned char *p, struct quantized_coords *qc)
+{
+/* encoding the precisions of a QUANTIZED item */
+    qc->x = 0;
+    qc->y = 0;
+    qc->z = 0;
+    qc->m = 0;
+    *p++ = (unsigned char) (qc->xy_precision & 0xff);
+    if (qc->has_z)
+	*p++ = (unsigned char) (qc->z_precision & 0xff);
+    if (qc->has_m)
+	*p++ = (unsigned char) (qc->m_precision & 0xff);
+    return p;
+}
+
+static unsigned char *
+quantizedExportPoint (unsigned char *p, gaiaPointPtr point, int dims,
+		      int endian_arch)
+{
+/* POINTs are never quantized: plain doubles */
+    gaiaExport64 (p, point->X, 1, endian_arch);
+    gaiaExport64 (p + 8, point->Y, 1, endian_arch);
+    p += 16;
+    if (dims == GAIA_XY_Z || dims == GAIA_XY_Z_M)
+      {
+	  gaiaExport64 (p, point->Z, 1, endian_arch);
+	  p += 8;
+      }
+    if (dims == GAIA_XY_M || dims == GAIA_XY_Z_M)
+      {
+	  gaiaExport64 (p, point->M, 1, endian_arch);
+	  p += 8;
+      }
+    return p;
+}
+
+static unsigned char *
+quantizedExportPolygon (unsigned char *p, struct quantized_coords *qc,
+			gaiaPolygonPtr polyg, int dims)
+{
+/* encoding a QUANTIZED POLYGON [deltas are never reset between rings] */
+    int ib;
+    gaiaRingPtr rng;
+    p = quantizedExportHeader (p, qc);
+    p = quantizedExportVarint (p, (sqlite3_uint64) (polyg->NumInteriors + 1));
+    rng = polyg->Exterior;
+    p = quantizedExportCoords (p, qc, rng->Coords, rng->Points, dims);
+    for (ib = 0; ib < polyg->NumInteriors; ib++)
+      {
+	  rng = polyg->Interiors + ib;
+	  p = quantizedExportCoords (p, qc, rng->Coords, rng->Points, dims);
+      }
+    return p;
+}
+
+static int
+quantizedBlobClass (gaiaGeomCollPtr geom, int n_points, int n_linestrings,
+		    int n_polygons, int *collection)
+{
+/* determining the class of a QUANTIZED BLOB-Geometry */
+    int type;
+    int declared = geom->DeclaredType;
+    *collection = 1;
+    if (declared != GAIA_GEOMETRYCOLLECTION && n_points > 0
+	&& n_linestrings == 0 && n_polygons == 0)
+      {
+	  if (n_points == 1 && declared != GAIA_MULTIPOINT)
+	    {
+		*collection = 0;
+		type = GAIA_POINT;
+	    }
+	  else
+	      type = GAIA_MULTIPOINT;
+      }
+    else if (declared != GAIA_GEOMETRYCOLLECTION && n_points == 0
+	     && n_linestrings > 0 && n_polygons == 0)
+      {
+	  if (n_linestrings == 1 && declared != GAIA_MULTILINESTRING)
+	    {
+		*collection = 0;
+		type = GAIA_QUANTIZED_LINESTRING;
+	    }
+	  else
+	      type = GAIA_MULTILINESTRING;
+      }
+    else if (declared != GAIA_GEOMETRYCOLLECTION && n_points == 0
+	     && n_linestrings == 0 && n_polygons > 0)
+      {
+	  if (n_polygons == 1 && declared != GAIA_MULTIPOLYGON)
+	    {
+		*collection = 0;
+		type = GAIA_QUANTIZED_POLYGON;
+	    }
+	  else
+	      type = GAIA_MULTIPOLYGON;
+      }
+    else
+	type = GAIA_GEOMETRYCOLLECTION;
+    switch (geom->DimensionModel)
+      {
+      case GAIA_XY_Z:
+	  type += 1000;
+	  break;
+      case GAIA_XY_M:
+	  type += 2000;
+	  break;
+      case GAIA_XY_Z_M:
+	  type += 3000;
+	  break;
+      }
+    return type;
+}
+
+GAIAGEO_DECLARE int
+gaiaToQuantizedBlobWkb (gaiaGeomCollPtr geom, int xy_precision,
+			int z_precision, int m_precision,
+			unsigned char **result, int *size)
+{
+/* 
+/ builds the SpatiaLite BLOB representation for this GEOMETRY 
+/ LINESTRINGs and RINGs will be stored as quantized integer deltas
+*/
+    int ib;
+    int n_points = 0;
+    int n_linestrings = 0;
+    int n_polygons = 0;
+    int collection;
+    int type;
+    int dims;
+    int item_dims;
+    int max_size;
+    double mbr[4];
+    struct quantized_coords qc;
+    unsigned char *blob;
+    unsigned char *shrunk;
+    unsigned char *ptr;
+    gaiaPointPtr pt;
+    gaiaLinestringPtr ln;
+    gaiaPolygonPtr pg;
+    gaiaRingPtr rng;
+    int endian_arch = gaiaEndianArch ();
+
+    *result = NULL;
+    *size = 0;
+    if (geom == NULL)
+	return 0;
+    if (xy_precision < GAIA_QUANTIZED_MIN_PRECISION
+	|| xy_precision > GAIA_QUANTIZED_MAX_PRECISION
+	|| z_precision < GAIA_QUANTIZED_MIN_PRECISION
+	|| z_precision > GAIA_QUANTIZED_MAX_PRECISION
+	|| m_precision < GAIA_QUANTIZED_MIN_PRECISION
+	|| m_precision > GAIA_QUANTIZED_MAX_PRECISION)
+	return 0;
+    dims = geom->DimensionModel;
+    memset (&qc, 0, sizeof (struct quantized_coords));
+    qc.has_z = (dims == GAIA_XY_Z || dims == GAIA_XY_Z_M);
+    qc.has_m = (dims == GAIA_XY_M || dims == GAIA_XY_Z_M);
+    qc.n_coords = 2 + qc.has_z + qc.has_m;
+    qc.xy_precision = xy_precision;
+    qc.z_precision = z_precision;
+    qc.m_precision = m_precision;
+
+/* 
+/ checking all vertices, computing the MBR of the quantized Geometry
+/ and an upper bound of the BLOB size (a varint requires at most 10 bytes)
+*/
+    mbr[0] = DBL_MAX;
+    mbr[1] = DBL_MAX;
+    mbr[2] = -DBL_MAX;
+    mbr[3] = -DBL_MAX;
+    max_size = 48;		/* header, # entities and END signature */
+    for (pt = geom->FirstPoint; pt != NULL; pt = pt->Next)
+      {
+	  if (pt->X < mbr[0])
+	      mbr[0] = pt->X;
+	  if (pt->Y < mbr[1])
+	      mbr[1] = pt->Y;
+	  if (pt->X > mbr[2])
+	      mbr[2] = pt->X;
+	  if (pt->Y > mbr[3])
+	      mbr[3] = pt->Y;
+	  max_size += 5 + (8 * qc.n_coords);
+	  n_points++;
+      }
+    for (ln = geom->FirstLinestring; ln != NULL; ln = ln->Next)
+      {
+	  if (!quantizedCheckCoords (&qc, ln->Coords, ln->Points, dims, mbr))
+	      return 0;
+	  max_size += 5 + 3 + 10 + (10 * qc.n_coords * ln->Points);
+	  n_linestrings++;
+      }
+    for (pg = geom->FirstPolygon; pg != NULL; pg = pg->Next)
+      {
+	  rng = pg->Exterior;
+	  if (!quantizedCheckCoords
+	      (&qc, rng->Coords, rng->Points, dims, mbr))
+	      return 0;
+	  max_size += 5 + 3 + 10 + 10 + (10 * qc.n_coords * rng->Points);
+	  for (ib = 0; ib < pg->NumInteriors; ib++)
+	    {
+		rng = pg->Interiors + ib;
+		if (!quantizedCheckCoords
+		    (&qc, rng->Coords, rng->Points, dims, mbr))
+		    return 0;
+		max_size += 10 + (10 * qc.n_coords * rng->Points);
+	    }
+	  n_polygons++;
+      }
+    if (n_points == 0 && n_linestrings == 0 && n_polygons == 0)
+	return 0;
+    type =
+	quantizedBlobClass (geom, n_points, n_linestrings, n_polygons,
+			    &collection);
+    if (dims == GAIA_XY_Z)
+	item_dims = 1000;
+    else if (dims == GAIA_XY_M)
+	item_dims = 2000;
+    else if (dims == GAIA_XY_Z_M)
+	item_dims = 3000;
+    else
+	item_dims = 0;
+
+    blob = malloc (max_size);
+    if (blob == NULL)
+	return 0;
+    *blob = GAIA_MARK_START;	/* START signature */
+    *(blob + 1) = GAIA_LITTLE_ENDIAN;	/* byte ordering */
+    gaiaExport32 (blob + 2, geom->Srid, 1, endian_arch);	/* the SRID */
+    gaiaExport64 (blob + 6, mbr[0], 1, endian_arch);	/* MBR - minimum X */
+    gaiaExport64 (blob + 14, mbr[1], 1, endian_arch);	/* MBR - minimum Y */
+    gaiaExport64 (blob + 22, mbr[2], 1, endian_arch);	/* MBR - maximum X */
+    gaiaExport64 (blob + 30, mbr[3], 1, endian_arch);	/* MBR - maximum Y */
+    *(blob + 38) = GAIA_MARK_MBR;	/* MBR signature */
+    gaiaExport32 (blob + 39, type, 1, endian_arch);	/* geometry class */
+    ptr = blob + 43;
+    if (!collection)
+      {
+	  /* an elementary Geometry */
+	  if (geom->FirstPoint != NULL)
+	      ptr = quantizedExportPoint (ptr, geom->FirstPoint, dims,
+					  endian_arch);
+	  else if (geom->FirstLinestring != NULL)
+	    {
+		ln = geom->FirstLinestring;
+		ptr = quantizedExportHeader (ptr, &qc);
+		ptr = quantizedExportCoords (ptr, &qc, ln->Coords, ln->Points,
+					     dims);
+	    }
+	  else
+	      ptr = quantizedExportPolygon (ptr, &qc, geom->FirstPolygon,
+					    dims);
+      }
+    else
+      {
+	  /* a MULTIxxxx or a GEOMETRYCOLLECTION */
+	  gaiaExport32 (ptr, n_points + n_linestrings + n_polygons, 1,
+			endian_arch);
+	  ptr += 4;
+	  for (pt = geom->FirstPoint; pt != NULL; pt = pt->Next)
+	    {
+		*ptr = GAIA_MARK_ENTITY;	/* ENTITY signature */
+		gaiaExport32 (ptr + 1, GAIA_POINT + item_dims, 1,
+			      endian_arch);
+		ptr = quantizedExportPoint (ptr + 5, pt, dims, endian_arch);
+	    }
+	  for (ln = geom->FirstLinestring; ln != NULL; ln = ln->Next)
+	    {
+		*ptr = GAIA_MARK_ENTITY;	/* ENTITY signature */
+		gaiaExport32 (ptr + 1, GAIA_QUANTIZED_LINESTRING + item_dims,
+			      1, endian_arch);
+		ptr = quantizedExportHeader (ptr + 5, &qc);
+		ptr = quantizedExportCoords (ptr, &qc, ln->Coords, ln->Points,
+					     dims);
+	    }
+	  for (pg = geom->FirstPolygon; pg != NULL; pg = pg->Next)
+	    {
+		*ptr = GAIA_MARK_ENTITY;	/* ENTITY signature */
+		gaiaExport32 (ptr + 1, GAIA_QUANTIZED_POLYGON + item_dims, 1,
+			      endian_arch);
+		ptr = quantizedExportPolygon (ptr + 5, &qc, pg, dims);
+	    }
+      }
+    *ptr++ = GAIA_MARK_END;	/* END signature */
+    *size = ptr - blob;
+    shrunk = realloc (blob, *size);
+    if (shrunk == NULL)
+	*result = blob;
+    else
+	*result = shrunk;
+    return 1;
+}
+
 GAIAGEO_DECLARE gaiaGeomCollPtr
 gaiaFromWkb (const unsigned char *blob, unsigned int size)
 {
@@ -48,6 +48,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdarg.h>
 
 #if defined(_WIN32) && !defined(__MINGW32__)
 #include "config-msvc.h"
@@ -59,36 +60,6 @@ the terms of any one of the MPL, the GPL or the LGPL.
 
 #include <spatialite/gaiageo.h>
 
-static void
-gaiaOutClean (char *buffer)
-{
-/* cleans unneeded trailing zeros */
-    int i;
-    for (i = strlen (buffer) - 1; i > 0; i--)
-      {
-	  if (buffer[i] == '0')
-	      buffer[i] = '\0';
-	  else
-	      break;
-      }
-    if (buffer[i] == '.')
-	buffer[i] = '\0';
-    if (strcmp (buffer, "-0") == 0)
-      {
-	  /* avoiding to return embarassing NEGATIVE ZEROes */
-	  strcpy (buffer, "0");
-      }
-
-    if (strcmp (buffer, "-1.#QNAN") == 0 || strcmp (buffer, "NaN") == 0
-	|| strcmp (buffer, "1.#QNAN") == 0
-	|| strcmp (buffer, "-1.#IND") == 0 || strcmp (buffer, "1.#IND") == 0)
-      {
-	  /* on Windows a NaN could be represented in "odd" ways */
-	  /* this is intended to restore a consistent behaviour  */
-	  strcpy (buffer, "nan");
-      }
-}
-
 GAIAGEO_DECLARE void
 gaiaOutBufferInitialize (gaiaOutBufferPtr buf)
 {
@@ -111,11 +82,10 @@ gaiaOutBufferReset (gaiaOutBufferPtr buf)
     buf->Error = 0;
 }
 
-GAIAGEO_DECLARE void
-gaiaAppendToOutBuffer (gaiaOutBufferPtr buf, const char *text)
+static int
+gaiaOutBufferReserve (gaiaOutBufferPtr buf, int len)
 {
-/* appending a text string */
-    int len = strlen (text);
+/* ensuring enough free space for appending len more chars */
     int free_size = buf->BufferSize - buf->WriteOffset;
     if ((len + 1) > free_size)
       {
@@ -134,7 +104,7 @@ gaiaAppendToOutBuffer (gaiaOutBufferPtr buf, const char *text)
 	  if (!new_buf)
 	    {
 		buf->Error = 1;
-		return;
+		return 0;
 	    }
 	  memcpy (new_buf, buf->Buffer, buf->WriteOffset);
 	  if (buf->Buffer)
@@ -142,81 +112,94 @@ gaiaAppendToOutBuffer (gaiaOutBufferPtr buf, const char *text)
 	  buf->Buffer = new_buf;
 	  buf->BufferSize = new_size;
       }
+    return 1;
+}
+
+GAIAGEO_DECLARE void
+gaiaAppendToOutBuffer (gaiaOutBufferPtr buf, const char *text)
+{
+/* appending a text string */
+    int len = strlen (text);
+    if (!gaiaOutBufferReserve (buf, len))
+	return;
     strcpy (buf->Buffer + buf->WriteOffset, text);
     buf->WriteOffset += len;
 }
 
+GAIAGEO_DECLARE void
+gaiaAppendDoubleToOutBuffer (gaiaOutBufferPtr buf, double value,
+			     int precision)
+{
+/* appending a formatted double (directly into the output buffer) */
+    if (!gaiaOutBufferReserve (buf, GAIA_DOUBLE_TEXT_MAX))
+	return;
+    buf->WriteOffset +=
+	gaiaFormatDouble (buf->Buffer + buf->WriteOffset, value, precision);
+}
+
+static void
+gaiaOutCoords (gaiaOutBufferPtr out_buf, int precision, const char *format,
+	       ...)
+{
+/* 
+/ appending formatted coordinates: any "%f" in format will be replaced
+/ by the next double argument and any "%s" by the next string argument;
+/ all other chars will be copied exactly as they are
+*/
+    va_list ap;
+    const char *p;
+    va_start (ap, format);
+    for (p = format; *p != '\0'; p++)
+      {
+	  if (*p == '%' && *(p + 1) == 'f')
+	    {
+		gaiaAppendDoubleToOutBuffer (out_buf, va_arg (ap, double),
+					     precision);
+		p++;
+		continue;
+	    }
+	  if (*p == '%' && *(p + 1) == 's')
+	    {
+		const char *str = va_arg (ap, const char *);
+		if (str != NULL)
+		    gaiaAppendToOutBuffer (out_buf, str);
+		p++;
+		continue;
+	    }
+	  if (!gaiaOutBufferReserve (out_buf, 1))
+	      break;
+	  out_buf->Buffer[out_buf->WriteOffset++] = *p;
+	  out_buf->Buffer[out_buf->WriteOffset] = '\0';
+      }
+    va_end (ap);
+}
+
 static void
 gaiaOutPointStrict (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats a WKT POINT [Strict 2D] */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
-    buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    if (precision < 0)
+	precision = 6;
+    gaiaOutCoords (out_buf, precision, "%f %f", point->X, point->Y);
 }
 
 static void
 gaiaOutPoint (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats a WKT POINT */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
-    if (precision < 0)
-	buf_x = sqlite3_mprintf ("%1.6f", point->X);
-    else
-	buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
     if (precision < 0)
-	buf_y = sqlite3_mprintf ("%1.6f", point->Y);
-    else
-	buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
-    buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+	precision = 6;
+    gaiaOutCoords (out_buf, precision, "%f %f", point->X, point->Y);
 }
 
 GAIAGEO_DECLARE void
 gaiaOutPointZex (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats a WKT POINTZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
-    if (precision < 0)
-	buf_x = sqlite3_mprintf ("%1.6f", point->X);
-    else
-	buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
     if (precision < 0)
-	buf_y = sqlite3_mprintf ("%1.6f", point->Y);
-    else
-	buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
-    if (precision < 0)
-	buf_z = sqlite3_mprintf ("%1.6f", point->Z);
-    else
-	buf_z = sqlite3_mprintf ("%.*f", precision, point->Z);
-    gaiaOutClean (buf_z);
-    buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_z);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_z);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+	precision = 6;
+    gaiaOutCoords (out_buf, precision, "%f %f %f", point->X, point->Y,
+		   point->Z);
 }
 
 GAIAGEO_DECLARE void
@@ -233,157 +216,49 @@ static void
 gaiaOutPointM (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats a WKT POINTM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
-    if (precision < 0)
-	buf_x = sqlite3_mprintf ("%1.6f", point->X);
-    else
-	buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
-    if (precision < 0)
-	buf_y = sqlite3_mprintf ("%1.6f", point->Y);
-    else
-	buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
     if (precision < 0)
-	buf_m = sqlite3_mprintf ("%1.6f", point->M);
-    else
-	buf_m = sqlite3_mprintf ("%.*f", precision, point->M);
-    gaiaOutClean (buf_m);
-    buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_m);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_m);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+	precision = 6;
+    gaiaOutCoords (out_buf, precision, "%f %f %f", point->X, point->Y,
+		   point->M);
 }
 
 static void
 gaiaOutPointZM (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats a WKT POINTZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
-    if (precision < 0)
-	buf_x = sqlite3_mprintf ("%1.6f", point->X);
-    else
-	buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
     if (precision < 0)
-	buf_y = sqlite3_mprintf ("%1.6f", point->Y);
-    else
-	buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
-    if (precision < 0)
-	buf_z = sqlite3_mprintf ("%1.6f", point->Z);
-    else
-	buf_z = sqlite3_mprintf ("%.*f", precision, point->Z);
-    gaiaOutClean (buf_z);
-    if (precision < 0)
-	buf_m = sqlite3_mprintf ("%1.6f", point->M);
-    else
-	buf_m = sqlite3_mprintf ("%.*f", precision, point->M);
-    gaiaOutClean (buf_m);
-    buf = sqlite3_mprintf ("%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_z);
-    sqlite3_free (buf_m);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+	precision = 6;
+    gaiaOutCoords (out_buf, precision, "%f %f %f %f", point->X, point->Y,
+		   point->Z, point->M);
 }
 
 static void
 gaiaOutEwktPoint (gaiaOutBufferPtr out_buf, gaiaPointPtr point)
 {
 /* formats an EWKT POINT */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%1.15f", point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%1.15f", point->Y);
-    gaiaOutClean (buf_y);
-    buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, 15, "%f %f", point->X, point->Y);
 }
 
 GAIAGEO_DECLARE void
 gaiaOutEwktPointZ (gaiaOutBufferPtr out_buf, gaiaPointPtr point)
 {
 /* formats an EWKT POINTZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%1.15f", point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%1.15f", point->Y);
-    gaiaOutClean (buf_y);
-    buf_z = sqlite3_mprintf ("%1.15f", point->Z);
-    gaiaOutClean (buf_z);
-    buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_z);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_z);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, 15, "%f %f %f", point->X, point->Y, point->Z);
 }
 
 static void
 gaiaOutEwktPointM (gaiaOutBufferPtr out_buf, gaiaPointPtr point)
 {
 /* formats an EWKT POINTM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%1.15f", point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%1.15f", point->Y);
-    gaiaOutClean (buf_y);
-    buf_m = sqlite3_mprintf ("%1.15f", point->M);
-    gaiaOutClean (buf_m);
-    buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_m);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_m);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, 15, "%f %f %f", point->X, point->Y, point->M);
 }
 
 static void
 gaiaOutEwktPointZM (gaiaOutBufferPtr out_buf, gaiaPointPtr point)
 {
 /* formats an EWKT POINTZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%1.15f", point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%1.15f", point->Y);
-    gaiaOutClean (buf_y);
-    buf_z = sqlite3_mprintf ("%1.15f", point->Z);
-    gaiaOutClean (buf_z);
-    buf_m = sqlite3_mprintf ("%1.15f", point->M);
-    gaiaOutClean (buf_m);
-    buf = sqlite3_mprintf ("%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    sqlite3_free (buf_z);
-    sqlite3_free (buf_m);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, 15, "%f %f %f %f", point->X, point->Y, point->Z,
+		   point->M);
 }
 
 static void
@@ -391,14 +266,13 @@ gaiaOutLinestringStrict (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 			 int precision)
 {
 /* formats a WKT LINESTRING [Strict 2D] */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     double x;
     double y;
     double z;
     double m;
     int iv;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  if (line->DimensionModel == GAIA_XY_Z)
@@ -417,18 +291,10 @@ gaiaOutLinestringStrict (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 	    {
 		gaiaGetPoint (line->Coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, ",%f %f", x, y);
 	  else
-	      buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f", x, y);
       }
 }
 
@@ -437,33 +303,18 @@ gaiaOutLinestring (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 		   int precision)
 {
 /* formats a WKT LINESTRING */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     double x;
     double y;
     int iv;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPoint (line->Coords, iv, &x, &y);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (", %s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, ", %f %f", x, y);
 	  else
-	      buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f", x, y);
       }
 }
 
@@ -472,41 +323,19 @@ gaiaOutLinestringZex (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 		      int precision)
 {
 /* formats a WKT LINESTRINGZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
     double x;
     double y;
     double z;
     int iv;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYZ (line->Coords, iv, &x, &y, &z);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_z = sqlite3_mprintf ("%1.6f", z);
-	  else
-	      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-	  gaiaOutClean (buf_z);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, z);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_z);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f %f", x, y, z);
       }
 }
 
@@ -525,41 +354,19 @@ gaiaOutLinestringM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 		    int precision)
 {
 /* formats a WKT LINESTRINGM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
     double x;
     double y;
     double m;
     int iv;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYM (line->Coords, iv, &x, &y, &m);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_m = sqlite3_mprintf ("%1.6f", m);
-	  else
-	      buf_m = sqlite3_mprintf ("%.*f", precision, m);
-	  gaiaOutClean (buf_m);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, m);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f %f", x, y, m);
       }
 }
 
@@ -568,50 +375,20 @@ gaiaOutLinestringZM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line,
 		     int precision)
 {
 /* formats a WKT LINESTRINGZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
     double x;
     double y;
     double z;
     double m;
     int iv;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYZM (line->Coords, iv, &x, &y, &z, &m);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_z = sqlite3_mprintf ("%1.6f", z);
-	  else
-	      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-	  gaiaOutClean (buf_z);
-	  if (precision < 0)
-	      buf_m = sqlite3_mprintf ("%1.6f", m);
-	  else
-	      buf_m = sqlite3_mprintf ("%.*f", precision, m);
-	  gaiaOutClean (buf_m);
 	  if (iv > 0)
-	      buf =
-		  sqlite3_mprintf (", %s %s %s %s", buf_x, buf_y, buf_z, buf_m);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f %f", x, y, z, m);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f %f %f", x, y, z, m);
       }
 }
 
@@ -619,27 +396,16 @@ static void
 gaiaOutEwktLinestring (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
 {
 /* formats an EWKT LINESTRING */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     double x;
     double y;
     int iv;
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPoint (line->Coords, iv, &x, &y);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, 15, ",%f %f", x, y);
 	  else
-	      buf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, "%f %f", x, y);
       }
 }
 
@@ -647,10 +413,6 @@ GAIAGEO_DECLARE void
 gaiaOutEwktLinestringZ (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
 {
 /* formats an EWKT LINESTRINGZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
     double x;
     double y;
     double z;
@@ -658,21 +420,10 @@ gaiaOutEwktLinestringZ (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYZ (line->Coords, iv, &x, &y, &z);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_z = sqlite3_mprintf ("%1.15f", z);
-	  gaiaOutClean (buf_z);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, z);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_z);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, "%f %f %f", x, y, z);
       }
 }
 
@@ -680,10 +431,6 @@ static void
 gaiaOutEwktLinestringM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
 {
 /* formats an EWKT LINESTRINGM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
     double x;
     double y;
     double m;
@@ -691,21 +438,10 @@ gaiaOutEwktLinestringM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYM (line->Coords, iv, &x, &y, &m);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_m = sqlite3_mprintf ("%1.15f", m);
-	  gaiaOutClean (buf_m);
 	  if (iv > 0)
-	      buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, m);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, "%f %f %f", x, y, m);
       }
 }
 
@@ -713,11 +449,6 @@ static void
 gaiaOutEwktLinestringZM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
 {
 /* formats an EWKT LINESTRINGZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
     double x;
     double y;
     double z;
@@ -726,25 +457,10 @@ gaiaOutEwktLinestringZM (gaiaOutBufferPtr out_buf, gaiaLinestringPtr line)
     for (iv = 0; iv < line->Points; iv++)
       {
 	  gaiaGetPointXYZM (line->Coords, iv, &x, &y, &z, &m);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_z = sqlite3_mprintf ("%1.15f", z);
-	  gaiaOutClean (buf_z);
-	  buf_m = sqlite3_mprintf ("%1.15f", m);
-	  gaiaOutClean (buf_m);
 	  if (iv > 0)
-	      buf =
-		  sqlite3_mprintf (",%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f %f", x, y, z, m);
 	  else
-	      buf = sqlite3_mprintf ("%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, "%f %f %f %f", x, y, z, m);
       }
 }
 
@@ -753,9 +469,6 @@ gaiaOutPolygonStrict (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
 		      int precision)
 {
 /* formats a WKT POLYGON [Strict 2D] */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -763,6 +476,8 @@ gaiaOutPolygonStrict (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
     double z;
     double m;
     gaiaRingPtr ring = polyg->Exterior;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  if (ring->DimensionModel == GAIA_XY_Z)
@@ -781,20 +496,12 @@ gaiaOutPolygonStrict (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
 	    {
 		gaiaGetPoint (ring->Coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, "(%f %f", x, y);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (",%s %s)", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, ",%f %f)", x, y);
 	  else
-	      buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, ",%f %f", x, y);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -817,20 +524,12 @@ gaiaOutPolygonStrict (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
 		  {
 		      gaiaGetPoint (ring->Coords, iv, &x, &y);
 		  }
-		buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (",(%s %s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, ",(%f %f", x, y);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (",%s %s)", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, ",%f %f)", x, y);
 		else
-		    buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, precision, ",%f %f", x, y);
 	    }
       }
 }
@@ -839,37 +538,22 @@ static void
 gaiaOutPolygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 {
 /* formats a WKT POLYGON */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     int ib;
     int iv;
     double x;
     double y;
     gaiaRingPtr ring = polyg->Exterior;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPoint (ring->Coords, iv, &x, &y);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, "(%f %f", x, y);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (", %s %s)", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, precision, ", %f %f)", x, y);
 	  else
-	      buf = sqlite3_mprintf (", %s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, ", %f %f", x, y);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -877,26 +561,12 @@ gaiaOutPolygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPoint (ring->Coords, iv, &x, &y);
-		if (precision < 0)
-		    buf_x = sqlite3_mprintf ("%1.6f", x);
-		else
-		    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		if (precision < 0)
-		    buf_y = sqlite3_mprintf ("%1.6f", y);
-		else
-		    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (", (%s %s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, ", (%f %f", x, y);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (", %s %s)", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, ", %f %f)", x, y);
 		else
-		    buf = sqlite3_mprintf (", %s %s", buf_x, buf_y);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, precision, ", %f %f", x, y);
 	    }
       }
 }
@@ -906,45 +576,23 @@ gaiaOutPolygonZex (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
 		   int precision)
 {
 /* formats a WKT POLYGONZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
     int ib;
     int iv;
     double x;
     double y;
     double z;
     gaiaRingPtr ring = polyg->Exterior;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYZ (ring->Coords, iv, &x, &y, &z);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_z = sqlite3_mprintf ("%1.6f", z);
-	  else
-	      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-	  gaiaOutClean (buf_z);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s %s", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, precision, "(%f %f %f", x, y, z);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (", %s %s %s)", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f)", x, y, z);
 	  else
-	      buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_z);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, z);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -952,32 +600,12 @@ gaiaOutPolygonZex (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg,
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYZ (ring->Coords, iv, &x, &y, &z);
-		if (precision < 0)
-		    buf_x = sqlite3_mprintf ("%1.6f", x);
-		else
-		    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		if (precision < 0)
-		    buf_y = sqlite3_mprintf ("%1.6f", y);
-		else
-		    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
-		if (precision < 0)
-		    buf_z = sqlite3_mprintf ("%1.6f", z);
-		else
-		    buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		gaiaOutClean (buf_z);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (", (%s %s %s", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, precision, ", (%f %f %f", x, y, z);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (", %s %s %s)", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f)", x, y, z);
 		else
-		    buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_z);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, z);
 	    }
       }
 }
@@ -996,45 +624,23 @@ static void
 gaiaOutPolygonM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 {
 /* formats a WKT POLYGONM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
     int ib;
     int iv;
     double x;
     double y;
     double m;
     gaiaRingPtr ring = polyg->Exterior;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYM (ring->Coords, iv, &x, &y, &m);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_m = sqlite3_mprintf ("%1.6f", m);
-	  else
-	      buf_m = sqlite3_mprintf ("%.*f", precision, m);
-	  gaiaOutClean (buf_m);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s %s", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, precision, "(%f %f %f", x, y, m);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (", %s %s %s)", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f)", x, y, m);
 	  else
-	      buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, m);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1042,32 +648,12 @@ gaiaOutPolygonM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYM (ring->Coords, iv, &x, &y, &m);
-		if (precision < 0)
-		    buf_x = sqlite3_mprintf ("%1.6f", x);
-		else
-		    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		if (precision < 0)
-		    buf_y = sqlite3_mprintf ("%1.6f", y);
-		else
-		    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
-		if (precision < 0)
-		    buf_m = sqlite3_mprintf ("%1.6f", m);
-		else
-		    buf_m = sqlite3_mprintf ("%.*f", precision, m);
-		gaiaOutClean (buf_m);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (", (%s %s %s", buf_x, buf_y, buf_m);
+		    gaiaOutCoords (out_buf, precision, ", (%f %f %f", x, y, m);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (", %s %s %s)", buf_x, buf_y, buf_m);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f)", x, y, m);
 		else
-		    buf = sqlite3_mprintf (", %s %s %s", buf_x, buf_y, buf_m);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_m);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f", x, y, m);
 	    }
       }
 }
@@ -1076,11 +662,6 @@ static void
 gaiaOutPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 {
 /* formats a WKT POLYGONZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -1088,45 +669,17 @@ gaiaOutPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
     double z;
     double m;
     gaiaRingPtr ring = polyg->Exterior;
+    if (precision < 0)
+	precision = 6;
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYZM (ring->Coords, iv, &x, &y, &z, &m);
-	  if (precision < 0)
-	      buf_x = sqlite3_mprintf ("%1.6f", x);
-	  else
-	      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  if (precision < 0)
-	      buf_y = sqlite3_mprintf ("%1.6f", y);
-	  else
-	      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
-	  if (precision < 0)
-	      buf_z = sqlite3_mprintf ("%1.6f", z);
-	  else
-	      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-	  gaiaOutClean (buf_z);
-	  if (precision < 0)
-	      buf_m = sqlite3_mprintf ("%1.6f", m);
-	  else
-	      buf_m = sqlite3_mprintf ("%.*f", precision, m);
-	  gaiaOutClean (buf_m);
 	  if (iv == 0)
-	      buf =
-		  sqlite3_mprintf ("(%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
+	      gaiaOutCoords (out_buf, precision, "(%f %f %f %f", x, y, z, m);
 	  else if (iv == (ring->Points - 1))
-	      buf =
-		  sqlite3_mprintf (", %s %s %s %s)", buf_x, buf_y, buf_z,
-				   buf_m);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f %f)", x, y, z, m);
 	  else
-	      buf =
-		  sqlite3_mprintf (", %s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, ", %f %f %f %f", x, y, z, m);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1134,44 +687,15 @@ gaiaOutPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg, int precision)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYZM (ring->Coords, iv, &x, &y, &z, &m);
-		if (precision < 0)
-		    buf_x = sqlite3_mprintf ("%1.6f", x);
-		else
-		    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		if (precision < 0)
-		    buf_y = sqlite3_mprintf ("%1.6f", y);
-		else
-		    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
-		if (precision < 0)
-		    buf_z = sqlite3_mprintf ("%1.6f", z);
-		else
-		    buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		gaiaOutClean (buf_z);
-		if (precision < 0)
-		    buf_m = sqlite3_mprintf ("%1.6f", m);
-		else
-		    buf_m = sqlite3_mprintf ("%.*f", precision, m);
-		gaiaOutClean (buf_m);
 		if (iv == 0)
-		    buf =
-			sqlite3_mprintf (", (%s %s %s %s", buf_x, buf_y, buf_z,
-					 buf_m);
+		    gaiaOutCoords (out_buf, precision, ", (%f %f %f %f", x, y,
+				   z, m);
 		else if (iv == (ring->Points - 1))
-		    buf =
-			sqlite3_mprintf (", %s %s %s %s)", buf_x, buf_y, buf_z,
-					 buf_m);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f %f)", x, y,
+				   z, m);
 		else
-		    buf =
-			sqlite3_mprintf (", %s %s %s %s", buf_x, buf_y, buf_z,
-					 buf_m);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
-		sqlite3_free (buf_m);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, precision, ", %f %f %f %f", x, y,
+				   z, m);
 	    }
       }
 }
@@ -1180,9 +704,6 @@ static void
 gaiaOutEwktPolygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 {
 /* formats an EWKT POLYGON */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -1191,20 +712,12 @@ gaiaOutEwktPolygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPoint (ring->Coords, iv, &x, &y);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, 15, "(%f %f", x, y);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (",%s %s)", buf_x, buf_y);
+	      gaiaOutCoords (out_buf, 15, ",%f %f)", x, y);
 	  else
-	      buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, ",%f %f", x, y);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1212,20 +725,12 @@ gaiaOutEwktPolygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPoint (ring->Coords, iv, &x, &y);
-		buf_x = sqlite3_mprintf ("%1.15f", x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%1.15f", y);
-		gaiaOutClean (buf_y);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (",(%s %s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, 15, ",(%f %f", x, y);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (",%s %s)", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, 15, ",%f %f)", x, y);
 		else
-		    buf = sqlite3_mprintf (",%s %s", buf_x, buf_y);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, 15, ",%f %f", x, y);
 	    }
       }
 }
@@ -1234,10 +739,6 @@ GAIAGEO_DECLARE void
 gaiaOutEwktPolygonZ (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 {
 /* formats an EWKT POLYGONZ */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -1247,23 +748,12 @@ gaiaOutEwktPolygonZ (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYZ (ring->Coords, iv, &x, &y, &z);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_z = sqlite3_mprintf ("%1.15f", z);
-	  gaiaOutClean (buf_z);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s %s", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, 15, "(%f %f %f", x, y, z);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (",%s %s %s)", buf_x, buf_y, buf_z);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f)", x, y, z);
 	  else
-	      buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_z);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, z);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1271,23 +761,12 @@ gaiaOutEwktPolygonZ (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYZ (ring->Coords, iv, &x, &y, &z);
-		buf_x = sqlite3_mprintf ("%1.15f", x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%1.15f", y);
-		gaiaOutClean (buf_y);
-		buf_z = sqlite3_mprintf ("%1.15f", z);
-		gaiaOutClean (buf_z);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (",(%s %s %s", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, 15, ",(%f %f %f", x, y, z);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (",%s %s %s)", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f)", x, y, z);
 		else
-		    buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_z);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, z);
 	    }
       }
 }
@@ -1296,10 +775,6 @@ static void
 gaiaOutEwktPolygonM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 {
 /* formats an EWKT POLYGONM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -1309,23 +784,12 @@ gaiaOutEwktPolygonM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYM (ring->Coords, iv, &x, &y, &m);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_m = sqlite3_mprintf ("%1.15f", m);
-	  gaiaOutClean (buf_m);
 	  if (iv == 0)
-	      buf = sqlite3_mprintf ("(%s %s %s", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, 15, "(%f %f %f", x, y, m);
 	  else if (iv == (ring->Points - 1))
-	      buf = sqlite3_mprintf (",%s %s %s)", buf_x, buf_y, buf_m);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f)", x, y, m);
 	  else
-	      buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, m);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1333,23 +797,12 @@ gaiaOutEwktPolygonM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYM (ring->Coords, iv, &x, &y, &m);
-		buf_x = sqlite3_mprintf ("%1.15f", x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%1.15f", y);
-		gaiaOutClean (buf_y);
-		buf_m = sqlite3_mprintf ("%1.15f", m);
-		gaiaOutClean (buf_m);
 		if (iv == 0)
-		    buf = sqlite3_mprintf (",(%s %s %s", buf_x, buf_y, buf_m);
+		    gaiaOutCoords (out_buf, 15, ",(%f %f %f", x, y, m);
 		else if (iv == (ring->Points - 1))
-		    buf = sqlite3_mprintf (",%s %s %s)", buf_x, buf_y, buf_m);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f)", x, y, m);
 		else
-		    buf = sqlite3_mprintf (",%s %s %s", buf_x, buf_y, buf_m);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_m);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f", x, y, m);
 	    }
       }
 }
@@ -1358,11 +811,6 @@ static void
 gaiaOutEwktPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 {
 /* formats an EWKT POLYGONZM */
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
-    char *buf_m;
-    char *buf;
     int ib;
     int iv;
     double x;
@@ -1373,29 +821,12 @@ gaiaOutEwktPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
     for (iv = 0; iv < ring->Points; iv++)
       {
 	  gaiaGetPointXYZM (ring->Coords, iv, &x, &y, &z, &m);
-	  buf_x = sqlite3_mprintf ("%1.15f", x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%1.15f", y);
-	  gaiaOutClean (buf_y);
-	  buf_z = sqlite3_mprintf ("%1.15f", z);
-	  gaiaOutClean (buf_z);
-	  buf_m = sqlite3_mprintf ("%1.15f", m);
-	  gaiaOutClean (buf_m);
 	  if (iv == 0)
-	      buf =
-		  sqlite3_mprintf ("(%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
+	      gaiaOutCoords (out_buf, 15, "(%f %f %f %f", x, y, z, m);
 	  else if (iv == (ring->Points - 1))
-	      buf =
-		  sqlite3_mprintf (",%s %s %s %s)", buf_x, buf_y, buf_z, buf_m);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f %f)", x, y, z, m);
 	  else
-	      buf =
-		  sqlite3_mprintf (",%s %s %s %s", buf_x, buf_y, buf_z, buf_m);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  sqlite3_free (buf_z);
-	  sqlite3_free (buf_m);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, 15, ",%f %f %f %f", x, y, z, m);
       }
     for (ib = 0; ib < polyg->NumInteriors; ib++)
       {
@@ -1403,32 +834,12 @@ gaiaOutEwktPolygonZM (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polyg)
 	  for (iv = 0; iv < ring->Points; iv++)
 	    {
 		gaiaGetPointXYZM (ring->Coords, iv, &x, &y, &z, &m);
-		buf_x = sqlite3_mprintf ("%1.15f", x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%1.15f", y);
-		gaiaOutClean (buf_y);
-		buf_z = sqlite3_mprintf ("%1.15f", z);
-		gaiaOutClean (buf_z);
-		buf_m = sqlite3_mprintf ("%1.15f", m);
-		gaiaOutClean (buf_m);
 		if (iv == 0)
-		    buf =
-			sqlite3_mprintf (",(%s %s %s %s", buf_x, buf_y, buf_z,
-					 buf_m);
+		    gaiaOutCoords (out_buf, 15, ",(%f %f %f %f", x, y, z, m);
 		else if (iv == (ring->Points - 1))
-		    buf =
-			sqlite3_mprintf (",%s %s %s %s)", buf_x, buf_y, buf_z,
-					 buf_m);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f %f)", x, y, z, m);
 		else
-		    buf =
-			sqlite3_mprintf (",%s %s %s %s", buf_x, buf_y, buf_z,
-					 buf_m);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
-		sqlite3_free (buf_m);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
+		    gaiaOutCoords (out_buf, 15, ",%f %f %f %f", x, y, z, m);
 	    }
       }
 }
@@ -2355,36 +1766,16 @@ static void
 SvgCoords (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats POINT as SVG-attributes x,y */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%.*f", precision, point->Y * -1);
-    gaiaOutClean (buf_y);
-    buf = sqlite3_mprintf ("x=\"%s\" y=\"%s\"", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, precision, "x=\"%f\" y=\"%f\"", point->X,
+		   point->Y * -1);
 }
 
 static void
 SvgCircle (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats POINT as SVG-attributes cx,cy */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
-    buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%.*f", precision, point->Y * -1);
-    gaiaOutClean (buf_y);
-    buf = sqlite3_mprintf ("cx=\"%s\" cy=\"%s\"", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+    gaiaOutCoords (out_buf, precision, "cx=\"%f\" cy=\"%f\"", point->X,
+		   point->Y * -1);
 }
 
 static void
@@ -2392,9 +1783,6 @@ SvgPathRelative (gaiaOutBufferPtr out_buf, int dims, int points, double *coords,
 		 int precision, int closePath)
 {
 /* formats LINESTRING as SVG-path d-attribute with relative coordinate moves */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     double x;
     double y;
     double z;
@@ -2420,23 +1808,16 @@ SvgPathRelative (gaiaOutBufferPtr out_buf, int dims, int points, double *coords,
 	    {
 		gaiaGetPoint (coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x - lastX);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, (y - lastY) * -1);
-	  gaiaOutClean (buf_y);
-	  if (iv == 0)
-	      buf = sqlite3_mprintf ("M %s %s l ", buf_x, buf_y);
-	  else
-	      buf = sqlite3_mprintf ("%s %s ", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  lastX = x;
-	  lastY = y;
 	  if (iv == points - 1 && closePath == 1)
 	      gaiaAppendToOutBuffer (out_buf, "z ");
+	  else if (iv == 0)
+	      gaiaOutCoords (out_buf, precision, "M %f %f l ", x - lastX,
+			     (y - lastY) * -1);
 	  else
-	      gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f ", x - lastX,
+			     (y - lastY) * -1);
+	  lastX = x;
+	  lastY = y;
       }
 }
 
@@ -2445,9 +1826,6 @@ SvgPathAbsolute (gaiaOutBufferPtr out_buf, int dims, int points, double *coords,
 		 int precision, int closePath)
 {
 /* formats LINESTRING as SVG-path d-attribute with relative coordinate moves */
-    char *buf_x;
-    char *buf_y;
-    char *buf;
     double x;
     double y;
     double z;
@@ -2471,21 +1849,12 @@ SvgPathAbsolute (gaiaOutBufferPtr out_buf, int dims, int points, double *coords,
 	    {
 		gaiaGetPoint (coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, y * -1);
-	  gaiaOutClean (buf_y);
-	  if (iv == 0)
-	      buf = sqlite3_mprintf ("M %s %s L ", buf_x, buf_y);
-	  else
-	      buf = sqlite3_mprintf ("%s %s ", buf_x, buf_y);
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
 	  if (iv == points - 1 && closePath == 1)
 	      gaiaAppendToOutBuffer (out_buf, "z ");
+	  else if (iv == 0)
+	      gaiaOutCoords (out_buf, precision, "M %f %f L ", x, y * -1);
 	  else
-	      gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
+	      gaiaOutCoords (out_buf, precision, "%f %f ", x, y * -1);
       }
 }
 
@@ -2816,33 +2185,19 @@ static void
 out_kml_point (gaiaOutBufferPtr out_buf, gaiaPointPtr point, int precision)
 {
 /* formats POINT as KML [x,y] */
-    char *buf_x = NULL;
-    char *buf_y = NULL;
-    char *buf_z = NULL;
-    char *buf = NULL;
-    buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-    gaiaOutClean (buf_x);
-    buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-    gaiaOutClean (buf_y);
     if (point->DimensionModel == GAIA_XY_Z
 	|| point->DimensionModel == GAIA_XY_Z_M)
       {
-	  buf_z = sqlite3_mprintf ("%.*f", precision, point->Z);
-	  gaiaOutClean (buf_z);
       }
     gaiaAppendToOutBuffer (out_buf, "<Point><coordinates>");
     if (point->DimensionModel == GAIA_XY_Z
 	|| point->DimensionModel == GAIA_XY_Z_M)
       {
-	  buf = sqlite3_mprintf ("%s,%s,%s", buf_x, buf_y, buf_z);
-	  sqlite3_free (buf_z);
+	  gaiaOutCoords (out_buf, precision, "%f,%f,%f", point->X, point->Y,
+			 point->Z);
       }
     else
-	buf = sqlite3_mprintf ("%s,%s", buf_x, buf_y);
-    sqlite3_free (buf_x);
-    sqlite3_free (buf_y);
-    gaiaAppendToOutBuffer (out_buf, buf);
-    sqlite3_free (buf);
+	gaiaOutCoords (out_buf, precision, "%f,%f", point->X, point->Y);
     gaiaAppendToOutBuffer (out_buf, "</coordinates></Point>");
 }
 
@@ -2851,10 +2206,6 @@ out_kml_linestring (gaiaOutBuffer * out_buf, int dims, int points,
 		    double *coords, int precision)
 {
 /* formats LINESTRING as KML [x,y] */
-    char *buf_x = NULL;
-    char *buf_y = NULL;
-    char *buf_z = NULL;
-    char *buf = NULL;
     int iv;
     double x = 0.0;
     double y = 0.0;
@@ -2880,31 +2231,20 @@ out_kml_linestring (gaiaOutBuffer * out_buf, int dims, int points,
 	    {
 		gaiaGetPoint (coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (dims == GAIA_XY_Z || dims == GAIA_XY_Z_M)
 	    {
-		buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		gaiaOutClean (buf_z);
 		if (iv == 0)
-		    buf = sqlite3_mprintf ("%s,%s,%s", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, precision, "%f,%f,%f", x, y, z);
 		else
-		    buf = sqlite3_mprintf (" %s,%s,%s", buf_x, buf_y, buf_z);
-		sqlite3_free (buf_z);
+		    gaiaOutCoords (out_buf, precision, " %f,%f,%f", x, y, z);
 	    }
 	  else
 	    {
 		if (iv == 0)
-		    buf = sqlite3_mprintf ("%s,%s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, "%f,%f", x, y);
 		else
-		    buf = sqlite3_mprintf (" %s,%s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, " %f,%f", x, y);
 	    }
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
       }
     gaiaAppendToOutBuffer (out_buf, "</coordinates></LineString>");
 }
@@ -2914,10 +2254,6 @@ out_kml_polygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polygon,
 		 int precision)
 {
 /* formats POLYGON as KML [x,y] */
-    char *buf_x = NULL;
-    char *buf_y = NULL;
-    char *buf_z = NULL;
-    char *buf = NULL;
     gaiaRingPtr ring;
     int iv;
     int ib;
@@ -2948,32 +2284,21 @@ out_kml_polygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polygon,
 	    {
 		gaiaGetPoint (ring->Coords, iv, &x, &y);
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, x);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, y);
-	  gaiaOutClean (buf_y);
 	  if (ring->DimensionModel == GAIA_XY_Z
 	      || ring->DimensionModel == GAIA_XY_Z_M)
 	    {
-		buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		gaiaOutClean (buf_z);
 		if (iv == 0)
-		    buf = sqlite3_mprintf ("%s,%s,%s", buf_x, buf_y, buf_z);
+		    gaiaOutCoords (out_buf, precision, "%f,%f,%f", x, y, z);
 		else
-		    buf = sqlite3_mprintf (" %s,%s,%s", buf_x, buf_y, buf_z);
-		sqlite3_free (buf_z);
+		    gaiaOutCoords (out_buf, precision, " %f,%f,%f", x, y, z);
 	    }
 	  else
 	    {
 		if (iv == 0)
-		    buf = sqlite3_mprintf ("%s,%s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, "%f,%f", x, y);
 		else
-		    buf = sqlite3_mprintf (" %s,%s", buf_x, buf_y);
+		    gaiaOutCoords (out_buf, precision, " %f,%f", x, y);
 	    }
-	  sqlite3_free (buf_x);
-	  sqlite3_free (buf_y);
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
       }
     gaiaAppendToOutBuffer (out_buf,
 			   "</coordinates></LinearRing></outerBoundaryIs>");
@@ -3002,35 +2327,23 @@ out_kml_polygon (gaiaOutBufferPtr out_buf, gaiaPolygonPtr polygon,
 		  {
 		      gaiaGetPoint (ring->Coords, iv, &x, &y);
 		  }
-		buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		gaiaOutClean (buf_y);
 		if (ring->DimensionModel == GAIA_XY_Z
 		    || ring->DimensionModel == GAIA_XY_Z_M)
 		  {
-		      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		      gaiaOutClean (buf_z);
 		      if (iv == 0)
-			  buf =
-			      sqlite3_mprintf ("%s,%s,%s", buf_x, buf_y, buf_z);
+			  gaiaOutCoords (out_buf, precision, "%f,%f,%f", x, y,
+					 z);
 		      else
-			  buf =
-			      sqlite3_mprintf (" %s,%s,%s", buf_x, buf_y,
-					       buf_z);
-		      sqlite3_free (buf_z);
+			  gaiaOutCoords (out_buf, precision, " %f,%f,%f", x, y,
+					 z);
 		  }
 		else
 		  {
 		      if (iv == 0)
-			  buf = sqlite3_mprintf ("%s,%s", buf_x, buf_y);
+			  gaiaOutCoords (out_buf, precision, "%f,%f", x, y);
 		      else
-			  buf = sqlite3_mprintf (" %s,%s", buf_x, buf_y);
+			  gaiaOutCoords (out_buf, precision, " %f,%f", x, y);
 		  }
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
 	    }
 	  gaiaAppendToOutBuffer (out_buf,
 				 "</coordinates></LinearRing></innerBoundaryIs>");
@@ -3237,10 +2550,6 @@ gaiaOutGml (gaiaOutBufferPtr out_buf, int version, int precision,
     int is_multi = 1;
     int is_coll = 0;
     char buf[2048];
-    char *xbuf;
-    char *buf_x;
-    char *buf_y;
-    char *buf_z;
     if (!geom)
 	return;
     if (precision > 18)
@@ -3338,47 +2647,33 @@ gaiaOutGml (gaiaOutBufferPtr out_buf, int version, int precision,
 	  else
 	      strcat (buf, "<gml:coordinates>");
 	  gaiaAppendToOutBuffer (out_buf, buf);
-	  buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-	  gaiaOutClean (buf_y);
 	  if (point->DimensionModel == GAIA_XY_Z
 	      || point->DimensionModel == GAIA_XY_Z_M)
 	    {
-		buf_z = sqlite3_mprintf ("%.*f", precision, point->Z);
-		gaiaOutClean (buf_z);
 		if (version == 3)
 		  {
-		      xbuf = sqlite3_mprintf ("%s %s %s", buf_x, buf_y, buf_z);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
-		      sqlite3_free (buf_z);
+		      gaiaOutCoords (out_buf, precision, "%f %f %f", point->X,
+				     point->Y, point->Z);
 		  }
 		else
 		  {
-		      xbuf = sqlite3_mprintf ("%s,%s,%s", buf_x, buf_y, buf_z);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
-		      sqlite3_free (buf_z);
+		      gaiaOutCoords (out_buf, precision, "%f,%f,%f", point->X,
+				     point->Y, point->Z);
 		  }
 	    }
 	  else
 	    {
 		if (version == 3)
 		  {
-		      xbuf = sqlite3_mprintf ("%s %s", buf_x, buf_y);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
+		      gaiaOutCoords (out_buf, precision, "%f %f", point->X,
+				     point->Y);
 		  }
 		else
 		  {
-		      xbuf = sqlite3_mprintf ("%s,%s", buf_x, buf_y);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
+		      gaiaOutCoords (out_buf, precision, "%f,%f", point->X,
+				     point->Y);
 		  }
 	    }
-	  gaiaAppendToOutBuffer (out_buf, xbuf);
-	  sqlite3_free (xbuf);
 	  if (version == 3)
 	      strcpy (buf, "</gml:pos>");
 	  else
@@ -3484,54 +2779,30 @@ gaiaOutGml (gaiaOutBufferPtr out_buf, int version, int precision,
 		    strcpy (buf, " ");
 		if (has_z)
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
-		      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		      gaiaOutClean (buf_z);
 		      if (version == 3)
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s %s %s", buf, buf_x,
-						 buf_y, buf_z);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
-			    sqlite3_free (buf_z);
+			    gaiaOutCoords (out_buf, precision, "%s%f %f %f",
+					   buf, x, y, z);
 			}
 		      else
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s,%s,%s", buf, buf_x,
-						 buf_y, buf_z);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
-			    sqlite3_free (buf_z);
+			    gaiaOutCoords (out_buf, precision, "%s%f,%f,%f",
+					   buf, x, y, z);
 			}
 		  }
 		else
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
 		      if (version == 3)
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s %s", buf, buf_x, buf_y);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
+			    gaiaOutCoords (out_buf, precision, "%s%f %f", buf,
+					   x, y);
 			}
 		      else
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s,%s", buf, buf_x, buf_y);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
+			    gaiaOutCoords (out_buf, precision, "%s%f,%f", buf,
+					   x, y);
 			}
 		  }
-		gaiaAppendToOutBuffer (out_buf, xbuf);
-		sqlite3_free (xbuf);
 	    }
 	  if (is_multi)
 	    {
@@ -3662,54 +2933,30 @@ gaiaOutGml (gaiaOutBufferPtr out_buf, int version, int precision,
 		    strcpy (buf, " ");
 		if (has_z)
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
-		      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		      gaiaOutClean (buf_z);
 		      if (version == 3)
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s %s %s", buf, buf_x,
-						 buf_y, buf_z);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
-			    sqlite3_free (buf_z);
+			    gaiaOutCoords (out_buf, precision, "%s%f %f %f",
+					   buf, x, y, z);
 			}
 		      else
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s,%s,%s", buf, buf_x,
-						 buf_y, buf_z);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
-			    sqlite3_free (buf_z);
+			    gaiaOutCoords (out_buf, precision, "%s%f,%f,%f",
+					   buf, x, y, z);
 			}
 		  }
 		else
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
 		      if (version == 3)
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s %s", buf, buf_x, buf_y);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
+			    gaiaOutCoords (out_buf, precision, "%s%f %f", buf,
+					   x, y);
 			}
 		      else
 			{
-			    xbuf =
-				sqlite3_mprintf ("%s%s,%s", buf, buf_x, buf_y);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
+			    gaiaOutCoords (out_buf, precision, "%s%f,%f", buf,
+					   x, y);
 			}
 		  }
-		gaiaAppendToOutBuffer (out_buf, xbuf);
-		sqlite3_free (xbuf);
 	    }
 	  /* closing the Exterior Ring */
 	  if (version == 3)
@@ -3775,56 +3022,30 @@ gaiaOutGml (gaiaOutBufferPtr out_buf, int version, int precision,
 			  strcpy (buf, " ");
 		      if (has_z)
 			{
-			    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-			    gaiaOutClean (buf_x);
-			    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-			    gaiaOutClean (buf_y);
-			    buf_z = sqlite3_mprintf ("%.*f", precision, z);
-			    gaiaOutClean (buf_z);
 			    if (version == 3)
 			      {
-				  xbuf =
-				      sqlite3_mprintf ("%s%s %s %s", buf, buf_x,
-						       buf_y, buf_z);
-				  sqlite3_free (buf_x);
-				  sqlite3_free (buf_y);
-				  sqlite3_free (buf_z);
+				  gaiaOutCoords (out_buf, precision,
+						 "%s%f %f %f", buf, x, y, z);
 			      }
 			    else
 			      {
-				  xbuf =
-				      sqlite3_mprintf ("%s%s,%s,%s", buf, buf_x,
-						       buf_y, buf_z);
-				  sqlite3_free (buf_x);
-				  sqlite3_free (buf_y);
-				  sqlite3_free (buf_z);
+				  gaiaOutCoords (out_buf, precision,
+						 "%s%f,%f,%f", buf, x, y, z);
 			      }
 			}
 		      else
 			{
-			    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-			    gaiaOutClean (buf_x);
-			    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-			    gaiaOutClean (buf_y);
 			    if (version == 3)
 			      {
-				  xbuf =
-				      sqlite3_mprintf ("%s%s %s", buf, buf_x,
-						       buf_y);
-				  sqlite3_free (buf_x);
-				  sqlite3_free (buf_y);
+				  gaiaOutCoords (out_buf, precision, "%s%f %f",
+						 buf, x, y);
 			      }
 			    else
 			      {
-				  xbuf =
-				      sqlite3_mprintf ("%s%s,%s", buf, buf_x,
-						       buf_y);
-				  sqlite3_free (buf_x);
-				  sqlite3_free (buf_y);
+				  gaiaOutCoords (out_buf, precision, "%s%f,%f",
+						 buf, x, y);
 			      }
 			}
-		      gaiaAppendToOutBuffer (out_buf, xbuf);
-		      sqlite3_free (xbuf);
 		  }
 		/* closing the Interior Ring */
 		if (version == 3)
@@ -3917,12 +3138,9 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
     int is_multi = 0;
     int multi_count = 0;
     char *bbox;
+    gaiaOutBuffer bbox_buf;
     char crs[2048];
     char *buf;
-    char *buf_x;
-    char *buf_y;
-    char *buf_m;
-    char *buf_z = NULL;
     char endJson[16];
     if (!geom)
 	return;
@@ -3954,21 +3172,10 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 	    {
 		/* including BBOX */
 		gaiaMbrGeometry (geom);
-		buf_x = sqlite3_mprintf ("%.*f", precision, geom->MinX);
-		gaiaOutClean (buf_x);
-		buf_y = sqlite3_mprintf ("%.*f", precision, geom->MinY);
-		gaiaOutClean (buf_y);
-		buf_z = sqlite3_mprintf ("%.*f", precision, geom->MaxX);
-		gaiaOutClean (buf_z);
-		buf_m = sqlite3_mprintf ("%.*f", precision, geom->MaxY);
-		gaiaOutClean (buf_m);
-		bbox =
-		    sqlite3_mprintf (",\"bbox\":[%s,%s,%s,%s]", buf_x, buf_y,
-				     buf_z, buf_m);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
-		sqlite3_free (buf_m);
+		gaiaOutBufferInitialize (&bbox_buf);
+		gaiaOutCoords (&bbox_buf, precision, ",\"bbox\":[%f,%f,%f,%f]",
+			       geom->MinX, geom->MinY, geom->MaxX, geom->MaxY);
+		bbox = bbox_buf.Buffer;
 	    }
 	  switch (geom->DeclaredType)
 	    {
@@ -4022,7 +3229,7 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 		break;
 	    };
 	  if (bbox)
-	      sqlite3_free (bbox);
+	      gaiaOutBufferReset (&bbox_buf);
       }
     else
       {
@@ -4090,33 +3297,22 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 		/* adding a further Point */
 		gaiaAppendToOutBuffer (out_buf, ",");
 	    }
-	  buf_x = sqlite3_mprintf ("%.*f", precision, point->X);
-	  gaiaOutClean (buf_x);
-	  buf_y = sqlite3_mprintf ("%.*f", precision, point->Y);
-	  gaiaOutClean (buf_y);
 	  has_z = 0;
 	  if (point->DimensionModel == GAIA_XY_Z
 	      || point->DimensionModel == GAIA_XY_Z_M)
 	    {
-		buf_z = sqlite3_mprintf ("%.*f", precision, point->Z);
-		gaiaOutClean (buf_z);
 		has_z = 1;
 	    }
 	  if (has_z)
 	    {
-		buf = sqlite3_mprintf ("[%s,%s,%s]", buf_x, buf_y, buf_z);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
-		sqlite3_free (buf_z);
+		gaiaOutCoords (out_buf, precision, "[%f,%f,%f]", point->X,
+			       point->Y, point->Z);
 	    }
 	  else
 	    {
-		buf = sqlite3_mprintf ("[%s,%s]", buf_x, buf_y);
-		sqlite3_free (buf_x);
-		sqlite3_free (buf_y);
+		gaiaOutCoords (out_buf, precision, "[%f,%f]", point->X,
+			       point->Y);
 	    }
-	  gaiaAppendToOutBuffer (out_buf, buf);
-	  sqlite3_free (buf);
 	  if (is_multi)
 	    {
 		gaiaAppendToOutBuffer (out_buf, "}");
@@ -4166,39 +3362,20 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 		  }
 		if (has_z)
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
-		      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		      gaiaOutClean (buf_z);
 		      if (iv == 0)
-			  buf =
-			      sqlite3_mprintf ("[%s,%s,%s]", buf_x, buf_y,
-					       buf_z);
+			  gaiaOutCoords (out_buf, precision, "[%f,%f,%f]", x,
+					 y, z);
 		      else
-			  buf =
-			      sqlite3_mprintf (",[%s,%s,%s]", buf_x, buf_y,
-					       buf_z);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
-		      sqlite3_free (buf_z);
+			  gaiaOutCoords (out_buf, precision, ",[%f,%f,%f]", x,
+					 y, z);
 		  }
 		else
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
 		      if (iv == 0)
-			  buf = sqlite3_mprintf ("[%s,%s]", buf_x, buf_y);
+			  gaiaOutCoords (out_buf, precision, "[%f,%f]", x, y);
 		      else
-			  buf = sqlite3_mprintf (",[%s,%s]", buf_x, buf_y);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
+			  gaiaOutCoords (out_buf, precision, ",[%f,%f]", x, y);
 		  }
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
 	    }
 	  /* closing the LineString */
 	  gaiaAppendToOutBuffer (out_buf, "]");
@@ -4252,39 +3429,20 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 		  }
 		if (has_z)
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
-		      buf_z = sqlite3_mprintf ("%.*f", precision, z);
-		      gaiaOutClean (buf_z);
 		      if (iv == 0)
-			  buf =
-			      sqlite3_mprintf ("[[%s,%s,%s]", buf_x, buf_y,
-					       buf_z);
+			  gaiaOutCoords (out_buf, precision, "[[%f,%f,%f]", x,
+					 y, z);
 		      else
-			  buf =
-			      sqlite3_mprintf (",[%s,%s,%s]", buf_x, buf_y,
-					       buf_z);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
-		      sqlite3_free (buf_z);
+			  gaiaOutCoords (out_buf, precision, ",[%f,%f,%f]", x,
+					 y, z);
 		  }
 		else
 		  {
-		      buf_x = sqlite3_mprintf ("%.*f", precision, x);
-		      gaiaOutClean (buf_x);
-		      buf_y = sqlite3_mprintf ("%.*f", precision, y);
-		      gaiaOutClean (buf_y);
 		      if (iv == 0)
-			  buf = sqlite3_mprintf ("[[%s,%s]", buf_x, buf_y);
+			  gaiaOutCoords (out_buf, precision, "[[%f,%f]", x, y);
 		      else
-			  buf = sqlite3_mprintf (",[%s,%s]", buf_x, buf_y);
-		      sqlite3_free (buf_x);
-		      sqlite3_free (buf_y);
+			  gaiaOutCoords (out_buf, precision, ",[%f,%f]", x, y);
 		  }
-		gaiaAppendToOutBuffer (out_buf, buf);
-		sqlite3_free (buf);
 	    }
 	  /* closing the Exterior Ring */
 	  gaiaAppendToOutBuffer (out_buf, "]");
@@ -4317,41 +3475,22 @@ gaiaOutGeoJSON (gaiaOutBufferPtr out_buf, gaiaGeomCollPtr geom, int precision,
 			}
 		      if (has_z)
 			{
-			    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-			    gaiaOutClean (buf_x);
-			    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-			    gaiaOutClean (buf_y);
-			    buf_z = sqlite3_mprintf ("%.*f", precision, z);
-			    gaiaOutClean (buf_z);
 			    if (iv == 0)
-				buf =
-				    sqlite3_mprintf (",[[%s,%s,%s]", buf_x,
-						     buf_y, buf_z);
+				gaiaOutCoords (out_buf, precision,
+					       ",[[%f,%f,%f]", x, y, z);
 			    else
-				buf =
-				    sqlite3_mprintf (",[%s,%s,%s]", buf_x,
-						     buf_y, buf_z);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
-			    sqlite3_free (buf_z);
+				gaiaOutCoords (out_buf, precision,
+					       ",[%f,%f,%f]", x, y, z);
 			}
 		      else
 			{
-			    buf_x = sqlite3_mprintf ("%.*f", precision, x);
-			    gaiaOutClean (buf_x);
-			    buf_y = sqlite3_mprintf ("%.*f", precision, y);
-			    gaiaOutClean (buf_y);
 			    if (iv == 0)
-				buf =
-				    sqlite3_mprintf (",[[%s,%s]", buf_x, buf_y);
+				gaiaOutCoords (out_buf, precision, ",[[%f,%f]",
+					       x, y);
 			    else
-				buf =
-				    sqlite3_mprintf (",[%s,%s]", buf_x, buf_y);
-			    sqlite3_free (buf_x);
-			    sqlite3_free (buf_y);
+				gaiaOutCoords (out_buf, precision, ",[%f,%f]",
+					       x, y);
 			}
-		      gaiaAppendToOutBuffer (out_buf, buf);
-		      sqlite3_free (buf);
 		  }
 		/* closing the Interior Ring */
 		gaiaAppendToOutBuffer (out_buf, "]");
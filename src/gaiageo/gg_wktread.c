@@ -0,0 +1,725 @@
+/*
+
+ gg_wktread.c -- Gaia fast single-pass WKT and EWKT reader
+  
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Klaus Foerster klaus.foerster@svg.cc
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+/*
+ a recursive-descent reader accepting exactly the same WKT and EWKT
+ dialects as the Flex/Lemon parsers, but building the Geometry in a
+ single pass: the vertices of each Linestring or Ring are counted in
+ advance, so that coordinates are directly stored into their final
+ Coords array without any intermediate token, point or list allocation
+
+ any input not strictly matching the supported syntax simply makes the
+ reader to give up, so that the Lemon parser will then handle it (and
+ eventually report the error)
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <locale.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+
+#include <spatialite/gaiageo.h>
+#include <spatialite_private.h>
+
+#define WKTREAD_MAX_KEYWORD	24
+#define WKTREAD_MAX_DEPTH	64
+#define WKTREAD_MAX_DIGITS	19
+#define WKTREAD_UNKNOWN_DIMS	-1
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+/* plain double arithmetic is exactly rounded */
+#define WKTREAD_FAST_DOUBLES
+#endif
+
+struct wkt_reader
+{
+/* a struct wrapping the fast WKT reader status */
+    const char *p;		/* current position */
+    int ewkt;			/* TRUE for the EWKT dialect */
+    int keyword_model;		/* the dimension suffix of the main keyword */
+    int model;			/* the Geometry dimension model */
+    int dims;			/* how many coordinates for each vertex */
+    int depth;			/* GEOMETRYCOLLECTION nesting level */
+    gaiaGeomCollPtr geom;	/* the Geometry being built */
+};
+
+static const char *wkt_class_names[] = {
+    "POINT", "LINESTRING", "POLYGON", "MULTIPOINT", "MULTILINESTRING",
+    "MULTIPOLYGON", "GEOMETRYCOLLECTION"
+};
+
+static const double wkt_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int
+wkt_is_blank (char c)
+{
+/* the whitespaces ignored by the Flex lexers */
+    if (c == ' ' || c == '\t' || c == '\n')
+	return 1;
+    return 0;
+}
+
+static void
+wkt_skip_blanks (struct wkt_reader *rd)
+{
+/* skipping any whitespace */
+    while (wkt_is_blank (*rd->p))
+	rd->p++;
+}
+
+static int
+wkt_expect (struct wkt_reader *rd, char c)
+{
+/* consuming the expected punctuation char */
+    wkt_skip_blanks (rd);
+    if (*rd->p != c)
+	return 0;
+    rd->p++;
+    return 1;
+}
+
+static int
+wkt_is_digit (char c)
+{
+/* testing for a decimal digit */
+    if (c >= '0' && c <= '9')
+	return 1;
+    return 0;
+}
+
+SPATIALITE_PRIVATE const char *
+wkt_scan_number (const char *text, double *value)
+{
+/* 
+/ scanning a number token, also shared by the GeoJSON reader
+/ returns a pointer to the first char following the token, or NULL 
+/ for any token the Flex lexers could read in a different way 
+/ (e.g. "1.e5" or "1e"); checking the terminator is up to the caller
+*/
+    const char *start = text;
+    const char *p = text;
+    sqlite3_uint64 mantissa = 0;
+    int significant = 0;
+    int int_digits = 0;
+    int frac_digits = 0;
+    int dot = 0;
+    int exponent = 0;
+    int exp_value = 0;
+    int exp_negative = 0;
+    int negative = 0;
+    int slow = 0;
+    double v;
+    char *end;
+
+    if (*p == '+' || *p == '-')
+      {
+	  if (*p == '-')
+	      negative = 1;
+	  p++;
+      }
+    while (wkt_is_digit (*p))
+      {
+	  if (mantissa != 0 || *p != '0')
+	    {
+		if (significant < WKTREAD_MAX_DIGITS)
+		    mantissa = (mantissa * 10) + (*p - '0');
+		else
+		  {
+		      slow = 1;
+		      exponent++;
+		  }
+		significant++;
+	    }
+	  int_digits++;
+	  p++;
+      }
+    if (*p == '.')
+      {
+	  dot = 1;
+	  p++;
+	  while (wkt_is_digit (*p))
+	    {
+		if (mantissa != 0 || *p != '0')
+		  {
+		      if (significant < WKTREAD_MAX_DIGITS)
+			{
+			    mantissa = (mantissa * 10) + (*p - '0');
+			    exponent--;
+			}
+		      else
+			  slow = 1;
+		      significant++;
+		  }
+		else
+		    exponent--;
+		frac_digits++;
+		p++;
+	    }
+      }
+    if (int_digits + frac_digits == 0)
+	return NULL;
+    if (*p == 'e' || *p == 'E')
+      {
+	  if (dot && frac_digits == 0)
+	      return NULL;
+	  p++;
+	  if (*p == '+' || *p == '-')
+	    {
+		if (*p == '-')
+		    exp_negative = 1;
+		p++;
+	    }
+	  if (!wkt_is_digit (*p))
+	      return NULL;
+	  while (wkt_is_digit (*p))
+	    {
+		if (exp_value < 100000)
+		    exp_value = (exp_value * 10) + (*p - '0');
+		p++;
+	    }
+	  if (exp_negative)
+	      exponent -= exp_value;
+	  else
+	      exponent += exp_value;
+      }
+#ifdef WKTREAD_FAST_DOUBLES
+    if (!slow && mantissa < ((sqlite3_uint64) 1 << 53) && exponent >= -22
+	&& exponent <= 22)
+      {
+	  /* exactly representable operands: a single rounding step */
+	  v = (double) mantissa;
+	  if (exponent < 0)
+	      v /= wkt_pow10[-exponent];
+	  else
+	      v *= wkt_pow10[exponent];
+	  *value = negative ? -v : v;
+	  return p;
+      }
+#endif
+    if (mantissa == 0 && !slow)
+      {
+	  /* zero, whatever is the exponent */
+	  *value = negative ? -0.0 : 0.0;
+	  return p;
+      }
+/* any other case: exactly the same as atof() in the Flex lexer */
+    v = strtod (start, &end);
+    if (end != p)
+	return NULL;
+    *value = v;
+    return p;
+}
+
+static int
+wkt_number (struct wkt_reader *rd, double *value)
+{
+/* 
+/ parsing a number; the Flex lexer would split a token such as "1-2", 
+/ so a whitespace, a comma or a bracket is strictly required to follow
+*/
+    const char *p;
+    wkt_skip_blanks (rd);
+    p = wkt_scan_number (rd->p, value);
+    if (p == NULL)
+	return 0;
+    if (!wkt_is_blank (*p) && *p != ',' && *p != ')')
+	return 0;
+    rd->p = p;
+    return 1;
+}
+
+static int
+wkt_is_letter (char c)
+{
+/* testing for an ASCII letter */
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+	return 1;
+    return 0;
+}
+
+static int
+wkt_read_word (struct wkt_reader *rd, char *word)
+{
+/* reading an uppercased keyword; returns its length, -1 if too long */
+    int len = 0;
+    while (wkt_is_letter (*rd->p))
+      {
+	  char c = *rd->p++;
+	  if (len == WKTREAD_MAX_KEYWORD)
+	      return -1;
+	  if (c >= 'a' && c <= 'z')
+	      c -= 'a' - 'A';
+	  word[len++] = c;
+      }
+    word[len] = '\0';
+    return len;
+}
+
+static int
+wkt_suffix_model (struct wkt_reader *rd, const char *suffix)
+{
+/* decoding a dimension suffix; returns -2 if invalid */
+    if (*suffix == '\0')
+	return rd->ewkt ? WKTREAD_UNKNOWN_DIMS : GAIA_XY;
+    if (strcmp (suffix, "M") == 0)
+	return GAIA_XY_M;
+    if (rd->ewkt)
+	return -2;
+    if (strcmp (suffix, "Z") == 0)
+	return GAIA_XY_Z;
+    if (strcmp (suffix, "ZM") == 0)
+	return GAIA_XY_Z_M;
+    return -2;
+}
+
+static int
+wkt_keyword (struct wkt_reader *rd, int *model)
+{
+/* parsing a Geometry class keyword; returns 0 on failure */
+    char word[WKTREAD_MAX_KEYWORD + 1];
+    char suffix[WKTREAD_MAX_KEYWORD + 1];
+    const char *save;
+    int len;
+    int ic;
+    int cls = 0;
+    wkt_skip_blanks (rd);
+    len = wkt_read_word (rd, word);
+    if (len <= 0)
+	return 0;
+    for (ic = 0; ic < 7; ic++)
+      {
+	  int n = strlen (wkt_class_names[ic]);
+	  if (len < n || memcmp (word, wkt_class_names[ic], n) != 0)
+	      continue;
+	  *model = wkt_suffix_model (rd, word + n);
+	  if (*model == -2)
+	      continue;
+	  cls = ic + 1;
+	  break;
+      }
+    if (!cls)
+	return 0;
+    if (!rd->ewkt && *model == GAIA_XY)
+      {
+	  /* WKT also accepts a blank-separated suffix, as in "POINT Z" */
+	  save = rd->p;
+	  wkt_skip_blanks (rd);
+	  len = wkt_read_word (rd, suffix);
+	  if (len > 0 && len <= 2)
+	      *model = wkt_suffix_model (rd, suffix);
+	  if (len <= 0 || len > 2 || *model == -2)
+	    {
+		*model = GAIA_XY;
+		rd->p = save;
+	    }
+      }
+    return cls;
+}
+
+static int
+wkt_probe_model (const char *p)
+{
+/* 
+/ EWKT: an unqualified keyword takes its dimensions from the first vertex
+/ returns -1 if no well formed vertex is found
+*/
+    int count = 0;
+    while (*p != '\0')
+      {
+	  /* skipping keywords and brackets */
+	  if (wkt_is_digit (*p) || *p == '+' || *p == '-' || *p == '.')
+	      break;
+	  if (*p == ')' || *p == ',')
+	      return -1;
+	  p++;
+      }
+    while (*p != '\0')
+      {
+	  /* counting the coordinates */
+	  while (*p != '\0' && !wkt_is_blank (*p) && *p != ',' && *p != ')')
+	      p++;
+	  count++;
+	  while (wkt_is_blank (*p))
+	      p++;
+	  if (*p == ',' || *p == ')')
+	      break;
+      }
+    if (count == 2)
+	return GAIA_XY;
+    if (count == 3)
+	return GAIA_XY_Z;
+    if (count == 4)
+	return GAIA_XY_Z_M;
+    return -1;
+}
+
+static int
+wkt_count_vertices (const char *p)
+{
+/* counting the vertices up to the closing bracket */
+    int count = 1;
+    while (*p != ')')
+      {
+	  if (*p == '\0' || *p == '(')
+	      return 0;
+	  if (*p == ',')
+	      count++;
+	  p++;
+      }
+    return count;
+}
+
+static int
+wkt_count_rings (const char *p)
+{
+/* counting the Rings up to the closing bracket */
+    int count = 0;
+    int depth = 0;
+    while (*p != '\0')
+      {
+	  if (*p == '(')
+	    {
+		if (depth > 0)
+		    return 0;
+		count++;
+		depth++;
+	    }
+	  else if (*p == ')')
+	    {
+		if (depth == 0)
+		    return count;
+		depth--;
+	    }
+	  p++;
+      }
+    return 0;
+}
+
+static int
+wkt_coords (struct wkt_reader *rd, double *coords, int points)
+{
+/* parsing a list of vertices straight into their Coords array */
+    int iv;
+    int ic;
+    for (iv = 0; iv < points; iv++)
+      {
+	  if (iv > 0 && !wkt_expect (rd, ','))
+	      return 0;
+	  for (ic = 0; ic < rd->dims; ic++)
+	    {
+		if (!wkt_number (rd, coords++))
+		    return 0;
+	    }
+      }
+    return wkt_expect (rd, ')');
+}
+
+static int
+wkt_point (struct wkt_reader *rd)
+{
+/* parsing a vertex and adding it as a POINT */
+    double c[4];
+    int ic;
+    for (ic = 0; ic < rd->dims; ic++)
+      {
+	  if (!wkt_number (rd, c + ic))
+	      return 0;
+      }
+    switch (rd->model)
+      {
+      case GAIA_XY_Z:
+	  gaiaAddPointToGeomCollXYZ (rd->geom, c[0], c[1], c[2]);
+	  break;
+      case GAIA_XY_M:
+	  gaiaAddPointToGeomCollXYM (rd->geom, c[0], c[1], c[2]);
+	  break;
+      case GAIA_XY_Z_M:
+	  gaiaAddPointToGeomCollXYZM (rd->geom, c[0], c[1], c[2], c[3]);
+	  break;
+      default:
+	  gaiaAddPointToGeomColl (rd->geom, c[0], c[1]);
+	  break;
+      }
+    return 1;
+}
+
+static int
+wkt_multipoint_text (struct wkt_reader *rd)
+{
+/* parsing a MULTIPOINT, either "(x y, ...)" or "((x y), ...)" */
+    int brackets;
+    if (!wkt_expect (rd, '('))
+	return 0;
+    wkt_skip_blanks (rd);
+    brackets = (*rd->p == '(');
+    while (1)
+      {
+	  if (brackets && !wkt_expect (rd, '('))
+	      return 0;
+	  if (!wkt_point (rd))
+	      return 0;
+	  if (brackets && !wkt_expect (rd, ')'))
+	      return 0;
+	  if (!wkt_expect (rd, ','))
+	      break;
+      }
+    return wkt_expect (rd, ')');
+}
+
+static int
+wkt_linestring_text (struct wkt_reader *rd)
+{
+/* parsing a LINESTRING */
+    gaiaLinestringPtr ln;
+    int points;
+    if (!wkt_expect (rd, '('))
+	return 0;
+    points = wkt_count_vertices (rd->p);
+    if (points < 2)
+	return 0;
+    ln = gaiaAddLinestringToGeomColl (rd->geom, points);
+    return wkt_coords (rd, ln->Coords, points);
+}
+
+static int
+wkt_polygon_text (struct wkt_reader *rd)
+{
+/* parsing a POLYGON */
+    gaiaPolygonPtr pg;
+    gaiaRingPtr rng;
+    int rings;
+    int points;
+    int ib;
+    if (!wkt_expect (rd, '('))
+	return 0;
+    rings = wkt_count_rings (rd->p);
+    if (rings < 1 || !wkt_expect (rd, '('))
+	return 0;
+    points = wkt_count_vertices (rd->p);
+    if (points < 4)
+	return 0;
+    pg = gaiaAddPolygonToGeomColl (rd->geom, points, rings - 1);
+    if (!wkt_coords (rd, pg->Exterior->Coords, points))
+	return 0;
+    for (ib = 0; ib < rings - 1; ib++)
+      {
+	  if (!wkt_expect (rd, ',') || !wkt_expect (rd, '('))
+	      return 0;
+	  points = wkt_count_vertices (rd->p);
+	  if (points < 4)
+	      return 0;
+	  rng = gaiaAddInteriorRing (pg, ib, points);
+	  if (!wkt_coords (rd, rng->Coords, points))
+	      return 0;
+      }
+    return wkt_expect (rd, ')');
+}
+
+static int
+wkt_multi_text (struct wkt_reader *rd, int (*item) (struct wkt_reader *))
+{
+/* parsing a MULTILINESTRING or MULTIPOLYGON */
+    if (!wkt_expect (rd, '('))
+	return 0;
+    while (1)
+      {
+	  if (!item (rd))
+	      return 0;
+	  if (!wkt_expect (rd, ','))
+	      break;
+      }
+    return wkt_expect (rd, ')');
+}
+
+static int wkt_collection_text (struct wkt_reader *rd);
+
+static int
+wkt_geometry_text (struct wkt_reader *rd, int cls)
+{
+/* parsing the text following some Geometry class keyword */
+    switch (cls)
+      {
+      case GAIA_POINT:
+	  if (!wkt_expect (rd, '(') || !wkt_point (rd))
+	      return 0;
+	  return wkt_expect (rd, ')');
+      case GAIA_LINESTRING:
+	  return wkt_linestring_text (rd);
+      case GAIA_POLYGON:
+	  return wkt_polygon_text (rd);
+      case GAIA_MULTIPOINT:
+	  return wkt_multipoint_text (rd);
+      case GAIA_MULTILINESTRING:
+	  return wkt_multi_text (rd, wkt_linestring_text);
+      case GAIA_MULTIPOLYGON:
+	  return wkt_multi_text (rd, wkt_polygon_text);
+      case GAIA_GEOMETRYCOLLECTION:
+	  return wkt_collection_text (rd);
+      }
+    return 0;
+}
+
+static int
+wkt_collection_text (struct wkt_reader *rd)
+{
+/* parsing a GEOMETRYCOLLECTION; all items share the same dimensions */
+    int cls;
+    int model;
+    if (rd->depth >= WKTREAD_MAX_DEPTH)
+	return 0;
+    if (!wkt_expect (rd, '('))
+	return 0;
+    rd->depth++;
+    while (1)
+      {
+	  cls = wkt_keyword (rd, &model);
+	  if (!cls || model != rd->keyword_model)
+	      return 0;
+	  if (!wkt_geometry_text (rd, cls))
+	      return 0;
+	  if (!wkt_expect (rd, ','))
+	      break;
+      }
+    rd->depth--;
+    return wkt_expect (rd, ')');
+}
+
+SPATIALITE_PRIVATE void *
+wkt_fast_parse (const unsigned char *text, int ewkt)
+{
+/* 
+/ attempting to parse some WKT or EWKT text in a single pass
+/ returns NULL on failure; the caller is expected to fall back 
+/ to the Lemon parser in this case
+*/
+    struct wkt_reader rd;
+    struct lconv *lc;
+    int cls;
+    gaiaGeomCollPtr geom;
+
+    if (text == NULL)
+	return NULL;
+    lc = localeconv ();
+    if (strcmp (lc->decimal_point, ".") != 0)
+      {
+	  /* atof() in the Flex lexers depends on the current locale */
+	  return NULL;
+      }
+    rd.p = (const char *) text;
+    rd.ewkt = ewkt;
+    rd.depth = 0;
+    cls = wkt_keyword (&rd, &rd.keyword_model);
+    if (!cls)
+	return NULL;
+    rd.model = rd.keyword_model;
+    if (rd.model == WKTREAD_UNKNOWN_DIMS)
+      {
+	  rd.model = wkt_probe_model (rd.p);
+	  if (rd.model < 0)
+	      return NULL;
+      }
+    switch (rd.model)
+      {
+      case GAIA_XY_Z:
+	  geom = gaiaAllocGeomCollXYZ ();
+	  rd.dims = 3;
+	  break;
+      case GAIA_XY_M:
+	  geom = gaiaAllocGeomCollXYM ();
+	  rd.dims = 3;
+	  break;
+      case GAIA_XY_Z_M:
+	  geom = gaiaAllocGeomCollXYZM ();
+	  rd.dims = 4;
+	  break;
+      default:
+	  geom = gaiaAllocGeomColl ();
+	  rd.dims = 2;
+	  break;
+      }
+    rd.geom = geom;
+    if (!wkt_geometry_text (&rd, cls))
+	goto error;
+    wkt_skip_blanks (&rd);
+    if (*rd.p != '\0')
+	goto error;
+
+    if (cls == GAIA_POINT)
+      {
+	  /* same as the Lemon parsers: a qualified POINT type */
+	  switch (rd.model)
+	    {
+	    case GAIA_XY_Z:
+		cls = GAIA_POINTZ;
+		break;
+	    case GAIA_XY_M:
+		cls = GAIA_POINTM;
+		break;
+	    case GAIA_XY_Z_M:
+		cls = GAIA_POINTZM;
+		break;
+	    }
+      }
+    geom->DeclaredType = cls;
+    return geom;
+
+  error:
+    gaiaFreeGeomColl (geom);
+    return NULL;
+}
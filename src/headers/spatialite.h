@@ -1320,6 +1320,31 @@ extern "C"
 						    const char *table,
 						    const char *column);
 
+/**
+ Updates the LAYER_STATISTICS table using parallel worker threads
+
+ \param sqlite handle to current DB connection
+ \param table name of the table to be processed
+ \param column name of the geometry to be processed
+ \param max_threads max number of concurrent worker threads
+
+ \note same as update_layer_statistics(), except that independent
+ table/geometry entries (and ROWID ranges of large tables) will be 
+ scanned in parallel, each worker using its own read-only connection;
+ all results will then be merged and stored by the current connection.
+ The serial update_layer_statistics() will be used anyway when max_threads
+ is less than 2, on MEMORY-DBs, on GeoPackages and when a Transaction 
+ is currently pending.
+
+ \sa update_layer_statistics
+
+ \return 0 on failure, any other value on success
+ */
+    SPATIALITE_DECLARE int update_layer_statistics_ex (sqlite3 * sqlite,
+						       const char *table,
+						       const char *column,
+						       int max_threads);
+
 /**
  Immediately and unconditionally invalidates the already existing Statistics
 
@@ -1339,6 +1364,63 @@ extern "C"
 						     const char *table,
 						     const char *geometry);
 
+/**
+ Enables the Incremental Statistics mode on some Spatial Table
+
+ \param handle SQLite handle to current DB connection.
+ \param table Spatial Table name.
+ \param geometry Geometry Column name.
+ 
+ \return 0 on failure, any other value on success
+
+ \sa gaiaDisableIncrementalStatistics, gaiaHasIncrementalStatistics,
+ update_layer_statistics, gaiaGetLayerExtent
+
+ \note the Statistics of the Layer will be immediately updated, then
+ a set of triggers will keep row_count and the full extent up to date
+ on each INSERT; on UPDATE and DELETE only an extent actually affected 
+ by the change will be invalidated, and will then be lazily recomputed
+ by the next OPTIMISTIC request (e.g. gaiaGetLayerExtent).
+ \n Only supported by current metadata style (>= v.4.0.0).
+ */
+    SPATIALITE_DECLARE int gaiaEnableIncrementalStatistics (sqlite3 * handle,
+							    const char *table,
+							    const char
+							    *geometry);
+
+/**
+ Disables the Incremental Statistics mode on some Spatial Table
+
+ \param handle SQLite handle to current DB connection.
+ \param table Spatial Table name.
+ \param geometry Geometry Column name.
+ 
+ \return 0 on failure, any other value on success
+
+ \sa gaiaEnableIncrementalStatistics, gaiaHasIncrementalStatistics
+ */
+    SPATIALITE_DECLARE int gaiaDisableIncrementalStatistics (sqlite3 *
+							     handle,
+							     const char
+							     *table,
+							     const char
+							     *geometry);
+
+/**
+ Checks if the Incremental Statistics mode is enabled on some Spatial Table
+
+ \param handle SQLite handle to current DB connection.
+ \param table Spatial Table name.
+ \param geometry Geometry Column name.
+ 
+ \return 0 if not enabled (or on failure), any other value if enabled
+
+ \sa gaiaEnableIncrementalStatistics, gaiaDisableIncrementalStatistics
+ */
+    SPATIALITE_DECLARE int gaiaHasIncrementalStatistics (sqlite3 * handle,
+							 const char *table,
+							 const char *geometry);
+
 /**
  Queries the Metadata tables returning the Layer Full Extent
 
@@ -1646,6 +1728,40 @@ extern "C"
 					     const char *new_name,
 					     char **error_message);
 
+/**
+ Reprojects a whole Geometry Column into a different SRID
+
+ \param sqlite handle to current DB connection
+ \param p_cache a memory pointer returned by spatialite_alloc_connection()
+ \param table name of the table containing the Geometry Column
+ (always expected to be in the MAIN database).
+ \param column name of the Geometry Column to be reprojected
+ \param srid the new SRID to be set
+ \param max_threads max number of concurrent worker threads
+ \param error_message: will point to a diagnostic error message
+  in case of failure, otherwise NULL
+
+ \note all Geometries will be read and written back in sorted ROWID batches;
+ each batch will be reprojected in parallel, every worker thread using
+ a PROJ context of its own.
+ \n the SRID registered into the Metadata tables will be updated, the
+ Spatial Index (if any) will be rebuilt just once at the end and the
+ Layer Statistics will be refreshed.
+ \n everything happens within a single SAVEPOINT, so that on failure
+ the Geometry Column will be left untouched.
+ \n an eventual diagnostic message pointed by error_message must be
+ freed by calling sqlite3_free()
+
+ \return 0 on failure, any other value on success
+ */
+    SPATIALITE_DECLARE int gaiaTransformGeometryColumn (sqlite3 * sqlite,
+							const void *p_cache,
+							const char *table,
+							const char *column,
+							int srid,
+							int max_threads,
+							char **error_message);
+
 /**
  Checks a Geometry Column for validity
 
@@ -1975,6 +2091,50 @@ extern "C"
 				       int transaction, int ram_tmp_store,
 				       char **message);
 
+/**
+  Will dissolve an input dataset by uniting all Geometries sharing the
+  same values on some attribute columns, and will consequently create
+  and populate an output dataset
+  
+ \param db_handle handle to the current SQLite connection
+ \param cache a memory pointer returned by spatialite_alloc_connection()
+ \param input_table name of the input table to be processed (always
+ expected to be in the MAIN database).
+ \param input_geom name of the input table Geometry column;
+ it could be NULL and in this case the appropriate column name will
+ be automatically determined. anyway if the input table do contains
+ two or more Geometries passing a NULL geometry name will raise a
+ fatal error.
+ \param group_by comma separated list of the input table columns
+ identifying each group; if NULL or empty all Geometries will be
+ united into a single one. key values are always compared exactly
+ (BINARY collation), but INTEGER and REAL values numerically equal
+ (e.g. 1 and 1.0) will belong to the same group.
+ \param output_table name to be assigned to the destination table
+ intended to permanently store all results. this table must not exist.
+ \param max_threads max number of concurrent worker threads
+ \param message pointer to a string buffer; if not NULL it will point
+ on completion an eventual error message.
+ 
+ \return 0 on failure, any other value on success
+ 
+ \note input rows are read just once sorted by group; groups are then
+ united in parallel, each worker thread using a GEOS handle of its own.
+ \n the output table will contain a PK_UID column, all the group_by
+ columns and a MULTI-type Geometry supported by a Spatial Index.
+ \n everything happens within a single SAVEPOINT, so that on failure
+ the output table will not be created.
+ \n the message buffer if not NULL will point to a dymanic memory
+ allocation and is expected to be released by calling sqlite3_free()
+ */
+    SPATIALITE_DECLARE int gaiaDissolveTable (sqlite3 * db_handle,
+					      const void *cache,
+					      const char *input_table,
+					      const char *input_geom,
+					      const char *group_by,
+					      const char *output_table,
+					      int max_threads, char **message);
+
 /**
   Will attempt to create the Routing Nodes columns for a spatial table
   
@@ -2055,6 +2215,98 @@ extern "C"
 						const char *oneway_to,
 						int overwrite);
 
+/**
+  Will attempt to create a VirtualRouting from an input table
+  (optionally supporting Contraction Hierarchies)
+  
+ \param db_handle handle to the current SQLite connection
+ \param cache a memory pointer returned by spatialite_alloc_connection()
+ \param routing_data_table name of the Routing Data Table to be created.
+ \param virtual_routing_table name of the VirtualRouting Table to be created.
+ \param input_table name of the input table to be processed.
+ \param from_column name of the input table column containing NodeFrom.
+ \param to_column name of the input table column containing NodeTo.
+ \param geom_column name of the input table column containing Linestring Geometries
+ (could be eventually NULL).
+ \param cost_column name of the input table column containing Cost values
+ (could be eventually NULL).
+ \param name_column name of the input table column containing RoadName
+ (could be eventually NULL).
+ \param a_star_enabled if set to TRUE the Routing Data Table will support
+ both Djiskra's Shortest Path and A* algorithms; if set to FALSE only
+ the Djiskra's algorithm will be supported.
+ \param bidirectional if set to TRUE all input arcs/links will be assumed
+ to be bidirectional (from-to and to-from); if set to FALSE all input
+ arcs/links will be assumed to be unidirectional (from-to only).
+ \param oneway_from name of the input table column containing OneWayFrom
+ (could be eventually NULL).
+ \param oneway_to name of the input table column containing OneWayTo
+ (could be eventually NULL).
+ \param overwrite if set to TRUE both the Routing Data Table and the
+ VirtualRouting Table will be dropped if already existing; if set to
+ FALSE an already existing Routing Data Table or VirtualRouting Table
+ will cause a fatal error.
+ \param contraction_hierarchies if set to TRUE the Contraction Hierarchies
+ (Node ranks and Shortcuts) will be precomputed and stored into the
+ Routing Data Table, so to support the "CH" algorithm (bidirectional
+ search on the Hierarchy).
+ 
+ \return 0 on failure, any other value on success
+
+ \sa gaia_create_routing
+ 
+ \note a Routing Data Table supporting Contraction Hierarchies cannot
+ be read by any previous version of the library.
+ */
+    SPATIALITE_DECLARE int gaia_create_routing_ex (sqlite3 * db_handle,
+						   const void *cache,
+						   const char
+						   *routing_data_table,
+						   const char
+						   *virtual_routing_table,
+						   const char *input_table,
+						   const char *from_column,
+						   const char *to_column,
+						   const char *geom_column,
+						   const char *cost_column,
+						   const char *name_column,
+						   int a_star_enabled,
+						   int bidirectional,
+						   const char *oneway_from,
+						   const char *oneway_to,
+						   int overwrite,
+						   int
+						   contraction_hierarchies);
+
+/**
+ will export a Routing Data Table into a Routing Graph file
+
+ \param db_handle handle to the current SQLite connection
+ \param cache a memory pointer returned by spatialite_alloc_connection()
+ \param routing_data_table name of the Routing Data Table to be exported.
+ \param graph_file path of the Routing Graph file to be created; any
+ existing file will be atomically replaced.
+
+ \return 0 on failure, any other value on success
+
+ \sa gaia_create_routing_ex, gaia_create_routing_get_last_error
+
+ \note a Routing Graph file is a position-independent image of the
+ decoded network (native byte order) that VirtualRouting can directly
+ map read-only, e.g.\n
+ CREATE VIRTUAL TABLE net USING VirtualRouting(net_data, '/path/net.graph')\n
+ the same physical copy is then shared by every connection and process
+ opening the same file. A file no longer matching the Routing Data Table
+ is ignored, and the network is decoded as usual.
+ */
+    SPATIALITE_DECLARE int gaia_create_routing_graph_file (sqlite3 *
+							   db_handle,
+							   const void *cache,
+							   const char
+							   *routing_data_table,
+							   const char
+							   *graph_file);
+
 /**
   Will attempt to retrieve the Full Extent from an R*Tree (SpatiaLite)
    
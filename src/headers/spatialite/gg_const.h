@@ -229,6 +229,29 @@ extern "C"
 /** BLOB-Geometry CLASS: compressed POLYGON ZM */
 #define GAIA_COMPRESSED_POLYGONZM		1003003
 
+/* constants that defines Quantized GEOMETRY CLASSes */
+/** BLOB-Geometry CLASS: quantized LINESTRING */
+#define GAIA_QUANTIZED_LINESTRING		2000002
+/** BLOB-Geometry CLASS: quantized POLYGON */
+#define GAIA_QUANTIZED_POLYGON			2000003
+/** BLOB-Geometry CLASS: quantized LINESTRING Z */
+#define GAIA_QUANTIZED_LINESTRINGZ		2001002
+/** BLOB-Geometry CLASS: quantized POLYGON Z */
+#define GAIA_QUANTIZED_POLYGONZ			2001003
+/** BLOB-Geometry CLASS: quantized LINESTRING M */
+#define GAIA_QUANTIZED_LINESTRINGM		2002002
+/** BLOB-Geometry CLASS: quantized POLYGON M */
+#define GAIA_QUANTIZED_POLYGONM			2002003
+/** BLOB-Geometry CLASS: quantized LINESTRING ZM */
+#define GAIA_QUANTIZED_LINESTRINGZM		2003002
+/** BLOB-Geometry CLASS: quantized POLYGON ZM */
+#define GAIA_QUANTIZED_POLYGONZM		2003003
+
+/** Quantized BLOB-Geometry: min allowed precision (decimal digits) */
+#define GAIA_QUANTIZED_MIN_PRECISION	-7
+/** Quantized BLOB-Geometry: max allowed precision (decimal digits) */
+#define GAIA_QUANTIZED_MAX_PRECISION	15
+
 /* constants that defines GEOS-WKB 3D CLASSes */
 /** GEOS-WKB 3D CLASS: POINT Z */
 #define GAIA_GEOSWKB_POINTZ			-2147483647
@@ -330,6 +353,12 @@ extern "C"
 #define GAIA_NET_A_STAR_COEFF	0xa5
 /** VirtualNetwork internal markers: BLOCK */
 #define GAIA_NET_BLOCK		0xed
+/** VirtualNetwork internal markers: Contraction Hierarchies */
+#define GAIA_NET_CH		0xa7
+/** VirtualNetwork internal markers: Contraction Hierarchies RANKS BLOCK */
+#define GAIA_NET_CH_RANKS	0xe0
+/** VirtualNetwork internal markers: Contraction Hierarchies SHORTCUTS BLOCK */
+#define GAIA_NET_CH_SHORTCUTS	0xe1
 
 /* constants used for Coordinate Dimensions */
 /** Coordinate Dimensions: XY */
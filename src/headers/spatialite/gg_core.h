@@ -635,6 +635,67 @@ extern "C"
  */
     GAIAGEO_DECLARE void gaiaFreeGeomColl (gaiaGeomCollPtr geom);
 
+/**
+ Creates a memory Arena for Geometry objects
+
+ \return the pointer to newly created Arena object: NULL on failure
+
+ \sa gaiaResetGeomArena, gaiaFreeGeomArena, gaiaAllocGeomCollArena,
+ gaiaFromSpatiaLiteBlobWkbArena
+
+ \note an Arena bump-allocates all POINT, LINESTRING, POLYGON and RING
+ objects (and their coordinates) from a few large memory blocks, thus
+ avoiding many small malloc() / free() pairs when decoding Geometries.
+ \n you are responsible to destroy (before or after) any allocated Arena
+ by calling gaiaFreeGeomArena().
+ */
+    GAIAGEO_DECLARE gaiaGeomArenaPtr gaiaCreateGeomArena (void);
+
+/**
+ Releases at once all Geometry objects allocated from a memory Arena
+
+ \param arena pointer to the Arena object
+
+ \sa gaiaCreateGeomArena, gaiaFreeGeomArena
+
+ \note the first memory block is retained so to be reused by the
+ next Geometry; any object allocated from the Arena becomes invalid
+ after this call.
+ */
+    GAIAGEO_DECLARE void gaiaResetGeomArena (gaiaGeomArenaPtr arena);
+
+/**
+ Destroys a memory Arena
+
+ \param arena pointer to the Arena object to be destroyed
+
+ \sa gaiaCreateGeomArena, gaiaResetGeomArena
+ */
+    GAIAGEO_DECLARE void gaiaFreeGeomArena (gaiaGeomArenaPtr arena);
+
+/**
+ Allocates a Geometry from a memory Arena
+
+ \param arena pointer to the Arena object (may be NULL)
+ \param dimension_model one of GAIA_XY, GAIA_XY_Z, GAIA_XY_M or GAIA_XY_Z_M
+
+ \return the pointer to newly created Geometry object: NULL on failure
+
+ \sa gaiaCreateGeomArena, gaiaAllocGeomColl
+
+ \note any POINT, LINESTRING or POLYGON subsequently added to the Geometry
+ will be allocated from the same Arena; calling gaiaFreeGeomColl() or 
+ gaiaFreePolygon() on Arena objects is an harmless no-op.
+ \n Arena Geometries are intended to be used in a read-only fashion:
+ directly freeing any elementary item (e.g. by gaiaFreeLinestring) is
+ a serious error.
+ \n passing a NULL Arena simply allocates an ordinary Geometry.
+ */
+    GAIAGEO_DECLARE gaiaGeomCollPtr gaiaAllocGeomCollArena (gaiaGeomArenaPtr
+							    arena,
+							    int
+							    dimension_model);
+
 /**
  Creates a new 2D Point [XY] object into a Geometry object
 
@@ -60,6 +60,11 @@ extern "C"
 {
 #endif
 
+/**
+ max length of a double formatted by gaiaFormatDouble (NUL included)
+ */
+#define GAIA_DOUBLE_TEXT_MAX	352
+
 /* function prototypes */
 
 /**
@@ -337,6 +342,45 @@ extern "C"
     GAIAGEO_DECLARE void gaiaAppendToOutBuffer (gaiaOutBufferPtr buf,
 						const char *text);
 
+/**
+ Formats a double value as plain decimal text
+
+ \param buffer the output buffer.
+ \param value the double value to be formatted.
+ \param precision max number of decimal digits; a negative value means
+ full precision.
+
+ \return the length of the output text (terminating NUL excluded).
+
+ \sa gaiaAppendDoubleToOutBuffer
+
+ \note the output is the shortest decimal representation still identifying
+ exactly the same double, rounded (half up) to the requested precision;
+ trailing zeros are never printed, exponents are never used, and the
+ formatting never depends on the current locale.
+ \n you are expected to pass an output buffer corresponding to an
+ allocation size of (at least) GAIA_DOUBLE_TEXT_MAX bytes.
+ */
+    GAIAGEO_DECLARE int gaiaFormatDouble (char *buffer, double value,
+					  int precision);
+
+/**
+ Appends a formatted double value at the end of Text output buffer
+
+ \param buf pointer to gaiaOutBufferStruct structure.
+ \param value the double value to be appended.
+ \param precision max number of decimal digits; a negative value means
+ full precision.
+
+ \sa gaiaFormatDouble, gaiaAppendToOutBuffer
+
+ \note the text is directly written into the output buffer, exactly
+ as gaiaFormatDouble would format it.
+ */
+    GAIAGEO_DECLARE void gaiaAppendDoubleToOutBuffer (gaiaOutBufferPtr buf,
+						      double value,
+						      int precision);
+
 /**
  Creates a BLOB-Geometry representing a Point (BLOB-Geometry)
 
@@ -580,6 +624,89 @@ extern "C"
 								 int
 								 gpkg_amphibious);
 
+/**
+ Creates a Geometry object from the corresponding BLOB-Geometry 
+ [allocating from a memory Arena]
+
+ \param arena pointer to the memory Arena (may be NULL)
+ \param blob pointer to BLOB-Geometry
+ \param size the BLOB's size
+ \param gpkg_mode is set to TRUE will accept only GPKG Geometry-BLOBs
+ \param gpkg_amphibious is set to TRUE will indifferenctly accept
+  either SpatiaLite Geometry-BLOBs or GPKG Geometry-BLOBs
+
+ \return the pointer to the newly created Geometry object: NULL on failure
+
+ \sa gaiaFromSpatiaLiteBlobWkbEx, gaiaCreateGeomArena, gaiaResetGeomArena
+
+ \note the whole Geometry tree is carved out of the Arena, so decoding
+ requires just a few malloc() calls; all memory will be released at once
+ by gaiaResetGeomArena() or gaiaFreeGeomArena().
+ \n TinyPoint and GPKG BLOBs (or a NULL Arena) will always return an
+ ordinary heap allocated Geometry; calling gaiaFreeGeomColl() on the
+ returned object is anyway safe in both cases.
+ */
+    GAIAGEO_DECLARE gaiaGeomCollPtr
+	gaiaFromSpatiaLiteBlobWkbArena (gaiaGeomArenaPtr arena,
+					const unsigned char *blob,
+					unsigned int size, int gpkg_mode,
+					int gpkg_amphibious);
+
+/**
+ Initializes a read-only view directly walking a BLOB-Geometry
+
+ \param view pointer to the BLOB-View object to be initialized.
+ \param blob pointer to BLOB-Geometry
+ \param size the BLOB's size
+
+ \return 0 on failure (invalid, truncated, Quantized or GPKG BLOB):
+ any other value on success.
+
+ \sa gaiaBlobViewNextPart, gaiaBlobViewNextVertex, gaiaFromSpatiaLiteBlobWkb
+
+ \note no memory is allocated at all: the view simply references the
+ BLOB's own buffer, that is required to stay valid while the view is in use.
+ On success all the NumXxx counters are already set, and the cursor is
+ positioned before the first elementary item.
+ */
+    GAIAGEO_DECLARE int gaiaBlobViewInit (gaiaBlobViewPtr view,
+					  const unsigned char *blob,
+					  unsigned int size);
+
+/**
+ Moves a BLOB-View cursor to the next elementary item
+
+ \param view pointer to the BLOB-View object.
+
+ \return 0 when no further item exists: any other value on success.
+
+ \sa gaiaBlobViewInit, gaiaBlobViewNextVertex
+
+ \note elementary items are returned in the same order as stored
+ within the BLOB: each POINT, each LINESTRING and each RING of any
+ POLYGON (exterior first) counts as an individual item.
+ */
+    GAIAGEO_DECLARE int gaiaBlobViewNextPart (gaiaBlobViewPtr view);
+
+/**
+ Reads the next vertex from the current item of a BLOB-View
+
+ \param view pointer to the BLOB-View object.
+ \param x on completion this variable will contain the X coordinate.
+ \param y on completion this variable will contain the Y coordinate.
+ \param z on completion this variable will contain the Z coordinate
+ (always 0.0 if the current item has no Z).
+ \param m on completion this variable will contain the M measure
+ (always 0.0 if the current item has no M).
+
+ \return 0 when no further vertex exists: any other value on success.
+
+ \sa gaiaBlobViewInit, gaiaBlobViewNextPart
+ */
+    GAIAGEO_DECLARE int gaiaBlobViewNextVertex (gaiaBlobViewPtr view,
+						double *x, double *y,
+						double *z, double *m);
+
 /**
  Creates a BLOB-Geometry corresponding to a Geometry object
 
@@ -661,6 +788,41 @@ extern "C"
 						  unsigned char **result,
 						  int *size);
 
+/**
+ Creates a Quantized BLOB-Geometry corresponding to a Geometry object
+
+ \param geom pointer to the Geometry object.
+ \param xy_precision number of decimal digits to be preserved for X and Y.
+ \param z_precision number of decimal digits to be preserved for Z.
+ \param m_precision number of decimal digits to be preserved for M.
+ \param result on completion will containt a pointer to Quantized
+ BLOB-Geometry: NULL on failure.
+ \param size on completion this variable will contain the BLOB's size (in bytes)
+
+ \return 0 on failure: any other value on success.
+
+ \sa gaiaFromSpatiaLiteBlobWkb, gaiaToCompressedBlobWkb
+
+ \note any Linestring / Ring found within the Geometry will be stored
+ as integer deltas (zigzag varints) of its coordinates rounded to the
+ requested number of decimal digits; Points are never quantized.
+ \n a negative precision rounds to tens, hundreds and so on; any precision
+ must be in the range GAIA_QUANTIZED_MIN_PRECISION to
+ GAIA_QUANTIZED_MAX_PRECISION, and this function will fail if some
+ rounded coordinate could not be exactly represented as a double.
+ \n the MBR stored in the BLOB header always corresponds to the rounded
+ coordinates.
+ \n the returned BLOB buffer corresponds to dynamically allocated memory:
+ so you are responsible to free() it [unless SQLite will take care
+ of memory cleanup via buffer binding].
+ */
+    GAIAGEO_DECLARE int gaiaToQuantizedBlobWkb (gaiaGeomCollPtr geom,
+						int xy_precision,
+						int z_precision,
+						int m_precision,
+						unsigned char **result,
+						int *size);
+
 /**
  Creates a Geometry object from WKB notation
 
@@ -212,6 +212,8 @@ extern "C"
 	int DimensionModel;	/* (x,y), (x,y,z), (x,y,m) or (x,y,z,m) */
 /** pointer to next item [linked list] */
 	struct gaiaPolygonStruct *Next;	/* for linked list */
+/** owning Arena (NULL for ordinary heap allocated POLYGONs) */
+	struct gaiaGeomArenaStruct *Arena;	/* memory Arena */
     } gaiaPolygon;
 /**
  Typedef for OGC POLYGON structure
@@ -264,6 +266,8 @@ extern "C"
 	int DeclaredType;	/* the declared TYPE for this Geometry */
 /** pointer to next item [linked list] */
 	struct gaiaGeomCollStruct *Next;	/* Vanuatu - used for linked list */
+/** owning Arena (NULL for ordinary heap allocated Geometries) */
+	struct gaiaGeomArenaStruct *Arena;	/* memory Arena */
     } gaiaGeomColl;
 /**
  Typedef for OGC GEOMETRYCOLLECTION structure
@@ -272,6 +276,91 @@ extern "C"
  */
     typedef gaiaGeomColl *gaiaGeomCollPtr;
 
+/**
+ Typedef for Geometry memory Arena [opaque object]
+
+ \sa gaiaCreateGeomArena
+ */
+    typedef struct gaiaGeomArenaStruct *gaiaGeomArenaPtr;
+
+/**
+ Read-only cursor directly walking a BLOB-Geometry [no decoding at all]
+ */
+    typedef struct gaiaBlobViewStruct
+    {
+/* a read-only view of a SpatiaLite BLOB-Geometry */
+/** the SRID */
+	int Srid;
+/** the BLOB-Geometry CLASS type */
+	int Type;
+/** any valid Geometry Class type */
+	int DeclaredType;
+/** one of GAIA_XY, GAIA_XY_Z, GAIA_XY_M, GAIA_XY_ZM */
+	int DimensionModel;
+/** MBR: min X */
+	double MinX;		/* MBR - BBOX */
+/** MBR: min Y */
+	double MinY;		/* MBR - BBOX */
+/** MBR: max X */
+	double MaxX;		/* MBR - BBOX */
+/** MBR: max Y */
+	double MaxY;		/* MBR - BBOX */
+/** total number of POINTs */
+	int NumPoints;
+/** total number of LINESTRINGs */
+	int NumLinestrings;
+/** total number of POLYGONs */
+	int NumPolygons;
+/** total number of RINGs (exterior and interior) */
+	int NumRings;
+/** total number of vertices */
+	int NumVertices;
+/** current item: one of GAIA_POINT, GAIA_LINESTRING, GAIA_POLYGON [ring] */
+	int PartType;
+/** current item: one of GAIA_XY, GAIA_XY_Z, GAIA_XY_M, GAIA_XY_ZM */
+	int PartDimensionModel;
+/** current item: number of vertices */
+	int PartPoints;
+/** current item: ring index (0 = exterior ring); -1 if not a ring */
+	int PartRing;
+/** BLOB-Geometry buffer */
+	const unsigned char *blob;
+/** BLOB-Geometry buffer size (in bytes) */
+	unsigned int size;
+/** CPU endian arch */
+	int endian_arch;
+/** BLOB Geometry endian arch */
+	int endian;
+/** collection flag */
+	int collection;
+/** current offset [next item] */
+	unsigned int offset;
+/** current offset [next vertex] */
+	unsigned int vertex_offset;
+/** number of elementary items still to be walked */
+	int entities;
+/** number of rings still to be walked [current polygon] */
+	int rings;
+/** current elementary type (compressed or not) */
+	int elem_type;
+/** current item: compressed vertices flag */
+	int compressed;
+/** current item: index of next vertex */
+	int vertex;
+/** last returned X [compressed vertices] */
+	double last_x;
+/** last returned Y [compressed vertices] */
+	double last_y;
+/** last returned Z [compressed vertices] */
+	double last_z;
+    } gaiaBlobView;
+/**
+ Typedef for BLOB-Geometry read-only view structure
+
+ \sa gaiaBlobView
+ */
+    typedef gaiaBlobView *gaiaBlobViewPtr;
+
 /**
  Container similar to LINESTRING [internally used]
  */
@@ -112,11 +112,65 @@ extern "C"
 
     struct splite_geos_cache_item
     {
-	unsigned char gaiaBlob[64];
+	unsigned char *gaiaBlob;	/* a full copy of the BLOB */
 	int gaiaBlobSize;
 	uLong crc32;
 	void *geosGeom;
 	void *preparedGeosGeom;
+	struct splite_geos_cache_item *prev;	/* LRU list */
+	struct splite_geos_cache_item *next;	/* LRU list */
+	struct splite_geos_cache_item *hashNext;	/* hash bucket chain */
+    };
+
+#define SPLITE_GEOS_CACHE_BUCKETS	1024
+#define SPLITE_GEOS_CACHE_DEFAULT	64
+#define SPLITE_GEOS_CACHE_MAX	16384
+
+    struct splite_geos_cache
+    {
+	/* an N-entries LRU cache of GEOS Prepared Geometries
+	/ keyed by the CRC32 of the whole BLOB;
+	/ a BLOB seen for the first time is simply registered
+	/ as a "candidate", and it will be prepared only
+	/ when seen again */
+	int maxItems;
+	int preparedCount;
+	int candidateCount;
+	struct splite_geos_cache_item **buckets;
+	struct splite_geos_cache_item *firstPrepared;	/* MRU */
+	struct splite_geos_cache_item *lastPrepared;	/* LRU */
+	struct splite_geos_cache_item *firstCandidate;	/* MRU */
+	struct splite_geos_cache_item *lastCandidate;	/* LRU */
+	sqlite3_int64 hits;
+	sqlite3_int64 misses;
+	sqlite3_int64 evictions;
+    };
+
+    struct splite_proj_cache_item
+    {
+	void *pj;
+	char *proj_string_1;
+	char *proj_string_2;
+	void *area;
+	unsigned int hash;
+	struct splite_proj_cache_item *prev;	/* LRU list */
+	struct splite_proj_cache_item *next;	/* LRU list */
+    };
+
+#define SPLITE_PROJ_CACHE_DEFAULT	16
+#define SPLITE_PROJ_CACHE_MAX	1024
+
+    struct splite_proj_cache
+    {
+	/* an N-entries LRU cache of PROJ transformation objects
+	/ keyed by (proj_string_1, proj_string_2, area) */
+	int maxItems;
+	int count;
+	struct splite_proj_cache_item *first;	/* MRU */
+	struct splite_proj_cache_item *last;	/* LRU */
+	sqlite3_int64 hits;
+	sqlite3_int64 misses;
+	sqlite3_int64 evictions;
     };
 
     struct splite_xmlSchema_cache_item
@@ -158,6 +212,16 @@ extern "C"
 	int size;
     };
 
+    struct splite_deferred_rtree
+    {
+	/* rows still to be aligned on some SpatialIndex [Deferred mode] */
+	char *rtree;
+	sqlite3_int64 *rowids;
+	int count;
+	int allocated;
+	struct splite_deferred_rtree *next;
+    };
+
 #define MAX_XMLSCHEMA_CACHE	16
 
     struct splite_internal_cache
@@ -175,8 +239,7 @@ extern "C"
 	char *cutterMessage;
 	char *storedProcError;
 	char *createRoutingError;
-	struct splite_geos_cache_item cacheItem1;
-	struct splite_geos_cache_item cacheItem2;
+	struct splite_geos_cache geosCache;
 	struct splite_xmlSchema_cache_item xmlSchemaCache[MAX_XMLSCHEMA_CACHE];
 	int pool_index;
 	void (*geos_warning) (const char *fmt, ...);
@@ -216,14 +279,18 @@ extern "C"
 	int buffer_join_style;
 	double buffer_mitre_limit;
 	int buffer_quadrant_segments;
-	int proj6_cached;
-	void *proj6_cached_pj;
-	char *proj6_cached_string_1;
-	char *proj6_cached_string_2;
-	void *proj6_cached_area;
+	struct splite_proj_cache projCache;
 	int is_pause_enabled;
+	void *geom_arena;
+	int geom_arena_busy;
+	int max_threads;
+	int deferred_rtree_mode;
+	int deferred_rtree_txn;
+	struct splite_deferred_rtree *first_deferred_rtree;
     };
 
+#define SPLITE_MAX_THREADS	64
+
     struct epsg_defs
     {
 	int srid;
@@ -286,6 +353,9 @@ extern "C"
 
     SPATIALITE_PRIVATE void free_internal_cache_networks (void *first);
 
+    SPATIALITE_PRIVATE void gaia_create_routing_set_error (const void *ctx,
+							   const char *errmsg);
+
     SPATIALITE_PRIVATE struct epsg_defs *add_epsg_def (int filter_srid,
 						       struct epsg_defs
 						       **first,
@@ -360,6 +430,17 @@ extern "C"
 
     SPATIALITE_PRIVATE void voronoj_free (void *voronoj);
 
+    SPATIALITE_PRIVATE void *wkt_fast_parse (const unsigned char *text,
+					     int ewkt);
+
+    SPATIALITE_PRIVATE const char *wkt_scan_number (const char *text,
+						    double *value);
+
+    SPATIALITE_PRIVATE void *geojson_fast_parse (const unsigned char *text);
+
+    SPATIALITE_PRIVATE int geojson_read_member (const char **text,
+						void *property);
+
     SPATIALITE_PRIVATE void *concave_hull_build (void *first,
 						 int dimension_model,
 						 double factor,
@@ -397,6 +478,22 @@ extern "C"
 						    const char *table,
 						    const char *column);
 
+    SPATIALITE_PRIVATE void updateGeometryTriggersEx (void *p_sqlite,
+						      const char *table,
+						      const char *column,
+						      const char
+						      *aux_columns);
+
+    SPATIALITE_PRIVATE char *getSpatialIndexAuxColumns (void *p_sqlite,
+							const char *table,
+							const char *column);
+
+    SPATIALITE_PRIVATE int checkSpatialIndexAuxColumns (void *p_sqlite,
+							const char *table,
+							const char *column,
+							const char
+							*aux_columns);
+
     SPATIALITE_PRIVATE void updateTemporaryGeometryTriggers (void *p_sqlite,
 							     const char
 							     *db_prefix,
@@ -427,6 +524,27 @@ extern "C"
 						const unsigned char *table,
 						const char *column);
 
+    SPATIALITE_PRIVATE int buildSpatialIndexPacked (void *p_sqlite,
+						    const unsigned char
+						    *table,
+						    const char *column);
+
+    SPATIALITE_PRIVATE int deferSpatialIndexRow (void *p_sqlite,
+						 const void *p_cache,
+						 const char *rtree,
+						 sqlite3_int64 pkid);
+
+    SPATIALITE_PRIVATE int enableDeferredSpatialIndex (void *p_sqlite,
+						       const void *p_cache);
+
+    SPATIALITE_PRIVATE int flushDeferredSpatialIndex (void *p_sqlite,
+						      const void *p_cache);
+
+    SPATIALITE_PRIVATE int disableDeferredSpatialIndex (void *p_sqlite,
+							const void *p_cache);
+
+    SPATIALITE_PRIVATE void splite_free_deferred_rtree (const void *p_cache);
+
     SPATIALITE_PRIVATE int buildTemporarySpatialIndex (void *p_sqlite,
 						       const char *db_prefix,
 						       const unsigned char
@@ -917,6 +1035,22 @@ extern "C"
 							   splite_geos_cache_item
 							   *p);
 
+    SPATIALITE_PRIVATE void splite_init_geos_cache (struct splite_geos_cache
+						    *p);
+
+    SPATIALITE_PRIVATE void splite_free_geos_cache (const void *p_cache);
+
+    SPATIALITE_PRIVATE void splite_geos_cache_set_size (const void *p_cache,
+							int max_items);
+
+    SPATIALITE_PRIVATE void splite_init_proj_cache (struct splite_proj_cache
+						    *p);
+
+    SPATIALITE_PRIVATE void splite_free_proj_cache (const void *p_cache);
+
+    SPATIALITE_PRIVATE void splite_proj_cache_set_size (const void *p_cache,
+							int max_items);
+
     SPATIALITE_PRIVATE void splite_free_xml_schema_cache_item (struct
 							       splite_xmlSchema_cache_item
 							       *p);
@@ -1453,6 +1587,20 @@ extern "C"
 
     SPATIALITE_PRIVATE void spatialite_internal_cleanup (const void *ptr);
 
+    SPATIALITE_PRIVATE void *splite_thread_create (void (*func) (void *arg),
+						   void *arg);
+
+    SPATIALITE_PRIVATE void splite_thread_join (void *thread);
+
+    SPATIALITE_PRIVATE void *gaiaUnionReducerCreate (const void *p_cache,
+						     int max_threads);
+
+    SPATIALITE_PRIVATE void gaiaUnionReducerAdd (void *reducer, void *geom);
+
+    SPATIALITE_PRIVATE void *gaiaUnionReducerFinish (void *reducer);
+
+    SPATIALITE_PRIVATE void gaiaUnionReducerDestroy (void *reducer);
+
     SPATIALITE_PRIVATE void gaia_sql_proc_set_error (const void *p_cache,
 						     const char *errmsg);
 
@@ -74,7 +74,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 
 #define MAX_BLOCK	1048576
 
-static void
+SPATIALITE_PRIVATE void
 gaia_create_routing_set_error (const void *ctx, const char *errmsg)
 {
 /* setting the CreateRouting Last Error Message */
@@ -1888,12 +1888,634 @@ do_check_input_table (sqlite3 * db_handle, const void *cache,
     return 1;
 }
 
+/*
+/
+/ Contraction Hierarchies preprocessing
+/
+/ Nodes are contracted one at a time, following an order driven
+/ by the edge difference (shortcuts added minus arcs removed) plus
+/ the number of already contracted neighbours; a Shortcut u->w is
+/ added whenever contracting v removes the only shortest path
+/ u->v->w (a bounded local Dijkstra looks for witness paths).
+/
+/ the original Arcs keep the same ordering used by output_node()
+/ so that each Arc is identified by its position; each Shortcut
+/ references its two halves (Arcs or other Shortcuts)
+/
+*/
+
+#define CH_WITNESS_MAX_SETTLED	512
+
+struct ch_edge
+{
+/* an Arc or a Shortcut */
+    int from;
+    int to;
+    double cost;
+    int child1;			/* first half (Shortcuts only) */
+    int child2;			/* second half (Shortcuts only) */
+};
+
+struct ch_list
+{
+/* a dynamic list of Edge indices */
+    int *items;
+    int count;
+    int max;
+};
+
+struct ch_heap_item
+{
+/* a Heap item */
+    double key;
+    int node;
+};
+
+struct ch_heap
+{
+/* a binary min-Heap */
+    struct ch_heap_item *items;
+    int count;
+    int max;
+};
+
+struct ch_graph
+{
+/* the Contraction Hierarchies builder */
+    int n_nodes;
+    int n_arcs;			/* the original Arcs */
+    int n_edges;		/* Arcs + Shortcuts */
+    int max_edges;
+    struct ch_edge *edges;
+    struct ch_list *out;	/* outcoming Edges by Node */
+    struct ch_list *in;		/* incoming Edges by Node */
+    int *rank;			/* contraction order; -1 if not yet contracted */
+    int *deleted;		/* contracted neighbours by Node */
+    double *dist;		/* witness search distances */
+    int *touched;		/* witness search touched Nodes */
+    int n_touched;
+    struct ch_heap heap;
+};
+
+static int
+ch_list_add (struct ch_list *list, int item)
+{
+/* appending an item into a dynamic list */
+    if (list->count == list->max)
+      {
+	  int max = (list->max == 0) ? 4 : list->max * 2;
+	  int *items = realloc (list->items, sizeof (int) * max);
+	  if (items == NULL)
+	      return 0;
+	  list->items = items;
+	  list->max = max;
+      }
+    list->items[list->count++] = item;
+    return 1;
+}
+
+static int
+ch_heap_push (struct ch_heap *heap, double key, int node)
+{
+/* inserting an item into the Heap */
+    int i;
+    struct ch_heap_item tmp;
+    if (heap->count == heap->max)
+      {
+	  int max = (heap->max == 0) ? 1024 : heap->max * 2;
+	  struct ch_heap_item *items =
+	      realloc (heap->items, sizeof (struct ch_heap_item) * max);
+	  if (items == NULL)
+	      return 0;
+	  heap->items = items;
+	  heap->max = max;
+      }
+    i = heap->count++;
+    heap->items[i].key = key;
+    heap->items[i].node = node;
+    while (i > 0 && heap->items[(i - 1) / 2].key > heap->items[i].key)
+      {
+	  tmp = heap->items[i];
+	  heap->items[i] = heap->items[(i - 1) / 2];
+	  heap->items[(i - 1) / 2] = tmp;
+	  i = (i - 1) / 2;
+      }
+    return 1;
+}
+
+static void
+ch_heap_pop (struct ch_heap *heap, double *key, int *node)
+{
+/* removing the min-key item from the Heap */
+    int i = 0;
+    int c;
+    struct ch_heap_item tmp;
+    *key = heap->items[0].key;
+    *node = heap->items[0].node;
+    heap->items[0] = heap->items[--heap->count];
+    while (1)
+      {
+	  c = (i * 2) + 1;
+	  if (c >= heap->count)
+	      break;
+	  if (c + 1 < heap->count
+	      && heap->items[c + 1].key < heap->items[c].key)
+	      c++;
+	  if (heap->items[c].key >= heap->items[i].key)
+	      break;
+	  tmp = heap->items[i];
+	  heap->items[i] = heap->items[c];
+	  heap->items[c] = tmp;
+	  i = c;
+      }
+}
+
+static int
+ch_add_edge (struct ch_graph *ch, int from, int to, double cost, int child1,
+	     int child2)
+{
+/* inserting a new Edge - returns -1 on failure */
+    struct ch_edge *edge;
+    if (ch->n_edges == ch->max_edges)
+      {
+	  int max = ch->max_edges * 2;
+	  struct ch_edge *edges =
+	      realloc (ch->edges, sizeof (struct ch_edge) * max);
+	  if (edges == NULL)
+	      return -1;
+	  ch->edges = edges;
+	  ch->max_edges = max;
+      }
+    edge = ch->edges + ch->n_edges;
+    edge->from = from;
+    edge->to = to;
+    edge->cost = cost;
+    edge->child1 = child1;
+    edge->child2 = child2;
+    if (!ch_list_add (ch->out + from, ch->n_edges))
+	return -1;
+    if (!ch_list_add (ch->in + to, ch->n_edges))
+      {
+	  ch->out[from].count -= 1;
+	  return -1;
+      }
+    return ch->n_edges++;
+}
+
+static void
+ch_free (struct ch_graph *ch)
+{
+/* memory cleanup - destroying a Contraction Hierarchies builder */
+    int i;
+    if (ch == NULL)
+	return;
+    for (i = 0; i < ch->n_nodes; i++)
+      {
+	  if (ch->out != NULL && ch->out[i].items != NULL)
+	      free (ch->out[i].items);
+	  if (ch->in != NULL && ch->in[i].items != NULL)
+	      free (ch->in[i].items);
+      }
+    free (ch->out);
+    free (ch->in);
+    free (ch->edges);
+    free (ch->rank);
+    free (ch->deleted);
+    free (ch->dist);
+    free (ch->touched);
+    if (ch->heap.items != NULL)
+	free (ch->heap.items);
+    free (ch);
+}
+
+static struct ch_graph *
+ch_alloc (int n_nodes)
+{
+/* allocating an empty Contraction Hierarchies builder */
+    int i;
+    struct ch_graph *ch = malloc (sizeof (struct ch_graph));
+    if (ch == NULL)
+	return NULL;
+    ch->n_nodes = n_nodes;
+    ch->n_arcs = 0;
+    ch->n_edges = 0;
+    ch->max_edges = 1024;
+    ch->edges = malloc (sizeof (struct ch_edge) * ch->max_edges);
+    ch->out = calloc (n_nodes, sizeof (struct ch_list));
+    ch->in = calloc (n_nodes, sizeof (struct ch_list));
+    ch->rank = malloc (sizeof (int) * n_nodes);
+    ch->deleted = malloc (sizeof (int) * n_nodes);
+    ch->dist = malloc (sizeof (double) * n_nodes);
+    ch->touched = malloc (sizeof (int) * n_nodes);
+    ch->n_touched = 0;
+    ch->heap.items = NULL;
+    ch->heap.count = 0;
+    ch->heap.max = 0;
+    if (ch->edges == NULL || ch->out == NULL || ch->in == NULL
+	|| ch->rank == NULL || ch->deleted == NULL || ch->dist == NULL
+	|| ch->touched == NULL)
+      {
+	  /* insufficient memory */
+	  ch_free (ch);
+	  return NULL;
+      }
+    for (i = 0; i < n_nodes; i++)
+      {
+	  ch->rank[i] = -1;
+	  ch->deleted[i] = 0;
+	  ch->dist[i] = DBL_MAX;
+      }
+    return ch;
+}
+
+static int
+ch_witness_search (struct ch_graph *ch, int source, int excluded,
+		   double max_cost)
+{
+/* bounded Dijkstra ignoring both contracted Nodes and the excluded one */
+    int i;
+    int node;
+    int settled = 0;
+    double key;
+    struct ch_list *list;
+    struct ch_edge *edge;
+
+    ch->heap.count = 0;
+    ch->dist[source] = 0.0;
+    ch->touched[ch->n_touched++] = source;
+    if (!ch_heap_push (&(ch->heap), 0.0, source))
+	return 0;
+    while (ch->heap.count > 0)
+      {
+	  ch_heap_pop (&(ch->heap), &key, &node);
+	  if (key > ch->dist[node])
+	      continue;		/* stale item */
+	  if (key > max_cost || ++settled > CH_WITNESS_MAX_SETTLED)
+	      break;
+	  list = ch->out + node;
+	  for (i = 0; i < list->count; i++)
+	    {
+		edge = ch->edges + list->items[i];
+		if (edge->to == excluded || ch->rank[edge->to] >= 0)
+		    continue;
+		if (key + edge->cost < ch->dist[edge->to])
+		  {
+		      if (ch->dist[edge->to] == DBL_MAX)
+			  ch->touched[ch->n_touched++] = edge->to;
+		      ch->dist[edge->to] = key + edge->cost;
+		      if (!ch_heap_push
+			  (&(ch->heap), ch->dist[edge->to], edge->to))
+			  return 0;
+		  }
+	    }
+      }
+    return 1;
+}
+
+static void
+ch_witness_reset (struct ch_graph *ch)
+{
+/* resetting all Nodes touched by the witness search */
+    int i;
+    for (i = 0; i < ch->n_touched; i++)
+	ch->dist[ch->touched[i]] = DBL_MAX;
+    ch->n_touched = 0;
+}
+
+static int
+ch_is_best_edge (struct ch_graph *ch, struct ch_list *list, int index,
+		 int outcoming)
+{
+/* testing if an Edge is the cheapest one connecting the same Nodes */
+    int i;
+    struct ch_edge *edge = ch->edges + list->items[index];
+    struct ch_edge *other;
+    for (i = 0; i < list->count; i++)
+      {
+	  if (i == index)
+	      continue;
+	  other = ch->edges + list->items[i];
+	  if (outcoming && other->to != edge->to)
+	      continue;
+	  if (!outcoming && other->from != edge->from)
+	      continue;
+	  if (other->cost < edge->cost
+	      || (other->cost == edge->cost && i < index))
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+ch_contract_node (struct ch_graph *ch, int node, int simulate)
+{
+/* 
+/ contracting a Node - or simply counting the required Shortcuts
+/ returns -1 on failure
+*/
+    int i;
+    int j;
+    int from;
+    int to;
+    int e_in;
+    int e_out;
+    double cost_in;
+    double max_out = 0.0;
+    int shortcuts = 0;
+    struct ch_list *in = ch->in + node;
+    struct ch_list *out = ch->out + node;
+
+    for (j = 0; j < out->count; j++)
+      {
+	  struct ch_edge *edge = ch->edges + out->items[j];
+	  if (ch->rank[edge->to] < 0 && edge->cost > max_out)
+	      max_out = edge->cost;
+      }
+    for (i = 0; i < in->count; i++)
+      {
+	  e_in = in->items[i];
+	  from = ch->edges[e_in].from;
+	  cost_in = ch->edges[e_in].cost;
+	  if (from == node || ch->rank[from] >= 0)
+	      continue;
+	  if (!ch_is_best_edge (ch, in, i, 0))
+	      continue;
+	  if (!ch_witness_search (ch, from, node, cost_in + max_out))
+	    {
+		ch_witness_reset (ch);
+		return -1;
+	    }
+	  for (j = 0; j < out->count; j++)
+	    {
+		e_out = out->items[j];
+		to = ch->edges[e_out].to;
+		if (to == node || to == from || ch->rank[to] >= 0)
+		    continue;
+		if (!ch_is_best_edge (ch, out, j, 1))
+		    continue;
+		if (ch->dist[to] <= cost_in + ch->edges[e_out].cost)
+		    continue;	/* a witness path exists */
+		shortcuts++;
+		if (!simulate)
+		  {
+		      if (ch_add_edge
+			  (ch, from, to, cost_in + ch->edges[e_out].cost, e_in,
+			   e_out) < 0)
+			{
+			    ch_witness_reset (ch);
+			    return -1;
+			}
+		  }
+	    }
+	  ch_witness_reset (ch);
+      }
+    return shortcuts;
+}
+
+static int
+ch_node_priority (struct ch_graph *ch, int node, double *priority)
+{
+/* computing the contraction priority of some Node */
+    int i;
+    int removed = 0;
+    int shortcuts;
+    struct ch_list *list;
+    list = ch->in + node;
+    for (i = 0; i < list->count; i++)
+      {
+	  if (ch->rank[ch->edges[list->items[i]].from] < 0)
+	      removed++;
+      }
+    list = ch->out + node;
+    for (i = 0; i < list->count; i++)
+      {
+	  if (ch->rank[ch->edges[list->items[i]].to] < 0)
+	      removed++;
+      }
+    shortcuts = ch_contract_node (ch, node, 1);
+    if (shortcuts < 0)
+	return 0;
+    *priority = shortcuts - removed + ch->deleted[node];
+    return 1;
+}
+
+static int
+ch_contract_graph (struct ch_graph *ch)
+{
+/* contracting all Nodes in priority order (lazy updates) */
+    int i;
+    int ok = 0;
+    int node;
+    int next_rank = 0;
+    double key;
+    double priority;
+    struct ch_heap queue;
+    struct ch_list *list;
+
+    queue.items = NULL;
+    queue.count = 0;
+    queue.max = 0;
+    for (i = 0; i < ch->n_nodes; i++)
+      {
+	  if (!ch_node_priority (ch, i, &priority))
+	      goto end;
+	  if (!ch_heap_push (&queue, priority, i))
+	      goto end;
+      }
+    while (queue.count > 0)
+      {
+	  ch_heap_pop (&queue, &key, &node);
+	  if (!ch_node_priority (ch, node, &priority))
+	      goto end;
+	  if (queue.count > 0 && priority > queue.items[0].key)
+	    {
+		/* stale priority: postponing this Node */
+		if (!ch_heap_push (&queue, priority, node))
+		    goto end;
+		continue;
+	    }
+	  if (ch_contract_node (ch, node, 0) < 0)
+	      goto end;
+	  ch->rank[node] = next_rank++;
+	  list = ch->in + node;
+	  for (i = 0; i < list->count; i++)
+	      ch->deleted[ch->edges[list->items[i]].from] += 1;
+	  list = ch->out + node;
+	  for (i = 0; i < list->count; i++)
+	      ch->deleted[ch->edges[list->items[i]].to] += 1;
+      }
+    ok = 1;
+
+  end:
+    if (queue.items != NULL)
+	free (queue.items);
+    return ok;
+}
+
+static struct ch_graph *
+do_build_contraction_hierarchies (sqlite3 * db_handle, const void *cache,
+				  int n_nodes)
+{
+/* building the Contraction Hierarchies */
+    int ret;
+    const char *sql;
+    sqlite3_stmt *stmt = NULL;
+    struct ch_graph *ch = ch_alloc (n_nodes);
+    if (ch == NULL)
+	goto no_memory;
+
+/* loading the original Arcs - same order as output_node() */
+    sql = "SELECT index_from, index_to, cost FROM create_routing_links "
+	"ORDER BY index_from, cost, index_to, rowid";
+    ret = sqlite3_prepare_v2 (db_handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+	goto sql_error;
+    while (1)
+      {
+	  /* scrolling the result set rows */
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;		/* end of result set */
+	  if (ret == SQLITE_ROW)
+	    {
+		int from = sqlite3_column_int (stmt, 0);
+		int to = sqlite3_column_int (stmt, 1);
+		double cost = sqlite3_column_double (stmt, 2);
+		if (from < 0 || from >= n_nodes || to < 0 || to >= n_nodes)
+		  {
+		      gaia_create_routing_set_error (cache,
+						     "Contraction Hierarchies: invalid Node index");
+		      goto error;
+		  }
+		if (ch_add_edge (ch, from, to, cost, -1, -1) < 0)
+		    goto no_memory;
+	    }
+	  else
+	      goto sql_error;
+      }
+    sqlite3_finalize (stmt);
+    stmt = NULL;
+    ch->n_arcs = ch->n_edges;
+
+    if (!ch_contract_graph (ch))
+	goto no_memory;
+    return ch;
+
+  no_memory:
+    gaia_create_routing_set_error (cache,
+				   "Contraction Hierarchies: insufficient memory");
+    goto error;
+
+  sql_error:
+    {
+	char *msg =
+	    sqlite3_mprintf ("SQL error: %s", sqlite3_errmsg (db_handle));
+	gaia_create_routing_set_error (cache, msg);
+	sqlite3_free (msg);
+    }
+  error:
+    if (stmt != NULL)
+	sqlite3_finalize (stmt);
+    ch_free (ch);
+    return NULL;
+}
+
+static int
+do_insert_ch_block (sqlite3 * db_handle, const void *cache,
+		    sqlite3_stmt * stmt_out, unsigned char *buf, int size)
+{
+/* inserting a Contraction Hierarchies block */
+    int ret;
+    sqlite3_reset (stmt_out);
+    sqlite3_clear_bindings (stmt_out);
+    sqlite3_bind_null (stmt_out, 1);
+    sqlite3_bind_blob (stmt_out, 2, buf, size, SQLITE_STATIC);
+    ret = sqlite3_step (stmt_out);
+    if (ret == SQLITE_DONE || ret == SQLITE_ROW)
+	return 1;
+    else
+      {
+	  char *msg =
+	      sqlite3_mprintf ("SQL error: %s", sqlite3_errmsg (db_handle));
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  return 0;
+      }
+}
+
+static int
+do_output_ch (sqlite3 * db_handle, const void *cache, sqlite3_stmt * stmt_out,
+	      unsigned char *buf, int endian_arch, struct ch_graph *ch)
+{
+/* exporting the Contraction Hierarchies blocks into NETWORK-DATA */
+    unsigned char *out;
+    int i;
+    int count;
+    int first;
+    int max_ranks = (MAX_BLOCK - 16) / 4;
+    int max_shortcuts = (MAX_BLOCK - 16) / 24;
+    struct ch_edge *edge;
+
+/* Node ranks */
+    for (first = 0; first < ch->n_nodes; first += count)
+      {
+	  count = ch->n_nodes - first;
+	  if (count > max_ranks)
+	      count = max_ranks;
+	  out = buf;
+	  *out++ = GAIA_NET_CH_RANKS;
+	  gaiaExport32 (out, first, 1, endian_arch);	/* the first Node internal index */
+	  out += 4;
+	  gaiaExport32 (out, count, 1, endian_arch);	/* how many Nodes are into this block */
+	  out += 4;
+	  for (i = first; i < first + count; i++)
+	    {
+		gaiaExport32 (out, ch->rank[i], 1, endian_arch);	/* the Node rank */
+		out += 4;
+	    }
+	  *out++ = GAIA_NET_END;
+	  if (!do_insert_ch_block (db_handle, cache, stmt_out, buf, out - buf))
+	      return 0;
+      }
+
+/* Shortcuts */
+    for (first = ch->n_arcs; first < ch->n_edges; first += count)
+      {
+	  count = ch->n_edges - first;
+	  if (count > max_shortcuts)
+	      count = max_shortcuts;
+	  out = buf;
+	  *out++ = GAIA_NET_CH_SHORTCUTS;
+	  gaiaExport32 (out, count, 1, endian_arch);	/* how many Shortcuts are into this block */
+	  out += 4;
+	  for (i = first; i < first + count; i++)
+	    {
+		edge = ch->edges + i;
+		gaiaExport32 (out, edge->from, 1, endian_arch);	/* the FromNode internal index */
+		out += 4;
+		gaiaExport32 (out, edge->to, 1, endian_arch);	/* the ToNode internal index */
+		out += 4;
+		gaiaExport64 (out, edge->cost, 1, endian_arch);	/* the Shortcut Cost */
+		out += 8;
+		gaiaExport32 (out, edge->child1, 1, endian_arch);	/* the first half */
+		out += 4;
+		gaiaExport32 (out, edge->child2, 1, endian_arch);	/* the second half */
+		out += 4;
+	    }
+	  *out++ = GAIA_NET_END;
+	  if (!do_insert_ch_block (db_handle, cache, stmt_out, buf, out - buf))
+	      return 0;
+      }
+    return 1;
+}
+
 static int
 do_prepare_header (unsigned char *buf, int endian_arch, int n_nodes,
 		   int has_ids, int max_code_length, const char *input_table,
 		   const char *from_column, const char *to_column,
 		   const char *geom_column, const char *name_column,
-		   int a_star_supported, double a_star_coeff)
+		   int a_star_supported, double a_star_coeff,
+		   struct ch_graph *ch)
 {
 /* preparing the HEADER block */
     int len;
@@ -1968,6 +2590,13 @@ do_prepare_header (unsigned char *buf, int endian_arch, int n_nodes,
 	  gaiaExport64 (out, a_star_coeff, 1, endian_arch);
 	  out += 8;
       }
+    if (ch != NULL)
+      {
+	  /* inserting the Contraction Hierarchies marker */
+	  *out++ = GAIA_NET_CH;
+	  gaiaExport32 (out, ch->n_edges - ch->n_arcs, 1, endian_arch);	/* how many Shortcuts are there */
+	  out += 4;
+      }
     *out++ = GAIA_NET_END;
     return out - buf;
 }
@@ -2055,7 +2684,7 @@ do_create_data (sqlite3 * db_handle, const void *cache,
 		const char *from_column, const char *to_column,
 		const char *geom_column, const char *name_column,
 		int a_star_enabled, double a_star_coeff, int has_ids,
-		int n_nodes, int max_code_length)
+		int n_nodes, int max_code_length, struct ch_graph *ch)
 {
 /* creating and populating the Routing Data table */
     char *sql;
@@ -2147,7 +2776,7 @@ do_create_data (sqlite3 * db_handle, const void *cache,
 /* preparing the Select Node To SQL statement */
     sql = "SELECT rowid, index_to, cost "
 	"FROM create_routing_links "
-	"WHERE index_from = ? " "ORDER BY cost, index_to";
+	"WHERE index_from = ? " "ORDER BY cost, index_to, rowid";
     ret = sqlite3_prepare_v2 (db_handle, sql, strlen (sql), &stmt_to, NULL);
     if (ret != SQLITE_OK)
       {
@@ -2164,7 +2793,7 @@ do_create_data (sqlite3 * db_handle, const void *cache,
     size =
 	do_prepare_header (buf, endian_arch, n_nodes, has_ids, max_code_length,
 			   input_table, from_column, to_column, geom_column,
-			   name_column, a_star_enabled, a_star_coeff);
+			   name_column, a_star_enabled, a_star_coeff, ch);
     sqlite3_reset (stmt_out);
     sqlite3_clear_bindings (stmt_out);
     sqlite3_bind_int (stmt_out, 1, 0);
@@ -2289,6 +2918,15 @@ do_create_data (sqlite3 * db_handle, const void *cache,
 		goto error;
 	    }
       }
+    if (ch != NULL)
+      {
+	  /* inserting the Contraction Hierarchies blocks */
+	  if (!do_output_ch (db_handle, cache, stmt_out, buf, endian_arch, ch))
+	    {
+		error = 1;
+		goto error;
+	    }
+      }
 
   error:
     if (auxbuf != NULL)
@@ -3091,6 +3729,34 @@ gaia_create_routing (sqlite3 * db_handle,
 		     const char *oneway_to, int overwrite)
 {
 /* attempting to create a VirtualRouting from an input table */
+    return gaia_create_routing_ex (db_handle, cache, routing_data_table,
+				   virtual_routing_table, input_table,
+				   from_column, to_column, geom_column,
+				   cost_column, name_column, a_star_enabled,
+				   bidirectional, oneway_from, oneway_to,
+				   overwrite, 0);
+}
+
+SPATIALITE_DECLARE int
+gaia_create_routing_ex (sqlite3 * db_handle,
+			const void *cache,
+			const char *routing_data_table,
+			const char
+			*virtual_routing_table,
+			const char *input_table,
+			const char *from_column,
+			const char *to_column,
+			const char *geom_column,
+			const char *cost_column,
+			const char *name_column,
+			int a_star_enabled,
+			int bidirectional,
+			const char *oneway_from,
+			const char *oneway_to, int overwrite,
+			int contraction_hierarchies)
+{
+/* attempting to create a VirtualRouting from an input table */
+    struct ch_graph *ch = NULL;
     int has_ids;
     int n_nodes = 0;
     int max_code_length = 0;
@@ -3208,11 +3874,22 @@ gaia_create_routing (sqlite3 * db_handle,
 	 bidirectional, &has_ids, &n_nodes, &max_code_length, &a_star_coeff))
 	return 0;
 
+/* optionally building the Contraction Hierarchies */
+    if (contraction_hierarchies)
+      {
+	  ch = do_build_contraction_hierarchies (db_handle, cache, n_nodes);
+	  if (ch == NULL)
+	      return 0;
+      }
+
 /* creating and populating the Routing Data table */
-    if (!do_create_data
-	(db_handle, cache, routing_data_table, input_table, from_column,
-	 to_column, geom_column, name_column, a_star_enabled, a_star_coeff,
-	 has_ids, n_nodes, max_code_length))
+    ret =
+	do_create_data (db_handle, cache, routing_data_table, input_table,
+			from_column, to_column, geom_column, name_column,
+			a_star_enabled, a_star_coeff, has_ids, n_nodes,
+			max_code_length, ch);
+    ch_free (ch);
+    if (!ret)
 	return 0;
 
 /* creating the VirtualRouting table */
@@ -2030,6 +2030,30 @@ scope_is_geometry_trigger (sqlite3 * sqlite, const char *db_prefix,
 		trg_name = sqlite3_mprintf ("tmd_%s_%s", table, geom);
 		cmp = strcasecmp (trg_name, tbl_name);
 		sqlite3_free (trg_name);
+		if (cmp == 0)
+		  {
+		      ok = 1;
+		      break;
+		  }
+		trg_name = sqlite3_mprintf ("tsi_%s_%s", table, geom);
+		cmp = strcasecmp (trg_name, tbl_name);
+		sqlite3_free (trg_name);
+		if (cmp == 0)
+		  {
+		      ok = 1;
+		      break;
+		  }
+		trg_name = sqlite3_mprintf ("tsu_%s_%s", table, geom);
+		cmp = strcasecmp (trg_name, tbl_name);
+		sqlite3_free (trg_name);
+		if (cmp == 0)
+		  {
+		      ok = 1;
+		      break;
+		  }
+		trg_name = sqlite3_mprintf ("tsd_%s_%s", table, geom);
+		cmp = strcasecmp (trg_name, tbl_name);
+		sqlite3_free (trg_name);
 		if (cmp == 0)
 		  {
 		      ok = 1;
@@ -49,6 +49,12 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <string.h>
 #include <float.h>
 
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #if defined(_WIN32) && !defined(__MINGW32__)
 #include "config-msvc.h"
 #else
@@ -62,6 +68,8 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite/gaiageo.h>
 #include <spatialite/gaiaaux.h>
 
+#include <spatialite_private.h>
+
 #ifdef _WIN32
 #define strcasecmp	_stricmp
 #endif /* not WIN32 */
@@ -80,16 +88,38 @@ static struct sqlite3_module my_mbr_module;
 
 memory structs used to store the MBR's cache
 
-the basic idea is to implement a hierarchy in order to avoid
-excessive memory fragmentation and achieve better performance
-
-- the cache is a linked-list of cache page elements
-  - each cache page contains an array of 32 cache blocks
-    - each cache block contains an array of 32 cache cells
-so a single cache page con store up to 1024 cache cells
+the cache is a packed Hilbert R-tree held in memory:
+
+- all the cached entities are stored into a single array of cells;
+  the first "n_packed" cells are sorted by the Hilbert code of their
+  MBR's center, and are covered by a static tree whose nodes contain
+  the combined MBR of MBR_CACHE_FANOUT children (cells or nodes)
+- any entity inserted or updated after the last packing is simply
+  appended to the unpacked tail of the array, that is scanned
+  linearly; deleted entities are just marked as such
+- a ROWID hash table allows direct access to any cell
+- the tree is rebuilt from scratch (packed) when the tail or the
+  deleted cells grow too much, just before performing a query
+
+the same cache is shared by all the connections of the current
+process accessing the same Geometry column of the same DB-file: it is
+kept in sync by the gci/gcu/gcd triggers of whichever connection
+writes the table, and is invalidated (i.e. reloaded on first use)
+when a transaction having modified it is rolled back.
+caches of in-memory or temporary DBs are never shared.
 
 */
 
+#define MBR_CACHE_FANOUT	16
+#define MBR_CACHE_MAX_LEVELS	16
+#define MBR_CACHE_TAIL		256
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+typedef CRITICAL_SECTION mbr_cache_mutex;
+#else
+typedef pthread_mutex_t mbr_cache_mutex;
+#endif
+
 struct mbr_cache_cell
 {
 /* 
@@ -103,77 +133,54 @@ a  cached entity
     double miny;
     double maxx;
     double maxy;
+/* 0 if the entity has been deleted */
+    int valid;
 };
 
-struct mbr_cache_block
-{
-/*
-a block of 32 cached entities
-*/
-
-/* 
-allocation bitmap: the meaning of each bit is:
-1 - corresponding cache cell is in use
-0 - corresponding cache cell is unused
-*/
-    unsigned int bitmap;
-/* 
-the MBR corresponding to this cache block 
-i.e. the combined MBR for any contained cell
-*/
-    double minx;
-    double miny;
-    double maxx;
-    double maxy;
-/* the cache cells array */
-    struct mbr_cache_cell cells[32];
-};
-
-struct mbr_cache_page
+struct mbr_cache_node
 {
-/*
-a page containing 32 cached blocks
-*/
-
-/* 
-allocation bitmap: the meaning of each bit is:
-1 - corresponding cache block is in full
-0 - corresponding cache block is not full
-*/
-    unsigned int bitmap;
-/* 
-the MBR corresponding to this cache page
-i.e. the combined MBR for any contained block
-*/
+/* a node of the packed tree: the combined MBR of its children */
     double minx;
     double miny;
     double maxx;
     double maxy;
-/* the cache blocks array */
-    struct mbr_cache_block blocks[32];
-/* the min-max rowid for this page */
-    sqlite3_int64 min_rowid;
-    sqlite3_int64 max_rowid;
-/* pointer to next element into the cached pages linked list */
-    struct mbr_cache_page *next;
 };
 
 struct mbr_cache
 {
 /*
 the MBR's cache
-implemented as a cache pages linked list
 */
 
-/* pointers used to handle the cache pages linked list */
-    struct mbr_cache_page *first;
-    struct mbr_cache_page *last;
-/*
- pointer used to identify the current cache page when inserting a new cache cell
- */
-    struct mbr_cache_page *current;
+/* the cells array */
+    struct mbr_cache_cell *cells;
+    int n_cells;		/* cells in use, deleted ones included */
+    int max_cells;		/* allocated cells */
+    int n_packed;		/* cells covered by the packed tree */
+    int n_deleted;		/* deleted cells */
+/* the packed tree nodes: Leaf level first, Root last */
+    struct mbr_cache_node *nodes;
+    int n_levels;
+    int level_first[MBR_CACHE_MAX_LEVELS];
+    int level_count[MBR_CACHE_MAX_LEVELS];
+/* the ROWID hash table: cell indices or -1 */
+    int *hash;
+    int hash_size;
+/* 1 if the cache has to be (re)loaded from the main table */
+    int stale;
+/* the sharing key: DB-file, table and column */
+    char *db_path;
+    char *table;
+    char *column;
+    int ref_count;
+    mbr_cache_mutex mutex;
+/* pointer to next element into the shared caches linked list */
+    struct mbr_cache *next;
 };
 
+/* the shared caches; protected by the cache semaphore */
+static struct mbr_cache *shared_caches = NULL;
+
 typedef struct MbrCacheStruct
 {
 /* extends the sqlite3_vtab struct */
@@ -185,6 +192,7 @@ typedef struct MbrCacheStruct
     char *table_name;		/* the main table to be cached */
     char *column_name;		/* the column to be cached */
     int error;			/* some previous error disables any operation */
+    int dirty;			/* the current transaction modified the cache */
 } MbrCache;
 typedef MbrCache *MbrCachePtr;
 
@@ -194,289 +202,530 @@ typedef struct MbrCacheCursortStruct
     MbrCachePtr pVtab;		/* Virtual table of this cursor */
     int eof;			/* the EOF marker */
 /* 
-positioning parameters while performing a cache search 
+the cells matching the current search, copied from the cache
 */
-    struct mbr_cache_page *current_page;
-    int current_block_index;
-    int current_cell_index;
+    struct mbr_cache_cell *results;
+    int n_results;
+    int max_results;
+    int current_index;
     struct mbr_cache_cell *current_cell;
-/* 
-the strategy to use:
-    0 = sequential scan
-    1 = find rowid
-    2 = spatial search
-*/
-    int strategy;
-/* the MBR to search for */
-    double minx;
-    double miny;
-    double maxx;
-    double maxy;
-/*
-the MBR search mode:
-    0 = WITHIN
-    1 = CONTAIN
-*/
-    int mbr_mode;
 } MbrCacheCursor;
 typedef MbrCacheCursor *MbrCacheCursorPtr;
 
-static unsigned int
-cache_bitmask (int x)
+static void
+cache_lock (struct mbr_cache *p)
 {
-/* return the bitmask corresponding to index X */
-    switch (x)
-      {
-      case 0:
-	  return 0x80000000;
-      case 1:
-	  return 0x40000000;
-      case 2:
-	  return 0x20000000;
-      case 3:
-	  return 0x10000000;
-      case 4:
-	  return 0x08000000;
-      case 5:
-	  return 0x04000000;
-      case 6:
-	  return 0x02000000;
-      case 7:
-	  return 0x01000000;
-      case 8:
-	  return 0x00800000;
-      case 9:
-	  return 0x00400000;
-      case 10:
-	  return 0x00200000;
-      case 11:
-	  return 0x00100000;
-      case 12:
-	  return 0x00080000;
-      case 13:
-	  return 0x00040000;
-      case 14:
-	  return 0x00020000;
-      case 15:
-	  return 0x00010000;
-      case 16:
-	  return 0x00008000;
-      case 17:
-	  return 0x00004000;
-      case 18:
-	  return 0x00002000;
-      case 19:
-	  return 0x00001000;
-      case 20:
-	  return 0x00000800;
-      case 21:
-	  return 0x00000400;
-      case 22:
-	  return 0x00000200;
-      case 23:
-	  return 0x00000100;
-      case 24:
-	  return 0x00000080;
-      case 25:
-	  return 0x00000040;
-      case 26:
-	  return 0x00000020;
-      case 27:
-	  return 0x00000010;
-      case 28:
-	  return 0x00000008;
-      case 29:
-	  return 0x00000004;
-      case 30:
-	  return 0x00000002;
-      case 31:
-	  return 0x00000001;
-      };
-    return 0x00000000;
+/* locking a cache */
+#if defined(_WIN32) && !defined(__MINGW32__)
+    EnterCriticalSection (&(p->mutex));
+#else
+    pthread_mutex_lock (&(p->mutex));
+#endif
+}
+
+static void
+cache_unlock (struct mbr_cache *p)
+{
+/* unlocking a cache */
+#if defined(_WIN32) && !defined(__MINGW32__)
+    LeaveCriticalSection (&(p->mutex));
+#else
+    pthread_mutex_unlock (&(p->mutex));
+#endif
+}
+
+static char *
+cache_strdup (const char *str)
+{
+/* duplicating a string (NULL safe) */
+    char *out;
+    if (str == NULL)
+	return NULL;
+    out = malloc (strlen (str) + 1);
+    strcpy (out, str);
+    return out;
 }
 
 static struct mbr_cache *
-cache_alloc (void)
+cache_alloc (const char *db_path, const char *table, const char *column)
 {
 /* allocates and initializes an empty cache struct */
     struct mbr_cache *p = malloc (sizeof (struct mbr_cache));
-    p->first = NULL;
-    p->last = NULL;
-    p->current = NULL;
+    p->cells = NULL;
+    p->n_cells = 0;
+    p->max_cells = 0;
+    p->n_packed = 0;
+    p->n_deleted = 0;
+    p->nodes = NULL;
+    p->n_levels = 0;
+    p->hash = NULL;
+    p->hash_size = 0;
+    p->stale = 1;
+    p->db_path = cache_strdup (db_path);
+    p->table = cache_strdup (table);
+    p->column = cache_strdup (column);
+    p->ref_count = 1;
+#if defined(_WIN32) && !defined(__MINGW32__)
+    InitializeCriticalSection (&(p->mutex));
+#else
+    pthread_mutex_init (&(p->mutex), NULL);
+#endif
+    p->next = NULL;
     return p;
 }
 
-static struct mbr_cache_page *
-cache_page_alloc (void)
+static void
+cache_reset (struct mbr_cache *p)
 {
-/* allocates and initializes a cache page */
-    int i;
-    struct mbr_cache_block *pb;
-    struct mbr_cache_page *p = malloc (sizeof (struct mbr_cache_page));
-    p->bitmap = 0x00000000;
-    p->next = NULL;
-    p->minx = DBL_MAX;
-    p->miny = DBL_MAX;
-    p->maxx = -DBL_MAX;
-    p->maxy = -DBL_MAX;
-    for (i = 0; i < 32; i++)
-      {
-	  pb = p->blocks + i;
-	  pb->bitmap = 0x00000000;
-	  pb->minx = DBL_MAX;
-	  pb->miny = DBL_MAX;
-	  pb->maxx = -DBL_MAX;
-	  pb->maxy = DBL_MAX;
-      }
-    p->max_rowid = LONG64_MIN;
-    p->min_rowid = LONG64_MAX;
-    return p;
+/* memory cleanup; emptying a cache */
+    if (p->cells)
+	free (p->cells);
+    if (p->nodes)
+	free (p->nodes);
+    if (p->hash)
+	free (p->hash);
+    p->cells = NULL;
+    p->n_cells = 0;
+    p->max_cells = 0;
+    p->n_packed = 0;
+    p->n_deleted = 0;
+    p->nodes = NULL;
+    p->n_levels = 0;
+    p->hash = NULL;
+    p->hash_size = 0;
 }
 
 static void
 cache_destroy (struct mbr_cache *p)
 {
-/* memory cleanup; destroying a cache and any page into the cache */
-    struct mbr_cache_page *pp;
-    struct mbr_cache_page *ppn;
+/* memory cleanup; destroying a cache */
     if (!p)
 	return;
-    pp = p->first;
-    while (pp)
-      {
-	  ppn = pp->next;
-	  free (pp);
-	  pp = ppn;
-      }
+    cache_reset (p);
+    if (p->db_path)
+	free (p->db_path);
+    if (p->table)
+	free (p->table);
+    if (p->column)
+	free (p->column);
+#if defined(_WIN32) && !defined(__MINGW32__)
+    DeleteCriticalSection (&(p->mutex));
+#else
+    pthread_mutex_destroy (&(p->mutex));
+#endif
     free (p);
 }
 
-static int
-cache_get_free_block (struct mbr_cache_page *pp)
+static struct mbr_cache *
+cache_acquire (sqlite3 * handle, const char *table, const char *column)
 {
-/* scans a cache page, returning the index of the first available block containing a free cell */
-    int ib;
-    for (ib = 0; ib < 32; ib++)
+/* 
+returns the cache of some Geometry column: an already existing
+shared cache if possible, otherwise a new (still empty) one
+*/
+    struct mbr_cache *p;
+    const char *db_path = sqlite3_db_filename (handle, "main");
+    if (db_path == NULL || *db_path == '\0')
       {
-	  if ((pp->bitmap & cache_bitmask (ib)) == 0x00000000)
-	      return ib;
+	  /* in-memory or temporary DB: never shared */
+	  return cache_alloc (NULL, table, column);
       }
-    return -1;
+    splite_cache_semaphore_lock ();
+    p = shared_caches;
+    while (p)
+      {
+	  if (strcmp (p->db_path, db_path) == 0
+	      && strcasecmp (p->table, table) == 0
+	      && strcasecmp (p->column, column) == 0)
+	    {
+		p->ref_count += 1;
+		splite_cache_semaphore_unlock ();
+		return p;
+	    }
+	  p = p->next;
+      }
+    p = cache_alloc (db_path, table, column);
+    p->next = shared_caches;
+    shared_caches = p;
+    splite_cache_semaphore_unlock ();
+    return p;
 }
 
 static void
-cache_fix_page_bitmap (struct mbr_cache_page *pp)
+cache_release (struct mbr_cache *p)
 {
-/* updating the cache page bitmap */
-    int ib;
-    for (ib = 0; ib < 32; ib++)
+/* releasing a cache; the last user destroys it */
+    struct mbr_cache *prev = NULL;
+    struct mbr_cache *pc;
+    if (p->db_path == NULL)
+      {
+	  /* a private cache */
+	  cache_destroy (p);
+	  return;
+      }
+    splite_cache_semaphore_lock ();
+    p->ref_count -= 1;
+    if (p->ref_count > 0)
+      {
+	  splite_cache_semaphore_unlock ();
+	  return;
+      }
+    pc = shared_caches;
+    while (pc)
       {
-	  if (pp->blocks[ib].bitmap == 0xffffffff)
+	  if (pc == p)
 	    {
-		/* all the cells into this block are used; marking the page bitmap */
-		pp->bitmap |= cache_bitmask (ib);
+		if (prev == NULL)
+		    shared_caches = p->next;
+		else
+		    prev->next = p->next;
+		break;
 	    }
+	  prev = pc;
+	  pc = pc->next;
       }
+    splite_cache_semaphore_unlock ();
+    cache_destroy (p);
 }
 
 static int
-cache_get_free_cell (struct mbr_cache_block *pb)
+cache_hash_slot (struct mbr_cache *p, sqlite3_int64 rowid)
 {
-/* scans a cache block, returning the index of the first free cell */
-    int ic;
-    for (ic = 0; ic < 32; ic++)
+/* 
+returns the hash slot of some ROWID: either the one already
+referencing it or the free one where it should be inserted
+*/
+    sqlite3_uint64 h = (sqlite3_uint64) rowid * 0x9E3779B97F4A7C15ULL;
+    int mask = p->hash_size - 1;
+    int slot = (int) (h >> 32) & mask;
+    while (1)
       {
-	  if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-	      return ic;
+	  int idx = p->hash[slot];
+	  if (idx < 0 || p->cells[idx].rowid == rowid)
+	      return slot;
+	  slot = (slot + 1) & mask;
       }
-    return -1;
 }
 
-static struct mbr_cache_page *
-cache_get_free_page (struct mbr_cache *p)
+static int
+cache_rehash (struct mbr_cache *p, int min_cells)
 {
-/* return a pointer to the first cache page containing a free cell */
-    struct mbr_cache_page *pp;
-    if (!(p->first))
-      {
-	  /* the cache is empty; so we surely need to allocate the first page */
-	  pp = cache_page_alloc ();
-	  p->first = pp;
-	  p->last = pp;
-	  p->current = pp;
-	  return pp;
-      }
-    if (p->current)
-      {
-	  /* checking if there is at least a free block into the current page */
-	  if (p->current->bitmap != 0xffffffff)
-	      return p->current;
-      }
-    pp = p->first;
-    while (pp)
+/* (re)building the ROWID hash table */
+    int i;
+    int size = 1024;
+    int *hash;
+    while (size < min_cells * 2)
+	size *= 2;
+    hash = malloc (sizeof (int) * size);
+    if (hash == NULL)
+	return 0;
+    for (i = 0; i < size; i++)
+	hash[i] = -1;
+    if (p->hash)
+	free (p->hash);
+    p->hash = hash;
+    p->hash_size = size;
+    for (i = 0; i < p->n_cells; i++)
       {
-	  /* scanning the page list in order to discover if there is an existing page not yet completely filled */
-	  if (pp->bitmap != 0xffffffff)
-	    {
-		p->current = pp;
-		return pp;
-	    }
-	  pp = pp->next;
+	  if (p->cells[i].valid)
+	      p->hash[cache_hash_slot (p, p->cells[i].rowid)] = i;
       }
-/* we have to allocate a new page */
-    pp = cache_page_alloc ();
-    p->last->next = pp;
-    p->last = pp;
-    p->current = pp;
-    return pp;
+    return 1;
 }
 
-static void
+static struct mbr_cache_cell *
+cache_find_by_rowid (struct mbr_cache *p, sqlite3_int64 rowid)
+{
+/* trying to find a row by rowid from the Mbr cache */
+    int idx;
+    if (p->hash_size == 0)
+	return NULL;
+    idx = p->hash[cache_hash_slot (p, rowid)];
+    if (idx < 0 || !(p->cells[idx].valid))
+	return NULL;
+    return p->cells + idx;
+}
+
+static int
 cache_insert_cell (struct mbr_cache *p, sqlite3_int64 rowid, double minx,
 		   double miny, double maxx, double maxy)
 {
-/* inserting a new cell */
-    struct mbr_cache_page *pp = cache_get_free_page (p);
-    int ib = cache_get_free_block (pp);
-    struct mbr_cache_block *pb = pp->blocks + ib;
-    int ic = cache_get_free_cell (pb);
-    struct mbr_cache_cell *pc = pb->cells + ic;
+/* appending a new cell to the unpacked tail */
+    struct mbr_cache_cell *pc;
+    if (p->n_cells == p->max_cells)
+      {
+	  int max = (p->max_cells == 0) ? 1024 : p->max_cells * 2;
+	  struct mbr_cache_cell *cells =
+	      realloc (p->cells, sizeof (struct mbr_cache_cell) * max);
+	  if (cells == NULL)
+	      return 0;
+	  p->cells = cells;
+	  p->max_cells = max;
+      }
+    if ((p->n_cells + 1) * 2 > p->hash_size)
+      {
+	  if (!cache_rehash (p, p->max_cells))
+	      return 0;
+      }
+    pc = p->cells + p->n_cells;
     pc->rowid = rowid;
     pc->minx = minx;
     pc->miny = miny;
     pc->maxx = maxx;
     pc->maxy = maxy;
-/* marking the cache cell as used into the block bitmap */
-    pb->bitmap |= cache_bitmask (ic);
-/* updating the cache block MBR */
-    if (pb->minx > minx)
-	pb->minx = minx;
-    if (pb->maxx < maxx)
-	pb->maxx = maxx;
-    if (pb->miny > miny)
-	pb->miny = miny;
-    if (pb->maxy < maxy)
-	pb->maxy = maxy;
-/* updating the cache page MBR */
-    if (pp->minx > minx)
-	pp->minx = minx;
-    if (pp->maxx < maxx)
-	pp->maxx = maxx;
-    if (pp->miny > miny)
-	pp->miny = miny;
-    if (pp->maxy < maxy)
-	pp->maxy = maxy;
-/* fixing the cache page bitmap */
-    cache_fix_page_bitmap (pp);
-/* updating min-max rowid into the cache page */
-    if (pp->min_rowid > rowid)
-	pp->min_rowid = rowid;
-    if (pp->max_rowid < rowid)
-	pp->max_rowid = rowid;
+    pc->valid = 1;
+    p->hash[cache_hash_slot (p, rowid)] = p->n_cells;
+    p->n_cells += 1;
+    return 1;
 }
 
-static struct mbr_cache *
-cache_load (sqlite3 * handle, const char *table, const char *column)
+static int
+cache_delete_cell (struct mbr_cache *p, sqlite3_int64 rowid)
+{
+/* trying to delete a row identified by rowid from the Mbr cache */
+    struct mbr_cache_cell *pc = cache_find_by_rowid (p, rowid);
+    if (pc == NULL)
+	return 0;
+    pc->valid = 0;
+    p->n_deleted += 1;
+    return 1;
+}
+
+static int
+cache_update_cell (struct mbr_cache *p, sqlite3_int64 rowid, double minx,
+		   double miny, double maxx, double maxy)
+{
+/* trying to update a row identified by rowid from the Mbr cache */
+    struct mbr_cache_cell *pc = cache_find_by_rowid (p, rowid);
+    if (pc == NULL)
+	return 0;
+    if (pc - p->cells >= p->n_packed)
+      {
+	  /* a tail cell: simply updating its MBR */
+	  pc->minx = minx;
+	  pc->miny = miny;
+	  pc->maxx = maxx;
+	  pc->maxy = maxy;
+	  return 1;
+      }
+/* a packed cell: moving it to the tail */
+    pc->valid = 0;
+    p->n_deleted += 1;
+    return cache_insert_cell (p, rowid, minx, miny, maxx, maxy);
+}
+
+static unsigned int
+cache_hilbert (unsigned int x, unsigned int y)
+{
+/* position of X,Y along a 65536 x 65536 Hilbert curve */
+    unsigned int n = 65536;
+    unsigned int s;
+    unsigned int rx;
+    unsigned int ry;
+    unsigned int t;
+    unsigned int d = 0;
+    for (s = n / 2; s > 0; s /= 2)
+      {
+	  rx = (x & s) > 0;
+	  ry = (y & s) > 0;
+	  d += s * s * ((3 * rx) ^ ry);
+	  if (ry == 0)
+	    {
+		if (rx == 1)
+		  {
+		      x = n - 1 - x;
+		      y = n - 1 - y;
+		  }
+		t = x;
+		x = y;
+		y = t;
+	    }
+      }
+    return d;
+}
+
+struct mbr_cache_sort
+{
+/* a cell to be sorted by its Hilbert code */
+    unsigned int key;
+    int index;
+};
+
+static int
+cmp_cache_sort (const void *p1, const void *p2)
+{
+/* compares two cells by Hilbert code [for QSORT] */
+    const struct mbr_cache_sort *s1 = (const struct mbr_cache_sort *) p1;
+    const struct mbr_cache_sort *s2 = (const struct mbr_cache_sort *) p2;
+    if (s1->key == s2->key)
+	return s1->index - s2->index;
+    if (s1->key > s2->key)
+	return 1;
+    return -1;
+}
+
+static void
+cache_node_init (struct mbr_cache_node *pn)
+{
+/* initializing an empty node MBR */
+    pn->minx = DBL_MAX;
+    pn->miny = DBL_MAX;
+    pn->maxx = -DBL_MAX;
+    pn->maxy = -DBL_MAX;
+}
+
+static void
+cache_node_extend (struct mbr_cache_node *pn, double minx, double miny,
+		   double maxx, double maxy)
+{
+/* extending a node MBR */
+    if (pn->minx > minx)
+	pn->minx = minx;
+    if (pn->miny > miny)
+	pn->miny = miny;
+    if (pn->maxx < maxx)
+	pn->maxx = maxx;
+    if (pn->maxy < maxy)
+	pn->maxy = maxy;
+}
+
+static int
+cache_pack (struct mbr_cache *p)
+{
+/* discarding deleted cells and rebuilding the packed tree */
+    int i;
+    int n = 0;
+    int level;
+    int count;
+    int total;
+    double minx = DBL_MAX;
+    double miny = DBL_MAX;
+    double maxx = -DBL_MAX;
+    double maxy = -DBL_MAX;
+    double scale_x;
+    double scale_y;
+    struct mbr_cache_sort *sort = NULL;
+    struct mbr_cache_cell *cells = NULL;
+    struct mbr_cache_node *nodes = NULL;
+
+/* compacting the valid cells, and computing the full extent */
+    for (i = 0; i < p->n_cells; i++)
+      {
+	  struct mbr_cache_cell *pc = p->cells + i;
+	  if (!(pc->valid))
+	      continue;
+	  p->cells[n++] = *pc;
+	  if (minx > pc->minx)
+	      minx = pc->minx;
+	  if (miny > pc->miny)
+	      miny = pc->miny;
+	  if (maxx < pc->maxx)
+	      maxx = pc->maxx;
+	  if (maxy < pc->maxy)
+	      maxy = pc->maxy;
+      }
+    p->n_cells = n;
+    p->n_deleted = 0;
+    p->n_packed = 0;
+    p->n_levels = 0;
+    if (p->nodes)
+	free (p->nodes);
+    p->nodes = NULL;
+
+    if (n > 0)
+      {
+	  /* sorting the cells by the Hilbert code of their center */
+	  sort = malloc (sizeof (struct mbr_cache_sort) * n);
+	  cells = malloc (sizeof (struct mbr_cache_cell) * p->max_cells);
+	  if (sort == NULL || cells == NULL)
+	      goto error;
+	  scale_x = (maxx > minx) ? 65535.0 / (maxx - minx) : 0.0;
+	  scale_y = (maxy > miny) ? 65535.0 / (maxy - miny) : 0.0;
+	  for (i = 0; i < n; i++)
+	    {
+		struct mbr_cache_cell *pc = p->cells + i;
+		double cx = ((pc->minx + pc->maxx) / 2.0 - minx) * scale_x;
+		double cy = ((pc->miny + pc->maxy) / 2.0 - miny) * scale_y;
+		sort[i].key =
+		    cache_hilbert ((unsigned int) cx, (unsigned int) cy);
+		sort[i].index = i;
+	    }
+	  qsort (sort, n, sizeof (struct mbr_cache_sort), cmp_cache_sort);
+	  for (i = 0; i < n; i++)
+	      cells[i] = p->cells[sort[i].index];
+	  free (sort);
+	  sort = NULL;
+	  free (p->cells);
+	  p->cells = cells;
+	  cells = NULL;
+
+	  /* counting the nodes of each level */
+	  total = 0;
+	  count = n;
+	  while (1)
+	    {
+		count = (count + MBR_CACHE_FANOUT - 1) / MBR_CACHE_FANOUT;
+		if (p->n_levels == MBR_CACHE_MAX_LEVELS)
+		    goto error;
+		p->level_first[p->n_levels] = total;
+		p->level_count[p->n_levels] = count;
+		p->n_levels += 1;
+		total += count;
+		if (count == 1)
+		    break;
+	    }
+	  nodes = malloc (sizeof (struct mbr_cache_node) * total);
+	  if (nodes == NULL)
+	      goto error;
+
+	  /* building the tree bottom-up */
+	  for (level = 0; level < p->n_levels; level++)
+	    {
+		struct mbr_cache_node *base = nodes + p->level_first[level];
+		for (i = 0; i < p->level_count[level]; i++)
+		    cache_node_init (base + i);
+		if (level == 0)
+		  {
+		      for (i = 0; i < n; i++)
+			{
+			    struct mbr_cache_cell *pc = p->cells + i;
+			    cache_node_extend (base + (i / MBR_CACHE_FANOUT),
+					       pc->minx, pc->miny, pc->maxx,
+					       pc->maxy);
+			}
+		  }
+		else
+		  {
+		      struct mbr_cache_node *child =
+			  nodes + p->level_first[level - 1];
+		      for (i = 0; i < p->level_count[level - 1]; i++)
+			{
+			    struct mbr_cache_node *pn = child + i;
+			    cache_node_extend (base + (i / MBR_CACHE_FANOUT),
+					       pn->minx, pn->miny, pn->maxx,
+					       pn->maxy);
+			}
+		  }
+	    }
+	  p->nodes = nodes;
+	  p->n_packed = n;
+      }
+    return cache_rehash (p, p->max_cells);
+
+  error:
+    if (sort)
+	free (sort);
+    if (cells)
+	free (cells);
+    if (nodes)
+	free (nodes);
+/* leaving all the cells into the unpacked tail */
+    p->n_levels = 0;
+    return cache_rehash (p, p->max_cells);
+}
+
+static int
+cache_load (sqlite3 * handle, struct mbr_cache *p_cache)
 {
 /* 
 initial loading the MBR cache
@@ -495,11 +744,10 @@ retrieving any existing entity from the main table
     int v3;
     int v4;
     int v5;
-    struct mbr_cache *p_cache;
     char *xcolumn;
     char *xtable;
-    xcolumn = gaiaDoubleQuotedSql (column);
-    xtable = gaiaDoubleQuotedSql (table);
+    xcolumn = gaiaDoubleQuotedSql (p_cache->column);
+    xtable = gaiaDoubleQuotedSql (p_cache->table);
     sql_statement =
 	sqlite3_mprintf ("SELECT ROWID, MbrMinX(\"%s\"), MbrMinY(\"%s\"), "
 			 "MbrMaxX(\"%s\"), MbrMaxY(\"%s\") FROM \"%s\"",
@@ -514,9 +762,9 @@ retrieving any existing entity from the main table
       {
 /* some error occurred */
 	  spatialite_e ("cache SQL error: %s\n", sqlite3_errmsg (handle));
-	  return NULL;
+	  return 0;
       }
-    p_cache = cache_alloc ();
+    cache_reset (p_cache);
     while (1)
       {
 	  ret = sqlite3_step (stmt);
@@ -533,22 +781,23 @@ retrieving any existing entity from the main table
 		    v1 = 1;
 		if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
 		    v2 = 1;
-		if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
+		if (sqlite3_column_type (stmt, 2) == SQLITE_FLOAT)
 		    v3 = 1;
-		if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
+		if (sqlite3_column_type (stmt, 3) == SQLITE_FLOAT)
 		    v4 = 1;
-		if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
+		if (sqlite3_column_type (stmt, 4) == SQLITE_FLOAT)
 		    v5 = 1;
 		if (v1 && v2 && v3 && v4 && v5)
 		  {
 		      /* ok, this entity is a valid one; inserting them into the MBR's cache */
-		      rowid = sqlite3_column_int (stmt, 0);
+		      rowid = sqlite3_column_int64 (stmt, 0);
 		      minx = sqlite3_column_double (stmt, 1);
 		      miny = sqlite3_column_double (stmt, 2);
 		      maxx = sqlite3_column_double (stmt, 3);
 		      maxy = sqlite3_column_double (stmt, 4);
-		      cache_insert_cell (p_cache, rowid, minx, miny, maxx,
-					 maxy);
+		      if (!cache_insert_cell
+			  (p_cache, rowid, minx, miny, maxx, maxy))
+			  goto error;
 		  }
 	    }
 	  else
@@ -556,310 +805,207 @@ retrieving any existing entity from the main table
 /* some unexpected error occurred */
 		spatialite_e ("sqlite3_step() error: %s\n",
 			      sqlite3_errmsg (handle));
-		sqlite3_finalize (stmt);
-		cache_destroy (p_cache);
-		return NULL;
+		goto error;
 	    }
       }
 /* we have now to finalize the query [memory cleanup] */
     sqlite3_finalize (stmt);
-    return p_cache;
+    if (!cache_pack (p_cache))
+	goto stop;
+    p_cache->stale = 0;
+    return 1;
+
+  error:
+    sqlite3_finalize (stmt);
+  stop:
+    cache_reset (p_cache);
+    return 0;
 }
 
 static int
-cache_find_next_cell (struct mbr_cache_page **page, int *i_block, int *i_cell,
-		      struct mbr_cache_cell **cell)
+cache_ready (sqlite3 * handle, struct mbr_cache *p)
 {
-/* finding next cached cell */
-    struct mbr_cache_page *pp = *page;
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-    int sib = *i_block;
-    int sic = *i_cell;
-    while (pp)
-      {
-	  for (ib = sib; ib < 32; ib++)
-	    {
-		pb = pp->blocks + ib;
-		for (ic = sic; ic < 32; ic++)
-		  {
-		      if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-			  continue;
-		      pc = pb->cells + ic;
-		      if (pc == *cell)
-			{
-			    /* this one is the current cell */
-			    continue;
-			}
-		      /* next cell found */
-		      *page = pp;
-		      *i_block = ib;
-		      *i_cell = ic;
-		      *cell = pc;
-		      return 1;
-		  }
-		sic = 0;
-	    }
-	  sib = 0;
-	  pp = pp->next;
-      }
-    return 0;
+/* 
+making the (locked) cache ready to be used: (re)loading
+it if required, and packing it if the tail grew too much
+*/
+    int tail;
+    if (p->stale)
+	return cache_load (handle, p);
+    tail = p->n_cells - p->n_packed;
+    if (tail > MBR_CACHE_TAIL + (p->n_packed / 8)
+	|| p->n_deleted > MBR_CACHE_TAIL + (p->n_cells / 4))
+	return cache_pack (p);
+    return 1;
 }
 
 static int
-cache_find_next_mbr (struct mbr_cache_page **page, int *i_block, int *i_cell,
-		     struct mbr_cache_cell **cell, double minx, double miny,
-		     double maxx, double maxy, int mode)
+cache_cell_match (struct mbr_cache_cell *pc, double minx, double miny,
+		  double maxx, double maxy, int mode)
 {
-/* finding next cached cell */
-    struct mbr_cache_page *pp = *page;
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-    int sib = *i_block;
-    int sic = *i_cell;
-    int ok_mbr;
-    while (pp)
+/* checking if a cell satisfies the MBR spatial relation */
+    if (!(pc->valid))
+	return 0;
+    if (mode == GAIA_FILTER_MBR_INTERSECTS)
       {
-	  ok_mbr = 0;
-	  if (pp->maxx >= minx && pp->minx <= maxx && pp->maxy >= miny
-	      && pp->miny <= maxy)
-	      ok_mbr = 1;
-	  if (ok_mbr)
-	    {
-		for (ib = sib; ib < 32; ib++)
-		  {
-		      pb = pp->blocks + ib;
-		      ok_mbr = 0;
-		      if (pb->maxx >= minx && pb->minx <= maxx
-			  && pb->maxy >= miny && pb->miny <= maxy)
-			  ok_mbr = 1;
-		      if (ok_mbr)
-			{
-			    for (ic = sic; ic < 32; ic++)
-			      {
-				  if ((pb->bitmap & cache_bitmask (ic)) ==
-				      0x00000000)
-				      continue;
-				  pc = pb->cells + ic;
-				  ok_mbr = 0;
-				  if (mode == GAIA_FILTER_MBR_INTERSECTS)
-				    {
-					/* MBR INTERSECTS */
-					if (pc->maxx >= minx && pc->minx <= maxx
-					    && pc->maxy >= miny
-					    && pc->miny <= maxy)
-					    ok_mbr = 1;
-				    }
-				  else if (mode == GAIA_FILTER_MBR_CONTAINS)
-				    {
-					/* MBR CONTAINS */
-					if (minx >= pc->minx && maxx <= pc->maxx
-					    && miny >= pc->miny
-					    && maxy <= pc->maxy)
-					    ok_mbr = 1;
-				    }
-				  else
-				    {
-					/* MBR WITHIN */
-					if (pc->minx >= minx && pc->maxx <= maxx
-					    && pc->miny >= miny
-					    && pc->maxy <= maxy)
-					    ok_mbr = 1;
-				    }
-				  if (ok_mbr)
-				    {
-					if (pc == *cell)
-					  {
-					      /* this one is the current cell */
-					      continue;
-					  }
-					/* next cell found */
-					*page = pp;
-					*i_block = ib;
-					*i_cell = ic;
-					*cell = pc;
-					return 1;
-				    }
-			      }
-			}
-		      sic = 0;
-		  }
-	    }
-	  sib = 0;
-	  pp = pp->next;
+	  /* MBR INTERSECTS */
+	  if (pc->maxx >= minx && pc->minx <= maxx
+	      && pc->maxy >= miny && pc->miny <= maxy)
+	      return 1;
+      }
+    else if (mode == GAIA_FILTER_MBR_CONTAINS)
+      {
+	  /* MBR CONTAINS */
+	  if (minx >= pc->minx && maxx <= pc->maxx
+	      && miny >= pc->miny && maxy <= pc->maxy)
+	      return 1;
+      }
+    else
+      {
+	  /* MBR WITHIN */
+	  if (pc->minx >= minx && pc->maxx <= maxx
+	      && pc->miny >= miny && pc->maxy <= maxy)
+	      return 1;
       }
     return 0;
 }
 
-static struct mbr_cache_cell *
-cache_find_by_rowid (struct mbr_cache_page *pp, sqlite3_int64 rowid)
+static int
+cache_node_match (struct mbr_cache_node *pn, double minx, double miny,
+		  double maxx, double maxy, int mode)
 {
-/* trying to find a row by rowid from the Mbr cache */
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-    while (pp)
+/* checking if a node could contain any cell satisfying the relation */
+    if (mode == GAIA_FILTER_MBR_CONTAINS)
       {
-	  if (rowid >= pp->min_rowid && rowid <= pp->max_rowid)
-	    {
-		for (ib = 0; ib < 32; ib++)
-		  {
-		      pb = pp->blocks + ib;
-		      for (ic = 0; ic < 32; ic++)
-			{
-			    if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-				continue;
-			    pc = pb->cells + ic;
-			    if (pc->rowid == rowid)
-				return pc;
-			}
-		  }
-	    }
-	  pp = pp->next;
+	  /* some descendant must contain the search MBR */
+	  if (minx >= pn->minx && maxx <= pn->maxx
+	      && miny >= pn->miny && maxy <= pn->maxy)
+	      return 1;
+	  return 0;
       }
+/* some descendant must intersect the search MBR */
+    if (pn->maxx >= minx && pn->minx <= maxx
+	&& pn->maxy >= miny && pn->miny <= maxy)
+	return 1;
     return 0;
 }
 
-static void
-cache_update_page (struct mbr_cache_page *pp, int i_block)
+static int
+cursor_add_result (MbrCacheCursorPtr cursor, struct mbr_cache_cell *pc)
 {
-/* updating the cache block and cache page MBR after a DELETE or UPDATE occurred */
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-/* updating the cache block MBR */
-    pb = pp->blocks + i_block;
-    pb->minx = DBL_MAX;
-    pb->miny = DBL_MAX;
-    pb->maxx = -DBL_MAX;
-    pb->maxy = -DBL_MAX;
-    for (ic = 0; ic < 32; ic++)
+/* copying a matching cell into the cursor results */
+    if (cursor->n_results == cursor->max_results)
       {
-	  if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-	      continue;
-	  pc = pb->cells + ic;
-	  if (pb->minx > pc->minx)
-	      pb->minx = pc->minx;
-	  if (pb->miny > pc->miny)
-	      pb->miny = pc->miny;
-	  if (pb->maxx < pc->maxx)
-	      pb->maxx = pc->maxx;
-	  if (pb->maxy < pc->maxy)
-	      pb->maxy = pc->maxy;
-      }
-/* updating the cache page MBR */
-    pp->minx = DBL_MAX;
-    pp->miny = DBL_MAX;
-    pp->maxx = -DBL_MAX;
-    pp->maxy = -DBL_MAX;
-    pp->min_rowid = LONG64_MAX;
-    pp->max_rowid = LONG64_MIN;
-    for (ib = 0; ib < 32; ib++)
-      {
-	  pb = pp->blocks + ib;
-	  for (ic = 0; ic < 32; ic++)
-	    {
-		if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-		    continue;
-		pc = pb->cells + ic;
-		if (pp->minx > pc->minx)
-		    pp->minx = pc->minx;
-		if (pp->miny > pc->miny)
-		    pp->miny = pc->miny;
-		if (pp->maxx < pc->maxx)
-		    pp->maxx = pc->maxx;
-		if (pp->maxy < pc->maxy)
-		    pp->maxy = pc->maxy;
-		if (pp->min_rowid > pc->rowid)
-		    pp->min_rowid = pc->rowid;
-		if (pp->max_rowid < pc->rowid)
-		    pp->max_rowid = pc->rowid;
-	    }
+	  int max = (cursor->max_results == 0) ? 64 : cursor->max_results * 2;
+	  struct mbr_cache_cell *results =
+	      sqlite3_realloc (cursor->results,
+			       sizeof (struct mbr_cache_cell) * max);
+	  if (results == NULL)
+	      return 0;
+	  cursor->results = results;
+	  cursor->max_results = max;
       }
+    cursor->results[cursor->n_results] = *pc;
+    cursor->n_results += 1;
+    return 1;
 }
 
 static int
-cache_delete_cell (struct mbr_cache_page *pp, sqlite3_int64 rowid)
+cache_search_node (MbrCacheCursorPtr cursor, struct mbr_cache *p, int level,
+		   int index, double minx, double miny, double maxx,
+		   double maxy, int mode)
 {
-/* trying to delete a row identified by rowid from the Mbr cache */
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-    while (pp)
+/* recursively searching the packed tree */
+    int i;
+    int first = index * MBR_CACHE_FANOUT;
+    int last = first + MBR_CACHE_FANOUT;
+    if (level == 0)
       {
-	  if (rowid >= pp->min_rowid && rowid <= pp->max_rowid)
+	  /* a Leaf node: checking the cells */
+	  if (last > p->n_packed)
+	      last = p->n_packed;
+	  for (i = first; i < last; i++)
 	    {
-		for (ib = 0; ib < 32; ib++)
+		struct mbr_cache_cell *pc = p->cells + i;
+		if (cache_cell_match (pc, minx, miny, maxx, maxy, mode))
 		  {
-		      pb = pp->blocks + ib;
-		      for (ic = 0; ic < 32; ic++)
-			{
-			    if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-				continue;
-			    pc = pb->cells + ic;
-			    if (pc->rowid == rowid)
-			      {
-				  /* marking the cell as free */
-				  pb->bitmap &= ~(cache_bitmask (ic));
-				  /* marking the block as not full */
-				  pp->bitmap &= ~(cache_bitmask (ib));
-				  /* updating the cache block and cache page MBR */
-				  cache_update_page (pp, ib);
-				  return 1;
-			      }
-			}
+		      if (!cursor_add_result (cursor, pc))
+			  return 0;
 		  }
 	    }
-	  pp = pp->next;
+	  return 1;
       }
-    return 0;
+/* an internal node: descending into the matching children */
+    if (last > p->level_count[level - 1])
+	last = p->level_count[level - 1];
+    for (i = first; i < last; i++)
+      {
+	  struct mbr_cache_node *pn =
+	      p->nodes + p->level_first[level - 1] + i;
+	  if (!cache_node_match (pn, minx, miny, maxx, maxy, mode))
+	      continue;
+	  if (!cache_search_node
+	      (cursor, p, level - 1, i, minx, miny, maxx, maxy, mode))
+	      return 0;
+      }
+    return 1;
 }
 
 static int
-cache_update_cell (struct mbr_cache_page *pp, sqlite3_int64 rowid, double minx,
-		   double miny, double maxx, double maxy)
+cache_search (MbrCacheCursorPtr cursor, struct mbr_cache *p, int strategy,
+	      sqlite3_int64 rowid, double minx, double miny, double maxx,
+	      double maxy, int mode)
 {
-/* trying to update a row identified by rowid from the Mbr cache */
-    struct mbr_cache_block *pb;
-    struct mbr_cache_cell *pc;
-    int ib;
-    int ic;
-    while (pp)
+/* 
+collecting all the cells matching the current search
+the cache is expected to be already locked and ready
+*/
+    int i;
+    cursor->n_results = 0;
+    if (strategy == 0)
       {
-	  if (rowid >= pp->min_rowid && rowid <= pp->max_rowid)
+	  /* unfiltered mode */
+	  for (i = 0; i < p->n_cells; i++)
 	    {
-		for (ib = 0; ib < 32; ib++)
-		  {
-		      pb = pp->blocks + ib;
-		      for (ic = 0; ic < 32; ic++)
-			{
-			    if ((pb->bitmap & cache_bitmask (ic)) == 0x00000000)
-				continue;
-			    pc = pb->cells + ic;
-			    if (pc->rowid == rowid)
-			      {
-				  /* updating the cell MBR */
-				  pc->minx = minx;
-				  pc->miny = miny;
-				  pc->maxx = maxx;
-				  pc->maxy = maxy;
-				  /* updating the cache block and cache page MBR */
-				  cache_update_page (pp, ib);
-				  return 1;
-			      }
-			}
-		  }
+		struct mbr_cache_cell *pc = p->cells + i;
+		if (!(pc->valid))
+		    continue;
+		if (!cursor_add_result (cursor, pc))
+		    return 0;
 	    }
-	  pp = pp->next;
+	  return 1;
       }
-    return 0;
+    if (strategy == 1)
+      {
+	  /* filtering by ROWID */
+	  struct mbr_cache_cell *pc = cache_find_by_rowid (p, rowid);
+	  if (pc == NULL)
+	      return 1;
+	  return cursor_add_result (cursor, pc);
+      }
+/* filtering by MBR spatial relation: the packed tree first */
+    if (p->n_levels > 0)
+      {
+	  int root = p->n_levels - 1;
+	  struct mbr_cache_node *pn = p->nodes + p->level_first[root];
+	  if (cache_node_match (pn, minx, miny, maxx, maxy, mode))
+	    {
+		if (!cache_search_node
+		    (cursor, p, root, 0, minx, miny, maxx, maxy, mode))
+		    return 0;
+	    }
+      }
+/* then the unpacked tail */
+    for (i = p->n_packed; i < p->n_cells; i++)
+      {
+	  struct mbr_cache_cell *pc = p->cells + i;
+	  if (cache_cell_match (pc, minx, miny, maxx, maxy, mode))
+	    {
+		if (!cursor_add_result (cursor, pc))
+		    return 0;
+	    }
+      }
+    return 1;
 }
 
 static int
@@ -899,6 +1045,7 @@ mbrc_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
     p_vt->table_name = NULL;
     p_vt->column_name = NULL;
     p_vt->cache = NULL;
+    p_vt->dirty = 0;
 /* checking for table_name and geo_column_name */
     if (argc == 5)
       {
@@ -1015,6 +1162,8 @@ mbrc_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
 	  return SQLITE_ERROR;
       }
     sqlite3_free (sql_statement);
+/* attaching the (possibly shared) cache; it will be loaded on first use */
+    p_vt->cache = cache_acquire (db, p_vt->table_name, p_vt->column_name);
     *ppVTab = (sqlite3_vtab *) p_vt;
     return SQLITE_OK;
 }
@@ -1098,7 +1247,7 @@ mbrc_disconnect (sqlite3_vtab * pVTab)
 /* disconnects the virtual table */
     MbrCachePtr p_vt = (MbrCachePtr) pVTab;
     if (p_vt->cache)
-	cache_destroy (p_vt->cache);
+	cache_release (p_vt->cache);
     if (p_vt->table_name)
 	sqlite3_free (p_vt->table_name);
     if (p_vt->column_name)
@@ -1115,53 +1264,14 @@ mbrc_destroy (sqlite3_vtab * pVTab)
 }
 
 static void
-mbrc_read_row_unfiltered (MbrCacheCursorPtr cursor)
+mbrc_read_row (MbrCacheCursorPtr cursor)
 {
-/* trying to read the next row from the Mbr cache - unfiltered mode */
-    struct mbr_cache_page *page = cursor->current_page;
-    struct mbr_cache_cell *cell = cursor->current_cell;
-    int i_block = cursor->current_block_index;
-    int i_cell = cursor->current_cell_index;
-    if (cache_find_next_cell (&page, &i_block, &i_cell, &cell))
+/* trying to read the next row from the search results */
+    if (cursor->current_index < cursor->n_results)
       {
-	  cursor->current_page = page;
-	  cursor->current_block_index = i_block;
-	  cursor->current_cell_index = i_cell;
-	  cursor->current_cell = cell;
+	  cursor->current_cell = cursor->results + cursor->current_index;
+	  cursor->current_index += 1;
       }
-    else
-	cursor->eof = 1;
-}
-
-static void
-mbrc_read_row_filtered (MbrCacheCursorPtr cursor)
-{
-/* trying to read the next row from the Mbr cache - spatially filter mode */
-    struct mbr_cache_page *page = cursor->current_page;
-    struct mbr_cache_cell *cell = cursor->current_cell;
-    int i_block = cursor->current_block_index;
-    int i_cell = cursor->current_cell_index;
-    if (cache_find_next_mbr
-	(&page, &i_block, &i_cell, &cell, cursor->minx, cursor->miny,
-	 cursor->maxx, cursor->maxy, cursor->mbr_mode))
-      {
-	  cursor->current_page = page;
-	  cursor->current_block_index = i_block;
-	  cursor->current_cell_index = i_cell;
-	  cursor->current_cell = cell;
-      }
-    else
-	cursor->eof = 1;
-}
-
-static void
-mbrc_read_row_by_rowid (MbrCacheCursorPtr cursor, sqlite3_int64 rowid)
-{
-/* trying to find a row by rowid from the Mbr cache */
-    struct mbr_cache_cell *cell =
-	cache_find_by_rowid (cursor->pVtab->cache->first, rowid);
-    if (cell)
-	cursor->current_cell = cell;
     else
       {
 	  cursor->current_cell = NULL;
@@ -1179,20 +1289,14 @@ mbrc_open (sqlite3_vtab * pVTab, sqlite3_vtab_cursor ** ppCursor)
     if (cursor == NULL)
 	return SQLITE_ERROR;
     cursor->pVtab = p_vt;
-    if (p_vt->error)
-      {
-	  cursor->eof = 1;
-	  *ppCursor = (sqlite3_vtab_cursor *) cursor;
-	  return SQLITE_OK;
-      }
-    if (!(p_vt->cache))
-	p_vt->cache =
-	    cache_load (p_vt->db, p_vt->table_name, p_vt->column_name);
-    cursor->current_page = cursor->pVtab->cache->first;
-    cursor->current_block_index = 0;
-    cursor->current_cell_index = 0;
+    cursor->results = NULL;
+    cursor->n_results = 0;
+    cursor->max_results = 0;
+    cursor->current_index = 0;
     cursor->current_cell = NULL;
     cursor->eof = 0;
+    if (p_vt->error)
+	cursor->eof = 1;
     *ppCursor = (sqlite3_vtab_cursor *) cursor;
     return SQLITE_OK;
 }
@@ -1201,6 +1305,9 @@ static int
 mbrc_close (sqlite3_vtab_cursor * pCursor)
 {
 /* closing the cursor */
+    MbrCacheCursorPtr cursor = (MbrCacheCursorPtr) pCursor;
+    if (cursor->results)
+	sqlite3_free (cursor->results);
     sqlite3_free (pCursor);
     return SQLITE_OK;
 }
@@ -1211,70 +1318,60 @@ mbrc_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 {
 /* setting up a cursor filter */
     MbrCacheCursorPtr cursor = (MbrCacheCursorPtr) pCursor;
+    struct mbr_cache *cache = cursor->pVtab->cache;
+    sqlite3_int64 rowid = 0;
+    double minx = 0.0;
+    double miny = 0.0;
+    double maxx = 0.0;
+    double maxy = 0.0;
+    int mode = 0;
+    int ok;
     if (idxStr || argc)
 	idxStr = idxStr;	/* unused arg warning suppression */
-    if (cursor->pVtab->error)
-      {
-	  cursor->eof = 1;
-	  return SQLITE_OK;
-      }
-    cursor->current_page = cursor->pVtab->cache->first;
-    cursor->current_block_index = 0;
-    cursor->current_cell_index = 0;
+    cursor->n_results = 0;
+    cursor->current_index = 0;
     cursor->current_cell = NULL;
-    cursor->eof = 0;
-    cursor->strategy = idxNum;
-    if (idxNum == 0)
-      {
-	  /* unfiltered mode */
-	  mbrc_read_row_unfiltered (cursor);
-	  return SQLITE_OK;
-      }
+    cursor->eof = 1;
+    if (cursor->pVtab->error)
+	return SQLITE_OK;
     if (idxNum == 1)
       {
 	  /* filtering by ROWID */
-	  sqlite3_int64 rowid = sqlite3_value_int64 (argv[0]);
-	  mbrc_read_row_by_rowid (cursor, rowid);
-	  return SQLITE_OK;
+	  rowid = sqlite3_value_int64 (argv[0]);
       }
-    if (idxNum == 2)
+    else if (idxNum == 2)
       {
 	  /* filtering by MBR spatial relation */
 	  unsigned char *p_blob;
 	  int n_bytes;
-	  double minx;
-	  double miny;
-	  double maxx;
-	  double maxy;
-	  int mode;
 	  if (sqlite3_value_type (argv[0]) != SQLITE_BLOB)
-	      cursor->eof = 1;
-	  else
-	    {
-		p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
-		n_bytes = sqlite3_value_bytes (argv[0]);
-		if (gaiaParseFilterMbr
-		    (p_blob, n_bytes, &minx, &miny, &maxx, &maxy, &mode))
-		  {
-		      if (mode == GAIA_FILTER_MBR_WITHIN
-			  || mode == GAIA_FILTER_MBR_CONTAINS
-			  || mode == GAIA_FILTER_MBR_INTERSECTS)
-			{
-			    cursor->minx = minx;
-			    cursor->miny = miny;
-			    cursor->maxx = maxx;
-			    cursor->maxy = maxy;
-			    cursor->mbr_mode = mode;
-			    mbrc_read_row_filtered (cursor);
-			}
-		      else
-			  cursor->eof = 1;
-		  }
-	    }
+	      return SQLITE_OK;
+	  p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
+	  n_bytes = sqlite3_value_bytes (argv[0]);
+	  if (!gaiaParseFilterMbr
+	      (p_blob, n_bytes, &minx, &miny, &maxx, &maxy, &mode))
+	      return SQLITE_OK;
+	  if (mode != GAIA_FILTER_MBR_WITHIN
+	      && mode != GAIA_FILTER_MBR_CONTAINS
+	      && mode != GAIA_FILTER_MBR_INTERSECTS)
+	      return SQLITE_OK;
+      }
+    else if (idxNum != 0)
+      {
+	  /* illegal query mode */
 	  return SQLITE_OK;
       }
-/* illegal query mode */
-    cursor->eof = 1;
+/* collecting the matching cells */
+    cache_lock (cache);
+    ok = cache_ready (cursor->pVtab->db, cache);
+    if (ok)
+	ok = cache_search (cursor, cache, idxNum, rowid, minx, miny, maxx,
+			   maxy, mode);
+    cache_unlock (cache);
+    if (!ok)
+	return SQLITE_NOMEM;
+    cursor->eof = 0;
+    mbrc_read_row (cursor);
     return SQLITE_OK;
 }
 
@@ -1288,12 +1385,7 @@ mbrc_next (sqlite3_vtab_cursor * pCursor)
 	  cursor->eof = 1;
 	  return SQLITE_OK;
       }
-    if (cursor->strategy == 0)
-	mbrc_read_row_unfiltered (cursor);
-    else if (cursor->strategy == 2)
-	mbrc_read_row_filtered (cursor);
-    else
-	cursor->eof = 1;
+    mbrc_read_row (cursor);
     return SQLITE_OK;
 }
 
@@ -1351,6 +1443,7 @@ mbrc_rowid (sqlite3_vtab_cursor * pCursor, sqlite_int64 * pRowid)
     return SQLITE_OK;
 }
 
+
 static int
 mbrc_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 	     sqlite_int64 * pRowid)
@@ -1365,21 +1458,26 @@ mbrc_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
     double maxy;
     int mode;
     int illegal = 0;
+    int ok = 1;
     MbrCachePtr p_vtab = (MbrCachePtr) pVTab;
+    struct mbr_cache *cache = p_vtab->cache;
     if (pRowid)
 	pRowid = pRowid;	/* unused arg warning suppression */
     if (p_vtab->error)
 	return SQLITE_OK;
-    if (!(p_vtab->cache))
-	p_vtab->cache =
-	    cache_load (p_vtab->db, p_vtab->table_name, p_vtab->column_name);
+    cache_lock (cache);
+    if (cache->stale)
+      {
+	  /* loading the cache: the current change is already visible */
+	  cache_load (p_vtab->db, cache);
+      }
     if (argc == 1)
       {
 	  /* performing a DELETE */
 	  if (sqlite3_value_type (argv[0]) == SQLITE_INTEGER)
 	    {
 		rowid = sqlite3_value_int64 (argv[0]);
-		cache_delete_cell (p_vtab->cache->first, rowid);
+		cache_delete_cell (cache, rowid);
 	    }
 	  else
 	      illegal = 1;
@@ -1404,12 +1502,10 @@ mbrc_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 			      {
 				  if (mode == GAIA_FILTER_MBR_DECLARE)
 				    {
-					if (!cache_find_by_rowid
-					    (p_vtab->cache->first, rowid))
-					    cache_insert_cell (p_vtab->cache,
-							       rowid, minx,
-							       miny, maxx,
-							       maxy);
+					if (!cache_find_by_rowid (cache, rowid))
+					    ok = cache_insert_cell (cache, rowid,
+								    minx, miny,
+								    maxx, maxy);
 				    }
 				  else
 				      illegal = 1;
@@ -1440,9 +1536,9 @@ mbrc_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 				 &mode))
 			      {
 				  if (mode == GAIA_FILTER_MBR_DECLARE)
-				      cache_update_cell (p_vtab->cache->first,
-							 rowid, minx, miny,
-							 maxx, maxy);
+				      ok = cache_update_cell (cache, rowid,
+							      minx, miny,
+							      maxx, maxy);
 				  else
 				      illegal = 1;
 			      }
@@ -1456,8 +1552,15 @@ mbrc_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 		    illegal = 1;
 	    }
       }
+    if (!ok)
+      {
+	  /* out of memory: the cache will be reloaded on next use */
+	  cache->stale = 1;
+      }
+    cache_unlock (cache);
     if (illegal)
 	return SQLITE_MISMATCH;
+    p_vtab->dirty = 1;
     return SQLITE_OK;
 }
 
@@ -1465,8 +1568,8 @@ static int
 mbrc_begin (sqlite3_vtab * pVTab)
 {
 /* BEGIN TRANSACTION */
-    if (pVTab)
-	pVTab = pVTab;		/* unused arg warning suppression */
+    MbrCachePtr p_vtab = (MbrCachePtr) pVTab;
+    p_vtab->dirty = 0;
     return SQLITE_OK;
 }
 
@@ -1482,18 +1585,25 @@ mbrc_sync (sqlite3_vtab * pVTab)
 static int
 mbrc_commit (sqlite3_vtab * pVTab)
 {
-/* BEGIN TRANSACTION */
-    if (pVTab)
-	pVTab = pVTab;		/* unused arg warning suppression */
+/* COMMIT TRANSACTION */
+    MbrCachePtr p_vtab = (MbrCachePtr) pVTab;
+    p_vtab->dirty = 0;
     return SQLITE_OK;
 }
 
 static int
 mbrc_rollback (sqlite3_vtab * pVTab)
 {
-/* BEGIN TRANSACTION */
-    if (pVTab)
-	pVTab = pVTab;		/* unused arg warning suppression */
+/* ROLLBACK TRANSACTION */
+    MbrCachePtr p_vtab = (MbrCachePtr) pVTab;
+    if (p_vtab->dirty && p_vtab->cache)
+      {
+	  /* discarding the changes: the cache will be reloaded on next use */
+	  cache_lock (p_vtab->cache);
+	  p_vtab->cache->stale = 1;
+	  cache_unlock (p_vtab->cache);
+      }
+    p_vtab->dirty = 0;
     return SQLITE_OK;
 }
 
@@ -3652,6 +3652,199 @@ createTemporaryGeometryColumns (void *p_sqlite, const char *db_prefix)
     return 1;
 }
 
+static int
+check_incremental_statistics (sqlite3 * sqlite, const char *table,
+			      const char *column)
+{
+/* checking if Incremental Statistics are enabled on some Spatial Column */
+    int ret;
+    int i;
+    char **results;
+    int rows;
+    int columns;
+    int count = 0;
+    char *trigger;
+    char *sql_statement;
+
+    trigger = sqlite3_mprintf ("tsi_%s_%s", table, column);
+    sql_statement =
+	sqlite3_mprintf ("SELECT Count(*) FROM main.sqlite_master "
+			 "WHERE type = 'trigger' AND Lower(name) = Lower(%Q)",
+			 trigger);
+    sqlite3_free (trigger);
+    ret =
+	sqlite3_get_table (sqlite, sql_statement, &results, &rows, &columns,
+			   NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    for (i = 1; i <= rows; i++)
+	count = atoi (results[(i * columns) + 0]);
+    sqlite3_free_table (results);
+    if (count > 0)
+	return 1;
+    return 0;
+}
+
+static int
+drop_incremental_statistics_triggers (sqlite3 * sqlite, const char *table,
+				      const char *column, char **errMsg)
+{
+/* deleting the Incremental Statistics triggers [if any] */
+    int ret;
+    int i;
+    char *raw;
+    char *quoted_trigger;
+    char *sql_statement;
+    const char *prefix[] = { "tsi", "tsu", "tsd" };
+
+    for (i = 0; i < 3; i++)
+      {
+	  raw = sqlite3_mprintf ("%s_%s_%s", prefix[i], table, column);
+	  quoted_trigger = gaiaDoubleQuotedSql (raw);
+	  sqlite3_free (raw);
+	  sql_statement =
+	      sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"",
+			       quoted_trigger);
+	  free (quoted_trigger);
+	  ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+	  sqlite3_free (sql_statement);
+	  if (ret != SQLITE_OK)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+create_incremental_statistics_triggers (sqlite3 * sqlite, const char *table,
+					const char *column, char **errMsg)
+{
+/* 
+/ (re)creating the Incremental Statistics triggers
+/
+/ - INSERT: row_count is incremented and the extent is
+/   expanded so to include the new Geometry
+/ - UPDATE: the extent is expanded so to include the new
+/   Geometry; it will be invalidated (set to NULL) if the
+/   old Geometry was touching its boundary
+/ - DELETE: row_count is decremented; the extent will be
+/   invalidated if the old Geometry was touching its boundary
+/
+/ an invalidated extent will be then lazily recomputed by
+/ the next OPTIMISTIC statistics request (e.g. GetLayerExtent)
+/ and rows never verified (row_count IS NULL) are left untouched
+*/
+    int ret;
+    char *raw;
+    char *quoted_trigger;
+    char *quoted_table;
+    char *quoted_column;
+    char *sql_statement;
+    char *where;
+    char *expand;
+    char *shrink;
+
+    if (!drop_incremental_statistics_triggers (sqlite, table, column, errMsg))
+	return 0;
+
+    where =
+	sqlite3_mprintf ("WHERE Lower(f_table_name) = Lower(%Q) AND "
+			 "Lower(f_geometry_column) = Lower(%Q) AND "
+			 "row_count IS NOT NULL", table, column);
+    quoted_table = gaiaDoubleQuotedSql (table);
+    quoted_column = gaiaDoubleQuotedSql (column);
+    expand =
+	sqlite3_mprintf
+	("extent_min_x = CASE WHEN MbrMinX(NEW.\"%s\") IS NULL THEN extent_min_x "
+	 "WHEN row_count = 0 THEN MbrMinX(NEW.\"%s\") "
+	 "ELSE Min(extent_min_x, MbrMinX(NEW.\"%s\")) END, "
+	 "extent_min_y = CASE WHEN MbrMinY(NEW.\"%s\") IS NULL THEN extent_min_y "
+	 "WHEN row_count = 0 THEN MbrMinY(NEW.\"%s\") "
+	 "ELSE Min(extent_min_y, MbrMinY(NEW.\"%s\")) END, "
+	 "extent_max_x = CASE WHEN MbrMaxX(NEW.\"%s\") IS NULL THEN extent_max_x "
+	 "WHEN row_count = 0 THEN MbrMaxX(NEW.\"%s\") "
+	 "ELSE Max(extent_max_x, MbrMaxX(NEW.\"%s\")) END, "
+	 "extent_max_y = CASE WHEN MbrMaxY(NEW.\"%s\") IS NULL THEN extent_max_y "
+	 "WHEN row_count = 0 THEN MbrMaxY(NEW.\"%s\") "
+	 "ELSE Max(extent_max_y, MbrMaxY(NEW.\"%s\")) END",
+	 quoted_column, quoted_column, quoted_column, quoted_column,
+	 quoted_column, quoted_column, quoted_column, quoted_column,
+	 quoted_column, quoted_column, quoted_column, quoted_column);
+    shrink =
+	sqlite3_mprintf
+	("UPDATE geometry_columns_statistics SET extent_min_x = NULL, "
+	 "extent_min_y = NULL, extent_max_x = NULL, extent_max_y = NULL\n"
+	 "%s AND (MbrMinX(OLD.\"%s\") <= extent_min_x OR "
+	 "MbrMinY(OLD.\"%s\") <= extent_min_y OR "
+	 "MbrMaxX(OLD.\"%s\") >= extent_max_x OR "
+	 "MbrMaxY(OLD.\"%s\") >= extent_max_y);\n", where, quoted_column,
+	 quoted_column, quoted_column, quoted_column);
+
+/* inserting the new INSERT (incremental statistics) trigger */
+    raw = sqlite3_mprintf ("tsi_%s_%s", table, column);
+    quoted_trigger = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql_statement =
+	sqlite3_mprintf ("CREATE TRIGGER \"%s\" AFTER INSERT ON \"%s\"\n"
+			 "FOR EACH ROW BEGIN\n"
+			 "UPDATE geometry_columns_statistics SET "
+			 "row_count = row_count + 1, %s\n%s;\nEND",
+			 quoted_trigger, quoted_table, expand, where);
+    free (quoted_trigger);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	goto error;
+
+/* inserting the new UPDATE (incremental statistics) trigger */
+    raw = sqlite3_mprintf ("tsu_%s_%s", table, column);
+    quoted_trigger = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql_statement =
+	sqlite3_mprintf ("CREATE TRIGGER \"%s\" AFTER UPDATE OF \"%s\" ON \"%s\"\n"
+			 "FOR EACH ROW BEGIN\n"
+			 "UPDATE geometry_columns_statistics SET %s\n"
+			 "%s AND extent_min_x IS NOT NULL;\n%sEND",
+			 quoted_trigger, quoted_column, quoted_table, expand,
+			 where, shrink);
+    free (quoted_trigger);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	goto error;
+
+/* inserting the new DELETE (incremental statistics) trigger */
+    raw = sqlite3_mprintf ("tsd_%s_%s", table, column);
+    quoted_trigger = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql_statement =
+	sqlite3_mprintf ("CREATE TRIGGER \"%s\" AFTER DELETE ON \"%s\"\n"
+			 "FOR EACH ROW BEGIN\n"
+			 "UPDATE geometry_columns_statistics SET "
+			 "row_count = row_count - 1\n%s;\n%sEND",
+			 quoted_trigger, quoted_table, where, shrink);
+    free (quoted_trigger);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	goto error;
+
+    free (quoted_table);
+    free (quoted_column);
+    sqlite3_free (where);
+    sqlite3_free (expand);
+    sqlite3_free (shrink);
+    return 1;
+
+  error:
+    free (quoted_table);
+    free (quoted_column);
+    sqlite3_free (where);
+    sqlite3_free (expand);
+    sqlite3_free (shrink);
+    return 0;
+}
+
 SPATIALITE_PRIVATE int
 upgradeGeometryTriggers (void *p_sqlite)
 {
@@ -3704,10 +3897,428 @@ upgradeGeometryTriggers (void *p_sqlite)
     return retcode;
 }
 
+struct spatial_index_aux
+{
+/* the auxiliary columns of a covering SpatialIndex */
+    int count;
+    char *names[100];
+    int point;			/* the last two ones are point_x, point_y */
+};
+
+static void
+free_spatial_index_aux (struct spatial_index_aux *aux)
+{
+/* memory cleanup - destroying the auxiliary columns list */
+    int i;
+    if (aux == NULL)
+	return;
+    for (i = 0; i < aux->count; i++)
+	free (aux->names[i]);
+    free (aux);
+}
+
+static int
+add_spatial_index_aux (struct spatial_index_aux *aux, const char *name)
+{
+/* appending an auxiliary column, refusing duplicates */
+    int i;
+    int len;
+    if (aux->count >= 100)
+	return 0;
+    for (i = 0; i < aux->count; i++)
+      {
+	  if (strcasecmp (aux->names[i], name) == 0)
+	      return 0;
+      }
+    len = strlen (name);
+    aux->names[aux->count] = malloc (len + 1);
+    strcpy (aux->names[aux->count], name);
+    aux->count += 1;
+    return 1;
+}
+
+static int
+is_point_geometry_column (sqlite3 * sqlite, const char *table,
+			  const char *column)
+{
+/* checking if some Geometry column is of the POINT type */
+    char *sql;
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    int point = 0;
+    if (checkSpatialMetaData (sqlite) != 3)
+	return 0;
+    sql = sqlite3_mprintf ("SELECT geometry_type FROM geometry_columns "
+			   "WHERE Lower(f_table_name) = Lower(%Q) "
+			   "AND Lower(f_geometry_column) = Lower(%Q)", table,
+			   column);
+    ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    if (rows == 1 && results[1] != NULL && atoi (results[1]) % 1000 == 1)
+	point = 1;
+    sqlite3_free_table (results);
+    return point;
+}
+
+static struct spatial_index_aux *
+parse_spatial_index_aux (sqlite3 * sqlite, const char *table,
+			 const char *column, const char *list)
+{
+/* 
+/ parsing and validating a comma separated list of table columns
+/ to be stored as auxiliary columns into a covering SpatialIndex
+*/
+    char *sql;
+    char *quoted;
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    int i;
+    const char *p = list;
+    struct spatial_index_aux *aux = malloc (sizeof (struct spatial_index_aux));
+    aux->count = 0;
+    aux->point = 0;
+
+    quoted = gaiaDoubleQuotedSql (table);
+    sql = sqlite3_mprintf ("PRAGMA table_info(\"%s\")", quoted);
+    free (quoted);
+    ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto error;
+    while (1)
+      {
+	  /* extracting the next column name */
+	  const char *start;
+	  const char *end;
+	  const char *real_name = NULL;
+	  char *name;
+	  char *dequoted;
+	  while (*p == ' ' || *p == '\t')
+	      p++;
+	  start = p;
+	  while (*p != ',' && *p != '\0')
+	      p++;
+	  end = p;
+	  while (end > start && (*(end - 1) == ' ' || *(end - 1) == '\t'))
+	      end--;
+	  if (end == start)
+	      break;
+	  name = malloc (end - start + 1);
+	  memcpy (name, start, end - start);
+	  *(name + (end - start)) = '\0';
+	  if (*name == '"')
+	    {
+		dequoted = gaiaDequotedSql (name);
+		free (name);
+		name = dequoted;
+	    }
+	  for (i = 1; name != NULL && i <= rows; i++)
+	    {
+		if (strcasecmp (results[(i * columns) + 1], name) == 0)
+		    real_name = results[(i * columns) + 1];
+	    }
+	  if (name != NULL)
+	      free (name);
+	  if (real_name == NULL || strcasecmp (real_name, column) == 0)
+	    {
+		/* not existing column, or the Geometry itself */
+		sqlite3_free_table (results);
+		goto error;
+	    }
+	  if (strcasecmp (real_name, "pkid") == 0
+	      || strcasecmp (real_name, "xmin") == 0
+	      || strcasecmp (real_name, "xmax") == 0
+	      || strcasecmp (real_name, "ymin") == 0
+	      || strcasecmp (real_name, "ymax") == 0
+	      || strcasecmp (real_name, "point_x") == 0
+	      || strcasecmp (real_name, "point_y") == 0)
+	    {
+		/* reserved names */
+		sqlite3_free_table (results);
+		goto error;
+	    }
+	  if (aux->count >= 98 || !add_spatial_index_aux (aux, real_name))
+	    {
+		sqlite3_free_table (results);
+		goto error;
+	    }
+	  if (*p == '\0')
+	      break;
+	  p++;
+      }
+    sqlite3_free_table (results);
+    if (is_point_geometry_column (sqlite, table, column))
+      {
+	  /* the exact coordinates of Points: R*Tree MBRs are 32 bit floats */
+	  add_spatial_index_aux (aux, "point_x");
+	  add_spatial_index_aux (aux, "point_y");
+	  aux->point = 1;
+      }
+    if (aux->count == 0)
+	goto error;
+    return aux;
+
+  error:
+    free_spatial_index_aux (aux);
+    return NULL;
+}
+
+static struct spatial_index_aux *
+get_spatial_index_aux (sqlite3 * sqlite, const char *table,
+		       const char *column)
+{
+/* retrieving the auxiliary columns of an existing SpatialIndex [if any] */
+    char *sql;
+    char *raw;
+    char *quoted;
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    int i;
+    struct spatial_index_aux *aux;
+
+    raw = sqlite3_mprintf ("idx_%s_%s", table, column);
+    quoted = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql = sqlite3_mprintf ("PRAGMA table_info(\"%s\")", quoted);
+    free (quoted);
+    ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return NULL;
+    if (rows <= 5)
+      {
+	  /* not existing, or an ordinary R*Tree */
+	  sqlite3_free_table (results);
+	  return NULL;
+      }
+    aux = malloc (sizeof (struct spatial_index_aux));
+    aux->count = 0;
+    aux->point = 0;
+    for (i = 6; i <= rows; i++)
+	add_spatial_index_aux (aux, results[(i * columns) + 1]);
+    sqlite3_free_table (results);
+    if (aux->count >= 2
+	&& strcmp (aux->names[aux->count - 2], "point_x") == 0
+	&& strcmp (aux->names[aux->count - 1], "point_y") == 0)
+	aux->point = 1;
+    return aux;
+}
+
+static char *
+spatial_index_aux_sql (struct spatial_index_aux *aux, int mode,
+		       const char *prefix, const char *column)
+{
+/* 
+/ building a list of SQL expressions for the auxiliary columns:
+/
+/ mode 0: the R*Tree declaration [, +"name"]
+/ mode 1: the column names [, "name"]
+/ mode 2: the values to be inserted [, prefix"name"]
+/ mode 3: the table columns to be watched by triggers [, "name"]
+*/
+    int i;
+    char *sql = sqlite3_mprintf ("%s", "");
+    char *prev;
+    char *quoted;
+    char *quoted_column = gaiaDoubleQuotedSql (column);
+    for (i = 0; i < aux->count; i++)
+      {
+	  int pseudo = (aux->point && i >= aux->count - 2);
+	  quoted = gaiaDoubleQuotedSql (aux->names[i]);
+	  prev = sql;
+	  if (mode == 0)
+	      sql = sqlite3_mprintf ("%s, +\"%s\"", prev, quoted);
+	  else if (mode == 1)
+	      sql = sqlite3_mprintf ("%s, \"%s\"", prev, quoted);
+	  else if (mode == 2 && pseudo)
+	      sql = sqlite3_mprintf ("%s, ST_%c(%s\"%s\")", prev,
+				     (i == aux->count - 2) ? 'X' : 'Y',
+				     prefix, quoted_column);
+	  else if (mode == 2)
+	      sql = sqlite3_mprintf ("%s, %s\"%s\"", prev, prefix, quoted);
+	  else if (!pseudo)
+	      sql = sqlite3_mprintf ("%s, \"%s\"", prev, quoted);
+	  else
+	      sql = sqlite3_mprintf ("%s", prev);
+	  sqlite3_free (prev);
+	  free (quoted);
+      }
+    free (quoted_column);
+    return sql;
+}
+
+SPATIALITE_PRIVATE char *
+getSpatialIndexAuxColumns (void *p_sqlite, const char *table,
+			   const char *column)
+{
+/* 
+/ retrieving the auxiliary columns of an existing covering SpatialIndex
+/ as a list suitable for updateGeometryTriggersEx (point_x and point_y
+/ are always implicitly added for POINT layers)
+/
+/ returns NULL for an ordinary SpatialIndex
+*/
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    struct spatial_index_aux *aux;
+    char *list;
+    char *prev;
+    char *quoted;
+    int i;
+    int count;
+    aux = get_spatial_index_aux (sqlite, table, column);
+    if (aux == NULL)
+	return NULL;
+    count = aux->point ? aux->count - 2 : aux->count;
+    list = sqlite3_mprintf ("%s", "");
+    for (i = 0; i < count; i++)
+      {
+	  quoted = gaiaDoubleQuotedSql (aux->names[i]);
+	  prev = list;
+	  list = sqlite3_mprintf ("%s%s\"%s\"", prev, (i == 0) ? "" : ", ",
+				  quoted);
+	  sqlite3_free (prev);
+	  free (quoted);
+      }
+    free_spatial_index_aux (aux);
+    return list;
+}
+
+SPATIALITE_PRIVATE int
+checkSpatialIndexAuxColumns (void *p_sqlite, const char *table,
+			     const char *column, const char *aux_columns)
+{
+/* checking a list of auxiliary columns for a covering SpatialIndex */
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    char *p_table = NULL;
+    char *p_column = NULL;
+    struct spatial_index_aux *aux = NULL;
+    if (getRealSQLnames (sqlite, table, column, &p_table, &p_column))
+      {
+	  aux = parse_spatial_index_aux (sqlite, p_table, p_column,
+					 aux_columns);
+	  free (p_table);
+	  free (p_column);
+      }
+    if (aux == NULL)
+	return 0;
+    free_spatial_index_aux (aux);
+    return 1;
+}
+
+static int
+create_covering_index_triggers (sqlite3 * sqlite, const char *table,
+				const char *column,
+				struct spatial_index_aux *aux,
+				int metadata_version, char **errMsg)
+{
+/* 
+/ creating the INSERT and UPDATE triggers of a covering SpatialIndex:
+/ the R*Tree row is directly inserted together with its auxiliary values
+*/
+    char *raw;
+    char *sql_statement;
+    char *quoted_trigger;
+    char *quoted_rtree;
+    char *quoted_table;
+    char *quoted_column;
+    char *names;
+    char *values;
+    char *watched;
+    char *body;
+    int ret;
+
+    raw = sqlite3_mprintf ("idx_%s_%s", table, column);
+    quoted_rtree = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    quoted_table = gaiaDoubleQuotedSql (table);
+    quoted_column = gaiaDoubleQuotedSql (column);
+    names = spatial_index_aux_sql (aux, 1, NULL, column);
+    values = spatial_index_aux_sql (aux, 2, "NEW.", column);
+    watched = spatial_index_aux_sql (aux, 3, NULL, column);
+    body =
+	sqlite3_mprintf ("FOR EACH ROW BEGIN\n"
+			 "DELETE FROM \"%s\" WHERE pkid=NEW.ROWID;\n"
+			 "INSERT INTO \"%s\" (pkid, xmin, xmax, ymin, ymax%s) "
+			 "SELECT NEW.ROWID, MbrMinX(NEW.\"%s\"), "
+			 "MbrMaxX(NEW.\"%s\"), MbrMinY(NEW.\"%s\"), "
+			 "MbrMaxY(NEW.\"%s\")%s "
+			 "WHERE MbrMinX(NEW.\"%s\") IS NOT NULL;\nEND",
+			 quoted_rtree, quoted_rtree, names, quoted_column,
+			 quoted_column, quoted_column, quoted_column, values,
+			 quoted_column);
+    sqlite3_free (names);
+    sqlite3_free (values);
+
+/* inserting the new INSERT trigger RTree */
+    raw = sqlite3_mprintf ("gii_%s_%s", table, column);
+    quoted_trigger = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql_statement =
+	sqlite3_mprintf ("CREATE TRIGGER \"%s\" AFTER INSERT ON \"%s\"\n%s",
+			 quoted_trigger, quoted_table, body);
+    free (quoted_trigger);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	goto stop;
+
+/* inserting the new UPDATE trigger RTree */
+    raw = sqlite3_mprintf ("giu_%s_%s", table, column);
+    quoted_trigger = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    if (metadata_version == 3)
+      {
+	  /* current metadata style >= v.4.0.0 */
+	  sql_statement =
+	      sqlite3_mprintf
+	      ("CREATE TRIGGER \"%s\" AFTER UPDATE OF \"%s\"%s ON \"%s\"\n%s",
+	       quoted_trigger, quoted_column, watched, quoted_table, body);
+      }
+    else
+      {
+	  /* legacy metadata style <= v.3.1.0 */
+	  sql_statement =
+	      sqlite3_mprintf
+	      ("CREATE TRIGGER \"%s\" AFTER UPDATE ON \"%s\"\n%s",
+	       quoted_trigger, quoted_table, body);
+      }
+    free (quoted_trigger);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+
+  stop:
+    sqlite3_free (body);
+    sqlite3_free (watched);
+    free (quoted_rtree);
+    free (quoted_table);
+    free (quoted_column);
+    return ret;
+}
+
 SPATIALITE_PRIVATE void
 updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 {
 /* updates triggers for some Spatial Column */
+    updateGeometryTriggersEx (p_sqlite, table, column, NULL);
+}
+
+SPATIALITE_PRIVATE void
+updateGeometryTriggersEx (void *p_sqlite, const char *table,
+			  const char *column, const char *aux_columns)
+{
+/* 
+/ updates triggers for some Spatial Column
+/ aux_columns (if not NULL) lists the auxiliary columns of a new
+/ covering SpatialIndex; otherwise the current ones are preserved
+*/
     sqlite3 *sqlite = (sqlite3 *) p_sqlite;
     int ret;
     int col_index;
@@ -3731,6 +4342,8 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
     struct spatial_index_str *last_idx = NULL;
     struct spatial_index_str *curr_idx;
     struct spatial_index_str *next_idx;
+    struct spatial_index_aux *aux = NULL;
+    char *aux_sql;
     int metadata_version = checkSpatialMetaData (sqlite);
 
     if (!getRealSQLnames (sqlite, table, column, &p_table, &p_column))
@@ -3769,6 +4382,11 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
     sqlite3_clear_bindings (stmt);
     sqlite3_bind_text (stmt, 1, table, strlen (table), SQLITE_STATIC);
     sqlite3_bind_text (stmt, 2, column, strlen (column), SQLITE_STATIC);
+    if (aux_columns != NULL)
+	aux =
+	    parse_spatial_index_aux (sqlite, p_table, p_column, aux_columns);
+    else
+	aux = get_spatial_index_aux (sqlite, p_table, p_column);
     while (1)
       {
 	  /* scrolling the result set rows */
@@ -4121,6 +4739,15 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 		      sqlite3_free (sql_statement);
 		      if (ret != SQLITE_OK)
 			  goto error;
+
+		      if (check_incremental_statistics
+			  (sqlite, p_table, p_column))
+			{
+			    /* refreshing the Incremental Statistics triggers */
+			    if (!create_incremental_statistics_triggers
+				(sqlite, p_table, p_column, &errMsg))
+				goto error;
+			}
 		  }
 
 		/* deleting the old INSERT trigger SPATIAL_INDEX [if any] */
@@ -4201,7 +4828,18 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 		if (ret != SQLITE_OK)
 		    goto error;
 
-		if (index)
+		if (index && aux != NULL)
+		  {
+		      /* inserting the new INSERT and UPDATE triggers RTree */
+		      ret =
+			  create_covering_index_triggers (sqlite, p_table,
+							  p_column, aux,
+							  metadata_version,
+							  &errMsg);
+		      if (ret != SQLITE_OK)
+			  goto error;
+		  }
+		else if (index)
 		  {
 		      /* inserting the new INSERT trigger RTree */
 		      if (metadata_version == 3)
@@ -4330,7 +4968,9 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 		      sqlite3_free (sql_statement);
 		      if (ret != SQLITE_OK)
 			  goto error;
-
+		  }
+		if (index)
+		  {
 		      /* inserting the new DELETE trigger RTree */
 		      if (metadata_version == 3)
 			{
@@ -4601,9 +5241,16 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 				       curr_idx->ColumnName);
 		quoted_rtree = gaiaDoubleQuotedSql (raw);
 		sqlite3_free (raw);
+		if (aux != NULL)
+		    aux_sql =
+			spatial_index_aux_sql (aux, 0, NULL,
+					       curr_idx->ColumnName);
+		else
+		    aux_sql = sqlite3_mprintf ("%s", "");
 		sql_statement = sqlite3_mprintf ("CREATE VIRTUAL TABLE \"%s\" "
-						 "USING rtree(pkid, xmin, xmax, ymin, ymax)",
-						 quoted_rtree);
+						 "USING rtree(pkid, xmin, xmax, ymin, ymax%s)",
+						 quoted_rtree, aux_sql);
+		sqlite3_free (aux_sql);
 		free (quoted_rtree);
 		ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
 		sqlite3_free (sql_statement);
@@ -4667,6 +5314,7 @@ updateGeometryTriggers (void *p_sqlite, const char *table, const char *column)
 	  free (curr_idx);
 	  curr_idx = next_idx;
       }
+    free_spatial_index_aux (aux);
     if (p_table)
 	free (p_table);
     if (p_column)
@@ -5247,6 +5895,53 @@ validateTemporaryRowid (void *p_sqlite, const char *db_prefix,
     return 0;
 }
 
+static int
+fill_spatial_index_aux (sqlite3 * sqlite, const char *table,
+			const char *column, struct spatial_index_aux *aux,
+			char **errMsg)
+{
+/* 
+/ copying the auxiliary values of a bulk loaded covering SpatialIndex:
+/ SQLite stores them into the "a0", "a1" ... columns of "_rowid"
+*/
+    int i;
+    int ret;
+    char *raw;
+    char *sql;
+    char *prev;
+    char *values;
+    char *quoted_rtree;
+    char *quoted_table;
+    char *quoted_column;
+    raw = sqlite3_mprintf ("idx_%s_%s_rowid", table, column);
+    quoted_rtree = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    quoted_table = gaiaDoubleQuotedSql (table);
+    quoted_column = gaiaDoubleQuotedSql (column);
+    values = spatial_index_aux_sql (aux, 2, "", column);
+    sql = sqlite3_mprintf ("UPDATE \"%s\" SET (a0", quoted_rtree);
+    for (i = 1; i < aux->count; i++)
+      {
+	  prev = sql;
+	  sql = sqlite3_mprintf ("%s, a%d", prev, i);
+	  sqlite3_free (prev);
+      }
+    prev = sql;
+    sql =
+	sqlite3_mprintf
+	("%s) = (SELECT %s FROM \"%s\" WHERE ROWID = \"%s\".rowid)",
+	 prev, values + 2 /* skipping the leading comma */ , quoted_table,
+	 quoted_rtree);
+    sqlite3_free (prev);
+    sqlite3_free (values);
+    free (quoted_rtree);
+    free (quoted_table);
+    free (quoted_column);
+    ret = sqlite3_exec (sqlite, sql, NULL, NULL, errMsg);
+    sqlite3_free (sql);
+    return ret;
+}
+
 SPATIALITE_PRIVATE int
 buildSpatialIndexEx (void *p_sqlite, const unsigned char *table,
 		     const char *column)
@@ -5259,7 +5954,10 @@ buildSpatialIndexEx (void *p_sqlite, const unsigned char *table,
     char *quoted_column;
     char *sql_statement;
     char *errMsg = NULL;
+    char *names;
+    char *values;
     int ret;
+    struct spatial_index_aux *aux;
 
     if (!validateRowid (sqlite, (const char *) table))
       {
@@ -5269,21 +5967,55 @@ buildSpatialIndexEx (void *p_sqlite, const unsigned char *table,
 	  return -2;
       }
 
+    aux = get_spatial_index_aux (sqlite, (const char *) table, column);
+
+/* attempting first to bulk load a fully packed R*Tree */
+    if (buildSpatialIndexPacked (sqlite, table, column) == 0)
+      {
+	  if (aux == NULL)
+	      return 0;
+	  /* the auxiliary values directly go into the "_rowid" shadow table */
+	  ret = fill_spatial_index_aux (sqlite, (const char *) table, column,
+					aux, &errMsg);
+	  free_spatial_index_aux (aux);
+	  if (ret != SQLITE_OK)
+	    {
+		spatialite_e ("buildSpatialIndex error: \"%s\"\n", errMsg);
+		sqlite3_free (errMsg);
+		return -1;
+	    }
+	  return 0;
+      }
+
+    if (aux != NULL)
+      {
+	  names = spatial_index_aux_sql (aux, 1, NULL, column);
+	  values = spatial_index_aux_sql (aux, 2, "", column);
+	  free_spatial_index_aux (aux);
+      }
+    else
+      {
+	  names = sqlite3_mprintf ("%s", "");
+	  values = sqlite3_mprintf ("%s", "");
+      }
     raw = sqlite3_mprintf ("idx_%s_%s", table, column);
     quoted_rtree = gaiaDoubleQuotedSql (raw);
     sqlite3_free (raw);
     quoted_table = gaiaDoubleQuotedSql ((const char *) table);
     quoted_column = gaiaDoubleQuotedSql (column);
     sql_statement = sqlite3_mprintf ("INSERT INTO \"%s\" "
-				     "(pkid, xmin, xmax, ymin, ymax) "
-				     "SELECT ROWID, MbrMinX(\"%s\"), MbrMaxX(\"%s\"), MbrMinY(\"%s\"), MbrMaxY(\"%s\") "
+				     "(pkid, xmin, xmax, ymin, ymax%s) "
+				     "SELECT ROWID, MbrMinX(\"%s\"), MbrMaxX(\"%s\"), MbrMinY(\"%s\"), MbrMaxY(\"%s\")%s "
 				     "FROM \"%s\" WHERE MbrMinX(\"%s\") IS NOT NULL",
-				     quoted_rtree, quoted_column, quoted_column,
-				     quoted_column, quoted_column, quoted_table,
+				     quoted_rtree, names, quoted_column,
+				     quoted_column, quoted_column,
+				     quoted_column, values, quoted_table,
 				     quoted_column);
     free (quoted_rtree);
     free (quoted_table);
     free (quoted_column);
+    sqlite3_free (names);
+    sqlite3_free (values);
     ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
     sqlite3_free (sql_statement);
     if (ret != SQLITE_OK)
@@ -7780,6 +8512,120 @@ gaiaStatisticsInvalidate (sqlite3 * sqlite, const char *table,
 	return 0;
 }
 
+static int
+check_incremental_statistics_layer (sqlite3 * sqlite, const char *table,
+				    const char *geometry, char **p_table,
+				    char **p_column)
+{
+/* checking if Incremental Statistics could be supported by some Layer */
+    int ret;
+    int i;
+    char **results;
+    int rows;
+    int columns;
+    int count = 0;
+    char *sql_statement;
+
+    *p_table = NULL;
+    *p_column = NULL;
+    if (table == NULL || geometry == NULL)
+	return 0;
+    if (checkSpatialMetaData (sqlite) != 3)
+	return 0;
+    sql_statement =
+	sqlite3_mprintf ("SELECT Count(*) FROM geometry_columns "
+			 "WHERE Lower(f_table_name) = Lower(%Q) AND "
+			 "Lower(f_geometry_column) = Lower(%Q)", table,
+			 geometry);
+    ret =
+	sqlite3_get_table (sqlite, sql_statement, &results, &rows, &columns,
+			   NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    for (i = 1; i <= rows; i++)
+	count = atoi (results[(i * columns) + 0]);
+    sqlite3_free_table (results);
+    if (count != 1)
+	return 0;
+    if (!getRealSQLnames (sqlite, table, geometry, p_table, p_column))
+	return 0;
+    return 1;
+}
+
+SPATIALITE_DECLARE int
+gaiaEnableIncrementalStatistics (sqlite3 * sqlite, const char *table,
+				 const char *geometry)
+{
+/* attempting to enable Incremental Statistics on some Spatial Table */
+    char *p_table;
+    char *p_column;
+    char *errMsg = NULL;
+    int ret = 0;
+
+    if (!check_incremental_statistics_layer
+	(sqlite, table, geometry, &p_table, &p_column))
+	return 0;
+/* initializing the statistics from a full table scan */
+    if (!update_layer_statistics (sqlite, p_table, p_column))
+	goto end;
+    if (!create_incremental_statistics_triggers
+	(sqlite, p_table, p_column, &errMsg))
+      {
+	  spatialite_e ("EnableIncrementalStatistics: \"%s\"\n", errMsg);
+	  sqlite3_free (errMsg);
+	  goto end;
+      }
+    ret = 1;
+  end:
+    free (p_table);
+    free (p_column);
+    return ret;
+}
+
+SPATIALITE_DECLARE int
+gaiaDisableIncrementalStatistics (sqlite3 * sqlite, const char *table,
+				  const char *geometry)
+{
+/* attempting to disable Incremental Statistics on some Spatial Table */
+    char *p_table;
+    char *p_column;
+    char *errMsg = NULL;
+    int ret = 1;
+
+    if (!check_incremental_statistics_layer
+	(sqlite, table, geometry, &p_table, &p_column))
+	return 0;
+    if (!drop_incremental_statistics_triggers
+	(sqlite, p_table, p_column, &errMsg))
+      {
+	  spatialite_e ("DisableIncrementalStatistics: \"%s\"\n", errMsg);
+	  sqlite3_free (errMsg);
+	  ret = 0;
+      }
+    free (p_table);
+    free (p_column);
+    return ret;
+}
+
+SPATIALITE_DECLARE int
+gaiaHasIncrementalStatistics (sqlite3 * sqlite, const char *table,
+			      const char *geometry)
+{
+/* checking if Incremental Statistics are enabled on some Spatial Table */
+    char *p_table;
+    char *p_column;
+    int ret;
+
+    if (!check_incremental_statistics_layer
+	(sqlite, table, geometry, &p_table, &p_column))
+	return 0;
+    ret = check_incremental_statistics (sqlite, p_table, p_column);
+    free (p_table);
+    free (p_column);
+    return ret;
+}
+
 static int
 rtree_bbox_callback (sqlite3_rtree_query_info * info)
 {
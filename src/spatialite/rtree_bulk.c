@@ -0,0 +1,1424 @@
+/*
+
+ rtree_bulk.c -- packed bulk loading of SpatialIndex R*Trees
+
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+#include <spatialite/debug.h>
+
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite_private.h>
+#include <spatialite/spatialite_ext.h>
+#include <spatialite/gaiaaux.h>
+
+#ifdef _WIN32
+#define strcasecmp	_stricmp
+#endif /* not WIN32 */
+
+/*
+/ SQLite's R*Tree stores each cell as a 64 bit integer (rowid or child
+/ node number) followed by 32 bit floats [xmin, xmax, ymin, ymax], all
+/ of them in big-endian order; each node starts with a 16 bit tree depth
+/ (only meaningful for the root node) and a 16 bit cell count.
+*/
+#define RTREE_BULK_CELL		24
+#define RTREE_BULK_HEADER	4
+#define RTREE_BULK_ROUND_TOWARDS	(1.0 - 1.0 / 8388608.0)
+#define RTREE_BULK_ROUND_AWAY		(1.0 + 1.0 / 8388608.0)
+
+struct rtree_bulk_item
+{
+/* an R*Tree cell: a rowid (leaves) or a child node (internal nodes) */
+    sqlite3_int64 id;
+    float minx;
+    float maxx;
+    float miny;
+    float maxy;
+};
+
+struct rtree_bulk_level
+{
+/* all cells belonging to a given level of the R*Tree */
+    struct rtree_bulk_item *items;
+    int count;
+    sqlite3_int64 base;		/* node number of the first node */
+};
+
+static float
+rtree_bulk_down (double d)
+{
+/* rounding towards -Infinity exactly as SQLite's R*Tree does */
+    float f = (float) d;
+    if (f > d)
+	f = (float) (d *
+		     (d <
+		      0 ? RTREE_BULK_ROUND_AWAY : RTREE_BULK_ROUND_TOWARDS));
+    return f;
+}
+
+static float
+rtree_bulk_up (double d)
+{
+/* rounding towards +Infinity exactly as SQLite's R*Tree does */
+    float f = (float) d;
+    if (f < d)
+	f = (float) (d *
+		     (d <
+		      0 ? RTREE_BULK_ROUND_TOWARDS : RTREE_BULK_ROUND_AWAY));
+    return f;
+}
+
+static int
+rtree_bulk_cmp_x (const void *p1, const void *p2)
+{
+/* qsort comparator: X center */
+    const struct rtree_bulk_item *i1 = (const struct rtree_bulk_item *) p1;
+    const struct rtree_bulk_item *i2 = (const struct rtree_bulk_item *) p2;
+    double c1 = (double) i1->minx + (double) i1->maxx;
+    double c2 = (double) i2->minx + (double) i2->maxx;
+    if (c1 < c2)
+	return -1;
+    if (c1 > c2)
+	return 1;
+    return 0;
+}
+
+static int
+rtree_bulk_cmp_y (const void *p1, const void *p2)
+{
+/* qsort comparator: Y center */
+    const struct rtree_bulk_item *i1 = (const struct rtree_bulk_item *) p1;
+    const struct rtree_bulk_item *i2 = (const struct rtree_bulk_item *) p2;
+    double c1 = (double) i1->miny + (double) i1->maxy;
+    double c2 = (double) i2->miny + (double) i2->maxy;
+    if (c1 < c2)
+	return -1;
+    if (c1 > c2)
+	return 1;
+    return 0;
+}
+
+static void
+rtree_bulk_str_sort (struct rtree_bulk_item *items, int count, int max_cells)
+{
+/* 
+/ Sort-Tile-Recursive: sorting by X center, then splitting into
+/ vertical slices each one of them sorted by Y center, so that any
+/ run of max_cells consecutive items will become a tight node
+*/
+    int nodes = (count + max_cells - 1) / max_cells;
+    int slices = (int) ceil (sqrt ((double) nodes));
+    int slice_items = slices * max_cells;
+    int i;
+    qsort (items, count, sizeof (struct rtree_bulk_item), rtree_bulk_cmp_x);
+    for (i = 0; i < count; i += slice_items)
+      {
+	  int n = count - i;
+	  if (n > slice_items)
+	      n = slice_items;
+	  qsort (items + i, n, sizeof (struct rtree_bulk_item),
+		 rtree_bulk_cmp_y);
+      }
+}
+
+static void
+rtree_bulk_export16 (unsigned char *p, int value)
+{
+/* big-endian 16 bit int */
+    p[0] = (unsigned char) ((value >> 8) & 0xff);
+    p[1] = (unsigned char) (value & 0xff);
+}
+
+static void
+rtree_bulk_export_float (unsigned char *p, float value)
+{
+/* big-endian 32 bit float */
+    unsigned int i;
+    memcpy (&i, &value, 4);
+    p[0] = (unsigned char) ((i >> 24) & 0xff);
+    p[1] = (unsigned char) ((i >> 16) & 0xff);
+    p[2] = (unsigned char) ((i >> 8) & 0xff);
+    p[3] = (unsigned char) (i & 0xff);
+}
+
+static void
+rtree_bulk_export_cell (unsigned char *p, const struct rtree_bulk_item *item,
+			sqlite3_int64 id)
+{
+/* encoding an R*Tree cell */
+    sqlite3_uint64 v = (sqlite3_uint64) id;
+    int i;
+    for (i = 7; i >= 0; i--)
+      {
+	  p[i] = (unsigned char) (v & 0xff);
+	  v >>= 8;
+      }
+    rtree_bulk_export_float (p + 8, item->minx);
+    rtree_bulk_export_float (p + 12, item->maxx);
+    rtree_bulk_export_float (p + 16, item->miny);
+    rtree_bulk_export_float (p + 20, item->maxy);
+}
+
+static int
+rtree_bulk_node_size (sqlite3 * sqlite, const char *xrtree)
+{
+/* 
+/ retrieving the R*Tree node size (root node always exists)
+/ and checking that the R*Tree is currently empty
+*/
+    char *sql;
+    sqlite3_stmt *stmt = NULL;
+    int ret;
+    int size = -1;
+    int empty = 0;
+
+    sql =
+	sqlite3_mprintf ("SELECT rowid FROM \"%s_rowid\" LIMIT 1", xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return -1;
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_DONE)
+	empty = 1;
+    sqlite3_finalize (stmt);
+    if (!empty)
+	return -1;
+
+    sql =
+	sqlite3_mprintf ("SELECT length(data) FROM \"%s_node\" WHERE nodeno = 1",
+			 xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return -1;
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW)
+	size = sqlite3_column_int (stmt, 0);
+    sqlite3_finalize (stmt);
+    if (size < RTREE_BULK_HEADER + (2 * RTREE_BULK_CELL))
+	return -1;
+    return size;
+}
+
+static int
+rtree_bulk_load (sqlite3 * sqlite, const char *xtable, const char *xcolumn,
+		 struct rtree_bulk_item **list, int *count)
+{
+/* loading all MBRs from the Geometry table */
+    char *sql;
+    sqlite3_stmt *stmt = NULL;
+    int ret;
+    struct rtree_bulk_item *items = NULL;
+    int n = 0;
+    int max = 0;
+
+    *list = NULL;
+    *count = 0;
+    sql =
+	sqlite3_mprintf
+	("SELECT ROWID, MbrMinX(\"%s\"), MbrMaxX(\"%s\"), MbrMinY(\"%s\"), "
+	 "MbrMaxY(\"%s\") FROM \"%s\" WHERE MbrMinX(\"%s\") IS NOT NULL",
+	 xcolumn, xcolumn, xcolumn, xcolumn, xtable, xcolumn);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    while (1)
+      {
+	  struct rtree_bulk_item *item;
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW)
+	      goto error;
+	  if (n >= max)
+	    {
+		struct rtree_bulk_item *save;
+		int new_max = (max == 0) ? 4096 : max * 2;
+		if (new_max < max)
+		    goto error;	/* integer overflow */
+		save =
+		    realloc (items, sizeof (struct rtree_bulk_item) * new_max);
+		if (save == NULL)
+		    goto error;
+		items = save;
+		max = new_max;
+	    }
+	  item = items + n;
+	  item->id = sqlite3_column_int64 (stmt, 0);
+	  item->minx = rtree_bulk_down (sqlite3_column_double (stmt, 1));
+	  item->maxx = rtree_bulk_up (sqlite3_column_double (stmt, 2));
+	  item->miny = rtree_bulk_down (sqlite3_column_double (stmt, 3));
+	  item->maxy = rtree_bulk_up (sqlite3_column_double (stmt, 4));
+	  if (item->minx > item->maxx || item->miny > item->maxy)
+	      goto error;	/* the R*Tree would raise a constraint error */
+	  n++;
+      }
+    sqlite3_finalize (stmt);
+    *list = items;
+    *count = n;
+    return 1;
+
+  error:
+    sqlite3_finalize (stmt);
+    if (items != NULL)
+	free (items);
+    return 0;
+}
+
+static int
+rtree_bulk_write (sqlite3 * sqlite, const char *xrtree,
+		  struct rtree_bulk_level *levels, int num_levels,
+		  int max_cells, int node_size)
+{
+/* writing all nodes directly into the R*Tree shadow tables */
+    char *sql;
+    int ret;
+    int lvl;
+    int i;
+    int ok = 0;
+    unsigned char *node = NULL;
+    sqlite3_stmt *stmt_node = NULL;
+    sqlite3_stmt *stmt_rowid = NULL;
+    sqlite3_stmt *stmt_parent = NULL;
+
+    sql = sqlite3_mprintf ("DELETE FROM \"%s_node\" WHERE nodeno <> 1; "
+			   "DELETE FROM \"%s_parent\"", xrtree, xrtree);
+    ret = sqlite3_exec (sqlite, sql, NULL, NULL, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    sql =
+	sqlite3_mprintf
+	("INSERT OR REPLACE INTO \"%s_node\" (nodeno, data) VALUES (?, ?)",
+	 xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_node, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    sql =
+	sqlite3_mprintf
+	("INSERT INTO \"%s_rowid\" (rowid, nodeno) VALUES (?, ?)", xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_rowid, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    sql =
+	sqlite3_mprintf
+	("INSERT INTO \"%s_parent\" (nodeno, parentnode) VALUES (?, ?)",
+	 xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_parent, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    node = malloc (node_size);
+    if (node == NULL)
+	goto stop;
+
+    for (lvl = num_levels - 1; lvl >= 0; lvl--)
+      {
+	  struct rtree_bulk_level *level = levels + lvl;
+	  int is_root = (lvl == num_levels - 1);
+	  for (i = 0; i < level->count; i += max_cells)
+	    {
+		sqlite3_int64 nodeno = is_root ? 1 : level->base + i / max_cells;
+		int n = level->count - i;
+		int ic;
+		if (n > max_cells)
+		    n = max_cells;
+		memset (node, 0, node_size);
+		if (is_root)
+		    rtree_bulk_export16 (node, num_levels - 1);
+		rtree_bulk_export16 (node + 2, n);
+		for (ic = 0; ic < n; ic++)
+		  {
+		      const struct rtree_bulk_item *item = level->items + i + ic;
+		      sqlite3_int64 id = item->id;
+		      sqlite3_stmt *stmt = stmt_rowid;
+		      if (lvl > 0)
+			{
+			    /* internal node: pointing to some child node */
+			    id += levels[lvl - 1].base;
+			    stmt = stmt_parent;
+			}
+		      rtree_bulk_export_cell (node + RTREE_BULK_HEADER +
+					      (ic * RTREE_BULK_CELL), item, id);
+		      sqlite3_reset (stmt);
+		      sqlite3_clear_bindings (stmt);
+		      sqlite3_bind_int64 (stmt, 1, id);
+		      sqlite3_bind_int64 (stmt, 2, nodeno);
+		      ret = sqlite3_step (stmt);
+		      if (ret != SQLITE_DONE)
+			  goto stop;
+		  }
+		sqlite3_reset (stmt_node);
+		sqlite3_clear_bindings (stmt_node);
+		sqlite3_bind_int64 (stmt_node, 1, nodeno);
+		sqlite3_bind_blob (stmt_node, 2, node, node_size, SQLITE_STATIC);
+		ret = sqlite3_step (stmt_node);
+		if (ret != SQLITE_DONE)
+		    goto stop;
+	    }
+      }
+    ok = 1;
+
+  stop:
+    if (node != NULL)
+	free (node);
+    sqlite3_finalize (stmt_node);
+    sqlite3_finalize (stmt_rowid);
+    sqlite3_finalize (stmt_parent);
+    return ok;
+}
+
+static int
+rtree_bulk_build (sqlite3 * sqlite, const char *xrtree,
+		  struct rtree_bulk_item *leaves, int count, int node_size)
+{
+/* building all R*Tree levels bottom-up, then writing the whole tree */
+    struct rtree_bulk_level levels[64];
+    int num_levels = 0;
+    int max_cells = (node_size - RTREE_BULK_HEADER) / RTREE_BULK_CELL;
+    sqlite3_int64 base;
+    int lvl;
+    int ok = 0;
+
+    levels[0].items = leaves;
+    levels[0].count = count;
+    levels[0].base = 0;
+    num_levels = 1;
+    while (levels[num_levels - 1].count > max_cells)
+      {
+	  /* one more level is required */
+	  struct rtree_bulk_level *child = levels + (num_levels - 1);
+	  struct rtree_bulk_level *parent = levels + num_levels;
+	  int n_nodes = (child->count + max_cells - 1) / max_cells;
+	  int i;
+	  if (num_levels >= 64)
+	      goto stop;
+	  rtree_bulk_str_sort (child->items, child->count, max_cells);
+	  parent->items = malloc (sizeof (struct rtree_bulk_item) * n_nodes);
+	  if (parent->items == NULL)
+	      goto stop;
+	  parent->count = n_nodes;
+	  parent->base = 0;
+	  num_levels++;
+	  for (i = 0; i < n_nodes; i++)
+	    {
+		/* each parent cell covers the MBR of a whole child node */
+		struct rtree_bulk_item *cell = parent->items + i;
+		const struct rtree_bulk_item *item =
+		    child->items + (i * max_cells);
+		int n = child->count - (i * max_cells);
+		int ic;
+		if (n > max_cells)
+		    n = max_cells;
+		cell->id = i;
+		cell->minx = item->minx;
+		cell->maxx = item->maxx;
+		cell->miny = item->miny;
+		cell->maxy = item->maxy;
+		for (ic = 1; ic < n; ic++)
+		  {
+		      item++;
+		      if (item->minx < cell->minx)
+			  cell->minx = item->minx;
+		      if (item->maxx > cell->maxx)
+			  cell->maxx = item->maxx;
+		      if (item->miny < cell->miny)
+			  cell->miny = item->miny;
+		      if (item->maxy > cell->maxy)
+			  cell->maxy = item->maxy;
+		  }
+	    }
+      }
+
+/* assigning node numbers: the root always is #1, then top-down */
+    base = 2;
+    for (lvl = num_levels - 2; lvl >= 0; lvl--)
+      {
+	  levels[lvl].base = base;
+	  base += (levels[lvl].count + max_cells - 1) / max_cells;
+      }
+    ok = rtree_bulk_write (sqlite, xrtree, levels, num_levels, max_cells,
+			   node_size);
+
+  stop:
+    for (lvl = 1; lvl < num_levels; lvl++)
+	free (levels[lvl].items);
+    return ok;
+}
+
+SPATIALITE_PRIVATE int
+buildSpatialIndexPacked (void *p_sqlite, const unsigned char *table,
+			 const char *column)
+{
+/* 
+/ bulk loading a SpatialIndex [RTree] by writing a fully packed
+/ Sort-Tile-Recursive tree directly into the R*Tree shadow tables
+/
+/ returns 0 on success, -1 if the ordinary row-by-row loading
+/ is required (the R*Tree is left untouched in this case)
+*/
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    char *raw;
+    char *xrtree;
+    char *xtable;
+    char *xcolumn;
+    int node_size;
+    int count = 0;
+    int ret;
+    int ok = 0;
+    struct rtree_bulk_item *items = NULL;
+
+    raw = sqlite3_mprintf ("idx_%s_%s", table, column);
+    xrtree = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    xtable = gaiaDoubleQuotedSql ((const char *) table);
+    xcolumn = gaiaDoubleQuotedSql (column);
+
+    ret =
+	sqlite3_exec (sqlite, "SAVEPOINT splite_rtree_bulk", NULL, NULL,
+		      NULL);
+    if (ret != SQLITE_OK)
+	goto stop;
+    node_size = rtree_bulk_node_size (sqlite, xrtree);
+    if (node_size > 0
+	&& rtree_bulk_load (sqlite, xtable, xcolumn, &items, &count))
+      {
+	  if (count == 0)
+	      ok = 1;		/* empty table: nothing to be done */
+	  else
+	      ok = rtree_bulk_build (sqlite, xrtree, items, count,
+				     node_size);
+      }
+    if (!ok)
+	sqlite3_exec (sqlite, "ROLLBACK TO splite_rtree_bulk", NULL, NULL,
+		      NULL);
+    sqlite3_exec (sqlite, "RELEASE splite_rtree_bulk", NULL, NULL, NULL);
+
+  stop:
+    if (items != NULL)
+	free (items);
+    free (xrtree);
+    free (xtable);
+    free (xcolumn);
+    return ok ? 0 : -1;
+}
+
+/*
+/ Deferred SpatialIndex maintenance
+/
+/ while the Deferred mode is enabled RTreeAlign() (as called by the
+/ gii_ and giu_ triggers) simply records the ROWID of each row to be
+/ aligned; the R*Tree will be then aligned all at once by the next
+/ flush, so to avoid a lot of node splits during bulk loads.
+/ SQLite never allows to write an R*Tree while a COMMIT is in
+/ progress, so the pending rows must be explicitly flushed before
+/ committing the current transaction: the DeferredSpatialIndexTxn
+/ virtual table joins every transaction recording some pending row,
+/ and any COMMIT still leaving some row to be aligned will fail
+/ with SQLITE_BUSY, the transaction being left open.
+*/
+
+struct rtree_deferred_item
+{
+/* a row to be aligned, sorted by the Hilbert code of its center */
+    sqlite3_int64 rowid;
+    double minx;
+    double maxx;
+    double miny;
+    double maxy;
+    unsigned int key;
+};
+
+static unsigned int
+rtree_deferred_hilbert (unsigned int x, unsigned int y)
+{
+/* position of X,Y along a 65536 x 65536 Hilbert curve */
+    unsigned int n = 65536;
+    unsigned int s;
+    unsigned int rx;
+    unsigned int ry;
+    unsigned int t;
+    unsigned int d = 0;
+    for (s = n / 2; s > 0; s /= 2)
+      {
+	  rx = (x & s) > 0;
+	  ry = (y & s) > 0;
+	  d += s * s * ((3 * rx) ^ ry);
+	  if (ry == 0)
+	    {
+		if (rx == 1)
+		  {
+		      x = n - 1 - x;
+		      y = n - 1 - y;
+		  }
+		t = x;
+		x = y;
+		y = t;
+	    }
+      }
+    return d;
+}
+
+static int
+rtree_deferred_cmp_rowid (const void *p1, const void *p2)
+{
+/* qsort comparator: ROWID */
+    sqlite3_int64 r1 = *((const sqlite3_int64 *) p1);
+    sqlite3_int64 r2 = *((const sqlite3_int64 *) p2);
+    if (r1 < r2)
+	return -1;
+    if (r1 > r2)
+	return 1;
+    return 0;
+}
+
+static int
+rtree_deferred_cmp_key (const void *p1, const void *p2)
+{
+/* qsort comparator: Hilbert code, then ROWID */
+    const struct rtree_deferred_item *i1 =
+	(const struct rtree_deferred_item *) p1;
+    const struct rtree_deferred_item *i2 =
+	(const struct rtree_deferred_item *) p2;
+    if (i1->key < i2->key)
+	return -1;
+    if (i1->key > i2->key)
+	return 1;
+    if (i1->rowid < i2->rowid)
+	return -1;
+    if (i1->rowid > i2->rowid)
+	return 1;
+    return 0;
+}
+
+static void
+rtree_deferred_free (struct splite_deferred_rtree *p)
+{
+/* destroying a list of pending rows */
+    if (p->rtree != NULL)
+	free (p->rtree);
+    if (p->rowids != NULL)
+	free (p->rowids);
+    free (p);
+}
+
+SPATIALITE_PRIVATE void
+splite_free_deferred_rtree (const void *p_cache)
+{
+/* discarding all pending rows */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    struct splite_deferred_rtree *p;
+    struct splite_deferred_rtree *pn;
+    if (cache == NULL)
+	return;
+    p = cache->first_deferred_rtree;
+    while (p != NULL)
+      {
+	  pn = p->next;
+	  rtree_deferred_free (p);
+	  p = pn;
+      }
+    cache->first_deferred_rtree = NULL;
+}
+
+static int
+rtree_deferred_append (struct splite_internal_cache *cache, const char *rtree,
+		       sqlite3_int64 pkid)
+{
+/* appending a row to the list of the pending rows */
+    struct splite_deferred_rtree *p;
+    struct splite_deferred_rtree *prev = NULL;
+    int len;
+
+    p = cache->first_deferred_rtree;
+    while (p != NULL)
+      {
+	  if (strcasecmp (p->rtree, rtree) == 0)
+	      break;
+	  prev = p;
+	  p = p->next;
+      }
+    if (p == NULL)
+      {
+	  /* first row for this R*Tree */
+	  p = malloc (sizeof (struct splite_deferred_rtree));
+	  if (p == NULL)
+	      return 0;
+	  len = strlen (rtree);
+	  p->rtree = malloc (len + 1);
+	  if (p->rtree == NULL)
+	    {
+		free (p);
+		return 0;
+	    }
+	  strcpy (p->rtree, rtree);
+	  p->rowids = NULL;
+	  p->count = 0;
+	  p->allocated = 0;
+	  p->next = cache->first_deferred_rtree;
+	  cache->first_deferred_rtree = p;
+      }
+    else if (prev != NULL)
+      {
+	  /* moving the most recently used R*Tree in first position */
+	  prev->next = p->next;
+	  p->next = cache->first_deferred_rtree;
+	  cache->first_deferred_rtree = p;
+      }
+    if (p->count >= p->allocated)
+      {
+	  sqlite3_int64 *save;
+	  int new_max = (p->allocated == 0) ? 4096 : p->allocated * 2;
+	  if (new_max < p->allocated)
+	      return 0;		/* integer overflow */
+	  save = realloc (p->rowids, sizeof (sqlite3_int64) * new_max);
+	  if (save == NULL)
+	      return 0;
+	  p->rowids = save;
+	  p->allocated = new_max;
+      }
+    p->rowids[p->count++] = pkid;
+    return 1;
+}
+
+static char *
+rtree_deferred_string (const char *value)
+{
+/* duplicating a string */
+    int len = strlen (value);
+    char *dup = malloc (len + 1);
+    strcpy (dup, value);
+    return dup;
+}
+
+static int
+rtree_deferred_locate (sqlite3 * sqlite, const char *rtree, char **db_prefix,
+		       char **table, char **column)
+{
+/* 
+/ identifying the DB containing some R*Tree (exactly as RTreeAlign
+/ does: TEMP first, then MAIN and then any ATTACHED DB), and then
+/ the Geometry column supported by the R*Tree itself
+/
+/ returns 0 on failure; *db_prefix will be NULL if the R*Tree
+/ no longer exists (nothing is left to be aligned in this case)
+/ and *table will be NULL if the R*Tree isn't a SpatialIndex
+*/
+    char *sql;
+    char *xprefix;
+    sqlite3_stmt *stmt = NULL;
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    int i;
+    int pass;
+    int found;
+
+    *db_prefix = NULL;
+    *table = NULL;
+    *column = NULL;
+    ret =
+	sqlite3_get_table (sqlite, "PRAGMA database_list", &results, &rows,
+			   &columns, NULL);
+    if (ret != SQLITE_OK)
+	return 0;
+    for (pass = 0; pass < 2 && *db_prefix == NULL; pass++)
+      {
+	  for (i = 1; i <= rows && *db_prefix == NULL; i++)
+	    {
+		const char *name = results[(i * columns) + 1];
+		int is_temp = (strcasecmp (name, "temp") == 0);
+		if ((pass == 0 && !is_temp) || (pass == 1 && is_temp))
+		    continue;
+		xprefix = gaiaDoubleQuotedSql (name);
+		sql =
+		    sqlite3_mprintf
+		    ("SELECT Count(*) FROM \"%s\".sqlite_master "
+		     "WHERE type = 'table' AND Lower(name) = Lower(%Q)",
+		     xprefix, rtree);
+		free (xprefix);
+		ret =
+		    sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt,
+					NULL);
+		sqlite3_free (sql);
+		if (ret != SQLITE_OK)
+		    continue;
+		found = 0;
+		if (sqlite3_step (stmt) == SQLITE_ROW)
+		    found = sqlite3_column_int (stmt, 0);
+		sqlite3_finalize (stmt);
+		if (found)
+		    *db_prefix = rtree_deferred_string (name);
+	    }
+      }
+    sqlite3_free_table (results);
+    if (*db_prefix == NULL)
+	return 1;		/* the R*Tree has been dropped */
+
+    xprefix = gaiaDoubleQuotedSql (*db_prefix);
+    sql =
+	sqlite3_mprintf
+	("SELECT f_table_name, f_geometry_column FROM \"%s\".geometry_columns "
+	 "WHERE spatial_index_enabled = 1 AND Lower('idx_' || f_table_name || "
+	 "'_' || f_geometry_column) = Lower(%Q)", xprefix, rtree);
+    free (xprefix);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW)
+      {
+	  *table =
+	      rtree_deferred_string ((const char *)
+				     sqlite3_column_text (stmt, 0));
+	  *column =
+	      rtree_deferred_string ((const char *)
+				     sqlite3_column_text (stmt, 1));
+      }
+    sqlite3_finalize (stmt);
+    if (ret == SQLITE_ROW || ret == SQLITE_DONE)
+	return 1;
+    return 0;
+}
+
+static int
+rtree_deferred_rebuild (sqlite3 * sqlite, const char *xrtree,
+			const char *table, const char *column)
+{
+/* 
+/ emptying the R*Tree shadow tables (the root node becomes
+/ an empty leaf), then bulk loading the whole R*Tree
+*/
+    char *sql;
+    int ret;
+    sql = sqlite3_mprintf ("DELETE FROM \"%s_rowid\"; "
+			   "DELETE FROM \"%s_parent\"; "
+			   "DELETE FROM \"%s_node\" WHERE nodeno <> 1; "
+			   "UPDATE \"%s_node\" SET data = zeroblob(length(data)) "
+			   "WHERE nodeno = 1", xrtree, xrtree, xrtree, xrtree);
+    ret = sqlite3_exec (sqlite, sql, NULL, NULL, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    if (buildSpatialIndexEx
+	(sqlite, (const unsigned char *) table, column) != 0)
+	return 0;
+    return 1;
+}
+
+static int
+rtree_deferred_apply (sqlite3 * sqlite, struct splite_deferred_rtree *p)
+{
+/* 
+/ aligning an R*Tree: small batches are inserted in Hilbert order,
+/ a batch at least as large as the current R*Tree is rather
+/ applied by bulk loading again the whole R*Tree (MAIN DB only)
+*/
+    char *sql;
+    char *xprefix = NULL;
+    char *xrtree = NULL;
+    char *xtable = NULL;
+    char *xcolumn = NULL;
+    char *db_prefix = NULL;
+    char *table = NULL;
+    char *column = NULL;
+    sqlite3_stmt *stmt_mbr = NULL;
+    sqlite3_stmt *stmt_del = NULL;
+    sqlite3_stmt *stmt_ins = NULL;
+    struct rtree_deferred_item *items = NULL;
+    sqlite3_int64 indexed = 0;
+    int count = 0;
+    int n = 0;
+    int i;
+    int ret;
+    int ok = 0;
+    int reported = 0;
+    double minx = DBL_MAX;
+    double miny = DBL_MAX;
+    double maxx = -DBL_MAX;
+    double maxy = -DBL_MAX;
+    double scale_x;
+    double scale_y;
+
+/* sorting the pending ROWIDs and removing duplicates */
+    qsort (p->rowids, p->count, sizeof (sqlite3_int64),
+	   rtree_deferred_cmp_rowid);
+    for (i = 0; i < p->count; i++)
+      {
+	  if (count > 0 && p->rowids[count - 1] == p->rowids[i])
+	      continue;
+	  p->rowids[count++] = p->rowids[i];
+      }
+    p->count = count;
+
+    if (!rtree_deferred_locate (sqlite, p->rtree, &db_prefix, &table, &column))
+	goto stop;
+    if (db_prefix == NULL)
+      {
+	  /* the R*Tree has been dropped: nothing is left to be aligned */
+	  ok = 1;
+	  goto stop;
+      }
+    if (table == NULL)
+      {
+	  /* an R*Tree not supporting any Geometry column */
+	  spatialite_e
+	      ("FlushDeferredSpatialIndex error: \"%s\".\"%s\" isn't a SpatialIndex\n",
+	       db_prefix, p->rtree);
+	  reported = 1;
+	  goto stop;
+      }
+    xprefix = gaiaDoubleQuotedSql (db_prefix);
+    xrtree = gaiaDoubleQuotedSql (p->rtree);
+    xtable = gaiaDoubleQuotedSql (table);
+    xcolumn = gaiaDoubleQuotedSql (column);
+
+/* counting how many rows are currently indexed */
+    sql =
+	sqlite3_mprintf ("SELECT Count(*) FROM \"%s\".\"%s_rowid\"", xprefix,
+			 xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_mbr, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    ret = sqlite3_step (stmt_mbr);
+    if (ret == SQLITE_ROW)
+	indexed = sqlite3_column_int64 (stmt_mbr, 0);
+    sqlite3_finalize (stmt_mbr);
+    stmt_mbr = NULL;
+    if (ret != SQLITE_ROW)
+	goto stop;
+    if (count >= indexed && strcasecmp (db_prefix, "main") == 0)
+      {
+	  ok = rtree_deferred_rebuild (sqlite, xrtree, table, column);
+	  goto stop;
+      }
+
+/* fetching the current MBR of each pending row */
+    sql =
+	sqlite3_mprintf
+	("SELECT MbrMinX(\"%s\"), MbrMaxX(\"%s\"), MbrMinY(\"%s\"), "
+	 "MbrMaxY(\"%s\") FROM \"%s\".\"%s\" WHERE ROWID = ?", xcolumn,
+	 xcolumn, xcolumn, xcolumn, xprefix, xtable);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_mbr, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    sql =
+	sqlite3_mprintf ("DELETE FROM \"%s\".\"%s\" WHERE pkid = ?", xprefix,
+			 xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_del, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    items = malloc (sizeof (struct rtree_deferred_item) * count);
+    if (items == NULL)
+	goto stop;
+    for (i = 0; i < count; i++)
+      {
+	  struct rtree_deferred_item *item = items + n;
+	  int valid = 0;
+	  sqlite3_reset (stmt_mbr);
+	  sqlite3_clear_bindings (stmt_mbr);
+	  sqlite3_bind_int64 (stmt_mbr, 1, p->rowids[i]);
+	  ret = sqlite3_step (stmt_mbr);
+	  if (ret == SQLITE_ROW)
+	    {
+		if (sqlite3_column_type (stmt_mbr, 0) != SQLITE_NULL)
+		  {
+		      item->rowid = p->rowids[i];
+		      item->minx = sqlite3_column_double (stmt_mbr, 0);
+		      item->maxx = sqlite3_column_double (stmt_mbr, 1);
+		      item->miny = sqlite3_column_double (stmt_mbr, 2);
+		      item->maxy = sqlite3_column_double (stmt_mbr, 3);
+		      valid = 1;
+		  }
+	    }
+	  else if (ret != SQLITE_DONE)
+	      goto stop;
+	  if (valid)
+	    {
+		if (minx > item->minx)
+		    minx = item->minx;
+		if (miny > item->miny)
+		    miny = item->miny;
+		if (maxx < item->maxx)
+		    maxx = item->maxx;
+		if (maxy < item->maxy)
+		    maxy = item->maxy;
+		n++;
+		continue;
+	    }
+	  /* deleted row or NULL Geometry: never indexed */
+	  sqlite3_reset (stmt_del);
+	  sqlite3_clear_bindings (stmt_del);
+	  sqlite3_bind_int64 (stmt_del, 1, p->rowids[i]);
+	  ret = sqlite3_step (stmt_del);
+	  if (ret != SQLITE_DONE)
+	      goto stop;
+      }
+
+/* sorting the rows by the Hilbert code of their center */
+    scale_x = (maxx > minx) ? 65535.0 / (maxx - minx) : 0.0;
+    scale_y = (maxy > miny) ? 65535.0 / (maxy - miny) : 0.0;
+    for (i = 0; i < n; i++)
+      {
+	  struct rtree_deferred_item *item = items + i;
+	  double cx = ((item->minx + item->maxx) / 2.0 - minx) * scale_x;
+	  double cy = ((item->miny + item->maxy) / 2.0 - miny) * scale_y;
+	  item->key =
+	      rtree_deferred_hilbert ((unsigned int) cx, (unsigned int) cy);
+      }
+    qsort (items, n, sizeof (struct rtree_deferred_item),
+	   rtree_deferred_cmp_key);
+
+/* inserting into the R*Tree; an already indexed row will be replaced */
+    sql =
+	sqlite3_mprintf
+	("INSERT OR REPLACE INTO \"%s\".\"%s\" (pkid, xmin, xmax, ymin, ymax) "
+	 "VALUES (?, ?, ?, ?, ?)", xprefix, xrtree);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_ins, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto stop;
+    for (i = 0; i < n; i++)
+      {
+	  struct rtree_deferred_item *item = items + i;
+	  sqlite3_reset (stmt_ins);
+	  sqlite3_clear_bindings (stmt_ins);
+	  sqlite3_bind_int64 (stmt_ins, 1, item->rowid);
+	  sqlite3_bind_double (stmt_ins, 2, item->minx);
+	  sqlite3_bind_double (stmt_ins, 3, item->maxx);
+	  sqlite3_bind_double (stmt_ins, 4, item->miny);
+	  sqlite3_bind_double (stmt_ins, 5, item->maxy);
+	  ret = sqlite3_step (stmt_ins);
+	  if (ret != SQLITE_DONE)
+	      goto stop;
+      }
+    ok = 1;
+
+  stop:
+    if (!ok && !reported)
+      {
+	  spatialite_e ("FlushDeferredSpatialIndex error on \"%s\": %s\n",
+			p->rtree, sqlite3_errmsg (sqlite));
+      }
+    sqlite3_finalize (stmt_mbr);
+    sqlite3_finalize (stmt_del);
+    sqlite3_finalize (stmt_ins);
+    if (items != NULL)
+	free (items);
+    if (xprefix != NULL)
+	free (xprefix);
+    if (xrtree != NULL)
+	free (xrtree);
+    if (xtable != NULL)
+	free (xtable);
+    if (xcolumn != NULL)
+	free (xcolumn);
+    if (db_prefix != NULL)
+	free (db_prefix);
+    if (table != NULL)
+	free (table);
+    if (column != NULL)
+	free (column);
+    return ok;
+}
+
+SPATIALITE_PRIVATE int
+flushDeferredSpatialIndex (void *p_sqlite, const void *p_cache)
+{
+/* 
+/ aligning all R*Trees affected by some pending row
+/
+/ returns the number of aligned rows, or -1 on failure
+/ (the pending rows of a failing R*Tree will be preserved)
+*/
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    struct splite_deferred_rtree *p;
+    int total = 0;
+    int ret;
+    int ok;
+
+    if (cache == NULL)
+	return -1;
+    while (cache->first_deferred_rtree != NULL)
+      {
+	  p = cache->first_deferred_rtree;
+	  ret =
+	      sqlite3_exec (sqlite, "SAVEPOINT splite_rtree_deferred", NULL,
+			    NULL, NULL);
+	  if (ret != SQLITE_OK)
+	      return -1;
+	  ok = rtree_deferred_apply (sqlite, p);
+	  if (!ok)
+	      sqlite3_exec (sqlite, "ROLLBACK TO splite_rtree_deferred", NULL,
+			    NULL, NULL);
+	  sqlite3_exec (sqlite, "RELEASE splite_rtree_deferred", NULL, NULL,
+			NULL);
+	  if (!ok)
+	      return -1;
+	  total += p->count;
+	  cache->first_deferred_rtree = p->next;
+	  rtree_deferred_free (p);
+      }
+    return total;
+}
+
+/*
+/ DeferredSpatialIndexTxn is an eponymous virtual table never
+/ returning any row; writing into it simply causes the current
+/ transaction to be joined, so to be notified about its end
+*/
+
+typedef struct VirtualDeferredTxnStruct
+{
+/* extends the sqlite3_vtab struct */
+    const sqlite3_module *pModule;	/* ptr to sqlite module: USED INTERNALLY BY SQLITE */
+    int nRef;			/* # references: USED INTERNALLY BY SQLITE */
+    char *zErrMsg;		/* error message: USE INTERNALLY BY SQLITE */
+    struct splite_internal_cache *cache;
+} VirtualDeferredTxn;
+typedef VirtualDeferredTxn *VirtualDeferredTxnPtr;
+
+typedef struct VirtualDeferredTxnCursorStruct
+{
+/* extends the sqlite3_vtab_cursor struct */
+    VirtualDeferredTxnPtr pVtab;	/* Virtual table of this cursor */
+} VirtualDeferredTxnCursor;
+typedef VirtualDeferredTxnCursor *VirtualDeferredTxnCursorPtr;
+
+static sqlite3_module my_deferred_txn_module;
+
+static int
+vdtxn_connect (sqlite3 * db, void *pAux, int argc, const char *const *argv,
+	       sqlite3_vtab ** ppVTab, char **pzErr)
+{
+/* connects the virtual table */
+    VirtualDeferredTxnPtr p_vt;
+    if (pAux == NULL)
+      {
+	  *pzErr = sqlite3_mprintf ("[DeferredSpatialIndexTxn] no cache\n");
+	  return SQLITE_ERROR;
+      }
+    p_vt = (VirtualDeferredTxnPtr) sqlite3_malloc (sizeof (VirtualDeferredTxn));
+    if (!p_vt)
+	return SQLITE_NOMEM;
+    p_vt->pModule = &my_deferred_txn_module;
+    p_vt->nRef = 0;
+    p_vt->zErrMsg = NULL;
+    p_vt->cache = (struct splite_internal_cache *) pAux;
+    if (sqlite3_declare_vtab (db, "CREATE TABLE x(txn INTEGER)") != SQLITE_OK)
+      {
+	  sqlite3_free (p_vt);
+	  return SQLITE_ERROR;
+      }
+    *ppVTab = (sqlite3_vtab *) p_vt;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_best_index (sqlite3_vtab * pVTab, sqlite3_index_info * pIdxInfo)
+{
+/* best index selection */
+    if (pVTab || pIdxInfo)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    pIdxInfo->estimatedCost = 1.0;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_disconnect (sqlite3_vtab * pVTab)
+{
+/* disconnects the virtual table */
+    sqlite3_free (pVTab);
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_open (sqlite3_vtab * pVTab, sqlite3_vtab_cursor ** ppCursor)
+{
+/* opening a new cursor */
+    VirtualDeferredTxnCursorPtr cursor =
+	(VirtualDeferredTxnCursorPtr)
+	sqlite3_malloc (sizeof (VirtualDeferredTxnCursor));
+    if (cursor == NULL)
+	return SQLITE_NOMEM;
+    cursor->pVtab = (VirtualDeferredTxnPtr) pVTab;
+    *ppCursor = (sqlite3_vtab_cursor *) cursor;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_close (sqlite3_vtab_cursor * pCursor)
+{
+/* closing the cursor */
+    sqlite3_free (pCursor);
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
+	      int argc, sqlite3_value ** argv)
+{
+/* setting up a cursor filter: nothing to do */
+    if (pCursor || idxNum || idxStr || argc || argv)
+	pCursor = pCursor;	/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_next (sqlite3_vtab_cursor * pCursor)
+{
+/* fetching the next row: nothing to do */
+    if (pCursor)
+	pCursor = pCursor;	/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_eof (sqlite3_vtab_cursor * pCursor)
+{
+/* never returning any row */
+    if (pCursor)
+	pCursor = pCursor;	/* unused arg warning suppression */
+    return 1;
+}
+
+static int
+vdtxn_column (sqlite3_vtab_cursor * pCursor, sqlite3_context * pContext,
+	      int column)
+{
+/* fetching a column value: never called */
+    if (pCursor || column)
+	pCursor = pCursor;	/* unused arg warning suppression */
+    sqlite3_result_null (pContext);
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_rowid (sqlite3_vtab_cursor * pCursor, sqlite_int64 * pRowid)
+{
+/* fetching the ROWID: never called */
+    if (pCursor)
+	pCursor = pCursor;	/* unused arg warning suppression */
+    *pRowid = 0;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
+	      sqlite_int64 * pRowid)
+{
+/* "writing" into the virtual table: nothing to do */
+    if (pVTab || argc || argv)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    *pRowid = 0;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_begin (sqlite3_vtab * pVTab)
+{
+/* the current transaction has been joined */
+    VirtualDeferredTxnPtr p_vt = (VirtualDeferredTxnPtr) pVTab;
+    p_vt->cache->deferred_rtree_txn = 1;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_sync (sqlite3_vtab * pVTab)
+{
+/* 
+/ COMMIT is starting: SQLITE_BUSY will leave the transaction open
+/ if some row is still waiting to be aligned (any other error code
+/ would rather cause the whole transaction to be rolled back)
+*/
+    VirtualDeferredTxnPtr p_vt = (VirtualDeferredTxnPtr) pVTab;
+    if (p_vt->cache->first_deferred_rtree == NULL)
+	return SQLITE_OK;
+    sqlite3_free (p_vt->zErrMsg);
+    p_vt->zErrMsg =
+	sqlite3_mprintf
+	("COMMIT rejected: call FlushDeferredSpatialIndex() before committing "
+	 "(the transaction is still open)");
+    return SQLITE_BUSY;
+}
+
+static int
+vdtxn_commit (sqlite3_vtab * pVTab)
+{
+/* the transaction has been committed */
+    VirtualDeferredTxnPtr p_vt = (VirtualDeferredTxnPtr) pVTab;
+    p_vt->cache->deferred_rtree_txn = 0;
+    return SQLITE_OK;
+}
+
+static int
+vdtxn_rollback (sqlite3_vtab * pVTab)
+{
+/* a rolled back transaction discards all pending rows */
+    VirtualDeferredTxnPtr p_vt = (VirtualDeferredTxnPtr) pVTab;
+    p_vt->cache->deferred_rtree_txn = 0;
+    splite_free_deferred_rtree (p_vt->cache);
+    return SQLITE_OK;
+}
+
+SPATIALITE_PRIVATE int
+deferred_spatialindex_extension_init (void *p_sqlite, const void *p_cache)
+{
+/* registering the DeferredSpatialIndexTxn module */
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    if (p_cache == NULL)
+	return SQLITE_OK;	/* the Deferred mode requires a cache */
+    my_deferred_txn_module.iVersion = 1;
+    my_deferred_txn_module.xCreate = NULL;	/* eponymous only */
+    my_deferred_txn_module.xConnect = &vdtxn_connect;
+    my_deferred_txn_module.xBestIndex = &vdtxn_best_index;
+    my_deferred_txn_module.xDisconnect = &vdtxn_disconnect;
+    my_deferred_txn_module.xDestroy = &vdtxn_disconnect;
+    my_deferred_txn_module.xOpen = &vdtxn_open;
+    my_deferred_txn_module.xClose = &vdtxn_close;
+    my_deferred_txn_module.xFilter = &vdtxn_filter;
+    my_deferred_txn_module.xNext = &vdtxn_next;
+    my_deferred_txn_module.xEof = &vdtxn_eof;
+    my_deferred_txn_module.xColumn = &vdtxn_column;
+    my_deferred_txn_module.xRowid = &vdtxn_rowid;
+    my_deferred_txn_module.xUpdate = &vdtxn_update;
+    my_deferred_txn_module.xBegin = &vdtxn_begin;
+    my_deferred_txn_module.xSync = &vdtxn_sync;
+    my_deferred_txn_module.xCommit = &vdtxn_commit;
+    my_deferred_txn_module.xRollback = &vdtxn_rollback;
+    my_deferred_txn_module.xFindFunction = NULL;
+    my_deferred_txn_module.xRename = NULL;
+    return sqlite3_create_module_v2 (sqlite, "DeferredSpatialIndexTxn",
+				     &my_deferred_txn_module, (void *) p_cache,
+				     0);
+}
+
+SPATIALITE_PRIVATE int
+deferSpatialIndexRow (void *p_sqlite, const void *p_cache, const char *rtree,
+		      sqlite3_int64 pkid)
+{
+/* 
+/ recording a row to be aligned on some R*Tree by the next flush,
+/ after having joined the current transaction (if not yet done)
+/
+/ returns 0 if the row must be immediately aligned
+*/
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    int ret;
+    if (cache == NULL || !(cache->deferred_rtree_mode))
+	return 0;
+    if (!(cache->deferred_rtree_txn))
+      {
+	  ret =
+	      sqlite3_exec (sqlite,
+			    "INSERT INTO main.DeferredSpatialIndexTxn (txn) VALUES (1)",
+			    NULL, NULL, NULL);
+	  if (ret != SQLITE_OK || !(cache->deferred_rtree_txn))
+	      return 0;
+      }
+    return rtree_deferred_append (cache, rtree, pkid);
+}
+
+SPATIALITE_PRIVATE int
+enableDeferredSpatialIndex (void *p_sqlite, const void *p_cache)
+{
+/* enabling the Deferred SpatialIndex mode */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    if (p_sqlite == NULL || cache == NULL)
+	return 0;
+    cache->deferred_rtree_mode = 1;
+    return 1;
+}
+
+SPATIALITE_PRIVATE int
+disableDeferredSpatialIndex (void *p_sqlite, const void *p_cache)
+{
+/* 
+/ disabling the Deferred SpatialIndex mode, after flushing
+/
+/ returns the number of aligned rows, or -1 on failure
+/ (the Deferred mode still remains enabled in this case)
+*/
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    int total;
+    if (cache == NULL)
+	return -1;
+    if (!(cache->deferred_rtree_mode))
+	return 0;
+    total = flushDeferredSpatialIndex (sqlite, cache);
+    if (total < 0)
+	return -1;
+    cache->deferred_rtree_mode = 0;
+    return total;
+}
@@ -145,21 +145,6 @@ Regione Toscana - Settore Sistema Informativo Territoriale ed Ambientale
 #define LINESTRING_MAX_SEGMENT_LENGTH	2
 #define LINESTRING_AVG_SEGMENT_LENGTH	3
 
-struct gaia_geom_chain_item
-{
-/* a struct used to store a chain item */
-    gaiaGeomCollPtr geom;
-    struct gaia_geom_chain_item *next;
-};
-
-struct gaia_geom_chain
-{
-/* a struct used to store a dynamic chain of GeometryCollections */
-    int all_polygs;
-    struct gaia_geom_chain_item *first;
-    struct gaia_geom_chain_item *last;
-};
-
 #ifndef OMIT_GEOCALLBACKS	/* supporting RTree geometry callbacks */
 struct gaia_rtree_mbr
 {
@@ -1369,29 +1354,37 @@ fnct_GeometryConstraints (sqlite3_context * context, int argc,
       }
     switch (geom_type)
       {
-	  /* adjusting COMPRESSED Geometries */
+	  /* adjusting COMPRESSED and QUANTIZED Geometries */
       case GAIA_COMPRESSED_LINESTRING:
+      case GAIA_QUANTIZED_LINESTRING:
 	  geom_normalized_type = GAIA_LINESTRING;
 	  break;
       case GAIA_COMPRESSED_LINESTRINGZ:
+      case GAIA_QUANTIZED_LINESTRINGZ:
 	  geom_normalized_type = GAIA_LINESTRINGZ;
 	  break;
       case GAIA_COMPRESSED_LINESTRINGM:
+      case GAIA_QUANTIZED_LINESTRINGM:
 	  geom_normalized_type = GAIA_LINESTRINGM;
 	  break;
       case GAIA_COMPRESSED_LINESTRINGZM:
+      case GAIA_QUANTIZED_LINESTRINGZM:
 	  geom_normalized_type = GAIA_LINESTRINGZM;
 	  break;
       case GAIA_COMPRESSED_POLYGON:
+      case GAIA_QUANTIZED_POLYGON:
 	  geom_normalized_type = GAIA_POLYGON;
 	  break;
       case GAIA_COMPRESSED_POLYGONZ:
+      case GAIA_QUANTIZED_POLYGONZ:
 	  geom_normalized_type = GAIA_POLYGONZ;
 	  break;
       case GAIA_COMPRESSED_POLYGONM:
+      case GAIA_QUANTIZED_POLYGONM:
 	  geom_normalized_type = GAIA_POLYGONM;
 	  break;
       case GAIA_COMPRESSED_POLYGONZM:
+      case GAIA_QUANTIZED_POLYGONZM:
 	  geom_normalized_type = GAIA_POLYGONZM;
 	  break;
       default:
@@ -1443,6 +1436,7 @@ fnct_RTreeAlign (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int ret;
     char *sql_statement;
     sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (sqlite3_value_type (argv[0]) == SQLITE_TEXT)
 	rtree_table = (const char *) sqlite3_value_text (argv[0]);
@@ -1466,6 +1460,17 @@ fnct_RTreeAlign (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	  sqlite3_result_int (context, -1);
 	  return;
       }
+    if (cache != NULL && cache->deferred_rtree_mode
+	&& sqlite3_value_type (argv[2]) == SQLITE_BLOB
+	&& !sqlite3_get_autocommit (sqlite) && *rtree_table != '"')
+      {
+	  /* Deferred mode: the R*Tree will be aligned by the next flush */
+	  if (deferSpatialIndexRow (sqlite, cache, rtree_table, pkid))
+	    {
+		sqlite3_result_int (context, 1);
+		return;
+	    }
+      }
     if (sqlite3_value_type (argv[2]) == SQLITE_BLOB)
       {
 	  p_blob = (unsigned char *) sqlite3_value_blob (argv[2]);
@@ -1518,6 +1523,80 @@ fnct_RTreeAlign (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
 }
 
+static void
+fnct_EnableDeferredSpatialIndex (sqlite3_context * context, int argc,
+				 sqlite3_value ** argv)
+{
+/* SQL function:
+/ EnableDeferredSpatialIndex ( void )
+/
+/ from now on RTreeAlign() will simply record the rows to be
+/ aligned while a transaction is in progress; the R*Trees will
+/ be then aligned by FlushDeferredSpatialIndex(), that must be
+/ called before COMMIT (an unflushed COMMIT fails with SQLITE_BUSY
+/ and leaves the transaction open)
+/
+/ returns: 1 on success, 0 on failure
+*/
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    sqlite3_result_int (context, enableDeferredSpatialIndex (sqlite, cache));
+}
+
+static void
+fnct_FlushDeferredSpatialIndex (sqlite3_context * context, int argc,
+				sqlite3_value ** argv)
+{
+/* SQL function:
+/ FlushDeferredSpatialIndex ( void )
+/
+/ aligning all R*Trees affected by the rows recorded in Deferred mode
+/
+/ returns: the number of aligned rows, -1 on failure
+*/
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    sqlite3_result_int (context, flushDeferredSpatialIndex (sqlite, cache));
+}
+
+static void
+fnct_DisableDeferredSpatialIndex (sqlite3_context * context, int argc,
+				  sqlite3_value ** argv)
+{
+/* SQL function:
+/ DisableDeferredSpatialIndex ( void )
+/
+/ flushing all pending rows, then disabling the Deferred mode
+/
+/ returns: the number of aligned rows, -1 on failure
+*/
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    sqlite3_result_int (context, disableDeferredSpatialIndex (sqlite, cache));
+}
+
+static void
+fnct_GetDeferredSpatialIndexMode (sqlite3_context * context, int argc,
+				  sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetDeferredSpatialIndexMode ( void )
+/
+/ returns: TRUE or FALSE
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    sqlite3_result_int (context, cache->deferred_rtree_mode);
+}
+
 static void
 fnct_TemporaryRTreeAlign (sqlite3_context * context, int argc,
 			  sqlite3_value ** argv)
@@ -6573,6 +6652,28 @@ fnct_RecoverGeometryColumn (sqlite3_context * context, int argc,
     return;
 }
 
+static int
+discard_geometry_trigger (sqlite3 * sqlite, const char *prefix,
+			  const char *table, const char *column, char **errMsg)
+{
+/* dropping the "<prefix>_<table>_<column>" trigger [if any] */
+    char *raw;
+    char *quoted;
+    char *sql_statement;
+    int ret;
+    raw = sqlite3_mprintf ("%s_%s_%s", prefix, table, column);
+    quoted = gaiaDoubleQuotedSql (raw);
+    sqlite3_free (raw);
+    sql_statement =
+	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
+    free (quoted);
+    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, errMsg);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    return 1;
+}
+
 static void
 fnct_DiscardGeometryColumn (sqlite3_context * context, int argc,
 			    sqlite3_value ** argv)
@@ -6590,10 +6691,16 @@ fnct_DiscardGeometryColumn (sqlite3_context * context, int argc,
     char *p_column = NULL;
     sqlite3_stmt *stmt;
     char *sql_statement;
-    char *raw;
-    char *quoted;
     char *errMsg = NULL;
     int ret;
+    int i;
+    const char *prefixes[] = {
+	"ggi", "ggu", "gii", "giu", "gid", "gci", "gcu", "gcd",
+	"tmi", "tmu", "tmd", "tsi", "tsu", "tsd",
+	/* old versions [v2.0, v2.2] triggers [if any] */
+	"gti", "gtu", "gsi", "gsu",
+	NULL
+    };
     sqlite3 *sqlite = sqlite3_context_db_handle (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
@@ -6653,159 +6760,12 @@ fnct_DiscardGeometryColumn (sqlite3_context * context, int argc,
 	  sqlite3_result_int (context, 0);
 	  return;
       }
-    raw = sqlite3_mprintf ("ggi_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("ggu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gii_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("giu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gid_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gci_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gcu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gcd_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("tmi_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("tmu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("tmd_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-
-    /* trying to delete old versions [v2.0, v2.2] triggers[if any] */
-    raw = sqlite3_mprintf ("gti_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gtu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gsi_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    raw = sqlite3_mprintf ("gsu_%s_%s", p_table, p_column);
-    quoted = gaiaDoubleQuotedSql (raw);
-    sqlite3_free (raw);
-    sql_statement =
-	sqlite3_mprintf ("DROP TRIGGER IF EXISTS main.\"%s\"", quoted);
-    free (quoted);
-    ret = sqlite3_exec (sqlite, sql_statement, NULL, NULL, &errMsg);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto error;
-    /* end deletion old versions [v2.0, v2.2] triggers[if any] */
+    for (i = 0; prefixes[i] != NULL; i++)
+      {
+	  if (!discard_geometry_trigger
+	      (sqlite, prefixes[i], p_table, p_column, &errMsg))
+	      goto error;
+      }
 
     sqlite3_result_int (context, 1);
     updateSpatiaLiteHistory (sqlite, p_table,
@@ -9076,13 +9036,18 @@ fnct_CreateSpatialIndex (sqlite3_context * context, int argc,
 {
 /* SQL function:
 / CreateSpatialIndex(table, column )
+/ CreateSpatialIndex(table, column, aux_columns )
 /
 / creates a SpatialIndex based on Column and Table
+/ aux_columns is a comma separated list of table columns to be
+/ copied into the R*Tree as auxiliary columns (a covering index);
+/ POINT layers will also store the exact point_x and point_y
 / returns 1 on success
 / 0 on failure
 */
     const char *table;
     const char *column;
+    const char *aux_columns = NULL;
     char *sql_statement;
     char sql[1024];
     char *errMsg = NULL;
@@ -9105,6 +9070,17 @@ fnct_CreateSpatialIndex (sqlite3_context * context, int argc,
 	  return;
       }
     column = (const char *) sqlite3_value_text (argv[1]);
+    if (argc == 3)
+      {
+	  if (sqlite3_value_type (argv[2]) != SQLITE_TEXT)
+	    {
+		spatialite_e
+		    ("CreateSpatialIndex() error: argument 3 [aux_columns] is not of the String type\n");
+		sqlite3_result_int (context, 0);
+		return;
+	    }
+	  aux_columns = (const char *) sqlite3_value_text (argv[2]);
+      }
     if (is_without_rowid_table (sqlite, table))
       {
 	  spatialite_e
@@ -9120,6 +9096,15 @@ fnct_CreateSpatialIndex (sqlite3_context * context, int argc,
 	  sqlite3_result_int (context, -1);
 	  return;
       }
+    if (aux_columns != NULL
+	&& !checkSpatialIndexAuxColumns (sqlite, table, column, aux_columns))
+      {
+	  spatialite_e
+	      ("CreateSpatialIndex() error: invalid aux_columns \"%s\"\n",
+	       aux_columns);
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
     sql_statement =
 	sqlite3_mprintf
 	("UPDATE geometry_columns SET spatial_index_enabled = 1 "
@@ -9138,9 +9123,12 @@ fnct_CreateSpatialIndex (sqlite3_context * context, int argc,
 	  sqlite3_result_int (context, 0);
 	  return;
       }
-    updateGeometryTriggers (sqlite, table, column);
+    updateGeometryTriggersEx (sqlite, table, column, aux_columns);
     sqlite3_result_int (context, 1);
-    strcpy (sql, "R*Tree Spatial Index successfully created");
+    if (aux_columns != NULL)
+	strcpy (sql, "Covering R*Tree Spatial Index successfully created");
+    else
+	strcpy (sql, "R*Tree Spatial Index successfully created");
     updateSpatiaLiteHistory (sqlite, table, column, sql);
     return;
   error:
@@ -9361,7 +9349,9 @@ fnct_UpdateLayerStatistics (sqlite3_context * context, int argc,
     const char *sql;
     const char *table = NULL;
     const char *column = NULL;
+    int max_threads = 1;
     sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (argc >= 1)
       {
@@ -9385,7 +9375,9 @@ fnct_UpdateLayerStatistics (sqlite3_context * context, int argc,
 	    }
 	  column = (const char *) sqlite3_value_text (argv[1]);
       }
-    if (!update_layer_statistics (sqlite, table, column))
+    if (cache != NULL)
+	max_threads = cache->max_threads;
+    if (!update_layer_statistics_ex (sqlite, table, column, max_threads))
 	goto error;
     sqlite3_result_int (context, 1);
     sql = "UpdateLayerStatistics";
@@ -9596,6 +9588,117 @@ fnct_InvalidateLayerStatistics (sqlite3_context * context, int argc,
     return;
 }
 
+static void
+fnct_EnableIncrementalStatistics (sqlite3_context * context, int argc,
+				  sqlite3_value ** argv)
+{
+/* SQL function:
+/ EnableIncrementalStatistics(table, column)
+/
+/ updates the Layer Statistics and then creates a set of triggers
+/ incrementally maintaining row_count and the full extent
+/ returns 1 on success
+/ 0 on failure
+*/
+    const char *table;
+    const char *column;
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+      {
+	  spatialite_e
+	      ("EnableIncrementalStatistics() error: argument 1 [table_name] is not of the String type\n");
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    table = (const char *) sqlite3_value_text (argv[0]);
+    if (sqlite3_value_type (argv[1]) != SQLITE_TEXT)
+      {
+	  spatialite_e
+	      ("EnableIncrementalStatistics() error: argument 2 [column_name] is not of the String type\n");
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    column = (const char *) sqlite3_value_text (argv[1]);
+    if (!gaiaEnableIncrementalStatistics (sqlite, table, column))
+      {
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    sqlite3_result_int (context, 1);
+    updateSpatiaLiteHistory (sqlite, table, column,
+			     "Incremental Statistics successfully enabled");
+}
+
+static void
+fnct_DisableIncrementalStatistics (sqlite3_context * context, int argc,
+				   sqlite3_value ** argv)
+{
+/* SQL function:
+/ DisableIncrementalStatistics(table, column)
+/
+/ removes the Incremental Statistics triggers
+/ returns 1 on success
+/ 0 on failure
+*/
+    const char *table;
+    const char *column;
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+      {
+	  spatialite_e
+	      ("DisableIncrementalStatistics() error: argument 1 [table_name] is not of the String type\n");
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    table = (const char *) sqlite3_value_text (argv[0]);
+    if (sqlite3_value_type (argv[1]) != SQLITE_TEXT)
+      {
+	  spatialite_e
+	      ("DisableIncrementalStatistics() error: argument 2 [column_name] is not of the String type\n");
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    column = (const char *) sqlite3_value_text (argv[1]);
+    if (!gaiaDisableIncrementalStatistics (sqlite, table, column))
+      {
+	  sqlite3_result_int (context, 0);
+	  return;
+      }
+    sqlite3_result_int (context, 1);
+    updateSpatiaLiteHistory (sqlite, table, column,
+			     "Incremental Statistics successfully disabled");
+}
+
+static void
+fnct_HasIncrementalStatistics (sqlite3_context * context, int argc,
+			       sqlite3_value ** argv)
+{
+/* SQL function:
+/ HasIncrementalStatistics(table, column)
+/
+/ returns 1 if Incremental Statistics are enabled
+/ 0 if not
+/ -1 on invalid arguments
+*/
+    const char *table;
+    const char *column;
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT
+	|| sqlite3_value_type (argv[1]) != SQLITE_TEXT)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    table = (const char *) sqlite3_value_text (argv[0]);
+    column = (const char *) sqlite3_value_text (argv[1]);
+    sqlite3_result_int (context,
+			gaiaHasIncrementalStatistics (sqlite, table,
+						      column) ? 1 : 0);
+}
+
 static void
 fnct_CreateRasterCoveragesTable (sqlite3_context * context, int argc,
 				 sqlite3_value ** argv)
@@ -11132,6 +11235,49 @@ fnct_UpdateMetaCatalogStatistics (sqlite3_context * context, int argc,
     return;
 }
 
+static int
+blob_view_init (struct splite_internal_cache *cache,
+		const unsigned char *blob, int n_bytes, gaiaBlobViewPtr view)
+{
+/* helper function
+/ attempting to directly walk a SpatiaLite BLOB-Geometry
+/ (GPKG Geometries will always require a full decoding)
+*/
+    if (cache != NULL && cache->gpkg_mode)
+	return 0;
+    return gaiaBlobViewInit (view, blob, n_bytes);
+}
+
+static gaiaGeomArenaPtr
+acquire_geom_arena (struct splite_internal_cache *cache)
+{
+/* helper function
+/ grabbing the connection's Geometry Arena
+/ (NULL if already in use: ordinary heap allocation will be used)
+*/
+    if (cache == NULL || cache->geom_arena_busy)
+	return NULL;
+    if (cache->geom_arena == NULL)
+	cache->geom_arena = gaiaCreateGeomArena ();
+    if (cache->geom_arena == NULL)
+	return NULL;
+    cache->geom_arena_busy = 1;
+    return cache->geom_arena;
+}
+
+static void
+release_geom_arena (struct splite_internal_cache *cache,
+		    gaiaGeomArenaPtr arena)
+{
+/* helper function
+/ releasing at once all Geometries allocated from the Arena
+*/
+    if (arena == NULL)
+	return;
+    gaiaResetGeomArena (arena);
+    cache->geom_arena_busy = 0;
+}
+
 static gaiaPointPtr
 simplePoint (gaiaGeomCollPtr geo)
 {
@@ -11230,6 +11376,7 @@ fnct_AsText (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int len;
     gaiaOutBuffer out_buf;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int decimal_precision = -1;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
@@ -11249,9 +11396,10 @@ fnct_AsText (sqlite3_context * context, int argc, sqlite3_value ** argv)
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
     gaiaOutBufferInitialize (&out_buf);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
 	sqlite3_result_null (context);
     else
@@ -11270,6 +11418,7 @@ fnct_AsText (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	    }
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
     gaiaOutBufferReset (&out_buf);
 }
 
@@ -11288,6 +11437,7 @@ fnct_AsWkt (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int precision = 15;
     gaiaOutBuffer out_buf;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -11314,9 +11464,10 @@ fnct_AsWkt (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     gaiaOutBufferInitialize (&out_buf);
     if (!geo)
 	sqlite3_result_null (context);
@@ -11333,6 +11484,7 @@ fnct_AsWkt (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	    }
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
     gaiaOutBufferReset (&out_buf);
 }
 
@@ -11360,6 +11512,7 @@ fnct_AsSvg (sqlite3_context * context, int argc, sqlite3_value ** argv,
     int len;
     gaiaOutBuffer out_buf;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -11376,12 +11529,14 @@ fnct_AsSvg (sqlite3_context * context, int argc, sqlite3_value ** argv,
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
       {
 	  sqlite3_result_null (context);
+	  release_geom_arena (cache, arena);
 	  return;
       }
     else
@@ -11409,6 +11564,7 @@ fnct_AsSvg (sqlite3_context * context, int argc, sqlite3_value ** argv,
 	    }
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
     gaiaOutBufferReset (&out_buf);
 }
 
@@ -11793,6 +11949,7 @@ fnct_AsGml (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int precision = 15;
     gaiaOutBuffer out_buf;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -11859,9 +12016,10 @@ fnct_AsGml (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	  n_bytes = sqlite3_value_bytes (argv[0]);
       }
     gaiaOutBufferInitialize (&out_buf);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
 	sqlite3_result_null (context);
     else
@@ -11878,6 +12036,7 @@ fnct_AsGml (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	    }
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
     gaiaOutBufferReset (&out_buf);
 }
 
@@ -11912,6 +12071,7 @@ fnct_AsGeoJSON (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int options = 0;
     gaiaOutBuffer out_buf;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -11965,9 +12125,10 @@ fnct_AsGeoJSON (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	  n_bytes = sqlite3_value_bytes (argv[0]);
       }
     gaiaOutBufferInitialize (&out_buf);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
 	sqlite3_result_null (context);
     else
@@ -11984,6 +12145,7 @@ fnct_AsGeoJSON (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	    }
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
     gaiaOutBufferReset (&out_buf);
 }
 
@@ -12001,6 +12163,7 @@ fnct_AsBinary (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int len;
     unsigned char *p_result = NULL;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -12017,9 +12180,10 @@ fnct_AsBinary (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
 	sqlite3_result_null (context);
     else
@@ -12031,6 +12195,7 @@ fnct_AsBinary (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	      sqlite3_result_blob (context, p_result, len, free);
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
 }
 
 static void
@@ -12047,6 +12212,7 @@ fnct_AsFGF (sqlite3_context * context, int argc, sqlite3_value ** argv)
     int len;
     unsigned char *p_result = NULL;
     gaiaGeomCollPtr geo = NULL;
+    gaiaGeomArenaPtr arena = NULL;
     int coord_dims;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
@@ -12082,9 +12248,10 @@ fnct_AsFGF (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	  sqlite3_result_null (context);
 	  return;
       }
+    arena = acquire_geom_arena (cache);
     geo =
-	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
-				     gpkg_amphibious);
+	gaiaFromSpatiaLiteBlobWkbArena (arena, p_blob, n_bytes, gpkg_mode,
+					gpkg_amphibious);
     if (!geo)
 	sqlite3_result_null (context);
     else
@@ -12096,6 +12263,7 @@ fnct_AsFGF (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	      sqlite3_result_blob (context, p_result, len, free);
       }
     gaiaFreeGeomColl (geo);
+    release_geom_arena (cache, arena);
 }
 
 static void
@@ -15210,6 +15378,87 @@ fnct_CompressGeometry (sqlite3_context * context, int argc,
     gaiaFreeGeomColl (geo);
 }
 
+static void
+fnct_QuantizeGeometry (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ QuantizeGeometry(BLOB encoded geometry, int precision)
+/ QuantizeGeometry(BLOB encoded geometry, int xy_precision,
+/                  int z_precision)
+/ QuantizeGeometry(BLOB encoded geometry, int xy_precision,
+/                  int z_precision, int m_precision)
+/
+/ returns a QUANTIZED geometry [if a valid Geometry was supplied]
+/ or NULL in any other case
+/
+/ Linestrings and Rings are rounded to the given number of decimal
+/ digits and stored as integer deltas; Z and M precisions default
+/ to the XY precision
+*/
+    unsigned char *p_blob;
+    int n_bytes;
+    int len;
+    int xy_precision;
+    int z_precision;
+    int m_precision;
+    unsigned char *p_result = NULL;
+    gaiaGeomCollPtr geo = NULL;
+    int gpkg_amphibious = 0;
+    int gpkg_mode = 0;
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache != NULL)
+      {
+	  gpkg_amphibious = cache->gpkg_amphibious_mode;
+	  gpkg_mode = cache->gpkg_mode;
+      }
+    if (sqlite3_value_type (argv[0]) != SQLITE_BLOB)
+      {
+	  sqlite3_result_null (context);
+	  return;
+      }
+    if (sqlite3_value_type (argv[1]) != SQLITE_INTEGER)
+      {
+	  sqlite3_result_null (context);
+	  return;
+      }
+    xy_precision = sqlite3_value_int (argv[1]);
+    z_precision = xy_precision;
+    m_precision = xy_precision;
+    if (argc >= 3)
+      {
+	  if (sqlite3_value_type (argv[2]) != SQLITE_INTEGER)
+	    {
+		sqlite3_result_null (context);
+		return;
+	    }
+	  z_precision = sqlite3_value_int (argv[2]);
+      }
+    if (argc >= 4)
+      {
+	  if (sqlite3_value_type (argv[3]) != SQLITE_INTEGER)
+	    {
+		sqlite3_result_null (context);
+		return;
+	    }
+	  m_precision = sqlite3_value_int (argv[3]);
+      }
+    p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
+    n_bytes = sqlite3_value_bytes (argv[0]);
+    geo =
+	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
+				     gpkg_amphibious);
+    if (!geo)
+	sqlite3_result_null (context);
+    else if (!gaiaToQuantizedBlobWkb
+	     (geo, xy_precision, z_precision, m_precision, &p_result, &len))
+	sqlite3_result_null (context);
+    else
+	sqlite3_result_blob (context, p_result, len, free);
+    gaiaFreeGeomColl (geo);
+}
+
 static void
 fnct_UncompressGeometry (sqlite3_context * context, int argc,
 			 sqlite3_value ** argv)
@@ -18941,6 +19190,11 @@ fnct_X (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaPointPtr point;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
+    double x;
+    double y;
+    double z;
+    double m;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -18955,6 +19209,17 @@ fnct_X (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 1 && view.NumLinestrings == 0
+	      && view.NumPolygons == 0 && gaiaBlobViewNextPart (&view)
+	      && gaiaBlobViewNextVertex (&view, &x, &y, &z, &m))
+	      sqlite3_result_double (context, x);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -18986,6 +19251,11 @@ fnct_Y (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaPointPtr point;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
+    double x;
+    double y;
+    double z;
+    double m;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19000,6 +19270,17 @@ fnct_Y (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 1 && view.NumLinestrings == 0
+	      && view.NumPolygons == 0 && gaiaBlobViewNextPart (&view)
+	      && gaiaBlobViewNextVertex (&view, &x, &y, &z, &m))
+	      sqlite3_result_double (context, y);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19031,6 +19312,11 @@ fnct_Z (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaPointPtr point;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
+    double x;
+    double y;
+    double z;
+    double m;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19045,6 +19331,19 @@ fnct_Z (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 1 && view.NumLinestrings == 0
+	      && view.NumPolygons == 0 && gaiaBlobViewNextPart (&view)
+	      && gaiaBlobViewNextVertex (&view, &x, &y, &z, &m)
+	      && (view.PartDimensionModel == GAIA_XY_Z
+		  || view.PartDimensionModel == GAIA_XY_Z_M))
+	      sqlite3_result_double (context, z);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19082,6 +19381,11 @@ fnct_M (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaPointPtr point;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
+    double x;
+    double y;
+    double z;
+    double m;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19096,6 +19400,19 @@ fnct_M (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 1 && view.NumLinestrings == 0
+	      && view.NumPolygons == 0 && gaiaBlobViewNextPart (&view)
+	      && gaiaBlobViewNextVertex (&view, &x, &y, &z, &m)
+	      && (view.PartDimensionModel == GAIA_XY_M
+		  || view.PartDimensionModel == GAIA_XY_Z_M))
+	      sqlite3_result_double (context, m);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19133,6 +19450,7 @@ fnct_NumPoints (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaLinestringPtr line;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19147,6 +19465,16 @@ fnct_NumPoints (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 0 && view.NumLinestrings == 1
+	      && view.NumPolygons == 0)
+	      sqlite3_result_int (context, view.NumVertices);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19418,6 +19746,7 @@ fnct_NumInteriorRings (sqlite3_context * context, int argc,
     gaiaPolygonPtr polyg;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19432,6 +19761,16 @@ fnct_NumInteriorRings (sqlite3_context * context, int argc,
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  if (view.NumPoints == 0 && view.NumLinestrings == 0
+	      && view.NumPolygons == 1)
+	      sqlite3_result_int (context, view.NumRings - 1);
+	  else
+	      sqlite3_result_null (context);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19578,6 +19917,7 @@ fnct_NumGeometries (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaGeomCollPtr geo = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19592,6 +19932,14 @@ fnct_NumGeometries (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  sqlite3_result_int (context,
+			      view.NumPoints + view.NumLinestrings +
+			      view.NumPolygons);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19645,6 +19993,7 @@ fnct_NPoints (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaGeomCollPtr geo = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19659,6 +20008,12 @@ fnct_NPoints (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  sqlite3_result_int (context, view.NumVertices);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -19716,6 +20071,7 @@ fnct_NRings (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaGeomCollPtr geo = NULL;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    gaiaBlobView view;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
@@ -19730,6 +20086,12 @@ fnct_NRings (sqlite3_context * context, int argc, sqlite3_value ** argv)
       }
     p_blob = (unsigned char *) sqlite3_value_blob (argv[0]);
     n_bytes = sqlite3_value_bytes (argv[0]);
+    if (blob_view_init (cache, p_blob, n_bytes, &view))
+      {
+	  /* fast path: directly walking the BLOB */
+	  sqlite3_result_int (context, view.NumRings);
+	  return;
+      }
     geo =
 	gaiaFromSpatiaLiteBlobWkbEx (p_blob, n_bytes, gpkg_mode,
 				     gpkg_amphibious);
@@ -26717,41 +27079,6 @@ fnct_Intersection (sqlite3_context * context, int argc, sqlite3_value ** argv)
     gaiaFreeGeomColl (geo2);
 }
 
-static int
-gaia_union_polygs (gaiaGeomCollPtr geom)
-{
-/* testing if this geometry simply contains Polygons */
-    int pts = 0;
-    int lns = 0;
-    int pgs = 0;
-    gaiaPointPtr pt;
-    gaiaLinestringPtr ln;
-    gaiaPolygonPtr pg;
-    pt = geom->FirstPoint;
-    while (pt)
-      {
-	  pts++;
-	  pt = pt->Next;
-      }
-    ln = geom->FirstLinestring;
-    while (ln)
-      {
-	  lns++;
-	  ln = ln->Next;
-      }
-    pg = geom->FirstPolygon;
-    while (pg)
-      {
-	  pgs++;
-	  pg = pg->Next;
-      }
-    if (pts || lns)
-	return 0;
-    if (!pgs)
-	return 0;
-    return 1;
-}
-
 static void
 fnct_Union_step (sqlite3_context * context, int argc, sqlite3_value ** argv)
 {
@@ -26760,21 +27087,23 @@ fnct_Union_step (sqlite3_context * context, int argc, sqlite3_value ** argv)
 /
 / aggregate function - STEP
 /
+/ Geometries are reduced incrementally in bounded batches (see
+/ union_reducer.c), so memory usage does not depend on the row count
 */
-    struct gaia_geom_chain *chain;
-    struct gaia_geom_chain_item *item;
     unsigned char *p_blob;
     int n_bytes;
     gaiaGeomCollPtr geom;
-    struct gaia_geom_chain **p;
+    void **p;
     int gpkg_amphibious = 0;
     int gpkg_mode = 0;
+    int max_threads = 1;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
     GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
     if (cache != NULL)
       {
 	  gpkg_amphibious = cache->gpkg_amphibious_mode;
 	  gpkg_mode = cache->gpkg_mode;
+	  max_threads = cache->max_threads;
       }
     if (sqlite3_value_type (argv[0]) != SQLITE_BLOB)
       {
@@ -26788,46 +27117,23 @@ fnct_Union_step (sqlite3_context * context, int argc, sqlite3_value ** argv)
 				     gpkg_amphibious);
     if (!geom)
 	return;
-    p = sqlite3_aggregate_context (context, sizeof (struct gaia_geom_chain **));
-    if (!(*p))
-      {
-	  /* this is the first row */
-	  chain = malloc (sizeof (struct gaia_geom_chain));
-	  *p = chain;
-	  item = malloc (sizeof (struct gaia_geom_chain_item));
-	  item->geom = geom;
-	  item->next = NULL;
-	  chain->all_polygs = gaia_union_polygs (geom);
-	  chain->first = item;
-	  chain->last = item;
-      }
-    else
+    p = sqlite3_aggregate_context (context, sizeof (void *));
+    if (p == NULL)
       {
-	  /* subsequent rows */
-	  chain = *p;
-	  item = malloc (sizeof (struct gaia_geom_chain_item));
-	  item->geom = geom;
-	  item->next = NULL;
-	  if (!gaia_union_polygs (geom))
-	      chain->all_polygs = 0;
-	  chain->last->next = item;
-	  chain->last = item;
+	  gaiaFreeGeomColl (geom);
+	  return;
       }
-}
-
-static void
-gaia_free_geom_chain (struct gaia_geom_chain *chain)
-{
-    struct gaia_geom_chain_item *p = chain->first;
-    struct gaia_geom_chain_item *pn;
-    while (p)
+    if (!(*p))
       {
-	  pn = p->next;
-	  gaiaFreeGeomColl (p->geom);
-	  free (p);
-	  p = pn;
+	  /* this is the first row */
+	  *p = gaiaUnionReducerCreate (cache, max_threads);
+	  if (*p == NULL)
+	    {
+		gaiaFreeGeomColl (geom);
+		return;
+	    }
       }
-    free (chain);
+    gaiaUnionReducerAdd (*p, geom);
 }
 
 static void
@@ -26839,13 +27145,8 @@ fnct_Union_final (sqlite3_context * context)
 / aggregate function - FINAL
 /
 */
-    gaiaGeomCollPtr tmp;
-    struct gaia_geom_chain *chain;
-    struct gaia_geom_chain_item *item;
-    gaiaGeomCollPtr aggregate = NULL;
     gaiaGeomCollPtr result;
-    void *data = sqlite3_user_data (context);
-    struct gaia_geom_chain **p = sqlite3_aggregate_context (context, 0);
+    void **p = sqlite3_aggregate_context (context, 0);
     int gpkg_mode = 0;
     int tiny_point = 0;
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -26854,41 +27155,14 @@ fnct_Union_final (sqlite3_context * context)
 	  gpkg_mode = cache->gpkg_mode;
 	  tiny_point = cache->tinyPointEnabled;
       }
-    if (!p)
+    if (!p || !(*p))
       {
 	  sqlite3_result_null (context);
 	  return;
       }
-    chain = *p;
-
-/* applying UnaryUnion */
-    item = chain->first;
-    while (item)
-      {
-	  gaiaGeomCollPtr geom = item->geom;
-	  if (item == chain->first)
-	    {
-		/* initializing the aggregate geometry */
-		aggregate = geom;
-		item->geom = NULL;
-		item = item->next;
-		continue;
-	    }
-	  if (data != NULL)
-	      tmp = gaiaMergeGeometries_r (data, aggregate, geom);
-	  else
-	      tmp = gaiaMergeGeometries (aggregate, geom);
-	  gaiaFreeGeomColl (geom);
-	  item->geom = NULL;
-	  aggregate = tmp;
-	  item = item->next;
-      }
-    if (data != NULL)
-	result = gaiaUnaryUnion_r (data, aggregate);
-    else
-	result = gaiaUnaryUnion (aggregate);
-    gaiaFreeGeomColl (aggregate);
-    gaia_free_geom_chain (chain);
+    result = gaiaUnionReducerFinish (*p);
+    gaiaUnionReducerDestroy (*p);
+    *p = NULL;
 
     if (result == NULL)
 	sqlite3_result_null (context);
@@ -32886,6 +33160,94 @@ fnct_Cutter (sqlite3_context * context, int argc, sqlite3_value ** argv)
     sqlite3_result_int (context, ret);
 }
 
+static void
+fnct_DissolveTable (sqlite3_context * context, int argc, sqlite3_value ** argv)
+{
+/* SQL function:
+/ DissolveTable(TEXT input_table, TEXT input_geom, TEXT group_by,
+/               TEXT output_table)
+/
+/ input_geom can eventually be NULL, and in this case the geometry
+/ column name will be automatically determined.
+/ group_by is a comma separated list of column names, and can
+/ eventually be NULL: in this case all Geometries will be united
+/ into a single one; key values are compared exactly (BINARY),
+/ but 1 and 1.0 are considered to be the same key.
+/
+/ the "output" table *must* not exists, and will be automatically
+/ created within the MAIN database; groups are united using up to
+/ GetMaxThreads() worker threads
+/
+/ returns:
+/ 1 on success
+/ an Exception on failure.
+*/
+    sqlite3 *sqlite;
+    const char *input_table;
+    const char *input_geom = NULL;
+    const char *group_by = NULL;
+    const char *output_table;
+    const char *arg_name;
+    int max_threads = 1;
+    char *err = NULL;
+    char *msg;
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+      {
+	  arg_name = "1st arg";
+	  goto invalid_args;
+      }
+    input_table = (const char *) sqlite3_value_text (argv[0]);
+    if (sqlite3_value_type (argv[1]) == SQLITE_TEXT)
+	input_geom = (const char *) sqlite3_value_text (argv[1]);
+    else if (sqlite3_value_type (argv[1]) != SQLITE_NULL)
+      {
+	  arg_name = "2nd arg";
+	  goto invalid_args;
+      }
+    if (sqlite3_value_type (argv[2]) == SQLITE_TEXT)
+	group_by = (const char *) sqlite3_value_text (argv[2]);
+    else if (sqlite3_value_type (argv[2]) != SQLITE_NULL)
+      {
+	  arg_name = "3rd arg";
+	  goto invalid_args;
+      }
+    if (sqlite3_value_type (argv[3]) != SQLITE_TEXT)
+      {
+	  arg_name = "4th arg";
+	  goto invalid_args;
+      }
+    output_table = (const char *) sqlite3_value_text (argv[3]);
+    if (cache != NULL)
+	max_threads = cache->max_threads;
+
+    sqlite = sqlite3_context_db_handle (context);
+    if (!gaiaDissolveTable
+	(sqlite, cache, input_table, input_geom, group_by, output_table,
+	 max_threads, &err))
+      {
+	  if (err != NULL)
+	      msg = sqlite3_mprintf ("DissolveTable exception - %s", err);
+	  else
+	      msg = sqlite3_mprintf ("DissolveTable exception - failure");
+	  sqlite3_result_error (context, msg, -1);
+	  sqlite3_free (msg);
+	  sqlite3_free (err);
+	  return;
+      }
+    sqlite3_result_int (context, 1);
+    return;
+
+  invalid_args:
+    msg =
+	sqlite3_mprintf ("DissolveTable exception - invalid argument (%s).",
+			 arg_name);
+    sqlite3_result_error (context, msg, -1);
+    sqlite3_free (msg);
+    return;
+}
+
 static void
 fnct_GetCutterMessage (sqlite3_context * context, int argc,
 		       sqlite3_value ** argv)
@@ -37125,6 +37487,90 @@ fnct_RenameColumn (sqlite3_context * context, int argc, sqlite3_value ** argv)
     return;
 }
 
+static void
+fnct_TransformGeometryColumn (sqlite3_context * context, int argc,
+			      sqlite3_value ** argv)
+{
+/* SQL function:
+/ TransformGeometryColumn(TEXT table, TEXT column, INT srid)
+/ TransformGeometryColumn(TEXT table, TEXT column, INT srid, BOOL permissive)
+/
+/ reprojects all Geometries stored into a Geometry Column, using
+/ up to GetMaxThreads() worker threads
+/
+/ returns:
+/ 1 on success
+/ an Exception on failure.
+*/
+    const char *table;
+    const char *column;
+    int srid;
+    const char *arg_name;
+    int permissive = 0;
+    int max_threads = 1;
+    char *err;
+    char *msg;
+    sqlite3 *db_handle = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+      {
+	  arg_name = "1st arg";
+	  goto invalid_args;
+      }
+    table = (const char *) sqlite3_value_text (argv[0]);
+    if (sqlite3_value_type (argv[1]) != SQLITE_TEXT)
+      {
+	  arg_name = "2nd arg";
+	  goto invalid_args;
+      }
+    column = (const char *) sqlite3_value_text (argv[1]);
+    if (sqlite3_value_type (argv[2]) != SQLITE_INTEGER)
+      {
+	  arg_name = "3rd arg";
+	  goto invalid_args;
+      }
+    srid = sqlite3_value_int (argv[2]);
+    if (argc >= 4)
+      {
+	  if (sqlite3_value_type (argv[3]) != SQLITE_INTEGER)
+	    {
+		arg_name = "4th arg";
+		goto invalid_args;
+	    }
+	  permissive = sqlite3_value_int (argv[3]);
+      }
+    if (cache != NULL)
+	max_threads = cache->max_threads;
+    if (!gaiaTransformGeometryColumn
+	(db_handle, cache, table, column, srid, max_threads, &err))
+      {
+	  if (permissive)
+	    {
+		sqlite3_free (err);
+		sqlite3_result_int (context, 0);
+		return;
+	    }
+	  msg =
+	      sqlite3_mprintf ("TransformGeometryColumn exception - %s.", err);
+	  sqlite3_result_error (context, msg, -1);
+	  sqlite3_free (msg);
+	  sqlite3_free (err);
+	  return;
+      }
+    sqlite3_result_int (context, 1);
+    return;
+
+  invalid_args:
+    msg =
+	sqlite3_mprintf
+	("TransformGeometryColumn exception - invalid argument (%s).",
+	 arg_name);
+    sqlite3_result_error (context, msg, -1);
+    sqlite3_free (msg);
+    return;
+}
+
 static void
 fnct_sp_get_last_error (sqlite3_context * context, int argc,
 			sqlite3_value ** argv)
@@ -39066,6 +39512,12 @@ fnct_create_routing (sqlite3_context * context, int argc, sqlite3_value ** argv)
 /               geom-column TEXT , cost-column TEXT , name-column TEXT ,
 /               a-star-enabled BOOLEAN , bidirectional BOOLEAN ,
 /               oneway-from TEXT , oneway-to TEXT , overwrite BOOLEAN )
+/ CreateRouting(routing-data-table TEXT , virtual-routing-table TEXT , 
+/               input-table TEXT , from-column TEXT , to-column TEXT , 
+/               geom-column TEXT , cost-column TEXT , name-column TEXT ,
+/               a-star-enabled BOOLEAN , bidirectional BOOLEAN ,
+/               oneway-from TEXT , oneway-to TEXT , overwrite BOOLEAN ,
+/               contraction-hierarchies BOOLEAN )
 /
 / returns:
 / 1 on succes
@@ -39084,6 +39536,7 @@ fnct_create_routing (sqlite3_context * context, int argc, sqlite3_value ** argv)
     const char *oneway_from = NULL;
     const char *oneway_to = NULL;
     int overwrite = 0;
+    int contraction_hierarchies = 0;
     const char *msg;
     sqlite3 *sqlite = sqlite3_context_db_handle (context);
     struct splite_internal_cache *cache = sqlite3_user_data (context);
@@ -39151,11 +39604,17 @@ fnct_create_routing (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	      goto invalid_argument_13;
 	  overwrite = sqlite3_value_int (argv[12]);
       }
-    if (gaia_create_routing
+    if (argc >= 14)
+      {
+	  if (sqlite3_value_type (argv[13]) != SQLITE_INTEGER)
+	      goto invalid_argument_14;
+	  contraction_hierarchies = sqlite3_value_int (argv[13]);
+      }
+    if (gaia_create_routing_ex
 	(sqlite, cache, routing_data_table, virtual_routing_table,
 	 input_table, from_column, to_column, geom_column, cost_column,
 	 name_column, a_star_enabled, bidirectional, oneway_from, oneway_to,
-	 overwrite))
+	 overwrite, contraction_hierarchies))
 	sqlite3_result_int (context, 1);
     else
       {
@@ -39249,6 +39708,12 @@ fnct_create_routing (sqlite3_context * context, int argc, sqlite3_value ** argv)
 	"CreateRouting exception - illegal OverWrite option [not an INTEGER].";
     sqlite3_result_error (context, msg, -1);
     return;
+
+  invalid_argument_14:
+    msg =
+	"CreateRouting exception - illegal ContractionHierarchies option [not an INTEGER].";
+    sqlite3_result_error (context, msg, -1);
+    return;
 }
 
 static void
@@ -39278,6 +39743,61 @@ fnct_create_routing_get_last_error (sqlite3_context * context, int argc,
 	sqlite3_result_text (context, err_msg, strlen (err_msg), SQLITE_STATIC);
 }
 
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static void
+fnct_create_routing_graph_file (sqlite3_context * context, int argc,
+				sqlite3_value ** argv)
+{
+/* SQL function:
+/ CreateRoutingGraphFile(TEXT routing_data_table, TEXT graph_file)
+/
+/ returns:
+/ 1 on success
+/ raises an exception on failure
+*/
+    const char *routing_data_table;
+    const char *graph_file;
+    const char *msg;
+    sqlite3 *sqlite = sqlite3_context_db_handle (context);
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+      {
+	  msg =
+	      "CreateRoutingGraphFile exception - illegal Routing-Data Table Name [not a TEXT string].";
+	  sqlite3_result_error (context, msg, -1);
+	  return;
+      }
+    routing_data_table = (const char *) sqlite3_value_text (argv[0]);
+    if (sqlite3_value_type (argv[1]) != SQLITE_TEXT)
+      {
+	  msg =
+	      "CreateRoutingGraphFile exception - illegal Graph-file [not a TEXT string].";
+	  sqlite3_result_error (context, msg, -1);
+	  return;
+      }
+    graph_file = (const char *) sqlite3_value_text (argv[1]);
+    if (gaia_create_routing_graph_file
+	(sqlite, cache, routing_data_table, graph_file))
+	sqlite3_result_int (context, 1);
+    else
+      {
+	  /* there was an error, raising an Exception */
+	  char *msg_err;
+	  msg = gaia_create_routing_get_last_error (cache);
+	  if (msg == NULL)
+	      msg_err =
+		  sqlite3_mprintf
+		  ("CreateRoutingGraphFile exception - Unknown reason");
+	  else
+	      msg_err =
+		  sqlite3_mprintf ("CreateRoutingGraphFile exception - %s", msg);
+	  sqlite3_result_error (context, msg_err, -1);
+	  sqlite3_free (msg_err);
+      }
+}
+#endif /* end GEOS conditional */
+
 #ifndef OMIT_FREEXL		/* FREEXL is enabled */
 static void
 fnct_ImportXLS (sqlite3_context * context, int argc, sqlite3_value ** argv)
@@ -46932,6 +47452,280 @@ fnct_getDecimalPrecision (sqlite3_context * context, int argc,
     sqlite3_result_int (context, cache->decimal_precision);
 }
 
+static void
+fnct_setMaxThreads (sqlite3_context * context, int argc, sqlite3_value ** argv)
+{
+/* SQL function:
+/ SetMaxThreads ( int max_threads )
+/ sets the max number of worker threads used by parallel functions
+/ (e.g. UpdateLayerStatistics); 1 (default) means serial processing
+/
+/ returns: nothing
+*/
+    int max_threads;
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+	return;
+    if (sqlite3_value_type (argv[0]) == SQLITE_INTEGER)
+	max_threads = sqlite3_value_int (argv[0]);
+    else
+	return;
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    cache->max_threads = max_threads;
+}
+
+static void
+fnct_getMaxThreads (sqlite3_context * context, int argc, sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetMaxThreads ( void )
+/
+/ returns: the max number of worker threads used by parallel functions
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, 1);
+	  return;
+      }
+    sqlite3_result_int (context, cache->max_threads);
+}
+
+static void
+fnct_setGeosCacheSize (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ SetGeosCacheSize ( int max_items )
+/ sets the max number of GEOS Prepared Geometries kept in the cache
+/ a negative value identifies the default setting
+/ ZERO disables the cache at all
+/
+/ returns: nothing
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+	return;
+    if (sqlite3_value_type (argv[0]) == SQLITE_INTEGER)
+	splite_geos_cache_set_size (cache, sqlite3_value_int (argv[0]));
+}
+
+static void
+fnct_getGeosCacheSize (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetGeosCacheSize ( void )
+/
+/ returns: the max number of GEOS Prepared Geometries kept in the cache
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int (context, cache->geosCache.maxItems);
+}
+
+static void
+fnct_getGeosCacheHits (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetGeosCacheHits ( void )
+/
+/ returns: how many times an already prepared GEOS geometry was reused
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->geosCache.hits);
+}
+
+static void
+fnct_getGeosCacheMisses (sqlite3_context * context, int argc,
+			 sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetGeosCacheMisses ( void )
+/
+/ returns: how many times no prepared GEOS geometry was available
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->geosCache.misses);
+}
+
+static void
+fnct_getGeosCacheEvictions (sqlite3_context * context, int argc,
+			    sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetGeosCacheEvictions ( void )
+/
+/ returns: how many prepared GEOS geometries were evicted from the cache
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->geosCache.evictions);
+}
+
+static void
+fnct_resetGeosCacheStatistics (sqlite3_context * context, int argc,
+			       sqlite3_value ** argv)
+{
+/* SQL function:
+/ ResetGeosCacheStatistics ( void )
+/
+/ resets the hit/miss/eviction counters of the GEOS cache
+/ returns: nothing
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+	return;
+    cache->geosCache.hits = 0;
+    cache->geosCache.misses = 0;
+    cache->geosCache.evictions = 0;
+}
+
+static void
+fnct_setProjCacheSize (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ SetProjCacheSize ( int max_items )
+/ sets the max number of PROJ transformation objects kept in the cache
+/ a negative value identifies the default setting
+/ ZERO disables the cache at all
+/
+/ returns: nothing
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+	return;
+    if (sqlite3_value_type (argv[0]) == SQLITE_INTEGER)
+	splite_proj_cache_set_size (cache, sqlite3_value_int (argv[0]));
+}
+
+static void
+fnct_getProjCacheSize (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetProjCacheSize ( void )
+/
+/ returns: the max number of PROJ transformation objects kept in the cache
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int (context, cache->projCache.maxItems);
+}
+
+static void
+fnct_getProjCacheHits (sqlite3_context * context, int argc,
+		       sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetProjCacheHits ( void )
+/
+/ returns: how many times a cached PROJ transformation was reused
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->projCache.hits);
+}
+
+static void
+fnct_getProjCacheMisses (sqlite3_context * context, int argc,
+			 sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetProjCacheMisses ( void )
+/
+/ returns: how many times a PROJ transformation had to be created
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->projCache.misses);
+}
+
+static void
+fnct_getProjCacheEvictions (sqlite3_context * context, int argc,
+			    sqlite3_value ** argv)
+{
+/* SQL function:
+/ GetProjCacheEvictions ( void )
+/
+/ returns: how many PROJ transformations were evicted from the cache
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+      {
+	  sqlite3_result_int (context, -1);
+	  return;
+      }
+    sqlite3_result_int64 (context, cache->projCache.evictions);
+}
+
+static void
+fnct_resetProjCacheStatistics (sqlite3_context * context, int argc,
+			       sqlite3_value ** argv)
+{
+/* SQL function:
+/ ResetProjCacheStatistics ( void )
+/
+/ resets the hit/miss/eviction counters of the PROJ cache
+/ returns: nothing
+*/
+    struct splite_internal_cache *cache = sqlite3_user_data (context);
+    GAIA_UNUSED ();		/* LCOV_EXCL_LINE */
+    if (cache == NULL)
+	return;
+    cache->projCache.hits = 0;
+    cache->projCache.misses = 0;
+    cache->projCache.evictions = 0;
+}
+
 static void
 fnct_enableTinyPoint (sqlite3_context * context, int argc,
 		      sqlite3_value ** argv)
@@ -48345,8 +49139,20 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_GeometryConstraints, 0, 0, 0);
     sqlite3_create_function_v2 (db, "RTreeAlign", 3,
-				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_RTreeAlign, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "EnableDeferredSpatialIndex", 0,
+				SQLITE_UTF8, cache,
+				fnct_EnableDeferredSpatialIndex, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "FlushDeferredSpatialIndex", 0,
+				SQLITE_UTF8, cache,
+				fnct_FlushDeferredSpatialIndex, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "DisableDeferredSpatialIndex", 0,
+				SQLITE_UTF8, cache,
+				fnct_DisableDeferredSpatialIndex, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetDeferredSpatialIndexMode", 0,
+				SQLITE_UTF8, cache,
+				fnct_GetDeferredSpatialIndexMode, 0, 0, 0);
     sqlite3_create_function_v2 (db, "TemporaryRTreeAlign", 4,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_TemporaryRTreeAlign, 0, 0, 0);
@@ -48555,6 +49361,11 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "CreateSpatialIndex", 2,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_CreateSpatialIndex, 0, 0, 0);
+#if SQLITE_VERSION_NUMBER >= 3024000	/* R*Tree auxiliary columns */
+    sqlite3_create_function_v2 (db, "CreateSpatialIndex", 3,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
+				fnct_CreateSpatialIndex, 0, 0, 0);
+#endif
     sqlite3_create_function_v2 (db, "CreateTemporarySpatialIndex", 3,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_CreateTemporarySpatialIndex, 0, 0, 0);
@@ -48568,13 +49379,13 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_RebuildGeometryTriggers, 0, 0, 0);
     sqlite3_create_function_v2 (db, "UpdateLayerStatistics", 0,
-				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_UpdateLayerStatistics, 0, 0, 0);
     sqlite3_create_function_v2 (db, "UpdateLayerStatistics", 1,
-				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_UpdateLayerStatistics, 0, 0, 0);
     sqlite3_create_function_v2 (db, "UpdateLayerStatistics", 2,
-				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_UpdateLayerStatistics, 0, 0, 0);
     sqlite3_create_function_v2 (db, "GetLayerExtent", 1,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
@@ -48594,6 +49405,15 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "InvalidateLayerStatistics", 2,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_InvalidateLayerStatistics, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "EnableIncrementalStatistics", 2,
+				SQLITE_UTF8, 0,
+				fnct_EnableIncrementalStatistics, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "DisableIncrementalStatistics", 2,
+				SQLITE_UTF8, 0,
+				fnct_DisableIncrementalStatistics, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "HasIncrementalStatistics", 2,
+				SQLITE_UTF8, 0,
+				fnct_HasIncrementalStatistics, 0, 0, 0);
     sqlite3_create_function_v2 (db, "CreateRasterCoveragesTable", 0,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_CreateRasterCoveragesTable, 0, 0, 0);
@@ -49207,6 +50027,15 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "CompressGeometry", 1,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_CompressGeometry, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "QuantizeGeometry", 2,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
+				fnct_QuantizeGeometry, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "QuantizeGeometry", 3,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
+				fnct_QuantizeGeometry, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "QuantizeGeometry", 4,
+				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
+				fnct_QuantizeGeometry, 0, 0, 0);
     sqlite3_create_function_v2 (db, "UncompressGeometry", 1,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_UncompressGeometry, 0, 0, 0);
@@ -50199,6 +51028,12 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "RenameColumn", 5,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0,
 				fnct_RenameColumn, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "TransformGeometryColumn", 3,
+				SQLITE_UTF8, cache,
+				fnct_TransformGeometryColumn, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "TransformGeometryColumn", 4,
+				SQLITE_UTF8, cache,
+				fnct_TransformGeometryColumn, 0, 0, 0);
 
     sqlite3_create_function_v2 (db, "SqlProc_GetLastError", 0, SQLITE_UTF8,
 				cache, fnct_sp_get_last_error, 0, 0, 0);
@@ -50910,6 +51745,8 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
 				fnct_create_routing, 0, 0, 0);
     sqlite3_create_function_v2 (db, "CreateRouting", 13, SQLITE_UTF8, cache,
 				fnct_create_routing, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "CreateRouting", 14, SQLITE_UTF8, cache,
+				fnct_create_routing, 0, 0, 0);
     sqlite3_create_function_v2 (db, "CreateRouting_GetLastError", 0,
 				SQLITE_UTF8, cache,
 				fnct_create_routing_get_last_error, 0, 0, 0);
@@ -50962,6 +51799,9 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
 	  sqlite3_create_function_v2 (db, "ImportDXFfromDir", 8,
 				      SQLITE_UTF8 | SQLITE_DETERMINISTIC,
 				      cache, fnct_ImportDXFfromDir, 0, 0, 0);
+	  sqlite3_create_function_v2 (db, "CreateRoutingGraphFile", 2,
+				      SQLITE_UTF8, cache,
+				      fnct_create_routing_graph_file, 0, 0, 0);
 
 #endif /* GEOS enabled */
 
@@ -51264,6 +52104,40 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "GetDecimalPrecision", 0,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_getDecimalPrecision, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "SetMaxThreads", 1, SQLITE_UTF8, cache,
+				fnct_setMaxThreads, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetMaxThreads", 0, SQLITE_UTF8, cache,
+				fnct_getMaxThreads, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "SetGeosCacheSize", 1,
+				SQLITE_UTF8, cache, fnct_setGeosCacheSize, 0, 0,
+				0);
+    sqlite3_create_function_v2 (db, "GetGeosCacheSize", 0, SQLITE_UTF8,
+				cache, fnct_getGeosCacheSize, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetGeosCacheHits", 0, SQLITE_UTF8,
+				cache, fnct_getGeosCacheHits, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetGeosCacheMisses", 0, SQLITE_UTF8,
+				cache, fnct_getGeosCacheMisses, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetGeosCacheEvictions", 0,
+				SQLITE_UTF8, cache, fnct_getGeosCacheEvictions,
+				0, 0, 0);
+    sqlite3_create_function_v2 (db, "ResetGeosCacheStatistics", 0,
+				SQLITE_UTF8, cache,
+				fnct_resetGeosCacheStatistics, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "SetProjCacheSize", 1,
+				SQLITE_UTF8, cache, fnct_setProjCacheSize, 0, 0,
+				0);
+    sqlite3_create_function_v2 (db, "GetProjCacheSize", 0, SQLITE_UTF8,
+				cache, fnct_getProjCacheSize, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetProjCacheHits", 0, SQLITE_UTF8,
+				cache, fnct_getProjCacheHits, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetProjCacheMisses", 0, SQLITE_UTF8,
+				cache, fnct_getProjCacheMisses, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "GetProjCacheEvictions", 0,
+				SQLITE_UTF8, cache, fnct_getProjCacheEvictions,
+				0, 0, 0);
+    sqlite3_create_function_v2 (db, "ResetProjCacheStatistics", 0,
+				SQLITE_UTF8, cache,
+				fnct_resetProjCacheStatistics, 0, 0, 0);
 
     sqlite3_create_function_v2 (db, "*Add-VirtualTable+Extent", 6,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
@@ -52487,6 +53361,9 @@ register_spatialite_sql_functions (void *p_db, const void *p_cache)
     sqlite3_create_function_v2 (db, "GetCutterMessage", 0,
 				SQLITE_UTF8, cache,
 				fnct_GetCutterMessage, 0, 0, 0);
+    sqlite3_create_function_v2 (db, "DissolveTable", 4,
+				SQLITE_UTF8, cache,
+				fnct_DissolveTable, 0, 0, 0);
     sqlite3_create_function_v2 (db, "ST_DrapeLine", 2,
 				SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache,
 				fnct_DrapeLine, 0, 0, 0);
@@ -53394,15 +54271,21 @@ init_spatialite_virtualtables (void *p_db, const void *p_cache)
     virtualbbox_extension_init (db, p_cache);
 /* initializing the VirtualSpatialIndex  extension */
     virtual_spatialindex_extension_init (db);
+/* initializing the VirtualSpatialJoin  extension */
+    virtual_spatialjoin_extension_init (db, p_cache);
+/* initializing the DeferredSpatialIndexTxn  extension */
+    deferred_spatialindex_extension_init (db, p_cache);
 /* initializing the VirtualElementary  extension */
     virtual_elementary_extension_init (db);
 
 #ifndef OMIT_GEOS		/* only if GEOS is supported */
 /* initializing the VirtualRouting  extension */
-    virtualrouting_extension_init (db);
+    virtualrouting_extension_init (db, p_cache);
 #ifndef OMIT_KNN		/* only if KNN is enabled */
 /* initializing the VirtualKNN  extension */
     virtual_knn_extension_init (db);
+/* initializing the VirtualKNNJoin  extension */
+    virtual_knnjoin_extension_init (db, p_cache);
 #endif /* end KNN conditional */
 #endif /* end GEOS conditional */
 
@@ -878,7 +878,7 @@ do_update_virts_field_infos (sqlite3 * sqlite, const char *table,
 }
 
 static int
-do_compute_minmax (sqlite3 * sqlite, const char *table,
+do_compute_minmax (sqlite3 * sqlite, const char *table, const char *where,
 		   struct field_container_infos *infos)
 {
 /* Pass2 - computing Integer / Double min/max ranges */
@@ -956,7 +956,9 @@ do_compute_minmax (sqlite3 * sqlite, const char *table,
 
       }
     quoted = gaiaDoubleQuotedSql (table);
-    sql_statement = sqlite3_mprintf (" FROM \"%s\"", quoted);
+    sql_statement =
+	sqlite3_mprintf (" FROM \"%s\"%s", quoted,
+			 (where == NULL) ? "" : where);
     free (quoted);
     gaiaAppendToOutBuffer (&out_buf, sql_statement);
     sqlite3_free (sql_statement);
@@ -1063,13 +1065,11 @@ copy_attributes_into_layer (struct field_container_infos *infos,
       }
 }
 
-SPATIALITE_PRIVATE int
-doComputeFieldInfos (void *p_sqlite, const char *table,
-		     const char *column, int stat_type, void *p_lyr)
+static int
+do_compute_field_infos (sqlite3 * sqlite, const char *table, const char *where,
+			struct field_container_infos *infos)
 {
-/* computes FIELD_INFOS [single table/geometry] */
-    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
-    gaiaVectorLayerPtr lyr = (gaiaVectorLayerPtr) p_lyr;
+/* Pass1 - computing the FIELD_INFOS type counters */
     char *sql_statement;
     char *quoted;
     int ret;
@@ -1084,16 +1084,12 @@ doComputeFieldInfos (void *p_sqlite, const char *table,
     const char *sz;
     int size;
     int count;
-    int error = 0;
     int comma = 0;
     gaiaOutBuffer out_buf;
     gaiaOutBuffer group_by;
-    struct field_container_infos infos;
 
     gaiaOutBufferInitialize (&out_buf);
     gaiaOutBufferInitialize (&group_by);
-    infos.first = NULL;
-    infos.last = NULL;
 
 /* retrieving the column names for the current table */
 /* then building the SQL query statement */
@@ -1143,7 +1139,9 @@ doComputeFieldInfos (void *p_sqlite, const char *table,
     if (out_buf.Buffer == NULL)
 	return 0;
     quoted = gaiaDoubleQuotedSql (table);
-    sql_statement = sqlite3_mprintf (" FROM \"%s\" ", quoted);
+    sql_statement =
+	sqlite3_mprintf (" FROM \"%s\"%s ", quoted,
+			 (where == NULL) ? "" : where);
     free (quoted);
     gaiaAppendToOutBuffer (&out_buf, sql_statement);
     sqlite3_free (sql_statement);
@@ -1174,20 +1172,40 @@ doComputeFieldInfos (void *p_sqlite, const char *table,
 			  size = -1;
 		      else
 			  size = atoi (sz);
-		      update_field_infos (&infos, ordinal, col_name, type, size,
+		      update_field_infos (infos, ordinal, col_name, type, size,
 					  count);
 		  }
 	    }
       }
     sqlite3_free_table (results);
 
-/* Pass-2: computing INTEGER and DOUBLE min/max ranges */
-    if (!error)
+    return 1;
+}
+
+SPATIALITE_PRIVATE int
+doComputeFieldInfos (void *p_sqlite, const char *table,
+		     const char *column, int stat_type, void *p_lyr)
+{
+/* computes FIELD_INFOS [single table/geometry] */
+    sqlite3 *sqlite = (sqlite3 *) p_sqlite;
+    gaiaVectorLayerPtr lyr = (gaiaVectorLayerPtr) p_lyr;
+    int error = 0;
+    struct field_container_infos infos;
+
+    infos.first = NULL;
+    infos.last = NULL;
+
+/* Pass-1: computing the type counters */
+    if (!do_compute_field_infos (sqlite, table, NULL, &infos))
       {
-	  if (!do_compute_minmax (sqlite, table, &infos))
-	      error = 1;
+	  free_field_infos (&infos);
+	  return 0;
       }
 
+/* Pass-2: computing INTEGER and DOUBLE min/max ranges */
+    if (!do_compute_minmax (sqlite, table, NULL, &infos))
+	error = 1;
+
     switch (stat_type)
       {
       case SPATIALITE_STATISTICS_LEGACY:
@@ -1218,59 +1236,32 @@ doComputeFieldInfos (void *p_sqlite, const char *table,
 }
 
 static int
-do_compute_layer_statistics (sqlite3 * sqlite, const char *table,
-			     const char *column, int stat_type)
+do_compute_layer_extent (sqlite3 * sqlite, const char *table,
+			 const char *column, const char *where, int *count,
+			 int *has_coords, double *min_x, double *min_y,
+			 double *max_x, double *max_y)
 {
-/* computes LAYER_STATISTICS [single table/geometry] */
+/* computing the row count and the full extent of a Layer */
     int ret;
     int error = 0;
-    int count;
-    double min_x = DBL_MAX;
-    double min_y = DBL_MAX;
-    double max_x = 0.0 - DBL_MAX;
-    double max_y = 0.0 - DBL_MAX;
-    int has_coords = 1;
     char *quoted;
     char *col_quoted;
     char *sql_statement;
     sqlite3_stmt *stmt;
-    int metadata_version = checkSpatialMetaData (sqlite);
 
+    *count = 0;
+    *has_coords = 1;
+    *min_x = DBL_MAX;
+    *min_y = DBL_MAX;
+    *max_x = 0.0 - DBL_MAX;
+    *max_y = 0.0 - DBL_MAX;
     quoted = gaiaDoubleQuotedSql ((const char *) table);
     col_quoted = gaiaDoubleQuotedSql ((const char *) column);
-
-    if (metadata_version == 4)
-      {
-	  /* GeoPackage Vector only */
-	  sql_statement = sqlite3_mprintf ("UPDATE gpkg_contents SET "
-					   "min_x = (SELECT Min(MbrMinX(%s)) FROM \"%s\"),"
-					   "min_y = (SELECT Min(MbrMinY(%s)) FROM \"%s\"),"
-					   "max_x = (SELECT Max(MbrMinX(%s)) FROM \"%s\"),"
-					   "max_y = (SELECT Max(MbrMinY(%s)) FROM \"%s\"),"
-					   "last_change = strftime('%%Y-%%m-%%dT%%H:%%M:%%fZ', 'now') "
-					   "WHERE ((lower(table_name) = lower('%s')) AND (Lower(data_type) = 'features'))",
-					   col_quoted, quoted, col_quoted,
-					   quoted, col_quoted, quoted,
-					   col_quoted, quoted, quoted);
-	  free (quoted);
-	  free (col_quoted);
-	  if (sqlite3_exec (sqlite, sql_statement, NULL, NULL, NULL) !=
-	      SQLITE_OK)
-	    {
-		sqlite3_free (sql_statement);
-		return 0;
-	    }
-	  sqlite3_free (sql_statement);
-	  return 1;
-      }
-    else
-      {
-	  sql_statement = sqlite3_mprintf ("SELECT Count(*), "
-					   "Min(MbrMinX(\"%s\")), Min(MbrMinY(\"%s\")), Max(MbrMaxX(\"%s\")), Max(MbrMaxY(\"%s\")) "
-					   "FROM \"%s\"", col_quoted,
-					   col_quoted, col_quoted, col_quoted,
-					   quoted);
-      }
+    sql_statement = sqlite3_mprintf ("SELECT Count(*), "
+				     "Min(MbrMinX(\"%s\")), Min(MbrMinY(\"%s\")), Max(MbrMaxX(\"%s\")), Max(MbrMaxY(\"%s\")) "
+				     "FROM \"%s\"%s", col_quoted,
+				     col_quoted, col_quoted, col_quoted,
+				     quoted, (where == NULL) ? "" : where);
     free (quoted);
     free (col_quoted);
 
@@ -1289,44 +1280,23 @@ do_compute_layer_statistics (sqlite3 * sqlite, const char *table,
 	      break;		/* end of result set */
 	  if (ret == SQLITE_ROW)
 	    {
-		count = sqlite3_column_int (stmt, 0);
+		*count = sqlite3_column_int (stmt, 0);
 		if (sqlite3_column_type (stmt, 1) == SQLITE_NULL)
-		    has_coords = 0;
+		    *has_coords = 0;
 		else
-		    min_x = sqlite3_column_double (stmt, 1);
+		    *min_x = sqlite3_column_double (stmt, 1);
 		if (sqlite3_column_type (stmt, 2) == SQLITE_NULL)
-		    has_coords = 0;
+		    *has_coords = 0;
 		else
-		    min_y = sqlite3_column_double (stmt, 2);
+		    *min_y = sqlite3_column_double (stmt, 2);
 		if (sqlite3_column_type (stmt, 3) == SQLITE_NULL)
-		    has_coords = 0;
+		    *has_coords = 0;
 		else
-		    max_x = sqlite3_column_double (stmt, 3);
+		    *max_x = sqlite3_column_double (stmt, 3);
 		if (sqlite3_column_type (stmt, 4) == SQLITE_NULL)
-		    has_coords = 0;
+		    *has_coords = 0;
 		else
-		    max_y = sqlite3_column_double (stmt, 4);
-		switch (stat_type)
-		  {
-		  case SPATIALITE_STATISTICS_GENUINE:
-		      if (!do_update_layer_statistics
-			  (sqlite, table, column, count, has_coords, min_x,
-			   min_y, max_x, max_y))
-			  error = 1;
-		      break;
-		  case SPATIALITE_STATISTICS_VIEWS:
-		      if (!do_update_views_layer_statistics
-			  (sqlite, table, column, count, has_coords, min_x,
-			   min_y, max_x, max_y))
-			  error = 1;
-		      break;
-		  case SPATIALITE_STATISTICS_VIRTS:
-		      if (!do_update_virts_layer_statistics
-			  (sqlite, table, column, count, has_coords, min_x,
-			   min_y, max_x, max_y))
-			  error = 1;
-		      break;
-		  };
+		    *max_y = sqlite3_column_double (stmt, 4);
 	    }
 	  else
 	      error = 1;
@@ -1336,6 +1306,85 @@ do_compute_layer_statistics (sqlite3 * sqlite, const char *table,
 	return 0;
     if (error)
 	return 0;
+    return 1;
+}
+
+static int
+do_store_layer_statistics (sqlite3 * sqlite, const char *table,
+			   const char *column, int stat_type, int count,
+			   int has_coords, double min_x, double min_y,
+			   double max_x, double max_y)
+{
+/* storing LAYER_STATISTICS [single table/geometry] */
+    switch (stat_type)
+      {
+      case SPATIALITE_STATISTICS_GENUINE:
+	  return do_update_layer_statistics (sqlite, table, column, count,
+					     has_coords, min_x, min_y, max_x,
+					     max_y);
+      case SPATIALITE_STATISTICS_VIEWS:
+	  return do_update_views_layer_statistics (sqlite, table, column,
+						   count, has_coords, min_x,
+						   min_y, max_x, max_y);
+      case SPATIALITE_STATISTICS_VIRTS:
+	  return do_update_virts_layer_statistics (sqlite, table, column,
+						   count, has_coords, min_x,
+						   min_y, max_x, max_y);
+      };
+    return 1;
+}
+
+static int
+do_compute_layer_statistics (sqlite3 * sqlite, const char *table,
+			     const char *column, int stat_type)
+{
+/* computes LAYER_STATISTICS [single table/geometry] */
+    int count;
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+    int has_coords;
+    char *quoted;
+    char *col_quoted;
+    char *sql_statement;
+    int metadata_version = checkSpatialMetaData (sqlite);
+
+    if (metadata_version == 4)
+      {
+	  /* GeoPackage Vector only */
+	  quoted = gaiaDoubleQuotedSql ((const char *) table);
+	  col_quoted = gaiaDoubleQuotedSql ((const char *) column);
+	  sql_statement = sqlite3_mprintf ("UPDATE gpkg_contents SET "
+					   "min_x = (SELECT Min(MbrMinX(%s)) FROM \"%s\"),"
+					   "min_y = (SELECT Min(MbrMinY(%s)) FROM \"%s\"),"
+					   "max_x = (SELECT Max(MbrMinX(%s)) FROM \"%s\"),"
+					   "max_y = (SELECT Max(MbrMinY(%s)) FROM \"%s\"),"
+					   "last_change = strftime('%%Y-%%m-%%dT%%H:%%M:%%fZ', 'now') "
+					   "WHERE ((lower(table_name) = lower('%s')) AND (Lower(data_type) = 'features'))",
+					   col_quoted, quoted, col_quoted,
+					   quoted, col_quoted, quoted,
+					   col_quoted, quoted, quoted);
+	  free (quoted);
+	  free (col_quoted);
+	  if (sqlite3_exec (sqlite, sql_statement, NULL, NULL, NULL) !=
+	      SQLITE_OK)
+	    {
+		sqlite3_free (sql_statement);
+		return 0;
+	    }
+	  sqlite3_free (sql_statement);
+	  return 1;
+      }
+
+    if (!do_compute_layer_extent
+	(sqlite, table, column, NULL, &count, &has_coords, &min_x, &min_y,
+	 &max_x, &max_y))
+	return 0;
+    if (!do_store_layer_statistics
+	(sqlite, table, column, stat_type, count, has_coords, min_x, min_y,
+	 max_x, max_y))
+	return 0;
     if (metadata_version == 3)
       {
 	  /* current metadata style >= v.4.0.0 */
@@ -1345,9 +1394,122 @@ do_compute_layer_statistics (sqlite3 * sqlite, const char *table,
     return 1;
 }
 
+#define SPLITE_STATS_CHUNK_ROWS	65536
+
+struct layer_stats_job
+{
+/* a table/geometry whose statistics will be computed in parallel */
+    char *table;
+    char *column;
+    int stat_type;
+    int chunked;
+    sqlite3_int64 min_rowid;
+    sqlite3_int64 max_rowid;
+    int first_task;
+    int n_tasks;
+    struct layer_stats_job *next;
+};
+
+struct layer_stats_jobs
+{
+/* the list of all pending table/geometry jobs */
+    struct layer_stats_job *first;
+    struct layer_stats_job *last;
+    int out_of_memory;
+};
+
+struct layer_stats_task
+{
+/* a unit of work: a whole Layer or a range of ROWIDs of a Layer */
+    struct layer_stats_job *job;
+    int chunked;
+    sqlite3_int64 min_rowid;
+    sqlite3_int64 max_rowid;
+    sqlite3_int64 weight;
+    int count;
+    int has_coords;
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+    struct field_container_infos infos;
+    int error;
+};
+
+struct layer_stats_worker
+{
+/* a worker thread owning its own read-only connection */
+    sqlite3 *handle;
+    void *cache;
+    void *thread;
+    struct layer_stats_task **order;
+    int n_tasks;
+    int first;
+    int step;
+    int field_infos;
+};
+
+static int
+add_layer_stats_job (struct layer_stats_jobs *jobs, const char *table,
+		     const char *column, int stat_type)
+{
+/* appending a pending table/geometry job */
+    struct layer_stats_job *job = malloc (sizeof (struct layer_stats_job));
+    if (job == NULL)
+	goto no_memory;
+    job->table = malloc (strlen (table) + 1);
+    job->column = malloc (strlen (column) + 1);
+    if (job->table == NULL || job->column == NULL)
+      {
+	  if (job->table != NULL)
+	      free (job->table);
+	  if (job->column != NULL)
+	      free (job->column);
+	  free (job);
+	  goto no_memory;
+      }
+    strcpy (job->table, table);
+    strcpy (job->column, column);
+    job->stat_type = stat_type;
+    job->chunked = 0;
+    job->min_rowid = 0;
+    job->max_rowid = 0;
+    job->first_task = 0;
+    job->n_tasks = 0;
+    job->next = NULL;
+    if (jobs->first == NULL)
+	jobs->first = job;
+    if (jobs->last != NULL)
+	jobs->last->next = job;
+    jobs->last = job;
+    return 1;
+
+  no_memory:
+    jobs->out_of_memory = 1;
+    return 0;
+}
+
+static void
+free_layer_stats_jobs (struct layer_stats_jobs *jobs)
+{
+/* memory cleanup - freeing all pending jobs */
+    struct layer_stats_job *job = jobs->first;
+    struct layer_stats_job *jobn;
+    while (job != NULL)
+      {
+	  jobn = job->next;
+	  free (job->table);
+	  free (job->column);
+	  free (job);
+	  job = jobn;
+      }
+    jobs->first = NULL;
+    jobs->last = NULL;
+}
+
 static int
 genuine_layer_statistics_v4 (sqlite3 * sqlite, const char *table,
-			     const char *column)
+			     const char *column, struct layer_stats_jobs *jobs)
 {
 /* updating GEOMETRY_COLUMNS_STATISTICS Version >= 4.0.0 */
     char *sql_statement;
@@ -1420,6 +1582,18 @@ genuine_layer_statistics_v4 (sqlite3 * sqlite, const char *table,
 	    {
 		f_table_name = results[(i * columns) + 0];
 		f_geometry_column = results[(i * columns) + 1];
+		if (jobs != NULL)
+		  {
+		      /* deferring to the parallel workers */
+		      if (!add_layer_stats_job
+			  (jobs, f_table_name, f_geometry_column,
+			   SPATIALITE_STATISTICS_GENUINE))
+			{
+			    error = 1;
+			    break;
+			}
+		      continue;
+		  }
 		if (!do_compute_layer_statistics
 		    (sqlite, f_table_name, f_geometry_column,
 		     SPATIALITE_STATISTICS_GENUINE))
@@ -1437,7 +1611,7 @@ genuine_layer_statistics_v4 (sqlite3 * sqlite, const char *table,
 
 static int
 genuine_layer_statistics (sqlite3 * sqlite, const char *table,
-			  const char *column)
+			  const char *column, struct layer_stats_jobs *jobs)
 {
 /* updating genuine LAYER_STATISTICS metadata */
     char *sql_statement;
@@ -1454,7 +1628,7 @@ genuine_layer_statistics (sqlite3 * sqlite, const char *table,
     if (metadata_version == 3)
       {
 	  /* current metadata style >= v.4.0.0 */
-	  return genuine_layer_statistics_v4 (sqlite, table, column);
+	  return genuine_layer_statistics_v4 (sqlite, table, column, jobs);
       }
 
     if (table == NULL && column == NULL)
@@ -1529,6 +1703,18 @@ genuine_layer_statistics (sqlite3 * sqlite, const char *table,
 	    {
 		f_table_name = results[(i * columns) + 0];
 		f_geometry_column = results[(i * columns) + 1];
+		if (jobs != NULL)
+		  {
+		      /* deferring to the parallel workers */
+		      if (!add_layer_stats_job
+			  (jobs, f_table_name, f_geometry_column,
+			   SPATIALITE_STATISTICS_GENUINE))
+			{
+			    error = 1;
+			    break;
+			}
+		      continue;
+		  }
 		if (!do_compute_layer_statistics
 		    (sqlite, f_table_name, f_geometry_column,
 		     SPATIALITE_STATISTICS_GENUINE))
@@ -1545,7 +1731,8 @@ genuine_layer_statistics (sqlite3 * sqlite, const char *table,
 }
 
 static int
-views_layer_statistics (sqlite3 * sqlite, const char *table, const char *column)
+views_layer_statistics (sqlite3 * sqlite, const char *table,
+			const char *column, struct layer_stats_jobs *jobs)
 {
 /* updating VIEWS_LAYER_STATISTICS metadata */
     char *sql_statement;
@@ -1595,6 +1782,18 @@ views_layer_statistics (sqlite3 * sqlite, const char *table, const char *column)
 	    {
 		view_name = results[(i * columns) + 0];
 		view_geometry = results[(i * columns) + 1];
+		if (jobs != NULL)
+		  {
+		      /* deferring to the parallel workers */
+		      if (!add_layer_stats_job
+			  (jobs, view_name, view_geometry,
+			   SPATIALITE_STATISTICS_VIEWS))
+			{
+			    error = 1;
+			    break;
+			}
+		      continue;
+		  }
 		if (!do_compute_layer_statistics
 		    (sqlite, view_name, view_geometry,
 		     SPATIALITE_STATISTICS_VIEWS))
@@ -1728,16 +1927,456 @@ has_virts_metadata (sqlite3 * sqlite)
     return defined;
 }
 
+static void
+merge_field_infos (struct field_container_infos *infos,
+		   struct field_container_infos *chunk)
+{
+/* merging the FIELD_INFOS computed on a range of ROWIDs */
+    struct field_item_infos *p = chunk->first;
+    struct field_item_infos *q;
+    while (p)
+      {
+	  q = infos->first;
+	  while (q)
+	    {
+		if (strcasecmp (p->col_name, q->col_name) == 0)
+		    break;
+		q = q->next;
+	    }
+	  if (q == NULL)
+	    {
+		/* inserting a new field */
+		q = malloc (sizeof (struct field_item_infos));
+		*q = *p;
+		q->col_name = malloc (strlen (p->col_name) + 1);
+		strcpy (q->col_name, p->col_name);
+		q->next = NULL;
+		if (infos->first == NULL)
+		    infos->first = q;
+		if (infos->last != NULL)
+		    infos->last->next = q;
+		infos->last = q;
+	    }
+	  else
+	    {
+		/* updating an already defined field */
+		q->null_values += p->null_values;
+		q->integer_values += p->integer_values;
+		q->double_values += p->double_values;
+		q->text_values += p->text_values;
+		q->blob_values += p->blob_values;
+		if (p->max_size > q->max_size)
+		    q->max_size = p->max_size;
+		if (p->int_minmax_set)
+		  {
+		      if (!q->int_minmax_set)
+			{
+			    q->int_minmax_set = 1;
+			    q->int_min = p->int_min;
+			    q->int_max = p->int_max;
+			}
+		      if (p->int_min < q->int_min)
+			  q->int_min = p->int_min;
+		      if (p->int_max > q->int_max)
+			  q->int_max = p->int_max;
+		  }
+		if (p->dbl_minmax_set)
+		  {
+		      if (!q->dbl_minmax_set)
+			{
+			    q->dbl_minmax_set = 1;
+			    q->dbl_min = p->dbl_min;
+			    q->dbl_max = p->dbl_max;
+			}
+		      if (p->dbl_min < q->dbl_min)
+			  q->dbl_min = p->dbl_min;
+		      if (p->dbl_max > q->dbl_max)
+			  q->dbl_max = p->dbl_max;
+		  }
+	    }
+	  p = p->next;
+      }
+}
+
+static void
+check_merged_minmax (struct field_container_infos *infos)
+{
+/* 
+/ a range of ROWIDs could contain only INTEGER values for some column
+/ that also contains DOUBLE or TEXT values somewhere else:
+/ min/max ranges are only valid for globally homogeneous columns
+*/
+    struct field_item_infos *p = infos->first;
+    while (p)
+      {
+	  if (p->double_values != 0 || p->blob_values != 0
+	      || p->text_values != 0)
+	      p->int_minmax_set = 0;
+	  if (p->integer_values != 0 || p->blob_values != 0
+	      || p->text_values != 0)
+	      p->dbl_minmax_set = 0;
+	  p = p->next;
+      }
+}
+
+static void
+do_layer_stats_task (sqlite3 * sqlite, struct layer_stats_task *task,
+		     int field_infos)
+{
+/* computing a single unit of work */
+    struct layer_stats_job *job = task->job;
+    char *where = NULL;
+    if (task->chunked)
+	where =
+	    sqlite3_mprintf (" WHERE ROWID BETWEEN %lld AND %lld",
+			     task->min_rowid, task->max_rowid);
+    if (!do_compute_layer_extent
+	(sqlite, job->table, job->column, where, &(task->count),
+	 &(task->has_coords), &(task->min_x), &(task->min_y), &(task->max_x),
+	 &(task->max_y)))
+	task->error = 1;
+    else if (field_infos)
+      {
+	  if (!do_compute_field_infos (sqlite, job->table, where, &(task->infos)))
+	      task->error = 1;
+	  else if (!do_compute_minmax
+		   (sqlite, job->table, where, &(task->infos)))
+	      task->error = 1;
+      }
+    if (where != NULL)
+	sqlite3_free (where);
+}
+
+static void
+layer_stats_worker (void *arg)
+{
+/* the worker thread body: processing its own share of tasks */
+    struct layer_stats_worker *worker = (struct layer_stats_worker *) arg;
+    int i;
+    for (i = worker->first; i < worker->n_tasks; i += worker->step)
+	do_layer_stats_task (worker->handle, worker->order[i],
+			     worker->field_infos);
+}
+
+static int
+cmp_layer_stats_tasks (const void *p1, const void *p2)
+{
+/* sorting tasks by descending weight */
+    const struct layer_stats_task *t1 =
+	*((const struct layer_stats_task **) p1);
+    const struct layer_stats_task *t2 =
+	*((const struct layer_stats_task **) p2);
+    if (t1->weight > t2->weight)
+	return -1;
+    if (t1->weight < t2->weight)
+	return 1;
+    return 0;
+}
+
+static int
+get_layer_rowid_range (sqlite3 * sqlite, const char *table,
+		       sqlite3_int64 * min_rowid, sqlite3_int64 * max_rowid)
+{
+/* retrieving the ROWID range of some table */
+    char *quoted;
+    char *sql_statement;
+    sqlite3_stmt *stmt;
+    int ret;
+    int ok = 0;
+    quoted = gaiaDoubleQuotedSql (table);
+    sql_statement =
+	sqlite3_mprintf ("SELECT Min(ROWID), Max(ROWID) FROM \"%s\"", quoted);
+    free (quoted);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &stmt, NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW)
+      {
+	  if (sqlite3_column_type (stmt, 0) == SQLITE_INTEGER
+	      && sqlite3_column_type (stmt, 1) == SQLITE_INTEGER)
+	    {
+		*min_rowid = sqlite3_column_int64 (stmt, 0);
+		*max_rowid = sqlite3_column_int64 (stmt, 1);
+		ok = 1;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    return ok;
+}
+
+static int
+do_store_field_infos (sqlite3 * sqlite, struct layer_stats_job *job,
+		      struct field_container_infos *infos)
+{
+/* storing FIELD_INFOS [single table/geometry] */
+    switch (job->stat_type)
+      {
+      case SPATIALITE_STATISTICS_GENUINE:
+	  return do_update_field_infos (sqlite, job->table, job->column,
+					infos);
+      case SPATIALITE_STATISTICS_VIEWS:
+	  return do_update_views_field_infos (sqlite, job->table, job->column,
+					      infos);
+      case SPATIALITE_STATISTICS_VIRTS:
+	  return do_update_virts_field_infos (sqlite, job->table, job->column,
+					      infos);
+      };
+    return 1;
+}
+
+static int
+do_merge_layer_statistics (sqlite3 * sqlite, struct layer_stats_job *job,
+			   struct layer_stats_task *tasks, int field_infos)
+{
+/* merging the results of all tasks of a job, then storing them */
+    struct layer_stats_task *task;
+    struct field_container_infos infos;
+    int count = 0;
+    int has_coords = 0;
+    double min_x = DBL_MAX;
+    double min_y = DBL_MAX;
+    double max_x = 0.0 - DBL_MAX;
+    double max_y = 0.0 - DBL_MAX;
+    int k;
+    int ret = 1;
+
+    for (k = 0; k < job->n_tasks; k++)
+      {
+	  task = tasks + job->first_task + k;
+	  if (task->error)
+	    {
+		/* some worker failed: falling back to the main connection */
+		return do_compute_layer_statistics (sqlite, job->table,
+						    job->column,
+						    job->stat_type);
+	    }
+      }
+
+    infos.first = NULL;
+    infos.last = NULL;
+    for (k = 0; k < job->n_tasks; k++)
+      {
+	  task = tasks + job->first_task + k;
+	  count += task->count;
+	  if (task->has_coords)
+	    {
+		has_coords = 1;
+		if (task->min_x < min_x)
+		    min_x = task->min_x;
+		if (task->min_y < min_y)
+		    min_y = task->min_y;
+		if (task->max_x > max_x)
+		    max_x = task->max_x;
+		if (task->max_y > max_y)
+		    max_y = task->max_y;
+	    }
+	  if (field_infos)
+	      merge_field_infos (&infos, &(task->infos));
+      }
+    if (!do_store_layer_statistics
+	(sqlite, job->table, job->column, job->stat_type, count, has_coords,
+	 min_x, min_y, max_x, max_y))
+	ret = 0;
+    else if (field_infos)
+      {
+	  check_merged_minmax (&infos);
+	  if (!do_store_field_infos (sqlite, job, &infos))
+	      ret = 0;
+      }
+    free_field_infos (&infos);
+    return ret;
+}
+
+static int
+do_parallel_layer_statistics (sqlite3 * sqlite, struct layer_stats_jobs *jobs,
+			      int max_threads, int field_infos)
+{
+/*
+/ computing LAYER_STATISTICS on parallel read-only connections
+/ returns 1 on success, 0 on failure or -1 if the workers could not
+/ be set up at all (the caller is then expected to fall back to the
+/ main connection)
+*/
+    struct layer_stats_job *job;
+    struct layer_stats_task *tasks = NULL;
+    struct layer_stats_task **order = NULL;
+    struct layer_stats_worker *workers = NULL;
+    struct layer_stats_worker *worker;
+    struct layer_stats_task *task;
+    const char *db_path = sqlite3_db_filename (sqlite, "main");
+    sqlite3_int64 step;
+    int n_tasks = 0;
+    int n_workers = 0;
+    int i;
+    int k;
+    int ret;
+    int retval = -1;
+
+/* splitting the largest tables into ranges of ROWIDs */
+    job = jobs->first;
+    while (job != NULL)
+      {
+	  job->first_task = n_tasks;
+	  job->n_tasks = 1;
+	  if (job->stat_type == SPATIALITE_STATISTICS_GENUINE
+	      && get_layer_rowid_range (sqlite, job->table, &(job->min_rowid),
+					&(job->max_rowid)))
+	    {
+		if ((double) (job->max_rowid) - (double) (job->min_rowid) <
+		    (double) SPLITE_STATS_CHUNK_ROWS * (double) max_threads)
+		    job->n_tasks =
+			(int) ((job->max_rowid - job->min_rowid +
+				1) / SPLITE_STATS_CHUNK_ROWS);
+		else
+		    job->n_tasks = max_threads;
+		if (job->n_tasks > 1)
+		    job->chunked = 1;
+		else
+		    job->n_tasks = 1;
+	    }
+	  n_tasks += job->n_tasks;
+	  job = job->next;
+      }
+    if (n_tasks == 0)
+	return 1;
+
+    tasks = calloc (n_tasks, sizeof (struct layer_stats_task));
+    order = malloc (sizeof (struct layer_stats_task *) * n_tasks);
+    if (tasks == NULL || order == NULL)
+	goto stop;
+    job = jobs->first;
+    while (job != NULL)
+      {
+	  step = 0;
+	  if (job->chunked)
+	      step =
+		  job->max_rowid / job->n_tasks - job->min_rowid / job->n_tasks;
+	  for (k = 0; k < job->n_tasks; k++)
+	    {
+		task = tasks + job->first_task + k;
+		task->job = job;
+		task->chunked = job->chunked;
+		task->min_rowid = job->min_rowid + (step * k);
+		if (k == job->n_tasks - 1)
+		    task->max_rowid = job->max_rowid;
+		else
+		    task->max_rowid = task->min_rowid + step - 1;
+		task->weight = task->max_rowid - task->min_rowid;
+		task->count = 0;
+		task->has_coords = 0;
+		task->min_x = DBL_MAX;
+		task->min_y = DBL_MAX;
+		task->max_x = 0.0 - DBL_MAX;
+		task->max_y = 0.0 - DBL_MAX;
+		task->infos.first = NULL;
+		task->infos.last = NULL;
+		task->error = 0;
+		order[job->first_task + k] = task;
+	    }
+	  job = job->next;
+      }
+/* the heaviest tasks will be processed first */
+    qsort (order, n_tasks, sizeof (struct layer_stats_task *),
+	   cmp_layer_stats_tasks);
+
+/* opening a read-only connection for each worker */
+    if (max_threads > n_tasks)
+	max_threads = n_tasks;
+    workers = malloc (sizeof (struct layer_stats_worker) * max_threads);
+    if (workers == NULL)
+	goto stop;
+    for (i = 0; i < max_threads; i++)
+      {
+	  worker = workers + n_workers;
+	  worker->cache = spatialite_alloc_connection ();
+	  if (worker->cache == NULL)
+	      break;
+	  ret =
+	      sqlite3_open_v2 (db_path, &(worker->handle),
+			       SQLITE_OPEN_READONLY, NULL);
+	  if (ret != SQLITE_OK)
+	    {
+		sqlite3_close (worker->handle);
+		spatialite_internal_cleanup (worker->cache);
+		break;
+	    }
+	  spatialite_internal_init (worker->handle, worker->cache);
+	  worker->thread = NULL;
+	  worker->order = order;
+	  worker->n_tasks = n_tasks;
+	  worker->first = n_workers;
+	  worker->field_infos = field_infos;
+	  n_workers++;
+      }
+    if (n_workers == 0)
+	goto stop;
+
+/* running all workers */
+    for (i = 0; i < n_workers; i++)
+      {
+	  worker = workers + i;
+	  worker->step = n_workers;
+	  worker->thread = splite_thread_create (layer_stats_worker, worker);
+      }
+    for (i = 0; i < n_workers; i++)
+      {
+	  worker = workers + i;
+	  if (worker->thread == NULL)
+	    {
+		/* unable to start a thread: running in the current one */
+		layer_stats_worker (worker);
+	    }
+	  else
+	      splite_thread_join (worker->thread);
+      }
+    for (i = 0; i < n_workers; i++)
+      {
+	  worker = workers + i;
+	  sqlite3_close (worker->handle);
+	  spatialite_internal_cleanup (worker->cache);
+      }
+
+/* merging and storing the results */
+    retval = 1;
+    job = jobs->first;
+    while (job != NULL)
+      {
+	  if (!do_merge_layer_statistics (sqlite, job, tasks, field_infos))
+	    {
+		retval = 0;
+		break;
+	    }
+	  job = job->next;
+      }
+
+  stop:
+    if (tasks != NULL)
+      {
+	  for (k = 0; k < n_tasks; k++)
+	      free_field_infos (&(tasks[k].infos));
+	  free (tasks);
+      }
+    if (order != NULL)
+	free (order);
+    if (workers != NULL)
+	free (workers);
+    return retval;
+}
+
 SPATIALITE_DECLARE int
 update_layer_statistics (sqlite3 * sqlite, const char *table,
 			 const char *column)
 {
 /* updating LAYER_STATISTICS metadata [main] */
-    if (!genuine_layer_statistics (sqlite, table, column))
+    if (!genuine_layer_statistics (sqlite, table, column, NULL))
 	return 0;
     if (has_views_metadata (sqlite))
       {
-	  if (!views_layer_statistics (sqlite, table, column))
+	  if (!views_layer_statistics (sqlite, table, column, NULL))
 	      return 0;
       }
     if (has_virts_metadata (sqlite))
@@ -1748,6 +2387,85 @@ update_layer_statistics (sqlite3 * sqlite, const char *table,
     return 1;
 }
 
+SPATIALITE_DECLARE int
+update_layer_statistics_ex (sqlite3 * sqlite, const char *table,
+			    const char *column, int max_threads)
+{
+/* updating LAYER_STATISTICS metadata [main] - parallel workers */
+    struct layer_stats_jobs jobs;
+    const char *db_path;
+    int metadata_version;
+    int ret;
+
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    if (max_threads <= 1)
+	return update_layer_statistics (sqlite, table, column);
+    if (sqlite3_threadsafe () == 0)
+      {
+	  /* SQLite was built without any thread support */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+    metadata_version = checkSpatialMetaData (sqlite);
+    if (metadata_version == 4)
+      {
+	  /* GeoPackage: a single UPDATE statement */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+    db_path = sqlite3_db_filename (sqlite, "main");
+    if (db_path == NULL || *db_path == '\0')
+      {
+	  /* a MEMORY-DB can't be shared by many connections */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+    if (!sqlite3_get_autocommit (sqlite))
+      {
+	  /* pending changes are not visible to other connections */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+#if SQLITE_VERSION_NUMBER >= 3034000
+    if (sqlite3_txn_state (sqlite, "main") == SQLITE_TXN_WRITE)
+	return update_layer_statistics (sqlite, table, column);
+#endif
+
+    jobs.first = NULL;
+    jobs.last = NULL;
+    jobs.out_of_memory = 0;
+    if (!genuine_layer_statistics (sqlite, table, column, &jobs))
+	goto error;
+    if (has_views_metadata (sqlite))
+      {
+	  if (!views_layer_statistics (sqlite, table, column, &jobs))
+	      goto error;
+      }
+    ret =
+	do_parallel_layer_statistics (sqlite, &jobs, max_threads,
+				      (metadata_version == 3) ? 1 : 0);
+    free_layer_stats_jobs (&jobs);
+    if (ret < 0)
+      {
+	  /* unable to start any worker */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+    if (!ret)
+	return 0;
+    if (has_virts_metadata (sqlite))
+      {
+	  if (!virts_layer_statistics (sqlite, table, column))
+	      return 0;
+      }
+    return 1;
+
+  error:
+    free_layer_stats_jobs (&jobs);
+    if (jobs.out_of_memory)
+      {
+	  /* unable to queue all jobs */
+	  return update_layer_statistics (sqlite, table, column);
+      }
+    return 0;
+}
+
 struct table_params
 {
 /* a struct supporting Drop Table / Rename Table / Rename Column */
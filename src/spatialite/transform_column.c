@@ -0,0 +1,699 @@
+/*
+
+ transform_column.c -- reprojecting a whole Geometry Column
+
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+#include <spatialite/debug.h>
+
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite_private.h>
+#include <spatialite/gaiaaux.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#define LONG64_MAX	_I64_MAX
+#define LONG64_MIN	_I64_MIN
+#else
+#define LONG64_MAX	9223372036854775807LL
+#define LONG64_MIN	(-LONG64_MAX - 1)
+#endif
+
+#define TRANSFORM_COLUMN_BATCH	4096	/* rows per thread and per batch */
+
+#ifndef OMIT_PROJ		/* including PROJ */
+
+struct transform_column_row
+{
+/* a single row to be reprojected */
+    sqlite3_int64 rowid;
+    unsigned char *blob;
+    int size;
+    unsigned char *result;
+    int result_size;
+};
+
+struct transform_column_worker
+{
+/* a slice of the current batch, processed by a single thread */
+    const void *cache;		/* owning the PROJ context */
+    const char *proj_from;
+    const char *proj_to;
+    int srid;
+    int tiny_point;
+    struct transform_column_row *rows;
+    int count;
+    int error;
+    sqlite3_int64 error_rowid;
+    char *error_message;
+    void *thread;
+};
+
+static void
+transform_column_work (void *arg)
+{
+/* reprojecting all Geometries belonging to a slice */
+    struct transform_column_worker *worker =
+	(struct transform_column_worker *) arg;
+    int i;
+    for (i = 0; i < worker->count; i++)
+      {
+	  struct transform_column_row *row = worker->rows + i;
+	  gaiaGeomCollPtr geom;
+	  gaiaGeomCollPtr result;
+	  if (row->blob == NULL)
+	      continue;
+	  geom = gaiaFromSpatiaLiteBlobWkb (row->blob, row->size);
+	  if (geom == NULL)
+	    {
+		worker->error = 1;
+		worker->error_rowid = row->rowid;
+		worker->error_message =
+		    sqlite3_mprintf ("not a valid Geometry");
+		return;
+	    }
+#ifdef PROJ_NEW			/* supporting new PROJ.6 */
+	  gaiaResetProjErrorMsg_r (worker->cache);
+	  result =
+	      gaiaTransformEx_r (worker->cache, geom, worker->proj_from,
+				 worker->proj_to, NULL);
+#else /* supporting old PROJ.4 */
+	  result =
+	      gaiaTransform_r (worker->cache, geom, worker->proj_from,
+			       worker->proj_to);
+#endif
+	  gaiaFreeGeomColl (geom);
+	  if (result == NULL)
+	    {
+		const char *msg = NULL;
+#ifdef PROJ_NEW			/* supporting new PROJ.6 */
+		msg = gaiaGetProjErrorMsg_r (worker->cache);
+#endif
+		worker->error = 1;
+		worker->error_rowid = row->rowid;
+		if (msg != NULL)
+		    worker->error_message =
+			sqlite3_mprintf ("PROJ reports \"%s\"", msg);
+		else
+		    worker->error_message =
+			sqlite3_mprintf ("unable to reproject the Geometry");
+		return;
+	    }
+	  result->Srid = worker->srid;
+	  gaiaToSpatiaLiteBlobWkbEx2 (result, &(row->result),
+				      &(row->result_size), 0,
+				      worker->tiny_point);
+	  gaiaFreeGeomColl (result);
+      }
+}
+
+static void
+transform_column_run (struct transform_column_worker *workers, int n_workers,
+		      struct transform_column_row *rows, int count)
+{
+/* reprojecting a batch of rows, split into contiguous slices */
+    int i;
+    int base = 0;
+    int slice = count / n_workers;
+    int extra = count % n_workers;
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct transform_column_worker *worker = workers + i;
+	  worker->rows = rows + base;
+	  worker->count = slice + ((i < extra) ? 1 : 0);
+	  base += worker->count;
+	  worker->thread = NULL;
+      }
+    for (i = 1; i < n_workers; i++)
+      {
+	  struct transform_column_worker *worker = workers + i;
+	  if (worker->count == 0)
+	      continue;
+	  worker->thread = splite_thread_create (transform_column_work, worker);
+	  if (worker->thread == NULL)
+	      transform_column_work (worker);	/* falling back to serial */
+      }
+/* the current thread always processes the first slice */
+    transform_column_work (workers);
+    for (i = 1; i < n_workers; i++)
+      {
+	  if (workers[i].thread != NULL)
+	      splite_thread_join (workers[i].thread);
+	  workers[i].thread = NULL;
+      }
+}
+
+static void
+transform_column_reset (struct transform_column_row *rows, int count)
+{
+/* releasing all BLOBs belonging to a batch */
+    int i;
+    for (i = 0; i < count; i++)
+      {
+	  struct transform_column_row *row = rows + i;
+	  if (row->blob != NULL)
+	      free (row->blob);
+	  if (row->result != NULL)
+	      free (row->result);
+	  row->blob = NULL;
+	  row->result = NULL;
+      }
+}
+
+static void
+transform_column_inherit (struct splite_internal_cache *cache,
+			  const void *p_worker)
+{
+/* a worker's own PROJ context inherits the main connection settings */
+    struct splite_internal_cache *worker =
+	(struct splite_internal_cache *) p_worker;
+#ifdef PROJ_NEW			/* supporting new PROJ.6 */
+    const char *path = gaiaGetProjDatabasePath (cache);
+    const char *old_path = gaiaGetProjDatabasePath (worker);
+    if (path != NULL)
+      {
+	  if (old_path == NULL || strcmp (path, old_path) != 0)
+	      gaiaSetProjDatabasePath (worker, path);
+      }
+#endif
+    splite_proj_cache_set_size (worker, cache->projCache.maxItems);
+}
+
+static int
+transform_column_exec (sqlite3 * sqlite, const char *sql,
+		       char **error_message)
+{
+/* executing an SQL statement - reporting any error */
+    char *errMsg = NULL;
+    int ret = sqlite3_exec (sqlite, sql, NULL, NULL, &errMsg);
+    if (ret != SQLITE_OK)
+      {
+	  if (error_message != NULL && *error_message == NULL)
+	      *error_message = sqlite3_mprintf ("%s", errMsg);
+	  sqlite3_free (errMsg);
+	  return 0;
+      }
+    return 1;
+}
+
+static int
+transform_column_drop (sqlite3 * sqlite, const char *type,
+		       const char *prefix, const char *table,
+		       const char *column, char **error_message)
+{
+/* dropping a Spatial Index trigger or table */
+    char *raw = sqlite3_mprintf ("%s_%s_%s", prefix, table, column);
+    char *quoted = gaiaDoubleQuotedSql (raw);
+    char *sql =
+	sqlite3_mprintf ("DROP %s IF EXISTS main.\"%s\"", type, quoted);
+    int ret;
+    sqlite3_free (raw);
+    free (quoted);
+    ret = transform_column_exec (sqlite, sql, error_message);
+    sqlite3_free (sql);
+    return ret;
+}
+
+static int
+transform_column_exists (sqlite3 * sqlite, const char *prefix,
+			 const char *table, const char *column)
+{
+/* checking if a Spatial Index table does really exist */
+    char *name = sqlite3_mprintf ("%s_%s_%s", prefix, table, column);
+    char *sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM sqlite_master WHERE type = 'table' "
+	 "AND Upper(name) = Upper(%Q)", name);
+    char **results;
+    int rows;
+    int columns;
+    int exists = 0;
+    int ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, NULL);
+    sqlite3_free (sql);
+    sqlite3_free (name);
+    if (ret != SQLITE_OK)
+	return 0;
+    if (rows == 1 && results[1] != NULL)
+	exists = atoi (results[1]);
+    sqlite3_free_table (results);
+    return exists;
+}
+
+static int
+transform_column_layout (sqlite3 * sqlite, const char *table,
+			 const char *column, int *srid, int *index)
+{
+/* retrieving the current SRID and Spatial Index type */
+    char *sql =
+	sqlite3_mprintf
+	("SELECT srid, spatial_index_enabled FROM geometry_columns "
+	 "WHERE Lower(f_table_name) = Lower(%Q) "
+	 "AND Lower(f_geometry_column) = Lower(%Q)", table, column);
+    char **results;
+    int rows;
+    int columns;
+    int ok = 0;
+    int ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    if (rows == 1 && results[2] != NULL && results[3] != NULL)
+      {
+	  *srid = atoi (results[2]);
+	  *index = atoi (results[3]);
+	  ok = 1;
+      }
+    sqlite3_free_table (results);
+    return ok;
+}
+
+static int
+transform_column_rows (sqlite3 * sqlite, const char *table,
+		       const char *column, struct transform_column_worker *workers,
+		       int n_workers, char **error_message)
+{
+/* reprojecting all rows in sorted ROWID batches */
+    struct transform_column_row *rows = NULL;
+    sqlite3_stmt *stmt_in = NULL;
+    sqlite3_stmt *stmt_out = NULL;
+    char *quoted_table = gaiaDoubleQuotedSql (table);
+    char *quoted_column = gaiaDoubleQuotedSql (column);
+    char *sql;
+    int max_rows = TRANSFORM_COLUMN_BATCH * n_workers;
+    sqlite3_int64 next_rowid = LONG64_MIN;
+    int count = 0;
+    int done = 0;
+    int ok = 0;
+    int ret;
+    int i;
+
+    sql =
+	sqlite3_mprintf ("SELECT ROWID, \"%s\" FROM main.\"%s\" "
+			 "WHERE ROWID >= ? ORDER BY ROWID LIMIT ?",
+			 quoted_column, quoted_table);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_in, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto sql_error;
+    sql =
+	sqlite3_mprintf ("UPDATE main.\"%s\" SET \"%s\" = ? WHERE ROWID = ?",
+			 quoted_table, quoted_column);
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_out, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto sql_error;
+    rows = calloc (max_rows, sizeof (struct transform_column_row));
+    if (rows == NULL)
+      {
+	  *error_message = sqlite3_mprintf ("insufficient memory");
+	  goto stop;
+      }
+
+    while (!done)
+      {
+	  /* fetching the next batch */
+	  count = 0;
+	  sqlite3_reset (stmt_in);
+	  sqlite3_clear_bindings (stmt_in);
+	  sqlite3_bind_int64 (stmt_in, 1, next_rowid);
+	  sqlite3_bind_int (stmt_in, 2, max_rows);
+	  while (1)
+	    {
+		ret = sqlite3_step (stmt_in);
+		if (ret == SQLITE_DONE)
+		    break;
+		if (ret != SQLITE_ROW)
+		    goto sql_error;
+		rows[count].rowid = sqlite3_column_int64 (stmt_in, 0);
+		if (sqlite3_column_type (stmt_in, 1) == SQLITE_BLOB)
+		  {
+		      const void *blob = sqlite3_column_blob (stmt_in, 1);
+		      int size = sqlite3_column_bytes (stmt_in, 1);
+		      rows[count].blob = malloc (size);
+		      if (rows[count].blob == NULL)
+			{
+			    *error_message =
+				sqlite3_mprintf ("insufficient memory");
+			    goto stop;
+			}
+		      memcpy (rows[count].blob, blob, size);
+		      rows[count].size = size;
+		  }
+		count++;
+	    }
+	  if (count < max_rows)
+	      done = 1;
+	  if (count == 0)
+	      break;
+	  if (rows[count - 1].rowid == LONG64_MAX)
+	      done = 1;
+	  else
+	      next_rowid = rows[count - 1].rowid + 1;
+
+	  /* reprojecting */
+	  transform_column_run (workers, n_workers, rows, count);
+	  for (i = 0; i < n_workers; i++)
+	    {
+		if (workers[i].error)
+		  {
+		      *error_message =
+			  sqlite3_mprintf ("ROWID=%lld: %s",
+					   workers[i].error_rowid,
+					   workers[i].error_message);
+		      goto stop;
+		  }
+	    }
+
+	  /* writing back the reprojected Geometries */
+	  for (i = 0; i < count; i++)
+	    {
+		struct transform_column_row *row = rows + i;
+		if (row->result == NULL)
+		    continue;
+		sqlite3_reset (stmt_out);
+		sqlite3_clear_bindings (stmt_out);
+		sqlite3_bind_blob (stmt_out, 1, row->result, row->result_size,
+				   SQLITE_STATIC);
+		sqlite3_bind_int64 (stmt_out, 2, row->rowid);
+		ret = sqlite3_step (stmt_out);
+		if (ret != SQLITE_DONE && ret != SQLITE_ROW)
+		    goto sql_error;
+	    }
+	  transform_column_reset (rows, count);
+	  count = 0;
+      }
+    ok = 1;
+    goto stop;
+
+  sql_error:
+    *error_message = sqlite3_mprintf ("%s", sqlite3_errmsg (sqlite));
+  stop:
+    if (rows != NULL)
+      {
+	  transform_column_reset (rows, count);
+	  free (rows);
+      }
+    if (stmt_in != NULL)
+	sqlite3_finalize (stmt_in);
+    if (stmt_out != NULL)
+	sqlite3_finalize (stmt_out);
+    free (quoted_table);
+    free (quoted_column);
+    return ok;
+}
+
+static int
+transform_column_apply (sqlite3 * sqlite, const char *table,
+			const char *column, int srid, int index,
+			struct transform_column_worker *workers, int n_workers,
+			char **error_message)
+{
+/* reprojecting the Geometry Column and updating all related metadata */
+    char *sql;
+    int ret;
+
+/* the geometry constraint triggers will check the new SRID */
+    sql =
+	sqlite3_mprintf ("UPDATE geometry_columns SET srid = %d "
+			 "WHERE Lower(f_table_name) = Lower(%Q) "
+			 "AND Lower(f_geometry_column) = Lower(%Q)", srid,
+			 table, column);
+    ret = transform_column_exec (sqlite, sql, error_message);
+    sqlite3_free (sql);
+    if (!ret)
+	return 0;
+
+/* the Spatial Index will be rebuilt from scratch */
+    if (index == 1)
+      {
+	  if (!transform_column_drop
+	      (sqlite, "TRIGGER", "giu", table, column, error_message))
+	      return 0;
+      }
+    if (index == 2)
+      {
+	  if (!transform_column_drop
+	      (sqlite, "TRIGGER", "gcu", table, column, error_message))
+	      return 0;
+      }
+
+    if (!transform_column_rows
+	(sqlite, table, column, workers, n_workers, error_message))
+	return 0;
+
+    if (index == 1 || index == 2)
+      {
+	  /* dropping the old Spatial Index, then rebuilding all triggers */
+	  const char *prefix = (index == 1) ? "idx" : "cache";
+	  char *aux_columns = NULL;
+	  if (index == 1)
+	    {
+		/* a covering Spatial Index must keep its auxiliary columns */
+		aux_columns = getSpatialIndexAuxColumns (sqlite, table, column);
+	    }
+	  if (!transform_column_drop
+	      (sqlite, "TABLE", prefix, table, column, error_message))
+	    {
+		sqlite3_free (aux_columns);
+		return 0;
+	    }
+	  updateGeometryTriggersEx (sqlite, table, column, aux_columns);
+	  sqlite3_free (aux_columns);
+	  if (!transform_column_exists (sqlite, prefix, table, column))
+	    {
+		*error_message =
+		    sqlite3_mprintf ("unable to rebuild the Spatial Index");
+		return 0;
+	    }
+      }
+
+    if (!update_layer_statistics (sqlite, table, column))
+      {
+	  *error_message =
+	      sqlite3_mprintf ("unable to update the layer statistics");
+	  return 0;
+      }
+    sql = sqlite3_mprintf ("Geometry successfully reprojected to SRID=%d",
+			   srid);
+    updateSpatiaLiteHistory (sqlite, table, column, sql);
+    sqlite3_free (sql);
+    return 1;
+}
+
+#endif /* end including PROJ */
+
+SPATIALITE_DECLARE int
+gaiaTransformGeometryColumn (sqlite3 * sqlite, const void *p_cache,
+			     const char *table, const char *column, int srid,
+			     int max_threads, char **error_message)
+{
+/* reprojecting a whole Geometry Column */
+#ifndef OMIT_PROJ		/* including PROJ */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) p_cache;
+    struct transform_column_worker *workers = NULL;
+    int n_workers = 0;
+    char *p_table = NULL;
+    char *p_column = NULL;
+    char *proj_from = NULL;
+    char *proj_to = NULL;
+    char *msg = NULL;
+    int metadata_version;
+    int old_srid;
+    int index;
+    int ok = 0;
+    int i;
+
+    if (error_message != NULL)
+	*error_message = NULL;
+    if (cache == NULL || table == NULL || column == NULL)
+      {
+	  msg = sqlite3_mprintf ("invalid argument");
+	  goto stop;
+      }
+    metadata_version = checkSpatialMetaData (sqlite);
+    if (metadata_version != 1 && metadata_version != 3)
+      {
+	  msg = sqlite3_mprintf ("unsupported Spatial Metadata layout");
+	  goto stop;
+      }
+    if (!getRealSQLnames (sqlite, table, column, &p_table, &p_column))
+      {
+	  msg = sqlite3_mprintf ("not a registered Geometry Column");
+	  goto stop;
+      }
+    if (!transform_column_layout (sqlite, p_table, p_column, &old_srid, &index))
+      {
+	  msg = sqlite3_mprintf ("not a registered Geometry Column");
+	  goto stop;
+      }
+    if (old_srid == srid)
+      {
+	  /* nothing to do */
+	  ok = 1;
+	  goto stop;
+      }
+    if (!validateRowid (sqlite, p_table))
+      {
+	  msg =
+	      sqlite3_mprintf
+	      ("a physical column named ROWID shadows the real ROWID");
+	  goto stop;
+      }
+#ifdef PROJ_NEW			/* supporting new PROJ.6 */
+    getProjAuthNameSrid (sqlite, old_srid, &proj_from);
+    getProjAuthNameSrid (sqlite, srid, &proj_to);
+#else /* supporting old PROJ.4 */
+    getProjParams (sqlite, old_srid, &proj_from);
+    getProjParams (sqlite, srid, &proj_to);
+#endif
+    if (proj_from == NULL)
+      {
+	  msg = sqlite3_mprintf ("unknown SRID %d", old_srid);
+	  goto stop;
+      }
+    if (proj_to == NULL)
+      {
+	  msg = sqlite3_mprintf ("unknown SRID %d", srid);
+	  goto stop;
+      }
+
+/* each worker thread needs a PROJ context of its own */
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    workers = calloc (max_threads, sizeof (struct transform_column_worker));
+    if (workers == NULL)
+      {
+	  msg = sqlite3_mprintf ("insufficient memory");
+	  goto stop;
+      }
+    for (i = 0; i < max_threads; i++)
+      {
+	  struct transform_column_worker *worker = workers + i;
+	  if (i == 0)
+	      worker->cache = cache;
+	  else
+	    {
+		worker->cache = spatialite_alloc_connection ();
+		if (worker->cache == NULL)
+		    break;	/* no more free connection slots */
+		transform_column_inherit (cache, worker->cache);
+	    }
+	  worker->proj_from = proj_from;
+	  worker->proj_to = proj_to;
+	  worker->srid = srid;
+	  worker->tiny_point = cache->tinyPointEnabled;
+	  n_workers++;
+      }
+
+    if (!transform_column_exec
+	(sqlite, "SAVEPOINT transform_geometry_column", &msg))
+	goto stop;
+    if (transform_column_apply
+	(sqlite, p_table, p_column, srid, index, workers, n_workers, &msg))
+      {
+	  if (transform_column_exec
+	      (sqlite, "RELEASE SAVEPOINT transform_geometry_column", &msg))
+	      ok = 1;
+      }
+    if (!ok)
+      {
+	  transform_column_exec (sqlite,
+				 "ROLLBACK TO SAVEPOINT transform_geometry_column",
+				 NULL);
+	  transform_column_exec (sqlite,
+				 "RELEASE SAVEPOINT transform_geometry_column",
+				 NULL);
+      }
+
+  stop:
+    if (workers != NULL)
+      {
+	  for (i = 0; i < n_workers; i++)
+	    {
+		if (i > 0)
+		    spatialite_cleanup_ex (workers[i].cache);
+		if (workers[i].error_message != NULL)
+		    sqlite3_free (workers[i].error_message);
+	    }
+	  free (workers);
+      }
+    if (p_table != NULL)
+	free (p_table);
+    if (p_column != NULL)
+	free (p_column);
+    if (proj_from != NULL)
+	free (proj_from);
+    if (proj_to != NULL)
+	free (proj_to);
+    if (msg != NULL)
+      {
+	  if (error_message != NULL && !ok)
+	      *error_message = msg;
+	  else
+	      sqlite3_free (msg);
+      }
+    return ok;
+#else /* PROJ is disabled */
+    if (sqlite == NULL || p_cache == NULL || table == NULL || column == NULL
+	|| srid == 0 || max_threads == 0)
+	sqlite = NULL;		/* silencing stupid compiler warnings about unused args */
+    if (error_message != NULL)
+	*error_message = sqlite3_mprintf ("PROJ support is disabled");
+    return 0;
+#endif /* end including PROJ */
+}
@@ -0,0 +1,514 @@
+/*
+
+ union_reducer.c -- memory-bounded aggregate Union
+
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+#include <spatialite/debug.h>
+
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite_private.h>
+
+#ifndef OMIT_GEOS		/* including GEOS */
+
+#define UNION_REDUCER_ROWS	1024	/* max Geometries buffered at once */
+#define UNION_REDUCER_POINTS	1048576	/* max Vertices buffered at once */
+#define UNION_REDUCER_SLICE	128	/* min Geometries per worker thread */
+#define UNION_REDUCER_LEVELS	64
+
+struct union_reducer_item
+{
+/* a buffered Geometry */
+    gaiaGeomCollPtr geom;
+    unsigned int key;		/* Hilbert key of the MBR center */
+};
+
+struct union_reducer_worker
+{
+/* a slice of the current batch, processed by a single thread */
+    const void *cache;		/* owning the GEOS handle */
+    struct union_reducer_item *items;
+    int count;
+    gaiaGeomCollPtr result;
+    int error;
+    void *thread;
+};
+
+struct union_reducer
+{
+/* an incremental Union: buffered Geometries and partial results */
+    const void *cache;
+    int max_threads;
+    struct union_reducer_worker *workers;
+    int n_workers;
+    struct union_reducer_item items[UNION_REDUCER_ROWS];
+    int count;
+    int points;
+    gaiaGeomCollPtr levels[UNION_REDUCER_LEVELS];
+    int error;
+};
+
+static int
+union_reducer_points (gaiaGeomCollPtr geom)
+{
+/* counting how many Vertices are there in a Geometry */
+    gaiaPointPtr pt;
+    gaiaLinestringPtr ln;
+    gaiaPolygonPtr pg;
+    int ib;
+    int points = 0;
+    pt = geom->FirstPoint;
+    while (pt)
+      {
+	  points++;
+	  pt = pt->Next;
+      }
+    ln = geom->FirstLinestring;
+    while (ln)
+      {
+	  points += ln->Points;
+	  ln = ln->Next;
+      }
+    pg = geom->FirstPolygon;
+    while (pg)
+      {
+	  points += pg->Exterior->Points;
+	  for (ib = 0; ib < pg->NumInteriors; ib++)
+	      points += (pg->Interiors + ib)->Points;
+	  pg = pg->Next;
+      }
+    return points;
+}
+
+static gaiaGeomCollPtr
+union_reducer_unary (const void *cache, gaiaGeomCollPtr geom)
+{
+/* UnaryUnion - always using the reentrant API when possible */
+    if (cache != NULL)
+	return gaiaUnaryUnion_r (cache, geom);
+    return gaiaUnaryUnion (geom);
+}
+
+static gaiaGeomCollPtr
+union_reducer_merge (const void *cache, struct union_reducer_item *items,
+		     int count)
+{
+/* merging many Geometries into the first one, then freeing them */
+    int i;
+    gaiaGeomCollPtr merged = items[0].geom;
+    items[0].geom = NULL;
+    for (i = 1; i < count; i++)
+      {
+	  gaiaMergeGeometries_r (cache, merged, items[i].geom);
+	  gaiaFreeGeomColl (items[i].geom);
+	  items[i].geom = NULL;
+      }
+    return merged;
+}
+
+static void
+union_reducer_work (void *arg)
+{
+/* reducing a whole slice to a single partial result */
+    struct union_reducer_worker *worker = (struct union_reducer_worker *) arg;
+    gaiaGeomCollPtr merged =
+	union_reducer_merge (worker->cache, worker->items, worker->count);
+    worker->result = union_reducer_unary (worker->cache, merged);
+    gaiaFreeGeomColl (merged);
+    if (worker->result == NULL)
+	worker->error = 1;
+}
+
+static unsigned int
+union_reducer_hilbert (unsigned int x, unsigned int y)
+{
+/* position of X,Y along a 65536 x 65536 Hilbert curve */
+    unsigned int n = 65536;
+    unsigned int s;
+    unsigned int rx;
+    unsigned int ry;
+    unsigned int t;
+    unsigned int d = 0;
+    for (s = n / 2; s > 0; s /= 2)
+      {
+	  rx = (x & s) > 0;
+	  ry = (y & s) > 0;
+	  d += s * s * ((3 * rx) ^ ry);
+	  if (ry == 0)
+	    {
+		if (rx == 1)
+		  {
+		      x = n - 1 - x;
+		      y = n - 1 - y;
+		  }
+		t = x;
+		x = y;
+		y = t;
+	    }
+      }
+    return d;
+}
+
+static int
+cmp_union_reducer_items (const void *p1, const void *p2)
+{
+/* compares two buffered Geometries [for QSORT] */
+    const struct union_reducer_item *item1 =
+	(const struct union_reducer_item *) p1;
+    const struct union_reducer_item *item2 =
+	(const struct union_reducer_item *) p2;
+    if (item1->key == item2->key)
+	return 0;
+    if (item1->key > item2->key)
+	return 1;
+    return -1;
+}
+
+static void
+union_reducer_sort (struct union_reducer *reducer)
+{
+/* sorting the buffered Geometries along a Hilbert curve */
+    int i;
+    double minx = DBL_MAX;
+    double miny = DBL_MAX;
+    double maxx = -DBL_MAX;
+    double maxy = -DBL_MAX;
+    double ext_x;
+    double ext_y;
+    for (i = 0; i < reducer->count; i++)
+      {
+	  gaiaGeomCollPtr geom = reducer->items[i].geom;
+	  gaiaMbrGeometry (geom);
+	  if (geom->MinX < minx)
+	      minx = geom->MinX;
+	  if (geom->MinY < miny)
+	      miny = geom->MinY;
+	  if (geom->MaxX > maxx)
+	      maxx = geom->MaxX;
+	  if (geom->MaxY > maxy)
+	      maxy = geom->MaxY;
+      }
+    ext_x = maxx - minx;
+    ext_y = maxy - miny;
+    for (i = 0; i < reducer->count; i++)
+      {
+	  gaiaGeomCollPtr geom = reducer->items[i].geom;
+	  double cx = (geom->MinX + geom->MaxX) / 2.0;
+	  double cy = (geom->MinY + geom->MaxY) / 2.0;
+	  unsigned int x = 0;
+	  unsigned int y = 0;
+	  if (ext_x > 0.0)
+	      x = (unsigned int) (((cx - minx) / ext_x) * 65535.0);
+	  if (ext_y > 0.0)
+	      y = (unsigned int) (((cy - miny) / ext_y) * 65535.0);
+	  reducer->items[i].key = union_reducer_hilbert (x, y);
+      }
+    qsort (reducer->items, reducer->count, sizeof (struct union_reducer_item),
+	   cmp_union_reducer_items);
+}
+
+static void
+union_reducer_push (struct union_reducer *reducer, gaiaGeomCollPtr partial)
+{
+/* 
+/ storing a partial result: two partial results of the same level
+/ are united into a single one of the next level, exactly as the
+/ carry of a binary counter, so that only a logarithmic number of
+/ partial results can exist at any time
+*/
+    int level = 0;
+    while (level < UNION_REDUCER_LEVELS - 1 && reducer->levels[level] != NULL)
+      {
+	  gaiaGeomCollPtr merged = reducer->levels[level];
+	  gaiaGeomCollPtr result;
+	  reducer->levels[level] = NULL;
+	  gaiaMergeGeometries_r (reducer->cache, merged, partial);
+	  gaiaFreeGeomColl (partial);
+	  result = union_reducer_unary (reducer->cache, merged);
+	  gaiaFreeGeomColl (merged);
+	  if (result == NULL)
+	    {
+		reducer->error = 1;
+		return;
+	    }
+	  partial = result;
+	  level++;
+      }
+    if (reducer->levels[level] != NULL)
+      {
+	  /* unreachable in practice: the topmost level simply accumulates */
+	  gaiaMergeGeometries_r (reducer->cache, reducer->levels[level],
+				 partial);
+	  gaiaFreeGeomColl (partial);
+      }
+    else
+	reducer->levels[level] = partial;
+}
+
+static int
+union_reducer_threads (struct union_reducer *reducer)
+{
+/* lazily allocating the worker threads (each one owns a GEOS handle) */
+    int i;
+    if (reducer->workers != NULL)
+	return reducer->n_workers;
+    reducer->workers =
+	calloc (reducer->max_threads, sizeof (struct union_reducer_worker));
+    if (reducer->workers == NULL)
+	return 1;
+    for (i = 0; i < reducer->max_threads; i++)
+      {
+	  struct union_reducer_worker *worker = reducer->workers + i;
+	  if (i == 0)
+	      worker->cache = reducer->cache;
+	  else
+	    {
+		worker->cache = spatialite_alloc_connection ();
+		if (worker->cache == NULL)
+		    break;	/* no more free connection slots */
+	    }
+	  reducer->n_workers++;
+      }
+    return reducer->n_workers;
+}
+
+static void
+union_reducer_flush (struct union_reducer *reducer)
+{
+/* reducing the current batch to one or more partial results */
+    struct union_reducer_worker serial;
+    struct union_reducer_worker *workers = &serial;
+    int n_workers = 1;
+    int i;
+    int base = 0;
+    int slice;
+    int extra;
+    if (reducer->count == 0)
+	return;
+    union_reducer_sort (reducer);
+
+    if (reducer->cache != NULL && reducer->max_threads > 1
+	&& reducer->count >= UNION_REDUCER_SLICE * 2)
+      {
+	  /* splitting the batch into spatially contiguous slices */
+	  n_workers = union_reducer_threads (reducer);
+	  if (n_workers > reducer->count / UNION_REDUCER_SLICE)
+	      n_workers = reducer->count / UNION_REDUCER_SLICE;
+	  if (n_workers > 1)
+	      workers = reducer->workers;
+	  else
+	      n_workers = 1;
+      }
+    if (workers == &serial)
+	serial.cache = reducer->cache;
+    slice = reducer->count / n_workers;
+    extra = reducer->count % n_workers;
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct union_reducer_worker *worker = workers + i;
+	  worker->items = reducer->items + base;
+	  worker->count = slice + ((i < extra) ? 1 : 0);
+	  worker->result = NULL;
+	  worker->error = 0;
+	  worker->thread = NULL;
+	  base += worker->count;
+      }
+    for (i = 1; i < n_workers; i++)
+      {
+	  struct union_reducer_worker *worker = workers + i;
+	  worker->thread = splite_thread_create (union_reducer_work, worker);
+	  if (worker->thread == NULL)
+	      union_reducer_work (worker);	/* falling back to serial */
+      }
+/* the current thread always processes the first slice */
+    union_reducer_work (workers);
+    for (i = 1; i < n_workers; i++)
+      {
+	  if (workers[i].thread != NULL)
+	      splite_thread_join (workers[i].thread);
+	  workers[i].thread = NULL;
+      }
+    reducer->count = 0;
+    reducer->points = 0;
+
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct union_reducer_worker *worker = workers + i;
+	  if (worker->error)
+	      reducer->error = 1;
+      }
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct union_reducer_worker *worker = workers + i;
+	  if (worker->result == NULL)
+	      continue;
+	  if (reducer->error)
+	      gaiaFreeGeomColl (worker->result);
+	  else
+	      union_reducer_push (reducer, worker->result);
+	  worker->result = NULL;
+      }
+}
+
+SPATIALITE_PRIVATE void *
+gaiaUnionReducerCreate (const void *p_cache, int max_threads)
+{
+/* creating an incremental Union */
+    struct union_reducer *reducer = malloc (sizeof (struct union_reducer));
+    if (reducer == NULL)
+	return NULL;
+    memset (reducer, 0, sizeof (struct union_reducer));
+    reducer->cache = p_cache;
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    reducer->max_threads = max_threads;
+    return reducer;
+}
+
+SPATIALITE_PRIVATE void
+gaiaUnionReducerAdd (void *p_reducer, void *p_geom)
+{
+/* adding a Geometry to an incremental Union - takes ownership of GEOM */
+    struct union_reducer *reducer = (struct union_reducer *) p_reducer;
+    gaiaGeomCollPtr geom = (gaiaGeomCollPtr) p_geom;
+    if (geom == NULL)
+	return;
+    if (reducer == NULL || reducer->error || gaiaIsEmpty (geom))
+      {
+	  gaiaFreeGeomColl (geom);
+	  return;
+      }
+    reducer->items[reducer->count].geom = geom;
+    reducer->count++;
+    reducer->points += union_reducer_points (geom);
+    if (reducer->count >= UNION_REDUCER_ROWS
+	|| reducer->points >= UNION_REDUCER_POINTS)
+	union_reducer_flush (reducer);
+}
+
+SPATIALITE_PRIVATE void *
+gaiaUnionReducerFinish (void *p_reducer)
+{
+/* 
+/ completing an incremental Union
+/ all partial results (oldest first) and then all still buffered
+/ Geometries are merged together and finally reduced by a single
+/ UnaryUnion; returns NULL on failure or when nothing was added
+*/
+    struct union_reducer *reducer = (struct union_reducer *) p_reducer;
+    struct union_reducer_item items[UNION_REDUCER_LEVELS + UNION_REDUCER_ROWS];
+    int count = 0;
+    int i;
+    gaiaGeomCollPtr merged;
+    gaiaGeomCollPtr result;
+    if (reducer == NULL)
+	return NULL;
+    for (i = UNION_REDUCER_LEVELS - 1; i >= 0; i--)
+      {
+	  if (reducer->levels[i] == NULL)
+	      continue;
+	  items[count++].geom = reducer->levels[i];
+	  reducer->levels[i] = NULL;
+      }
+    for (i = 0; i < reducer->count; i++)
+      {
+	  items[count++].geom = reducer->items[i].geom;
+	  reducer->items[i].geom = NULL;
+      }
+    reducer->count = 0;
+    reducer->points = 0;
+    if (count == 0)
+	return NULL;
+    if (reducer->error)
+      {
+	  for (i = 0; i < count; i++)
+	      gaiaFreeGeomColl (items[i].geom);
+	  return NULL;
+      }
+    merged = union_reducer_merge (reducer->cache, items, count);
+    result = union_reducer_unary (reducer->cache, merged);
+    gaiaFreeGeomColl (merged);
+    return result;
+}
+
+SPATIALITE_PRIVATE void
+gaiaUnionReducerDestroy (void *p_reducer)
+{
+/* destroying an incremental Union */
+    int i;
+    struct union_reducer *reducer = (struct union_reducer *) p_reducer;
+    if (reducer == NULL)
+	return;
+    for (i = 0; i < UNION_REDUCER_LEVELS; i++)
+      {
+	  if (reducer->levels[i] != NULL)
+	      gaiaFreeGeomColl (reducer->levels[i]);
+      }
+    for (i = 0; i < reducer->count; i++)
+	gaiaFreeGeomColl (reducer->items[i].geom);
+    if (reducer->workers != NULL)
+      {
+	  for (i = 1; i < reducer->n_workers; i++)
+	      spatialite_cleanup_ex (reducer->workers[i].cache);
+	  free (reducer->workers);
+      }
+    free (reducer);
+}
+
+#endif /* end including GEOS */
@@ -62,6 +62,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite.h>
 #include <spatialite/spatialite_ext.h>
 #include <spatialite/geojson.h>
+#include <spatialite_private.h>
 
 #ifdef _WIN32
 #define strcasecmp	_stricmp
@@ -115,37 +116,6 @@ typedef struct VirtualGeoJsonCursorStruct
 typedef VirtualGeoJsonCursor *VirtualGeoJsonCursorPtr;
 
 
-static int
-geojson_is_float (const char *buf)
-{
-/* checking for a possible floating point number */
-    int ok = 0;
-    int err = 0;
-    unsigned int i;
-    for (i = 0; i < strlen (buf); i++)
-      {
-	  if (i == 0 && (*(buf + i) == '-' || *(buf + i) == '+'))
-	      continue;
-	  if (*(buf + i) == '.')
-	    {
-		ok++;
-		continue;
-	    }
-	  if (*(buf + i) == 'e' || *(buf + i) == 'E')
-	    {
-		ok++;
-		continue;
-	    }
-	  if (*(buf + i) >= '0' && *(buf + i) <= '9')
-	      ;
-	  else
-	      err++;
-      }
-    if (!err && ok == 1)
-	return 1;
-    return 0;
-}
-
 static geojson_property_ptr
 geojson_create_property ()
 {
@@ -295,12 +265,11 @@ static int
 geojson_parse_value (geojson_stack_ptr stack, char c, char **error_message)
 {
 /* parsing a GeoJSON Object's Value string */
-    if (stack->key_idx >= GEOJSON_MAX - 1)
+    if (stack->value_idx >= GEOJSON_MAX - 1)
       {
-	  *error_message =
-	      sqlite3_mprintf
-	      ("GeoJSON Object's Value string: len > %d chars\n", GEOJSON_MAX);
-	  return 0;
+	  /* only short Values (e.g. "Feature") are meaningful here;
+	     any longer string is simply truncated */
+	  return 1;
       }
     *(stack->value + stack->value_idx) = c;
     stack->value_idx += 1;
@@ -785,7 +754,7 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
     long offset;
     int level = -1;
     int is_string = 0;
-    int prev_char = '\0';
+    int is_escaped = 0;
     int is_first = 0;
     int is_second = 0;
     int is_first_ready = 0;
@@ -800,7 +769,7 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 	  if (is_string)
 	    {
 		/* consuming a quoted text string */
-		if (c == '"' && prev_char != '/')
+		if (c == '"' && !is_escaped)
 		  {
 		      is_string = 0;	/* end string marker */
 		      if (is_first)
@@ -829,18 +798,17 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 				goto err;
 			}
 		  }
-		prev_char = c;
+		/* a backslash escapes the next char (e.g. \") */
+		is_escaped = (c == '\\' && !is_escaped);
 		continue;
 	    }
 	  if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
 	    {
 		/* ignoring white spaces */
-		prev_char = c;
 		continue;
 	    }
 	  if (c == '[' || c == ']')
 	    {
-		prev_char = c;
 		is_second_ready = 0;
 		is_second = 0;
 		is_numeric = 0;
@@ -858,7 +826,6 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 		if (!geojson_start_object
 		    (parser, stack, level, offset, parent_key, error_message))
 		    goto err;
-		prev_char = c;
 		is_first_ready = 1;
 		is_first = 0;
 		is_second_ready = 0;
@@ -874,7 +841,6 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 		if (!geojson_end_object (stack, level, offset, error_message))
 		    goto err;
 		level--;
-		prev_char = c;
 		is_first_ready = 0;
 		is_first = 0;
 		is_second_ready = 0;
@@ -884,7 +850,6 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 	    }
 	  if (c == ':')
 	    {
-		prev_char = c;
 		is_first_ready = 0;
 		is_second_ready = 1;
 		continue;
@@ -892,7 +857,6 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 	  if (c == ',')
 	    {
 		geojson_add_keyval (stack, level);
-		prev_char = c;
 		is_first_ready = 1;
 		is_first = 0;
 		is_second_ready = 0;
@@ -904,7 +868,6 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 	    {
 		/* a quoted text string starts here */
 		is_string = 1;
-		prev_char = c;
 		if (is_first_ready)
 		  {
 		      is_first_ready = 0;
@@ -928,10 +891,8 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 		/* consuming a numeric or special value */
 		if (!geojson_parse_numvalue (stack, c, error_message))
 		    goto err;
-		prev_char = c;
 		continue;
 	    }
-	  prev_char = c;
       }
     geojson_destroy_stack (stack);
     return 1;
@@ -942,183 +903,10 @@ geojson_parser_init (geojson_parser_ptr parser, char **error_message)
 }
 
 static int
-geojson_get_property (const char *buf, geojson_stack_ptr stack,
-		      geojson_property_ptr prop, int *off, char **error_message)
-{
-/* parsing the Feature's Properties string */
-    char c;
-    int len;
-    int is_string = 0;
-    int prev_char = '\0';
-    int is_first = 0;
-    int is_second = 0;
-    int is_first_ready = 1;
-    int is_second_ready = 0;
-    int is_numeric = 0;
-    const char *end_p = buf + strlen (buf);
-    const char *p = buf + *off;
-    if (p < buf || p >= end_p)
-	return -1;		/* the string has been completely parsed */
-
-/* resetting all stack buffers */
-    memset (stack->key, '\0', GEOJSON_MAX);
-    stack->key_idx = 0;
-    memset (stack->value, '\0', GEOJSON_MAX);
-    stack->value_idx = 0;
-    memset (stack->numvalue, '\0', GEOJSON_MAX);
-    stack->numvalue_idx = 0;
-
-    while (1)
-      {
-	  /* consuming the GeoJSON Properties string */
-	  if (p >= end_p)
-	      break;
-	  c = *p++;
-	  if (is_string)
-	    {
-		/* consuming a quoted text string */
-		if (c == '"' && prev_char != '/')
-		  {
-		      is_string = 0;	/* end string marker */
-		      if (is_first)
-			{
-			    /* found the GeoJSON object Key terminator */
-			    is_first = 0;
-			}
-		      if (is_second)
-			{
-			    /* found the GeoJSON object Value terminator */
-			    is_second = 0;
-			}
-		  }
-		else
-		  {
-		      if (is_first)
-			{
-			    /* found the GeoJSON object Key */
-			    if (!geojson_parse_key (stack, c, error_message))
-				goto err;
-			    if (prop->name != NULL)
-				free (prop->name);
-			    len = strlen (stack->key);
-			    if (len == 0)
-				prop->name = NULL;
-			    else
-			      {
-				  prop->name = malloc (len + 1);
-				  strcpy (prop->name, stack->key);
-			      }
-			}
-		      if (is_second)
-			{
-			    /* found the GeoJSON object Value */
-			    if (!geojson_parse_value (stack, c, error_message))
-				goto err;
-			    if (prop->txt_value != NULL)
-				free (prop->txt_value);
-			    prop->txt_value = NULL;
-			    len = strlen (stack->value);
-			    if (len > 0)
-			      {
-				  prop->txt_value = malloc (len + 1);
-				  strcpy (prop->txt_value, stack->value);
-			      }
-			    prop->type = GEOJSON_TEXT;
-			}
-		  }
-		prev_char = c;
-		continue;
-	    }
-	  if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-	    {
-		/* ignoring white spaces */
-		prev_char = c;
-		continue;
-	    }
-	  if (c == ':')
-	    {
-		prev_char = c;
-		is_first = 0;
-		is_first_ready = 0;
-		is_second_ready = 1;
-		continue;
-	    }
-	  if (c == ',')
-	      break;
-	  if (c == '"')
-	    {
-		/* a quoted text string starts here */
-		is_string = 1;
-		prev_char = c;
-		if (is_first_ready)
-		  {
-		      is_first_ready = 0;
-		      is_first = 1;
-		  }
-		if (is_second_ready)
-		  {
-		      is_second_ready = 0;
-		      is_second = 1;
-		  }
-		continue;
-	    }
-	  if (is_second_ready)
-	    {
-		/* should be the beginning of some numeric value */
-		is_second_ready = 0;
-		is_numeric = 1;
-	    }
-	  if (is_numeric)
-	    {
-		/* consuming a numeric or special value */
-		if (!geojson_parse_numvalue (stack, c, error_message))
-		    goto err;
-		prev_char = c;
-		continue;
-	    }
-	  prev_char = c;
-      }
-    if (is_numeric)
-      {
-	  if (strcmp (stack->numvalue, "null") == 0)
-	      prop->type = GEOJSON_NULL;
-	  else if (strcmp (stack->numvalue, "true") == 0)
-	      prop->type = GEOJSON_TRUE;
-	  else if (strcmp (stack->numvalue, "false") == 0)
-	      prop->type = GEOJSON_FALSE;
-	  else
-	    {
-		len = strlen (stack->numvalue);
-		if (len > 0)
-		  {
-		      if (geojson_is_float (stack->numvalue))
-			{
-			    prop->dbl_value = atof (stack->numvalue);
-			    prop->type = GEOJSON_DOUBLE;
-			}
-		      else
-			{
-			    prop->int_value = atoll (stack->numvalue);
-			    prop->type = GEOJSON_INTEGER;
-			}
-		  }
-	    }
-      }
-
-    *off = p - buf;
-    return 1;
-
-  err:
-    return 0;
-}
-
-static int
-geojson_parse_columns (geojson_parser_ptr parser, const char *buf,
-		       char **error_message)
+geojson_parse_columns (geojson_parser_ptr parser, const char *buf)
 {
 /* attempting to parse Feature's Properties for detecting Column types */
-    int off = 0;
-    geojson_stack_ptr stack = geojson_create_stack ();
+    const char *p = buf;
     geojson_property prop;
     geojson_init_property (&prop);
 
@@ -1126,7 +914,7 @@ geojson_parse_columns (geojson_parser_ptr parser, const char *buf,
       {
 	  int ret;
 	  geojson_reset_property (&prop);
-	  ret = geojson_get_property (buf, stack, &prop, &off, error_message);
+	  ret = geojson_read_member (&p, &prop);
 	  if (ret <= 0)
 	      geojson_reset_property (&prop);
 	  if (ret < 0)
@@ -1153,28 +941,24 @@ geojson_parse_columns (geojson_parser_ptr parser, const char *buf,
 	      goto err;
 	  geojson_reset_property (&prop);
       }
-    geojson_destroy_stack (stack);
     return 1;
 
   err:
-    geojson_destroy_stack (stack);
     return 0;
 }
 
 static int
-geojson_parse_properties (geojson_feature_ptr ft, const char *buf,
-			  char **error_message)
+geojson_parse_properties (geojson_feature_ptr ft, const char *buf)
 {
 /* attempting to parse Feature's Properties for loading Values */
-    int off = 0;
-    geojson_stack_ptr stack = geojson_create_stack ();
+    const char *p = buf;
     geojson_property_ptr prop;
 
     while (1)
       {
 	  int ret;
 	  prop = geojson_create_property ();
-	  ret = geojson_get_property (buf, stack, prop, &off, error_message);
+	  ret = geojson_read_member (&p, prop);
 	  if (ret <= 0)
 	      geojson_destroy_property (prop);
 	  if (ret < 0)
@@ -1209,11 +993,9 @@ geojson_parse_properties (geojson_feature_ptr ft, const char *buf,
 		goto err;
 	    }
       }
-    geojson_destroy_stack (stack);
     return 1;
 
   err:
-    geojson_destroy_stack (stack);
     return 0;
 }
 
@@ -1293,7 +1075,7 @@ geojson_check_features (geojson_parser_ptr parser, char **error_message)
 		return 0;
 	    }
 	  *(buf + len) = '\0';
-	  geojson_parse_columns (parser, buf, error_message);
+	  geojson_parse_columns (parser, buf);
 	  free (buf);
       }
     for (i = 0; i < parser->count; i++)
@@ -1996,7 +1778,7 @@ geojson_init_feature (geojson_parser_ptr parser, geojson_feature_ptr ft,
 	  return 0;
       }
     *(buf + len) = '\0';
-    geojson_parse_properties (ft, buf, error_message);
+    geojson_parse_properties (ft, buf);
     free (buf);
 
 /* checking for duplicate Droperty names */
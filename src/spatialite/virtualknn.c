@@ -59,54 +59,56 @@ CIG: 644544015A
 
 IMPORTANT NOTE: how KNN works
 
-the KNN module is implemented on the top of an SQLite's R*Tree, and
-more specifically is built around the sqlite3_rtree_query_callback()
-function.
-
-this API allows to directly explore the R*Tree hierarchy; for each
-node found within the Tree the registered callback will be invoked
-so to determine if the current Tree node (aka BBOX) should be further
-expanded or should be ignored.
-while the process goes on all Tree levels will be traversed until it
-reaches Level=0 (Leaves aka Terminal Nodes) where the indexed
-Geometries will be finally referenced by their individual ROWID and BBOX
-
-in a most usual Spatial Index query the R*Tree will be simply
-traversed starting from Root Nodes (higher level) and progressively
-descending level by level toward Leaf Nodes (indexed Geometries); in
-this specific case the BBOX to be searched is clearly defined, so the
-callback function should simply check if each Node BBOX do effectively
-intersect the reference BBOX and that's all.
-
-the access strategy required by a KNN query is much more complex than
-this, because there is no reference BBOX at all (the search radius is
-unknown in this case); so it should be dynamically built by repeatedly
-querying the R*Tree until a satisfying solution is found.
+the KNN module is implemented on the top of an SQLite's R*Tree, whose
+nodes are directly read from the "idx_<table>_<geom>_node" shadow table.
+each node is a BLOB starting with a 16 bit Tree depth (only meaningful
+for the Root node) and a 16 bit cell count, followed by an array of
+cells; each cell is a 64 bit integer (child node or indexed ROWID)
+followed by four 32 bit floats [xmin, xmax, ymin, ymax], all of them in
+big-endian order.
+
+the Tree is explored "best-first": a priority queue sorted by distance
+is initially seeded with just the Root node, then the nearest entry is
+repeatedly extracted from the queue.
 
 step #1
 -------
-we'll descend the Tree by exploring a Level at each time so to
-identify the lower-level BBOX containing the reference Geometry.
-if no BBOX directly contains the reference Geometry then the
-nearest one will be identified.
+an internal node is expanded: each child BBOX is inserted into the
+queue, using as the key the distance between the BBOX of the reference
+Geometry and the child BBOX; this is always a lower bound of the
+distance from any Geometry indexed below the child.
 
 step #2
 -------
-the reference Geometry will now be buffered so to completely
-cover the BBOX identified in the previous step.
+a Leaf cell (an indexed Geometry only known by its BBOX) is refined:
+the exact distance is computed by ST_Distance() and the Geometry is
+inserted again into the queue, this time using its true distance.
 
 step #3
 -------
-an ordinary Spatial Index query will be now performed, using
-the buffered Geometry as the search frame, so to identify
-all nearest features.
-
-step #4
--------
-if the total number of nearest features identified by the
-previous query is less than requested, then the buffer
-radius will be repeatedly expanded until all requested
-nearest features will be found.
+a Geometry carrying its exact distance is surely the nearest one
+among all the remaining ones, and is immediately appended to the
+result set.
+
+the process stops as soon as the requested number of nearest features
+has been found, or when the queue becomes empty; so each node will be
+read at most once, and the exact distance will be computed only for
+the Leaf candidates actually competing for the result set.
+
+for Geographic SRIDs distances are measured in meters: in this case
+the BBOX distances are conservatively estimated on a sphere smaller
+than any Earth's ellipsoid, so to still be lower bounds.
+
+attribute filtering
+-------------------
+a "filter" SQL expression (e.g. filter = 'kind = ''school''') and/or
+a "fid IN (subquery)" set of ROWIDs may be optionally specified: both
+of them are checked during step #2, so that any Leaf candidate failing
+to match is simply discarded before being inserted into the queue.
+the traversal then continues until exactly "max_items" qualifying
+features have been found, with no need to over-fetch and post-filter.
+the "filter" must be a single expression: any filter whose parentheses
+are unbalanced at the top level is rejected as invalid.
 
 */
 
@@ -145,6 +147,20 @@ static struct sqlite3_module my_knn_module;
 /
 ******************************************************************************/
 
+#define VKNN_CELL		24
+#define VKNN_HEADER		4
+#define VKNN_MAX_DEPTH		40
+#define VKNN_NODE		0	/* queue entry: an R*Tree node */
+#define VKNN_LEAF		1	/* queue entry: a Leaf cell (BBOX only) */
+#define VKNN_FEATURE		2	/* queue entry: an exact distance */
+#define VKNN_MIN_RADIUS		6300000.0	/* meters, less than any b^2/a */
+#define VKNN_DEG2RAD		(3.14159265358979323846 / 180.0)
+#define VKNN_IDX_VALID		1	/* idxNum: a valid KNN query */
+#define VKNN_IDX_COLUMN		2	/* idxNum: f_geometry_column */
+#define VKNN_IDX_MAX		4	/* idxNum: max_items */
+#define VKNN_IDX_FILTER		8	/* idxNum: filter */
+#define VKNN_IDX_ROWIDS		16	/* idxNum: fid IN (...) */
+
 typedef struct VKnnItemStruct
 {
 /* a Feature item into the KNN sorted array */
@@ -153,6 +169,16 @@ typedef struct VKnnItemStruct
 } VKnnItem;
 typedef VKnnItem *VKnnItemPtr;
 
+typedef struct VKnnQueueItemStruct
+{
+/* an entry into the best-first priority queue */
+    sqlite3_int64 id;		/* node number or ROWID */
+    double dist;		/* lower bound or exact distance */
+    int type;			/* VKNN_NODE, VKNN_LEAF or VKNN_FEATURE */
+    int level;			/* R*Tree level (nodes only; -1 for the Root) */
+} VKnnQueueItem;
+typedef VKnnQueueItem *VKnnQueueItemPtr;
+
 typedef struct VKnnContextStruct
 {
 /* current KNN context */
@@ -161,32 +187,22 @@ typedef struct VKnnContextStruct
     unsigned char *blob;
     int blob_size;
     sqlite3_stmt *stmt_dist;
-    sqlite3_stmt *stmt_map_dist;
-    sqlite3_stmt *stmt_rect_dist;
-    sqlite3_stmt *stmt_pt_dist;
-    sqlite3_stmt *stmt_buffer;
-    sqlite3_stmt *stmt_rtree;
-    sqlite3_stmt *stmt_rtree_count;
-    double bbox_minx;
-    double bbox_miny;
-    double bbox_maxx;
-    double bbox_maxy;
-    double minx;
+    sqlite3_stmt *stmt_node;
+    int is_geographic;
+    int is_point;
+    double minx;		/* the reference Geometry's BBOX */
     double miny;
     double maxx;
     double maxy;
-    double min_dist;
-    double rtree_minx;
-    double rtree_miny;
-    double rtree_maxx;
-    double rtree_maxy;
-    int level;
-    int current_level;
+    VKnnQueueItemPtr queue;
+    int queue_count;
+    int queue_max;
+    char *filter;		/* the optional filter expression */
+    sqlite3_int64 *rowid_set;	/* the optional sorted ROWID IN-set */
+    int rowid_set_count;
     VKnnItemPtr knn_array;
     int max_items;
-    double max_dist;
     int curr_items;
-    int rtree_count;
 } VKnnContext;
 typedef VKnnContext *VKnnContextPtr;
 
@@ -221,32 +237,22 @@ vknn_empty_context (VKnnContextPtr ctx)
     ctx->blob = NULL;
     ctx->blob_size = 0;
     ctx->stmt_dist = NULL;
-    ctx->stmt_map_dist = NULL;
-    ctx->stmt_rect_dist = NULL;
-    ctx->stmt_pt_dist = NULL;
-    ctx->stmt_buffer = NULL;
-    ctx->stmt_rtree = NULL;
-    ctx->stmt_rtree_count = NULL;
-    ctx->bbox_minx = -DBL_MAX;
-    ctx->bbox_miny = -DBL_MAX;
-    ctx->bbox_maxx = DBL_MAX;
-    ctx->bbox_maxy = DBL_MAX;
+    ctx->stmt_node = NULL;
+    ctx->is_geographic = 0;
+    ctx->is_point = 0;
     ctx->minx = DBL_MAX;
     ctx->miny = DBL_MAX;
     ctx->maxx = -DBL_MAX;
     ctx->maxy = -DBL_MAX;
-    ctx->min_dist = DBL_MAX;
-    ctx->rtree_minx = -DBL_MAX;
-    ctx->rtree_miny = -DBL_MAX;
-    ctx->rtree_maxx = DBL_MAX;
-    ctx->rtree_maxy = DBL_MAX;
-    ctx->level = 0;
-    ctx->current_level = 0;
+    ctx->queue = NULL;
+    ctx->queue_count = 0;
+    ctx->queue_max = 0;
+    ctx->filter = NULL;
+    ctx->rowid_set = NULL;
+    ctx->rowid_set_count = 0;
     ctx->max_items = 0;
     ctx->knn_array = NULL;
     ctx->curr_items = 0;
-    ctx->rtree_count = 0;
-    ctx->max_dist = -DBL_MAX;
 }
 
 static VKnnContextPtr
@@ -272,63 +278,25 @@ vknn_reset_context (VKnnContextPtr ctx)
 	free (ctx->blob);
     if (ctx->stmt_dist != NULL)
 	sqlite3_finalize (ctx->stmt_dist);
-    if (ctx->stmt_map_dist != NULL)
-	sqlite3_finalize (ctx->stmt_map_dist);
-    if (ctx->stmt_rect_dist != NULL)
-	sqlite3_finalize (ctx->stmt_rect_dist);
-    if (ctx->stmt_pt_dist != NULL)
-	sqlite3_finalize (ctx->stmt_pt_dist);
-    if (ctx->stmt_buffer != NULL)
-	sqlite3_finalize (ctx->stmt_buffer);
-    if (ctx->stmt_rtree != NULL)
-	sqlite3_finalize (ctx->stmt_rtree);
-    if (ctx->stmt_rtree_count != NULL)
-	sqlite3_finalize (ctx->stmt_rtree_count);
+    if (ctx->stmt_node != NULL)
+	sqlite3_finalize (ctx->stmt_node);
+    if (ctx->queue != NULL)
+	free (ctx->queue);
+    if (ctx->filter != NULL)
+	free (ctx->filter);
+    if (ctx->rowid_set != NULL)
+	free (ctx->rowid_set);
     if (ctx->knn_array != NULL)
 	free (ctx->knn_array);
     vknn_empty_context (ctx);
 }
 
-static void
-vknn_rtree_count (VKnnContextPtr ctx)
-{
-/* approximatively counting how many entries are into the R*Tree */
-    int ret;
-    sqlite3_stmt *stmt;
-
-
-    ctx->rtree_count = 0;
-    if (ctx == NULL)
-	return;
-    stmt = ctx->stmt_rtree_count;
-    if (stmt == NULL)
-	return;
-    sqlite3_reset (stmt);
-    while (1)
-      {
-	  /* scrolling the result set rows */
-	  ret = sqlite3_step (stmt);
-	  if (ret == SQLITE_DONE)
-	      break;		/* end of result set */
-	  if (ret == SQLITE_ROW)
-	    {
-		ctx->rtree_count += 1;
-	    }
-	  else
-	    {
-		ctx->rtree_count = 0;
-		break;
-	    }
-      }
-}
-
 static void
 vknn_init_context (VKnnContextPtr ctx, const char *table, const char *column,
-		   gaiaGeomCollPtr geom, int max_items,
-		   sqlite3_stmt * stmt_dist, sqlite3_stmt * stmt_map_dist,
-		   sqlite3_stmt * stmt_rect_dist, sqlite3_stmt * stmt_pt_dist,
-		   sqlite3_stmt * stmt_buffer, sqlite3_stmt * stmt_rtree,
-		   sqlite3_stmt * stmt_rtree_count)
+		   gaiaGeomCollPtr geom, int max_items, int is_geographic,
+		   sqlite3_stmt * stmt_dist, sqlite3_stmt * stmt_node,
+		   const char *filter, sqlite3_int64 * rowid_set,
+		   int rowid_set_count)
 {
 /* initializing a KNN context */
     int i;
@@ -343,12 +311,22 @@ vknn_init_context (VKnnContextPtr ctx, const char *table, const char *column,
     strcpy (ctx->column_name, column);
     gaiaToSpatiaLiteBlobWkb (geom, &(ctx->blob), &(ctx->blob_size));
     ctx->stmt_dist = stmt_dist;
-    ctx->stmt_map_dist = stmt_map_dist;
-    ctx->stmt_rect_dist = stmt_rect_dist;
-    ctx->stmt_pt_dist = stmt_pt_dist;
-    ctx->stmt_buffer = stmt_buffer;
-    ctx->stmt_rtree = stmt_rtree;
-    ctx->stmt_rtree_count = stmt_rtree_count;
+    ctx->stmt_node = stmt_node;
+    ctx->is_geographic = is_geographic;
+    if (filter != NULL)
+      {
+	  i = strlen (filter);
+	  ctx->filter = malloc (i + 1);
+	  strcpy (ctx->filter, filter);
+      }
+    ctx->rowid_set = rowid_set;
+    ctx->rowid_set_count = rowid_set_count;
+    ctx->minx = geom->MinX;
+    ctx->miny = geom->MinY;
+    ctx->maxx = geom->MaxX;
+    ctx->maxy = geom->MaxY;
+    if (geom->MinX == geom->MaxX && geom->MinY == geom->MaxY)
+	ctx->is_point = 1;
     ctx->max_items = max_items;
     ctx->knn_array = malloc (sizeof (VKnnItem) * max_items);
     for (i = 0; i < max_items; i++)
@@ -359,7 +337,6 @@ vknn_init_context (VKnnContextPtr ctx, const char *table, const char *column,
 	  item->dist = DBL_MAX;
       }
     ctx->curr_items = 0;
-    vknn_rtree_count (ctx);
 }
 
 static void
@@ -800,7 +777,8 @@ vknn_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
     xname = gaiaDoubleQuotedSql (vtable);
     buf = sqlite3_mprintf ("CREATE TABLE \"%s\" (f_table_name TEXT, "
 			   "f_geometry_column TEXT, ref_geometry BLOB, max_items INTEGER, "
-			   "pos INTEGER, fid INTEGER, distance DOUBLE)", xname);
+			   "pos INTEGER, fid INTEGER, distance DOUBLE, filter TEXT)",
+			   xname);
     free (xname);
     free (vtable);
     if (sqlite3_declare_vtab (db, buf) != SQLITE_OK)
@@ -830,63 +808,86 @@ vknn_best_index (sqlite3_vtab * pVTab, sqlite3_index_info * pIdxInfo)
 {
 /* best index selection */
     int i;
-    int err = 1;
-    int table = 0;
-    int geom_col = 0;
-    int ref_geom = 0;
-    int max_items = 0;
+    int dup = 0;
+    int argc = 0;
+    int table = -1;
+    int geom_col = -1;
+    int ref_geom = -1;
+    int max_items = -1;
+#if SQLITE_VERSION_NUMBER >= 3038000
+    int rowids = -1;
+#endif
+    int filter = -1;
+    int *slot;
     if (pVTab)
 	pVTab = pVTab;		/* unused arg warning suppression */
     for (i = 0; i < pIdxInfo->nConstraint; i++)
       {
 	  /* verifying the constraints */
 	  struct sqlite3_index_constraint *p = &(pIdxInfo->aConstraint[i]);
-	  if (p->usable)
-	    {
-		if (p->iColumn == 0 && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
-		    table++;
-		else if (p->iColumn == 1 && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
-		    geom_col++;
-		else if (p->iColumn == 2 && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
-		    ref_geom++;
-		else if (p->iColumn == 3 && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
-		    max_items++;
-	    }
-      }
-    if (table == 1 && (geom_col == 0 || geom_col == 1) && ref_geom == 1
-	&& (max_items == 0 || max_items == 1))
-      {
-	  /* this one is a valid KNN query */
-	  if (geom_col == 1)
-	    {
-		if (max_items == 1)
-		    pIdxInfo->idxNum = 3;
-		else
-		    pIdxInfo->idxNum = 1;
-	    }
+	  if (!p->usable || p->op != SQLITE_INDEX_CONSTRAINT_EQ)
+	      continue;
+	  if (p->iColumn == 0)
+	      slot = &table;
+	  else if (p->iColumn == 1)
+	      slot = &geom_col;
+	  else if (p->iColumn == 2)
+	      slot = &ref_geom;
+	  else if (p->iColumn == 3)
+	      slot = &max_items;
+#if SQLITE_VERSION_NUMBER >= 3038000
+	  else if (p->iColumn == 5 && sqlite3_vtab_in (pIdxInfo, i, -1))
+	      slot = &rowids;	/* a ROWID IN-set */
+#endif
+	  else if (p->iColumn == 7)
+	      slot = &filter;
 	  else
-	    {
-		if (max_items == 1)
-		    pIdxInfo->idxNum = 4;
-		else
-		    pIdxInfo->idxNum = 2;
-	    }
-	  pIdxInfo->estimatedCost = 1.0;
-	  for (i = 0; i < pIdxInfo->nConstraint; i++)
-	    {
-		if (pIdxInfo->aConstraint[i].usable)
-		  {
-		      pIdxInfo->aConstraintUsage[i].argvIndex = i + 1;
-		      pIdxInfo->aConstraintUsage[i].omit = 1;
-		  }
-	    }
-	  err = 0;
+	      continue;
+	  if (*slot >= 0)
+	      dup = 1;
+	  *slot = i;
       }
-    if (err)
+    if (table < 0 || ref_geom < 0 || dup)
       {
 	  /* illegal query */
 	  pIdxInfo->idxNum = 0;
+	  return SQLITE_OK;
+      }
+
+/* this one is a valid KNN query: args are passed in a fixed order */
+    pIdxInfo->idxNum = VKNN_IDX_VALID;
+    pIdxInfo->aConstraintUsage[table].argvIndex = ++argc;
+    if (geom_col >= 0)
+      {
+	  pIdxInfo->idxNum |= VKNN_IDX_COLUMN;
+	  pIdxInfo->aConstraintUsage[geom_col].argvIndex = ++argc;
       }
+    pIdxInfo->aConstraintUsage[ref_geom].argvIndex = ++argc;
+    if (max_items >= 0)
+      {
+	  pIdxInfo->idxNum |= VKNN_IDX_MAX;
+	  pIdxInfo->aConstraintUsage[max_items].argvIndex = ++argc;
+      }
+    if (filter >= 0)
+      {
+	  pIdxInfo->idxNum |= VKNN_IDX_FILTER;
+	  pIdxInfo->aConstraintUsage[filter].argvIndex = ++argc;
+      }
+#if SQLITE_VERSION_NUMBER >= 3038000
+    if (rowids >= 0)
+      {
+	  /* the whole IN-set will be passed at once */
+	  sqlite3_vtab_in (pIdxInfo, rowids, 1);
+	  pIdxInfo->idxNum |= VKNN_IDX_ROWIDS;
+	  pIdxInfo->aConstraintUsage[rowids].argvIndex = ++argc;
+      }
+#endif
+    for (i = 0; i < pIdxInfo->nConstraint; i++)
+      {
+	  if (pIdxInfo->aConstraintUsage[i].argvIndex > 0)
+	      pIdxInfo->aConstraintUsage[i].omit = 1;
+      }
+    pIdxInfo->estimatedCost = 1.0;
     return SQLITE_OK;
 }
 
@@ -930,70 +931,6 @@ vknn_close (sqlite3_vtab_cursor * pCursor)
     return SQLITE_OK;
 }
 
-static void
-vknn_shift_items (VKnnContextPtr ctx, int index)
-{
-/* shifting down the Features sorted array */
-    int i;
-    for (i = ctx->max_items - 1; i > index; i--)
-      {
-	  VKnnItemPtr item1 = ctx->knn_array + i - 1;
-	  VKnnItemPtr item2 = ctx->knn_array + i;
-	  item2->rowid = item1->rowid;
-	  item2->dist = item1->dist;
-	  if ((i == ctx->max_items - 1) && item2->dist != DBL_MAX)
-	      ctx->max_dist = item2->dist;
-      }
-}
-
-static void
-vknn_update_items (VKnnContextPtr ctx, sqlite3_int64 rowid, double dist)
-{
-/* updating the Features sorted array */
-    int i;
-    if (ctx->curr_items == ctx->max_items)
-      {
-	  if (dist >= ctx->max_dist)
-	      return;
-      }
-    for (i = 0; i < ctx->max_items; i++)
-      {
-	  VKnnItemPtr item = ctx->knn_array + i;
-	  if (rowid == item->rowid)
-	      return;
-	  if (dist < item->dist)
-	    {
-		vknn_shift_items (ctx, i);
-		item->rowid = rowid;
-		item->dist = dist;
-		break;
-	    }
-      }
-    if (dist > ctx->max_dist)
-	ctx->max_dist = dist;
-    if (ctx->curr_items < ctx->max_items)
-	ctx->curr_items += 1;
-}
-
-static int
-vknn_check_mbr (VKnnContextPtr ctx, double rtree_minx, double rtree_miny,
-		double rtree_maxx, double rtree_maxy)
-{
-/* comparing two MBRs */
-    if (rtree_minx >= ctx->bbox_minx && rtree_maxx <= ctx->bbox_maxx
-	&& rtree_miny >= ctx->bbox_miny && rtree_maxy <= ctx->bbox_maxy)
-	return FULLY_WITHIN;
-    if (rtree_maxx < ctx->bbox_minx)
-	return NOT_WITHIN;
-    if (rtree_minx > ctx->bbox_maxx)
-	return NOT_WITHIN;
-    if (rtree_maxy < ctx->bbox_miny)
-	return NOT_WITHIN;
-    if (rtree_miny > ctx->bbox_maxy)
-	return NOT_WITHIN;
-    return PARTLY_WITHIN;
-}
-
 static double
 vknn_compute_distance (VKnnContextPtr ctx, sqlite3_int64 rowid)
 {
@@ -1032,67 +969,214 @@ vknn_compute_distance (VKnnContextPtr ctx, sqlite3_int64 rowid)
     return dist;
 }
 
+static int
+vknn_import16 (const unsigned char *p)
+{
+/* deserializing a big-endian 16 bit unsigned integer */
+    return (p[0] << 8) | p[1];
+}
+
+static sqlite3_int64
+vknn_import64 (const unsigned char *p)
+{
+/* deserializing a big-endian 64 bit integer */
+    sqlite3_uint64 v = 0;
+    int i;
+    for (i = 0; i < 8; i++)
+	v = (v << 8) | p[i];
+    return (sqlite3_int64) v;
+}
+
 static double
-vknn_rect_distance (VKnnContextPtr ctx, double minx, double miny, double maxx,
-		    double maxy)
+vknn_import_float (const unsigned char *p)
 {
-/* computing the distance between the geometry and an R*Tree BBOX */
-    double dist = DBL_MAX;
-    int ret;
-    sqlite3_stmt *stmt;
-    if (ctx == NULL)
-	return DBL_MAX;
-    if (ctx->blob == NULL)
-	return DBL_MAX;
-    if (ctx->stmt_rect_dist == NULL)
-	return DBL_MAX;
-    stmt = ctx->stmt_rect_dist;
-    sqlite3_reset (stmt);
-    sqlite3_clear_bindings (stmt);
-    sqlite3_bind_blob (stmt, 1, ctx->blob, ctx->blob_size, SQLITE_STATIC);
-    sqlite3_bind_double (stmt, 2, minx);
-    sqlite3_bind_double (stmt, 3, miny);
-    sqlite3_bind_double (stmt, 4, maxx);
-    sqlite3_bind_double (stmt, 5, maxy);
+/* deserializing a big-endian 32 bit float */
+    union
+    {
+	float f;
+	unsigned int u;
+    } v;
+    v.u = ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+	((unsigned int) p[2] << 8) | (unsigned int) p[3];
+    return v.f;
+}
+
+static int
+vknn_queue_push (VKnnContextPtr ctx, sqlite3_int64 id, double dist, int type,
+		 int level)
+{
+/* inserting a new entry into the priority queue (binary min-heap) */
+    int i;
+    VKnnQueueItemPtr q;
+    if (ctx->queue_count >= ctx->queue_max)
+      {
+	  /* expanding the queue */
+	  int new_max = (ctx->queue_max == 0) ? 1024 : ctx->queue_max * 2;
+	  VKnnQueueItemPtr new_queue =
+	      realloc (ctx->queue, sizeof (VKnnQueueItem) * new_max);
+	  if (new_queue == NULL)
+	      return 0;
+	  ctx->queue = new_queue;
+	  ctx->queue_max = new_max;
+      }
+    q = ctx->queue;
+    i = ctx->queue_count++;
+    while (i > 0)
+      {
+	  /* sifting up; on ties exact distances come first */
+	  int parent = (i - 1) / 2;
+	  if (q[parent].dist < dist
+	      || (q[parent].dist == dist && q[parent].type >= type))
+	      break;
+	  q[i] = q[parent];
+	  i = parent;
+      }
+    q[i].id = id;
+    q[i].dist = dist;
+    q[i].type = type;
+    q[i].level = level;
+    return 1;
+}
+
+static void
+vknn_queue_pop (VKnnContextPtr ctx, VKnnQueueItemPtr item)
+{
+/* extracting the nearest entry from the priority queue */
+    int i = 0;
+    VKnnQueueItemPtr q = ctx->queue;
+    VKnnQueueItem last;
+    *item = q[0];
+    ctx->queue_count -= 1;
+    if (ctx->queue_count == 0)
+	return;
+    last = q[ctx->queue_count];
     while (1)
       {
-	  /* scrolling the result set rows */
-	  ret = sqlite3_step (stmt);
-	  if (ret == SQLITE_DONE)
-	      break;		/* end of result set */
-	  if (ret == SQLITE_ROW)
+	  /* sifting down */
+	  int child = (2 * i) + 1;
+	  if (child >= ctx->queue_count)
+	      break;
+	  if (child + 1 < ctx->queue_count
+	      && (q[child + 1].dist < q[child].dist
+		  || (q[child + 1].dist == q[child].dist
+		      && q[child + 1].type > q[child].type)))
+	      child++;
+	  if (last.dist < q[child].dist
+	      || (last.dist == q[child].dist && last.type >= q[child].type))
+	      break;
+	  q[i] = q[child];
+	  i = child;
+      }
+    q[i] = last;
+}
+
+static double
+vknn_geo_lat_distance (double lat1, double lat2)
+{
+/* lower bound of the distance between two parallels (in meters) */
+    return fabs (lat2 - lat1) * VKNN_DEG2RAD * VKNN_MIN_RADIUS;
+}
+
+static double
+vknn_geo_pt_meridian (double lon, double lat, double meridian, double miny,
+		      double maxy)
+{
+/* lower bound of the distance between a Point and a meridian segment */
+    double dlon = fabs (meridian - lon);
+    double phi = lat * VKNN_DEG2RAD;
+    double cos_dlon;
+    double phi0;
+    double c;
+    double best;
+    while (dlon > 360.0)
+	dlon -= 360.0;
+    if (dlon > 180.0)
+	dlon = 360.0 - dlon;
+    cos_dlon = cos (dlon * VKNN_DEG2RAD);
+/* the cosine of the angular distance from both segment's endpoints */
+    best =
+	sin (phi) * sin (miny * VKNN_DEG2RAD) +
+	cos (phi) * cos (miny * VKNN_DEG2RAD) * cos_dlon;
+    c = sin (phi) * sin (maxy * VKNN_DEG2RAD) +
+	cos (phi) * cos (maxy * VKNN_DEG2RAD) * cos_dlon;
+    if (c > best)
+	best = c;
+/* the nearest point along the whole meridian could be an inner one */
+    phi0 = atan2 (sin (phi), cos (phi) * cos_dlon);
+    if (phi0 >= miny * VKNN_DEG2RAD && phi0 <= maxy * VKNN_DEG2RAD)
+      {
+	  c = sin (phi) * sin (phi0) + cos (phi) * cos (phi0) * cos_dlon;
+	  if (c > best)
+	      best = c;
+      }
+    if (best > 1.0)
+	best = 1.0;
+    if (best < -1.0)
+	best = -1.0;
+    return acos (best) * VKNN_MIN_RADIUS;
+}
+
+static double
+vknn_bbox_distance (VKnnContextPtr ctx, double minx, double miny, double maxx,
+		    double maxy)
+{
+/* 
+/ computing a lower bound of the distance between the reference Geometry
+/ and any Geometry contained within an R*Tree BBOX
+*/
+    double dx = 0.0;
+    double dy = 0.0;
+    if (ctx->is_geographic)
+      {
+	  /* Geographic coordinates: distances in meters */
+	  double lon = ctx->minx;
+	  double lat = ctx->miny;
+	  double d1;
+	  double d2;
+	  if (!ctx->is_point)
 	    {
-		if (sqlite3_column_type (stmt, 0) == SQLITE_FLOAT)
-		    dist = sqlite3_column_double (stmt, 0);
+		/* just considering the latitude gap */
+		if (ctx->miny > maxy)
+		    return vknn_geo_lat_distance (maxy, ctx->miny);
+		if (ctx->maxy < miny)
+		    return vknn_geo_lat_distance (ctx->maxy, miny);
+		return 0.0;
 	    }
-	  else
+	  if (lon >= minx && lon <= maxx)
 	    {
-		dist = DBL_MAX;
-		break;
+		/* the nearest point lays on the same meridian */
+		if (lat < miny)
+		    return vknn_geo_lat_distance (lat, miny);
+		if (lat > maxy)
+		    return vknn_geo_lat_distance (maxy, lat);
+		return 0.0;
 	    }
+	  d1 = vknn_geo_pt_meridian (lon, lat, minx, miny, maxy);
+	  d2 = vknn_geo_pt_meridian (lon, lat, maxx, miny, maxy);
+	  return (d1 < d2) ? d1 : d2;
       }
-    return dist;
+/* planar coordinates */
+    if (ctx->maxx < minx)
+	dx = minx - ctx->maxx;
+    else if (ctx->minx > maxx)
+	dx = ctx->minx - maxx;
+    if (ctx->maxy < miny)
+	dy = miny - ctx->maxy;
+    else if (ctx->miny > maxy)
+	dy = ctx->miny - maxy;
+    return sqrt ((dx * dx) + (dy * dy));
 }
 
-static double
-vknn_pt_distance (VKnnContextPtr ctx, double x, double y)
+static int
+vknn_expand_node (VKnnContextPtr ctx, sqlite3_int64 nodeno, int level)
 {
-/* computing the distance between the geometry and a point */
-    double dist = DBL_MAX;
+/* reading an R*Tree node and inserting all its cells into the queue */
     int ret;
-    sqlite3_stmt *stmt;
-    if (ctx == NULL)
-	return DBL_MAX;
-    if (ctx->blob == NULL)
-	return DBL_MAX;
-    if (ctx->stmt_pt_dist == NULL)
-	return DBL_MAX;
-    stmt = ctx->stmt_pt_dist;
+    int ok = 1;
+    sqlite3_stmt *stmt = ctx->stmt_node;
     sqlite3_reset (stmt);
     sqlite3_clear_bindings (stmt);
-    sqlite3_bind_blob (stmt, 1, ctx->blob, ctx->blob_size, SQLITE_STATIC);
-    sqlite3_bind_double (stmt, 2, x);
-    sqlite3_bind_double (stmt, 3, y);
+    sqlite3_bind_int64 (stmt, 1, nodeno);
     while (1)
       {
 	  /* scrolling the result set rows */
@@ -1101,158 +1185,248 @@ vknn_pt_distance (VKnnContextPtr ctx, double x, double y)
 	      break;		/* end of result set */
 	  if (ret == SQLITE_ROW)
 	    {
-		if (sqlite3_column_type (stmt, 0) == SQLITE_FLOAT)
-		    dist = sqlite3_column_double (stmt, 0);
+		const unsigned char *blob;
+		int size;
+		int count;
+		int i;
+		if (sqlite3_column_type (stmt, 0) != SQLITE_BLOB)
+		  {
+		      ok = 0;
+		      break;
+		  }
+		blob = sqlite3_column_blob (stmt, 0);
+		size = sqlite3_column_bytes (stmt, 0);
+		if (size < VKNN_HEADER)
+		  {
+		      ok = 0;
+		      break;
+		  }
+		if (level < 0)
+		  {
+		      /* the Root node: the Tree depth is in its header */
+		      level = vknn_import16 (blob);
+		      if (level > VKNN_MAX_DEPTH)
+			{
+			    ok = 0;
+			    break;
+			}
+		  }
+		count = vknn_import16 (blob + 2);
+		if (VKNN_HEADER + (count * VKNN_CELL) > size)
+		  {
+		      ok = 0;
+		      break;
+		  }
+		for (i = 0; i < count; i++)
+		  {
+		      const unsigned char *cell =
+			  blob + VKNN_HEADER + (i * VKNN_CELL);
+		      sqlite3_int64 id = vknn_import64 (cell);
+		      double minx = vknn_import_float (cell + 8);
+		      double maxx = vknn_import_float (cell + 12);
+		      double miny = vknn_import_float (cell + 16);
+		      double maxy = vknn_import_float (cell + 20);
+		      double dist =
+			  vknn_bbox_distance (ctx, minx, miny, maxx, maxy);
+		      if (level == 0)
+			  ret = vknn_queue_push (ctx, id, dist, VKNN_LEAF, 0);
+		      else
+			  ret =
+			      vknn_queue_push (ctx, id, dist, VKNN_NODE,
+					       level - 1);
+		      if (!ret)
+			{
+			    ok = 0;
+			    break;
+			}
+		  }
 	    }
 	  else
 	    {
-		dist = DBL_MAX;
+		ok = 0;
 		break;
 	    }
       }
-    return dist;
+    sqlite3_reset (stmt);
+    return ok;
+}
+
+static int
+vknn_cmp_rowids (const void *p1, const void *p2)
+{
+/* comparison function for QSort and BSearch */
+    sqlite3_int64 r1 = *((const sqlite3_int64 *) p1);
+    sqlite3_int64 r2 = *((const sqlite3_int64 *) p2);
+    if (r1 < r2)
+	return -1;
+    if (r1 > r2)
+	return 1;
+    return 0;
 }
 
+#if SQLITE_VERSION_NUMBER >= 3038000
 static int
-vknn_bufferize (VKnnContextPtr ctx, double radius)
+vknn_load_rowid_set (sqlite3_value * in_list, sqlite3_int64 ** rowid_set,
+		     int *count)
 {
-/* computing the frame for an R*Tree query */
+/* loading all values from a "fid IN (...)" constraint into a sorted array */
+    sqlite3_value *value;
+    sqlite3_int64 *set = NULL;
+    int max = 0;
+    int n = 0;
     int ret;
-    sqlite3_stmt *stmt;
-    if (ctx == NULL)
-	return 0;
-    if (ctx->blob == NULL)
-	return 0;
-    if (ctx->stmt_buffer == NULL)
-	return 0;
-    stmt = ctx->stmt_buffer;
-    sqlite3_reset (stmt);
-    sqlite3_clear_bindings (stmt);
-    sqlite3_bind_blob (stmt, 1, ctx->blob, ctx->blob_size, SQLITE_STATIC);
-    sqlite3_bind_double (stmt, 2, radius);
-    while (1)
+    *rowid_set = NULL;
+    *count = 0;
+    for (ret = sqlite3_vtab_in_first (in_list, &value);
+	 ret == SQLITE_OK && value != NULL;
+	 ret = sqlite3_vtab_in_next (in_list, &value))
       {
-	  /* scrolling the result set rows */
-	  ret = sqlite3_step (stmt);
-	  if (ret == SQLITE_DONE)
-	      break;		/* end of result set */
-	  if (ret == SQLITE_ROW)
+	  if (sqlite3_value_type (value) != SQLITE_INTEGER)
+	      continue;		/* never matching any ROWID */
+	  if (n == max)
 	    {
-		if (sqlite3_column_type (stmt, 0) == SQLITE_FLOAT)
-		    ctx->rtree_minx = sqlite3_column_double (stmt, 0);
-		if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
-		    ctx->rtree_miny = sqlite3_column_double (stmt, 1);
-		if (sqlite3_column_type (stmt, 2) == SQLITE_FLOAT)
-		    ctx->rtree_maxx = sqlite3_column_double (stmt, 2);
-		if (sqlite3_column_type (stmt, 3) == SQLITE_FLOAT)
-		    ctx->rtree_maxy = sqlite3_column_double (stmt, 3);
-	    }
-	  else
-	    {
-		return 0;
-		break;
+		sqlite3_int64 *new_set;
+		max = (max == 0) ? 1024 : max * 2;
+		new_set = realloc (set, sizeof (sqlite3_int64) * max);
+		if (new_set == NULL)
+		  {
+		      free (set);
+		      return 0;
+		  }
+		set = new_set;
 	    }
+	  set[n++] = sqlite3_value_int64 (value);
       }
+    if (ret != SQLITE_OK && ret != SQLITE_DONE)
+      {
+	  free (set);
+	  return 0;
+      }
+    if (n > 1)
+	qsort (set, n, sizeof (sqlite3_int64), vknn_cmp_rowids);
+    *rowid_set = set;
+    *count = n;
     return 1;
 }
+#endif
 
 static int
-vknn_rtree_query (VKnnContextPtr ctx)
+vknn_best_first (VKnnContextPtr ctx)
 {
-/* Querying the RTree - Intersections */
-    int err = 0;
-    int count = 0;
-    int ret;
-    sqlite3_stmt *stmt;
-    if (ctx == NULL)
-	return 0;
-    if (ctx->stmt_rtree == NULL)
-	return 0;
-    stmt = ctx->stmt_rtree;
-    sqlite3_reset (stmt);
-    sqlite3_clear_bindings (stmt);
-    sqlite3_bind_double (stmt, 1, ctx->rtree_maxx);
-    sqlite3_bind_double (stmt, 2, ctx->rtree_minx);
-    sqlite3_bind_double (stmt, 3, ctx->rtree_maxy);
-    sqlite3_bind_double (stmt, 4, ctx->rtree_miny);
-    while (1)
+/*
+/ best-first traversal of the R*Tree: returns the number of
+/ nearest Features found, or -1 on failure
+*/
+    VKnnQueueItem item;
+    ctx->queue_count = 0;
+    ctx->curr_items = 0;
+    if (!vknn_queue_push (ctx, 1, 0.0, VKNN_NODE, -1))
+	return -1;
+    while (ctx->queue_count > 0 && ctx->curr_items < ctx->max_items)
       {
-	  /* scrolling the result set rows */
-	  ret = sqlite3_step (stmt);
-	  if (ret == SQLITE_DONE)
-	      break;		/* end of result set */
-	  if (ret == SQLITE_ROW)
+	  vknn_queue_pop (ctx, &item);
+	  if (item.type == VKNN_FEATURE)
+	    {
+		/* surely nearer than any other remaining entry */
+		VKnnItemPtr p = ctx->knn_array + ctx->curr_items;
+		p->rowid = item.id;
+		p->dist = item.dist;
+		ctx->curr_items += 1;
+	    }
+	  else if (item.type == VKNN_LEAF)
 	    {
+		/* refining a Leaf candidate by its exact distance */
 		double dist;
-		sqlite3_int64 rowid = sqlite3_column_int64 (stmt, 0);
-		dist = vknn_compute_distance (ctx, rowid);
-		vknn_update_items (ctx, rowid, dist);
-		count++;
+		if (ctx->rowid_set != NULL
+		    && bsearch (&(item.id), ctx->rowid_set,
+				ctx->rowid_set_count, sizeof (sqlite3_int64),
+				vknn_cmp_rowids) == NULL)
+		    continue;	/* not belonging to the ROWID IN-set */
+		dist = vknn_compute_distance (ctx, item.id);
+		if (dist == DBL_MAX)
+		    continue;	/* NULL Geometry or not matching the filter */
+		if (!vknn_queue_push (ctx, item.id, dist, VKNN_FEATURE, 0))
+		    return -1;
 	    }
 	  else
 	    {
-		err = 1;
-		break;
+		/* expanding an internal node */
+		if (!vknn_expand_node (ctx, item.id, item.level))
+		    return -1;
 	    }
       }
-    if (err)
-	return -1;
-    return count;
+    return ctx->curr_items;
 }
 
 static int
-vknn_query_callback (sqlite3_rtree_query_info * info)
+vknn_check_filter (const char *filter)
 {
-/* R*Tree Query Callback function */
-    double rtree_minx;
-    double rtree_maxx;
-    double rtree_miny;
-    double rtree_maxy;
-    double dist;
-    int mode;
-    VKnnContextPtr ctx = (VKnnContextPtr) (info->pContext);
-    if (info->nCoord != 4)
-      {
-	  /* invalid RTree */
-	  info->eWithin = NOT_WITHIN;
-	  return SQLITE_OK;
-      }
-
-/* fetching the node's BBOX */
-    rtree_minx = info->aCoord[0];
-    rtree_maxx = info->aCoord[1];
-    rtree_miny = info->aCoord[2];
-    rtree_maxy = info->aCoord[3];
-    if (info->iLevel > ctx->current_level)
-      {
-	  mode =
-	      vknn_check_mbr (ctx, rtree_minx, rtree_miny, rtree_maxx,
-			      rtree_maxy);
-	  if (mode == FULLY_WITHIN || mode == PARTLY_WITHIN)
-	    {
-		/* overlaps the current reference frame; to be further expanded */
-		info->eWithin = FULLY_WITHIN;
-	    }
-	  else
-	      info->eWithin = NOT_WITHIN;
-      }
-    else
+/*
+/ checking that the filter expression keeps its parentheses balanced
+/ at the top level, so that it can never escape the enclosing "( )"
+/ (string literals, quoted identifiers and comments are skipped)
+*/
+    const char *p = filter;
+    int depth = 0;
+    char quote;
+    while (*p != '\0')
       {
-	  dist =
-	      vknn_rect_distance (ctx, rtree_minx, rtree_miny, rtree_maxx,
-				  rtree_maxy);
-	  if (dist < ctx->min_dist)
+	  switch (*p)
 	    {
-		ctx->minx = rtree_minx;
-		ctx->miny = rtree_miny;
-		ctx->maxx = rtree_maxx;
-		ctx->maxy = rtree_maxy;
-		ctx->min_dist = dist;
-		ctx->level = info->iLevel;
-	    }
-	  info->eWithin = NOT_WITHIN;
+	    case '\'':
+	    case '"':
+	    case '`':
+	    case '[':
+		quote = (*p == '[') ? ']' : *p;
+		p++;
+		while (1)
+		  {
+		      if (*p == '\0')
+			  return 0;	/* unterminated */
+		      if (*p == quote)
+			{
+			    if (quote != ']' && *(p + 1) == quote)
+			      {
+				  /* an escaped quote */
+				  p += 2;
+				  continue;
+			      }
+			    break;
+			}
+		      p++;
+		  }
+		break;
+	    case '-':
+		if (*(p + 1) == '-')
+		  {
+		      while (*p != '\0' && *p != '\n')
+			  p++;
+		      continue;
+		  }
+		break;
+	    case '/':
+		if (*(p + 1) == '*')
+		  {
+		      p += 2;
+		      while (*p != '\0' && !(*p == '*' && *(p + 1) == '/'))
+			  p++;
+		      if (*p == '\0')
+			  return 0;	/* unterminated */
+		      p++;
+		  }
+		break;
+	    case '(':
+		depth++;
+		break;
+	    case ')':
+		depth--;
+		if (depth < 0)
+		    return 0;	/* closing the enclosing parenthesis */
+		break;
+	    };
+	  p++;
       }
-    return SQLITE_OK;
+    return (depth == 0) ? 1 : 0;
 }
 
 static int
@@ -1273,151 +1447,116 @@ vknn_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
     gaiaGeomCollPtr geom = NULL;
     int ok_table = 0;
     int ok_geom = 0;
-    int ok_max = 0;
     int max_items = 3;
     int is_geographic;
     const unsigned char *blob;
     int size;
     int exists;
     int ret;
-    double radius;
-    double dist;
-    sqlite3_stmt *stmt = NULL;
+    int err = SQLITE_OK;
+    char *quoted_db = NULL;
+    const char *filter = NULL;
+    char *where;
+    const char *tail;
+    sqlite3_int64 *rowid_set = NULL;
+    int rowid_set_count = 0;
+    int expected;
+    int arg = 0;
     sqlite3_stmt *stmt_dist = NULL;
-    sqlite3_stmt *stmt_map_dist = NULL;
-    sqlite3_stmt *stmt_rect_dist = NULL;
-    sqlite3_stmt *stmt_pt_dist = NULL;
-    sqlite3_stmt *stmt_buffer = NULL;
-    sqlite3_stmt *stmt_rtree = NULL;
-    sqlite3_stmt *stmt_rtree_count = NULL;
+    sqlite3_stmt *stmt_node = NULL;
     VirtualKnnCursorPtr cursor = (VirtualKnnCursorPtr) pCursor;
     VirtualKnnPtr knn = (VirtualKnnPtr) cursor->pVtab;
     VKnnContextPtr vknn_context = knn->knn_ctx;
     if (idxStr)
 	idxStr = idxStr;	/* unused arg warning suppression */
     cursor->eof = 1;
-    if (idxStr)
-	idxStr = idxStr;	/* unused arg warning suppression */
-    cursor->eof = 1;
-    if (idxNum == 1 && argc == 3)
+    if (!(idxNum & VKNN_IDX_VALID))
+	goto stop;
+    expected = 2;
+    if (idxNum & VKNN_IDX_COLUMN)
+	expected++;
+    if (idxNum & VKNN_IDX_MAX)
+	expected++;
+    if (idxNum & VKNN_IDX_FILTER)
+	expected++;
+    if (idxNum & VKNN_IDX_ROWIDS)
+	expected++;
+    if (argc != expected)
+	goto stop;
+
+/* retrieving the params: always passed in the same order */
+    if (sqlite3_value_type (argv[arg]) == SQLITE_TEXT)
       {
-	  /* retrieving the Table/Column/Geometry params */
-	  if (sqlite3_value_type (argv[0]) == SQLITE_TEXT)
-	    {
-		char *tn = (char *) sqlite3_value_text (argv[0]);
-		vknn_parse_table_name (tn, &db_prefix, &table_name);
-		ok_table = 1;
-	    }
-	  if (sqlite3_value_type (argv[1]) == SQLITE_TEXT)
+	  char *tn = (char *) sqlite3_value_text (argv[arg]);
+	  vknn_parse_table_name (tn, &db_prefix, &table_name);
+	  ok_table = 1;
+      }
+    arg++;
+    if (idxNum & VKNN_IDX_COLUMN)
+      {
+	  if (sqlite3_value_type (argv[arg]) == SQLITE_TEXT)
 	    {
-		geom_column = (char *) sqlite3_value_text (argv[1]);
+		geom_column = (char *) sqlite3_value_text (argv[arg]);
 		ok_geom = 1;
 	    }
-	  if (sqlite3_value_type (argv[2]) == SQLITE_BLOB)
-	    {
-		blob = sqlite3_value_blob (argv[2]);
-		size = sqlite3_value_bytes (argv[2]);
-		geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
-	    }
-	  if (ok_table && ok_geom && geom)
-	      ;
 	  else
-	    {
-		/* invalid args */
-		goto stop;
-	    }
+	      goto stop;
+	  arg++;
       }
-    if (idxNum == 2 && argc == 2)
+    if (sqlite3_value_type (argv[arg]) == SQLITE_BLOB)
       {
-	  /* retrieving the Table/Geometry params */
-	  if (sqlite3_value_type (argv[0]) == SQLITE_TEXT)
-	    {
-		char *tn = (char *) sqlite3_value_text (argv[0]);
-		vknn_parse_table_name (tn, &db_prefix, &table_name);
-		ok_table = 1;
-	    }
-	  if (sqlite3_value_type (argv[1]) == SQLITE_BLOB)
-	    {
-		blob = sqlite3_value_blob (argv[1]);
-		size = sqlite3_value_bytes (argv[1]);
-		geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
-	    }
-	  if (ok_table && geom)
-	      ;
-	  else
-	    {
-		/* invalid args */
-		goto stop;
-	    }
+	  blob = sqlite3_value_blob (argv[arg]);
+	  size = sqlite3_value_bytes (argv[arg]);
+	  geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
       }
-    if (idxNum == 3 && argc == 4)
+    arg++;
+    if (idxNum & VKNN_IDX_MAX)
       {
-	  /* retrieving the Table/Column/Geometry/MaxItems params */
-	  if (sqlite3_value_type (argv[0]) == SQLITE_TEXT)
-	    {
-		char *tn = (char *) sqlite3_value_text (argv[0]);
-		vknn_parse_table_name (tn, &db_prefix, &table_name);
-		ok_table = 1;
-	    }
-	  if (sqlite3_value_type (argv[1]) == SQLITE_TEXT)
-	    {
-		geom_column = (char *) sqlite3_value_text (argv[1]);
-		ok_geom = 1;
-	    }
-	  if (sqlite3_value_type (argv[2]) == SQLITE_BLOB)
-	    {
-		blob = sqlite3_value_blob (argv[2]);
-		size = sqlite3_value_bytes (argv[2]);
-		geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
-	    }
-	  if (sqlite3_value_type (argv[3]) == SQLITE_INTEGER)
+	  if (sqlite3_value_type (argv[arg]) == SQLITE_INTEGER)
 	    {
-		max_items = sqlite3_value_int (argv[3]);
+		max_items = sqlite3_value_int (argv[arg]);
 		if (max_items > 1024)
 		    max_items = 1024;
 		if (max_items < 1)
 		    max_items = 1;
-		ok_max = 1;
 	    }
-	  if (ok_table && ok_geom && geom && ok_max)
-	      ;
 	  else
-	    {
-		/* invalid args */
-		goto stop;
-	    }
+	      goto stop;
+	  arg++;
       }
-    if (idxNum == 4 && argc == 3)
+    if (idxNum & VKNN_IDX_FILTER)
       {
-	  /* retrieving the Table/Geometry/MaxItems params */
-	  if (sqlite3_value_type (argv[0]) == SQLITE_TEXT)
-	    {
-		char *tn = (char *) sqlite3_value_text (argv[0]);
-		vknn_parse_table_name (tn, &db_prefix, &table_name);
-		ok_table = 1;
-	    }
-	  if (sqlite3_value_type (argv[1]) == SQLITE_BLOB)
-	    {
-		blob = sqlite3_value_blob (argv[1]);
-		size = sqlite3_value_bytes (argv[1]);
-		geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
-	    }
-	  if (sqlite3_value_type (argv[2]) == SQLITE_INTEGER)
-	    {
-		max_items = sqlite3_value_int (argv[2]);
-		if (max_items > 1024)
-		    max_items = 1024;
-		if (max_items < 1)
-		    max_items = 1;
-		ok_max = 1;
-	    }
-	  if (ok_table && geom && ok_max)
-	      ;
+	  if (sqlite3_value_type (argv[arg]) == SQLITE_TEXT)
+	      filter = (const char *) sqlite3_value_text (argv[arg]);
 	  else
-	    {
-		/* invalid args */
-		goto stop;
-	    }
+	      goto stop;
+	  arg++;
+      }
+#if SQLITE_VERSION_NUMBER >= 3038000
+    if (idxNum & VKNN_IDX_ROWIDS)
+      {
+	  if (!vknn_load_rowid_set
+	      (argv[arg], &rowid_set, &rowid_set_count))
+	      goto stop;
+	  if (rowid_set_count == 0)
+	      goto stop;	/* an empty IN-set */
+	  arg++;
+      }
+#endif
+    if (!ok_table || geom == NULL)
+      {
+	  /* invalid args */
+	  goto stop;
+      }
+    if (filter != NULL && !vknn_check_filter (filter))
+      {
+	  sqlite3_free (knn->zErrMsg);
+	  knn->zErrMsg =
+	      sqlite3_mprintf
+	      ("VirtualKNN: invalid filter \"%s\": unbalanced parentheses",
+	       filter);
+	  err = SQLITE_ERROR;
+	  goto stop;
       }
 
 /* checking if the corresponding R*Tree exists */
@@ -1435,215 +1574,76 @@ vknn_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 /* building the Distance query */
     xgeomQ = gaiaDoubleQuotedSql (xgeom);
     xtableQ = gaiaDoubleQuotedSql (xtable);
+    if (db_prefix == NULL)
+	quoted_db = gaiaDoubleQuotedSql ("main");
+    else
+	quoted_db = gaiaDoubleQuotedSql (db_prefix);
+    if (filter != NULL)
+	where = sqlite3_mprintf ("rowid = ? AND (%s\n)", filter);
+    else
+	where = sqlite3_mprintf ("rowid = ?");
     if (is_geographic)
 	sql_statement =
 	    sqlite3_mprintf
-	    ("SELECT ST_Distance(?, \"%s\", 1) FROM \"%s\" WHERE rowid = ?",
-	     xgeomQ, xtableQ);
+	    ("SELECT ST_Distance(?, \"%s\", 1) FROM \"%s\".\"%s\" WHERE %s",
+	     xgeomQ, quoted_db, xtableQ, where);
     else
 	sql_statement =
 	    sqlite3_mprintf
-	    ("SELECT ST_Distance(?, \"%s\") FROM \"%s\" WHERE rowid = ?",
-	     xgeomQ, xtableQ);
-    free (xgeomQ);
-    free (xtableQ);
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_dist, NULL);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the Distance query - map units */
-    xgeomQ = gaiaDoubleQuotedSql (xgeom);
-    xtableQ = gaiaDoubleQuotedSql (xtable);
-    sql_statement =
-	sqlite3_mprintf
-	("SELECT ST_Distance(?, \"%s\") FROM \"%s\" WHERE rowid = ?",
-	 xgeomQ, xtableQ);
+	    ("SELECT ST_Distance(?, \"%s\") FROM \"%s\".\"%s\" WHERE %s",
+	     xgeomQ, quoted_db, xtableQ, where);
     free (xgeomQ);
     free (xtableQ);
+    sqlite3_free (where);
     ret =
 	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_map_dist, NULL);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the Distance query - RTree MBR */
-    sql_statement = "SELECT ST_Distance(?, BuildMbr(?, ?, ?, ?))";
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_rect_dist, NULL);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the Distance query - Point */
-    sql_statement = "SELECT ST_Distance(?, MakePoint(?, ?))";
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_pt_dist, NULL);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the Buffer query */
-    sql_statement =
-	"SELECT MbrMinX(x.g), MbrMinY(x.g), MbrMaxX(x.g), MbrMaxY(x.g) "
-	"FROM (SELECT ST_Buffer(ST_Envelope(?), ?) AS g) AS x";
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_buffer, NULL);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the RTree query - Intersects */
-    idx_name = sqlite3_mprintf ("idx_%s_%s", xtable, xgeom);
-    idx_nameQ = gaiaDoubleQuotedSql (idx_name);
-    if (db_prefix == NULL)
-      {
-	  sql_statement =
-	      sqlite3_mprintf
-	      ("SELECT pkid FROM main.\"%s\" WHERE xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?",
-	       idx_nameQ);
-      }
-    else
+			    &stmt_dist, &tail);
+    if (ret == SQLITE_OK && *tail != '\0')
       {
-	  char *quoted_db = gaiaDoubleQuotedSql (db_prefix);
-	  sql_statement =
-	      sqlite3_mprintf
-	      ("SELECT pkid FROM \"%s\".\"%s\" WHERE xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?",
-	       quoted_db, idx_nameQ);
-	  free (quoted_db);
+	  /* the filter expression smuggles a further SQL statement */
+	  ret = SQLITE_ERROR;
       }
-    free (idx_nameQ);
-    sqlite3_free (idx_name);
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_rtree, NULL);
     sqlite3_free (sql_statement);
     if (ret != SQLITE_OK)
-	goto stop;
-
-/* building the RTree query - count items */
-    idx_name = sqlite3_mprintf ("idx_%s_%s", xtable, xgeom);
-    idx_nameQ = gaiaDoubleQuotedSql (idx_name);
-    if (db_prefix == NULL)
       {
-	  sql_statement =
-	      sqlite3_mprintf ("SELECT pkid FROM \"%s\" LIMIT 1024", idx_nameQ);
-      }
-    else
-      {
-	  char *quoted_db = gaiaDoubleQuotedSql (db_prefix);
-	  sql_statement =
-	      sqlite3_mprintf ("SELECT pkid FROM \"%s\".\"%s\" LIMIT 1024",
-			       quoted_db, idx_nameQ);
-	  free (quoted_db);
+	  if (filter != NULL)
+	    {
+		sqlite3_free (knn->zErrMsg);
+		knn->zErrMsg =
+		    sqlite3_mprintf ("VirtualKNN: invalid filter \"%s\": %s",
+				     filter, sqlite3_errmsg (knn->db));
+		err = SQLITE_ERROR;
+	    }
+	  goto stop;
       }
-    sqlite3_free (idx_name);
+
+/* building the R*Tree Node query */
+    idx_name = sqlite3_mprintf ("idx_%s_%s_node", xtable, xgeom);
+    idx_nameQ = gaiaDoubleQuotedSql (idx_name);
+    sql_statement =
+	sqlite3_mprintf ("SELECT data FROM \"%s\".\"%s\" WHERE nodeno = ?",
+			 quoted_db, idx_nameQ);
     free (idx_nameQ);
+    sqlite3_free (idx_name);
     ret =
 	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt_rtree_count, NULL);
+			    &stmt_node, NULL);
     sqlite3_free (sql_statement);
     if (ret != SQLITE_OK)
 	goto stop;
 
-/* installing the R*Tree query callback */
+/* exploring the R*Tree */
     gaiaMbrGeometry (geom);
     vknn_init_context (vknn_context, xtable, xgeom, geom, max_items,
-		       stmt_dist, stmt_map_dist, stmt_rect_dist, stmt_pt_dist,
-		       stmt_buffer, stmt_rtree, stmt_rtree_count);
+		       is_geographic, stmt_dist, stmt_node, filter, rowid_set,
+		       rowid_set_count);
     gaiaFreeGeomColl (geom);
     geom = NULL;		/* releasing ownership on geom */
+    rowid_set = NULL;		/* releasing ownership on rowid_set */
     stmt_dist = NULL;		/* releasing ownership on stmt_dist */
-    stmt_map_dist = NULL;	/* releasing ownership on stmt_map_dist */
-    stmt_rect_dist = NULL;	/* releasing ownership on stmt_rect */
-    stmt_pt_dist = NULL;	/* releasing ownership on stmt_point */
-    stmt_buffer = NULL;		/* releasing ownership on stmt_buffer */
-    stmt_rtree = NULL;		/* releasing ownership on stmt_rtree */
-    stmt_rtree_count = NULL;	/* releasing ownership on stmt_rtree_count */
-    sqlite3_rtree_query_callback (knn->db, "knn_position", vknn_query_callback,
-				  vknn_context, NULL);
-
-/* building the RTree query - callback */
-    idx_name = sqlite3_mprintf ("idx_%s_%s", xtable, xgeom);
-    idx_nameQ = gaiaDoubleQuotedSql (idx_name);
-    if (db_prefix == NULL)
-      {
-	  sql_statement =
-	      sqlite3_mprintf
-	      ("SELECT pkid FROM main.\"%s\" WHERE pkid MATCH knn_position(1)",
-	       idx_nameQ);
-      }
-    else
-      {
-	  char *quoted_db = gaiaDoubleQuotedSql (db_prefix);
-	  sql_statement =
-	      sqlite3_mprintf
-	      ("SELECT pkid FROM \"%s\".\"%s\" WHERE pkid MATCH knn_position(1)",
-	       quoted_db, idx_nameQ);
-	  free (quoted_db);
-      }
-    free (idx_nameQ);
-    sqlite3_free (idx_name);
-    ret =
-	sqlite3_prepare_v2 (knn->db, sql_statement, strlen (sql_statement),
-			    &stmt, NULL);
-    sqlite3_free (sql_statement);
-    if (ret != SQLITE_OK)
-	goto stop;
-
-    vknn_context->bbox_minx = -DBL_MAX;
-    vknn_context->bbox_miny = -DBL_MAX;
-    vknn_context->bbox_maxx = DBL_MAX;
-    vknn_context->bbox_maxy = DBL_MAX;
-    vknn_context->current_level = 1024;
-    while (1)
-      {
-	  /* repeatedly querying the R*Tree until finding the nearest BBOX */
-	  vknn_context->minx = DBL_MAX;
-	  vknn_context->miny = DBL_MAX;
-	  vknn_context->maxx = -DBL_MAX;
-	  vknn_context->maxy = -DBL_MAX;
-	  vknn_context->min_dist = DBL_MAX;
-	  sqlite3_step (stmt);
-	  vknn_context->bbox_minx = vknn_context->minx;
-	  vknn_context->bbox_miny = vknn_context->miny;
-	  vknn_context->bbox_maxx = vknn_context->maxx;
-	  vknn_context->bbox_maxy = vknn_context->maxy;
-	  if (vknn_context->level <= 1)
-	      break;
-	  vknn_context->current_level = vknn_context->level - 1;
-      }
-    radius =
-	vknn_pt_distance (vknn_context, vknn_context->bbox_minx,
-			  vknn_context->bbox_miny);
-    dist =
-	vknn_pt_distance (vknn_context, vknn_context->bbox_minx,
-			  vknn_context->bbox_maxy);
-    if (dist > radius)
-	radius = dist;
-    dist =
-	vknn_pt_distance (vknn_context, vknn_context->bbox_maxx,
-			  vknn_context->bbox_miny);
-    if (dist > radius)
-	radius = dist;
-    dist =
-	vknn_pt_distance (vknn_context, vknn_context->bbox_maxx,
-			  vknn_context->bbox_maxy);
-    if (dist > radius)
-	radius = dist;
-
-    while (1)
-      {
-	  if (!vknn_bufferize (vknn_context, radius))
-	      break;
-	  ret = vknn_rtree_query (vknn_context);
-	  if (ret <= 0 || ret >= max_items || ret >= vknn_context->rtree_count)
-	      break;
-	  radius *= 1.05;
-      }
+    stmt_node = NULL;		/* releasing ownership on stmt_node */
+    if (vknn_best_first (vknn_context) <= 0)
+	vknn_context->curr_items = 0;
 
     if (vknn_context->curr_items == 0)
 	cursor->eof = 1;
@@ -1661,23 +1661,15 @@ vknn_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 	free (db_prefix);
     if (table_name)
 	free (table_name);
-    if (stmt != NULL)
-	sqlite3_finalize (stmt);
+    if (quoted_db)
+	free (quoted_db);
     if (stmt_dist != NULL)
 	sqlite3_finalize (stmt_dist);
-    if (stmt_map_dist != NULL)
-	sqlite3_finalize (stmt_map_dist);
-    if (stmt_rect_dist != NULL)
-	sqlite3_finalize (stmt_rect_dist);
-    if (stmt_pt_dist != NULL)
-	sqlite3_finalize (stmt_pt_dist);
-    if (stmt_buffer != NULL)
-	sqlite3_finalize (stmt_buffer);
-    if (stmt_rtree != NULL)
-	sqlite3_finalize (stmt_rtree);
-    if (stmt_rtree_count != NULL)
-	sqlite3_finalize (stmt_rtree_count);
-    return SQLITE_OK;
+    if (stmt_node != NULL)
+	sqlite3_finalize (stmt_node);
+    if (rowid_set != NULL)
+	free (rowid_set);
+    return err;
 }
 
 static int
@@ -1757,6 +1749,12 @@ vknn_column (sqlite3_vtab_cursor * pCursor, sqlite3_context * pContext,
 	  else
 	      sqlite3_result_null (pContext);
       }
+    else if (column == 7 && ctx->filter != NULL)
+      {
+	  /* the Filter column */
+	  sqlite3_result_text (pContext, ctx->filter, strlen (ctx->filter),
+			       SQLITE_STATIC);
+      }
     else
 	sqlite3_result_null (pContext);
     return SQLITE_OK;
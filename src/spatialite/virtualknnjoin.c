@@ -0,0 +1,2070 @@
+/*
+
+ virtualknnjoin.c -- SQLite3 extension [VIRTUAL TABLE KNN Join]
+
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ -----------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#ifndef OMIT_GEOS		/* GEOS is supported */
+#ifndef OMIT_KNN		/* only if KNN is enabled */
+
+#include <spatialite/sqlite.h>
+
+#include <spatialite/spatialite_ext.h>
+#include <spatialite/gaiaaux.h>
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite_private.h>
+
+#ifdef _WIN32
+#define strcasecmp	_stricmp
+#define strncasecmp	_strnicmp
+#endif /* not WIN32 */
+
+/*
+
+IMPORTANT NOTE: how the KNN Join works
+
+all the Geometries of the first table (the "probes") are sorted along
+a Hilbert curve, so that consecutive probes are spatially close, and
+are then processed in batches.
+
+each batch is split into small groups of consecutive probes; the
+R*Tree of the second table is explored best-first from the BBOX
+enclosing a whole group (node BLOBs are directly read from the
+"idx_<table>_<geom>_node" shadow table, see rtree_bulk.c for their
+layout).  for every Leaf cell the farthest possible distance from the
+group's BBOX is an upper bound of the distance of that feature from
+any probe in the group, so the K-th smallest of them is a search radius
+surely enclosing the K nearest features of every probe: all Leaf cells
+whose nearest possible distance is within this radius are the group's
+candidates, and the traversal stops as soon as the radius is reached.
+
+each distinct candidate Geometry is then fetched and parsed just once
+per batch (and retained for the next batch if still needed), and the
+probes are finally refined in parallel on SetMaxThreads() workers: each
+probe only computes the exact distance from its group's candidates,
+in ascending order of their BBOX distance, until K nearest features
+are found.
+
+for Geographic SRIDs distances are measured in meters exactly as
+ST_Distance(a, b, 1) does; the BBOX distances are then conservatively
+estimated on two spheres respectively smaller and larger than any
+Earth's ellipsoid.
+
+*/
+
+#define VKNNJ_CELL		24
+#define VKNNJ_HEADER		4
+#define VKNNJ_MAX_DEPTH		40
+#define VKNNJ_NODE_CACHE	256	/* cached nodes of the R*Tree */
+#define VKNNJ_GROUP		64	/* probes sharing the same candidates */
+#define VKNNJ_BATCH		4096	/* max probes in a batch */
+#define VKNNJ_BATCH_ITEMS	262144	/* max result items in a batch */
+#define VKNNJ_SLICE		32	/* min probes per worker thread */
+#define VKNNJ_NODE		0	/* queue entry: an R*Tree node */
+#define VKNNJ_LEAF		1	/* queue entry: a Leaf cell */
+#define VKNNJ_MIN_RADIUS	6300000.0	/* meters, less than any b^2/a */
+#define VKNNJ_MAX_RADIUS	6410000.0	/* meters, more than any a^2/b */
+#define VKNNJ_DEG2RAD		(3.14159265358979323846 / 180.0)
+
+static struct sqlite3_module my_knnjoin_module;
+
+struct vknnj_cell
+{
+/* an R*Tree cell: a rowid (leaves) or a child node (internal nodes) */
+    sqlite3_int64 id;
+    float minx;
+    float maxx;
+    float miny;
+    float maxy;
+};
+
+struct vknnj_node
+{
+/* a cached R*Tree node */
+    sqlite3_int64 nodeno;	/* 0 if the slot is unused */
+    struct vknnj_cell *cells;
+    int count;
+    int max_count;
+};
+
+struct vknnj_table
+{
+/* one of the two joined tables */
+    char *db_prefix;
+    char *table;
+    char *geometry;
+    int srid;
+    sqlite3_stmt *stmt_node;	/* only for the second table */
+    sqlite3_stmt *stmt_geom;
+    int depth;			/* depth of the root node */
+    struct vknnj_node cache[VKNNJ_NODE_CACHE];
+};
+
+struct vknnj_probe
+{
+/* a Geometry of the first table, to be sorted along the Hilbert curve */
+    sqlite3_int64 rowid;
+    union
+    {
+	float center[2];	/* while scanning the table */
+	unsigned int key;	/* once the whole extent is known */
+    } pos;
+};
+
+struct vknnj_ref
+{
+/* a probe of the current batch */
+    sqlite3_int64 rowid;
+    gaiaGeomCollPtr geom;
+    int group;
+};
+
+struct vknnj_group
+{
+/* a group of consecutive probes and their candidates */
+    int first;
+    int count;
+};
+
+struct vknnj_candidate
+{
+/* a candidate feature of the second table */
+    sqlite3_int64 rowid;
+    float minx;
+    float maxx;
+    float miny;
+    float maxy;
+    int feature;		/* index of the parsed Geometry */
+};
+
+struct vknnj_feature
+{
+/* a parsed Geometry of the second table */
+    sqlite3_int64 rowid;
+    gaiaGeomCollPtr geom;
+};
+
+struct vknnj_queue_item
+{
+/* an entry into the best-first priority queue */
+    struct vknnj_cell cell;
+    double dist;		/* lower bound of the distance */
+    int type;			/* VKNNJ_NODE or VKNNJ_LEAF */
+    int level;			/* R*Tree level of the node */
+};
+
+struct vknnj_item
+{
+/* one of the K nearest features of a probe */
+    sqlite3_int64 rowid;
+    double dist;
+};
+
+struct vknnj_sort
+{
+/* a candidate sorted by its BBOX distance */
+    double dist;
+    int index;
+};
+
+struct vknnj_worker
+{
+/* a slice of the probes, refined by a single thread */
+    const void *cache;		/* owning the GEOS handle */
+    int is_geographic;
+    double a;
+    double b;
+    double rf;
+    int max_items;
+    struct vknnj_ref *refs;
+    int first;
+    int count;
+    struct vknnj_group *groups;
+    struct vknnj_candidate *cands;
+    struct vknnj_feature *features;
+    struct vknnj_item *items;
+    int *counts;
+    struct vknnj_sort *sort;
+    int max_sort;
+    void *thread;
+};
+
+/******************************************************************************
+/
+/ VirtualTable structs
+/
+******************************************************************************/
+
+typedef struct VirtualKnnJoinStruct
+{
+/* extends the sqlite3_vtab struct */
+    const sqlite3_module *pModule;	/* ptr to sqlite module: USED INTERNALLY BY SQLITE */
+    int nRef;			/* # references: USED INTERNALLY BY SQLITE */
+    char *zErrMsg;		/* error message: USE INTERNALLY BY SQLITE */
+    sqlite3 *db;		/* the sqlite db holding the virtual table */
+    const void *p_cache;	/* pointer to the internal cache */
+} VirtualKnnJoin;
+typedef VirtualKnnJoin *VirtualKnnJoinPtr;
+
+typedef struct VirtualKnnJoinCursorStruct
+{
+/* extends the sqlite3_vtab_cursor struct */
+    VirtualKnnJoinPtr pVtab;	/* Virtual table of this cursor */
+    int eof;			/* the EOF marker */
+    char *table_a;
+    char *table_b;
+    int max_items;
+    int is_geographic;
+    double a;			/* ellipsoid params (Geographic SRIDs) */
+    double b;
+    double rf;
+    struct vknnj_table tab_a;
+    struct vknnj_table tab_b;
+    struct vknnj_probe *probes;	/* all probes, in Hilbert order */
+    int n_probes;
+    int next_probe;
+    struct vknnj_ref *refs;	/* the probes of the current batch */
+    int n_refs;
+    int max_refs;
+    struct vknnj_group *groups;
+    int n_groups;
+    int max_groups;
+    struct vknnj_candidate *cands;
+    int n_cands;
+    int max_cands;
+    struct vknnj_feature *features;	/* sorted by rowid */
+    int n_features;
+    struct vknnj_queue_item *queue;
+    int queue_count;
+    int queue_max;
+    double *bounds;		/* max-heap of the K smallest upper bounds */
+    int n_bounds;
+    struct vknnj_item *items;	/* max_items slots for each probe */
+    int *counts;
+    int current_ref;
+    int current_item;
+    struct vknnj_worker *workers;
+    int n_workers;
+    sqlite3_int64 CurrentRowId;
+} VirtualKnnJoinCursor;
+typedef VirtualKnnJoinCursor *VirtualKnnJoinCursorPtr;
+
+static int
+vknnj_import16 (const unsigned char *p)
+{
+/* big-endian 16 bit int */
+    return (p[0] << 8) | p[1];
+}
+
+static float
+vknnj_import_float (const unsigned char *p)
+{
+/* big-endian 32 bit float */
+    unsigned int i;
+    float value;
+    i = ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+	((unsigned int) p[2] << 8) | (unsigned int) p[3];
+    memcpy (&value, &i, 4);
+    return value;
+}
+
+static void
+vknnj_import_cell (const unsigned char *p, struct vknnj_cell *cell)
+{
+/* decoding an R*Tree cell */
+    sqlite3_uint64 v = 0;
+    int i;
+    for (i = 0; i < 8; i++)
+	v = (v << 8) | p[i];
+    cell->id = (sqlite3_int64) v;
+    cell->minx = vknnj_import_float (p + 8);
+    cell->maxx = vknnj_import_float (p + 12);
+    cell->miny = vknnj_import_float (p + 16);
+    cell->maxy = vknnj_import_float (p + 20);
+}
+
+static void
+vknnj_parse_table_name (const char *tn, char **db_prefix, char **table_name)
+{
+/* attempting to extract an eventual DB prefix */
+    int i;
+    int len = strlen (tn);
+    int i_dot = -1;
+    if (strncasecmp (tn, "DB=", 3) == 0)
+      {
+	  int l_db;
+	  int l_tbl;
+	  for (i = 3; i < len; i++)
+	    {
+		if (tn[i] == '.')
+		  {
+		      i_dot = i;
+		      break;
+		  }
+	    }
+	  if (i_dot > 1)
+	    {
+		l_db = i_dot - 3;
+		l_tbl = len - (i_dot + 1);
+		*db_prefix = malloc (l_db + 1);
+		memset (*db_prefix, '\0', l_db + 1);
+		memcpy (*db_prefix, tn + 3, l_db);
+		*table_name = malloc (l_tbl + 1);
+		strcpy (*table_name, tn + i_dot + 1);
+		return;
+	    }
+      }
+    *table_name = malloc (len + 1);
+    strcpy (*table_name, tn);
+}
+
+static void
+vknnj_reset_table (struct vknnj_table *tbl)
+{
+/* resetting one of the joined tables */
+    int i;
+    if (tbl->db_prefix != NULL)
+	free (tbl->db_prefix);
+    if (tbl->table != NULL)
+	free (tbl->table);
+    if (tbl->geometry != NULL)
+	free (tbl->geometry);
+    if (tbl->stmt_node != NULL)
+	sqlite3_finalize (tbl->stmt_node);
+    if (tbl->stmt_geom != NULL)
+	sqlite3_finalize (tbl->stmt_geom);
+    for (i = 0; i < VKNNJ_NODE_CACHE; i++)
+      {
+	  if (tbl->cache[i].cells != NULL)
+	      free (tbl->cache[i].cells);
+      }
+    memset (tbl, 0, sizeof (struct vknnj_table));
+}
+
+static int
+vknnj_find_table (sqlite3 * sqlite, struct vknnj_table *tbl,
+		  const char *geom_column, int with_rtree)
+{
+/* checks if the required Geometry (and its R*Tree) is actually defined */
+    sqlite3_stmt *stmt;
+    char *sql_statement;
+    char *quoted_db;
+    int ret;
+    int count = 0;
+    char *rt = NULL;
+    char *rg = NULL;
+    int srid = 0;
+
+    quoted_db =
+	gaiaDoubleQuotedSql (tbl->db_prefix == NULL ? "main" : tbl->db_prefix);
+    if (geom_column == NULL)
+	sql_statement =
+	    sqlite3_mprintf
+	    ("SELECT f_table_name, f_geometry_column, srid "
+	     "FROM \"%s\".geometry_columns WHERE Upper(f_table_name) = Upper(%Q)%s",
+	     quoted_db, tbl->table,
+	     with_rtree ? " AND spatial_index_enabled = 1" : "");
+    else
+	sql_statement =
+	    sqlite3_mprintf
+	    ("SELECT f_table_name, f_geometry_column, srid "
+	     "FROM \"%s\".geometry_columns WHERE Upper(f_table_name) = Upper(%Q) "
+	     "AND Upper(f_geometry_column) = Upper(%Q)%s",
+	     quoted_db, tbl->table, geom_column,
+	     with_rtree ? " AND spatial_index_enabled = 1" : "");
+    free (quoted_db);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &stmt, NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    while (1)
+      {
+	  /* scrolling the result set rows */
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;		/* end of result set */
+	  if (ret == SQLITE_ROW)
+	    {
+		const char *v = (const char *) sqlite3_column_text (stmt, 0);
+		int len = sqlite3_column_bytes (stmt, 0);
+		if (rt)
+		    free (rt);
+		rt = malloc (len + 1);
+		strcpy (rt, v);
+		v = (const char *) sqlite3_column_text (stmt, 1);
+		len = sqlite3_column_bytes (stmt, 1);
+		if (rg)
+		    free (rg);
+		rg = malloc (len + 1);
+		strcpy (rg, v);
+		srid = sqlite3_column_int (stmt, 2);
+		count++;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    if (count != 1)
+      {
+	  /* not found, or ambiguous (more than a single Geometry column) */
+	  if (rg != NULL)
+	      free (rg);
+	  if (rt != NULL)
+	      free (rt);
+	  return 0;
+      }
+    free (tbl->table);
+    tbl->table = rt;
+    tbl->geometry = rg;
+    tbl->srid = srid;
+    return 1;
+}
+
+static int
+vknnj_prepare_table (sqlite3 * sqlite, struct vknnj_table *tbl,
+		     int with_rtree)
+{
+/* preparing the SQL statements accessing the R*Tree and the Geometries */
+    char *quoted_db;
+    char *idx_name;
+    char *xname;
+    char *xgeom;
+    char *sql_statement;
+    int ret;
+
+    quoted_db =
+	gaiaDoubleQuotedSql (tbl->db_prefix == NULL ? "main" : tbl->db_prefix);
+    if (with_rtree)
+      {
+	  idx_name =
+	      sqlite3_mprintf ("idx_%s_%s_node", tbl->table, tbl->geometry);
+	  xname = gaiaDoubleQuotedSql (idx_name);
+	  sqlite3_free (idx_name);
+	  sql_statement =
+	      sqlite3_mprintf
+	      ("SELECT data FROM \"%s\".\"%s\" WHERE nodeno = ?", quoted_db,
+	       xname);
+	  free (xname);
+	  ret =
+	      sqlite3_prepare_v2 (sqlite, sql_statement,
+				  strlen (sql_statement), &(tbl->stmt_node),
+				  NULL);
+	  sqlite3_free (sql_statement);
+	  if (ret != SQLITE_OK)
+	    {
+		free (quoted_db);
+		return 0;
+	    }
+      }
+
+    xname = gaiaDoubleQuotedSql (tbl->table);
+    xgeom = gaiaDoubleQuotedSql (tbl->geometry);
+    sql_statement =
+	sqlite3_mprintf ("SELECT \"%s\" FROM \"%s\".\"%s\" WHERE ROWID = ?",
+			 xgeom, quoted_db, xname);
+    free (xname);
+    free (xgeom);
+    free (quoted_db);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &(tbl->stmt_geom), NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    return 1;
+}
+
+static struct vknnj_node *
+vknnj_load_node (struct vknnj_table *tbl, sqlite3_int64 nodeno)
+{
+/* fetching an R*Tree node (possibly from the cache) */
+    struct vknnj_node *node =
+	tbl->cache + (int) (nodeno & (VKNNJ_NODE_CACHE - 1));
+    const unsigned char *blob;
+    int size;
+    int count;
+    int i;
+    int ret;
+    if (node->nodeno == nodeno)
+	return node;
+    node->nodeno = 0;
+    sqlite3_reset (tbl->stmt_node);
+    sqlite3_clear_bindings (tbl->stmt_node);
+    sqlite3_bind_int64 (tbl->stmt_node, 1, nodeno);
+    ret = sqlite3_step (tbl->stmt_node);
+    if (ret != SQLITE_ROW
+	|| sqlite3_column_type (tbl->stmt_node, 0) != SQLITE_BLOB)
+	return NULL;
+    blob = sqlite3_column_blob (tbl->stmt_node, 0);
+    size = sqlite3_column_bytes (tbl->stmt_node, 0);
+    if (size < VKNNJ_HEADER)
+	return NULL;
+    count = vknnj_import16 (blob + 2);
+    if (size < VKNNJ_HEADER + (count * VKNNJ_CELL))
+	return NULL;
+    if (nodeno == 1)
+	tbl->depth = vknnj_import16 (blob);
+    if (count > node->max_count)
+      {
+	  struct vknnj_cell *cells =
+	      realloc (node->cells, sizeof (struct vknnj_cell) * count);
+	  if (cells == NULL)
+	      return NULL;
+	  node->cells = cells;
+	  node->max_count = count;
+      }
+    for (i = 0; i < count; i++)
+	vknnj_import_cell (blob + VKNNJ_HEADER + (i * VKNNJ_CELL),
+			   node->cells + i);
+    sqlite3_reset (tbl->stmt_node);
+    node->count = count;
+    node->nodeno = nodeno;
+    return node;
+}
+
+static unsigned int
+vknnj_hilbert (unsigned int x, unsigned int y)
+{
+/* position of X,Y along a 65536 x 65536 Hilbert curve */
+    unsigned int n = 65536;
+    unsigned int s;
+    unsigned int rx;
+    unsigned int ry;
+    unsigned int t;
+    unsigned int d = 0;
+    for (s = n / 2; s > 0; s /= 2)
+      {
+	  rx = (x & s) > 0;
+	  ry = (y & s) > 0;
+	  d += s * s * ((3 * rx) ^ ry);
+	  if (ry == 0)
+	    {
+		if (rx == 1)
+		  {
+		      x = n - 1 - x;
+		      y = n - 1 - y;
+		  }
+		t = x;
+		x = y;
+		y = t;
+	    }
+      }
+    return d;
+}
+
+static int
+vknnj_cmp_probes (const void *p1, const void *p2)
+{
+/* sorting probes by Hilbert key, rowid */
+    const struct vknnj_probe *pr1 = (const struct vknnj_probe *) p1;
+    const struct vknnj_probe *pr2 = (const struct vknnj_probe *) p2;
+    if (pr1->pos.key < pr2->pos.key)
+	return -1;
+    if (pr1->pos.key > pr2->pos.key)
+	return 1;
+    if (pr1->rowid < pr2->rowid)
+	return -1;
+    if (pr1->rowid > pr2->rowid)
+	return 1;
+    return 0;
+}
+
+static int
+vknnj_load_probes (VirtualKnnJoinCursorPtr cursor)
+{
+/* loading all the probes of the first table, sorted along a Hilbert curve */
+    sqlite3 *sqlite = cursor->pVtab->db;
+    struct vknnj_table *tbl = &(cursor->tab_a);
+    sqlite3_stmt *stmt;
+    char *sql_statement;
+    char *quoted_db;
+    char *xname;
+    char *xgeom;
+    int ret;
+    int max_probes = 0;
+    int i;
+    double minx = DBL_MAX;
+    double miny = DBL_MAX;
+    double maxx = -DBL_MAX;
+    double maxy = -DBL_MAX;
+    double ext_x;
+    double ext_y;
+
+    quoted_db =
+	gaiaDoubleQuotedSql (tbl->db_prefix == NULL ? "main" : tbl->db_prefix);
+    xname = gaiaDoubleQuotedSql (tbl->table);
+    xgeom = gaiaDoubleQuotedSql (tbl->geometry);
+    sql_statement =
+	sqlite3_mprintf
+	("SELECT ROWID, MbrMinX(\"%s\"), MbrMinY(\"%s\"), MbrMaxX(\"%s\"), "
+	 "MbrMaxY(\"%s\") FROM \"%s\".\"%s\"", xgeom, xgeom, xgeom, xgeom,
+	 quoted_db, xname);
+    free (quoted_db);
+    free (xname);
+    free (xgeom);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &stmt, NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    while (1)
+      {
+	  /* scrolling the result set rows */
+	  struct vknnj_probe *probe;
+	  double cx;
+	  double cy;
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;		/* end of result set */
+	  if (ret != SQLITE_ROW)
+	    {
+		sqlite3_finalize (stmt);
+		return 0;
+	    }
+	  if (sqlite3_column_type (stmt, 1) != SQLITE_FLOAT
+	      || sqlite3_column_type (stmt, 2) != SQLITE_FLOAT
+	      || sqlite3_column_type (stmt, 3) != SQLITE_FLOAT
+	      || sqlite3_column_type (stmt, 4) != SQLITE_FLOAT)
+	      continue;		/* NULL or invalid Geometry */
+	  if (cursor->n_probes == max_probes)
+	    {
+		int new_max = (max_probes == 0) ? 65536 : max_probes * 2;
+		struct vknnj_probe *probes = realloc (cursor->probes,
+						      sizeof (struct
+							      vknnj_probe) *
+						      new_max);
+		if (probes == NULL)
+		  {
+		      sqlite3_finalize (stmt);
+		      return 0;
+		  }
+		cursor->probes = probes;
+		max_probes = new_max;
+	    }
+	  cx = (sqlite3_column_double (stmt, 1) +
+		sqlite3_column_double (stmt, 3)) / 2.0;
+	  cy = (sqlite3_column_double (stmt, 2) +
+		sqlite3_column_double (stmt, 4)) / 2.0;
+	  if (cx < minx)
+	      minx = cx;
+	  if (cx > maxx)
+	      maxx = cx;
+	  if (cy < miny)
+	      miny = cy;
+	  if (cy > maxy)
+	      maxy = cy;
+	  probe = cursor->probes + cursor->n_probes;
+	  probe->rowid = sqlite3_column_int64 (stmt, 0);
+	  probe->pos.center[0] = (float) cx;
+	  probe->pos.center[1] = (float) cy;
+	  cursor->n_probes++;
+      }
+    sqlite3_finalize (stmt);
+
+/* replacing each center by its Hilbert key */
+    ext_x = maxx - minx;
+    ext_y = maxy - miny;
+    for (i = 0; i < cursor->n_probes; i++)
+      {
+	  struct vknnj_probe *probe = cursor->probes + i;
+	  double cx = probe->pos.center[0];
+	  double cy = probe->pos.center[1];
+	  unsigned int x = 0;
+	  unsigned int y = 0;
+	  if (ext_x > 0.0)
+	      x = (unsigned int) (((cx - minx) / ext_x) * 65535.0);
+	  if (ext_y > 0.0)
+	      y = (unsigned int) (((cy - miny) / ext_y) * 65535.0);
+	  if (x > 65535)
+	      x = 65535;
+	  if (y > 65535)
+	      y = 65535;
+	  probe->pos.key = vknnj_hilbert (x, y);
+      }
+    qsort (cursor->probes, cursor->n_probes, sizeof (struct vknnj_probe),
+	   vknnj_cmp_probes);
+    return 1;
+}
+
+static double
+vknnj_min_distance (int is_geographic, double minx1, double miny1,
+		    double maxx1, double maxy1, double minx2, double miny2,
+		    double maxx2, double maxy2)
+{
+/* lower bound of the distance between any two points of two BBOXes */
+    double dx = 0.0;
+    double dy = 0.0;
+    if (maxx1 < minx2)
+	dx = minx2 - maxx1;
+    else if (minx1 > maxx2)
+	dx = minx1 - maxx2;
+    if (maxy1 < miny2)
+	dy = miny2 - maxy1;
+    else if (miny1 > maxy2)
+	dy = miny1 - maxy2;
+    if (is_geographic)
+      {
+	  /* spherical distance (a smaller sphere): meters */
+	  double wrap;
+	  double c1;
+	  double c2;
+	  double c;
+	  if (dx > 0.0)
+	    {
+		/* the gap could be shorter going around the antimeridian */
+		wrap =
+		    360.0 - (((maxx1 > maxx2) ? maxx1 : maxx2) -
+			     ((minx1 < minx2) ? minx1 : minx2));
+		if (wrap < dx)
+		    dx = (wrap > 0.0) ? wrap : 0.0;
+		if (dx > 180.0)
+		    dx = 180.0;
+	    }
+	  /* the parallels nearest to the Poles have the smallest cosine */
+	  c1 = cos (miny1 * VKNNJ_DEG2RAD);
+	  c = cos (maxy1 * VKNNJ_DEG2RAD);
+	  if (c < c1)
+	      c1 = c;
+	  c2 = cos (miny2 * VKNNJ_DEG2RAD);
+	  c = cos (maxy2 * VKNNJ_DEG2RAD);
+	  if (c < c2)
+	      c2 = c;
+	  if (c1 < 0.0)
+	      c1 = 0.0;
+	  if (c2 < 0.0)
+	      c2 = 0.0;
+	  c = cos (dy * VKNNJ_DEG2RAD) -
+	      (c1 * c2 * (1.0 - cos (dx * VKNNJ_DEG2RAD)));
+	  if (c > 1.0)
+	      c = 1.0;
+	  if (c < -1.0)
+	      c = -1.0;
+	  return acos (c) * VKNNJ_MIN_RADIUS;
+      }
+    return sqrt ((dx * dx) + (dy * dy));
+}
+
+static double
+vknnj_max_distance (int is_geographic, double minx1, double miny1,
+		    double maxx1, double maxy1, double minx2, double miny2,
+		    double maxx2, double maxy2)
+{
+/* upper bound of the distance between any two points of two BBOXes */
+    double dx = fabs (maxx2 - minx1);
+    double dy = fabs (maxy2 - miny1);
+    if (fabs (maxx1 - minx2) > dx)
+	dx = fabs (maxx1 - minx2);
+    if (fabs (maxy1 - miny2) > dy)
+	dy = fabs (maxy1 - miny2);
+    if (is_geographic)
+      {
+	  /* 
+	     / spherical length (a larger sphere) of a path first following
+	     / a meridian and then a parallel of the second BBOX: meters
+	   */
+	  double c = 1.0;
+	  double angle;
+	  if (miny2 > 0.0)
+	      c = cos (miny2 * VKNNJ_DEG2RAD);
+	  else if (maxy2 < 0.0)
+	      c = cos (maxy2 * VKNNJ_DEG2RAD);
+	  if (dx > 180.0)
+	      dx = 180.0;
+	  angle = (dy + (c * dx)) * VKNNJ_DEG2RAD;
+	  if (angle > 3.14159265358979323846)
+	      angle = 3.14159265358979323846;
+	  return angle * VKNNJ_MAX_RADIUS;
+      }
+    return sqrt ((dx * dx) + (dy * dy));
+}
+
+static int
+vknnj_queue_push (VirtualKnnJoinCursorPtr cursor,
+		  const struct vknnj_cell *cell, double dist, int type,
+		  int level)
+{
+/* inserting a new entry into the priority queue (binary min-heap) */
+    int i;
+    struct vknnj_queue_item *q;
+    if (cursor->queue_count >= cursor->queue_max)
+      {
+	  /* expanding the queue */
+	  int new_max = (cursor->queue_max == 0) ? 1024 : cursor->queue_max * 2;
+	  struct vknnj_queue_item *new_queue = realloc (cursor->queue,
+							sizeof (struct
+								vknnj_queue_item)
+							* new_max);
+	  if (new_queue == NULL)
+	      return 0;
+	  cursor->queue = new_queue;
+	  cursor->queue_max = new_max;
+      }
+    q = cursor->queue;
+    i = cursor->queue_count++;
+    while (i > 0)
+      {
+	  /* sifting up */
+	  int parent = (i - 1) / 2;
+	  if (q[parent].dist <= dist)
+	      break;
+	  q[i] = q[parent];
+	  i = parent;
+      }
+    q[i].cell = *cell;
+    q[i].dist = dist;
+    q[i].type = type;
+    q[i].level = level;
+    return 1;
+}
+
+static void
+vknnj_queue_pop (VirtualKnnJoinCursorPtr cursor,
+		 struct vknnj_queue_item *item)
+{
+/* extracting the nearest entry from the priority queue */
+    int i = 0;
+    struct vknnj_queue_item *q = cursor->queue;
+    struct vknnj_queue_item last;
+    *item = q[0];
+    cursor->queue_count -= 1;
+    if (cursor->queue_count == 0)
+	return;
+    last = q[cursor->queue_count];
+    while (1)
+      {
+	  /* sifting down */
+	  int child = (2 * i) + 1;
+	  if (child >= cursor->queue_count)
+	      break;
+	  if (child + 1 < cursor->queue_count
+	      && q[child + 1].dist < q[child].dist)
+	      child++;
+	  if (last.dist <= q[child].dist)
+	      break;
+	  q[i] = q[child];
+	  i = child;
+      }
+    q[i] = last;
+}
+
+static void
+vknnj_push_bound (VirtualKnnJoinCursorPtr cursor, double bound)
+{
+/* keeping the K smallest upper bounds (binary max-heap) */
+    double *h = cursor->bounds;
+    int i;
+    if (cursor->n_bounds < cursor->max_items)
+      {
+	  /* sifting up */
+	  i = cursor->n_bounds++;
+	  while (i > 0)
+	    {
+		int parent = (i - 1) / 2;
+		if (h[parent] >= bound)
+		    break;
+		h[i] = h[parent];
+		i = parent;
+	    }
+	  h[i] = bound;
+	  return;
+      }
+    if (bound >= h[0])
+	return;
+/* replacing the largest one, then sifting down */
+    i = 0;
+    while (1)
+      {
+	  int child = (2 * i) + 1;
+	  if (child >= cursor->n_bounds)
+	      break;
+	  if (child + 1 < cursor->n_bounds && h[child + 1] > h[child])
+	      child++;
+	  if (bound >= h[child])
+	      break;
+	  h[i] = h[child];
+	  i = child;
+      }
+    h[i] = bound;
+}
+
+static int
+vknnj_add_candidate (VirtualKnnJoinCursorPtr cursor,
+		     const struct vknnj_cell *cell)
+{
+/* appending a candidate to the current group */
+    struct vknnj_candidate *cand;
+    if (cursor->n_cands == cursor->max_cands)
+      {
+	  int max_cands = (cursor->max_cands == 0) ? 4096 : cursor->max_cands * 2;
+	  struct vknnj_candidate *cands = realloc (cursor->cands,
+						   sizeof (struct
+							   vknnj_candidate) *
+						   max_cands);
+	  if (cands == NULL)
+	      return 0;
+	  cursor->cands = cands;
+	  cursor->max_cands = max_cands;
+      }
+    cand = cursor->cands + cursor->n_cands;
+    cand->rowid = cell->id;
+    cand->minx = cell->minx;
+    cand->maxx = cell->maxx;
+    cand->miny = cell->miny;
+    cand->maxy = cell->maxy;
+    cand->feature = -1;
+    cursor->n_cands++;
+    return 1;
+}
+
+static int
+vknnj_group_candidates (VirtualKnnJoinCursorPtr cursor, double minx,
+			double miny, double maxx, double maxy)
+{
+/*
+/ best-first traversal of the R*Tree from the BBOX of a group of
+/ probes, collecting all Leaf cells possibly being one of the K
+/ nearest features of any probe in the group
+*/
+    struct vknnj_queue_item item;
+    struct vknnj_node *node;
+    struct vknnj_cell root;
+    int is_geo = cursor->is_geographic;
+    double radius;
+    int i;
+    cursor->queue_count = 0;
+    cursor->n_bounds = 0;
+    root.id = 1;
+    root.minx = -FLT_MAX;
+    root.maxx = FLT_MAX;
+    root.miny = -FLT_MAX;
+    root.maxy = FLT_MAX;
+    if (!vknnj_queue_push
+	(cursor, &root, 0.0, VKNNJ_NODE, cursor->tab_b.depth))
+	return 0;
+    while (cursor->queue_count > 0)
+      {
+	  vknnj_queue_pop (cursor, &item);
+	  radius =
+	      (cursor->n_bounds ==
+	       cursor->max_items) ? cursor->bounds[0] : DBL_MAX;
+	  if (item.dist > radius)
+	      break;		/* all remaining entries are farther */
+	  if (item.type == VKNNJ_LEAF)
+	    {
+		if (!vknnj_add_candidate (cursor, &(item.cell)))
+		    return 0;
+		continue;
+	    }
+	  node = vknnj_load_node (&(cursor->tab_b), item.cell.id);
+	  if (node == NULL)
+	      return 0;
+	  for (i = 0; i < node->count; i++)
+	    {
+		struct vknnj_cell *cell = node->cells + i;
+		double dist =
+		    vknnj_min_distance (is_geo, minx, miny, maxx, maxy,
+					cell->minx, cell->miny, cell->maxx,
+					cell->maxy);
+		if (item.level == 0)
+		    vknnj_push_bound (cursor,
+				      vknnj_max_distance (is_geo, minx, miny,
+							  maxx, maxy,
+							  cell->minx,
+							  cell->miny,
+							  cell->maxx,
+							  cell->maxy));
+		radius =
+		    (cursor->n_bounds ==
+		     cursor->max_items) ? cursor->bounds[0] : DBL_MAX;
+		if (dist > radius)
+		    continue;
+		if (!vknnj_queue_push
+		    (cursor, cell, dist,
+		     (item.level == 0) ? VKNNJ_LEAF : VKNNJ_NODE,
+		     item.level - 1))
+		    return 0;
+	    }
+      }
+    return 1;
+}
+
+static int
+vknnj_cmp_features (const void *p1, const void *p2)
+{
+/* sorting parsed Geometries by rowid */
+    const struct vknnj_feature *f1 = (const struct vknnj_feature *) p1;
+    const struct vknnj_feature *f2 = (const struct vknnj_feature *) p2;
+    if (f1->rowid < f2->rowid)
+	return -1;
+    if (f1->rowid > f2->rowid)
+	return 1;
+    return 0;
+}
+
+static gaiaGeomCollPtr
+vknnj_fetch_geometry (struct vknnj_table *tbl, sqlite3_int64 rowid, int *err)
+{
+/* fetching and parsing a single Geometry */
+    gaiaGeomCollPtr geom = NULL;
+    int ret;
+    sqlite3_reset (tbl->stmt_geom);
+    sqlite3_clear_bindings (tbl->stmt_geom);
+    sqlite3_bind_int64 (tbl->stmt_geom, 1, rowid);
+    ret = sqlite3_step (tbl->stmt_geom);
+    if (ret == SQLITE_ROW)
+      {
+	  if (sqlite3_column_type (tbl->stmt_geom, 0) == SQLITE_BLOB)
+	    {
+		geom =
+		    gaiaFromSpatiaLiteBlobWkb (sqlite3_column_blob
+					       (tbl->stmt_geom, 0),
+					       sqlite3_column_bytes
+					       (tbl->stmt_geom, 0));
+		if (geom != NULL)
+		    gaiaMbrGeometry (geom);
+	    }
+      }
+    else if (ret != SQLITE_DONE)
+	*err = 1;
+    sqlite3_reset (tbl->stmt_geom);
+    return geom;
+}
+
+static int
+vknnj_fetch_features (VirtualKnnJoinCursorPtr cursor)
+{
+/*
+/ fetching every distinct candidate Geometry of the current batch;
+/ Geometries already parsed for the previous batch are retained
+*/
+    struct vknnj_feature *features;
+    struct vknnj_feature *old;
+    struct vknnj_feature key;
+    int n_features = 0;
+    int err = 0;
+    int i;
+    if (cursor->n_cands == 0)
+	features = malloc (sizeof (struct vknnj_feature));
+    else
+	features = malloc (sizeof (struct vknnj_feature) * cursor->n_cands);
+    if (features == NULL)
+	return 0;
+    for (i = 0; i < cursor->n_cands; i++)
+      {
+	  features[i].rowid = cursor->cands[i].rowid;
+	  features[i].geom = NULL;
+      }
+    qsort (features, cursor->n_cands, sizeof (struct vknnj_feature),
+	   vknnj_cmp_features);
+    for (i = 0; i < cursor->n_cands; i++)
+      {
+	  if (n_features == 0
+	      || features[n_features - 1].rowid != features[i].rowid)
+	      features[n_features++] = features[i];
+      }
+    for (i = 0; i < n_features; i++)
+      {
+	  struct vknnj_feature *p = features + i;
+	  old = NULL;
+	  if (cursor->n_features > 0)
+	      old =
+		  bsearch (p, cursor->features, cursor->n_features,
+			   sizeof (struct vknnj_feature), vknnj_cmp_features);
+	  if (old != NULL)
+	    {
+		/* already parsed for the previous batch */
+		p->geom = old->geom;
+		old->geom = NULL;
+		continue;
+	    }
+	  p->geom = vknnj_fetch_geometry (&(cursor->tab_b), p->rowid, &err);
+	  if (err)
+	      break;
+      }
+
+/* releasing the Geometries no longer required */
+    for (i = 0; i < cursor->n_features; i++)
+      {
+	  if (cursor->features[i].geom != NULL)
+	      gaiaFreeGeomColl (cursor->features[i].geom);
+      }
+    if (cursor->features != NULL)
+	free (cursor->features);
+    cursor->features = features;
+    cursor->n_features = n_features;
+    if (err)
+	return 0;
+
+    for (i = 0; i < cursor->n_cands; i++)
+      {
+	  key.rowid = cursor->cands[i].rowid;
+	  old =
+	      bsearch (&key, features, n_features,
+		       sizeof (struct vknnj_feature), vknnj_cmp_features);
+	  cursor->cands[i].feature = old - features;
+      }
+    return 1;
+}
+
+static double
+vknnj_distance (struct vknnj_worker *worker, gaiaGeomCollPtr geom1,
+		gaiaGeomCollPtr geom2)
+{
+/* computing the distance between two Geometries, just as ST_Distance() */
+    gaiaGeomCollPtr shortest;
+    gaiaLinestringPtr ln;
+    double dist;
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+    int dims;
+    if (!worker->is_geographic)
+      {
+	  if (!gaiaGeomCollDistance_r (worker->cache, geom1, geom2, &dist))
+	      return DBL_MAX;
+	  return dist;
+      }
+
+/* Geographic SRID: metric distance along the shortest line */
+    if (gaiaGeomCollIntersects_r (worker->cache, geom1, geom2))
+	return 0.0;
+    shortest = gaiaShortestLine_r (worker->cache, geom1, geom2);
+    if (shortest == NULL)
+	return DBL_MAX;
+    ln = shortest->FirstLinestring;
+    if (ln == NULL || ln->Points != 2)
+      {
+	  gaiaFreeGeomColl (shortest);
+	  return DBL_MAX;
+      }
+    if (ln->DimensionModel == GAIA_XY_Z || ln->DimensionModel == GAIA_XY_M)
+	dims = 3;
+    else if (ln->DimensionModel == GAIA_XY_Z_M)
+	dims = 4;
+    else
+	dims = 2;
+    x0 = ln->Coords[0];
+    y0 = ln->Coords[1];
+    x1 = ln->Coords[dims];
+    y1 = ln->Coords[dims + 1];
+    gaiaFreeGeomColl (shortest);
+    dist =
+	gaiaGeodesicDistance (worker->a, worker->b, worker->rf, y0, x0, y1,
+			      x1);
+    if (dist < 0.0)
+	return DBL_MAX;
+    return dist;
+}
+
+static int
+vknnj_cmp_sort (const void *p1, const void *p2)
+{
+/* sorting candidates by BBOX distance */
+    const struct vknnj_sort *s1 = (const struct vknnj_sort *) p1;
+    const struct vknnj_sort *s2 = (const struct vknnj_sort *) p2;
+    if (s1->dist < s2->dist)
+	return -1;
+    if (s1->dist > s2->dist)
+	return 1;
+    return s1->index - s2->index;
+}
+
+static void
+vknnj_refine_probe (struct vknnj_worker *worker, int index)
+{
+/* finding the K nearest features of a single probe */
+    struct vknnj_ref *ref = worker->refs + index;
+    struct vknnj_group *group = worker->groups + ref->group;
+    struct vknnj_item *items = worker->items + (index * worker->max_items);
+    gaiaGeomCollPtr geom = ref->geom;
+    int count = 0;
+    int i;
+    int j;
+    worker->counts[index] = 0;
+    if (geom == NULL)
+	return;
+    for (i = 0; i < group->count; i++)
+      {
+	  struct vknnj_candidate *cand = worker->cands + group->first + i;
+	  worker->sort[i].dist =
+	      vknnj_min_distance (worker->is_geographic, geom->MinX,
+				  geom->MinY, geom->MaxX, geom->MaxY,
+				  cand->minx, cand->miny, cand->maxx,
+				  cand->maxy);
+	  worker->sort[i].index = group->first + i;
+      }
+    qsort (worker->sort, group->count, sizeof (struct vknnj_sort),
+	   vknnj_cmp_sort);
+    for (i = 0; i < group->count; i++)
+      {
+	  struct vknnj_candidate *cand = worker->cands + worker->sort[i].index;
+	  gaiaGeomCollPtr other = worker->features[cand->feature].geom;
+	  double dist;
+	  if (count == worker->max_items
+	      && worker->sort[i].dist > items[count - 1].dist)
+	      break;		/* all remaining candidates are farther */
+	  if (other == NULL)
+	      continue;
+	  dist = vknnj_distance (worker, geom, other);
+	  if (dist == DBL_MAX)
+	      continue;
+	  /* inserting into the sorted array (ties sorted by rowid) */
+	  for (j = count; j > 0; j--)
+	    {
+		struct vknnj_item *prev = items + j - 1;
+		if (prev->dist < dist
+		    || (prev->dist == dist && prev->rowid < cand->rowid))
+		    break;
+		if (j < worker->max_items)
+		    items[j] = *prev;
+	    }
+	  if (j < worker->max_items)
+	    {
+		items[j].rowid = cand->rowid;
+		items[j].dist = dist;
+		if (count < worker->max_items)
+		    count++;
+	    }
+      }
+    worker->counts[index] = count;
+}
+
+static void
+vknnj_work (void *arg)
+{
+/* refining a slice of the probes */
+    struct vknnj_worker *worker = (struct vknnj_worker *) arg;
+    int i;
+    for (i = worker->first; i < worker->first + worker->count; i++)
+	vknnj_refine_probe (worker, i);
+}
+
+static int
+vknnj_threads (VirtualKnnJoinCursorPtr cursor)
+{
+/* lazily allocating the worker threads (each one owns a GEOS handle) */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) (cursor->pVtab->p_cache);
+    int max_threads;
+    int i;
+    if (cursor->workers != NULL)
+	return cursor->n_workers;
+    max_threads = (cache == NULL) ? 1 : cache->max_threads;
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    cursor->workers = calloc (max_threads, sizeof (struct vknnj_worker));
+    if (cursor->workers == NULL)
+	return 0;
+    for (i = 0; i < max_threads; i++)
+      {
+	  struct vknnj_worker *worker = cursor->workers + i;
+	  if (i == 0)
+	      worker->cache = cache;
+	  else
+	    {
+		worker->cache = spatialite_alloc_connection ();
+		if (worker->cache == NULL)
+		    break;	/* no more free connection slots */
+	    }
+	  cursor->n_workers++;
+      }
+    return cursor->n_workers;
+}
+
+static void
+vknnj_free_refs (VirtualKnnJoinCursorPtr cursor)
+{
+/* releasing the probes of the current batch */
+    int i;
+    for (i = 0; i < cursor->n_refs; i++)
+      {
+	  if (cursor->refs[i].geom != NULL)
+	      gaiaFreeGeomColl (cursor->refs[i].geom);
+      }
+    cursor->n_refs = 0;
+    cursor->n_groups = 0;
+    cursor->n_cands = 0;
+}
+
+static int
+vknnj_batch_size (VirtualKnnJoinCursorPtr cursor)
+{
+/* how many probes will be processed at once */
+    int size = VKNNJ_BATCH_ITEMS / cursor->max_items;
+    if (size > VKNNJ_BATCH)
+	size = VKNNJ_BATCH;
+    if (size < VKNNJ_GROUP)
+	size = VKNNJ_GROUP;
+    return size;
+}
+
+static int
+vknnj_process_batch (VirtualKnnJoinCursorPtr cursor)
+{
+/* finding the K nearest features for the next batch of probes */
+    struct vknnj_worker *workers;
+    int n_workers;
+    int n_refs;
+    int max_group = 0;
+    int err = 0;
+    int base;
+    int i;
+    int g;
+
+    vknnj_free_refs (cursor);
+    n_workers = vknnj_threads (cursor);
+    if (n_workers == 0)
+	return 0;
+    n_refs = cursor->n_probes - cursor->next_probe;
+    if (n_refs > cursor->max_refs)
+	n_refs = cursor->max_refs;
+
+/* fetching the probes' Geometries */
+    for (i = 0; i < n_refs; i++)
+      {
+	  struct vknnj_ref *ref = cursor->refs + i;
+	  ref->rowid = cursor->probes[cursor->next_probe + i].rowid;
+	  ref->group = i / VKNNJ_GROUP;
+	  ref->geom =
+	      vknnj_fetch_geometry (&(cursor->tab_a), ref->rowid, &err);
+	  cursor->n_refs++;
+	  if (err)
+	      return 0;
+      }
+    cursor->next_probe += n_refs;
+
+/* collecting the candidates of each group */
+    cursor->n_groups = (n_refs + VKNNJ_GROUP - 1) / VKNNJ_GROUP;
+    for (g = 0; g < cursor->n_groups; g++)
+      {
+	  struct vknnj_group *group = cursor->groups + g;
+	  double minx = DBL_MAX;
+	  double miny = DBL_MAX;
+	  double maxx = -DBL_MAX;
+	  double maxy = -DBL_MAX;
+	  group->first = cursor->n_cands;
+	  group->count = 0;
+	  for (i = g * VKNNJ_GROUP; i < n_refs && i < (g + 1) * VKNNJ_GROUP;
+	       i++)
+	    {
+		gaiaGeomCollPtr geom = cursor->refs[i].geom;
+		if (geom == NULL)
+		    continue;
+		if (geom->MinX < minx)
+		    minx = geom->MinX;
+		if (geom->MinY < miny)
+		    miny = geom->MinY;
+		if (geom->MaxX > maxx)
+		    maxx = geom->MaxX;
+		if (geom->MaxY > maxy)
+		    maxy = geom->MaxY;
+	    }
+	  if (minx > maxx)
+	      continue;		/* no valid Geometry at all */
+	  if (!vknnj_group_candidates (cursor, minx, miny, maxx, maxy))
+	      return 0;
+	  group->count = cursor->n_cands - group->first;
+	  if (group->count > max_group)
+	      max_group = group->count;
+      }
+    if (!vknnj_fetch_features (cursor))
+	return 0;
+
+/* splitting the batch into slices, one for each worker */
+    if (n_workers > n_refs / VKNNJ_SLICE)
+	n_workers = n_refs / VKNNJ_SLICE;
+    if (n_workers < 1)
+	n_workers = 1;
+    workers = cursor->workers;
+    base = 0;
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct vknnj_worker *worker = workers + i;
+	  int end = (int) (((sqlite3_int64) n_refs * (i + 1)) / n_workers);
+	  if (max_group > worker->max_sort)
+	    {
+		struct vknnj_sort *sort = realloc (worker->sort,
+						   sizeof (struct vknnj_sort)
+						   * max_group);
+		if (sort == NULL)
+		    return 0;
+		worker->sort = sort;
+		worker->max_sort = max_group;
+	    }
+	  worker->is_geographic = cursor->is_geographic;
+	  worker->a = cursor->a;
+	  worker->b = cursor->b;
+	  worker->rf = cursor->rf;
+	  worker->max_items = cursor->max_items;
+	  worker->refs = cursor->refs;
+	  worker->first = base;
+	  worker->count = end - base;
+	  worker->groups = cursor->groups;
+	  worker->cands = cursor->cands;
+	  worker->features = cursor->features;
+	  worker->items = cursor->items;
+	  worker->counts = cursor->counts;
+	  worker->thread = NULL;
+	  base = end;
+      }
+    for (i = 1; i < n_workers; i++)
+      {
+	  struct vknnj_worker *worker = workers + i;
+	  if (worker->count == 0)
+	      continue;
+	  worker->thread = splite_thread_create (vknnj_work, worker);
+	  if (worker->thread == NULL)
+	      vknnj_work (worker);	/* falling back to serial */
+      }
+/* the current thread always processes the first slice */
+    vknnj_work (workers);
+    for (i = 1; i < n_workers; i++)
+      {
+	  if (workers[i].thread != NULL)
+	      splite_thread_join (workers[i].thread);
+	  workers[i].thread = NULL;
+      }
+    return 1;
+}
+
+static void
+vknnj_next_batch (VirtualKnnJoinCursorPtr cursor)
+{
+/* producing the next batch having at least one result */
+    while (1)
+      {
+	  if (cursor->next_probe >= cursor->n_probes)
+	    {
+		cursor->eof = 1;
+		return;
+	    }
+	  if (!vknnj_process_batch (cursor))
+	    {
+		cursor->eof = 1;
+		return;
+	    }
+	  cursor->current_item = 0;
+	  for (cursor->current_ref = 0; cursor->current_ref < cursor->n_refs;
+	       cursor->current_ref++)
+	    {
+		if (cursor->counts[cursor->current_ref] > 0)
+		    return;
+	    }
+      }
+}
+
+static void
+vknnj_reset_cursor (VirtualKnnJoinCursorPtr cursor)
+{
+/* resetting the cursor (worker threads are preserved) */
+    int i;
+    vknnj_free_refs (cursor);
+    for (i = 0; i < cursor->n_features; i++)
+      {
+	  if (cursor->features[i].geom != NULL)
+	      gaiaFreeGeomColl (cursor->features[i].geom);
+      }
+    if (cursor->features != NULL)
+	free (cursor->features);
+    cursor->features = NULL;
+    cursor->n_features = 0;
+    if (cursor->table_a != NULL)
+	free (cursor->table_a);
+    if (cursor->table_b != NULL)
+	free (cursor->table_b);
+    cursor->table_a = NULL;
+    cursor->table_b = NULL;
+    if (cursor->probes != NULL)
+	free (cursor->probes);
+    cursor->probes = NULL;
+    cursor->n_probes = 0;
+    cursor->next_probe = 0;
+    if (cursor->refs != NULL)
+	free (cursor->refs);
+    cursor->refs = NULL;
+    cursor->max_refs = 0;
+    if (cursor->groups != NULL)
+	free (cursor->groups);
+    cursor->groups = NULL;
+    if (cursor->items != NULL)
+	free (cursor->items);
+    cursor->items = NULL;
+    if (cursor->counts != NULL)
+	free (cursor->counts);
+    cursor->counts = NULL;
+    if (cursor->bounds != NULL)
+	free (cursor->bounds);
+    cursor->bounds = NULL;
+    vknnj_reset_table (&(cursor->tab_a));
+    vknnj_reset_table (&(cursor->tab_b));
+    cursor->max_items = 0;
+    cursor->is_geographic = 0;
+    cursor->current_ref = 0;
+    cursor->current_item = 0;
+    cursor->CurrentRowId = 0;
+    cursor->eof = 1;
+}
+
+static int
+vknnj_alloc_batch (VirtualKnnJoinCursorPtr cursor)
+{
+/* allocating the per-batch buffers */
+    int max_refs = vknnj_batch_size (cursor);
+    int max_groups = (max_refs + VKNNJ_GROUP - 1) / VKNNJ_GROUP;
+    cursor->refs = malloc (sizeof (struct vknnj_ref) * max_refs);
+    cursor->groups = malloc (sizeof (struct vknnj_group) * max_groups);
+    cursor->items =
+	malloc (sizeof (struct vknnj_item) * max_refs * cursor->max_items);
+    cursor->counts = malloc (sizeof (int) * max_refs);
+    cursor->bounds = malloc (sizeof (double) * cursor->max_items);
+    if (cursor->refs == NULL || cursor->groups == NULL
+	|| cursor->items == NULL || cursor->counts == NULL
+	|| cursor->bounds == NULL)
+	return 0;
+    cursor->max_refs = max_refs;
+    cursor->max_groups = max_groups;
+    return 1;
+}
+
+static char *
+vknnj_text_arg (sqlite3_value * value)
+{
+/* copying a TEXT argument */
+    const char *txt;
+    char *str;
+    if (sqlite3_value_type (value) != SQLITE_TEXT)
+	return NULL;
+    txt = (const char *) sqlite3_value_text (value);
+    str = malloc (strlen (txt) + 1);
+    strcpy (str, txt);
+    return str;
+}
+
+static int
+vknnj_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
+	      sqlite3_vtab ** ppVTab, char **pzErr)
+{
+/* creates the virtual table for KNN Join */
+    VirtualKnnJoinPtr p_vt;
+    char *buf;
+    char *vtable;
+    char *xname;
+    if (argc == 3)
+      {
+	  vtable = gaiaDequotedSql ((char *) argv[2]);
+      }
+    else
+      {
+	  *pzErr =
+	      sqlite3_mprintf
+	      ("[VirtualKNNJoin module] CREATE VIRTUAL: illegal arg list {void}\n");
+	  return SQLITE_ERROR;
+      }
+    p_vt = (VirtualKnnJoinPtr) sqlite3_malloc (sizeof (VirtualKnnJoin));
+    if (!p_vt)
+	return SQLITE_NOMEM;
+    p_vt->db = db;
+    p_vt->p_cache = pAux;
+    p_vt->pModule = &my_knnjoin_module;
+    p_vt->nRef = 0;
+    p_vt->zErrMsg = NULL;
+/* preparing the COLUMNs for this VIRTUAL TABLE */
+    xname = gaiaDoubleQuotedSql (vtable);
+    buf = sqlite3_mprintf ("CREATE TABLE \"%s\" (table_a TEXT, "
+			   "geometry_a TEXT, table_b TEXT, geometry_b TEXT, "
+			   "max_items INTEGER, rowid_a INTEGER, pos INTEGER, "
+			   "rowid_b INTEGER, distance DOUBLE)", xname);
+    free (xname);
+    free (vtable);
+    if (sqlite3_declare_vtab (db, buf) != SQLITE_OK)
+      {
+	  sqlite3_free (buf);
+	  *pzErr =
+	      sqlite3_mprintf
+	      ("[VirtualKNNJoin module] CREATE VIRTUAL: invalid SQL statement");
+	  sqlite3_free (p_vt);
+	  return SQLITE_ERROR;
+      }
+    sqlite3_free (buf);
+    *ppVTab = (sqlite3_vtab *) p_vt;
+    return SQLITE_OK;
+}
+
+static int
+vknnj_connect (sqlite3 * db, void *pAux, int argc, const char *const *argv,
+	       sqlite3_vtab ** ppVTab, char **pzErr)
+{
+/* connects the virtual table - simply aliases vknnj_create() */
+    return vknnj_create (db, pAux, argc, argv, ppVTab, pzErr);
+}
+
+static int
+vknnj_best_index (sqlite3_vtab * pVTab, sqlite3_index_info * pIdxInfo)
+{
+/* 
+/ best index selection
+/ idxNum is a bitmask of the constrained columns [table_a, geometry_a,
+/ table_b, geometry_b, max_items]: their values are passed to xFilter
+/ in this same order
+*/
+    int i;
+    int col;
+    int mask = 0;
+    int n_args = 0;
+    int usage[5];
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    for (col = 0; col < 5; col++)
+      {
+	  usage[col] = -1;
+	  for (i = 0; i < pIdxInfo->nConstraint; i++)
+	    {
+		struct sqlite3_index_constraint *p =
+		    &(pIdxInfo->aConstraint[i]);
+		if (p->usable && p->iColumn == col
+		    && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
+		  {
+		      usage[col] = i;
+		      mask |= (1 << col);
+		      break;
+		  }
+	    }
+      }
+    if ((mask & 0x01) && (mask & 0x04))
+      {
+	  /* this one is a valid KNN Join query */
+	  pIdxInfo->idxNum = mask;
+	  pIdxInfo->estimatedCost = 1.0;
+	  for (col = 0; col < 5; col++)
+	    {
+		if (usage[col] < 0)
+		    continue;
+		pIdxInfo->aConstraintUsage[usage[col]].argvIndex = ++n_args;
+		pIdxInfo->aConstraintUsage[usage[col]].omit = 1;
+	    }
+      }
+    else
+      {
+	  /* illegal query */
+	  pIdxInfo->idxNum = 0;
+	  pIdxInfo->estimatedCost = 1.0e+12;
+      }
+    return SQLITE_OK;
+}
+
+static int
+vknnj_disconnect (sqlite3_vtab * pVTab)
+{
+/* disconnects the virtual table */
+    VirtualKnnJoinPtr p_vt = (VirtualKnnJoinPtr) pVTab;
+    sqlite3_free (p_vt);
+    return SQLITE_OK;
+}
+
+static int
+vknnj_destroy (sqlite3_vtab * pVTab)
+{
+/* destroys the virtual table - simply aliases vknnj_disconnect() */
+    return vknnj_disconnect (pVTab);
+}
+
+static int
+vknnj_open (sqlite3_vtab * pVTab, sqlite3_vtab_cursor ** ppCursor)
+{
+/* opening a new cursor */
+    VirtualKnnJoinCursorPtr cursor =
+	(VirtualKnnJoinCursorPtr) sqlite3_malloc (sizeof (VirtualKnnJoinCursor));
+    if (cursor == NULL)
+	return SQLITE_ERROR;
+    memset (cursor, 0, sizeof (VirtualKnnJoinCursor));
+    cursor->pVtab = (VirtualKnnJoinPtr) pVTab;
+    cursor->eof = 1;
+    *ppCursor = (sqlite3_vtab_cursor *) cursor;
+    return SQLITE_OK;
+}
+
+static int
+vknnj_close (sqlite3_vtab_cursor * pCursor)
+{
+/* closing the cursor */
+    int i;
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    vknnj_reset_cursor (cursor);
+    if (cursor->cands != NULL)
+	free (cursor->cands);
+    if (cursor->queue != NULL)
+	free (cursor->queue);
+    if (cursor->workers != NULL)
+      {
+	  for (i = 0; i < cursor->n_workers; i++)
+	    {
+		if (cursor->workers[i].sort != NULL)
+		    free (cursor->workers[i].sort);
+		if (i > 0)
+		    spatialite_cleanup_ex ((void *) (cursor->workers[i].cache));
+	    }
+	  free (cursor->workers);
+      }
+    sqlite3_free (pCursor);
+    return SQLITE_OK;
+}
+
+static int
+vknnj_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
+	      int argc, sqlite3_value ** argv)
+{
+/* setting up a cursor filter */
+    char *args[4];
+    int col;
+    int i = 0;
+    int ok = 1;
+    int geographic = 0;
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    VirtualKnnJoinPtr knnjoin = (VirtualKnnJoinPtr) cursor->pVtab;
+    if (idxStr)
+	idxStr = idxStr;	/* unused arg warning suppression */
+    vknnj_reset_cursor (cursor);
+    if (idxNum == 0)
+	return SQLITE_OK;
+
+/* retrieving the Table/Column/MaxItems params */
+    cursor->max_items = 3;
+    for (col = 0; col < 5; col++)
+      {
+	  if (col < 4)
+	      args[col] = NULL;
+	  if ((idxNum & (1 << col)) == 0)
+	      continue;
+	  if (col == 4)
+	    {
+		if (i < argc && sqlite3_value_type (argv[i]) == SQLITE_INTEGER)
+		  {
+		      cursor->max_items = sqlite3_value_int (argv[i]);
+		      if (cursor->max_items > 1024)
+			  cursor->max_items = 1024;
+		      if (cursor->max_items < 1)
+			  cursor->max_items = 1;
+		  }
+		else
+		    ok = 0;
+	    }
+	  else
+	    {
+		if (i < argc)
+		    args[col] = vknnj_text_arg (argv[i]);
+		if (args[col] == NULL)
+		    ok = 0;	/* NULL or not a TEXT */
+	    }
+	  i++;
+      }
+    cursor->table_a = args[0];
+    cursor->table_b = args[2];
+    if (!ok)
+	goto stop;
+
+/* checking both tables (the second one requires an R*Tree) */
+    vknnj_parse_table_name (cursor->table_a, &(cursor->tab_a.db_prefix),
+			    &(cursor->tab_a.table));
+    if (!vknnj_find_table (knnjoin->db, &(cursor->tab_a), args[1], 0))
+	goto stop;
+    vknnj_parse_table_name (cursor->table_b, &(cursor->tab_b.db_prefix),
+			    &(cursor->tab_b.table));
+    if (!vknnj_find_table (knnjoin->db, &(cursor->tab_b), args[3], 1))
+	goto stop;
+    if (cursor->tab_a.srid != cursor->tab_b.srid)
+      {
+	  sqlite3_free (knnjoin->zErrMsg);
+	  knnjoin->zErrMsg =
+	      sqlite3_mprintf
+	      ("VirtualKNNJoin: mismatching SRIDs (%d and %d)",
+	       cursor->tab_a.srid, cursor->tab_b.srid);
+	  goto error;
+      }
+    if (srid_is_geographic (knnjoin->db, cursor->tab_b.srid, &geographic)
+	&& geographic)
+      {
+	  cursor->is_geographic = 1;
+	  if (!getEllipsoidParams
+	      (knnjoin->db, cursor->tab_b.srid, &(cursor->a), &(cursor->b),
+	       &(cursor->rf)))
+	      goto stop;
+      }
+    if (!vknnj_prepare_table (knnjoin->db, &(cursor->tab_a), 0))
+	goto stop;
+    if (!vknnj_prepare_table (knnjoin->db, &(cursor->tab_b), 1))
+	goto stop;
+
+/* loading the root node, so to know the depth of the R*Tree */
+    if (vknnj_load_node (&(cursor->tab_b), 1) == NULL)
+	goto stop;
+    if (cursor->tab_b.depth > VKNNJ_MAX_DEPTH)
+	goto stop;
+    if (!vknnj_alloc_batch (cursor))
+	goto stop;
+    if (!vknnj_load_probes (cursor))
+	goto stop;
+    cursor->eof = 0;
+/* processing the first batch of probes */
+    vknnj_next_batch (cursor);
+
+  stop:
+    if (args[1] != NULL)
+	free (args[1]);
+    if (args[3] != NULL)
+	free (args[3]);
+    return SQLITE_OK;
+
+  error:
+    if (args[1] != NULL)
+	free (args[1]);
+    if (args[3] != NULL)
+	free (args[3]);
+    return SQLITE_ERROR;
+}
+
+static int
+vknnj_next (sqlite3_vtab_cursor * pCursor)
+{
+/* fetching a next row from cursor */
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    cursor->CurrentRowId++;
+    cursor->current_item++;
+    if (cursor->current_item < cursor->counts[cursor->current_ref])
+	return SQLITE_OK;
+    cursor->current_item = 0;
+    for (cursor->current_ref++; cursor->current_ref < cursor->n_refs;
+	 cursor->current_ref++)
+      {
+	  if (cursor->counts[cursor->current_ref] > 0)
+	      return SQLITE_OK;
+      }
+    vknnj_next_batch (cursor);
+    return SQLITE_OK;
+}
+
+static int
+vknnj_eof (sqlite3_vtab_cursor * pCursor)
+{
+/* cursor EOF */
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    return cursor->eof;
+}
+
+static int
+vknnj_column (sqlite3_vtab_cursor * pCursor, sqlite3_context * pContext,
+	      int column)
+{
+/* fetching value for the Nth column */
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    struct vknnj_ref *ref = NULL;
+    struct vknnj_item *item = NULL;
+    const char *txt = NULL;
+    if (!cursor->eof && cursor->current_ref < cursor->n_refs)
+      {
+	  ref = cursor->refs + cursor->current_ref;
+	  item =
+	      cursor->items + (cursor->current_ref * cursor->max_items) +
+	      cursor->current_item;
+      }
+    if (column == 0)
+	txt = cursor->table_a;	/* the Table A Name column */
+    else if (column == 1)
+	txt = cursor->tab_a.geometry;	/* the GeometryColumn A Name column */
+    else if (column == 2)
+	txt = cursor->table_b;	/* the Table B Name column */
+    else if (column == 3)
+	txt = cursor->tab_b.geometry;	/* the GeometryColumn B Name column */
+    if (txt != NULL)
+	sqlite3_result_text (pContext, txt, strlen (txt), SQLITE_TRANSIENT);
+    else if (column == 4 && cursor->max_items > 0)
+      {
+	  /* the Max Items column */
+	  sqlite3_result_int (pContext, cursor->max_items);
+      }
+    else if (column == 5 && ref != NULL)
+      {
+	  /* the RowID A column */
+	  sqlite3_result_int64 (pContext, ref->rowid);
+      }
+    else if (column == 6 && ref != NULL)
+      {
+	  /* the index column */
+	  sqlite3_result_int (pContext, cursor->current_item + 1);
+      }
+    else if (column == 7 && item != NULL)
+      {
+	  /* the RowID B column */
+	  sqlite3_result_int64 (pContext, item->rowid);
+      }
+    else if (column == 8 && item != NULL)
+      {
+	  /* the Distance column */
+	  sqlite3_result_double (pContext, item->dist);
+      }
+    else
+	sqlite3_result_null (pContext);
+    return SQLITE_OK;
+}
+
+static int
+vknnj_rowid (sqlite3_vtab_cursor * pCursor, sqlite_int64 * pRowid)
+{
+/* fetching the ROWID */
+    VirtualKnnJoinCursorPtr cursor = (VirtualKnnJoinCursorPtr) pCursor;
+    *pRowid = cursor->CurrentRowId;
+    return SQLITE_OK;
+}
+
+static int
+vknnj_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
+	      sqlite_int64 * pRowid)
+{
+/* generic update [INSERT / UPDATE / DELETE */
+    if (pRowid || argc || argv || pVTab)
+	pRowid = pRowid;	/* unused arg warning suppression */
+/* read only datasource */
+    return SQLITE_READONLY;
+}
+
+static int
+vknnj_begin (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vknnj_sync (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vknnj_commit (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vknnj_rollback (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vknnj_rename (sqlite3_vtab * pVTab, const char *zNew)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    if (zNew)
+	zNew = zNew;		/* unused arg warning suppression */
+    return SQLITE_ERROR;
+}
+
+static int
+spliteVirtualKnnJoinInit (sqlite3 * db, void *p_cache)
+{
+    int rc = SQLITE_OK;
+    my_knnjoin_module.iVersion = 1;
+    my_knnjoin_module.xCreate = &vknnj_create;
+    my_knnjoin_module.xConnect = &vknnj_connect;
+    my_knnjoin_module.xBestIndex = &vknnj_best_index;
+    my_knnjoin_module.xDisconnect = &vknnj_disconnect;
+    my_knnjoin_module.xDestroy = &vknnj_destroy;
+    my_knnjoin_module.xOpen = &vknnj_open;
+    my_knnjoin_module.xClose = &vknnj_close;
+    my_knnjoin_module.xFilter = &vknnj_filter;
+    my_knnjoin_module.xNext = &vknnj_next;
+    my_knnjoin_module.xEof = &vknnj_eof;
+    my_knnjoin_module.xColumn = &vknnj_column;
+    my_knnjoin_module.xRowid = &vknnj_rowid;
+    my_knnjoin_module.xUpdate = &vknnj_update;
+    my_knnjoin_module.xBegin = &vknnj_begin;
+    my_knnjoin_module.xSync = &vknnj_sync;
+    my_knnjoin_module.xCommit = &vknnj_commit;
+    my_knnjoin_module.xRollback = &vknnj_rollback;
+    my_knnjoin_module.xFindFunction = NULL;
+    my_knnjoin_module.xRename = &vknnj_rename;
+    sqlite3_create_module_v2 (db, "VirtualKNNJoin", &my_knnjoin_module,
+			      p_cache, 0);
+    return rc;
+}
+
+SPATIALITE_PRIVATE int
+virtual_knnjoin_extension_init (void *xdb, const void *p_cache)
+{
+    sqlite3 *db = (sqlite3 *) xdb;
+    return spliteVirtualKnnJoinInit (db, (void *) p_cache);
+}
+
+#endif /* end KNN conditional */
+#endif /* end GEOS conditional */
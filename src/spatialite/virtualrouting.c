@@ -50,6 +50,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <string.h>
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <ctype.h>
 
 #if defined(_WIN32) && !defined(__MINGW32__)
@@ -66,17 +67,20 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <spatialite/spatialite_ext.h>
 #include <spatialite/gaiaaux.h>
 #include <spatialite/gaiageo.h>
+#include <spatialite_private.h>
 
 static struct sqlite3_module my_route_module;
 
 #define VROUTE_DIJKSTRA_ALGORITHM	1
 #define VROUTE_A_STAR_ALGORITHM	2
+#define VROUTE_CH_ALGORITHM	3
 
 #define VROUTE_ROUTING_SOLUTION		0xdd
 #define VROUTE_POINT2POINT_SOLUTION	0xcc
 #define VROUTE_POINT2POINT_ERROR	0xca
 #define VROUTE_RANGE_SOLUTION		0xbb
 #define VROUTE_TSP_SOLUTION			0xee
+#define VROUTE_MATRIX_SOLUTION		0xaa
 
 #define VROUTE_SHORTEST_PATH_FULL		0x70
 #define VROUTE_SHORTEST_PATH_NO_LINKS	0x71
@@ -87,10 +91,14 @@ static struct sqlite3_module my_route_module;
 #define VROUTE_SHORTEST_PATH			0x91
 #define VROUTE_TSP_NN					0x92
 #define VROUTE_TSP_GA					0x93
+#define VROUTE_COST_MATRIX				0x94
+#define VROUTE_TSP_GA_MT				0x95
 
 #define VROUTE_INVALID_SRID	-1234
 
 #define	VROUTE_TSP_GA_MAX_ITERATIONS	512
+#define	VROUTE_TSP_GA_MT_EPOCH	32	/* generations between migrations */
+#define	VROUTE_TSP_GA_MT_ISLAND	8	/* min sub-population per thread */
 
 #define VROUTE_POINT2POINT_FROM	1
 #define VROUTE_POINT2POINT_TO	2
@@ -105,6 +113,17 @@ static struct sqlite3_module my_route_module;
 #define strcasecmp	_stricmp
 #endif /* not WIN32 */
 
+#if defined(_WIN32)
+#include <windows.h>
+#define VROUTE_GRAPH_MMAP	/* Routing Graph files can be mapped */
+#elif defined(HAVE_SYS_MMAN_H)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define VROUTE_GRAPH_MMAP	/* Routing Graph files can be mapped */
+#endif
+
 /******************************************************************************
 /
 / helper structs for destintation candidates
@@ -137,11 +156,18 @@ typedef DestinationCandidatesList *DestinationCandidatesListPtr;
 /
 ******************************************************************************/
 
+/*
+/ both Links and Nodes are position-independent (internal indices
+/ and offsets instead of pointers), so that the same arrays can be
+/ either decoded from the Routing Data BLOBs or directly mapped
+/ from a Routing Graph file
+*/
+
 typedef struct RouteLinkStruct
 {
 /* a LINK */
-    const struct RouteNodeStruct *NodeFrom;
-    const struct RouteNodeStruct *NodeTo;
+    int NodeFrom;		/* FromNode internal index */
+    int NodeTo;			/* ToNode internal index */
     sqlite3_int64 LinkRowid;
     double Cost;
 } RouteLink;
@@ -151,15 +177,55 @@ typedef struct RouteNodeStruct
 {
 /* a NODE */
     int InternalIndex;
+    int NumLinks;
+    int FirstLink;		/* index of the first outgoing Link */
+    int Code;			/* offset into the Codes pool */
     sqlite3_int64 Id;
-    char *Code;
     double CoordX;
     double CoordY;
-    int NumLinks;
-    RouteLinkPtr Links;
 } RouteNode;
 typedef RouteNode *RouteNodePtr;
 
+#define VROUTE_NODE_FROM(graph, link)	((graph)->Nodes + (link)->NodeFrom)
+#define VROUTE_NODE_TO(graph, link)	((graph)->Nodes + (link)->NodeTo)
+#define VROUTE_NODE_CODE(graph, node)	((graph)->Codes + (node)->Code)
+
+typedef struct RoutingGraphFileStruct
+{
+/* a Routing Graph file mapped into memory (read-only) */
+    void *Base;
+    size_t Size;
+} RoutingGraphFile;
+typedef RoutingGraphFile *RoutingGraphFilePtr;
+
+typedef struct RoutingCHStruct
+{
+/* the Contraction Hierarchies overlay */
+    int NumArcs;		/* # original Arcs */
+    int NumShortcuts;		/* # Shortcuts declared by the Header */
+    int LoadedShortcuts;	/* # Shortcuts actually loaded */
+    int Mapped;			/* mapped from a Routing Graph file */
+    int *Ranks;			/* Node ranks */
+    RouteLinkPtr Shortcuts;
+    int *Children;		/* the two halves of each Shortcut */
+    int *UpIndex;		/* upward Edges by FromNode */
+    int *Up;
+    int *DownIndex;		/* downward Edges by ToNode */
+    int *Down;
+    double *DistFwd;		/* query workspace: forward search */
+    int *PrevFwd;
+    double *DistBwd;		/* query workspace: backward search */
+    int *PrevBwd;
+    int *Touched;
+    int NumTouched;
+} RoutingCH;
+typedef RoutingCH *RoutingCHPtr;
+
+/* CH Edges: the original Arcs (in Node order) followed by the Shortcuts */
+#define VROUTE_CH_EDGE(graph, ch, k) \
+	(((k) < (ch)->NumArcs) ? (graph)->Links + (k) : \
+	(ch)->Shortcuts + ((k) - (ch)->NumArcs))
+
 typedef struct RoutingStruct
 {
 /* the main NETWORK structure */
@@ -179,6 +245,13 @@ typedef struct RoutingStruct
     int HasZ;
     int Srid;
     RouteNodePtr Nodes;
+    int NumLinks;
+    int MaxLinks;		/* allocated Links while loading */
+    RouteLinkPtr Links;		/* all Links, grouped by FromNode */
+    int CodesSize;
+    char *Codes;		/* Node Codes pool, starting by an empty Code */
+    RoutingGraphFilePtr Mapped;	/* not NULL if mapped from a file */
+    RoutingCHPtr CH;
 } Routing;
 typedef Routing *RoutingPtr;
 
@@ -281,6 +354,10 @@ typedef struct MultiSolutionStruct
     RouteNodePtr From;
     double MaxCost;
     RoutingMultiDestPtr MultiTo;
+    RoutingMultiDestPtr MultiFrom;	/* Cost Matrix origins */
+    double *Matrix;		/* Cost Matrix: origins x destinations */
+    int MatrixCells;
+    int CurrentCell;
     ResultsetRowPtr FirstRow;
     ResultsetRowPtr LastRow;
     ResultsetRowPtr CurrentRow;
@@ -422,6 +499,39 @@ typedef struct TspGaPopulationStruct
 } TspGaPopulation;
 typedef TspGaPopulation *TspGaPopulationPtr;
 
+typedef struct TspGaMtStruct
+{
+/* multi-threaded TSP GA: shared (read-only) data */
+    RoutingPtr Graph;
+    int Cities;			/* #0 is the origin, #1..N are the targets */
+    RouteNodePtr *Nodes;	/* City index -> Node */
+    double *Matrix;		/* dense City-to-City costs */
+} TspGaMt;
+typedef TspGaMt *TspGaMtPtr;
+
+typedef struct TspGaIslandStruct
+{
+/* multi-threaded TSP GA: a sub-population owned by a single thread */
+    TspGaMtPtr Shared;
+    int Index;			/* island index */
+    int Count;			/* sub-population size */
+    int *Genes;			/* Count tours of Cities indices each */
+    double *Costs;		/* tour costs */
+    int *Offsprings;		/* offspring tours */
+    double *OffspringCosts;	/* offspring costs */
+    int *Parent1;		/* crossover work area */
+    int *Parent2;		/* crossover work area */
+    char *Taken;		/* crossover work area */
+    sqlite3_uint64 Random;	/* local PRNG state */
+    int Generation;		/* current generation */
+    int Generations;		/* generations to be bred by this run */
+    int FirstRow;		/* distance matrix: first row to be computed */
+    int Rows;			/* distance matrix: rows to be computed */
+    int Failed;			/* distance matrix: insufficient memory */
+    void *Thread;
+} TspGaIsland;
+typedef TspGaIsland *TspGaIslandPtr;
+
 /******************************************************************************
 /
 / Dijkstra and A* common structs
@@ -431,9 +541,6 @@ typedef TspGaPopulation *TspGaPopulationPtr;
 typedef struct RoutingNode
 {
     int Id;
-    struct RoutingNode **To;
-    RouteLinkPtr *Link;
-    int DimTo;
     struct RoutingNode *PreviousNode;
     RouteNodePtr Node;
     RouteLinkPtr xLink;
@@ -446,8 +553,7 @@ typedef RoutingNode *RoutingNodePtr;
 typedef struct RoutingNodes
 {
     RoutingNodePtr Nodes;
-    RouteLinkPtr *LinksBuffer;
-    RoutingNodePtr *NodesBuffer;
+    RouteLinkPtr Links;
     int Dim;
     int DimLink;
 } RoutingNodes;
@@ -485,6 +591,7 @@ typedef struct virtualroutingStruct
     int currentAlgorithm;	/* the currently selected Shortest Path Algorithm */
     int currentRequest;		/* the currently selected Shortest Path Request */
     int currentOptions;		/* the currently selected Shortest Path Options */
+    const void *p_cache;	/* pointer to the internal cache */
     char currentDelimiter;	/* the currently set delimiter char */
     double Tolerance;		/* the currently set Tolerance value [Point2Point] */
     MultiSolutionPtr multiSolution;	/* the current multiple solution */
@@ -514,44 +621,28 @@ typedef virtualroutingCursor *virtualroutingCursorPtr;
 static RoutingNodesPtr
 routing_init (RoutingPtr graph)
 {
-/* allocating and initializing the ROUTING struct */
+/* 
+/ allocating and initializing the ROUTING struct
+/ 
+/ only the per-query state is allocated here: the outcoming
+/ Links are directly read from the (possibly shared) NETWORK
+*/
     int i;
-    int j;
-    int cnt = 0;
     RoutingNodesPtr nd;
     RoutingNodePtr ndn;
-    RouteNodePtr nn;
 /* allocating the main Nodes struct */
     nd = malloc (sizeof (RoutingNodes));
 /* allocating and initializing  Nodes array */
     nd->Nodes = malloc (sizeof (RoutingNode) * graph->NumNodes);
+    nd->Links = graph->Links;
     nd->Dim = graph->NumNodes;
-    nd->DimLink = 0;
-/* pre-alloc buffer strategy - GENSCHER 2010-01-05 */
-    for (i = 0; i < graph->NumNodes; cnt += graph->Nodes[i].NumLinks, i++);
-    nd->NodesBuffer = malloc (sizeof (RoutingNodePtr) * cnt);
-    nd->LinksBuffer = malloc (sizeof (RouteLinkPtr) * cnt);
-
-    cnt = 0;
+    nd->DimLink = graph->NumLinks;
     for (i = 0; i < graph->NumNodes; i++)
       {
 	  /* initializing the Nodes array */
-	  nn = graph->Nodes + i;
 	  ndn = nd->Nodes + i;
-	  ndn->Id = nn->InternalIndex;
-	  ndn->DimTo = nn->NumLinks;
-	  ndn->Node = nn;
-	  ndn->To = &(nd->NodesBuffer[cnt]);
-	  ndn->Link = &(nd->LinksBuffer[cnt]);
-	  cnt += nn->NumLinks;
-
-	  for (j = 0; j < nn->NumLinks; j++)
-	    {
-		/*  setting the outcoming Links for the current Node */
-		nd->DimLink++;
-		ndn->To[j] = nd->Nodes + nn->Links[j].NodeTo->InternalIndex;
-		ndn->Link[j] = nn->Links + j;
-	    }
+	  ndn->Id = i;
+	  ndn->Node = graph->Nodes + i;
       }
     return (nd);
 }
@@ -560,8 +651,6 @@ static void
 routing_free (RoutingNodes * e)
 {
 /* memory cleanup; freeing the ROUTING struct */
-    free (e->LinksBuffer);
-    free (e->NodesBuffer);
     free (e->Nodes);
     free (e);
 }
@@ -1348,7 +1437,9 @@ build_solution (sqlite3 * handle, int options, RoutingPtr graph,
 			      {
 				  /* nodes are identified by TEXT codes */
 				  if (strcmp
-				      (pR->Link->NodeFrom->Code,
+				      (VROUTE_NODE_CODE
+				       (graph,
+					VROUTE_NODE_FROM (graph, pR->Link)),
 				       pA->ToCode) == 0)
 				      reverse = 1;
 				  else
@@ -1357,7 +1448,8 @@ build_solution (sqlite3 * handle, int options, RoutingPtr graph,
 			    else
 			      {
 				  /* nodes are identified by INTEGER ids */
-				  if (pR->Link->NodeFrom->Id == pA->ToId)
+				  if (VROUTE_NODE_FROM (graph, pR->Link)->Id ==
+				      pA->ToId)
 				      reverse = 1;
 				  else
 				      reverse = 0;
@@ -2075,10 +2167,10 @@ dijkstra_multi_shortest_path (sqlite3 * handle, int options, RoutingPtr graph,
 		    break;
 	    }
 	  n->Inspected = 1;
-	  for (i = 0; i < n->DimTo; i++)
+	  for (i = 0; i < n->Node->NumLinks; i++)
 	    {
-		p_to = *(n->To + i);
-		p_link = *(n->Link + i);
+		p_link = e->Links + n->Node->FirstLink + i;
+		p_to = e->Nodes + p_link->NodeTo;
 		if (p_to->Inspected == 0)
 		  {
 		      if (p_to->Distance == DBL_MAX)
@@ -2195,10 +2287,10 @@ dijkstra_targets_solve (RoutingNodesPtr e, TspTargetsPtr targets)
 		    break;
 	    }
 	  n->Inspected = 1;
-	  for (i = 0; i < n->DimTo; i++)
+	  for (i = 0; i < n->Node->NumLinks; i++)
 	    {
-		p_to = *(n->To + i);
-		p_link = *(n->Link + i);
+		p_link = e->Links + n->Node->FirstLink + i;
+		p_to = e->Nodes + p_link->NodeTo;
 		if (p_to->Inspected == 0)
 		  {
 		      if (p_to->Distance == DBL_MAX)
@@ -2512,10 +2604,10 @@ dijkstra_tsp_nn (sqlite3 * handle, int options, RoutingPtr graph,
 		continue;
 	    }
 	  n->Inspected = 1;
-	  for (i = 0; i < n->DimTo; i++)
+	  for (i = 0; i < n->Node->NumLinks; i++)
 	    {
-		p_to = *(n->To + i);
-		p_link = *(n->Link + i);
+		p_link = e->Links + n->Node->FirstLink + i;
+		p_to = e->Nodes + p_link->NodeTo;
 		if (p_to->Inspected == 0)
 		  {
 		      if (p_to->Distance == DBL_MAX)
@@ -2573,10 +2665,10 @@ dijkstra_range_analysis (RoutingNodesPtr e, RouteNodePtr pfrom,
 	  /* Dijsktra loop */
 	  n = routing_dequeue (heap);
 	  n->Inspected = 1;
-	  for (i = 0; i < n->DimTo; i++)
+	  for (i = 0; i < n->Node->NumLinks; i++)
 	    {
-		p_to = *(n->To + i);
-		p_link = *(n->Link + i);
+		p_link = e->Links + n->Node->FirstLink + i;
+		p_to = e->Nodes + p_link->NodeTo;
 		if (p_to->Inspected == 0)
 		  {
 		      if (p_to->Distance == DBL_MAX)
@@ -2726,10 +2818,10 @@ astar_shortest_path (RoutingNodesPtr e, RouteNodePtr nodes,
 		break;
 	    }
 	  n->Inspected = 1;
-	  for (i = 0; i < n->DimTo; i++)
+	  for (i = 0; i < n->Node->NumLinks; i++)
 	    {
-		p_to = *(n->To + i);
-		p_link = *(n->Link + i);
+		p_link = e->Links + n->Node->FirstLink + i;
+		p_to = e->Nodes + p_link->NodeTo;
 		if (p_to->Inspected == 0)
 		  {
 		      if (p_to->Distance == DBL_MAX)
@@ -2786,15 +2878,656 @@ astar_shortest_path (RoutingNodesPtr e, RouteNodePtr nodes,
 
 /* END of A* Shortest Path implementation */
 
+/*
+/
+/  implementation of the bidirectional Contraction Hierarchies search
+/
+/  the forward search only follows upward Edges (towards higher
+/  ranked Nodes) from the origin, the backward search only follows
+/  downward Edges in reverse from the destination; the shortest
+/  path is found on the highest ranked Node where both meet, then
+/  Shortcuts are recursively unpacked into the original Arcs
+/
+*/
+
+typedef struct CHHeapItemStruct
+{
+    double Distance;
+    int Node;
+} CHHeapItem;
+
+typedef struct CHHeapStruct
+{
+    CHHeapItem *Items;
+    int Count;
+    int Max;
+} CHHeap;
+
 static int
-cmp_nodes_code (const void *p1, const void *p2)
+ch_heap_push (CHHeap * heap, double distance, int node)
 {
-/* compares two nodes  by CODE [for BSEARCH] */
-    RouteNodePtr pN1 = (RouteNodePtr) p1;
-    RouteNodePtr pN2 = (RouteNodePtr) p2;
-    return strcmp (pN1->Code, pN2->Code);
+/* inserting a Node into the heap (lazy deletion) */
+    int i;
+    CHHeapItem tmp;
+    if (heap->Count == heap->Max)
+      {
+	  int max = (heap->Max == 0) ? 256 : heap->Max * 2;
+	  CHHeapItem *items = realloc (heap->Items, sizeof (CHHeapItem) * max);
+	  if (items == NULL)
+	      return 0;
+	  heap->Items = items;
+	  heap->Max = max;
+      }
+    i = heap->Count++;
+    heap->Items[i].Distance = distance;
+    heap->Items[i].Node = node;
+    while (i > 0 && heap->Items[(i - 1) / 2].Distance > heap->Items[i].Distance)
+      {
+	  tmp = heap->Items[i];
+	  heap->Items[i] = heap->Items[(i - 1) / 2];
+	  heap->Items[(i - 1) / 2] = tmp;
+	  i = (i - 1) / 2;
+      }
+    return 1;
+}
+
+static void
+ch_heap_pop (CHHeap * heap, double *distance, int *node)
+{
+/* removing the min-distance Node from the heap */
+    int i = 0;
+    int c;
+    CHHeapItem tmp;
+    *distance = heap->Items[0].Distance;
+    *node = heap->Items[0].Node;
+    heap->Items[0] = heap->Items[--heap->Count];
+    while (1)
+      {
+	  c = (i * 2) + 1;
+	  if (c >= heap->Count)
+	      break;
+	  if (c + 1 < heap->Count
+	      && heap->Items[c + 1].Distance < heap->Items[c].Distance)
+	      c++;
+	  if (heap->Items[c].Distance >= heap->Items[i].Distance)
+	      break;
+	  tmp = heap->Items[i];
+	  heap->Items[i] = heap->Items[c];
+	  heap->Items[c] = tmp;
+	  i = c;
+      }
+}
+
+static void
+ch_touch (RoutingCHPtr ch, int node)
+{
+/* registering a Node to be reset by the next query */
+    if (ch->DistFwd[node] == DBL_MAX && ch->DistBwd[node] == DBL_MAX)
+	ch->Touched[ch->NumTouched++] = node;
+}
+
+static void
+ch_reset (RoutingCHPtr ch)
+{
+/* resetting the query workspace */
+    int i;
+    int node;
+    for (i = 0; i < ch->NumTouched; i++)
+      {
+	  node = ch->Touched[i];
+	  ch->DistFwd[node] = DBL_MAX;
+	  ch->DistBwd[node] = DBL_MAX;
+	  ch->PrevFwd[node] = -1;
+	  ch->PrevBwd[node] = -1;
+      }
+    ch->NumTouched = 0;
+}
+
+static int
+ch_unpack_edge (RoutingPtr graph, int edge, RouteLinkPtr ** links, int *count,
+		int *max)
+{
+/* recursively unpacking a Shortcut into the original Arcs */
+    RoutingCHPtr ch = graph->CH;
+    if (edge < ch->NumArcs)
+      {
+	  if (*count == *max)
+	    {
+		int new_max = (*max == 0) ? 64 : *max * 2;
+		RouteLinkPtr *new_links =
+		    realloc (*links, sizeof (RouteLinkPtr) * new_max);
+		if (new_links == NULL)
+		    return 0;
+		*links = new_links;
+		*max = new_max;
+	    }
+	  (*links)[(*count)++] = graph->Links + edge;
+	  return 1;
+      }
+    edge = (edge - ch->NumArcs) * 2;
+    if (!ch_unpack_edge (graph, ch->Children[edge], links, count, max))
+	return 0;
+    return ch_unpack_edge (graph, ch->Children[edge + 1], links, count, max);
+}
+
+static RouteLinkPtr *
+ch_shortest_path (RoutingPtr graph, RouteNodePtr pfrom, RouteNodePtr pto,
+		  int *ll)
+{
+/* 
+/ identifying the Shortest Path - bidirectional CH search
+/ returns NULL on failure (insufficient memory)
+*/
+    RoutingCHPtr ch = graph->CH;
+    int from = pfrom->InternalIndex;
+    int to = pto->InternalIndex;
+    CHHeap fwd;
+    CHHeap bwd;
+    double best = DBL_MAX;
+    int meet = -1;
+    double dist;
+    double nd;
+    int node;
+    int next;
+    int i;
+    int e;
+    int forward;
+    RouteLinkPtr pA;
+    int *path = NULL;
+    int *new_path;
+    int n_path = 0;
+    int n_fwd;
+    RouteLinkPtr *result = NULL;
+    int count = 0;
+    int max = 0;
+
+    fwd.Items = NULL;
+    fwd.Count = 0;
+    fwd.Max = 0;
+    bwd.Items = NULL;
+    bwd.Count = 0;
+    bwd.Max = 0;
+    *ll = 0;
+    ch_touch (ch, from);
+    ch->DistFwd[from] = 0.0;
+    if (!ch_heap_push (&fwd, 0.0, from))
+	goto error;
+    ch_touch (ch, to);
+    ch->DistBwd[to] = 0.0;
+    if (!ch_heap_push (&bwd, 0.0, to))
+	goto error;
+    if (from == to)
+      {
+	  best = 0.0;
+	  meet = from;
+      }
+    while (fwd.Count > 0 || bwd.Count > 0)
+      {
+	  double kf = (fwd.Count > 0) ? fwd.Items[0].Distance : DBL_MAX;
+	  double kb = (bwd.Count > 0) ? bwd.Items[0].Distance : DBL_MAX;
+	  if (kf >= best && kb >= best)
+	      break;
+	  forward = (kf <= kb) ? 1 : 0;
+	  if (forward)
+	    {
+		/* forward step: upward Edges */
+		ch_heap_pop (&fwd, &dist, &node);
+		if (dist > ch->DistFwd[node])
+		    continue;	/* stale item */
+		for (i = ch->UpIndex[node]; i < ch->UpIndex[node + 1]; i++)
+		  {
+		      e = ch->Up[i];
+		      pA = VROUTE_CH_EDGE (graph, ch, e);
+		      next = pA->NodeTo;
+		      nd = dist + pA->Cost;
+		      if (nd < ch->DistFwd[next])
+			{
+			    ch_touch (ch, next);
+			    ch->DistFwd[next] = nd;
+			    ch->PrevFwd[next] = e;
+			    if (!ch_heap_push (&fwd, nd, next))
+				goto error;
+			    if (ch->DistBwd[next] != DBL_MAX
+				&& nd + ch->DistBwd[next] < best)
+			      {
+				  best = nd + ch->DistBwd[next];
+				  meet = next;
+			      }
+			}
+		  }
+	    }
+	  else
+	    {
+		/* backward step: downward Edges in reverse */
+		ch_heap_pop (&bwd, &dist, &node);
+		if (dist > ch->DistBwd[node])
+		    continue;	/* stale item */
+		for (i = ch->DownIndex[node]; i < ch->DownIndex[node + 1];
+		     i++)
+		  {
+		      e = ch->Down[i];
+		      pA = VROUTE_CH_EDGE (graph, ch, e);
+		      next = pA->NodeFrom;
+		      nd = dist + pA->Cost;
+		      if (nd < ch->DistBwd[next])
+			{
+			    ch_touch (ch, next);
+			    ch->DistBwd[next] = nd;
+			    ch->PrevBwd[next] = e;
+			    if (!ch_heap_push (&bwd, nd, next))
+				goto error;
+			    if (ch->DistFwd[next] != DBL_MAX
+				&& nd + ch->DistFwd[next] < best)
+			      {
+				  best = nd + ch->DistFwd[next];
+				  meet = next;
+			      }
+			}
+		  }
+	    }
+      }
+    if (fwd.Items != NULL)
+	free (fwd.Items);
+    fwd.Items = NULL;
+    if (bwd.Items != NULL)
+	free (bwd.Items);
+    bwd.Items = NULL;
+
+    if (meet >= 0)
+      {
+	  /* collecting the CH Edges: forward half (reversed) */
+	  int max_path = 64;
+	  path = malloc (sizeof (int) * max_path);
+	  if (path == NULL)
+	      goto error;
+	  node = meet;
+	  while (node != from)
+	    {
+		if (n_path == max_path)
+		  {
+		      new_path = realloc (path, sizeof (int) * max_path * 2);
+		      if (new_path == NULL)
+			  goto error;
+		      path = new_path;
+		      max_path *= 2;
+		  }
+		e = ch->PrevFwd[node];
+		path[n_path++] = e;
+		node = VROUTE_CH_EDGE (graph, ch, e)->NodeFrom;
+	    }
+	  n_fwd = n_path;
+	  for (i = 0; i < n_fwd / 2; i++)
+	    {
+		e = path[i];
+		path[i] = path[n_fwd - 1 - i];
+		path[n_fwd - 1 - i] = e;
+	    }
+	  /* backward half */
+	  node = meet;
+	  while (node != to)
+	    {
+		if (n_path == max_path)
+		  {
+		      new_path = realloc (path, sizeof (int) * max_path * 2);
+		      if (new_path == NULL)
+			  goto error;
+		      path = new_path;
+		      max_path *= 2;
+		  }
+		e = ch->PrevBwd[node];
+		path[n_path++] = e;
+		node = VROUTE_CH_EDGE (graph, ch, e)->NodeTo;
+	    }
+	  /* unpacking the Shortcuts */
+	  for (i = 0; i < n_path; i++)
+	    {
+		if (!ch_unpack_edge (graph, path[i], &result, &count, &max))
+		    goto error;
+	    }
+	  free (path);
+	  path = NULL;
+      }
+    ch_reset (ch);
+    if (result == NULL)
+      {
+	  result = malloc (sizeof (RouteLinkPtr));
+	  if (result == NULL)
+	      return NULL;
+      }
+    *ll = count;
+    return result;
+
+  error:
+    if (fwd.Items != NULL)
+	free (fwd.Items);
+    if (bwd.Items != NULL)
+	free (bwd.Items);
+    if (path != NULL)
+	free (path);
+    if (result != NULL)
+	free (result);
+    ch_reset (ch);
+    return NULL;
+}
+
+/* END of Contraction Hierarchies Shortest Path implementation */
+
+/*
+/
+/  implementation of the many-to-many Cost Matrix
+/
+/  no path is ever reconstructed: Dijkstra runs a one-to-many search
+/  from each origin, stopping as soon as all the destinations have
+/  been settled; on a network supporting Contraction Hierarchies the
+/  bucket-based algorithm is used instead: an upward backward search
+/  from each destination leaves a (destination, cost) entry into the
+/  bucket of every reached Node, then an upward forward search from
+/  each origin simply scans the buckets of the reached Nodes
+/
+*/
+
+typedef struct MatrixBucketStruct
+{
+/* a Cost Matrix bucket entry */
+    int Node;
+    int Target;
+    double Cost;
+} MatrixBucket;
+typedef MatrixBucket *MatrixBucketPtr;
+
+static int
+matrix_dijkstra (RoutingPtr graph, RoutingMultiDestPtr origins,
+		 RoutingMultiDestPtr destinations, double *matrix)
+{
+/* computing the Cost Matrix - one-to-many Dijkstra searches */
+    int num_nodes = graph->NumNodes;
+    double *dist = malloc (sizeof (double) * num_nodes);
+    int *touched = malloc (sizeof (int) * num_nodes);
+    char *targets = calloc (num_nodes, sizeof (char));
+    int retval = 0;
+    int num_touched;
+    int num_targets = 0;
+    int remaining;
+    CHHeap heap;
+    RouteNodePtr pN;
+    RouteLinkPtr pA;
+    double d;
+    double nd;
+    int node;
+    int next;
+    int i;
+    int j;
+    int k;
+
+    heap.Items = NULL;
+    heap.Count = 0;
+    heap.Max = 0;
+    if (dist == NULL || touched == NULL || targets == NULL)
+	goto stop;
+    for (i = 0; i < num_nodes; i++)
+	dist[i] = DBL_MAX;
+    for (j = 0; j < destinations->Items; j++)
+      {
+	  pN = *(destinations->To + j);
+	  if (pN != NULL && !targets[pN->InternalIndex])
+	    {
+		targets[pN->InternalIndex] = 1;
+		num_targets++;
+	    }
+      }
+    for (i = 0; i < origins->Items; i++)
+      {
+	  pN = *(origins->To + i);
+	  if (pN == NULL)
+	      continue;
+	  remaining = num_targets;
+	  num_touched = 0;
+	  heap.Count = 0;
+	  dist[pN->InternalIndex] = 0.0;
+	  touched[num_touched++] = pN->InternalIndex;
+	  if (!ch_heap_push (&heap, 0.0, pN->InternalIndex))
+	      goto stop;
+	  while (heap.Count > 0 && remaining > 0)
+	    {
+		ch_heap_pop (&heap, &d, &node);
+		if (d > dist[node])
+		    continue;	/* stale item */
+		if (targets[node])
+		    remaining--;
+		pN = graph->Nodes + node;
+		for (k = 0; k < pN->NumLinks; k++)
+		  {
+		      pA = graph->Links + pN->FirstLink + k;
+		      next = pA->NodeTo;
+		      nd = d + pA->Cost;
+		      if (nd < dist[next])
+			{
+			    if (dist[next] == DBL_MAX)
+				touched[num_touched++] = next;
+			    dist[next] = nd;
+			    if (!ch_heap_push (&heap, nd, next))
+				goto stop;
+			}
+		  }
+	    }
+	  for (j = 0; j < destinations->Items; j++)
+	    {
+		pN = *(destinations->To + j);
+		if (pN != NULL && dist[pN->InternalIndex] != DBL_MAX)
+		    matrix[(i * destinations->Items) + j] =
+			dist[pN->InternalIndex];
+	    }
+	  for (k = 0; k < num_touched; k++)
+	      dist[touched[k]] = DBL_MAX;
+      }
+    retval = 1;
+
+  stop:
+    if (heap.Items != NULL)
+	free (heap.Items);
+    if (dist != NULL)
+	free (dist);
+    if (touched != NULL)
+	free (touched);
+    if (targets != NULL)
+	free (targets);
+    return retval;
+}
+
+static int
+matrix_ch (RoutingPtr graph, RoutingMultiDestPtr origins,
+	   RoutingMultiDestPtr destinations, double *matrix)
+{
+/* computing the Cost Matrix - bucket-based CH many-to-many */
+    RoutingCHPtr ch = graph->CH;
+    int num_nodes = graph->NumNodes;
+    MatrixBucketPtr buckets = NULL;
+    MatrixBucketPtr sorted = NULL;
+    int num_buckets = 0;
+    int max_buckets = 0;
+    int *bucket_index = NULL;
+    int *cursor = NULL;
+    int retval = 0;
+    CHHeap heap;
+    RouteNodePtr pN;
+    RouteLinkPtr pA;
+    double d;
+    double nd;
+    double *cell;
+    int node;
+    int next;
+    int i;
+    int j;
+    int k;
+    int e;
+
+    heap.Items = NULL;
+    heap.Count = 0;
+    heap.Max = 0;
+
+/* backward searches: filling the buckets */
+    for (j = 0; j < destinations->Items; j++)
+      {
+	  pN = *(destinations->To + j);
+	  if (pN == NULL)
+	      continue;
+	  heap.Count = 0;
+	  ch_touch (ch, pN->InternalIndex);
+	  ch->DistBwd[pN->InternalIndex] = 0.0;
+	  if (!ch_heap_push (&heap, 0.0, pN->InternalIndex))
+	      goto stop;
+	  while (heap.Count > 0)
+	    {
+		ch_heap_pop (&heap, &d, &node);
+		if (d > ch->DistBwd[node])
+		    continue;	/* stale item */
+		if (num_buckets == max_buckets)
+		  {
+		      int max = (max_buckets == 0) ? 1024 : max_buckets * 2;
+		      MatrixBucketPtr grown =
+			  realloc (buckets, sizeof (MatrixBucket) * max);
+		      if (grown == NULL)
+			  goto stop;
+		      buckets = grown;
+		      max_buckets = max;
+		  }
+		buckets[num_buckets].Node = node;
+		buckets[num_buckets].Target = j;
+		buckets[num_buckets].Cost = d;
+		num_buckets++;
+		for (k = ch->DownIndex[node]; k < ch->DownIndex[node + 1]; k++)
+		  {
+		      e = ch->Down[k];
+		      pA = VROUTE_CH_EDGE (graph, ch, e);
+		      next = pA->NodeFrom;
+		      nd = d + pA->Cost;
+		      if (nd < ch->DistBwd[next])
+			{
+			    ch_touch (ch, next);
+			    ch->DistBwd[next] = nd;
+			    if (!ch_heap_push (&heap, nd, next))
+				goto stop;
+			}
+		  }
+	    }
+	  ch_reset (ch);
+      }
+
+/* grouping the buckets by Node */
+    bucket_index = calloc (num_nodes + 1, sizeof (int));
+    sorted = malloc (sizeof (MatrixBucket) * (num_buckets + 1));
+    cursor = malloc (sizeof (int) * num_nodes);
+    if (bucket_index == NULL || sorted == NULL || cursor == NULL)
+	goto stop;
+    for (k = 0; k < num_buckets; k++)
+	bucket_index[buckets[k].Node + 1] += 1;
+    for (i = 0; i < num_nodes; i++)
+	bucket_index[i + 1] += bucket_index[i];
+    memcpy (cursor, bucket_index, sizeof (int) * num_nodes);
+    for (k = 0; k < num_buckets; k++)
+	sorted[cursor[buckets[k].Node]++] = buckets[k];
+    free (cursor);
+    cursor = NULL;
+    if (buckets != NULL)
+	free (buckets);
+    buckets = NULL;
+
+/* forward searches: scanning the buckets */
+    for (i = 0; i < origins->Items; i++)
+      {
+	  pN = *(origins->To + i);
+	  if (pN == NULL)
+	      continue;
+	  heap.Count = 0;
+	  ch_touch (ch, pN->InternalIndex);
+	  ch->DistFwd[pN->InternalIndex] = 0.0;
+	  if (!ch_heap_push (&heap, 0.0, pN->InternalIndex))
+	      goto stop;
+	  while (heap.Count > 0)
+	    {
+		ch_heap_pop (&heap, &d, &node);
+		if (d > ch->DistFwd[node])
+		    continue;	/* stale item */
+		for (k = bucket_index[node]; k < bucket_index[node + 1]; k++)
+		  {
+		      cell =
+			  matrix + (i * destinations->Items) + sorted[k].Target;
+		      nd = d + sorted[k].Cost;
+		      if (*cell < 0.0 || nd < *cell)
+			  *cell = nd;
+		  }
+		for (k = ch->UpIndex[node]; k < ch->UpIndex[node + 1]; k++)
+		  {
+		      e = ch->Up[k];
+		      pA = VROUTE_CH_EDGE (graph, ch, e);
+		      next = pA->NodeTo;
+		      nd = d + pA->Cost;
+		      if (nd < ch->DistFwd[next])
+			{
+			    ch_touch (ch, next);
+			    ch->DistFwd[next] = nd;
+			    if (!ch_heap_push (&heap, nd, next))
+				goto stop;
+			}
+		  }
+	    }
+	  ch_reset (ch);
+      }
+    retval = 1;
+
+  stop:
+    ch_reset (ch);
+    if (heap.Items != NULL)
+	free (heap.Items);
+    if (buckets != NULL)
+	free (buckets);
+    if (cursor != NULL)
+	free (cursor);
+    if (sorted != NULL)
+	free (sorted);
+    if (bucket_index != NULL)
+	free (bucket_index);
+    return retval;
+}
+
+static int
+matrix_solve (int algorithm, RoutingPtr graph, MultiSolutionPtr multiSolution)
+{
+/* computing a many-to-many Cost Matrix solution */
+    int i;
+    int ret;
+    int cells;
+    RoutingMultiDestPtr origins = multiSolution->MultiFrom;
+    RoutingMultiDestPtr destinations = multiSolution->MultiTo;
+    multiSolution->MatrixCells = 0;
+    multiSolution->CurrentCell = 0;
+    cells = origins->Items * destinations->Items;
+    if (cells <= 0)
+	return 1;		/* empty Matrix */
+    multiSolution->Matrix = malloc (sizeof (double) * cells);
+    if (multiSolution->Matrix == NULL)
+	return 0;
+    for (i = 0; i < cells; i++)
+	multiSolution->Matrix[i] = -1.0;	/* unreachable */
+    if (algorithm == VROUTE_CH_ALGORITHM && graph->CH != NULL)
+	ret = matrix_ch (graph, origins, destinations, multiSolution->Matrix);
+    else
+	ret =
+	    matrix_dijkstra (graph, origins, destinations,
+			     multiSolution->Matrix);
+    if (!ret)
+      {
+	  /* insufficient memory: no partial Matrix is ever returned */
+	  free (multiSolution->Matrix);
+	  multiSolution->Matrix = NULL;
+	  return 0;
+      }
+    multiSolution->MatrixCells = cells;
+    return 1;
 }
 
+/* END of Cost Matrix implementation */
+
 static int
 cmp_nodes_id (const void *p1, const void *p2)
 {
@@ -2812,13 +3545,24 @@ static RouteNodePtr
 find_node_by_code (RoutingPtr graph, const char *code)
 {
 /* searching a Node (by Code) into the sorted list */
-    RouteNodePtr ret;
-    RouteNode pN;
-    pN.Code = (char *) code;
-    ret =
-	bsearch (&pN, graph->Nodes, graph->NumNodes, sizeof (RouteNode),
-		 cmp_nodes_code);
-    return ret;
+    int lo = 0;
+    int hi = graph->NumNodes - 1;
+    int mid;
+    int cmp;
+    RouteNodePtr pN;
+    while (lo <= hi)
+      {
+	  mid = lo + ((hi - lo) / 2);
+	  pN = graph->Nodes + mid;
+	  cmp = strcmp (VROUTE_NODE_CODE (graph, pN), code);
+	  if (cmp == 0)
+	      return pN;
+	  if (cmp < 0)
+	      lo = mid + 1;
+	  else
+	      hi = mid - 1;
+      }
+    return NULL;
 }
 
 static RouteNodePtr
@@ -3155,6 +3899,10 @@ delete_multiSolution (MultiSolutionPtr multiSolution)
 	return;
     if (multiSolution->MultiTo != NULL)
 	vroute_delete_multiple_destinations (multiSolution->MultiTo);
+    if (multiSolution->MultiFrom != NULL)
+	vroute_delete_multiple_destinations (multiSolution->MultiFrom);
+    if (multiSolution->Matrix != NULL)
+	free (multiSolution->Matrix);
     pS = multiSolution->First;
     while (pS != NULL)
       {
@@ -3215,6 +3963,10 @@ reset_multiSolution (MultiSolutionPtr multiSolution)
 	return;
     if (multiSolution->MultiTo != NULL)
 	vroute_delete_multiple_destinations (multiSolution->MultiTo);
+    if (multiSolution->MultiFrom != NULL)
+	vroute_delete_multiple_destinations (multiSolution->MultiFrom);
+    if (multiSolution->Matrix != NULL)
+	free (multiSolution->Matrix);
     pS = multiSolution->First;
     while (pS != NULL)
       {
@@ -3256,6 +4008,10 @@ reset_multiSolution (MultiSolutionPtr multiSolution)
       }
     multiSolution->From = NULL;
     multiSolution->MultiTo = NULL;
+    multiSolution->MultiFrom = NULL;
+    multiSolution->Matrix = NULL;
+    multiSolution->MatrixCells = 0;
+    multiSolution->CurrentCell = 0;
     multiSolution->First = NULL;
     multiSolution->Last = NULL;
     multiSolution->FirstRow = NULL;
@@ -3278,6 +4034,10 @@ alloc_multiSolution (void)
     MultiSolutionPtr p = malloc (sizeof (MultiSolution));
     p->From = NULL;
     p->MultiTo = NULL;
+    p->MultiFrom = NULL;
+    p->Matrix = NULL;
+    p->MatrixCells = 0;
+    p->CurrentCell = 0;
     p->First = NULL;
     p->Last = NULL;
     p->FirstRow = NULL;
@@ -3660,6 +4420,25 @@ astar_solve (sqlite3 * handle, int options, RoutingPtr graph,
     build_multi_solution (multiSolution);
 }
 
+static void
+ch_solve (sqlite3 * handle, int options, RoutingPtr graph,
+	  MultiSolutionPtr multiSolution)
+{
+/* computing a Contraction Hierarchies Shortest Path solution */
+    int cnt;
+    RouteLinkPtr *shortest_path;
+    ShortestPathSolutionPtr solution;
+    RouteNodePtr to = findSingleTo (multiSolution->MultiTo);
+    if (to == NULL)
+	return;
+    shortest_path = ch_shortest_path (graph, multiSolution->From, to, &cnt);
+    if (shortest_path == NULL)
+	return;
+    solution = add2multiSolution (multiSolution, multiSolution->From, to);
+    build_solution (handle, options, graph, solution, shortest_path, cnt);
+    build_multi_solution (multiSolution);
+}
+
 static void
 dijkstra_multi_solve (sqlite3 * handle, int options, RoutingPtr graph,
 		      RoutingNodesPtr routing, MultiSolutionPtr multiSolution)
@@ -4340,11 +5119,12 @@ tsp_ga_compute_route (sqlite3 * handle, int options, RouteNodePtr origin,
     to->Next = 0;
     if (graph->NodeCode)
       {
-	  int len = strlen (destination->Code);
+	  const char *code = VROUTE_NODE_CODE (graph, destination);
+	  int len = strlen (code);
 	  to->Ids = NULL;
 	  to->Codes = malloc (sizeof (char *));
 	  *(to->Codes + 0) = malloc (len + 1);
-	  strcpy (*(to->Codes + 0), destination->Code);
+	  strcpy (*(to->Codes + 0), code);
       }
     else
       {
@@ -4840,422 +5620,2040 @@ tsp_ga_solve (sqlite3 * handle, int options, RoutingPtr graph,
     destroy_tsp_ga_population (ga);
 }
 
-static void
-network_free (RoutingPtr p)
+static sqlite3_uint64
+tsp_ga_mt_random (TspGaIslandPtr island)
 {
-/* memory cleanup; freeing any allocation for the network struct */
-    RouteNodePtr pN;
-    int i;
-    if (!p)
-	return;
-    for (i = 0; i < p->NumNodes; i++)
-      {
-	  pN = p->Nodes + i;
-	  if (pN->Code)
-	      free (pN->Code);
-	  if (pN->Links)
-	      free (pN->Links);
-      }
-    if (p->Nodes)
-	free (p->Nodes);
-    if (p->TableName)
-	free (p->TableName);
-    if (p->FromColumn)
-	free (p->FromColumn);
-    if (p->ToColumn)
-	free (p->ToColumn);
-    if (p->GeometryColumn)
-	free (p->GeometryColumn);
-    if (p->NameColumn)
-	free (p->NameColumn);
-    free (p);
+/* local PRNG (xorshift64*): each thread owns its own state */
+    sqlite3_uint64 x = island->Random;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    island->Random = x;
+    return x * 2685821657736338717ULL;
 }
 
-static RoutingPtr
-network_init (const unsigned char *blob, int size)
+static int
+tsp_ga_mt_random_index (TspGaIslandPtr island, int count)
 {
-/* parsing the HEADER block */
-    RoutingPtr graph;
-    int net64;
-    int aStar = 0;
-    int nodes;
-    int node_code;
-    int max_code_length;
-    int endian_arch = gaiaEndianArch ();
-    const char *table;
-    const char *from;
-    const char *to;
-    const char *geom;
-    const char *name = NULL;
-    double a_star_coeff = 1.0;
-    int len;
+/* returns a random index in the range [0, count) */
+    return (int) ((tsp_ga_mt_random (island) >> 11) % (sqlite3_uint64) count);
+}
+
+static void
+tsp_ga_mt_seed (TspGaIslandPtr island, sqlite3_uint64 seed)
+{
+/* seeding the local PRNG (splitmix64) */
+    sqlite3_uint64 z = seed + (0x9E3779B97F4A7C15ULL * (island->Index + 1));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    if (z == 0)
+	z = 0x9E3779B97F4A7C15ULL;	/* xorshift never leaves zero */
+    island->Random = z;
+}
+
+static double
+tsp_ga_mt_tour_cost (TspGaMtPtr shared, const int *genes)
+{
+/* computing the cost of a closed tour */
+    int j;
+    int n = shared->Cities;
+    double cost = 0.0;
+    for (j = 0; j < n; j++)
+      {
+	  int to = (j + 1 < n) ? genes[j + 1] : genes[0];
+	  cost += shared->Matrix[(genes[j] * n) + to];
+      }
+    return cost;
+}
+
+static void
+tsp_ga_mt_nn_tour (TspGaMtPtr shared, int start, int *genes, char *taken)
+{
+/* building a Nearest Neighbor tour starting from the given City */
+    int j;
+    int k;
+    int n = shared->Cities;
+    int current = start;
+    memset (taken, 0, n);
+    taken[start] = 1;
+    genes[0] = start;
+    for (j = 1; j < n; j++)
+      {
+	  int best = -1;
+	  double min = DBL_MAX;
+	  const double *row = shared->Matrix + (current * n);
+	  for (k = 0; k < n; k++)
+	    {
+		if (taken[k])
+		    continue;
+		if (best < 0 || row[k] < min)
+		  {
+		      best = k;
+		      min = row[k];
+		  }
+	    }
+	  taken[best] = 1;
+	  genes[j] = best;
+	  current = best;
+      }
+}
+
+static void
+tsp_ga_mt_mutation (TspGaIslandPtr island, int *genes)
+{
+/* introducing a random mutation (swapping two Cities) */
+    int n = island->Shared->Cities;
+    int idx1 = tsp_ga_mt_random_index (island, n);
+    int idx2 = tsp_ga_mt_random_index (island, n);
+    int city = genes[idx1];
+    genes[idx1] = genes[idx2];
+    genes[idx2] = city;
+}
+
+static double
+tsp_ga_mt_crossover (TspGaIslandPtr island, int *hybrid, int mutation1,
+		     int mutation2)
+{
+/* creating a Crossover solution (Order Crossover) */
+    int j;
+    int k;
+    int lo;
+    int hi;
+    int n = island->Shared->Cities;
+    int idx1 = tsp_ga_mt_random_index (island, island->Count);
+    int idx2 = tsp_ga_mt_random_index (island, island->Count - 1);
+    if (idx2 >= idx1)
+	idx2++;			/* always choosing two distinct parents */
+
+    memcpy (island->Parent1, island->Genes + (idx1 * n), sizeof (int) * n);
+    memcpy (island->Parent2, island->Genes + (idx2 * n), sizeof (int) * n);
+    if (mutation1)
+	tsp_ga_mt_mutation (island, island->Parent1);
+    if (mutation2)
+	tsp_ga_mt_mutation (island, island->Parent2);
+
+/* step #1: inheritance from the first parent */
+    lo = tsp_ga_mt_random_index (island, n);
+    hi = tsp_ga_mt_random_index (island, n);
+    if (lo > hi)
+      {
+	  j = lo;
+	  lo = hi;
+	  hi = j;
+      }
+    memset (island->Taken, 0, n);
+    for (j = lo; j <= hi; j++)
+      {
+	  hybrid[j] = island->Parent1[j];
+	  island->Taken[hybrid[j]] = 1;
+      }
+
+/* step #2: inheritance from the second parent */
+    k = 0;
+    for (j = 0; j < n; j++)
+      {
+	  int city = island->Parent2[j];
+	  if (island->Taken[city])
+	      continue;
+	  if (k == lo)
+	      k = hi + 1;
+	  hybrid[k++] = city;
+      }
+    return tsp_ga_mt_tour_cost (island->Shared, hybrid);
+}
+
+static void
+tsp_ga_mt_fitness (TspGaIslandPtr island)
+{
+/* evaluating the comparative fitness of parents and offsprings */
+    int j;
     int i;
-    const unsigned char *ptr;
-    if (size < 9)
-	return NULL;
-    if (*(blob + 0) == GAIA_NET_START)	/* signature - legacy format using 32bit ints */
-	net64 = 0;
-    else if (*(blob + 0) == GAIA_NET64_START)	/* signature - format using 64bit ints */
-	net64 = 1;
-    else if (*(blob + 0) == GAIA_NET64_A_STAR_START)	/* signature - format using 64bit ints AND supporting A* */
+    int n = island->Shared->Cities;
+
+    for (j = 0; j < island->Count; j++)
       {
-	  net64 = 1;
-	  aStar = 1;
+	  int index = -1;
+	  int already_defined = 0;
+	  double max_cost = 0.0;
+	  double cost = island->OffspringCosts[j];
+	  for (i = 0; i < island->Count; i++)
+	    {
+		/* searching the worst parent */
+		if (index < 0 || island->Costs[i] > max_cost)
+		  {
+		      max_cost = island->Costs[i];
+		      index = i;
+		  }
+		if (island->Costs[i] == cost)
+		    already_defined = 1;
+	    }
+	  if (max_cost > cost && !already_defined)
+	    {
+		/* inserting the new hybrid by replacing the worst parent */
+		memcpy (island->Genes + (index * n),
+			island->Offsprings + (j * n), sizeof (int) * n);
+		island->Costs[index] = cost;
+	    }
+      }
+}
+
+static void
+tsp_ga_mt_breed_worker (void *arg)
+{
+/* thread function: breeding an island for a number of generations */
+    TspGaIslandPtr island = (TspGaIslandPtr) arg;
+    TspGaMtPtr shared = island->Shared;
+    int n = shared->Cities;
+    int g;
+    int i;
+
+    if (island->Generation == 0)
+      {
+	  /* initializing the island using NN solutions */
+	  for (i = 0; i < island->Count; i++)
+	    {
+		int *genes = island->Genes + (i * n);
+		int slot = (island->Index * island->Count) + i;
+		tsp_ga_mt_nn_tour (shared, slot % n, genes, island->Taken);
+		if (slot >= n)
+		    tsp_ga_mt_mutation (island, genes);
+		island->Costs[i] = tsp_ga_mt_tour_cost (shared, genes);
+	    }
+      }
+
+    for (g = 0; g < island->Generations; g++)
+      {
+	  /* sexual reproduction and darwinian selection */
+	  for (i = 0; i < island->Count; i++)
+	    {
+		int count = (island->Generation * island->Count) + i + 1;
+		island->OffspringCosts[i] =
+		    tsp_ga_mt_crossover (island,
+					 island->Offsprings + (i * n),
+					 count % 13 == 0, count % 16 == 0);
+	    }
+	  tsp_ga_mt_fitness (island);
+	  island->Generation += 1;
+      }
+}
+
+static void
+tsp_ga_mt_matrix_worker (void *arg)
+{
+/* thread function: computing some rows of the distance matrix */
+    TspGaIslandPtr island = (TspGaIslandPtr) arg;
+    TspGaMtPtr shared = island->Shared;
+    RoutingMultiDest origins;
+    RoutingMultiDest destinations;
+
+    if (island->Rows <= 0)
+	return;
+    origins.Items = island->Rows;
+    origins.To = shared->Nodes + island->FirstRow;
+    destinations.Items = shared->Cities;
+    destinations.To = shared->Nodes;
+    if (!matrix_dijkstra (shared->Graph, &origins, &destinations,
+			  shared->Matrix + (island->FirstRow * shared->Cities)))
+	island->Failed = 1;
+}
+
+static void
+tsp_ga_mt_run (TspGaIslandPtr islands, int count, void (*func) (void *arg))
+{
+/* running a task on all islands; the first one uses the current thread */
+    int i;
+    for (i = 1; i < count; i++)
+	islands[i].Thread = splite_thread_create (func, islands + i);
+    func (islands);
+    for (i = 1; i < count; i++)
+      {
+	  if (islands[i].Thread == NULL)
+	    {
+		/* unable to start a thread: running in the current one */
+		func (islands + i);
+	    }
+	  else
+	      splite_thread_join (islands[i].Thread);
+	  islands[i].Thread = NULL;
+      }
+}
+
+static int
+tsp_ga_mt_best (TspGaIslandPtr island)
+{
+/* returns the index of the best tour in an island */
+    int i;
+    int index = 0;
+    for (i = 1; i < island->Count; i++)
+      {
+	  if (island->Costs[i] < island->Costs[index])
+	      index = i;
+      }
+    return index;
+}
+
+static void
+tsp_ga_mt_migrate (TspGaIslandPtr islands, int count)
+{
+/* ring migration: each island's best tour replaces the next one's worst */
+    int i;
+    int j;
+    int n = islands->Shared->Cities;
+    int *best = malloc (sizeof (int) * count);
+    if (best == NULL)
+	return;			/* skipping this migration */
+    for (i = 0; i < count; i++)
+	best[i] = tsp_ga_mt_best (islands + i);
+    for (i = 0; i < count; i++)
+      {
+	  TspGaIslandPtr from = islands + i;
+	  TspGaIslandPtr to = islands + ((i + 1) % count);
+	  int index = 0;
+	  int already_defined = 0;
+	  double cost = from->Costs[best[i]];
+	  for (j = 0; j < to->Count; j++)
+	    {
+		if (to->Costs[j] > to->Costs[index])
+		    index = j;
+		if (to->Costs[j] == cost)
+		    already_defined = 1;
+	    }
+	  if (to->Costs[index] > cost && !already_defined)
+	    {
+		memcpy (to->Genes + (index * n), from->Genes + (best[i] * n),
+			sizeof (int) * n);
+		to->Costs[index] = cost;
+	    }
+      }
+    free (best);
+}
+
+static void
+tsp_ga_mt_solve (sqlite3 * handle, int options, RoutingPtr graph,
+		 RoutingNodesPtr routing, MultiSolutionPtr multiSolution,
+		 int max_threads)
+{
+/* computing a multi-threaded Dijkstra TSP GA Solution */
+    int i;
+    int j;
+    int n;
+    int n_workers;
+    int n_islands;
+    int island_size;
+    int generations;
+    int ok = 1;
+    sqlite3_uint64 seed;
+    TspGaMt shared;
+    TspGaIslandPtr islands = NULL;
+    TspGaIslandPtr island;
+    TspGaSolutionPtr bestSolution;
+    RoutingMultiDestPtr multi;
+    TspTargetsPtr targets;
+
+    if (multiSolution == NULL)
+	return;
+    multi = multiSolution->MultiTo;
+    if (multi == NULL)
+	return;
+    shared.Nodes = NULL;
+    shared.Matrix = NULL;
+    n_islands = 0;
+
+    targets = tsp_ga_permuted_targets (multiSolution->From, multi, -1);
+    for (j = 0; j < targets->Count; j++)
+      {
+	  /* checking for undefined targets */
+	  if (*(targets->To + j) == NULL)
+	    {
+		int k;
+		for (k = 0; k < targets->Count; k++)
+		  {
+		      /* maskinkg unreachable targets */
+		      *(targets->Found + k) = 'Y';
+		  }
+		build_tsp_illegal_solution (multiSolution, targets);
+		destroy_tsp_targets (targets);
+		return;
+	    }
+      }
+
+/* City #0 is the origin, all targets follow */
+    n = multi->Items + 1;
+    shared.Graph = graph;
+    shared.Cities = n;
+    shared.Nodes = malloc (sizeof (RouteNodePtr) * n);
+    shared.Matrix = malloc (sizeof (double) * n * n);
+    if (shared.Nodes == NULL || shared.Matrix == NULL)
+	goto no_memory;
+    shared.Nodes[0] = multiSolution->From;
+    for (j = 0; j < multi->Items; j++)
+	shared.Nodes[j + 1] = *(multi->To + j);
+    for (i = 0; i < n * n; i++)
+	shared.Matrix[i] = DBL_MAX;
+
+    n_workers = max_threads;
+    if (n_workers > n)
+	n_workers = n;
+    n_islands = n / VROUTE_TSP_GA_MT_ISLAND;
+    if (n_islands > max_threads)
+	n_islands = max_threads;
+    if (n_islands < 1)
+	n_islands = 1;
+    islands = calloc ((n_workers > n_islands) ? n_workers : n_islands,
+		      sizeof (TspGaIsland));
+    if (islands == NULL)
+	goto no_memory;
+
+/* computing all City-to-City distances (costs) at once */
+    for (i = 0; i < n_workers; i++)
+      {
+	  island = islands + i;
+	  memset (island, 0, sizeof (TspGaIsland));
+	  island->Shared = &shared;
+	  island->Index = i;
+	  island->FirstRow = (int) (((sqlite3_int64) n * i) / n_workers);
+	  island->Rows =
+	      (int) (((sqlite3_int64) n * (i + 1)) / n_workers) -
+	      island->FirstRow;
+      }
+    tsp_ga_mt_run (islands, n_workers, tsp_ga_mt_matrix_worker);
+    for (i = 0; i < n_workers; i++)
+      {
+	  /* an incomplete matrix would report false unreachable targets */
+	  if (islands[i].Failed)
+	      goto no_memory;
+      }
+    for (j = 1; j < n; j++)
+      {
+	  /* checking for unreachable targets */
+	  *(targets->Found + j - 1) = 'Y';
+	  for (i = 0; i < n; i++)
+	    {
+		if (i == j)
+		    continue;
+		if (shared.Matrix[(i * n) + j] == DBL_MAX
+		    || shared.Matrix[(j * n) + i] == DBL_MAX)
+		  {
+		      *(targets->Found + j - 1) = 'N';
+		      ok = 0;
+		      break;
+		  }
+	    }
+      }
+    if (!ok)
+      {
+	  build_tsp_illegal_solution (multiSolution, targets);
+	  destroy_tsp_targets (targets);
+	  goto stop;
+      }
+    destroy_tsp_targets (targets);
+
+/* initializing the islands (one sub-population for each thread) */
+    island_size = (n + n_islands - 1) / n_islands;
+    if (island_size < VROUTE_TSP_GA_MT_ISLAND)
+	island_size = VROUTE_TSP_GA_MT_ISLAND;
+    sqlite3_randomness (sizeof (sqlite3_uint64), &seed);
+    for (i = 0; i < n_islands; i++)
+      {
+	  island = islands + i;
+	  memset (island, 0, sizeof (TspGaIsland));
+	  island->Shared = &shared;
+	  island->Index = i;
+	  island->Count = island_size;
+	  island->Genes = malloc (sizeof (int) * n * island_size);
+	  island->Costs = malloc (sizeof (double) * island_size);
+	  island->Offsprings = malloc (sizeof (int) * n * island_size);
+	  island->OffspringCosts = malloc (sizeof (double) * island_size);
+	  island->Parent1 = malloc (sizeof (int) * n);
+	  island->Parent2 = malloc (sizeof (int) * n);
+	  island->Taken = malloc (n);
+	  if (island->Genes == NULL || island->Costs == NULL
+	      || island->Offsprings == NULL || island->OffspringCosts == NULL
+	      || island->Parent1 == NULL || island->Parent2 == NULL
+	      || island->Taken == NULL)
+	    {
+		n_islands = i + 1;	/* releasing just the initialized ones */
+		goto stop;
+	    }
+	  tsp_ga_mt_seed (island, seed);
+      }
+
+    generations = VROUTE_TSP_GA_MAX_ITERATIONS + 1;
+    while (generations > 0)
+      {
+	  /* breeding all islands in parallel, then migrating */
+	  int epoch = VROUTE_TSP_GA_MT_EPOCH;
+	  if (epoch > generations)
+	      epoch = generations;
+	  for (i = 0; i < n_islands; i++)
+	      islands[i].Generations = epoch;
+	  tsp_ga_mt_run (islands, n_islands, tsp_ga_mt_breed_worker);
+	  if (n_islands > 1)
+	      tsp_ga_mt_migrate (islands, n_islands);
+	  generations -= epoch;
+      }
+
+/* building the TSP GA solution */
+    island = islands;
+    for (i = 1; i < n_islands; i++)
+      {
+	  if (islands[i].Costs[tsp_ga_mt_best (islands + i)] <
+	      island->Costs[tsp_ga_mt_best (island)])
+	      island = islands + i;
+      }
+    j = tsp_ga_mt_best (island);
+    bestSolution = malloc (sizeof (TspGaSolution));
+    if (bestSolution == NULL)
+	goto stop;
+    bestSolution->Cities = n;
+    bestSolution->CitiesFrom = malloc (sizeof (RouteNodePtr) * n);
+    bestSolution->CitiesTo = malloc (sizeof (RouteNodePtr) * n);
+    bestSolution->Costs = malloc (sizeof (double) * n);
+    if (bestSolution->CitiesFrom == NULL || bestSolution->CitiesTo == NULL
+	|| bestSolution->Costs == NULL)
+      {
+	  destroy_tsp_ga_solution (bestSolution);
+	  goto stop;
+      }
+    bestSolution->TotalCost = island->Costs[j];
+    for (i = 0; i < n; i++)
+      {
+	  if (island->Genes[(j * n) + i] == 0)
+	      break;
+      }
+    for (ok = 0; ok < n; ok++)
+      {
+	  /* rotating the tour so to start from the origin */
+	  int from = island->Genes[(j * n) + ((i + ok) % n)];
+	  int to = island->Genes[(j * n) + ((i + ok + 1) % n)];
+	  *(bestSolution->CitiesFrom + ok) = shared.Nodes[from];
+	  *(bestSolution->CitiesTo + ok) = shared.Nodes[to];
+	  *(bestSolution->Costs + ok) = shared.Matrix[(from * n) + to];
+      }
+    targets =
+	build_tsp_ga_solution_targets (multi->Items, multiSolution->From);
+    set_tsp_ga_targets (handle, options, graph, routing, bestSolution,
+			targets);
+    build_tsp_solution (multiSolution, targets, graph->Srid);
+    destroy_tsp_targets (targets);
+    destroy_tsp_ga_solution (bestSolution);
+    goto stop;
+
+  no_memory:
+/* insufficient memory: leaving the solution empty */
+    destroy_tsp_targets (targets);
+
+  stop:
+    for (i = 0; islands != NULL && i < n_islands; i++)
+      {
+	  island = islands + i;
+	  if (island->Genes != NULL)
+	      free (island->Genes);
+	  if (island->Costs != NULL)
+	      free (island->Costs);
+	  if (island->Offsprings != NULL)
+	      free (island->Offsprings);
+	  if (island->OffspringCosts != NULL)
+	      free (island->OffspringCosts);
+	  if (island->Parent1 != NULL)
+	      free (island->Parent1);
+	  if (island->Parent2 != NULL)
+	      free (island->Parent2);
+	  if (island->Taken != NULL)
+	      free (island->Taken);
+      }
+    if (islands != NULL)
+	free (islands);
+    if (shared.Nodes != NULL)
+	free (shared.Nodes);
+    if (shared.Matrix != NULL)
+	free (shared.Matrix);
+}
+
+static void
+network_ch_free (RoutingCHPtr ch)
+{
+/* memory cleanup; freeing the Contraction Hierarchies overlay */
+    if (ch == NULL)
+	return;
+    if (!(ch->Mapped))
+      {
+	  /* these arrays are never owned by a mapped overlay */
+	  if (ch->Ranks)
+	      free (ch->Ranks);
+	  if (ch->Shortcuts)
+	      free (ch->Shortcuts);
+	  if (ch->Children)
+	      free (ch->Children);
+	  if (ch->UpIndex)
+	      free (ch->UpIndex);
+	  if (ch->Up)
+	      free (ch->Up);
+	  if (ch->DownIndex)
+	      free (ch->DownIndex);
+	  if (ch->Down)
+	      free (ch->Down);
+      }
+    if (ch->DistFwd)
+	free (ch->DistFwd);
+    if (ch->PrevFwd)
+	free (ch->PrevFwd);
+    if (ch->DistBwd)
+	free (ch->DistBwd);
+    if (ch->PrevBwd)
+	free (ch->PrevBwd);
+    if (ch->Touched)
+	free (ch->Touched);
+    free (ch);
+}
+
+static void
+network_ch_disable (RoutingPtr graph)
+{
+/* discarding an invalid Contraction Hierarchies overlay */
+    network_ch_free (graph->CH);
+    graph->CH = NULL;
+}
+
+static int
+network_ch_block (RoutingPtr graph, const unsigned char *blob, int size)
+{
+/* parsing a Contraction Hierarchies Block */
+    RoutingCHPtr ch = graph->CH;
+    const unsigned char *in = blob;
+    int first;
+    int count;
+    int i;
+    int from;
+    int to;
+    RouteLinkPtr pA;
+    if (ch == NULL)
+	return 0;
+    if (*in == GAIA_NET_CH_RANKS)
+      {
+	  /* Node ranks */
+	  in++;
+	  if (size < 10)
+	      return 0;
+	  first = gaiaImport32 (in, 1, graph->EndianArch);	/* first Node internal index */
+	  in += 4;
+	  count = gaiaImport32 (in, 1, graph->EndianArch);	/* # Nodes */
+	  in += 4;
+	  if (first < 0 || count < 0 || first > graph->NumNodes - count)
+	      return 0;
+	  if (size != 10 + (count * 4))
+	      return 0;
+	  for (i = first; i < first + count; i++)
+	    {
+		ch->Ranks[i] = gaiaImport32 (in, 1, graph->EndianArch);	/* Node rank */
+		in += 4;
+	    }
       }
     else
+      {
+	  /* Shortcuts */
+	  in++;
+	  if (size < 6)
+	      return 0;
+	  count = gaiaImport32 (in, 1, graph->EndianArch);	/* # Shortcuts */
+	  in += 4;
+	  if (count < 0 || count > ch->NumShortcuts - ch->LoadedShortcuts)
+	      return 0;
+	  if (size != 6 + (count * 24))
+	      return 0;
+	  for (i = 0; i < count; i++)
+	    {
+		from = gaiaImport32 (in, 1, graph->EndianArch);	/* FromNode internal index */
+		in += 4;
+		to = gaiaImport32 (in, 1, graph->EndianArch);	/* ToNode internal index */
+		in += 4;
+		if (from < 0 || from >= graph->NumNodes || to < 0
+		    || to >= graph->NumNodes)
+		    return 0;
+		pA = ch->Shortcuts + ch->LoadedShortcuts;
+		pA->NodeFrom = from;
+		pA->NodeTo = to;
+		pA->LinkRowid = -1;
+		pA->Cost = gaiaImport64 (in, 1, graph->EndianArch);	/* Shortcut Cost */
+		in += 8;
+		ch->Children[ch->LoadedShortcuts * 2] = gaiaImport32 (in, 1, graph->EndianArch);	/* first half */
+		in += 4;
+		ch->Children[(ch->LoadedShortcuts * 2) + 1] = gaiaImport32 (in, 1, graph->EndianArch);	/* second half */
+		in += 4;
+		ch->LoadedShortcuts++;
+	    }
+      }
+    if (*in != GAIA_NET_END)	/* signature */
+	return 0;
+    return 1;
+}
+
+static int
+network_ch_workspace (RoutingPtr graph)
+{
+/* allocating the per-connection CH query workspace */
+    RoutingCHPtr ch = graph->CH;
+    int i;
+    ch->Touched = malloc (sizeof (int) * graph->NumNodes);
+    ch->DistFwd = malloc (sizeof (double) * graph->NumNodes);
+    ch->PrevFwd = malloc (sizeof (int) * graph->NumNodes);
+    ch->DistBwd = malloc (sizeof (double) * graph->NumNodes);
+    ch->PrevBwd = malloc (sizeof (int) * graph->NumNodes);
+    ch->NumTouched = 0;
+    if (ch->Touched == NULL || ch->DistFwd == NULL || ch->PrevFwd == NULL
+	|| ch->DistBwd == NULL || ch->PrevBwd == NULL)
+	return 0;
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  ch->DistFwd[i] = DBL_MAX;
+	  ch->DistBwd[i] = DBL_MAX;
+	  ch->PrevFwd[i] = -1;
+	  ch->PrevBwd[i] = -1;
+      }
+    return 1;
+}
+
+static int
+network_ch_prepare (RoutingPtr graph)
+{
+/* building the upward/downward adjacency of the Contraction Hierarchies */
+    RoutingCHPtr ch = graph->CH;
+    RouteLinkPtr pA;
+    int num_edges;
+    int i;
+    int j;
+    int k;
+    int from;
+    int to;
+    int *cursor;
+    char *seen;
+
+    if (ch->LoadedShortcuts != ch->NumShortcuts)
+	return 0;
+    seen = calloc (graph->NumNodes, sizeof (char));
+    if (seen == NULL)
+	return 0;
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  /* ranks must be a permutation of the Node indices */
+	  k = ch->Ranks[i];
+	  if (k < 0 || k >= graph->NumNodes || seen[k])
+	    {
+		free (seen);
+		return 0;
+	    }
+	  seen[k] = 1;
+      }
+    free (seen);
+    ch->NumArcs = 0;
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  /* Arcs are identified by their position in Node order */
+	  if (graph->Nodes[i].NumLinks > 0
+	      && graph->Nodes[i].FirstLink != ch->NumArcs)
+	      return 0;
+	  ch->NumArcs += graph->Nodes[i].NumLinks;
+      }
+    num_edges = ch->NumArcs + ch->NumShortcuts;
+    for (i = 0; i < ch->NumShortcuts; i++)
+      {
+	  /* each half must precede the Shortcut itself */
+	  for (j = 0; j < 2; j++)
+	    {
+		k = ch->Children[(i * 2) + j];
+		if (k < 0 || k >= ch->NumArcs + i)
+		    return 0;
+	    }
+      }
+
+/* upward Edges are stored on FromNode, downward Edges on ToNode */
+    ch->UpIndex = calloc (graph->NumNodes + 1, sizeof (int));
+    ch->DownIndex = calloc (graph->NumNodes + 1, sizeof (int));
+    if (ch->UpIndex == NULL || ch->DownIndex == NULL)
+	return 0;
+    for (k = 0; k < num_edges; k++)
+      {
+	  pA = VROUTE_CH_EDGE (graph, ch, k);
+	  from = pA->NodeFrom;
+	  to = pA->NodeTo;
+	  if (ch->Ranks[to] > ch->Ranks[from])
+	      ch->UpIndex[from + 1] += 1;
+	  else if (ch->Ranks[from] > ch->Ranks[to])
+	      ch->DownIndex[to + 1] += 1;
+      }
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  ch->UpIndex[i + 1] += ch->UpIndex[i];
+	  ch->DownIndex[i + 1] += ch->DownIndex[i];
+      }
+    ch->Up = malloc (sizeof (int) * (ch->UpIndex[graph->NumNodes] + 1));
+    ch->Down = malloc (sizeof (int) * (ch->DownIndex[graph->NumNodes] + 1));
+    cursor = malloc (sizeof (int) * (graph->NumNodes * 2));
+    if (ch->Up == NULL || ch->Down == NULL || cursor == NULL)
+      {
+	  if (cursor != NULL)
+	      free (cursor);
+	  return 0;
+      }
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  cursor[i * 2] = ch->UpIndex[i];
+	  cursor[(i * 2) + 1] = ch->DownIndex[i];
+      }
+    for (k = 0; k < num_edges; k++)
+      {
+	  pA = VROUTE_CH_EDGE (graph, ch, k);
+	  from = pA->NodeFrom;
+	  to = pA->NodeTo;
+	  if (ch->Ranks[to] > ch->Ranks[from])
+	      ch->Up[cursor[from * 2]++] = k;
+	  else if (ch->Ranks[from] > ch->Ranks[to])
+	      ch->Down[cursor[(to * 2) + 1]++] = k;
+      }
+    free (cursor);
+
+/* allocating the query workspace */
+    return network_ch_workspace (graph);
+}
+
+static void
+routing_graph_file_unmap (RoutingGraphFilePtr map)
+{
+/* releasing a mapped Routing Graph file */
+    if (map == NULL)
+	return;
+#if defined(_WIN32)
+    UnmapViewOfFile (map->Base);
+#elif defined(VROUTE_GRAPH_MMAP)
+    munmap (map->Base, map->Size);
+#endif
+    free (map);
+}
+
+static void
+network_free (RoutingPtr p)
+{
+/* memory cleanup; freeing any allocation for the network struct */
+    if (!p)
+	return;
+    if (p->Mapped == NULL)
+      {
+	  /* Nodes, Links and Codes are owned by the network struct */
+	  if (p->Nodes)
+	      free (p->Nodes);
+	  if (p->Links)
+	      free (p->Links);
+	  if (p->Codes)
+	      free (p->Codes);
+      }
+    if (p->TableName)
+	free (p->TableName);
+    if (p->FromColumn)
+	free (p->FromColumn);
+    if (p->ToColumn)
+	free (p->ToColumn);
+    if (p->GeometryColumn)
+	free (p->GeometryColumn);
+    if (p->NameColumn)
+	free (p->NameColumn);
+    network_ch_free (p->CH);
+    routing_graph_file_unmap (p->Mapped);
+    free (p);
+}
+
+static RoutingPtr
+network_init (const unsigned char *blob, int size, int mapped)
+{
+/* 
+/ parsing the HEADER block
+/ 
+/ if "mapped" is set Nodes, Links, Codes and the CH arrays will be
+/ directly referenced from a Routing Graph file, so they are not allocated
+*/
+    RoutingPtr graph;
+    int net64;
+    int aStar = 0;
+    int nodes;
+    int node_code;
+    int max_code_length;
+    int endian_arch = gaiaEndianArch ();
+    const char *table;
+    const char *from;
+    const char *to;
+    const char *geom;
+    const char *name = NULL;
+    double a_star_coeff = 1.0;
+    int ch_shortcuts = -1;
+    int len;
+    int i;
+    const unsigned char *ptr;
+    if (size < 9)
+	return NULL;
+    if (*(blob + 0) == GAIA_NET_START)	/* signature - legacy format using 32bit ints */
+	net64 = 0;
+    else if (*(blob + 0) == GAIA_NET64_START)	/* signature - format using 64bit ints */
+	net64 = 1;
+    else if (*(blob + 0) == GAIA_NET64_A_STAR_START)	/* signature - format using 64bit ints AND supporting A* */
+      {
+	  net64 = 1;
+	  aStar = 1;
+      }
+    else
+	return NULL;
+    if (*(blob + 1) != GAIA_NET_HEADER)	/* signature */
+	return NULL;
+    nodes = gaiaImport32 (blob + 2, 1, endian_arch);	/* # nodes */
+    if (nodes <= 0)
+	return NULL;
+    if (*(blob + 6) == GAIA_NET_CODE)	/* Nodes identified by a TEXT code */
+	node_code = 1;
+    else if (*(blob + 6) == GAIA_NET_ID)	/* Nodes indentified by an INTEGER id */
+	node_code = 0;
+    else
+	return NULL;
+    max_code_length = *(blob + 7);	/* Max TEXT Code length */
+    if (*(blob + 8) != GAIA_NET_TABLE)	/* signature for TABLE NAME */
+	return NULL;
+    ptr = blob + 9;
+    len = gaiaImport16 (ptr, 1, endian_arch);	/* TABLE NAME is varlen */
+    ptr += 2;
+    table = (char *) ptr;
+    ptr += len;
+    if (*ptr != GAIA_NET_FROM)	/* signature for FromNode COLUMN */
+	return NULL;
+    ptr++;
+    len = gaiaImport16 (ptr, 1, endian_arch);	/* FromNode COLUMN is varlen */
+    ptr += 2;
+    from = (char *) ptr;
+    ptr += len;
+    if (*ptr != GAIA_NET_TO)	/* signature for ToNode COLUMN */
+	return NULL;
+    ptr++;
+    len = gaiaImport16 (ptr, 1, endian_arch);	/* ToNode COLUMN is varlen */
+    ptr += 2;
+    to = (char *) ptr;
+    ptr += len;
+    if (*ptr != GAIA_NET_GEOM)	/* signature for Geometry COLUMN */
+	return NULL;
+    ptr++;
+    len = gaiaImport16 (ptr, 1, endian_arch);	/* Geometry COLUMN is varlen */
+    ptr += 2;
+    geom = (char *) ptr;
+    ptr += len;
+    if (net64)
+      {
+	  if (*ptr != GAIA_NET_NAME)	/* signature for Name COLUMN - may be empty */
+	      return NULL;
+	  ptr++;
+	  len = gaiaImport16 (ptr, 1, endian_arch);	/* Name COLUMN is varlen */
+	  ptr += 2;
+	  name = (char *) ptr;
+	  ptr += len;
+      }
+    if (net64 && aStar)
+      {
+	  if (*ptr != GAIA_NET_A_STAR_COEFF)	/* signature for A* Heuristic Coeff */
+	      return NULL;
+	  ptr++;
+	  a_star_coeff = gaiaImport64 (ptr, 1, endian_arch);
+	  ptr += 8;
+      }
+    if (net64 && *ptr == GAIA_NET_CH)
+      {
+	  /* signature for Contraction Hierarchies */
+	  ptr++;
+	  ch_shortcuts = gaiaImport32 (ptr, 1, endian_arch);
+	  ptr += 4;
+	  if (ch_shortcuts < 0)
+	      return NULL;
+      }
+    if (*ptr != GAIA_NET_END)	/* signature */
+	return NULL;
+    graph = malloc (sizeof (Routing));
+    graph->Srid = VROUTE_INVALID_SRID;
+    graph->HasZ = 0;
+    graph->Net64 = net64;
+    graph->AStar = aStar;
+    graph->EndianArch = endian_arch;
+    graph->CurrentIndex = 0;
+    graph->NodeCode = node_code;
+    graph->MaxCodeLength = max_code_length;
+    graph->NumNodes = nodes;
+    graph->NumLinks = 0;
+    graph->MaxLinks = 0;
+    graph->Nodes = NULL;
+    graph->Links = NULL;
+    graph->Codes = NULL;
+    graph->CodesSize = 0;
+    graph->Mapped = NULL;
+    if (!mapped)
+      {
+	  /* allocating the Nodes array and the Codes pool */
+	  graph->Nodes = malloc (sizeof (RouteNode) * nodes);
+	  for (i = 0; i < nodes; i++)
+	    {
+		graph->Nodes[i].InternalIndex = i;
+		graph->Nodes[i].NumLinks = 0;
+		graph->Nodes[i].FirstLink = 0;
+		graph->Nodes[i].Code = 0;
+		graph->Nodes[i].Id = -1;
+		graph->Nodes[i].CoordX = DBL_MAX;
+		graph->Nodes[i].CoordY = DBL_MAX;
+	    }
+	  if (node_code)
+	      graph->Codes =
+		  malloc (1 + ((size_t) nodes * (max_code_length + 1)));
+	  else
+	      graph->Codes = malloc (1);
+	  *(graph->Codes) = '\0';
+	  graph->CodesSize = 1;
+      }
+    len = strlen (table);
+    graph->TableName = malloc (len + 1);
+    strcpy (graph->TableName, table);
+    len = strlen (from);
+    graph->FromColumn = malloc (len + 1);
+    strcpy (graph->FromColumn, from);
+    len = strlen (to);
+    graph->ToColumn = malloc (len + 1);
+    strcpy (graph->ToColumn, to);
+    len = strlen (geom);
+    if (len <= 1)
+	graph->GeometryColumn = NULL;
+    else
+      {
+	  graph->GeometryColumn = malloc (len + 1);
+	  strcpy (graph->GeometryColumn, geom);
+      }
+    if (!net64)
+      {
+	  /* Name column is not supported */
+	  graph->NameColumn = NULL;
+      }
+    else
+      {
+	  len = strlen (name);
+	  if (len <= 1)
+	      graph->NameColumn = NULL;
+	  else
+	    {
+		graph->NameColumn = malloc (len + 1);
+		strcpy (graph->NameColumn, name);
+	    }
+      }
+    graph->AStarHeuristicCoeff = a_star_coeff;
+    graph->CH = NULL;
+    if (ch_shortcuts >= 0)
+      {
+	  /* allocating the Contraction Hierarchies overlay */
+	  RoutingCHPtr ch = calloc (1, sizeof (RoutingCH));
+	  if (ch == NULL)
+	      return graph;	/* plain Dijkstra/A* only */
+	  ch->NumShortcuts = ch_shortcuts;
+	  ch->Mapped = mapped;
+	  if (!mapped)
+	    {
+		ch->Ranks = malloc (sizeof (int) * nodes);
+		if (ch->Ranks == NULL)
+		  {
+		      network_ch_free (ch);
+		      return graph;
+		  }
+		for (i = 0; i < nodes; i++)
+		    ch->Ranks[i] = -1;
+		if (ch_shortcuts > 0)
+		  {
+		      ch->Shortcuts =
+			  malloc (sizeof (RouteLink) * ch_shortcuts);
+		      ch->Children = malloc (sizeof (int) * 2 * ch_shortcuts);
+		      if (ch->Shortcuts == NULL || ch->Children == NULL)
+			{
+			    network_ch_free (ch);
+			    return graph;
+			}
+		  }
+	    }
+	  graph->CH = ch;
+      }
+    return graph;
+}
+
+static int
+network_block (RoutingPtr graph, const unsigned char *blob, int size)
+{
+/* parsing a NETWORK Block */
+    const unsigned char *in = blob;
+    int nodes;
+    int i;
+    int ia;
+    int index;
+    char *code = NULL;
+    double x;
+    double y;
+    sqlite3_int64 nodeId = -1;
+    int links;
+    RouteNodePtr pN;
+    RouteLinkPtr pA;
+    int len;
+    sqlite3_int64 linkId;
+    int nodeToIdx;
+    double cost;
+    if (size < 3)
+	goto error;
+    if (*in++ != GAIA_NET_BLOCK)	/* signature */
+	goto error;
+    nodes = gaiaImport16 (in, 1, graph->EndianArch);	/* # Nodes */
+    in += 2;
+    code = malloc (graph->MaxCodeLength + 1);
+    for (i = 0; i < nodes; i++)
+      {
+	  /* parsing each node */
+	  if ((size - (in - blob)) < 5)
+	      goto error;
+	  if (*in++ != GAIA_NET_NODE)	/* signature */
+	      goto error;
+	  index = gaiaImport32 (in, 1, graph->EndianArch);	/* node internal index */
+	  in += 4;
+	  if (index < 0 || index >= graph->NumNodes)
+	      goto error;
+	  if (graph->NodeCode)
+	    {
+		/* Nodes are identified by a TEXT Code */
+		if ((size - (in - blob)) < graph->MaxCodeLength)
+		    goto error;
+		memcpy (code, in, graph->MaxCodeLength);
+		*(code + graph->MaxCodeLength) = '\0';
+		in += graph->MaxCodeLength;
+	    }
+	  else
+	    {
+		/* Nodes are identified by an INTEGER Id */
+		if (graph->Net64)
+		  {
+		      if ((size - (in - blob)) < 8)
+			  goto error;
+		      nodeId = gaiaImportI64 (in, 1, graph->EndianArch);	/* the Node ID: 64bit */
+		      in += 8;
+		  }
+		else
+		  {
+		      if ((size - (in - blob)) < 4)
+			  goto error;
+		      nodeId = gaiaImport32 (in, 1, graph->EndianArch);	/* the Node ID: 32bit */
+		      in += 4;
+		  }
+	    }
+	  if (graph->AStar)
+	    {
+		/* fetching node's X,Y coords */
+		if ((size - (in - blob)) < 8)
+		    goto error;
+		x = gaiaImport64 (in, 1, graph->EndianArch);	/* X coord */
+		in += 8;
+		if ((size - (in - blob)) < 8)
+		    goto error;
+		y = gaiaImport64 (in, 1, graph->EndianArch);	/* Y coord */
+		in += 8;
+	    }
+	  else
+	    {
+		x = DBL_MAX;
+		y = DBL_MAX;
+	    }
+	  if ((size - (in - blob)) < 2)
+	      goto error;
+	  links = gaiaImport16 (in, 1, graph->EndianArch);	/* # Links */
+	  in += 2;
+	  if (links < 0)
+	      goto error;
+	  /* initializing the Node */
+	  pN = graph->Nodes + index;
+	  pN->InternalIndex = index;
+	  if (graph->NodeCode)
+	    {
+		/* Nodes are identified by a TEXT Code */
+		pN->Id = -1;
+		len = strlen (code);
+		if (pN->Code == 0)
+		  {
+		      /* appending the Code into the pool */
+		      pN->Code = graph->CodesSize;
+		      strcpy (graph->Codes + graph->CodesSize, code);
+		      graph->CodesSize += len + 1;
+		  }
+	    }
+	  else
+	    {
+		/* Nodes are identified by an INTEGER Id */
+		pN->Id = nodeId;
+		pN->Code = 0;
+	    }
+	  pN->CoordX = x;
+	  pN->CoordY = y;
+	  pN->NumLinks = links;
+	  pN->FirstLink = graph->NumLinks;
+	  if (links)
+	    {
+		/* parsing the Links */
+		if (graph->NumLinks + links > graph->MaxLinks)
+		  {
+		      /* growing the Links array */
+		      while (graph->NumLinks + links > graph->MaxLinks)
+			  graph->MaxLinks =
+			      (graph->MaxLinks ==
+			       0) ? 4096 : graph->MaxLinks * 2;
+		      graph->Links =
+			  realloc (graph->Links,
+				   sizeof (RouteLink) * graph->MaxLinks);
+		  }
+		graph->NumLinks += links;
+		for (ia = 0; ia < links; ia++)
+		  {
+		      /* parsing each Link */
+		      if (graph->Net64)
+			{
+			    if ((size - (in - blob)) < 22)
+				goto error;
+			}
+		      else
+			{
+			    if ((size - (in - blob)) < 18)
+				goto error;
+			}
+		      if (*in++ != GAIA_NET_ARC)	/* signature */
+			  goto error;
+		      if (graph->Net64)
+			{
+			    linkId = gaiaImportI64 (in, 1, graph->EndianArch);	/* # Link ROWID: 64bit */
+			    in += 8;
+			}
+		      else
+			{
+			    linkId = gaiaImport32 (in, 1, graph->EndianArch);	/* # Link ROWID: 32bit */
+			    in += 4;
+			}
+		      nodeToIdx = gaiaImport32 (in, 1, graph->EndianArch);	/* # NodeTo internal index */
+		      in += 4;
+		      cost = gaiaImport64 (in, 1, graph->EndianArch);	/* # Cost */
+		      in += 8;
+		      if (*in++ != GAIA_NET_END)	/* signature */
+			  goto error;
+		      pA = graph->Links + pN->FirstLink + ia;
+		      /* initializing the Link */
+		      if (nodeToIdx < 0 || nodeToIdx >= graph->NumNodes)
+			  goto error;
+		      pA->NodeFrom = index;
+		      pA->NodeTo = nodeToIdx;
+		      pA->LinkRowid = linkId;
+		      pA->Cost = cost;
+		  }
+	    }
+	  if ((size - (in - blob)) < 1)
+	      goto error;
+	  if (*in++ != GAIA_NET_END)	/* signature */
+	      goto error;
+      }
+    free (code);
+    return 1;
+  error:
+    if (code != NULL)
+	free (code);
+    return 0;
+}
+
+static RoutingPtr
+load_network (sqlite3 * handle, const char *table)
+{
+/* loads the NETWORK struct */
+    RoutingPtr graph = NULL;
+    sqlite3_stmt *stmt;
+    char *sql;
+    int ret;
+    int header = 1;
+    const unsigned char *blob;
+    int size;
+    char *xname;
+    xname = gaiaDoubleQuotedSql (table);
+    sql = sqlite3_mprintf ("SELECT NetworkData FROM \"%s\" ORDER BY Id", xname);
+    free (xname);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	goto abort;
+    while (1)
+      {
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret == SQLITE_ROW)
+	    {
+		if (sqlite3_column_type (stmt, 0) == SQLITE_BLOB)
+		  {
+		      blob =
+			  (const unsigned char *) sqlite3_column_blob (stmt, 0);
+		      size = sqlite3_column_bytes (stmt, 0);
+		      if (header)
+			{
+			    /* parsing the HEADER block */
+			    graph = network_init (blob, size, 0);
+			    header = 0;
+			}
+		      else
+			{
+			    /* parsing ordinary Blocks */
+			    if (!graph)
+			      {
+				  sqlite3_finalize (stmt);
+				  goto abort;
+			      }
+			    if (size > 0 && (*blob == GAIA_NET_CH_RANKS
+					     || *blob == GAIA_NET_CH_SHORTCUTS))
+			      {
+				  /* Contraction Hierarchies blocks */
+				  if (!network_ch_block (graph, blob, size))
+				      network_ch_disable (graph);
+			      }
+			    else if (!network_block (graph, blob, size))
+			      {
+				  sqlite3_finalize (stmt);
+				  goto abort;
+			      }
+			}
+		  }
+		else
+		  {
+		      sqlite3_finalize (stmt);
+		      goto abort;
+		  }
+	    }
+	  else
+	    {
+		sqlite3_finalize (stmt);
+		goto abort;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    if (graph != NULL && graph->CH != NULL)
+      {
+	  if (!network_ch_prepare (graph))
+	      network_ch_disable (graph);
+      }
+    find_srid (handle, graph);
+    return graph;
+  abort:
+    network_free (graph);
+    return NULL;
+}
+
+/*
+/
+/ Routing Graph files
+/
+/ a Routing Graph file is a position-independent image of the NETWORK
+/ (Nodes, Links, Codes and the optional CH overlay) using the native
+/ byte order; it is mapped read-only, so that any connection (and any
+/ process) opening the same file shares a single physical copy
+/
+*/
+
+#define VROUTE_GRAPH_MAGIC	"SpatiaLite-RTG\0"
+#define VROUTE_GRAPH_VERSION	1
+#define VROUTE_GRAPH_ENDIAN	0x01020304
+#define VROUTE_GRAPH_ALIGN(x)	(((x) + 7) & ~((sqlite3_int64) 7))
+
+typedef struct RoutingGraphHeaderStruct
+{
+/* the fixed-size header of a Routing Graph file */
+    char Magic[16];
+    int Version;
+    int EndianCheck;
+    int HeaderSize;		/* sizeof (RoutingGraphHeader) */
+    int NodeSize;		/* sizeof (RouteNode) */
+    int LinkSize;		/* sizeof (RouteLink) */
+    int NumNodes;
+    int NumLinks;
+    int CodesSize;
+    int NumShortcuts;		/* -1: no CH overlay */
+    int NumUp;
+    int NumDown;
+    int SourceHeaderSize;	/* length of the Routing Data HEADER block */
+    sqlite3_int64 SourceRows;	/* fingerprint of the Routing Data table */
+    sqlite3_int64 SourceBytes;
+    sqlite3_int64 SourceHash;
+    sqlite3_int64 FileSize;
+    sqlite3_int64 SourceHeader;	/* section offsets */
+    sqlite3_int64 Nodes;
+    sqlite3_int64 Links;
+    sqlite3_int64 Codes;
+    sqlite3_int64 Ranks;
+    sqlite3_int64 Shortcuts;
+    sqlite3_int64 Children;
+    sqlite3_int64 UpIndex;
+    sqlite3_int64 Up;
+    sqlite3_int64 DownIndex;
+    sqlite3_int64 Down;
+} RoutingGraphHeader;
+typedef RoutingGraphHeader *RoutingGraphHeaderPtr;
+
+static int
+routing_graph_source (sqlite3 * handle, const char *table,
+		      sqlite3_int64 * rows, sqlite3_int64 * bytes,
+		      sqlite3_int64 * hash, unsigned char **header,
+		      int *header_size)
+{
+/* 
+/ fetching the fingerprint and the HEADER block of a Routing Data table
+/
+/ the fingerprint is a FNV-1a hash of all the Routing Data blocks, so
+/ that any change (even preserving their size) is always detected
+*/
+    sqlite3_stmt *stmt;
+    char *sql;
+    char *xname;
+    int ret;
+    int i;
+    int size;
+    const unsigned char *blob;
+    sqlite3_uint64 h = 14695981039346656037ULL;
+    *rows = 0;
+    *bytes = 0;
+    *hash = 0;
+    *header = NULL;
+    *header_size = 0;
+    xname = gaiaDoubleQuotedSql (table);
+    sql = sqlite3_mprintf ("SELECT NetworkData FROM \"%s\" ORDER BY Id", xname);
+    free (xname);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+	return 0;
+    while (1)
+      {
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW || sqlite3_column_type (stmt, 0) != SQLITE_BLOB)
+	      goto error;
+	  blob = (const unsigned char *) sqlite3_column_blob (stmt, 0);
+	  size = sqlite3_column_bytes (stmt, 0);
+	  if (*header == NULL)
+	    {
+		/* saving a copy of the HEADER block */
+		*header = malloc (size);
+		memcpy (*header, blob, size);
+		*header_size = size;
+	    }
+	  for (i = 0; i < size; i++)
+	    {
+		h ^= blob[i];
+		h *= 1099511628211ULL;
+	    }
+	  *rows += 1;
+	  *bytes += size;
+      }
+    sqlite3_finalize (stmt);
+    if (*header == NULL)
+	return 0;
+    *hash = (sqlite3_int64) h;
+    return 1;
+  error:
+    sqlite3_finalize (stmt);
+    if (*header != NULL)
+	free (*header);
+    *header = NULL;
+    return 0;
+}
+
+static int
+routing_graph_section_ok (RoutingGraphHeaderPtr hdr, sqlite3_int64 offset,
+			  int count, int item_size)
+{
+/* checking a section of a Routing Graph file */
+    if (count < 0)
+	return 0;
+    if (offset < (sqlite3_int64) sizeof (RoutingGraphHeader))
+	return 0;
+    if ((offset % 8) != 0)
+	return 0;
+    if (offset + ((sqlite3_int64) count * item_size) > hdr->FileSize)
+	return 0;
+    return 1;
+}
+
+static int
+routing_graph_check_csr (const int *index, const int *edges, int num_nodes,
+			 int num_items, int num_edges)
+{
+/* checking an upward/downward CH adjacency */
+    int i;
+    if (index[0] != 0 || index[num_nodes] != num_items)
+	return 0;
+    for (i = 0; i < num_nodes; i++)
+      {
+	  if (index[i + 1] < index[i])
+	      return 0;
+      }
+    for (i = 0; i < num_items; i++)
+      {
+	  if (edges[i] < 0 || edges[i] >= num_edges)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+routing_graph_validate (RoutingGraphHeaderPtr hdr, const unsigned char *base,
+			const unsigned char *source, int source_size,
+			sqlite3_int64 rows, sqlite3_int64 bytes,
+			sqlite3_int64 hash)
+{
+/* 
+/ checking a mapped Routing Graph file
+/
+/ everything is checked in place (read-only): a file that doesn't
+/ exactly match the Routing Data table or that could cause any
+/ out-of-bounds access is simply rejected
+*/
+    const RouteNode *nodes;
+    const RouteLink *links;
+    const RouteLink *shortcuts;
+    const char *codes;
+    const int *children;
+    int i;
+    int j;
+    int k;
+    int num_links = 0;
+
+    if (memcmp (hdr->Magic, VROUTE_GRAPH_MAGIC, 16) != 0)
+	return 0;
+    if (hdr->Version != VROUTE_GRAPH_VERSION
+	|| hdr->EndianCheck != VROUTE_GRAPH_ENDIAN)
+	return 0;
+    if (hdr->HeaderSize != (int) sizeof (RoutingGraphHeader)
+	|| hdr->NodeSize != (int) sizeof (RouteNode)
+	|| hdr->LinkSize != (int) sizeof (RouteLink))
+	return 0;
+    if (hdr->SourceRows != rows || hdr->SourceBytes != bytes
+	|| hdr->SourceHash != hash)
+	return 0;
+    if (hdr->NumNodes <= 0 || hdr->NumLinks < 0 || hdr->CodesSize < 1)
+	return 0;
+    if (hdr->SourceHeaderSize != source_size)
+	return 0;
+    if (!routing_graph_section_ok (hdr, hdr->SourceHeader, source_size, 1))
+	return 0;
+    if (memcmp (base + hdr->SourceHeader, source, source_size) != 0)
+	return 0;
+    if (!routing_graph_section_ok
+	(hdr, hdr->Nodes, hdr->NumNodes, sizeof (RouteNode)))
+	return 0;
+    if (!routing_graph_section_ok
+	(hdr, hdr->Links, hdr->NumLinks, sizeof (RouteLink)))
+	return 0;
+    if (!routing_graph_section_ok (hdr, hdr->Codes, hdr->CodesSize, 1))
+	return 0;
+
+/* checking the Codes pool */
+    codes = (const char *) (base + hdr->Codes);
+    if (codes[0] != '\0' || codes[hdr->CodesSize - 1] != '\0')
+	return 0;
+
+/* checking Nodes and Links */
+    nodes = (const RouteNode *) (base + hdr->Nodes);
+    links = (const RouteLink *) (base + hdr->Links);
+    for (i = 0; i < hdr->NumNodes; i++)
+      {
+	  const RouteNode *pN = nodes + i;
+	  if (pN->InternalIndex != i)
+	      return 0;
+	  if (pN->Code < 0 || pN->Code >= hdr->CodesSize)
+	      return 0;
+	  if (pN->NumLinks < 0 || pN->FirstLink != num_links
+	      || pN->NumLinks > hdr->NumLinks - num_links)
+	      return 0;
+	  for (j = 0; j < pN->NumLinks; j++)
+	    {
+		const RouteLink *pA = links + pN->FirstLink + j;
+		if (pA->NodeFrom != i || pA->NodeTo < 0
+		    || pA->NodeTo >= hdr->NumNodes)
+		    return 0;
+	    }
+	  num_links += pN->NumLinks;
+      }
+    if (num_links != hdr->NumLinks)
+	return 0;
+    if (hdr->NumShortcuts < 0)
+	return 1;
+
+/* checking the Contraction Hierarchies overlay */
+    if (!routing_graph_section_ok (hdr, hdr->Ranks, hdr->NumNodes, 4))
+	return 0;
+    if (!routing_graph_section_ok
+	(hdr, hdr->Shortcuts, hdr->NumShortcuts, sizeof (RouteLink)))
+	return 0;
+    if (hdr->NumShortcuts > INT_MAX / 2
+	|| !routing_graph_section_ok (hdr, hdr->Children,
+				      hdr->NumShortcuts * 2, 4))
+	return 0;
+    if (!routing_graph_section_ok (hdr, hdr->UpIndex, hdr->NumNodes + 1, 4))
+	return 0;
+    if (!routing_graph_section_ok (hdr, hdr->Up, hdr->NumUp, 4))
+	return 0;
+    if (!routing_graph_section_ok
+	(hdr, hdr->DownIndex, hdr->NumNodes + 1, 4))
+	return 0;
+    if (!routing_graph_section_ok (hdr, hdr->Down, hdr->NumDown, 4))
+	return 0;
+    if (hdr->NumShortcuts > INT_MAX - hdr->NumLinks)
+	return 0;
+    shortcuts = (const RouteLink *) (base + hdr->Shortcuts);
+    children = (const int *) (base + hdr->Children);
+    for (i = 0; i < hdr->NumShortcuts; i++)
+      {
+	  const RouteLink *pA = shortcuts + i;
+	  if (pA->NodeFrom < 0 || pA->NodeFrom >= hdr->NumNodes
+	      || pA->NodeTo < 0 || pA->NodeTo >= hdr->NumNodes)
+	      return 0;
+	  for (j = 0; j < 2; j++)
+	    {
+		/* each half must precede the Shortcut itself */
+		k = children[(i * 2) + j];
+		if (k < 0 || k >= hdr->NumLinks + i)
+		    return 0;
+	    }
+      }
+    if (!routing_graph_check_csr
+	((const int *) (base + hdr->UpIndex), (const int *) (base + hdr->Up),
+	 hdr->NumNodes, hdr->NumUp, hdr->NumLinks + hdr->NumShortcuts))
+	return 0;
+    if (!routing_graph_check_csr
+	((const int *) (base + hdr->DownIndex),
+	 (const int *) (base + hdr->Down), hdr->NumNodes, hdr->NumDown,
+	 hdr->NumLinks + hdr->NumShortcuts))
+	return 0;
+    return 1;
+}
+
+static RoutingGraphFilePtr
+routing_graph_file_map (const char *path)
+{
+/* mapping a Routing Graph file into memory (read-only) */
+    RoutingGraphFilePtr map = NULL;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER size;
+    void *base;
+    file =
+	CreateFileA (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		     FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
 	return NULL;
-    if (*(blob + 1) != GAIA_NET_HEADER)	/* signature */
-	return NULL;
-    nodes = gaiaImport32 (blob + 2, 1, endian_arch);	/* # nodes */
-    if (nodes <= 0)
-	return NULL;
-    if (*(blob + 6) == GAIA_NET_CODE)	/* Nodes identified by a TEXT code */
-	node_code = 1;
-    else if (*(blob + 6) == GAIA_NET_ID)	/* Nodes indentified by an INTEGER id */
-	node_code = 0;
-    else
-	return NULL;
-    max_code_length = *(blob + 7);	/* Max TEXT Code length */
-    if (*(blob + 8) != GAIA_NET_TABLE)	/* signature for TABLE NAME */
-	return NULL;
-    ptr = blob + 9;
-    len = gaiaImport16 (ptr, 1, endian_arch);	/* TABLE NAME is varlen */
-    ptr += 2;
-    table = (char *) ptr;
-    ptr += len;
-    if (*ptr != GAIA_NET_FROM)	/* signature for FromNode COLUMN */
-	return NULL;
-    ptr++;
-    len = gaiaImport16 (ptr, 1, endian_arch);	/* FromNode COLUMN is varlen */
-    ptr += 2;
-    from = (char *) ptr;
-    ptr += len;
-    if (*ptr != GAIA_NET_TO)	/* signature for ToNode COLUMN */
+    if (!GetFileSizeEx (file, &size)
+	|| size.QuadPart < (LONGLONG) sizeof (RoutingGraphHeader)
+	|| (unsigned long long) size.QuadPart > (size_t) - 1)
+      {
+	  CloseHandle (file);
+	  return NULL;
+      }
+    mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle (file);
+    if (mapping == NULL)
 	return NULL;
-    ptr++;
-    len = gaiaImport16 (ptr, 1, endian_arch);	/* ToNode COLUMN is varlen */
-    ptr += 2;
-    to = (char *) ptr;
-    ptr += len;
-    if (*ptr != GAIA_NET_GEOM)	/* signature for Geometry COLUMN */
+    base = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle (mapping);
+    if (base == NULL)
 	return NULL;
-    ptr++;
-    len = gaiaImport16 (ptr, 1, endian_arch);	/* Geometry COLUMN is varlen */
-    ptr += 2;
-    geom = (char *) ptr;
-    ptr += len;
-    if (net64)
+    map = malloc (sizeof (RoutingGraphFile));
+    if (map == NULL)
       {
-	  if (*ptr != GAIA_NET_NAME)	/* signature for Name COLUMN - may be empty */
-	      return NULL;
-	  ptr++;
-	  len = gaiaImport16 (ptr, 1, endian_arch);	/* Name COLUMN is varlen */
-	  ptr += 2;
-	  name = (char *) ptr;
-	  ptr += len;
+	  UnmapViewOfFile (base);
+	  return NULL;
       }
-    if (net64 && aStar)
+    map->Base = base;
+    map->Size = (size_t) size.QuadPart;
+#elif defined(VROUTE_GRAPH_MMAP)
+    int fd;
+    struct stat st;
+    void *base;
+    fd = open (path, O_RDONLY);
+    if (fd < 0)
+	return NULL;
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode)
+	|| st.st_size < (off_t) sizeof (RoutingGraphHeader)
+	|| (unsigned long long) st.st_size > (size_t) - 1)
       {
-	  if (*ptr != GAIA_NET_A_STAR_COEFF)	/* signature for A* Heuristic Coeff */
-	      return NULL;
-	  ptr++;
-	  a_star_coeff = gaiaImport64 (ptr, 1, endian_arch);
-	  ptr += 8;
+	  close (fd);
+	  return NULL;
       }
-    if (*ptr != GAIA_NET_END)	/* signature */
+    base = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
 	return NULL;
-    graph = malloc (sizeof (Routing));
-    graph->Srid = VROUTE_INVALID_SRID;
-    graph->HasZ = 0;
-    graph->Net64 = net64;
-    graph->AStar = aStar;
-    graph->EndianArch = endian_arch;
-    graph->CurrentIndex = 0;
-    graph->NodeCode = node_code;
-    graph->MaxCodeLength = max_code_length;
-    graph->NumNodes = nodes;
-    graph->Nodes = malloc (sizeof (RouteNode) * nodes);
-    for (i = 0; i < nodes; i++)
+    map = malloc (sizeof (RoutingGraphFile));
+    if (map == NULL)
       {
-	  graph->Nodes[i].Code = NULL;
-	  graph->Nodes[i].NumLinks = 0;
-	  graph->Nodes[i].Links = NULL;
+	  munmap (base, (size_t) st.st_size);
+	  return NULL;
       }
-    len = strlen (table);
-    graph->TableName = malloc (len + 1);
-    strcpy (graph->TableName, table);
-    len = strlen (from);
-    graph->FromColumn = malloc (len + 1);
-    strcpy (graph->FromColumn, from);
-    len = strlen (to);
-    graph->ToColumn = malloc (len + 1);
-    strcpy (graph->ToColumn, to);
-    len = strlen (geom);
-    if (len <= 1)
-	graph->GeometryColumn = NULL;
-    else
+    map->Base = base;
+    map->Size = (size_t) st.st_size;
+#else
+    if (path != NULL)
+	map = NULL;		/* memory mapping is not supported */
+#endif
+    return map;
+}
+
+static RoutingPtr
+network_map_file (sqlite3 * handle, const char *table, const char *path)
+{
+/* 
+/ loads the NETWORK struct from a Routing Graph file
+/
+/ NULL is returned if the file can't be mapped or doesn't match the
+/ Routing Data table, so that the caller can fall back to decoding
+*/
+    RoutingPtr graph = NULL;
+    RoutingGraphFilePtr map;
+    RoutingGraphHeaderPtr hdr;
+    unsigned char *base;
+    unsigned char *source = NULL;
+    int source_size;
+    sqlite3_int64 rows;
+    sqlite3_int64 bytes;
+    sqlite3_int64 hash;
+    RoutingCHPtr ch;
+
+    if (!routing_graph_source
+	(handle, table, &rows, &bytes, &hash, &source, &source_size))
+	goto error;
+    map = routing_graph_file_map (path);
+    if (map == NULL)
+	goto error;
+    base = map->Base;
+    hdr = (RoutingGraphHeaderPtr) base;
+    if (hdr->FileSize != (sqlite3_int64) map->Size
+	|| !routing_graph_validate (hdr, base, source, source_size, rows,
+				    bytes, hash))
       {
-	  graph->GeometryColumn = malloc (len + 1);
-	  strcpy (graph->GeometryColumn, geom);
+	  routing_graph_file_unmap (map);
+	  goto error;
       }
-    if (!net64)
+    graph = network_init (source, source_size, 1);
+    if (graph == NULL || graph->NumNodes != hdr->NumNodes)
       {
-	  /* Name column is not supported */
-	  graph->NameColumn = NULL;
+	  routing_graph_file_unmap (map);
+	  goto error;
       }
-    else
-      {
-	  len = strlen (name);
-	  if (len <= 1)
-	      graph->NameColumn = NULL;
+    free (source);
+    source = NULL;
+
+/* directly referencing the mapped arrays */
+    graph->Mapped = map;
+    graph->Nodes = (RouteNodePtr) (base + hdr->Nodes);
+    graph->NumLinks = hdr->NumLinks;
+    graph->MaxLinks = hdr->NumLinks;
+    graph->Links = (RouteLinkPtr) (base + hdr->Links);
+    graph->CodesSize = hdr->CodesSize;
+    graph->Codes = (char *) (base + hdr->Codes);
+    ch = graph->CH;
+    if (ch != NULL)
+      {
+	  if (hdr->NumShortcuts != ch->NumShortcuts)
+	      network_ch_disable (graph);
 	  else
 	    {
-		graph->NameColumn = malloc (len + 1);
-		strcpy (graph->NameColumn, name);
+		ch->NumArcs = hdr->NumLinks;
+		ch->LoadedShortcuts = hdr->NumShortcuts;
+		ch->Ranks = (int *) (base + hdr->Ranks);
+		ch->Shortcuts = (RouteLinkPtr) (base + hdr->Shortcuts);
+		ch->Children = (int *) (base + hdr->Children);
+		ch->UpIndex = (int *) (base + hdr->UpIndex);
+		ch->Up = (int *) (base + hdr->Up);
+		ch->DownIndex = (int *) (base + hdr->DownIndex);
+		ch->Down = (int *) (base + hdr->Down);
+		if (!network_ch_workspace (graph))
+		    network_ch_disable (graph);
 	    }
       }
-    graph->AStarHeuristicCoeff = a_star_coeff;
+    find_srid (handle, graph);
     return graph;
+
+  error:
+    if (source != NULL)
+	free (source);
+    network_free (graph);
+    return NULL;
 }
 
 static int
-network_block (RoutingPtr graph, const unsigned char *blob, int size)
+routing_graph_pad (FILE * out, sqlite3_int64 * offset)
 {
-/* parsing a NETWORK Block */
-    const unsigned char *in = blob;
-    int nodes;
+/* padding a section of a Routing Graph file to 8 bytes */
+    static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    size_t pad = (size_t) (VROUTE_GRAPH_ALIGN (*offset) - *offset);
+    if (pad > 0 && fwrite (zeros, 1, pad, out) != pad)
+	return 0;
+    *offset += pad;
+    return 1;
+}
+
+static int
+routing_graph_write_section (FILE * out, const void *data, size_t size,
+			     sqlite3_int64 * offset)
+{
+/* writing a section of a Routing Graph file */
+    if (size > 0 && fwrite (data, 1, size, out) != size)
+	return 0;
+    *offset += size;
+    return routing_graph_pad (out, offset);
+}
+
+static int
+routing_graph_write (FILE * out, RoutingPtr graph, const unsigned char *source,
+		     int source_size, sqlite3_int64 rows, sqlite3_int64 bytes,
+		     sqlite3_int64 hash)
+{
+/* writing a Routing Graph file */
+    RoutingGraphHeader hdr;
+    RoutingCHPtr ch = graph->CH;
+    sqlite3_int64 offset = 0;
     int i;
-    int ia;
-    int index;
-    char *code = NULL;
-    double x;
-    double y;
-    sqlite3_int64 nodeId = -1;
-    int links;
-    RouteNodePtr pN;
-    RouteLinkPtr pA;
-    int len;
-    sqlite3_int64 linkId;
-    int nodeToIdx;
-    double cost;
-    if (size < 3)
-	goto error;
-    if (*in++ != GAIA_NET_BLOCK)	/* signature */
-	goto error;
-    nodes = gaiaImport16 (in, 1, graph->EndianArch);	/* # Nodes */
-    in += 2;
-    code = malloc (graph->MaxCodeLength + 1);
-    for (i = 0; i < nodes; i++)
+    int first = 0;
+    RouteNode node;
+
+/* computing the section offsets */
+    memset (&hdr, 0, sizeof (RoutingGraphHeader));
+    memcpy (hdr.Magic, VROUTE_GRAPH_MAGIC, 16);
+    hdr.Version = VROUTE_GRAPH_VERSION;
+    hdr.EndianCheck = VROUTE_GRAPH_ENDIAN;
+    hdr.HeaderSize = sizeof (RoutingGraphHeader);
+    hdr.NodeSize = sizeof (RouteNode);
+    hdr.LinkSize = sizeof (RouteLink);
+    hdr.NumNodes = graph->NumNodes;
+    hdr.NumLinks = graph->NumLinks;
+    hdr.CodesSize = graph->CodesSize;
+    hdr.NumShortcuts = (ch == NULL) ? -1 : ch->NumShortcuts;
+    hdr.NumUp = (ch == NULL) ? 0 : ch->UpIndex[graph->NumNodes];
+    hdr.NumDown = (ch == NULL) ? 0 : ch->DownIndex[graph->NumNodes];
+    hdr.SourceHeaderSize = source_size;
+    hdr.SourceRows = rows;
+    hdr.SourceBytes = bytes;
+    hdr.SourceHash = hash;
+    offset = VROUTE_GRAPH_ALIGN ((sqlite3_int64) sizeof (RoutingGraphHeader));
+    hdr.SourceHeader = offset;
+    offset = VROUTE_GRAPH_ALIGN (offset + source_size);
+    hdr.Nodes = offset;
+    offset =
+	VROUTE_GRAPH_ALIGN (offset +
+			    (sqlite3_int64) sizeof (RouteNode) *
+			    graph->NumNodes);
+    hdr.Links = offset;
+    offset =
+	VROUTE_GRAPH_ALIGN (offset +
+			    (sqlite3_int64) sizeof (RouteLink) *
+			    graph->NumLinks);
+    hdr.Codes = offset;
+    offset = VROUTE_GRAPH_ALIGN (offset + graph->CodesSize);
+    if (ch != NULL)
+      {
+	  hdr.Ranks = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) *
+				  graph->NumNodes);
+	  hdr.Shortcuts = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (RouteLink) *
+				  ch->NumShortcuts);
+	  hdr.Children = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) * 2 *
+				  ch->NumShortcuts);
+	  hdr.UpIndex = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) *
+				  (graph->NumNodes + 1));
+	  hdr.Up = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) * hdr.NumUp);
+	  hdr.DownIndex = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) *
+				  (graph->NumNodes + 1));
+	  hdr.Down = offset;
+	  offset =
+	      VROUTE_GRAPH_ALIGN (offset +
+				  (sqlite3_int64) sizeof (int) * hdr.NumDown);
+      }
+    hdr.FileSize = offset;
+
+/* writing the sections */
+    offset = 0;
+    if (!routing_graph_write_section
+	(out, &hdr, sizeof (RoutingGraphHeader), &offset))
+	return 0;
+    if (!routing_graph_write_section (out, source, source_size, &offset))
+	return 0;
+    for (i = 0; i < graph->NumNodes; i++)
       {
-	  /* parsing each node */
-	  if ((size - (in - blob)) < 5)
-	      goto error;
-	  if (*in++ != GAIA_NET_NODE)	/* signature */
-	      goto error;
-	  index = gaiaImport32 (in, 1, graph->EndianArch);	/* node internal index */
-	  in += 4;
-	  if (index < 0 || index >= graph->NumNodes)
-	      goto error;
-	  if (graph->NodeCode)
-	    {
-		/* Nodes are identified by a TEXT Code */
-		if ((size - (in - blob)) < graph->MaxCodeLength)
-		    goto error;
-		memcpy (code, in, graph->MaxCodeLength);
-		*(code + graph->MaxCodeLength) = '\0';
-		in += graph->MaxCodeLength;
-	    }
-	  else
-	    {
-		/* Nodes are identified by an INTEGER Id */
-		if (graph->Net64)
-		  {
-		      if ((size - (in - blob)) < 8)
-			  goto error;
-		      nodeId = gaiaImportI64 (in, 1, graph->EndianArch);	/* the Node ID: 64bit */
-		      in += 8;
-		  }
-		else
-		  {
-		      if ((size - (in - blob)) < 4)
-			  goto error;
-		      nodeId = gaiaImport32 (in, 1, graph->EndianArch);	/* the Node ID: 32bit */
-		      in += 4;
-		  }
-	    }
-	  if (graph->AStar)
-	    {
-		/* fetching node's X,Y coords */
-		if ((size - (in - blob)) < 8)
-		    goto error;
-		x = gaiaImport64 (in, 1, graph->EndianArch);	/* X coord */
-		in += 8;
-		if ((size - (in - blob)) < 8)
-		    goto error;
-		y = gaiaImport64 (in, 1, graph->EndianArch);	/* Y coord */
-		in += 8;
-	    }
-	  else
-	    {
-		x = DBL_MAX;
-		y = DBL_MAX;
-	    }
-	  if ((size - (in - blob)) < 2)
-	      goto error;
-	  links = gaiaImport16 (in, 1, graph->EndianArch);	/* # Links */
-	  in += 2;
-	  if (links < 0)
-	      goto error;
-	  /* initializing the Node */
-	  pN = graph->Nodes + index;
-	  pN->InternalIndex = index;
-	  if (graph->NodeCode)
-	    {
-		/* Nodes are identified by a TEXT Code */
-		pN->Id = -1;
-		len = strlen (code);
-		pN->Code = malloc (len + 1);
-		strcpy (pN->Code, code);
-	    }
-	  else
-	    {
-		/* Nodes are identified by an INTEGER Id */
-		pN->Id = nodeId;
-		pN->Code = NULL;
-	    }
-	  pN->CoordX = x;
-	  pN->CoordY = y;
-	  pN->NumLinks = links;
-	  if (links)
-	    {
-		/* parsing the Links */
-		pN->Links = malloc (sizeof (RouteLink) * links);
-		for (ia = 0; ia < links; ia++)
-		  {
-		      /* parsing each Link */
-		      if (graph->Net64)
-			{
-			    if ((size - (in - blob)) < 22)
-				goto error;
-			}
-		      else
-			{
-			    if ((size - (in - blob)) < 18)
-				goto error;
-			}
-		      if (*in++ != GAIA_NET_ARC)	/* signature */
-			  goto error;
-		      if (graph->Net64)
-			{
-			    linkId = gaiaImportI64 (in, 1, graph->EndianArch);	/* # Link ROWID: 64bit */
-			    in += 8;
-			}
-		      else
-			{
-			    linkId = gaiaImport32 (in, 1, graph->EndianArch);	/* # Link ROWID: 32bit */
-			    in += 4;
-			}
-		      nodeToIdx = gaiaImport32 (in, 1, graph->EndianArch);	/* # NodeTo internal index */
-		      in += 4;
-		      cost = gaiaImport64 (in, 1, graph->EndianArch);	/* # Cost */
-		      in += 8;
-		      if (*in++ != GAIA_NET_END)	/* signature */
-			  goto error;
-		      pA = pN->Links + ia;
-		      /* initializing the Link */
-		      if (nodeToIdx < 0 || nodeToIdx >= graph->NumNodes)
-			  goto error;
-		      pA->NodeFrom = pN;
-		      pA->NodeTo = graph->Nodes + nodeToIdx;
-		      pA->LinkRowid = linkId;
-		      pA->Cost = cost;
-		  }
-	    }
-	  else
-	      pN->Links = NULL;
-	  if ((size - (in - blob)) < 1)
-	      goto error;
-	  if (*in++ != GAIA_NET_END)	/* signature */
-	      goto error;
+	  /* Links are always stored in Node order */
+	  node = graph->Nodes[i];
+	  node.FirstLink = first;
+	  first += node.NumLinks;
+	  if (fwrite (&node, sizeof (RouteNode), 1, out) != 1)
+	      return 0;
+      }
+    offset += (sqlite3_int64) sizeof (RouteNode) * graph->NumNodes;
+    if (!routing_graph_pad (out, &offset))
+	return 0;
+    for (i = 0; i < graph->NumNodes; i++)
+      {
+	  RouteNodePtr pN = graph->Nodes + i;
+	  if (pN->NumLinks > 0
+	      && fwrite (graph->Links + pN->FirstLink, sizeof (RouteLink),
+			 pN->NumLinks, out) != (size_t) pN->NumLinks)
+	      return 0;
       }
-    free (code);
+    offset += (sqlite3_int64) sizeof (RouteLink) * graph->NumLinks;
+    if (!routing_graph_pad (out, &offset))
+	return 0;
+    if (!routing_graph_write_section
+	(out, graph->Codes, graph->CodesSize, &offset))
+	return 0;
+    if (ch != NULL)
+      {
+	  if (!routing_graph_write_section
+	      (out, ch->Ranks, sizeof (int) * graph->NumNodes, &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->Shortcuts, sizeof (RouteLink) * ch->NumShortcuts,
+	       &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->Children, sizeof (int) * 2 * ch->NumShortcuts,
+	       &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->UpIndex, sizeof (int) * (graph->NumNodes + 1),
+	       &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->Up, sizeof (int) * hdr.NumUp, &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->DownIndex, sizeof (int) * (graph->NumNodes + 1),
+	       &offset))
+	      return 0;
+	  if (!routing_graph_write_section
+	      (out, ch->Down, sizeof (int) * hdr.NumDown, &offset))
+	      return 0;
+      }
+    if (offset != hdr.FileSize)
+	return 0;
     return 1;
-  error:
-    if (code != NULL)
-	free (code);
-    return 0;
 }
 
-static RoutingPtr
-load_network (sqlite3 * handle, const char *table)
+SPATIALITE_DECLARE int
+gaia_create_routing_graph_file (sqlite3 * handle, const void *cache,
+				const char *routing_data_table,
+				const char *graph_file)
 {
-/* loads the NETWORK struct */
+/* exporting a Routing Data table into a Routing Graph file */
     RoutingPtr graph = NULL;
-    sqlite3_stmt *stmt;
-    char *sql;
-    int ret;
-    int header = 1;
-    const unsigned char *blob;
-    int size;
-    char *xname;
-    xname = gaiaDoubleQuotedSql (table);
-    sql = sqlite3_mprintf ("SELECT NetworkData FROM \"%s\" ORDER BY Id", xname);
-    free (xname);
-    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
-    sqlite3_free (sql);
-    if (ret != SQLITE_OK)
-	goto abort;
-    while (1)
+    unsigned char *source = NULL;
+    int source_size;
+    sqlite3_int64 rows;
+    sqlite3_int64 bytes;
+    sqlite3_int64 hash;
+    char *tmp_file = NULL;
+    char *msg;
+    FILE *out = NULL;
+    int ok;
+
+    gaia_create_routing_set_error (cache, NULL);
+    if (routing_data_table == NULL || graph_file == NULL)
+      {
+	  gaia_create_routing_set_error (cache,
+					 "Routing-Data Table and Graph-file are both required");
+	  return 0;
+      }
+    graph = load_network (handle, routing_data_table);
+    if (graph == NULL)
       {
-	  ret = sqlite3_step (stmt);
-	  if (ret == SQLITE_DONE)
-	      break;
-	  if (ret == SQLITE_ROW)
-	    {
-		if (sqlite3_column_type (stmt, 0) == SQLITE_BLOB)
-		  {
-		      blob =
-			  (const unsigned char *) sqlite3_column_blob (stmt, 0);
-		      size = sqlite3_column_bytes (stmt, 0);
-		      if (header)
-			{
-			    /* parsing the HEADER block */
-			    graph = network_init (blob, size);
-			    header = 0;
-			}
-		      else
-			{
-			    /* parsing ordinary Blocks */
-			    if (!graph)
-			      {
-				  sqlite3_finalize (stmt);
-				  goto abort;
-			      }
-			    if (!network_block (graph, blob, size))
-			      {
-				  sqlite3_finalize (stmt);
-				  goto abort;
-			      }
-			}
-		  }
-		else
-		  {
-		      sqlite3_finalize (stmt);
-		      goto abort;
-		  }
-	    }
-	  else
-	    {
-		sqlite3_finalize (stmt);
-		goto abort;
-	    }
+	  msg =
+	      sqlite3_mprintf ("\"%s\" is not a valid Routing-Data Table",
+			       routing_data_table);
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  return 0;
       }
-    sqlite3_finalize (stmt);
-    find_srid (handle, graph);
-    return graph;
-  abort:
+    if (!routing_graph_source
+	(handle, routing_data_table, &rows, &bytes, &hash, &source,
+	 &source_size))
+      {
+	  msg =
+	      sqlite3_mprintf ("unable to read the \"%s\" HEADER block",
+			       routing_data_table);
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  goto error;
+      }
+
+/* the file is atomically replaced, never rewritten in place */
+    tmp_file = sqlite3_mprintf ("%s.tmp", graph_file);
+    out = fopen (tmp_file, "wb");
+    if (out == NULL)
+      {
+	  msg = sqlite3_mprintf ("unable to create \"%s\"", tmp_file);
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  goto error;
+      }
+    ok =
+	routing_graph_write (out, graph, source, source_size, rows, bytes,
+			     hash);
+    if (fclose (out) != 0)
+	ok = 0;
+    out = NULL;
+    if (!ok)
+      {
+	  msg = sqlite3_mprintf ("unable to write \"%s\"", tmp_file);
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  remove (tmp_file);
+	  goto error;
+      }
+#ifdef _WIN32
+    remove (graph_file);
+#endif
+    if (rename (tmp_file, graph_file) != 0)
+      {
+	  msg = sqlite3_mprintf ("unable to rename \"%s\"", tmp_file);
+	  gaia_create_routing_set_error (cache, msg);
+	  sqlite3_free (msg);
+	  remove (tmp_file);
+	  goto error;
+      }
+    sqlite3_free (tmp_file);
+    free (source);
     network_free (graph);
-    return NULL;
+    return 1;
+
+  error:
+    if (tmp_file != NULL)
+	sqlite3_free (tmp_file);
+    if (source != NULL)
+	free (source);
+    network_free (graph);
+    return 0;
 }
 
 static void
@@ -5356,9 +7754,12 @@ do_check_by_code_point2point_oneway (RoutingPtr graph, sqlite3_int64 rowid,
 	return 0;
     for (j = 0; j < node->NumLinks; j++)
       {
-	  RouteLinkPtr link = &(node->Links[j]);
-	  if (strcmp (link->NodeFrom->Code, node_from) == 0
-	      && strcmp (link->NodeTo->Code, node_to) == 0
+	  RouteLinkPtr link = graph->Links + node->FirstLink + j;
+	  if (strcmp
+	      (VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, link)),
+	       node_from) == 0
+	      && strcmp (VROUTE_NODE_CODE
+			 (graph, VROUTE_NODE_TO (graph, link)), node_to) == 0
 	      && link->LinkRowid == rowid)
 	      return 1;
       }
@@ -5377,8 +7778,9 @@ do_check_by_id_point2point_oneway (RoutingPtr graph, sqlite3_int64 rowid,
 	return 0;
     for (j = 0; j < node->NumLinks; j++)
       {
-	  RouteLinkPtr link = &(node->Links[j]);
-	  if (link->NodeFrom->Id == node_from && link->NodeTo->Id == node_to
+	  RouteLinkPtr link = graph->Links + node->FirstLink + j;
+	  if (VROUTE_NODE_FROM (graph, link)->Id == node_from
+	      && VROUTE_NODE_TO (graph, link)->Id == node_to
 	      && link->LinkRowid == rowid)
 	      return 1;
       }
@@ -6182,7 +8584,7 @@ add_point2point_node_to_by_id (Point2PointSolutionPtr p2p, sqlite3_int64 id,
 
 static void
 point2point_eval_solution (Point2PointSolutionPtr p2p,
-			   ShortestPathSolutionPtr solution, int nodeCode)
+			   ShortestPathSolutionPtr solution, RoutingPtr graph)
 {
 /* attempting to identify the optimal Point2Point solution */
     Point2PointCandidatePtr p_from = p2p->firstFromCandidate;
@@ -6192,9 +8594,11 @@ point2point_eval_solution (Point2PointSolutionPtr p2p,
 	  int ok = 0;
 	  if (solution->From != NULL)
 	    {
-		if (nodeCode)
+		if (graph->NodeCode)
 		  {
-		      if (strcmp (solution->From->Code, p_from->codNodeTo) == 0)
+		      if (strcmp
+			  (VROUTE_NODE_CODE (graph, solution->From),
+			   p_from->codNodeTo) == 0)
 			  ok = 1;
 		  }
 		else
@@ -6212,10 +8616,10 @@ point2point_eval_solution (Point2PointSolutionPtr p2p,
 		      int ok2 = 0;
 		      if (solution->To != NULL)
 			{
-			    if (nodeCode)
+			    if (graph->NodeCode)
 			      {
 				  if (strcmp
-				      (solution->To->Code,
+				      (VROUTE_NODE_CODE (graph, solution->To),
 				       p_to->codNodeFrom) == 0)
 				      ok2 = 1;
 			      }
@@ -6319,8 +8723,8 @@ find_link (sqlite3 * sqlite, RoutingPtr graph, sqlite3_int64 linkRowid)
 		      if (ptr != NULL)
 			  free (ptr);
 		      ptr = malloc (sizeof (RouteLink));
-		      ptr->NodeFrom = from;
-		      ptr->NodeTo = to;
+		      ptr->NodeFrom = from->InternalIndex;
+		      ptr->NodeTo = to->InternalIndex;
 		      ptr->LinkRowid = linkRowid;
 		      ptr->Cost = 0.0;
 		  }
@@ -6651,11 +9055,16 @@ build_point2point_solution (sqlite3 * sqlite, int options, RoutingPtr graph,
 						{
 						    /* nodes are identified by TEXT codes */
 						    const char *from =
-							row->linkRef->
-							Link->NodeFrom->Code;
+							VROUTE_NODE_CODE
+							(graph,
+							 VROUTE_NODE_FROM
+							 (graph,
+							  row->linkRef->Link));
 						    const char *to =
-							row->linkRef->
-							Link->NodeTo->Code;
+							VROUTE_NODE_CODE
+							(graph,
+							 VROUTE_NODE_TO (graph,
+									 row->linkRef->Link));
 						    if (strcmp (from_code, from)
 							== 0
 							&& strcmp (to_code,
@@ -6666,11 +9075,12 @@ build_point2point_solution (sqlite3 * sqlite, int options, RoutingPtr graph,
 						{
 						    /* nodes are identified by INTEGER ids */
 						    sqlite3_int64 from =
-							row->linkRef->
-							Link->NodeFrom->Id;
+							VROUTE_NODE_FROM
+							(graph,
+							 row->linkRef->Link)->Id;
 						    sqlite3_int64 to =
-							row->linkRef->
-							Link->NodeTo->Id;
+							VROUTE_NODE_TO (graph,
+									row->linkRef->Link)->Id;
 						    if (from_id == from
 							&& to_id == to)
 							reverse = 0;
@@ -6905,7 +9315,7 @@ point2point_resolve (virtualroutingCursorPtr cursor)
 	  solution = cursor->pVtab->multiSolution->First;
 	  while (solution != NULL)
 	    {
-		point2point_eval_solution (p2p, solution, graph->NodeCode);
+		point2point_eval_solution (p2p, solution, graph);
 		solution = solution->Next;
 	    }
 	  p_node_from = p_node_from->next;
@@ -6953,6 +9363,9 @@ point2point_resolve (virtualroutingCursorPtr cursor)
     if (net->currentAlgorithm == VROUTE_A_STAR_ALGORITHM)
 	astar_solve (cursor->pVtab->db, VROUTE_SHORTEST_PATH_QUICK, graph,
 		     cursor->pVtab->routing, cursor->pVtab->multiSolution);
+    else if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+	ch_solve (cursor->pVtab->db, VROUTE_SHORTEST_PATH_QUICK, graph,
+		  cursor->pVtab->multiSolution);
     else
 	dijkstra_multi_solve (cursor->pVtab->db, VROUTE_SHORTEST_PATH_QUICK,
 			      graph, cursor->pVtab->routing,
@@ -7130,6 +9543,7 @@ vroute_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
     int n_columns;
     char *vtable = NULL;
     char *table = NULL;
+    char *graph_file = NULL;
     const char *col_name = NULL;
     char **results;
     char *err_msg = NULL;
@@ -7141,16 +9555,18 @@ vroute_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
     if (pAux)
 	pAux = pAux;		/* unused arg warning suppression */
 /* checking for table_name and geo_column_name */
-    if (argc == 4)
+    if (argc == 4 || argc == 5)
       {
 	  vtable = gaiaDequotedSql (argv[2]);
 	  table = gaiaDequotedSql (argv[3]);
+	  if (argc == 5)
+	      graph_file = gaiaDequotedSql (argv[4]);
       }
     else
       {
 	  *pzErr =
 	      sqlite3_mprintf
-	      ("[virtualrouting module] CREATE VIRTUAL: illegal arg list {NETWORK-DATAtable}\n");
+	      ("[virtualrouting module] CREATE VIRTUAL: illegal arg list {NETWORK-DATAtable [, GRAPH-file]}\n");
 	  goto error;
       }
 /* retrieving the base table columns */
@@ -7192,12 +9608,18 @@ vroute_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
 	  *pzErr =
 	      sqlite3_mprintf
 	      ("[virtualrouting module] cannot build a valid NETWORK\n");
-	  return SQLITE_ERROR;
+	  goto error;
       }
     p_vt = (virtualroutingPtr) sqlite3_malloc (sizeof (virtualrouting));
     if (!p_vt)
 	return SQLITE_NOMEM;
-    graph = load_network (db, table);
+    if (graph_file != NULL)
+      {
+	  /* attempting to map a shared Routing Graph file */
+	  graph = network_map_file (db, table, graph_file);
+      }
+    if (!graph)
+	graph = load_network (db, table);
     if (!graph)
       {
 	  /* something is going the wrong way */
@@ -7207,6 +9629,7 @@ vroute_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
 	  goto error;
       }
     p_vt->db = db;
+    p_vt->p_cache = pAux;
     p_vt->graph = graph;
     p_vt->currentAlgorithm = VROUTE_DIJKSTRA_ALGORITHM;
     p_vt->currentRequest = VROUTE_SHORTEST_PATH;
@@ -7279,15 +9702,18 @@ vroute_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
       }
     sqlite3_free (sql);
     *ppVTab = (sqlite3_vtab *) p_vt;
-    p_vt->routing = routing_init (p_vt->graph);
     free (table);
     free (vtable);
+    if (graph_file)
+	free (graph_file);
     return SQLITE_OK;
   error:
     if (table)
 	free (table);
     if (vtable)
 	free (vtable);
+    if (graph_file)
+	free (graph_file);
     return SQLITE_ERROR;
 }
 
@@ -7449,6 +9875,14 @@ vroute_read_row (virtualroutingCursorPtr cursor)
 	  else
 	      cursor->pVtab->eof = 0;
       }
+    else if (cursor->pVtab->multiSolution->Mode == VROUTE_MATRIX_SOLUTION)
+      {
+	  if (cursor->pVtab->multiSolution->CurrentCell >=
+	      cursor->pVtab->multiSolution->MatrixCells)
+	      cursor->pVtab->eof = 1;
+	  else
+	      cursor->pVtab->eof = 0;
+      }
     else
       {
 	  if (cursor->pVtab->multiSolution->CurrentRow == NULL)
@@ -7498,6 +9932,31 @@ vroute_close (sqlite3_vtab_cursor * pCursor)
     return SQLITE_OK;
 }
 
+static RoutingMultiDestPtr
+vroute_get_matrix_origins (virtualroutingPtr net, sqlite3_value * value)
+{
+/* parsing the Cost Matrix origins (a single Node or a list of Nodes) */
+    RoutingMultiDestPtr multiple = NULL;
+    if (sqlite3_value_type (value) == SQLITE_TEXT)
+      {
+	  multiple =
+	      vroute_get_multiple_destinations (net->graph->NodeCode,
+						net->currentDelimiter,
+						(const char *)
+						sqlite3_value_text (value));
+      }
+    else if (sqlite3_value_type (value) == SQLITE_INTEGER
+	     && !(net->graph->NodeCode))
+	multiple = vroute_as_multiple_destinations (sqlite3_value_int (value));
+    if (multiple == NULL)
+	return NULL;
+    if (net->graph->NodeCode)
+	set_multi_by_code (multiple, net->graph);
+    else
+	set_multi_by_id (multiple, net->graph);
+    return multiple;
+}
+
 static int
 vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 	       int argc, sqlite3_value ** argv)
@@ -7516,6 +9975,11 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
     if (idxStr)
 	idxStr = idxStr;	/* unused arg warning suppression */
     node_code = net->graph->NodeCode;
+    if (net->routing == NULL)
+      {
+	  /* lazily allocating the per-connection Routing workspace */
+	  net->routing = routing_init (net->graph);
+      }
     reset_multiSolution (multiSolution);
     reset_point2PointSolution (p2p);
     cursor->pVtab->eof = 0;
@@ -7645,6 +10109,13 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 					 sqlite3_value_int (argv[1]));
 	    }
       }
+    if ((idxNum == 1 || idxNum == 2) && argc == 2
+	&& net->currentRequest == VROUTE_COST_MATRIX)
+      {
+	  /* Cost Matrix: NodeFrom could be a list of origins as well */
+	  multiSolution->MultiFrom =
+	      vroute_get_matrix_origins (net, argv[(idxNum == 1) ? 0 : 1]);
+      }
     if (idxNum == 3 && argc == 2)
       {
 	  /* retrieving the From and Cost param */
@@ -7856,13 +10327,27 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 	  cursor->pVtab->eof = 0;
 	  return SQLITE_OK;
       }
+    if (multiSolution->MultiFrom && multiSolution->MultiTo)
+      {
+	  /* many-to-many Cost Matrix */
+	  multiSolution->Mode = VROUTE_MATRIX_SOLUTION;
+	  multiSolution->CurrentRowId = 0;
+	  if (!matrix_solve (net->currentAlgorithm, net->graph, multiSolution))
+	    {
+		cursor->pVtab->eof = 1;
+		return SQLITE_NOMEM;
+	    }
+	  cursor->pVtab->eof = (multiSolution->MatrixCells > 0) ? 0 : 1;
+	  return SQLITE_OK;
+      }
     if (multiSolution->From && multiSolution->MultiTo)
       {
 	  cursor->pVtab->eof = 0;
 	  if (net->currentRequest == VROUTE_TSP_NN)
 	    {
 		multiSolution->Mode = VROUTE_TSP_SOLUTION;
-		if (net->currentAlgorithm == VROUTE_DIJKSTRA_ALGORITHM)
+		if (net->currentAlgorithm == VROUTE_DIJKSTRA_ALGORITHM
+		    || net->currentAlgorithm == VROUTE_CH_ALGORITHM)
 		  {
 		      tsp_nn_solve (net->db, net->currentOptions, net->graph,
 				    net->routing, multiSolution);
@@ -7873,7 +10358,8 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 	  else if (net->currentRequest == VROUTE_TSP_GA)
 	    {
 		multiSolution->Mode = VROUTE_TSP_SOLUTION;
-		if (net->currentAlgorithm == VROUTE_DIJKSTRA_ALGORITHM)
+		if (net->currentAlgorithm == VROUTE_DIJKSTRA_ALGORITHM
+		    || net->currentAlgorithm == VROUTE_CH_ALGORITHM)
 		  {
 		      tsp_ga_solve (net->db, net->currentOptions, net->graph,
 				    net->routing, multiSolution);
@@ -7881,6 +10367,24 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 		      multiSolution->CurrentRow = multiSolution->FirstRow;
 		  }
 	    }
+	  else if (net->currentRequest == VROUTE_TSP_GA_MT)
+	    {
+		multiSolution->Mode = VROUTE_TSP_SOLUTION;
+		if (net->currentAlgorithm == VROUTE_DIJKSTRA_ALGORITHM
+		    || net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+		  {
+		      struct splite_internal_cache *cache =
+			  (struct splite_internal_cache *) net->p_cache;
+		      int max_threads = 1;
+		      if (cache != NULL)
+			  max_threads = cache->max_threads;
+		      tsp_ga_mt_solve (net->db, net->currentOptions,
+				       net->graph, net->routing, multiSolution,
+				       max_threads);
+		      multiSolution->CurrentRowId = 0;
+		      multiSolution->CurrentRow = multiSolution->FirstRow;
+		  }
+	    }
 	  else
 	    {
 		multiSolution->Mode = VROUTE_ROUTING_SOLUTION;
@@ -7897,6 +10401,19 @@ vroute_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
 			  astar_solve (net->db, net->currentOptions, net->graph,
 				       net->routing, multiSolution);
 		  }
+		else if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+		  {
+		      if (multiSolution->MultiTo->Items > 1)
+			{
+			    /* multiple destinations: always defaulting to Dijkstra */
+			    dijkstra_multi_solve (net->db, net->currentOptions,
+						  net->graph, net->routing,
+						  multiSolution);
+			}
+		      else
+			  ch_solve (net->db, net->currentOptions, net->graph,
+				    multiSolution);
+		  }
 		else
 		    dijkstra_multi_solve (net->db, net->currentOptions,
 					  net->graph, net->routing,
@@ -7966,6 +10483,15 @@ vroute_next (sqlite3_vtab_cursor * pCursor)
 		return SQLITE_OK;
 	    }
       }
+    else if (multiSolution->Mode == VROUTE_MATRIX_SOLUTION)
+      {
+	  multiSolution->CurrentCell += 1;
+	  if (multiSolution->CurrentCell >= multiSolution->MatrixCells)
+	    {
+		cursor->pVtab->eof = 1;
+		return SQLITE_OK;
+	    }
+      }
     else
       {
 	  if (multiSolution->CurrentRow == NULL)
@@ -7993,12 +10519,139 @@ vroute_eof (sqlite3_vtab_cursor * pCursor)
     return cursor->pVtab->eof;
 }
 
+static void
+do_cost_matrix_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
+		       sqlite3_context * pContext, int node_code, int column)
+{
+/* processing a Cost Matrix solution row */
+    MultiSolutionPtr multiSolution = cursor->pVtab->multiSolution;
+    RoutingMultiDestPtr origins = multiSolution->MultiFrom;
+    RoutingMultiDestPtr destinations = multiSolution->MultiTo;
+    int cell = multiSolution->CurrentCell;
+    int i = cell / destinations->Items;
+    int j = cell % destinations->Items;
+    double cost = multiSolution->Matrix[cell];
+    const char *algorithm;
+    char delimiter[128];
+    const char *role;
+
+    if (column == 0)
+      {
+	  /* the currently used Algorithm */
+	  if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+	      algorithm = "CH";
+	  else
+	      algorithm = "Dijkstra";
+	  if (cell != 0)
+	      sqlite3_result_null (pContext);
+	  else
+	      sqlite3_result_text (pContext, algorithm, strlen (algorithm),
+				   SQLITE_TRANSIENT);
+      }
+    if (column == 1)
+      {
+	  /* the current Request type */
+	  algorithm = "Matrix";
+	  if (cell != 0)
+	      sqlite3_result_null (pContext);
+	  else
+	      sqlite3_result_text (pContext, algorithm, strlen (algorithm),
+				   SQLITE_TRANSIENT);
+      }
+    if (column == 2)
+      {
+	  /* the currently set Options: a Matrix has no Links */
+	  algorithm = "No Links";
+	  if (cell != 0)
+	      sqlite3_result_null (pContext);
+	  else
+	      sqlite3_result_text (pContext, algorithm, strlen (algorithm),
+				   SQLITE_TRANSIENT);
+      }
+    if (column == 3)
+      {
+	  /* the currently set delimiter char */
+	  if (isprint (cursor->pVtab->currentDelimiter))
+	      sprintf (delimiter, "%c [dec=%d, hex=%02x]",
+		       cursor->pVtab->currentDelimiter,
+		       cursor->pVtab->currentDelimiter,
+		       cursor->pVtab->currentDelimiter);
+	  else
+	      sprintf (delimiter, "[dec=%d, hex=%02x]",
+		       cursor->pVtab->currentDelimiter,
+		       cursor->pVtab->currentDelimiter);
+	  if (cell != 0)
+	      sqlite3_result_null (pContext);
+	  else
+	      sqlite3_result_text (pContext, delimiter, strlen (delimiter),
+				   SQLITE_TRANSIENT);
+      }
+    if (column == 4)
+      {
+	  /* the RouteNum column: the origin index */
+	  sqlite3_result_int (pContext, i);
+      }
+    if (column == 5)
+      {
+	  /* the RouteRow column: the destination index */
+	  sqlite3_result_int (pContext, j);
+      }
+    if (column == 6)
+      {
+	  /* role of this row */
+	  if (*(origins->To + i) == NULL)
+	      role = "Undefined NodeFrom";
+	  else if (*(destinations->To + j) == NULL)
+	      role = "Undefined NodeTo";
+	  else if (cost < 0.0)
+	      role = "Unreachable NodeTo";
+	  else
+	      role = "Cost";
+	  sqlite3_result_text (pContext, role, strlen (role), SQLITE_TRANSIENT);
+      }
+    if (column == 8)
+      {
+	  /* the NodeFrom column */
+	  if (node_code)
+	      sqlite3_result_text (pContext, *(origins->Codes + i),
+				   strlen (*(origins->Codes + i)),
+				   SQLITE_STATIC);
+	  else
+	      sqlite3_result_int64 (pContext, *(origins->Ids + i));
+      }
+    if (column == 9)
+      {
+	  /* the NodeTo column */
+	  if (node_code)
+	      sqlite3_result_text (pContext, *(destinations->Codes + j),
+				   strlen (*(destinations->Codes + j)),
+				   SQLITE_STATIC);
+	  else
+	      sqlite3_result_int64 (pContext, *(destinations->Ids + j));
+      }
+    if (column == 13)
+      {
+	  /* the Cost column */
+	  if (cost < 0.0)
+	      sqlite3_result_null (pContext);
+	  else
+	      sqlite3_result_double (pContext, cost);
+      }
+    if (column == 7 || column == 10 || column == 11 || column == 12
+	|| column == 14 || column == 15)
+      {
+	  /* LinkRowid, PointFrom, PointTo, Tolerance, Geometry and Name */
+	  sqlite3_result_null (pContext);
+      }
+}
+
 static void
 do_cost_range_column (virtualroutingCursorPtr cursor,
 		      sqlite3_context * pContext, int node_code,
 		      RowNodeSolutionPtr row_node, int column)
 {
 /* processing a "within Cost range" solution row */
+    RoutingPtr graph = cursor->pVtab->graph;
     const char *algorithm;
     char delimiter[128];
     const char *role;
@@ -8078,9 +10731,8 @@ do_cost_range_column (virtualroutingCursorPtr cursor,
 	  /* the NodeFrom column */
 	  if (node_code)
 	      sqlite3_result_text (pContext,
-				   cursor->pVtab->multiSolution->From->Code,
-				   strlen (cursor->pVtab->multiSolution->
-					   From->Code), SQLITE_STATIC);
+				   VROUTE_NODE_CODE (graph, cursor->pVtab->multiSolution->From),
+				   strlen (VROUTE_NODE_CODE (graph, cursor->pVtab->multiSolution->From)), SQLITE_STATIC);
 	  else
 	      sqlite3_result_int64 (pContext,
 				    cursor->pVtab->multiSolution->From->Id);
@@ -8093,8 +10745,8 @@ do_cost_range_column (virtualroutingCursorPtr cursor,
 	  else
 	    {
 		if (node_code)
-		    sqlite3_result_text (pContext, row_node->Node->Code,
-					 strlen (row_node->Node->Code),
+		    sqlite3_result_text (pContext, VROUTE_NODE_CODE (graph, row_node->Node),
+					 strlen (VROUTE_NODE_CODE (graph, row_node->Node)),
 					 SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext, row_node->Node->Id);
@@ -8159,6 +10811,7 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		  ResultsetRowPtr row, int column)
 {
 /* processing an ordinary Routing (Shortest Path or TSP) solution row */
+    RoutingPtr graph = cursor->pVtab->graph;
     const char *algorithm;
     char delimiter[128];
     const char *role;
@@ -8173,6 +10826,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		/* the currently used Algorithm */
 		if (net->currentAlgorithm == VROUTE_A_STAR_ALGORITHM)
 		    algorithm = "A*";
+		else if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+		    algorithm = "CH";
 		else
 		    algorithm = "Dijkstra";
 		if (row != first)
@@ -8188,6 +10843,10 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		    algorithm = "TSP NN";
 		else if (net->currentRequest == VROUTE_TSP_GA)
 		    algorithm = "TSP GA";
+		else if (net->currentRequest == VROUTE_TSP_GA_MT)
+		    algorithm = "TSP GA MT";
+		else if (net->currentRequest == VROUTE_COST_MATRIX)
+		    algorithm = "Matrix";
 		else
 		    algorithm = "Shortest Path";
 		if (row != first)
@@ -8250,6 +10909,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		  {
 		      if (net->currentAlgorithm == VROUTE_A_STAR_ALGORITHM)
 			  algorithm = "A*";
+		      else if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+			  algorithm = "CH";
 		      else
 			  algorithm = "Dijkstra";
 		  }
@@ -8266,6 +10927,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		    algorithm = "TSP NN";
 		else if (net->currentRequest == VROUTE_TSP_GA)
 		    algorithm = "TSP GA";
+		else if (net->currentRequest == VROUTE_TSP_GA_MT)
+		    algorithm = "TSP GA MT";
 		else
 		    algorithm = "Shortest Path";
 		if (row != first)
@@ -8349,8 +11012,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		else
 		  {
 		      if (node_code)
-			  sqlite3_result_text (pContext, row->From->Code,
-					       strlen (row->From->Code),
+			  sqlite3_result_text (pContext, VROUTE_NODE_CODE (graph, row->From),
+					       strlen (VROUTE_NODE_CODE (graph, row->From)),
 					       SQLITE_STATIC);
 		      else
 			  sqlite3_result_int64 (pContext, row->From->Id);
@@ -8413,6 +11076,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		  {
 		      if (net->currentAlgorithm == VROUTE_A_STAR_ALGORITHM)
 			  algorithm = "A*";
+		      else if (net->currentAlgorithm == VROUTE_CH_ALGORITHM)
+			  algorithm = "CH";
 		      else
 			  algorithm = "Dijkstra";
 		  }
@@ -8429,6 +11094,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		    algorithm = "TSP NN";
 		else if (net->currentRequest == VROUTE_TSP_GA)
 		    algorithm = "TSP GA";
+		else if (net->currentRequest == VROUTE_TSP_GA_MT)
+		    algorithm = "TSP GA MT";
 		else
 		    algorithm = "Shortest Path";
 		if (row != first)
@@ -8514,8 +11181,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 	    {
 		/* the NodeFrom column */
 		if (node_code)
-		    sqlite3_result_text (pContext, row->From->Code,
-					 strlen (row->From->Code),
+		    sqlite3_result_text (pContext, VROUTE_NODE_CODE (graph, row->From),
+					 strlen (VROUTE_NODE_CODE (graph, row->From)),
 					 SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext, row->From->Id);
@@ -8524,8 +11191,8 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 	    {
 		/* the NodeTo column */
 		if (node_code)
-		    sqlite3_result_text (pContext, row->To->Code,
-					 strlen (row->To->Code), SQLITE_STATIC);
+		    sqlite3_result_text (pContext, VROUTE_NODE_CODE (graph, row->To),
+					 strlen (VROUTE_NODE_CODE (graph, row->To)), SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext, row->To->Id);
 	    }
@@ -8622,25 +11289,23 @@ do_common_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		/* the NodeFrom column */
 		if (node_code)
 		    sqlite3_result_text (pContext,
-					 row->linkRef->Link->NodeFrom->Code,
-					 strlen (row->linkRef->Link->
-						 NodeFrom->Code),
+					 VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link)),
+					 strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link))),
 					 SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext,
-					  row->linkRef->Link->NodeFrom->Id);
+					  VROUTE_NODE_FROM (graph, row->linkRef->Link)->Id);
 	    }
 	  if (column == 9)
 	    {
 		/* the NodeTo column */
 		if (node_code)
 		    sqlite3_result_text (pContext,
-					 row->linkRef->Link->NodeTo->Code,
-					 strlen (row->linkRef->Link->
-						 NodeTo->Code), SQLITE_STATIC);
+					 VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link)),
+					 strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link))), SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext,
-					  row->linkRef->Link->NodeTo->Id);
+					  VROUTE_NODE_TO (graph, row->linkRef->Link)->Id);
 	    }
 	  if (column == 10)
 	    {
@@ -8686,6 +11351,7 @@ do_point2point_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		       ResultsetRowPtr row, int column)
 {
 /* processing a Point2Point solution row */
+    RoutingPtr graph = cursor->pVtab->graph;
     const char *algorithm;
     char delimiter[128];
     const char *role;
@@ -8810,15 +11476,12 @@ do_point2point_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		  {
 		      if (node_code)
 			  sqlite3_result_text (pContext,
-					       row->linkRef->Link->
-					       NodeFrom->Code,
-					       strlen (row->linkRef->
-						       Link->NodeFrom->Code),
+					       VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link)),
+					       strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link))),
 					       SQLITE_STATIC);
 		      else
 			  sqlite3_result_int64 (pContext,
-						row->linkRef->Link->
-						NodeFrom->Id);
+						VROUTE_NODE_FROM (graph, row->linkRef->Link)->Id);
 		  }
 		else
 		    sqlite3_result_null (pContext);
@@ -8830,13 +11493,12 @@ do_point2point_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		  {
 		      if (node_code)
 			  sqlite3_result_text (pContext,
-					       row->linkRef->Link->NodeTo->Code,
-					       strlen (row->linkRef->
-						       Link->NodeTo->Code),
+					       VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link)),
+					       strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link))),
 					       SQLITE_STATIC);
 		      else
 			  sqlite3_result_int64 (pContext,
-						row->linkRef->Link->NodeTo->Id);
+						VROUTE_NODE_TO (graph, row->linkRef->Link)->Id);
 		  }
 		else
 		    sqlite3_result_null (pContext);
@@ -8971,25 +11633,23 @@ do_point2point_column (virtualroutingCursorPtr cursor, virtualroutingPtr net,
 		/* the NodeFrom column */
 		if (node_code)
 		    sqlite3_result_text (pContext,
-					 row->linkRef->Link->NodeFrom->Code,
-					 strlen (row->linkRef->Link->
-						 NodeFrom->Code),
+					 VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link)),
+					 strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_FROM (graph, row->linkRef->Link))),
 					 SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext,
-					  row->linkRef->Link->NodeFrom->Id);
+					  VROUTE_NODE_FROM (graph, row->linkRef->Link)->Id);
 	    }
 	  if (column == 9)
 	    {
 		/* the NodeTo column */
 		if (node_code)
 		    sqlite3_result_text (pContext,
-					 row->linkRef->Link->NodeTo->Code,
-					 strlen (row->linkRef->Link->
-						 NodeTo->Code), SQLITE_STATIC);
+					 VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link)),
+					 strlen (VROUTE_NODE_CODE (graph, VROUTE_NODE_TO (graph, row->linkRef->Link))), SQLITE_STATIC);
 		else
 		    sqlite3_result_int64 (pContext,
-					  row->linkRef->Link->NodeTo->Id);
+					  VROUTE_NODE_TO (graph, row->linkRef->Link)->Id);
 	    }
 	  if (column == 13)
 	    {
@@ -9032,6 +11692,12 @@ vroute_column (sqlite3_vtab_cursor * pCursor, sqlite3_context * pContext,
 	  do_cost_range_column (cursor, pContext, node_code, row_node, column);
 	  return SQLITE_OK;
       }
+    else if (cursor->pVtab->multiSolution->Mode == VROUTE_MATRIX_SOLUTION)
+      {
+	  /* processing a Cost Matrix solution */
+	  do_cost_matrix_column (cursor, net, pContext, node_code, column);
+	  return SQLITE_OK;
+      }
     else if (cursor->pVtab->multiSolution->Mode == VROUTE_ROUTING_SOLUTION
 	     || cursor->pVtab->multiSolution->Mode == VROUTE_TSP_SOLUTION)
       {
@@ -9099,8 +11765,14 @@ vroute_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 			    if (strcasecmp ((char *) algorithm, "A*") == 0)
 				p_vtab->currentAlgorithm =
 				    VROUTE_A_STAR_ALGORITHM;
+			    if (strcasecmp ((char *) algorithm, "CH") == 0)
+				p_vtab->currentAlgorithm = VROUTE_CH_ALGORITHM;
 			}
-		      if (p_vtab->graph->AStar == 0)
+		      if (p_vtab->currentAlgorithm == VROUTE_A_STAR_ALGORITHM
+			  && p_vtab->graph->AStar == 0)
+			  p_vtab->currentAlgorithm = VROUTE_DIJKSTRA_ALGORITHM;
+		      if (p_vtab->currentAlgorithm == VROUTE_CH_ALGORITHM
+			  && p_vtab->graph->CH == NULL)
 			  p_vtab->currentAlgorithm = VROUTE_DIJKSTRA_ALGORITHM;
 		      if (sqlite3_value_type (argv[3]) == SQLITE_TEXT)
 			{
@@ -9114,9 +11786,15 @@ vroute_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
 			    else if (strcasecmp ((char *) request, "TSP GA") ==
 				     0)
 				p_vtab->currentRequest = VROUTE_TSP_GA;
+			    else if (strcasecmp ((char *) request, "TSP GA MT")
+				     == 0)
+				p_vtab->currentRequest = VROUTE_TSP_GA_MT;
 			    else if (strcasecmp
 				     ((char *) request, "SHORTEST PATH") == 0)
 				p_vtab->currentRequest = VROUTE_SHORTEST_PATH;
+			    else if (strcasecmp ((char *) request, "MATRIX") ==
+				     0)
+				p_vtab->currentRequest = VROUTE_COST_MATRIX;
 			}
 		      if (sqlite3_value_type (argv[4]) == SQLITE_TEXT)
 			{
@@ -9199,7 +11877,7 @@ vroute_rename (sqlite3_vtab * pVTab, const char *zNew)
 }
 
 static int
-splitevirtualroutingInit (sqlite3 * db)
+splitevirtualroutingInit (sqlite3 * db, void *p_cache)
 {
     int rc = SQLITE_OK;
     my_route_module.iVersion = 1;
@@ -9222,15 +11900,16 @@ splitevirtualroutingInit (sqlite3 * db)
     my_route_module.xRollback = &vroute_rollback;
     my_route_module.xFindFunction = NULL;
     my_route_module.xRename = &vroute_rename;
-    sqlite3_create_module_v2 (db, "virtualrouting", &my_route_module, NULL, 0);
+    sqlite3_create_module_v2 (db, "virtualrouting", &my_route_module, p_cache,
+			      0);
     return rc;
 }
 
 SPATIALITE_PRIVATE int
-virtualrouting_extension_init (void *xdb)
+virtualrouting_extension_init (void *xdb, const void *p_cache)
 {
     sqlite3 *db = (sqlite3 *) xdb;
-    return splitevirtualroutingInit (db);
+    return splitevirtualroutingInit (db, (void *) p_cache);
 }
 
 #endif /* end GEOS conditional */
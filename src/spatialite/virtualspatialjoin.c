@@ -0,0 +1,1572 @@
+/*
+
+ virtualspatialjoin.c -- SQLite3 extension [VIRTUAL TABLE R*Tree Spatial Join]
+
+ version 5.0, 2020 August 1
+
+ Author: Sandro Furieri a.furieri@lqt.it
+
+ -----------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2008-2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include "config-msvc.h"
+#else
+#include "config.h"
+#endif
+
+#include <spatialite/sqlite.h>
+
+#include <spatialite/spatialite_ext.h>
+#include <spatialite/gaiaaux.h>
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+#include <spatialite_private.h>
+
+#ifdef _WIN32
+#define strcasecmp	_stricmp
+#define strncasecmp	_strnicmp
+#endif /* not WIN32 */
+
+/*
+/ both R*Trees are traversed at the same time, only descending into
+/ pairs of nodes whose MBRs do overlap; node BLOBs are directly read
+/ from the "idx_<table>_<geom>_node" shadow tables (see rtree_bulk.c
+/ for a description of their layout)
+*/
+#define VSJOIN_CELL		24
+#define VSJOIN_HEADER		4
+#define VSJOIN_MAX_DEPTH	40
+#define VSJOIN_NODE_CACHE	256	/* cached nodes for each R*Tree */
+#define VSJOIN_CHUNK		8192	/* candidate pairs produced at once */
+#define VSJOIN_SLICE		256	/* min candidate pairs per worker thread */
+
+#define VSJOIN_MBR		0
+#define VSJOIN_INTERSECTS	1
+#define VSJOIN_TOUCHES		2
+#define VSJOIN_OVERLAPS		3
+#define VSJOIN_CROSSES		4
+#define VSJOIN_CONTAINS		5
+#define VSJOIN_WITHIN		6
+#define VSJOIN_COVERS		7
+#define VSJOIN_COVEREDBY	8
+
+static struct sqlite3_module my_spjoin_module;
+
+struct vsjoin_cell
+{
+/* an R*Tree cell: a rowid (leaves) or a child node (internal nodes) */
+    sqlite3_int64 id;
+    float minx;
+    float maxx;
+    float miny;
+    float maxy;
+};
+
+struct vsjoin_node
+{
+/* a cached R*Tree node */
+    sqlite3_int64 nodeno;	/* 0 if the slot is unused */
+    struct vsjoin_cell *cells;
+    int count;
+    int max_count;
+};
+
+struct vsjoin_tree
+{
+/* one of the two joined R*Trees */
+    char *db_prefix;
+    char *table;
+    char *geometry;
+    sqlite3_stmt *stmt_node;
+    sqlite3_stmt *stmt_geom;
+    int depth;			/* depth of the root node */
+    struct vsjoin_node cache[VSJOIN_NODE_CACHE];
+};
+
+struct vsjoin_task
+{
+/* a pair of nodes still to be joined, and their common search window */
+    sqlite3_int64 node_a;
+    sqlite3_int64 node_b;
+    int depth_a;
+    int depth_b;
+    float minx;
+    float maxx;
+    float miny;
+    float maxy;
+};
+
+struct vsjoin_blob
+{
+/* a Geometry fetched for refinement */
+    sqlite3_int64 rowid;
+    unsigned char *blob;
+    int size;
+};
+
+struct vsjoin_pair
+{
+/* a candidate pair */
+    sqlite3_int64 rowid_a;
+    sqlite3_int64 rowid_b;
+    struct vsjoin_blob *geom_a;
+    struct vsjoin_blob *geom_b;
+    int match;
+};
+
+struct vsjoin_worker
+{
+/* a slice of the candidate pairs, refined by a single thread */
+    const void *cache;		/* owning the GEOS handle */
+    int predicate;
+    struct vsjoin_pair *pairs;
+    int count;
+    void *thread;
+};
+
+/******************************************************************************
+/
+/ VirtualTable structs
+/
+******************************************************************************/
+
+typedef struct VirtualSpatialJoinStruct
+{
+/* extends the sqlite3_vtab struct */
+    const sqlite3_module *pModule;	/* ptr to sqlite module: USED INTERNALLY BY SQLITE */
+    int nRef;			/* # references: USED INTERNALLY BY SQLITE */
+    char *zErrMsg;		/* error message: USE INTERNALLY BY SQLITE */
+    sqlite3 *db;		/* the sqlite db holding the virtual table */
+    const void *p_cache;	/* pointer to the internal cache */
+} VirtualSpatialJoin;
+typedef VirtualSpatialJoin *VirtualSpatialJoinPtr;
+
+typedef struct VirtualSpatialJoinCursorStruct
+{
+/* extends the sqlite3_vtab_cursor struct */
+    VirtualSpatialJoinPtr pVtab;	/* Virtual table of this cursor */
+    int eof;			/* the EOF marker */
+    char *table_a;
+    char *table_b;
+    char *predicate_name;
+    int predicate;
+    struct vsjoin_tree tree_a;
+    struct vsjoin_tree tree_b;
+    struct vsjoin_task *tasks;	/* the traversal stack */
+    int n_tasks;
+    int max_tasks;
+    struct vsjoin_cell *sweep_a;
+    int max_sweep_a;
+    struct vsjoin_cell *sweep_b;
+    int max_sweep_b;
+    struct vsjoin_pair *pairs;	/* the current chunk of pairs */
+    int n_pairs;
+    int max_pairs;
+    int current;
+    struct vsjoin_worker *workers;
+    int n_workers;
+    sqlite3_int64 CurrentRowId;
+} VirtualSpatialJoinCursor;
+typedef VirtualSpatialJoinCursor *VirtualSpatialJoinCursorPtr;
+
+static int
+vsjoin_import16 (const unsigned char *p)
+{
+/* big-endian 16 bit int */
+    return (p[0] << 8) | p[1];
+}
+
+static float
+vsjoin_import_float (const unsigned char *p)
+{
+/* big-endian 32 bit float */
+    unsigned int i;
+    float value;
+    i = ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+	((unsigned int) p[2] << 8) | (unsigned int) p[3];
+    memcpy (&value, &i, 4);
+    return value;
+}
+
+static void
+vsjoin_import_cell (const unsigned char *p, struct vsjoin_cell *cell)
+{
+/* decoding an R*Tree cell */
+    sqlite3_uint64 v = 0;
+    int i;
+    for (i = 0; i < 8; i++)
+	v = (v << 8) | p[i];
+    cell->id = (sqlite3_int64) v;
+    cell->minx = vsjoin_import_float (p + 8);
+    cell->maxx = vsjoin_import_float (p + 12);
+    cell->miny = vsjoin_import_float (p + 16);
+    cell->maxy = vsjoin_import_float (p + 20);
+}
+
+static void
+vsjoin_parse_table_name (const char *tn, char **db_prefix, char **table_name)
+{
+/* attempting to extract an eventual DB prefix */
+    int i;
+    int len = strlen (tn);
+    int i_dot = -1;
+    if (strncasecmp (tn, "DB=", 3) == 0)
+      {
+	  int l_db;
+	  int l_tbl;
+	  for (i = 3; i < len; i++)
+	    {
+		if (tn[i] == '.')
+		  {
+		      i_dot = i;
+		      break;
+		  }
+	    }
+	  if (i_dot > 1)
+	    {
+		l_db = i_dot - 3;
+		l_tbl = len - (i_dot + 1);
+		*db_prefix = malloc (l_db + 1);
+		memset (*db_prefix, '\0', l_db + 1);
+		memcpy (*db_prefix, tn + 3, l_db);
+		*table_name = malloc (l_tbl + 1);
+		strcpy (*table_name, tn + i_dot + 1);
+		return;
+	    }
+      }
+    *table_name = malloc (len + 1);
+    strcpy (*table_name, tn);
+}
+
+static int
+vsjoin_parse_predicate (const char *name)
+{
+/* identifying the spatial predicate to be evaluated */
+    if (name == NULL || strcasecmp (name, "mbr") == 0)
+	return VSJOIN_MBR;
+    if (strcasecmp (name, "intersects") == 0)
+	return VSJOIN_INTERSECTS;
+    if (strcasecmp (name, "touches") == 0)
+	return VSJOIN_TOUCHES;
+    if (strcasecmp (name, "overlaps") == 0)
+	return VSJOIN_OVERLAPS;
+    if (strcasecmp (name, "crosses") == 0)
+	return VSJOIN_CROSSES;
+    if (strcasecmp (name, "contains") == 0)
+	return VSJOIN_CONTAINS;
+    if (strcasecmp (name, "within") == 0)
+	return VSJOIN_WITHIN;
+    if (strcasecmp (name, "covers") == 0)
+	return VSJOIN_COVERS;
+    if (strcasecmp (name, "coveredby") == 0)
+	return VSJOIN_COVEREDBY;
+    return -1;
+}
+
+static void
+vsjoin_reset_tree (struct vsjoin_tree *tree)
+{
+/* resetting one of the joined R*Trees */
+    int i;
+    if (tree->db_prefix != NULL)
+	free (tree->db_prefix);
+    if (tree->table != NULL)
+	free (tree->table);
+    if (tree->geometry != NULL)
+	free (tree->geometry);
+    if (tree->stmt_node != NULL)
+	sqlite3_finalize (tree->stmt_node);
+    if (tree->stmt_geom != NULL)
+	sqlite3_finalize (tree->stmt_geom);
+    for (i = 0; i < VSJOIN_NODE_CACHE; i++)
+      {
+	  if (tree->cache[i].cells != NULL)
+	      free (tree->cache[i].cells);
+      }
+    memset (tree, 0, sizeof (struct vsjoin_tree));
+}
+
+static int
+vsjoin_find_rtree (sqlite3 * sqlite, struct vsjoin_tree *tree,
+		   const char *geom_column)
+{
+/* checks if the required R*Tree is actually defined */
+    sqlite3_stmt *stmt;
+    char *sql_statement;
+    char *quoted_db;
+    int ret;
+    int count = 0;
+    char *rt = NULL;
+    char *rg = NULL;
+
+    quoted_db =
+	gaiaDoubleQuotedSql (tree->db_prefix ==
+			     NULL ? "main" : tree->db_prefix);
+    if (geom_column == NULL)
+	sql_statement =
+	    sqlite3_mprintf
+	    ("SELECT f_table_name, f_geometry_column FROM \"%s\".geometry_columns "
+	     "WHERE Upper(f_table_name) = Upper(%Q) AND spatial_index_enabled = 1",
+	     quoted_db, tree->table);
+    else
+	sql_statement =
+	    sqlite3_mprintf
+	    ("SELECT f_table_name, f_geometry_column FROM \"%s\".geometry_columns "
+	     "WHERE Upper(f_table_name) = Upper(%Q) AND "
+	     "Upper(f_geometry_column) = Upper(%Q) AND spatial_index_enabled = 1",
+	     quoted_db, tree->table, geom_column);
+    free (quoted_db);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &stmt, NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    while (1)
+      {
+	  /* scrolling the result set rows */
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;		/* end of result set */
+	  if (ret == SQLITE_ROW)
+	    {
+		const char *v = (const char *) sqlite3_column_text (stmt, 0);
+		int len = sqlite3_column_bytes (stmt, 0);
+		if (rt)
+		    free (rt);
+		rt = malloc (len + 1);
+		strcpy (rt, v);
+		v = (const char *) sqlite3_column_text (stmt, 1);
+		len = sqlite3_column_bytes (stmt, 1);
+		if (rg)
+		    free (rg);
+		rg = malloc (len + 1);
+		strcpy (rg, v);
+		count++;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    if (count != 1)
+      {
+	  /* not found, or ambiguous (more than a single Geometry column) */
+	  if (rg != NULL)
+	      free (rg);
+	  if (rt != NULL)
+	      free (rt);
+	  return 0;
+      }
+    free (tree->table);
+    tree->table = rt;
+    tree->geometry = rg;
+    return 1;
+}
+
+static int
+vsjoin_prepare_tree (sqlite3 * sqlite, struct vsjoin_tree *tree)
+{
+/* preparing the SQL statements accessing the R*Tree and its Geometries */
+    char *quoted_db;
+    char *idx_name;
+    char *xname;
+    char *xgeom;
+    char *sql_statement;
+    int ret;
+
+    quoted_db =
+	gaiaDoubleQuotedSql (tree->db_prefix ==
+			     NULL ? "main" : tree->db_prefix);
+    idx_name =
+	sqlite3_mprintf ("idx_%s_%s_node", tree->table, tree->geometry);
+    xname = gaiaDoubleQuotedSql (idx_name);
+    sqlite3_free (idx_name);
+    sql_statement =
+	sqlite3_mprintf ("SELECT data FROM \"%s\".\"%s\" WHERE nodeno = ?",
+			 quoted_db, xname);
+    free (xname);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &(tree->stmt_node), NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+      {
+	  free (quoted_db);
+	  return 0;
+      }
+
+    xname = gaiaDoubleQuotedSql (tree->table);
+    xgeom = gaiaDoubleQuotedSql (tree->geometry);
+    sql_statement =
+	sqlite3_mprintf ("SELECT \"%s\" FROM \"%s\".\"%s\" WHERE ROWID = ?",
+			 xgeom, quoted_db, xname);
+    free (xname);
+    free (xgeom);
+    free (quoted_db);
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_statement, strlen (sql_statement),
+			    &(tree->stmt_geom), NULL);
+    sqlite3_free (sql_statement);
+    if (ret != SQLITE_OK)
+	return 0;
+    return 1;
+}
+
+static struct vsjoin_node *
+vsjoin_load_node (struct vsjoin_tree *tree, sqlite3_int64 nodeno)
+{
+/* fetching an R*Tree node (possibly from the cache) */
+    struct vsjoin_node *node =
+	tree->cache + (int) (nodeno & (VSJOIN_NODE_CACHE - 1));
+    const unsigned char *blob;
+    int size;
+    int count;
+    int i;
+    int ret;
+    if (node->nodeno == nodeno)
+	return node;
+    node->nodeno = 0;
+    sqlite3_reset (tree->stmt_node);
+    sqlite3_clear_bindings (tree->stmt_node);
+    sqlite3_bind_int64 (tree->stmt_node, 1, nodeno);
+    ret = sqlite3_step (tree->stmt_node);
+    if (ret != SQLITE_ROW
+	|| sqlite3_column_type (tree->stmt_node, 0) != SQLITE_BLOB)
+	return NULL;
+    blob = sqlite3_column_blob (tree->stmt_node, 0);
+    size = sqlite3_column_bytes (tree->stmt_node, 0);
+    if (size < VSJOIN_HEADER)
+	return NULL;
+    count = vsjoin_import16 (blob + 2);
+    if (size < VSJOIN_HEADER + (count * VSJOIN_CELL))
+	return NULL;
+    if (nodeno == 1)
+	tree->depth = vsjoin_import16 (blob);
+    if (count > node->max_count)
+      {
+	  struct vsjoin_cell *cells =
+	      realloc (node->cells, sizeof (struct vsjoin_cell) * count);
+	  if (cells == NULL)
+	      return NULL;
+	  node->cells = cells;
+	  node->max_count = count;
+      }
+    for (i = 0; i < count; i++)
+	vsjoin_import_cell (blob + VSJOIN_HEADER + (i * VSJOIN_CELL),
+			    node->cells + i);
+    sqlite3_reset (tree->stmt_node);
+    node->count = count;
+    node->nodeno = nodeno;
+    return node;
+}
+
+static int
+vsjoin_cmp_minx (const void *p1, const void *p2)
+{
+/* sorting cells by MinX */
+    const struct vsjoin_cell *c1 = (const struct vsjoin_cell *) p1;
+    const struct vsjoin_cell *c2 = (const struct vsjoin_cell *) p2;
+    if (c1->minx < c2->minx)
+	return -1;
+    if (c1->minx > c2->minx)
+	return 1;
+    return 0;
+}
+
+static int
+vsjoin_filter_cells (struct vsjoin_node *node, const struct vsjoin_task *task,
+		     struct vsjoin_cell **buf, int *max_count)
+{
+/* copying all cells overlapping the search window, sorted by MinX */
+    int i;
+    int count = 0;
+    if (node->count > *max_count)
+      {
+	  struct vsjoin_cell *cells =
+	      realloc (*buf, sizeof (struct vsjoin_cell) * node->count);
+	  if (cells == NULL)
+	      return -1;
+	  *buf = cells;
+	  *max_count = node->count;
+      }
+    for (i = 0; i < node->count; i++)
+      {
+	  struct vsjoin_cell *cell = node->cells + i;
+	  if (cell->minx > task->maxx || cell->maxx < task->minx
+	      || cell->miny > task->maxy || cell->maxy < task->miny)
+	      continue;
+	  (*buf)[count++] = *cell;
+      }
+    qsort (*buf, count, sizeof (struct vsjoin_cell), vsjoin_cmp_minx);
+    return count;
+}
+
+static int
+vsjoin_push_task (VirtualSpatialJoinCursorPtr cursor,
+		  const struct vsjoin_task *parent, sqlite3_int64 node_a,
+		  int depth_a, const struct vsjoin_cell *cell_a,
+		  sqlite3_int64 node_b, int depth_b,
+		  const struct vsjoin_cell *cell_b)
+{
+/* 
+/ pushing a pair of nodes onto the traversal stack; the search window
+/ is further restricted to the MBRs of the descended cells
+*/
+    struct vsjoin_task *task;
+    if (cursor->n_tasks == cursor->max_tasks)
+      {
+	  int max_tasks = (cursor->max_tasks == 0) ? 256 : cursor->max_tasks * 2;
+	  struct vsjoin_task *tasks = realloc (cursor->tasks,
+					       sizeof (struct vsjoin_task) *
+					       max_tasks);
+	  if (tasks == NULL)
+	      return 0;
+	  cursor->tasks = tasks;
+	  cursor->max_tasks = max_tasks;
+      }
+    task = cursor->tasks + cursor->n_tasks;
+    task->node_a = node_a;
+    task->depth_a = depth_a;
+    task->node_b = node_b;
+    task->depth_b = depth_b;
+    task->minx = parent->minx;
+    task->maxx = parent->maxx;
+    task->miny = parent->miny;
+    task->maxy = parent->maxy;
+    if (cell_a != NULL)
+      {
+	  if (cell_a->minx > task->minx)
+	      task->minx = cell_a->minx;
+	  if (cell_a->maxx < task->maxx)
+	      task->maxx = cell_a->maxx;
+	  if (cell_a->miny > task->miny)
+	      task->miny = cell_a->miny;
+	  if (cell_a->maxy < task->maxy)
+	      task->maxy = cell_a->maxy;
+      }
+    if (cell_b != NULL)
+      {
+	  if (cell_b->minx > task->minx)
+	      task->minx = cell_b->minx;
+	  if (cell_b->maxx < task->maxx)
+	      task->maxx = cell_b->maxx;
+	  if (cell_b->miny > task->miny)
+	      task->miny = cell_b->miny;
+	  if (cell_b->maxy < task->maxy)
+	      task->maxy = cell_b->maxy;
+      }
+    cursor->n_tasks++;
+    return 1;
+}
+
+static int
+vsjoin_add_pair (VirtualSpatialJoinCursorPtr cursor, sqlite3_int64 rowid_a,
+		 sqlite3_int64 rowid_b)
+{
+/* appending a candidate pair to the current chunk */
+    struct vsjoin_pair *pair;
+    if (cursor->n_pairs == cursor->max_pairs)
+      {
+	  int max_pairs =
+	      (cursor->max_pairs == 0) ? VSJOIN_CHUNK : cursor->max_pairs * 2;
+	  struct vsjoin_pair *pairs = realloc (cursor->pairs,
+					       sizeof (struct vsjoin_pair) *
+					       max_pairs);
+	  if (pairs == NULL)
+	      return 0;
+	  cursor->pairs = pairs;
+	  cursor->max_pairs = max_pairs;
+      }
+    pair = cursor->pairs + cursor->n_pairs;
+    pair->rowid_a = rowid_a;
+    pair->rowid_b = rowid_b;
+    pair->geom_a = NULL;
+    pair->geom_b = NULL;
+    pair->match = 1;
+    cursor->n_pairs++;
+    return 1;
+}
+
+static int
+vsjoin_overlapping_cells (VirtualSpatialJoinCursorPtr cursor,
+			  const struct vsjoin_task *task,
+			  const struct vsjoin_cell *cell_a,
+			  const struct vsjoin_cell *cell_b)
+{
+/* handling a pair of overlapping cells: either a candidate or two subtrees */
+    if (cell_a->miny > cell_b->maxy || cell_a->maxy < cell_b->miny)
+	return 1;
+    if (task->depth_a == 0)
+	return vsjoin_add_pair (cursor, cell_a->id, cell_b->id);
+    return vsjoin_push_task (cursor, task, cell_a->id, task->depth_a - 1,
+			     cell_a, cell_b->id, task->depth_b - 1, cell_b);
+}
+
+static int
+vsjoin_join_nodes (VirtualSpatialJoinCursorPtr cursor,
+		   const struct vsjoin_task *task)
+{
+/* joining a pair of nodes */
+    struct vsjoin_node *node;
+    struct vsjoin_cell *a;
+    struct vsjoin_cell *b;
+    int count_a;
+    int count_b;
+    int i;
+    int j;
+    int k;
+
+    node = vsjoin_load_node (&(cursor->tree_a), task->node_a);
+    if (node == NULL)
+	return 0;
+    count_a =
+	vsjoin_filter_cells (node, task, &(cursor->sweep_a),
+			     &(cursor->max_sweep_a));
+    node = vsjoin_load_node (&(cursor->tree_b), task->node_b);
+    if (node == NULL)
+	return 0;
+    count_b =
+	vsjoin_filter_cells (node, task, &(cursor->sweep_b),
+			     &(cursor->max_sweep_b));
+    if (count_a < 0 || count_b < 0)
+	return 0;
+    if (count_a == 0 || count_b == 0)
+	return 1;
+    a = cursor->sweep_a;
+    b = cursor->sweep_b;
+
+    if (task->depth_a > task->depth_b)
+      {
+	  /* the first R*Tree is deeper: descending it alone */
+	  for (i = 0; i < count_a; i++)
+	    {
+		if (!vsjoin_push_task
+		    (cursor, task, a[i].id, task->depth_a - 1, a + i,
+		     task->node_b, task->depth_b, NULL))
+		    return 0;
+	    }
+	  return 1;
+      }
+    if (task->depth_b > task->depth_a)
+      {
+	  /* the second R*Tree is deeper: descending it alone */
+	  for (j = 0; j < count_b; j++)
+	    {
+		if (!vsjoin_push_task
+		    (cursor, task, task->node_a, task->depth_a, NULL,
+		     b[j].id, task->depth_b - 1, b + j))
+		    return 0;
+	    }
+	  return 1;
+      }
+
+/* plane sweep along the X axis */
+    i = 0;
+    j = 0;
+    while (i < count_a && j < count_b)
+      {
+	  if (a[i].minx <= b[j].minx)
+	    {
+		for (k = j; k < count_b && b[k].minx <= a[i].maxx; k++)
+		  {
+		      if (!vsjoin_overlapping_cells (cursor, task, a + i, b + k))
+			  return 0;
+		  }
+		i++;
+	    }
+	  else
+	    {
+		for (k = i; k < count_a && a[k].minx <= b[j].maxx; k++)
+		  {
+		      if (!vsjoin_overlapping_cells (cursor, task, a + k, b + j))
+			  return 0;
+		  }
+		j++;
+	    }
+      }
+    return 1;
+}
+
+static int
+vsjoin_fetch_candidates (VirtualSpatialJoinCursorPtr cursor)
+{
+/* traversing both R*Trees until enough candidate pairs are found */
+    cursor->n_pairs = 0;
+    cursor->current = 0;
+    while (cursor->n_tasks > 0 && cursor->n_pairs < VSJOIN_CHUNK)
+      {
+	  /* the task is copied, the stack could be reallocated */
+	  struct vsjoin_task task = cursor->tasks[cursor->n_tasks - 1];
+	  cursor->n_tasks--;
+	  if (!vsjoin_join_nodes (cursor, &task))
+	      return 0;
+      }
+    return 1;
+}
+
+#ifndef OMIT_GEOS		/* including GEOS */
+
+static int
+vsjoin_cmp_pairs (const void *p1, const void *p2)
+{
+/* sorting candidate pairs by rowid_a, rowid_b */
+    const struct vsjoin_pair *pr1 = (const struct vsjoin_pair *) p1;
+    const struct vsjoin_pair *pr2 = (const struct vsjoin_pair *) p2;
+    if (pr1->rowid_a < pr2->rowid_a)
+	return -1;
+    if (pr1->rowid_a > pr2->rowid_a)
+	return 1;
+    if (pr1->rowid_b < pr2->rowid_b)
+	return -1;
+    if (pr1->rowid_b > pr2->rowid_b)
+	return 1;
+    return 0;
+}
+
+static int
+vsjoin_cmp_blobs (const void *p1, const void *p2)
+{
+/* sorting Geometries by rowid */
+    const struct vsjoin_blob *b1 = (const struct vsjoin_blob *) p1;
+    const struct vsjoin_blob *b2 = (const struct vsjoin_blob *) p2;
+    if (b1->rowid < b2->rowid)
+	return -1;
+    if (b1->rowid > b2->rowid)
+	return 1;
+    return 0;
+}
+
+static int
+vsjoin_fetch_blobs (struct vsjoin_tree *tree, struct vsjoin_blob *blobs,
+		    int count)
+{
+/* fetching the Geometries of a set of rowids */
+    int i;
+    int ret;
+    for (i = 0; i < count; i++)
+      {
+	  struct vsjoin_blob *p = blobs + i;
+	  sqlite3_reset (tree->stmt_geom);
+	  sqlite3_clear_bindings (tree->stmt_geom);
+	  sqlite3_bind_int64 (tree->stmt_geom, 1, p->rowid);
+	  ret = sqlite3_step (tree->stmt_geom);
+	  if (ret == SQLITE_DONE)
+	      continue;		/* stale R*Tree entry */
+	  if (ret != SQLITE_ROW)
+	      return 0;
+	  if (sqlite3_column_type (tree->stmt_geom, 0) != SQLITE_BLOB)
+	      continue;
+	  p->size = sqlite3_column_bytes (tree->stmt_geom, 0);
+	  p->blob = malloc (p->size);
+	  if (p->blob == NULL)
+	      return 0;
+	  memcpy (p->blob, sqlite3_column_blob (tree->stmt_geom, 0), p->size);
+      }
+    sqlite3_reset (tree->stmt_geom);
+    return 1;
+}
+
+static int
+vsjoin_eval (struct vsjoin_worker *worker, gaiaGeomCollPtr geom_a,
+	     struct vsjoin_blob *blob_a, gaiaGeomCollPtr geom_b,
+	     struct vsjoin_blob *blob_b)
+{
+/* evaluating the spatial predicate (the first Geometry gets prepared) */
+    switch (worker->predicate)
+      {
+      case VSJOIN_INTERSECTS:
+	  return gaiaGeomCollPreparedIntersects (worker->cache, geom_a,
+						 blob_a->blob, blob_a->size,
+						 geom_b, blob_b->blob,
+						 blob_b->size);
+      case VSJOIN_TOUCHES:
+	  return gaiaGeomCollPreparedTouches (worker->cache, geom_a,
+					      blob_a->blob, blob_a->size,
+					      geom_b, blob_b->blob,
+					      blob_b->size);
+      case VSJOIN_OVERLAPS:
+	  return gaiaGeomCollPreparedOverlaps (worker->cache, geom_a,
+					       blob_a->blob, blob_a->size,
+					       geom_b, blob_b->blob,
+					       blob_b->size);
+      case VSJOIN_CROSSES:
+	  return gaiaGeomCollPreparedCrosses (worker->cache, geom_a,
+					      blob_a->blob, blob_a->size,
+					      geom_b, blob_b->blob,
+					      blob_b->size);
+      case VSJOIN_CONTAINS:
+	  return gaiaGeomCollPreparedContains (worker->cache, geom_a,
+					       blob_a->blob, blob_a->size,
+					       geom_b, blob_b->blob,
+					       blob_b->size);
+      case VSJOIN_WITHIN:
+	  return gaiaGeomCollPreparedWithin (worker->cache, geom_a,
+					     blob_a->blob, blob_a->size,
+					     geom_b, blob_b->blob,
+					     blob_b->size);
+      case VSJOIN_COVERS:
+	  return gaiaGeomCollPreparedCovers (worker->cache, geom_a,
+					     blob_a->blob, blob_a->size,
+					     geom_b, blob_b->blob,
+					     blob_b->size);
+      case VSJOIN_COVEREDBY:
+	  return gaiaGeomCollPreparedCoveredBy (worker->cache, geom_a,
+						blob_a->blob, blob_a->size,
+						geom_b, blob_b->blob,
+						blob_b->size);
+      };
+    return -1;
+}
+
+static void
+vsjoin_work (void *arg)
+{
+/* refining a slice of candidate pairs (grouped by rowid_a) */
+    struct vsjoin_worker *worker = (struct vsjoin_worker *) arg;
+    struct vsjoin_blob *last = NULL;
+    gaiaGeomCollPtr geom_a = NULL;
+    gaiaGeomCollPtr geom_b;
+    int i;
+    for (i = 0; i < worker->count; i++)
+      {
+	  struct vsjoin_pair *pair = worker->pairs + i;
+	  pair->match = 0;
+	  if (pair->geom_a != last)
+	    {
+		if (geom_a != NULL)
+		    gaiaFreeGeomColl (geom_a);
+		geom_a = NULL;
+		last = pair->geom_a;
+		if (last->blob != NULL)
+		    geom_a = gaiaFromSpatiaLiteBlobWkb (last->blob, last->size);
+	    }
+	  if (geom_a == NULL || pair->geom_b->blob == NULL)
+	      continue;
+	  geom_b =
+	      gaiaFromSpatiaLiteBlobWkb (pair->geom_b->blob,
+					 pair->geom_b->size);
+	  if (geom_b == NULL)
+	      continue;
+	  if (vsjoin_eval (worker, geom_a, pair->geom_a, geom_b, pair->geom_b)
+	      > 0)
+	      pair->match = 1;
+	  gaiaFreeGeomColl (geom_b);
+      }
+    if (geom_a != NULL)
+	gaiaFreeGeomColl (geom_a);
+}
+
+static int
+vsjoin_threads (VirtualSpatialJoinCursorPtr cursor)
+{
+/* lazily allocating the worker threads (each one owns a GEOS handle) */
+    struct splite_internal_cache *cache =
+	(struct splite_internal_cache *) (cursor->pVtab->p_cache);
+    int max_threads;
+    int i;
+    if (cursor->workers != NULL)
+	return cursor->n_workers;
+    max_threads = (cache == NULL) ? 1 : cache->max_threads;
+    if (max_threads < 1)
+	max_threads = 1;
+    if (max_threads > SPLITE_MAX_THREADS)
+	max_threads = SPLITE_MAX_THREADS;
+    cursor->workers = calloc (max_threads, sizeof (struct vsjoin_worker));
+    if (cursor->workers == NULL)
+	return 0;
+    for (i = 0; i < max_threads; i++)
+      {
+	  struct vsjoin_worker *worker = cursor->workers + i;
+	  if (i == 0)
+	      worker->cache = cache;
+	  else
+	    {
+		worker->cache = spatialite_alloc_connection ();
+		if (worker->cache == NULL)
+		    break;	/* no more free connection slots */
+	    }
+	  cursor->n_workers++;
+      }
+    return cursor->n_workers;
+}
+
+static int
+vsjoin_refine (VirtualSpatialJoinCursorPtr cursor)
+{
+/* evaluating the spatial predicate on the current chunk of pairs */
+    struct vsjoin_blob *blobs_a = NULL;
+    struct vsjoin_blob *blobs_b = NULL;
+    struct vsjoin_worker *workers;
+    int n_pairs = cursor->n_pairs;
+    int n_workers;
+    int n_a = 0;
+    int n_b = 0;
+    int base;
+    int i;
+    int ok = 0;
+    if (n_pairs == 0)
+	return 1;
+    n_workers = vsjoin_threads (cursor);
+    if (n_workers == 0)
+	return 0;
+
+/* each distinct Geometry is fetched just once */
+    qsort (cursor->pairs, n_pairs, sizeof (struct vsjoin_pair),
+	   vsjoin_cmp_pairs);
+    blobs_a = calloc (n_pairs, sizeof (struct vsjoin_blob));
+    blobs_b = calloc (n_pairs, sizeof (struct vsjoin_blob));
+    if (blobs_a == NULL || blobs_b == NULL)
+	goto stop;
+    for (i = 0; i < n_pairs; i++)
+      {
+	  struct vsjoin_pair *pair = cursor->pairs + i;
+	  if (n_a == 0 || blobs_a[n_a - 1].rowid != pair->rowid_a)
+	      blobs_a[n_a++].rowid = pair->rowid_a;
+	  pair->geom_a = blobs_a + n_a - 1;
+	  blobs_b[i].rowid = pair->rowid_b;
+      }
+    qsort (blobs_b, n_pairs, sizeof (struct vsjoin_blob), vsjoin_cmp_blobs);
+    for (i = 0; i < n_pairs; i++)
+      {
+	  if (n_b == 0 || blobs_b[n_b - 1].rowid != blobs_b[i].rowid)
+	      blobs_b[n_b++].rowid = blobs_b[i].rowid;
+      }
+    for (i = 0; i < n_pairs; i++)
+      {
+	  struct vsjoin_pair *pair = cursor->pairs + i;
+	  struct vsjoin_blob key;
+	  key.rowid = pair->rowid_b;
+	  pair->geom_b =
+	      bsearch (&key, blobs_b, n_b, sizeof (struct vsjoin_blob),
+		       vsjoin_cmp_blobs);
+      }
+    if (!vsjoin_fetch_blobs (&(cursor->tree_a), blobs_a, n_a))
+	goto stop;
+    if (!vsjoin_fetch_blobs (&(cursor->tree_b), blobs_b, n_b))
+	goto stop;
+
+/* splitting the chunk into slices, never breaking a rowid_a group */
+    if (n_workers > n_pairs / VSJOIN_SLICE)
+	n_workers = n_pairs / VSJOIN_SLICE;
+    if (n_workers < 1)
+	n_workers = 1;
+    workers = cursor->workers;
+    base = 0;
+    for (i = 0; i < n_workers; i++)
+      {
+	  struct vsjoin_worker *worker = workers + i;
+	  int end = (int) (((sqlite3_int64) n_pairs * (i + 1)) / n_workers);
+	  if (end < base)
+	      end = base;
+	  while (end > 0 && end < n_pairs
+		 && cursor->pairs[end].rowid_a ==
+		 cursor->pairs[end - 1].rowid_a)
+	      end++;
+	  worker->predicate = cursor->predicate;
+	  worker->pairs = cursor->pairs + base;
+	  worker->count = end - base;
+	  worker->thread = NULL;
+	  base = end;
+      }
+    for (i = 1; i < n_workers; i++)
+      {
+	  struct vsjoin_worker *worker = workers + i;
+	  if (worker->count == 0)
+	      continue;
+	  worker->thread = splite_thread_create (vsjoin_work, worker);
+	  if (worker->thread == NULL)
+	      vsjoin_work (worker);	/* falling back to serial */
+      }
+/* the current thread always processes the first slice */
+    vsjoin_work (workers);
+    for (i = 1; i < n_workers; i++)
+      {
+	  if (workers[i].thread != NULL)
+	      splite_thread_join (workers[i].thread);
+	  workers[i].thread = NULL;
+      }
+
+/* discarding all pairs not satisfying the predicate */
+    base = 0;
+    for (i = 0; i < n_pairs; i++)
+      {
+	  if (cursor->pairs[i].match)
+	      cursor->pairs[base++] = cursor->pairs[i];
+      }
+    cursor->n_pairs = base;
+    ok = 1;
+
+  stop:
+    if (blobs_a != NULL)
+      {
+	  for (i = 0; i < n_a; i++)
+	    {
+		if (blobs_a[i].blob != NULL)
+		    free (blobs_a[i].blob);
+	    }
+	  free (blobs_a);
+      }
+    if (blobs_b != NULL)
+      {
+	  for (i = 0; i < n_b; i++)
+	    {
+		if (blobs_b[i].blob != NULL)
+		    free (blobs_b[i].blob);
+	    }
+	  free (blobs_b);
+      }
+    return ok;
+}
+
+#endif /* end GEOS conditionals */
+
+static void
+vsjoin_next_chunk (VirtualSpatialJoinCursorPtr cursor)
+{
+/* producing the next non-empty chunk of (refined) pairs */
+    while (1)
+      {
+	  if (cursor->n_tasks == 0)
+	    {
+		cursor->eof = 1;
+		return;
+	    }
+	  if (!vsjoin_fetch_candidates (cursor))
+	    {
+		cursor->eof = 1;
+		return;
+	    }
+#ifndef OMIT_GEOS		/* including GEOS */
+	  if (cursor->predicate != VSJOIN_MBR)
+	    {
+		if (!vsjoin_refine (cursor))
+		  {
+		      cursor->eof = 1;
+		      return;
+		  }
+	    }
+#endif /* end GEOS conditionals */
+	  if (cursor->n_pairs > 0)
+	      return;
+      }
+}
+
+static void
+vsjoin_reset_cursor (VirtualSpatialJoinCursorPtr cursor)
+{
+/* resetting the cursor (allocated buffers and threads are preserved) */
+    if (cursor->table_a != NULL)
+	free (cursor->table_a);
+    if (cursor->table_b != NULL)
+	free (cursor->table_b);
+    if (cursor->predicate_name != NULL)
+	free (cursor->predicate_name);
+    cursor->table_a = NULL;
+    cursor->table_b = NULL;
+    cursor->predicate_name = NULL;
+    cursor->predicate = VSJOIN_MBR;
+    vsjoin_reset_tree (&(cursor->tree_a));
+    vsjoin_reset_tree (&(cursor->tree_b));
+    cursor->n_tasks = 0;
+    cursor->n_pairs = 0;
+    cursor->current = 0;
+    cursor->CurrentRowId = 0;
+    cursor->eof = 1;
+}
+
+static char *
+vsjoin_text_arg (sqlite3_value * value)
+{
+/* copying a TEXT argument */
+    const char *txt;
+    char *str;
+    if (sqlite3_value_type (value) != SQLITE_TEXT)
+	return NULL;
+    txt = (const char *) sqlite3_value_text (value);
+    str = malloc (strlen (txt) + 1);
+    strcpy (str, txt);
+    return str;
+}
+
+static int
+vsjoin_create (sqlite3 * db, void *pAux, int argc, const char *const *argv,
+	       sqlite3_vtab ** ppVTab, char **pzErr)
+{
+/* creates the virtual table for R*Tree Spatial Join */
+    VirtualSpatialJoinPtr p_vt;
+    char *buf;
+    char *vtable;
+    char *xname;
+    if (argc == 3)
+      {
+	  vtable = gaiaDequotedSql ((char *) argv[2]);
+      }
+    else
+      {
+	  *pzErr =
+	      sqlite3_mprintf
+	      ("[VirtualSpatialJoin module] CREATE VIRTUAL: illegal arg list {void}\n");
+	  return SQLITE_ERROR;
+      }
+    p_vt =
+	(VirtualSpatialJoinPtr) sqlite3_malloc (sizeof (VirtualSpatialJoin));
+    if (!p_vt)
+	return SQLITE_NOMEM;
+    p_vt->db = db;
+    p_vt->p_cache = pAux;
+    p_vt->pModule = &my_spjoin_module;
+    p_vt->nRef = 0;
+    p_vt->zErrMsg = NULL;
+/* preparing the COLUMNs for this VIRTUAL TABLE */
+    xname = gaiaDoubleQuotedSql (vtable);
+    buf = sqlite3_mprintf ("CREATE TABLE \"%s\" (table_a TEXT, "
+			   "geometry_a TEXT, table_b TEXT, geometry_b TEXT, "
+			   "predicate TEXT, rowid_a INTEGER, rowid_b INTEGER)",
+			   xname);
+    free (xname);
+    free (vtable);
+    if (sqlite3_declare_vtab (db, buf) != SQLITE_OK)
+      {
+	  sqlite3_free (buf);
+	  *pzErr =
+	      sqlite3_mprintf
+	      ("[VirtualSpatialJoin module] CREATE VIRTUAL: invalid SQL statement");
+	  sqlite3_free (p_vt);
+	  return SQLITE_ERROR;
+      }
+    sqlite3_free (buf);
+    *ppVTab = (sqlite3_vtab *) p_vt;
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_connect (sqlite3 * db, void *pAux, int argc, const char *const *argv,
+		sqlite3_vtab ** ppVTab, char **pzErr)
+{
+/* connects the virtual table - simply aliases vsjoin_create() */
+    return vsjoin_create (db, pAux, argc, argv, ppVTab, pzErr);
+}
+
+static int
+vsjoin_best_index (sqlite3_vtab * pVTab, sqlite3_index_info * pIdxInfo)
+{
+/* 
+/ best index selection
+/ idxNum is a bitmask of the constrained columns [table_a, geometry_a,
+/ table_b, geometry_b, predicate]: their values are passed to xFilter
+/ in this same order
+*/
+    int i;
+    int col;
+    int mask = 0;
+    int n_args = 0;
+    int usage[5];
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    for (col = 0; col < 5; col++)
+      {
+	  usage[col] = -1;
+	  for (i = 0; i < pIdxInfo->nConstraint; i++)
+	    {
+		struct sqlite3_index_constraint *p =
+		    &(pIdxInfo->aConstraint[i]);
+		if (p->usable && p->iColumn == col
+		    && p->op == SQLITE_INDEX_CONSTRAINT_EQ)
+		  {
+		      usage[col] = i;
+		      mask |= (1 << col);
+		      break;
+		  }
+	    }
+      }
+    if ((mask & 0x01) && (mask & 0x04))
+      {
+	  /* this one is a valid Spatial Join query */
+	  pIdxInfo->idxNum = mask;
+	  pIdxInfo->estimatedCost = 1.0;
+	  for (col = 0; col < 5; col++)
+	    {
+		if (usage[col] < 0)
+		    continue;
+		pIdxInfo->aConstraintUsage[usage[col]].argvIndex = ++n_args;
+		pIdxInfo->aConstraintUsage[usage[col]].omit = 1;
+	    }
+      }
+    else
+      {
+	  /* illegal query */
+	  pIdxInfo->idxNum = 0;
+	  pIdxInfo->estimatedCost = 1.0e+12;
+      }
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_disconnect (sqlite3_vtab * pVTab)
+{
+/* disconnects the virtual table */
+    VirtualSpatialJoinPtr p_vt = (VirtualSpatialJoinPtr) pVTab;
+    sqlite3_free (p_vt);
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_destroy (sqlite3_vtab * pVTab)
+{
+/* destroys the virtual table - simply aliases vsjoin_disconnect() */
+    return vsjoin_disconnect (pVTab);
+}
+
+static int
+vsjoin_open (sqlite3_vtab * pVTab, sqlite3_vtab_cursor ** ppCursor)
+{
+/* opening a new cursor */
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr)
+	sqlite3_malloc (sizeof (VirtualSpatialJoinCursor));
+    if (cursor == NULL)
+	return SQLITE_ERROR;
+    memset (cursor, 0, sizeof (VirtualSpatialJoinCursor));
+    cursor->pVtab = (VirtualSpatialJoinPtr) pVTab;
+    cursor->eof = 1;
+    *ppCursor = (sqlite3_vtab_cursor *) cursor;
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_close (sqlite3_vtab_cursor * pCursor)
+{
+/* closing the cursor */
+    int i;
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    vsjoin_reset_cursor (cursor);
+    if (cursor->tasks != NULL)
+	free (cursor->tasks);
+    if (cursor->sweep_a != NULL)
+	free (cursor->sweep_a);
+    if (cursor->sweep_b != NULL)
+	free (cursor->sweep_b);
+    if (cursor->pairs != NULL)
+	free (cursor->pairs);
+    if (cursor->workers != NULL)
+      {
+	  for (i = 1; i < cursor->n_workers; i++)
+	      spatialite_cleanup_ex (cursor->workers[i].cache);
+	  free (cursor->workers);
+      }
+    sqlite3_free (pCursor);
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_filter (sqlite3_vtab_cursor * pCursor, int idxNum, const char *idxStr,
+	       int argc, sqlite3_value ** argv)
+{
+/* setting up a cursor filter */
+    char *args[5];
+    char *tn;
+    struct vsjoin_task root;
+    int col;
+    int i = 0;
+    int ok = 1;
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    VirtualSpatialJoinPtr spjoin = (VirtualSpatialJoinPtr) cursor->pVtab;
+    if (idxStr)
+	idxStr = idxStr;	/* unused arg warning suppression */
+    vsjoin_reset_cursor (cursor);
+    if (idxNum == 0)
+	return SQLITE_OK;
+
+/* retrieving the Table/Column/Predicate params */
+    for (col = 0; col < 5; col++)
+      {
+	  args[col] = NULL;
+	  if ((idxNum & (1 << col)) == 0)
+	      continue;
+	  if (i < argc)
+	      args[col] = vsjoin_text_arg (argv[i]);
+	  if (args[col] == NULL)
+	      ok = 0;		/* NULL or not a TEXT */
+	  i++;
+      }
+    cursor->table_a = args[0];
+    cursor->table_b = args[2];
+    cursor->predicate_name = args[4];
+    if (!ok)
+	goto stop;
+    cursor->predicate = vsjoin_parse_predicate (cursor->predicate_name);
+    if (cursor->predicate < 0)
+      {
+	  sqlite3_free (spjoin->zErrMsg);
+	  spjoin->zErrMsg =
+	      sqlite3_mprintf ("VirtualSpatialJoin: unknown predicate \"%s\"",
+			       cursor->predicate_name);
+	  goto error;
+      }
+#ifdef OMIT_GEOS		/* GEOS isn't supported */
+    if (cursor->predicate != VSJOIN_MBR)
+      {
+	  sqlite3_free (spjoin->zErrMsg);
+	  spjoin->zErrMsg =
+	      sqlite3_mprintf
+	      ("VirtualSpatialJoin: predicate \"%s\" requires GEOS support",
+	       cursor->predicate_name);
+	  goto error;
+      }
+#endif /* end GEOS conditionals */
+
+/* checking if both the corresponding R*Trees exist */
+    tn = cursor->table_a;
+    vsjoin_parse_table_name (tn, &(cursor->tree_a.db_prefix),
+			     &(cursor->tree_a.table));
+    if (!vsjoin_find_rtree (spjoin->db, &(cursor->tree_a), args[1]))
+	goto stop;
+    tn = cursor->table_b;
+    vsjoin_parse_table_name (tn, &(cursor->tree_b.db_prefix),
+			     &(cursor->tree_b.table));
+    if (!vsjoin_find_rtree (spjoin->db, &(cursor->tree_b), args[3]))
+	goto stop;
+    if (!vsjoin_prepare_tree (spjoin->db, &(cursor->tree_a)))
+	goto stop;
+    if (!vsjoin_prepare_tree (spjoin->db, &(cursor->tree_b)))
+	goto stop;
+
+/* loading both root nodes, so to know the depth of each R*Tree */
+    if (vsjoin_load_node (&(cursor->tree_a), 1) == NULL)
+	goto stop;
+    if (vsjoin_load_node (&(cursor->tree_b), 1) == NULL)
+	goto stop;
+    if (cursor->tree_a.depth > VSJOIN_MAX_DEPTH
+	|| cursor->tree_b.depth > VSJOIN_MAX_DEPTH)
+	goto stop;
+    root.minx = -FLT_MAX;
+    root.maxx = FLT_MAX;
+    root.miny = -FLT_MAX;
+    root.maxy = FLT_MAX;
+    if (!vsjoin_push_task
+	(cursor, &root, 1, cursor->tree_a.depth, NULL, 1,
+	 cursor->tree_b.depth, NULL))
+	goto stop;
+    cursor->eof = 0;
+/* fetching the first chunk of pairs */
+    vsjoin_next_chunk (cursor);
+
+  stop:
+    if (args[1] != NULL)
+	free (args[1]);
+    if (args[3] != NULL)
+	free (args[3]);
+    return SQLITE_OK;
+
+  error:
+    if (args[1] != NULL)
+	free (args[1]);
+    if (args[3] != NULL)
+	free (args[3]);
+    return SQLITE_ERROR;
+}
+
+static int
+vsjoin_next (sqlite3_vtab_cursor * pCursor)
+{
+/* fetching a next row from cursor */
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    cursor->current++;
+    cursor->CurrentRowId++;
+    if (cursor->current >= cursor->n_pairs)
+	vsjoin_next_chunk (cursor);
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_eof (sqlite3_vtab_cursor * pCursor)
+{
+/* cursor EOF */
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    return cursor->eof;
+}
+
+static int
+vsjoin_column (sqlite3_vtab_cursor * pCursor, sqlite3_context * pContext,
+	       int column)
+{
+/* fetching value for the Nth column */
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    struct vsjoin_pair *pair = NULL;
+    const char *txt = NULL;
+    if (!cursor->eof && cursor->current < cursor->n_pairs)
+	pair = cursor->pairs + cursor->current;
+    if (column == 0)
+	txt = cursor->table_a;	/* the Table A Name column */
+    else if (column == 1)
+	txt = cursor->tree_a.geometry;	/* the GeometryColumn A Name column */
+    else if (column == 2)
+	txt = cursor->table_b;	/* the Table B Name column */
+    else if (column == 3)
+	txt = cursor->tree_b.geometry;	/* the GeometryColumn B Name column */
+    else if (column == 4)
+	txt = cursor->predicate_name;	/* the Predicate column */
+    if (txt != NULL)
+	sqlite3_result_text (pContext, txt, strlen (txt), SQLITE_TRANSIENT);
+    else if (column == 5 && pair != NULL)
+      {
+	  /* the RowID A column */
+	  sqlite3_result_int64 (pContext, pair->rowid_a);
+      }
+    else if (column == 6 && pair != NULL)
+      {
+	  /* the RowID B column */
+	  sqlite3_result_int64 (pContext, pair->rowid_b);
+      }
+    else
+	sqlite3_result_null (pContext);
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_rowid (sqlite3_vtab_cursor * pCursor, sqlite_int64 * pRowid)
+{
+/* fetching the ROWID */
+    VirtualSpatialJoinCursorPtr cursor =
+	(VirtualSpatialJoinCursorPtr) pCursor;
+    *pRowid = cursor->CurrentRowId;
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_update (sqlite3_vtab * pVTab, int argc, sqlite3_value ** argv,
+	       sqlite_int64 * pRowid)
+{
+/* generic update [INSERT / UPDATE / DELETE */
+    if (pRowid || argc || argv || pVTab)
+	pRowid = pRowid;	/* unused arg warning suppression */
+/* read only datasource */
+    return SQLITE_READONLY;
+}
+
+static int
+vsjoin_begin (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_sync (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_commit (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_rollback (sqlite3_vtab * pVTab)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    return SQLITE_OK;
+}
+
+static int
+vsjoin_rename (sqlite3_vtab * pVTab, const char *zNew)
+{
+/* BEGIN TRANSACTION */
+    if (pVTab)
+	pVTab = pVTab;		/* unused arg warning suppression */
+    if (zNew)
+	zNew = zNew;		/* unused arg warning suppression */
+    return SQLITE_ERROR;
+}
+
+static int
+spliteVirtualSpatialJoinInit (sqlite3 * db, void *p_cache)
+{
+    int rc = SQLITE_OK;
+    my_spjoin_module.iVersion = 1;
+    my_spjoin_module.xCreate = &vsjoin_create;
+    my_spjoin_module.xConnect = &vsjoin_connect;
+    my_spjoin_module.xBestIndex = &vsjoin_best_index;
+    my_spjoin_module.xDisconnect = &vsjoin_disconnect;
+    my_spjoin_module.xDestroy = &vsjoin_destroy;
+    my_spjoin_module.xOpen = &vsjoin_open;
+    my_spjoin_module.xClose = &vsjoin_close;
+    my_spjoin_module.xFilter = &vsjoin_filter;
+    my_spjoin_module.xNext = &vsjoin_next;
+    my_spjoin_module.xEof = &vsjoin_eof;
+    my_spjoin_module.xColumn = &vsjoin_column;
+    my_spjoin_module.xRowid = &vsjoin_rowid;
+    my_spjoin_module.xUpdate = &vsjoin_update;
+    my_spjoin_module.xBegin = &vsjoin_begin;
+    my_spjoin_module.xSync = &vsjoin_sync;
+    my_spjoin_module.xCommit = &vsjoin_commit;
+    my_spjoin_module.xRollback = &vsjoin_rollback;
+    my_spjoin_module.xFindFunction = NULL;
+    my_spjoin_module.xRename = &vsjoin_rename;
+    sqlite3_create_module_v2 (db, "VirtualSpatialJoin", &my_spjoin_module,
+			      p_cache, 0);
+    return rc;
+}
+
+SPATIALITE_PRIVATE int
+virtual_spatialjoin_extension_init (void *xdb, const void *p_cache)
+{
+    sqlite3 *db = (sqlite3 *) xdb;
+    return spliteVirtualSpatialJoinInit (db, (void *) p_cache);
+}
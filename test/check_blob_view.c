@@ -0,0 +1,373 @@
+/*
+
+ check_blob_view.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include <spatialite/gaiageo.h>
+
+static const char *wkt_samples[] = {
+    "POINT(1.5 2.5)",
+    "POINTZ(1.5 2.5 3.5)",
+    "POINTM(1.5 2.5 4.5)",
+    "POINTZM(1.5 2.5 3.5 4.5)",
+    "LINESTRING(0 0, 1.1 1.2, 2.3 2.4, 3 3)",
+    "LINESTRINGZ(0 0 1, 1.1 1.2 2, 2.3 2.4 3, 3 3 4)",
+    "LINESTRINGM(0 0 1, 1.1 1.2 2, 2.3 2.4 3, 3 3 4)",
+    "LINESTRINGZM(0 0 1 9, 1.1 1.2 2 8, 2.3 2.4 3 7, 3 3 4 6)",
+    "POLYGON((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 3 2, 3 3, 2 2))",
+    "POLYGONZ((0 0 1, 10 0 2, 10 10 3, 0 10 4, 0 0 1))",
+    "MULTIPOINT(1 1, 2 2, 3 3)",
+    "MULTILINESTRINGM((0 0 1, 1 1 2), (2 2 3, 3 3 4, 4 4 5))",
+    "MULTIPOLYGON(((0 0, 1 0, 1 1, 0 0)), ((5 5, 6 5, 6 6, 5 5), "
+	"(5.1 5.1, 5.2 5.1, 5.2 5.2, 5.1 5.1)))",
+    "GEOMETRYCOLLECTIONZM(POINTZM(1 2 3 4), "
+	"LINESTRINGZM(0 0 1 2, 1.5 1.5 2 3, 2 2 3 4), "
+	"POLYGONZM((0 0 1 1, 1 0 1 1, 1 1 1 1, 0 0 1 1)), POINTZM(9 9 9 9))",
+    NULL
+};
+
+static int
+check_coords (double *coords, int dims, int iv, double x, double y,
+	      double z, double m)
+{
+/* comparing a decoded vertex against a BLOB-View vertex */
+    double xx;
+    double yy;
+    double zz = 0.0;
+    double mm = 0.0;
+    if (dims == GAIA_XY_Z)
+      {
+	  gaiaGetPointXYZ (coords, iv, &xx, &yy, &zz);
+      }
+    else if (dims == GAIA_XY_M)
+      {
+	  gaiaGetPointXYM (coords, iv, &xx, &yy, &mm);
+      }
+    else if (dims == GAIA_XY_Z_M)
+      {
+	  gaiaGetPointXYZM (coords, iv, &xx, &yy, &zz, &mm);
+      }
+    else
+      {
+	  gaiaGetPoint (coords, iv, &xx, &yy);
+      }
+    if (xx != x || yy != y || zz != z || mm != m)
+	return 0;
+    return 1;
+}
+
+static int
+check_view (const unsigned char *blob, int size, const char *wkt)
+{
+/* comparing the BLOB-View against the fully decoded Geometry */
+    gaiaBlobView view;
+    gaiaGeomCollPtr geom;
+    gaiaPointPtr pt;
+    gaiaLinestringPtr ln;
+    gaiaPolygonPtr pg;
+    gaiaRingPtr rng;
+    double x;
+    double y;
+    double z;
+    double m;
+    int iv;
+    int n_vertices = 0;
+    int ok = 0;
+
+    geom = gaiaFromSpatiaLiteBlobWkb (blob, size);
+    if (geom == NULL)
+      {
+	  fprintf (stderr, "%s: unable to decode the BLOB\n", wkt);
+	  return 0;
+      }
+    if (!gaiaBlobViewInit (&view, blob, size))
+      {
+	  fprintf (stderr, "%s: gaiaBlobViewInit failure\n", wkt);
+	  goto end;
+      }
+    if (view.Srid != geom->Srid || view.DimensionModel != geom->DimensionModel
+	|| view.DeclaredType != geom->DeclaredType || view.MinX != geom->MinX
+	|| view.MinY != geom->MinY || view.MaxX != geom->MaxX
+	|| view.MaxY != geom->MaxY)
+      {
+	  fprintf (stderr, "%s: BLOB-View header mismatch\n", wkt);
+	  goto end;
+      }
+    pt = geom->FirstPoint;
+    ln = geom->FirstLinestring;
+    pg = geom->FirstPolygon;
+    while (gaiaBlobViewNextPart (&view))
+      {
+	  iv = 0;
+	  if (view.PartType == GAIA_POINT)
+	    {
+		if (pt == NULL
+		    || !gaiaBlobViewNextVertex (&view, &x, &y, &z, &m))
+		    goto mismatch;
+		if (pt->X != x || pt->Y != y)
+		    goto mismatch;
+		if ((pt->DimensionModel == GAIA_XY_Z
+		     || pt->DimensionModel == GAIA_XY_Z_M) && pt->Z != z)
+		    goto mismatch;
+		if ((pt->DimensionModel == GAIA_XY_M
+		     || pt->DimensionModel == GAIA_XY_Z_M) && pt->M != m)
+		    goto mismatch;
+		iv = 1;
+		pt = pt->Next;
+	    }
+	  else if (view.PartType == GAIA_LINESTRING)
+	    {
+		if (ln == NULL || ln->Points != view.PartPoints)
+		    goto mismatch;
+		while (gaiaBlobViewNextVertex (&view, &x, &y, &z, &m))
+		  {
+		      if (!check_coords
+			  (ln->Coords, ln->DimensionModel, iv, x, y, z, m))
+			  goto mismatch;
+		      iv++;
+		  }
+		ln = ln->Next;
+	    }
+	  else
+	    {
+		if (pg == NULL)
+		    goto mismatch;
+		if (view.PartRing == 0)
+		    rng = pg->Exterior;
+		else
+		    rng = pg->Interiors + (view.PartRing - 1);
+		if (rng->Points != view.PartPoints)
+		    goto mismatch;
+		while (gaiaBlobViewNextVertex (&view, &x, &y, &z, &m))
+		  {
+		      if (!check_coords
+			  (rng->Coords, rng->DimensionModel, iv, x, y, z, m))
+			  goto mismatch;
+		      iv++;
+		  }
+		if (view.PartRing == pg->NumInteriors)
+		    pg = pg->Next;
+	    }
+	  if (iv != view.PartPoints)
+	      goto mismatch;
+	  n_vertices += iv;
+      }
+    if (pt != NULL || ln != NULL || pg != NULL
+	|| n_vertices != view.NumVertices)
+	goto mismatch;
+    ok = 1;
+    goto end;
+
+  mismatch:
+    fprintf (stderr, "%s: BLOB-View vertices mismatch\n", wkt);
+  end:
+    gaiaFreeGeomColl (geom);
+    return ok;
+}
+
+static int
+check_sql (sqlite3 * handle, const char *sql, int expected)
+{
+/* checking an SQL function expected to return an integer */
+    int ret;
+    int result = -1;
+    sqlite3_stmt *stmt;
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    if (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  if (sqlite3_column_type (stmt, 0) == SQLITE_NULL)
+	      result = -1;
+	  else
+	      result = sqlite3_column_int (stmt, 0);
+      }
+    sqlite3_finalize (stmt);
+    if (result != expected)
+      {
+	  fprintf (stderr, "%s: expected %d, got %d\n", sql, expected,
+		   result);
+	  return 0;
+      }
+    return 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    gaiaGeomCollPtr geom;
+    gaiaBlobView view;
+    unsigned char *blob;
+    int size;
+    int i;
+    const char *wkt;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+    for (i = 0; wkt_samples[i] != NULL; i++)
+      {
+	  wkt = wkt_samples[i];
+	  geom = gaiaParseWkt ((const unsigned char *) wkt, -1);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "unable to parse: %s\n", wkt);
+		return -1;
+	    }
+	  geom->Srid = 4326;
+	  gaiaMbrGeometry (geom);
+
+	  /* plain BLOB-Geometry */
+	  gaiaToSpatiaLiteBlobWkb (geom, &blob, &size);
+	  ret = check_view (blob, size, wkt);
+	  if (ret)
+	    {
+		/* a truncated BLOB is expected to be rejected */
+		*(blob + (size - 8)) = GAIA_MARK_END;
+		if (gaiaBlobViewInit (&view, blob, size - 7))
+		  {
+		      fprintf (stderr, "%s: truncated BLOB accepted\n", wkt);
+		      ret = 0;
+		  }
+	    }
+	  free (blob);
+	  if (!ret)
+	      return -2;
+
+	  /* compressed BLOB-Geometry */
+	  gaiaToCompressedBlobWkb (geom, &blob, &size);
+	  ret = check_view (blob, size, wkt);
+	  free (blob);
+	  if (!ret)
+	      return -3;
+
+	  /* TinyPoint BLOB-Geometry */
+	  gaiaToSpatiaLiteBlobWkbEx2 (geom, &blob, &size, 0, 1);
+	  ret = check_view (blob, size, wkt);
+	  free (blob);
+	  if (!ret)
+	      return -4;
+	  gaiaFreeGeomColl (geom);
+      }
+
+/* invalid BLOBs */
+    if (gaiaBlobViewInit (&view, (const unsigned char *) "abcdef", 6))
+      {
+	  fprintf (stderr, "gaiaBlobViewInit: invalid BLOB accepted\n");
+	  return -5;
+      }
+
+/* SQL functions supported by the BLOB-View */
+    if (!check_sql
+	(handle,
+	 "SELECT ST_NPoints(GeomFromText('MULTIPOLYGON(((0 0, 1 0, 1 1, 0 0)), "
+	 "((5 5, 6 5, 6 6, 5 5), (5.1 5.1, 5.2 5.1, 5.2 5.2, 5.1 5.1)))'))",
+	 12))
+	return -6;
+    if (!check_sql
+	(handle,
+	 "SELECT ST_NRings(GeomFromText('MULTIPOLYGON(((0 0, 1 0, 1 1, 0 0)), "
+	 "((5 5, 6 5, 6 6, 5 5), (5.1 5.1, 5.2 5.1, 5.2 5.2, 5.1 5.1)))'))",
+	 3))
+	return -7;
+    if (!check_sql
+	(handle,
+	 "SELECT ST_NumGeometries(GeomFromText('GEOMETRYCOLLECTION("
+	 "POINT(1 2), LINESTRING(0 0, 1 1), POINT(3 4))'))", 3))
+	return -8;
+    if (!check_sql
+	(handle,
+	 "SELECT ST_NumPoints(CompressGeometry(GeomFromText("
+	 "'LINESTRING(0 0, 1 1, 2 2, 3 3, 4 4)')))", 5))
+	return -9;
+    if (!check_sql
+	(handle,
+	 "SELECT ST_NumInteriorRing(GeomFromText('POLYGON((0 0, 10 0, "
+	 "10 10, 0 10, 0 0), (2 2, 3 2, 3 3, 2 2))'))", 1))
+	return -10;
+    if (!check_sql
+	(handle, "SELECT ST_NumPoints(GeomFromText('POINT(1 2)'))", -1))
+	return -11;
+    if (!check_sql (handle, "SELECT ST_Z(MakePointZ(1, 2, 3))", 3))
+	return -12;
+    if (!check_sql (handle, "SELECT ST_M(MakePoint(1, 2))", -1))
+	return -13;
+    if (!check_sql
+	(handle, "SELECT ST_Y(GeomFromText('MULTIPOINT(1 2, 3 4)'))", -1))
+	return -14;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+/*
+
+ check_covering_index.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+#if SQLITE_VERSION_NUMBER >= 3024000	/* R*Tree auxiliary columns */
+static int
+check_points (sqlite3 * handle)
+{
+/* the covering index must exactly match the Points table */
+    int value;
+    if (!query_int
+	(handle, "SELECT Count(*) FROM pts WHERE geom IS NOT NULL", &value))
+	return 0;
+    if (!query_int (handle, "SELECT Count(*) FROM idx_pts_geom", &value))
+	return 0;
+    if (!query_int
+	(handle,
+	 "SELECT (SELECT Count(*) FROM pts WHERE geom IS NOT NULL) - "
+	 "Count(*) FROM pts AS p JOIN idx_pts_geom AS i ON (i.pkid = p.ROWID) "
+	 "WHERE i.point_x = ST_X(p.geom) AND i.point_y = ST_Y(p.geom) "
+	 "AND i.class IS p.class AND i.name IS p.name", &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "covering index: %d mismatching Points\n", value);
+	  return 0;
+      }
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM idx_pts_geom WHERE pkid NOT IN "
+	 "(SELECT ROWID FROM pts WHERE geom IS NOT NULL)", &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "covering index: %d orphan entries\n", value);
+	  return 0;
+      }
+    return 1;
+}
+#endif /* end R*Tree auxiliary columns */
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+#if SQLITE_VERSION_NUMBER >= 3024000	/* R*Tree auxiliary columns */
+    int ret;
+    sqlite3 *handle;
+    int value;
+    int i;
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+
+/* a Points layer */
+    if (!execute (handle, "CREATE TABLE pts (id INTEGER PRIMARY KEY, "
+		  "class INTEGER, name TEXT, other TEXT)"))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('pts', 'geom', 3003, 'POINT', 'XY')"))
+	return -3;
+    if (!execute (handle, "BEGIN"))
+	return -4;
+    for (i = 0; i < 5000; i++)
+      {
+	  double x = 1500000.0 + (i * 17 % 1000) / 3.0;
+	  double y = 4800000.0 + (i * 31 % 1000) / 7.0;
+	  char *sql = sqlite3_mprintf ("INSERT INTO pts (class, name, geom) "
+				       "VALUES (%d, 'pt %d', "
+				       "MakePoint(%1.6f, %1.6f, 3003))",
+				       i % 7, i, x, y);
+	  ret = execute (handle, sql);
+	  sqlite3_free (sql);
+	  if (!ret)
+	      return -5;
+      }
+    if (!execute (handle, "INSERT INTO pts (class, name) VALUES (1, 'null')"))
+	return -6;
+    if (!execute (handle, "COMMIT"))
+	return -7;
+
+/* invalid auxiliary columns */
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pts', 'geom', 'class, wrong')",
+	 &value) || value != 0)
+	return -8;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pts', 'geom', 'class, geom')",
+	 &value) || value != 0)
+	return -9;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pts', 'geom', 'class, CLASS')",
+	 &value) || value != 0)
+	return -10;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pts', 'none', 'class')", &value)
+	|| value != 0)
+	return -11;
+    if (!query_int
+	(handle,
+	 "SELECT spatial_index_enabled FROM geometry_columns "
+	 "WHERE f_table_name = 'pts'", &value) || value != 0)
+	return -12;
+
+/* the covering SpatialIndex */
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pts', 'geom', 'Class, \"name\"')",
+	 &value) || value != 1)
+	return -13;
+    if (!check_points (handle))
+	return -14;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM idx_pts_geom WHERE xmin >= 1500100 "
+	 "AND xmax <= 1500200 AND ymin >= 4800000 AND ymax <= 4800050 "
+	 "AND class = 3", &value))
+	return -15;
+    ret = value;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts WHERE X(geom) >= 1500100 "
+	 "AND X(geom) <= 1500200 AND Y(geom) >= 4800000 "
+	 "AND Y(geom) <= 4800050 AND class = 3", &value) || value != ret)
+	return -16;
+
+/* the triggers keep the auxiliary columns in sync */
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (class, name, geom) VALUES (99, 'new', "
+	 "MakePoint(1500000.123456789, 4800000.987654321, 3003))"))
+	return -17;
+    if (!execute (handle, "UPDATE pts SET class = 42 WHERE id % 10 = 0"))
+	return -18;
+    if (!execute (handle, "UPDATE pts SET name = 'renamed' WHERE id < 100"))
+	return -19;
+    if (!execute
+	(handle,
+	 "UPDATE pts SET geom = MakePoint(ST_X(geom) + 0.5, ST_Y(geom), 3003) "
+	 "WHERE id % 3 = 0"))
+	return -20;
+    if (!execute (handle, "UPDATE pts SET other = 'x' WHERE id % 5 = 0"))
+	return -21;
+    if (!execute (handle, "UPDATE pts SET geom = NULL WHERE id % 11 = 0"))
+	return -22;
+    if (!execute (handle, "DELETE FROM pts WHERE id % 13 = 0"))
+	return -23;
+    if (!check_points (handle))
+	return -24;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM idx_pts_geom WHERE class = 99 "
+	 "AND point_x = 1500000.123456789 AND point_y = 4800000.987654321",
+	 &value) || value != 1)
+	return -25;
+
+/* rebuilding triggers and SpatialIndex preserves the auxiliary columns */
+    if (!execute (handle, "SELECT RebuildGeometryTriggers('pts', 'geom')"))
+	return -26;
+    if (!execute (handle, "UPDATE pts SET class = 7 WHERE id % 4 = 0"))
+	return -27;
+    if (!check_points (handle))
+	return -28;
+    if (!query_int
+	(handle, "SELECT RecoverSpatialIndex('pts', 'geom', 1)", &value)
+	|| value != 1)
+	return -29;
+    if (!check_points (handle))
+	return -30;
+
+/* a Polygons layer: no point coordinates */
+    if (!execute
+	(handle, "CREATE TABLE pgs (id INTEGER PRIMARY KEY, class INTEGER)"))
+	return -31;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('pgs', 'geom', 3003, 'POLYGON', 'XY')"))
+	return -32;
+    if (!execute
+	(handle,
+	 "INSERT INTO pgs (class, geom) VALUES (1, "
+	 "BuildMbr(0, 0, 10, 10, 3003)), (2, BuildMbr(5, 5, 20, 20, 3003))"))
+	return -33;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pgs', 'geom', '')", &value)
+	|| value != 0)
+	return -34;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('pgs', 'geom', 'class')", &value)
+	|| value != 1)
+	return -35;
+    if (!execute (handle, "UPDATE pgs SET class = 3 WHERE id = 2"))
+	return -36;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM idx_pgs_geom WHERE xmin <= 6 AND xmax >= 6 "
+	 "AND class = 3", &value) || value != 1)
+	return -37;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pragma_table_info('idx_pgs_geom')", &value)
+	|| value != 6)
+	return -38;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+    spatialite_cleanup_ex (cache);
+#endif /* end R*Tree auxiliary columns */
+#endif /* end GEOS conditional */
+
+    spatialite_shutdown ();
+    return 0;
+}
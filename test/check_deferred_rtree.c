@@ -0,0 +1,430 @@
+/*
+
+ check_deferred_rtree.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+count_commits (void *arg)
+{
+/* an application COMMIT hook */
+    int *commits = (int *) arg;
+    *commits += 1;
+    return 0;
+}
+
+static int
+insert_polygons (sqlite3 * handle, int first, int count)
+{
+/* inserting some small squares */
+    int i;
+    for (i = first; i < first + count; i++)
+      {
+	  double x = 1000.0 + (i * 37 % 1000);
+	  double y = 5000.0 + (i * 53 % 1000);
+	  char *sql = sqlite3_mprintf ("INSERT INTO pgs (id, geom) "
+				       "VALUES (%d, BuildMbr(%1.3f, %1.3f, "
+				       "%1.3f, %1.3f, 4326))", i, x, y,
+				       x + 1.5, y + 2.5);
+	  int ok = execute (handle, sql);
+	  sqlite3_free (sql);
+	  if (!ok)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+check_index (sqlite3 * handle)
+{
+/* the SpatialIndex must exactly match the Polygons table */
+    int value;
+    if (!query_int
+	(handle,
+	 "SELECT (SELECT Count(*) FROM pgs WHERE geom IS NOT NULL) - "
+	 "Count(*) FROM pgs AS p JOIN idx_pgs_geom AS i ON (i.pkid = p.ROWID) "
+	 "WHERE Abs(i.xmin - MbrMinX(p.geom)) < 0.001 "
+	 "AND Abs(i.xmax - MbrMaxX(p.geom)) < 0.001 "
+	 "AND Abs(i.ymin - MbrMinY(p.geom)) < 0.001 "
+	 "AND Abs(i.ymax - MbrMaxY(p.geom)) < 0.001", &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "SpatialIndex: %d mismatching Polygons\n", value);
+	  return 0;
+      }
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM idx_pgs_geom WHERE pkid NOT IN "
+	 "(SELECT ROWID FROM pgs WHERE geom IS NOT NULL)", &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "SpatialIndex: %d orphan entries\n", value);
+	  return 0;
+      }
+    if (!query_int
+	(handle,
+	 "SELECT (SELECT Count(*) FROM pgs WHERE MbrIntersects(geom, "
+	 "BuildMbr(1200.0, 5200.0, 1400.0, 5400.0)) = 1) - Count(*) "
+	 "FROM pgs WHERE ROWID IN (SELECT ROWID FROM SpatialIndex "
+	 "WHERE f_table_name = 'pgs' AND search_frame = "
+	 "BuildMbr(1200.0, 5200.0, 1400.0, 5400.0)) AND "
+	 "MbrIntersects(geom, BuildMbr(1200.0, 5200.0, 1400.0, 5400.0)) = 1",
+	 &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "SpatialIndex: %d missing Polygons\n", value);
+	  return 0;
+      }
+    return 1;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int ret;
+    sqlite3 *handle;
+    int value;
+    int commits = 0;
+    sqlite3 *handle2;
+    void *cache = spatialite_alloc_connection ();
+    void *cache2;
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+    sqlite3_commit_hook (handle, count_commits, &commits);
+
+/* a Polygons layer supported by a SpatialIndex */
+    if (!execute (handle, "CREATE TABLE pgs (id INTEGER PRIMARY KEY)"))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('pgs', 'geom', 4326, 'POLYGON', 'XY')"))
+	return -3;
+    if (!execute (handle, "SELECT CreateSpatialIndex('pgs', 'geom')"))
+	return -4;
+
+/* enabling the Deferred mode */
+    if (!query_int (handle, "SELECT GetDeferredSpatialIndexMode()", &value))
+	return -5;
+    if (value != 0)
+	return -6;
+    if (!query_int (handle, "SELECT EnableDeferredSpatialIndex()", &value))
+	return -7;
+    if (value != 1)
+	return -8;
+    if (!query_int (handle, "SELECT GetDeferredSpatialIndexMode()", &value))
+	return -9;
+    if (value != 1)
+	return -10;
+
+/* a bulk load into an empty SpatialIndex: packed rebuild */
+    if (!execute (handle, "BEGIN"))
+	return -11;
+    if (!insert_polygons (handle, 1, 5000))
+	return -12;
+    if (!query_int (handle, "SELECT Count(*) FROM idx_pgs_geom", &value))
+	return -13;
+    if (value != 0)
+      {
+	  fprintf (stderr, "Deferred: %d rows already indexed\n", value);
+	  return -14;
+      }
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -15;
+    if (value != 5000)
+      {
+	  fprintf (stderr, "Flush #1: unexpected %d\n", value);
+	  return -16;
+      }
+    if (!execute (handle, "COMMIT"))
+	return -17;
+    if (!check_index (handle))
+	return -18;
+
+/* a small batch of inserts, updates and deletes: Hilbert sorted inserts */
+    if (!execute (handle, "BEGIN"))
+	return -19;
+    if (!insert_polygons (handle, 5001, 100))
+	return -20;
+    if (!execute
+	(handle,
+	 "UPDATE pgs SET geom = ST_Translate(geom, 10.0, -20.0, 0.0) "
+	 "WHERE id % 97 = 0"))
+	return -21;
+    if (!execute
+	(handle,
+	 "UPDATE pgs SET geom = ST_Translate(geom, 1.0, 1.0, 0.0) "
+	 "WHERE id % 194 = 0"))
+	return -22;
+    if (!execute (handle, "UPDATE pgs SET geom = NULL WHERE id % 101 = 0"))
+	return -23;
+    if (!execute (handle, "DELETE FROM pgs WHERE id % 103 = 0"))
+	return -24;
+    if (!execute (handle, "SAVEPOINT sp"))
+	return -25;
+    if (!execute
+	(handle,
+	 "UPDATE pgs SET geom = ST_Translate(geom, 100.0, 100.0, 0.0) "
+	 "WHERE id % 89 = 0"))
+	return -26;
+    if (!execute (handle, "ROLLBACK TO sp"))
+	return -27;
+    if (!execute (handle, "RELEASE sp"))
+	return -28;
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -29;
+    if (value <= 100 || value >= 5000)
+      {
+	  fprintf (stderr, "Flush #2: unexpected %d\n", value);
+	  return -30;
+      }
+    if (!execute (handle, "COMMIT"))
+	return -31;
+    if (!check_index (handle))
+	return -32;
+
+/* an unflushed COMMIT fails, leaving the transaction open */
+    if (!execute (handle, "BEGIN"))
+	return -33;
+    if (!insert_polygons (handle, 6001, 10))
+	return -34;
+    ret = sqlite3_exec (handle, "COMMIT", NULL, NULL, NULL);
+    if (ret != SQLITE_BUSY)
+      {
+	  fprintf (stderr, "unflushed COMMIT: unexpected %d\n", ret);
+	  return -35;
+      }
+    if (sqlite3_get_autocommit (handle))
+	return -36;
+    if (!query_int (handle, "SELECT Count(*) FROM pgs WHERE id > 6000", &value))
+	return -37;
+    if (value != 10)
+	return -38;
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -39;
+    if (value != 10)
+	return -60;
+    if (!execute (handle, "COMMIT"))
+	return -61;
+    if (!check_index (handle))
+	return -62;
+
+/* a Layer no longer supported by the SpatialIndex can't be flushed */
+    if (!execute (handle, "BEGIN"))
+	return -63;
+    if (!insert_polygons (handle, 6101, 5))
+	return -64;
+    if (!execute
+	(handle,
+	 "UPDATE geometry_columns SET spatial_index_enabled = 0 "
+	 "WHERE f_table_name = 'pgs'"))
+	return -65;
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -66;
+    if (value != -1)
+	return -67;
+    if (!execute (handle, "ROLLBACK"))
+	return -68;
+    if (!check_index (handle))
+	return -69;
+
+/* a ROLLBACK discards all pending rows */
+    if (!execute (handle, "BEGIN"))
+	return -40;
+    if (!insert_polygons (handle, 6201, 10))
+	return -41;
+    if (!execute (handle, "ROLLBACK"))
+	return -42;
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -43;
+    if (value != 0)
+	return -44;
+
+/* autocommit statements are never deferred */
+    if (!insert_polygons (handle, 7001, 3))
+	return -45;
+    if (!check_index (handle))
+	return -46;
+
+/* disabling the Deferred mode flushes all pending rows */
+    if (!execute (handle, "BEGIN"))
+	return -47;
+    if (!insert_polygons (handle, 7101, 20))
+	return -48;
+    if (!query_int (handle, "SELECT DisableDeferredSpatialIndex()", &value))
+	return -49;
+    if (value != 20)
+	return -50;
+    if (!execute (handle, "COMMIT"))
+	return -51;
+    if (!check_index (handle))
+	return -52;
+    if (!query_int (handle, "SELECT GetDeferredSpatialIndexMode()", &value))
+	return -53;
+    if (value != 0)
+	return -54;
+
+/* back to the ordinary row-by-row mode */
+    if (!execute (handle, "BEGIN"))
+	return -55;
+    if (!insert_polygons (handle, 7201, 20))
+	return -56;
+    if (!execute (handle, "COMMIT"))
+	return -57;
+    if (!check_index (handle))
+	return -58;
+
+/* a Layer belonging to an ATTACHED DB */
+    unlink ("./check_deferred_rtree.sqlite");
+    ret =
+	sqlite3_open_v2 ("./check_deferred_rtree.sqlite", &handle2,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open the DB to be attached: %s\n",
+		   sqlite3_errmsg (handle2));
+	  sqlite3_close (handle2);
+	  return -70;
+      }
+    cache2 = spatialite_alloc_connection ();
+    spatialite_init_ex (handle2, cache2, 0);
+    if (!execute (handle2, "SELECT InitSpatialMetadata(1)"))
+	return -71;
+    if (!execute (handle2, "CREATE TABLE apg (id INTEGER PRIMARY KEY)"))
+	return -72;
+    if (!execute
+	(handle2,
+	 "SELECT AddGeometryColumn('apg', 'geom', 4326, 'POLYGON', 'XY')"))
+	return -73;
+    if (!execute (handle2, "SELECT CreateSpatialIndex('apg', 'geom')"))
+	return -74;
+    sqlite3_close (handle2);
+    spatialite_cleanup_ex (cache2);
+    if (!execute
+	(handle, "ATTACH DATABASE './check_deferred_rtree.sqlite' AS aux"))
+	return -75;
+    if (!query_int (handle, "SELECT EnableDeferredSpatialIndex()", &value))
+	return -76;
+    if (!execute (handle, "BEGIN"))
+	return -77;
+    if (!execute
+	(handle,
+	 "INSERT INTO aux.apg (id, geom) SELECT id, geom FROM main.pgs "
+	 "WHERE id <= 100"))
+	return -78;
+    if (!query_int (handle, "SELECT Count(*) FROM aux.idx_apg_geom", &value))
+	return -79;
+    if (value != 0)
+	return -80;
+    if (!query_int (handle, "SELECT FlushDeferredSpatialIndex()", &value))
+	return -81;
+    if (value != 100)
+      {
+	  fprintf (stderr, "Flush ATTACHED: unexpected %d\n", value);
+	  return -82;
+      }
+    if (!execute (handle, "COMMIT"))
+	return -83;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM aux.apg AS p JOIN aux.idx_apg_geom AS i "
+	 "ON (i.pkid = p.ROWID) WHERE Abs(i.xmin - MbrMinX(p.geom)) < 0.001 "
+	 "AND Abs(i.ymax - MbrMaxY(p.geom)) < 0.001", &value))
+	return -84;
+    if (value != 100)
+	return -85;
+    if (!query_int (handle, "SELECT DisableDeferredSpatialIndex()", &value))
+	return -86;
+    if (!execute (handle, "DETACH DATABASE aux"))
+	return -87;
+    unlink ("./check_deferred_rtree.sqlite");
+
+/* the application COMMIT hook has never been replaced */
+    if (sqlite3_commit_hook (handle, NULL, NULL) != &commits)
+	return -88;
+    if (commits < 5)
+	return -89;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -59;
+      }
+
+    spatialite_cleanup_ex (cache);
+#endif /* end GEOS conditional */
+
+    spatialite_shutdown ();
+    return 0;
+}
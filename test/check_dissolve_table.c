@@ -0,0 +1,264 @@
+/*
+
+ check_dissolve_table.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+check_output (sqlite3 * handle, const char *table)
+{
+/* checking a dissolved "grid" table */
+    int value;
+    char *sql;
+    int ok = 0;
+
+/* 4 regions x 2 zones, plus the NULL region */
+    sql = sqlite3_mprintf ("SELECT Count(*) FROM \"%s\"", table);
+    if (!query_int (handle, sql, &value) || value != 9)
+	goto end;
+    sqlite3_free (sql);
+/* each region/zone is a 25 x 25 square made of 625 cells */
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM \"%s\" WHERE region IS NOT NULL AND "
+	 "GeometryType(geom) = 'MULTIPOLYGON' AND NumGeometries(geom) = 1 "
+	 "AND ST_Equals(geom, BuildMbr(region * 25, zone * 25, "
+	 "region * 25 + 25, zone * 25 + 25))", table);
+    if (!query_int (handle, sql, &value) || value != 8)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT ST_Area(geom) = 2 FROM \"%s\" WHERE region IS NULL", table);
+    if (!query_int (handle, sql, &value) || value != 1)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM geometry_columns WHERE f_table_name = "
+	 "Lower(%Q) AND geometry_type = 6 AND srid = 4326 AND "
+	 "spatial_index_enabled = 1", table);
+    if (!query_int (handle, sql, &value) || value != 1)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM \"%s\" WHERE ROWID IN (SELECT ROWID FROM "
+	 "SpatialIndex WHERE f_table_name = %Q AND search_frame = "
+	 "BuildMbr(30, 30, 31, 31))", table, table);
+    if (!query_int (handle, sql, &value) || value != 1)
+	goto end;
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int value;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+    if (!execute
+	(handle,
+	 "CREATE TABLE grid (id INTEGER PRIMARY KEY, region INTEGER, "
+	 "zone INTEGER)"))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('grid', 'geom', 4326, 'POLYGON', 'XY')"))
+	return -3;
+/* 100 x 50 unit squares: a column of 25 cells is a region, 25 rows a zone */
+    if (!execute
+	(handle,
+	 "INSERT INTO grid (region, zone, geom) WITH RECURSIVE "
+	 "seq(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM seq WHERE n < 4999) "
+	 "SELECT n % 100 / 25, n / 100 / 25, BuildMbr(n % 100, n / 100, "
+	 "n % 100 + 1, n / 100 + 1, 4326) FROM seq"))
+	return -4;
+    if (!execute
+	(handle,
+	 "INSERT INTO grid (region, zone, geom) VALUES "
+	 "(NULL, NULL, BuildMbr(200, 0, 201, 1, 4326)), "
+	 "(NULL, NULL, BuildMbr(200, 1, 201, 2, 4326)), "
+	 "(NULL, NULL, NULL)"))
+	return -5;
+
+/* invalid arguments */
+    if (!expect_failure
+	(handle, "SELECT DissolveTable(1, 'geom', 'region', 'out')"))
+	return -6;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('grid', 'geom', 'region', NULL)"))
+	return -7;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('grid', 'geom', 'region, none', 'out')"))
+	return -8;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('grid', 'geom', 'geom', 'out')"))
+	return -9;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('grid', 'geom', 'region,,zone', 'out')"))
+	return -10;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('nothing', NULL, 'region', 'out')"))
+	return -11;
+    if (!query_int
+	(handle, "SELECT Count(*) FROM sqlite_master WHERE name = 'out'",
+	 &value) || value != 0)
+	return -12;
+
+/* serial */
+    if (!execute (handle, "SELECT SetMaxThreads(1)"))
+	return -13;
+    if (!query_int
+	(handle, "SELECT DissolveTable('grid', NULL, 'region, zone', 'out1')",
+	 &value) || value != 1)
+	return -14;
+    if (!check_output (handle, "out1"))
+	return -15;
+    if (!expect_failure
+	(handle, "SELECT DissolveTable('grid', NULL, 'region', 'out1')"))
+	return -16;
+
+/* parallel */
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -17;
+    if (!query_int
+	(handle, "SELECT DissolveTable('grid', 'geom', 'zone,region', 'out2')",
+	 &value) || value != 1)
+	return -18;
+    if (!check_output (handle, "out2"))
+	return -19;
+
+/* a single group, large enough to be incrementally reduced */
+    if (!query_int
+	(handle, "SELECT DissolveTable('grid', 'geom', NULL, 'out3')",
+	 &value) || value != 1)
+	return -20;
+    if (!query_int
+	(handle,
+	 "SELECT ST_Equals(geom, ST_Union(BuildMbr(0, 0, 100, 50), "
+	 "BuildMbr(200, 0, 201, 2))) FROM out3", &value) || value != 1)
+	return -21;
+
+/* keys are compared exactly (BINARY), but 1 and 1.0 are the same key */
+    if (!execute
+	(handle,
+	 "CREATE TABLE kinds (id INTEGER PRIMARY KEY, "
+	 "kind TEXT COLLATE NOCASE, class)"))
+	return -22;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('kinds', 'geom', 4326, 'POLYGON', 'XY')"))
+	return -23;
+    if (!execute
+	(handle,
+	 "INSERT INTO kinds (kind, class, geom) VALUES "
+	 "('a', 1, BuildMbr(0, 0, 1, 1, 4326)), "
+	 "('b', 2, BuildMbr(5, 0, 6, 1, 4326)), "
+	 "('A', 1, BuildMbr(9, 0, 10, 1, 4326)), "
+	 "('a', 1.0, BuildMbr(1, 0, 2, 1, 4326)), "
+	 "('a', 1, BuildMbr(2, 0, 3, 1, 4326)), "
+	 "('b', 2.0, BuildMbr(6, 0, 7, 1, 4326))"))
+	return -24;
+    if (!query_int
+	(handle, "SELECT DissolveTable('kinds', NULL, 'kind, class', 'out4')",
+	 &value) || value != 1)
+	return -25;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM out4 WHERE (kind = 'a' COLLATE BINARY AND "
+	 "ST_Equals(geom, BuildMbr(0, 0, 3, 1))) OR (kind = 'b' AND "
+	 "ST_Equals(geom, BuildMbr(5, 0, 7, 1))) OR (kind = 'A' COLLATE "
+	 "BINARY AND ST_Equals(geom, BuildMbr(9, 0, 10, 1)))", &value)
+	|| value != 3)
+	return -26;
+    if (!query_int (handle, "SELECT Count(*) FROM out4", &value) || value != 3)
+	return -27;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
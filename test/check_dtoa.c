@@ -0,0 +1,340 @@
+/*
+
+ check_dtoa.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2011
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Brad Hards <bradh@frogmouth.net>
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+#include <spatialite/gaiageo.h>
+
+struct dtoa_case
+{
+    double value;
+    int precision;
+    const char *expected;
+};
+
+static int
+check_cases ()
+{
+/* testing gaiaFormatDouble against well known values */
+    char buf[GAIA_DOUBLE_TEXT_MAX];
+    double zero = 0.0;
+    double sum = 0.1;
+    int i;
+    int len;
+    struct dtoa_case cases[] = {
+	{0.1, -1, "0.1"},
+	{0.0, -1, "0"},
+	{-0.0, 6, "0"},
+	{1.0, 6, "1"},
+	{-1.5, 6, "-1.5"},
+	{10.0, 0, "10"},
+	{9.96, 1, "10"},
+	{1e-7, 6, "0"},
+	{-1e-7, 6, "0"},
+	{-0.0004, 3, "0"},
+	{0.125, 2, "0.13"},
+	{-0.125, 2, "-0.13"},
+	{2.675, 2, "2.67"},
+	{2.5, 0, "3"},
+	{123456789.125, 2, "123456789.13"},
+	{47.025800000000004, -1, "47.025800000000004"},
+	{47.025800000000004, 14, "47.0258"},
+	{1e22, -1, "10000000000000000000000"},
+	{1e-5, 6, "0.00001"},
+	{-180.0, 15, "-180"},
+	{0.000123456789, 8, "0.00012346"},
+	{9007199254740993.0, -1, "9007199254740992"},
+	{1.7976931348623157e308, 0,
+	 "179769313486231570000000000000000000000000000000000000000000000000"
+	 "000000000000000000000000000000000000000000000000000000000000000000"
+	 "000000000000000000000000000000000000000000000000000000000000000000"
+	 "000000000000000000000000000000000000000000000000000000000000000000"
+	 "000000000000000000000000000000000000000000000"},
+	{0.0, 0, NULL}
+    };
+
+    sum += 0.2;
+    len = gaiaFormatDouble (buf, sum, -1);
+    if (strcmp (buf, "0.30000000000000004") != 0 || len != 19)
+      {
+	  fprintf (stderr, "unexpected 0.1 + 0.2: %s (%d)\n", buf, len);
+	  return -1;
+      }
+    len = gaiaFormatDouble (buf, sum, 15);
+    if (strcmp (buf, "0.3") != 0 || len != 3)
+      {
+	  fprintf (stderr, "unexpected 0.1 + 0.2 (15): %s (%d)\n", buf, len);
+	  return -2;
+      }
+    for (i = 0; cases[i].expected != NULL; i++)
+      {
+	  len = gaiaFormatDouble (buf, cases[i].value, cases[i].precision);
+	  if (strcmp (buf, cases[i].expected) != 0
+	      || len != (int) strlen (cases[i].expected))
+	    {
+		fprintf (stderr, "case #%d: got \"%s\" expected \"%s\"\n", i,
+			 buf, cases[i].expected);
+		return -3;
+	    }
+      }
+
+/* the smallest denormal: 0.(323 zeroes)5 */
+    len = gaiaFormatDouble (buf, 4.9406564584124654e-324, -1);
+    if (len != 326 || strncmp (buf, "0.000", 5) != 0 || buf[325] != '5')
+      {
+	  fprintf (stderr, "unexpected smallest denormal: %s\n", buf);
+	  return -4;
+      }
+    len = gaiaFormatDouble (buf, -DBL_MAX, -1);
+    if (len != 310 || strncmp (buf, "-17976931348623157000", 21) != 0)
+      {
+	  fprintf (stderr, "unexpected -DBL_MAX: %s\n", buf);
+	  return -5;
+      }
+
+/* special values */
+    gaiaFormatDouble (buf, zero / zero, 6);
+    if (strcmp (buf, "nan") != 0)
+      {
+	  fprintf (stderr, "unexpected NaN: %s\n", buf);
+	  return -6;
+      }
+    gaiaFormatDouble (buf, 1.0 / zero, 6);
+    if (strcmp (buf, "Inf") != 0)
+      {
+	  fprintf (stderr, "unexpected +Infinity: %s\n", buf);
+	  return -7;
+      }
+    gaiaFormatDouble (buf, -1.0 / zero, 6);
+    if (strcmp (buf, "-Inf") != 0)
+      {
+	  fprintf (stderr, "unexpected -Infinity: %s\n", buf);
+	  return -8;
+      }
+    return 0;
+}
+
+static int
+check_round_trip ()
+{
+/* any finite double should be exactly recovered from its shortest text */
+    char buf[GAIA_DOUBLE_TEXT_MAX];
+    sqlite3_uint64 seed = 88172645463325252LL;
+    sqlite3_uint64 bits;
+    double value;
+    double back;
+    int i;
+    for (i = 0; i < 200000; i++)
+      {
+	  /* xorshift pseudo-random bit patterns */
+	  seed ^= seed << 13;
+	  seed ^= seed >> 7;
+	  seed ^= seed << 17;
+	  bits = seed;
+	  if (i % 2)
+	    {
+		/* plausible coordinates */
+		value = (double) (seed % 36000000000LL) / 100000000.0 - 180.0;
+		memcpy (&bits, &value, sizeof (double));
+	    }
+	  memcpy (&value, &bits, sizeof (double));
+	  if (value != value || value > DBL_MAX || value < -DBL_MAX)
+	      continue;
+	  if (gaiaFormatDouble (buf, value, -1) != (int) strlen (buf))
+	    {
+		fprintf (stderr, "round trip: wrong length for %s\n", buf);
+		return -11;
+	    }
+	  if (strchr (buf, 'e') != NULL)
+	    {
+		fprintf (stderr, "round trip: unexpected exponent %s\n", buf);
+		return -12;
+	    }
+	  back = atof (buf);
+	  if (memcmp (&back, &value, sizeof (double)) != 0 && value != 0.0)
+	    {
+		fprintf (stderr, "round trip: %1.17g became %s\n", value, buf);
+		return -13;
+	    }
+      }
+    return 0;
+}
+
+static int
+check_out_buffer ()
+{
+/* testing gaiaAppendDoubleToOutBuffer */
+    gaiaOutBuffer out_buf;
+    int i;
+    gaiaOutBufferInitialize (&out_buf);
+    gaiaAppendToOutBuffer (&out_buf, "(");
+    gaiaAppendDoubleToOutBuffer (&out_buf, 11.5, 6);
+    gaiaAppendToOutBuffer (&out_buf, " ");
+    gaiaAppendDoubleToOutBuffer (&out_buf, -43.1234567, 6);
+    gaiaAppendToOutBuffer (&out_buf, ")");
+    if (out_buf.Error || strcmp (out_buf.Buffer, "(11.5 -43.123457)") != 0
+	|| out_buf.WriteOffset != 17)
+      {
+	  fprintf (stderr, "unexpected out buffer: %s\n", out_buf.Buffer);
+	  gaiaOutBufferReset (&out_buf);
+	  return -20;
+      }
+    for (i = 0; i < 10000; i++)
+	gaiaAppendDoubleToOutBuffer (&out_buf, 0.5, -1);
+    if (out_buf.Error || out_buf.WriteOffset != 17 + (10000 * 3)
+	|| strlen (out_buf.Buffer) != (size_t) out_buf.WriteOffset)
+      {
+	  fprintf (stderr, "unexpected out buffer length: %d\n",
+		   out_buf.WriteOffset);
+	  gaiaOutBufferReset (&out_buf);
+	  return -21;
+      }
+    gaiaOutBufferReset (&out_buf);
+    return 0;
+}
+
+static int
+check_sql (sqlite3 * handle, const char *sql, const char *expected)
+{
+/* testing the text output of some SQL function */
+    sqlite3_stmt *stmt;
+    int ret;
+    int retcode = -1;
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return -1;
+      }
+    if (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  const char *value = (const char *) sqlite3_column_text (stmt, 0);
+	  if (value != NULL && strcmp (value, expected) == 0)
+	      retcode = 0;
+	  else
+	      fprintf (stderr, "%s: got \"%s\" expected \"%s\"\n", sql,
+		       value == NULL ? "NULL" : value, expected);
+      }
+    sqlite3_finalize (stmt);
+    return retcode;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret = check_cases ();
+    if (ret != 0)
+	return ret;
+    ret = check_round_trip ();
+    if (ret != 0)
+	return ret;
+    ret = check_out_buffer ();
+    if (ret != 0)
+	return ret;
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory database: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -30;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+    if (check_sql
+	(handle, "SELECT AsText(MakePoint(0.1, 47.025800000000004))",
+	 "POINT(0.1 47.0258)") != 0)
+	return -31;
+    if (check_sql
+	(handle,
+	 "SELECT AsWKT(GeomFromText('LINESTRING(10 -0.0000001, 2.675 1e-20)'), 0)",
+	 "LINESTRING(10 0,3 0)") != 0)
+	return -32;
+    if (check_sql
+	(handle,
+	 "SELECT AsGeoJSON(MakeLine(MakePoint(10.0, -0.0000001), MakePoint(2.675, 1e-20)), 2)",
+	 "{\"type\":\"LineString\",\"coordinates\":[[10,0],[2.67,0]]}") != 0)
+	return -33;
+    if (check_sql
+	(handle, "SELECT AsEWKT(MakePoint(1e22, -1.5, 4326))",
+	 "SRID=4326;POINT(10000000000000000000000 -1.5)") != 0)
+	return -34;
+    if (check_sql
+	(handle, "SELECT AsSVG(MakePoint(1.25, 2.5), 0, 1)",
+	 "cx=\"1.3\" cy=\"-2.5\"") != 0)
+	return -35;
+    if (check_sql
+	(handle,
+	 "SELECT AsGML(3, GeomFromText('LINESTRING(1.5 2.25, 3 4.125)'), 2)",
+	 "<gml:Curve><gml:segments><gml:LineStringSegment>"
+	 "<gml:posList srsDimension=\"2\">1.5 2.25 3 4.13</gml:posList>"
+	 "</gml:LineStringSegment></gml:segments></gml:Curve>")
+	!= 0)
+	return -36;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -37;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
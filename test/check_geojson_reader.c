@@ -0,0 +1,458 @@
+/*
+
+ check_geojson_reader.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2011
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Brad Hards <bradh@frogmouth.net>
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+#include <spatialite/gaiageo.h>
+#include <spatialite/geojson.h>
+
+struct geojson_case
+{
+    const char *text;
+    int type;
+    int model;
+    int srid;
+    int points;
+    int lines;
+    int polygons;
+    double x;
+    double y;
+};
+
+static int
+count_entities (gaiaGeomCollPtr geom, int *lines, int *polygons)
+{
+/* counting POINTs, LINESTRINGs and POLYGONs */
+    int points = 0;
+    gaiaPointPtr pt;
+    gaiaLinestringPtr ln;
+    gaiaPolygonPtr pg;
+    *lines = 0;
+    *polygons = 0;
+    for (pt = geom->FirstPoint; pt != NULL; pt = pt->Next)
+	points++;
+    for (ln = geom->FirstLinestring; ln != NULL; ln = ln->Next)
+	*lines += 1;
+    for (pg = geom->FirstPolygon; pg != NULL; pg = pg->Next)
+	*polygons += 1;
+    return points;
+}
+
+static int
+check_cases ()
+{
+/* testing well known GeoJSON geometries */
+    gaiaGeomCollPtr geom;
+    int i;
+    int points;
+    int lines;
+    int polygons;
+    struct geojson_case cases[] = {
+	{"{\"type\":\"Point\",\"coordinates\":[1,2]}", GAIA_POINT, GAIA_XY,
+	 -1, 1, 0, 0, 1.0, 2.0},
+	{"{ \"type\" : \"Point\" ,\n\t\"coordinates\" : [ -1.5 , +2. , 3 ] }",
+	 GAIA_POINTZ, GAIA_XY_Z, -1, 1, 0, 0, -1.5, 2.0},
+	{"{\"coordinates\":[[1,2],[3,4],[5,6]],\"type\":\"LineString\"}",
+	 GAIA_LINESTRING, GAIA_XY, -1, 0, 1, 0, 0.0, 0.0},
+	{"{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[10,0],[10,10],[0,0]],"
+	 "[[1,1],[2,1],[2,2],[1,1]]]}", GAIA_POLYGON, GAIA_XY, 0, 0, 0, 1,
+	 0.0, 0.0},
+	{"{\"type\":\"MultiPoint\",\"coordinates\":[[1,2,3],[4,5,6]]}",
+	 GAIA_MULTIPOINT, GAIA_XY_Z, 0, 2, 0, 0, 1.0, 2.0},
+	{"{\"type\":\"MultiLineString\",\"coordinates\":[[[1,2],[3,4]],"
+	 "[[5,6],[7,8]]]}", GAIA_MULTILINESTRING, GAIA_XY, 0, 0, 2, 0, 0.0,
+	 0.0},
+	{"{\"type\":\"MultiPolygon\",\"coordinates\":[[[[0,0,1],[1,0,1],"
+	 "[1,1,1],[0,0,1]]],[[[5,5,2],[6,5,2],[6,6,2],[5,5,2]]]]}",
+	 GAIA_MULTIPOLYGON, GAIA_XY_Z, 0, 0, 0, 2, 0.0, 0.0},
+	{"{\"type\":\"GeometryCollection\",\"geometries\":[{\"type\":\"Point\","
+	 "\"coordinates\":[1,2]},{\"type\":\"LineString\",\"coordinates\":"
+	 "[[0,0],[1,1]]},{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],"
+	 "[1,1],[0,0]]]}]}", GAIA_GEOMETRYCOLLECTION, GAIA_XY, 0, 1, 1, 1,
+	 1.0, 2.0},
+	{"{\"type\":\"Point\",\"crs\":{\"type\":\"name\",\"properties\":"
+	 "{\"name\":\"EPSG:4326\"}},\"bbox\":[1,2,1,2],\"coordinates\":[1,2]}",
+	 GAIA_POINT, GAIA_XY, 4326, 1, 0, 0, 1.0, 2.0},
+	{"{\"bbox\":[0,0,1,1],\"coordinates\":[[[0,0],[1,0],[1,1],[0,0]]],"
+	 "\"type\":\"Polygon\",\"crs\":{\"type\":\"name\",\"properties\":"
+	 "{\"name\":\"EPSG:3003\"}}}", GAIA_POLYGON, GAIA_XY, 3003, 0, 0, 1,
+	 0.0, 0.0},
+	{"{\"type\":\"Point\",\"coordinates\":[1,2],}", GAIA_POINT, GAIA_XY,
+	 -1, 1, 0, 0, 1.0, 2.0},
+	{"{\"type\":\"Point\",\"coordinates\":[1e,2]}", GAIA_POINT, GAIA_XY,
+	 -1, 1, 0, 0, 1.0, 2.0},
+	{NULL, 0, 0, 0, 0, 0, 0, 0.0, 0.0}
+    };
+
+    for (i = 0; cases[i].text != NULL; i++)
+      {
+	  geom = gaiaParseGeoJSON ((const unsigned char *) cases[i].text);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "case #%d: unexpected NULL\n", i);
+		return -1;
+	    }
+	  points = count_entities (geom, &lines, &polygons);
+	  if (geom->DeclaredType != cases[i].type
+	      || geom->DimensionModel != cases[i].model
+	      || geom->Srid != cases[i].srid || points != cases[i].points
+	      || lines != cases[i].lines || polygons != cases[i].polygons)
+	    {
+		fprintf (stderr,
+			 "case #%d: unexpected type=%d model=%d srid=%d "
+			 "entities=%d/%d/%d\n", i, geom->DeclaredType,
+			 geom->DimensionModel, geom->Srid, points, lines,
+			 polygons);
+		gaiaFreeGeomColl (geom);
+		return -2;
+	    }
+	  if (points > 0
+	      && (geom->FirstPoint->X != cases[i].x
+		  || geom->FirstPoint->Y != cases[i].y))
+	    {
+		fprintf (stderr, "case #%d: unexpected POINT %1.17g %1.17g\n",
+			 i, geom->FirstPoint->X, geom->FirstPoint->Y);
+		gaiaFreeGeomColl (geom);
+		return -3;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    return 0;
+}
+
+static int
+check_invalid ()
+{
+/* testing malformed or unsupported GeoJSON geometries */
+    gaiaGeomCollPtr geom;
+    int i;
+    const char *json[] = {
+	"", "{}", "{\"type\":\"Point\"}", "{\"coordinates\":[1,2]}",
+	"{\"type\":\"point\",\"coordinates\":[1,2]}",
+	"{\"type\":\"Point\",\"coordinates\":[1,2,3,4]}",
+	"{\"type\":\"Point\",\"coordinates\":[1.e5,2]}",
+	"{\"type\":\"Point\",\"coordinates\":[1-2,3]}",
+	"{\"type\":\"Point\",\"coordinates\":[]}",
+	"{\"type\":\"Point\",\"coordinates\":[1,2],\"foo\":1}",
+	"{\"type\":\"Point\",\"type\":\"Point\",\"coordinates\":[1,2]}",
+	"{\"type\":\"Point\",\"bbox\":[1,2,3,1,2,3],\"coordinates\":[1,2]}",
+	"{\"type\":\"LineString\",\"coordinates\":[[1,2]]}",
+	"{\"type\":\"LineString\",\"coordinates\":[[1,2],[3,4,5]]}",
+	"{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[0,0]]]}",
+	"{\"type\":\"GeometryCollection\",\"geometries\":[{\"type\":\"Point\","
+	    "\"coordinates\":[1,2,3]}]}",
+	"{\"type\":\"Point\",\"crs\":{\"type\":\"name\",\"properties\":"
+	    "{\"name\":\"urn:ogc:def:crs:EPSG::3003\"}},\"coordinates\":[1,2]}",
+	NULL
+    };
+
+    for (i = 0; json[i] != NULL; i++)
+      {
+	  geom = gaiaParseGeoJSON ((const unsigned char *) json[i]);
+	  if (geom != NULL)
+	    {
+		fprintf (stderr, "GeoJSON #%d: unexpected success\n", i);
+		gaiaFreeGeomColl (geom);
+		return -10;
+	    }
+      }
+    return 0;
+}
+
+static int
+check_numbers ()
+{
+/* all numbers must exactly match strtod() */
+    gaiaGeomCollPtr geom;
+    char json[256];
+    double expected;
+    int i;
+    const char *numbers[] = {
+	"0.1", "-0.3", "123456.789", "1e22", "1e23", "9007199254740993",
+	"0.30000000000000004", "47.025800000000004", "-1.5E-05", "+.5e+1",
+	"2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+	"123456789012345678901234567890", "-0", "00012.50", NULL
+    };
+
+    for (i = 0; numbers[i] != NULL; i++)
+      {
+	  sprintf (json, "{\"type\":\"Point\",\"coordinates\":[%s,1]}",
+		   numbers[i]);
+	  geom = gaiaParseGeoJSON ((const unsigned char *) json);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "number \"%s\": unexpected NULL\n",
+			 numbers[i]);
+		return -20;
+	    }
+	  expected = strtod (numbers[i], NULL);
+	  if (memcmp (&(geom->FirstPoint->X), &expected, sizeof (double)) !=
+	      0)
+	    {
+		fprintf (stderr, "number \"%s\": unexpected %1.17g\n",
+			 numbers[i], geom->FirstPoint->X);
+		gaiaFreeGeomColl (geom);
+		return -21;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    return 0;
+}
+
+static int
+check_property (geojson_property_ptr prop, const char *name, int type,
+		const char *txt_value, sqlite3_int64 int_value,
+		double dbl_value)
+{
+/* checking a single Feature's Property */
+    if (prop == NULL)
+	return 0;
+    if (strcmp (prop->name, name) != 0 || prop->type != type)
+	return 0;
+    if (type == GEOJSON_TEXT && strcmp (prop->txt_value, txt_value) != 0)
+	return 0;
+    if (type == GEOJSON_INTEGER && prop->int_value != int_value)
+	return 0;
+    if (type == GEOJSON_DOUBLE && prop->dbl_value != dbl_value)
+	return 0;
+    return 1;
+}
+
+static int
+check_properties ()
+{
+/* testing Feature's Properties as read by VirtualGeoJSON */
+    FILE *in = tmpfile ();
+    geojson_parser_ptr parser;
+    geojson_feature_ptr ft;
+    geojson_property_ptr prop;
+    char *err_msg = NULL;
+    int ret = 0;
+
+    if (in == NULL)
+      {
+	  fprintf (stderr, "unable to create a temporary file\n");
+	  return -30;
+      }
+    fprintf (in, "{\"type\":\"FeatureCollection\",\"features\":[\n");
+    fprintf (in, "{\"type\":\"Feature\",\"properties\":{\"a\":"
+	     "\"with \\\"quote\\\"\",\"b\":\"\",\"c\":-1.5e3,\"d\":42,"
+	     "\"e\":{\"k\":[1,\"}\"]},\"f\":\"tab\\tsl\\/ \\u00e9\"},"
+	     "\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}},\n");
+    fprintf (in, "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\","
+	     "\"coordinates\":[3,4]},\"properties\":{\"a\":null,\"d\":true}}\n");
+    fprintf (in, "]}\n");
+    rewind (in);
+
+    parser = geojson_create_parser (in);
+    if (!geojson_parser_init (parser, &err_msg)
+	|| !geojson_create_features_index (parser, &err_msg)
+	|| !geojson_check_features (parser, &err_msg))
+      {
+	  fprintf (stderr, "GeoJSON parser error: %s\n",
+		   (err_msg == NULL) ? "?" : err_msg);
+	  sqlite3_free (err_msg);
+	  geojson_destroy_parser (parser);
+	  return -31;
+      }
+    if (parser->count != 2)
+      {
+	  fprintf (stderr, "unexpected %d Features\n", parser->count);
+	  geojson_destroy_parser (parser);
+	  return -32;
+      }
+    ft = parser->features;
+    if (!geojson_init_feature (parser, ft, &err_msg))
+      {
+	  fprintf (stderr, "unable to read Feature #1\n");
+	  sqlite3_free (err_msg);
+	  geojson_destroy_parser (parser);
+	  return -33;
+      }
+    prop = ft->first;
+    if (!check_property (prop, "a", GEOJSON_TEXT, "with \"quote\"", 0, 0.0))
+	ret = -34;
+    prop = (prop == NULL) ? NULL : prop->next;
+    if (!ret && !check_property (prop, "b", GEOJSON_TEXT, "", 0, 0.0))
+	ret = -35;
+    prop = (prop == NULL) ? NULL : prop->next;
+    if (!ret && !check_property (prop, "c", GEOJSON_DOUBLE, NULL, 0, -1500.0))
+	ret = -36;
+    prop = (prop == NULL) ? NULL : prop->next;
+    if (!ret && !check_property (prop, "d", GEOJSON_INTEGER, NULL, 42, 0.0))
+	ret = -37;
+    prop = (prop == NULL) ? NULL : prop->next;
+    if (!ret
+	&& !check_property (prop, "e", GEOJSON_TEXT, "{\"k\":[1,\"}\"]}", 0,
+			    0.0))
+	ret = -38;
+    prop = (prop == NULL) ? NULL : prop->next;
+    if (!ret
+	&& !check_property (prop, "f", GEOJSON_TEXT, "tab\tsl/ \xc3\xa9", 0,
+			    0.0))
+	ret = -39;
+    if (!ret && (prop == NULL || prop->next != NULL))
+	ret = -40;
+    geojson_reset_feature (ft);
+    if (ret != 0)
+      {
+	  fprintf (stderr, "unexpected Feature #1 Properties (%d)\n", ret);
+	  geojson_destroy_parser (parser);
+	  return ret;
+      }
+
+    ft = parser->features + 1;
+    if (!geojson_init_feature (parser, ft, &err_msg))
+      {
+	  fprintf (stderr, "unable to read Feature #2\n");
+	  sqlite3_free (err_msg);
+	  geojson_destroy_parser (parser);
+	  return -41;
+      }
+    prop = ft->first;
+    if (!check_property (prop, "a", GEOJSON_NULL, NULL, 0, 0.0)
+	|| !check_property (prop->next, "d", GEOJSON_TRUE, NULL, 0, 0.0))
+	ret = -42;
+    geojson_reset_feature (ft);
+    geojson_destroy_parser (parser);
+    if (ret != 0)
+	fprintf (stderr, "unexpected Feature #2 Properties\n");
+    return ret;
+}
+
+static int
+check_sql (sqlite3 * handle)
+{
+/* testing the SQL functions */
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    char *err_msg = NULL;
+    const char *sql =
+	"SELECT AsGeoJSON(GeomFromGeoJSON('{\"type\":\"MultiPoint\","
+	"\"coordinates\":[[1,2],[3,4]]}')), "
+	"ST_Srid(GeomFromGeoJSON('{\"type\":\"Point\",\"crs\":{\"type\":"
+	"\"name\",\"properties\":{\"name\":\"EPSG:4326\"}},"
+	"\"coordinates\":[1,2]}')), "
+	"GeomFromGeoJSON('{\"type\":\"Point\",\"coordinates\":[1,2]')";
+
+    ret = sqlite3_get_table (handle, sql, &results, &rows, &columns, &err_msg);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "Error: %s\n", err_msg);
+	  sqlite3_free (err_msg);
+	  return -50;
+      }
+    if (rows != 1 || columns != 3)
+      {
+	  fprintf (stderr, "unexpected %d rows / %d columns\n", rows, columns);
+	  ret = -51;
+      }
+    else if (strcmp (results[3],
+		     "{\"type\":\"MultiPoint\",\"coordinates\":[[1,2],[3,4]]}")
+	     != 0)
+      {
+	  fprintf (stderr, "unexpected GeoJSON: %s\n", results[3]);
+	  ret = -52;
+      }
+    else if (strcmp (results[4], "4326") != 0)
+      {
+	  fprintf (stderr, "unexpected SRID: %s\n", results[4]);
+	  ret = -53;
+      }
+    else if (results[5] != NULL)
+      {
+	  fprintf (stderr, "unexpected malformed GeoJSON result\n");
+	  ret = -54;
+      }
+    else
+	ret = 0;
+    sqlite3_free_table (results);
+    return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret = check_cases ();
+    if (ret != 0)
+	return ret;
+    ret = check_invalid ();
+    if (ret != 0)
+	return ret;
+    ret = check_numbers ();
+    if (ret != 0)
+	return ret;
+    ret = check_properties ();
+    if (ret != 0)
+	return ret;
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory database: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -60;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    ret = check_sql (handle);
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return ret;
+}
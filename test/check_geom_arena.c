@@ -0,0 +1,359 @@
+/*
+
+ check_geom_arena.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include <spatialite/gaiageo.h>
+
+static const char *wkt_samples[] = {
+    "POINT(1.5 2.5)",
+    "POINTZM(1.5 2.5 3.5 4.5)",
+    "LINESTRING(0 0, 1.1 1.2, 2.3 2.4, 3 3)",
+    "LINESTRINGM(0 0 1, 1.1 1.2 2, 2.3 2.4 3, 3 3 4)",
+    "POLYGON((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 3 2, 3 3, 2 2))",
+    "POLYGONZ((0 0 1, 10 0 2, 10 10 3, 0 10 4, 0 0 1))",
+    "MULTIPOINT(1 1, 2 2, 3 3)",
+    "MULTIPOLYGON(((0 0, 1 0, 1 1, 0 0)), ((5 5, 6 5, 6 6, 5 5), "
+	"(5.1 5.1, 5.2 5.1, 5.2 5.2, 5.1 5.1)))",
+    "GEOMETRYCOLLECTIONZM(POINTZM(1 2 3 4), "
+	"LINESTRINGZM(0 0 1 2, 1.5 1.5 2 3, 2 2 3 4), "
+	"POLYGONZM((0 0 1 1, 1 0 1 1, 1 1 1 1, 0 0 1 1)), POINTZM(9 9 9 9))",
+    NULL
+};
+
+static int
+same_wkt (gaiaGeomCollPtr geom1, gaiaGeomCollPtr geom2, const char *title)
+{
+/* comparing two Geometries by their WKT representation */
+    gaiaOutBuffer out1;
+    gaiaOutBuffer out2;
+    int ret = 1;
+    gaiaOutBufferInitialize (&out1);
+    gaiaOutBufferInitialize (&out2);
+    gaiaOutWkt (&out1, geom1);
+    gaiaOutWkt (&out2, geom2);
+    if (out1.Buffer == NULL || out2.Buffer == NULL
+	|| strcmp (out1.Buffer, out2.Buffer) != 0)
+      {
+	  fprintf (stderr, "%s: mismatching WKT\n\t%s\n\t%s\n", title,
+		   out1.Buffer ? out1.Buffer : "NULL",
+		   out2.Buffer ? out2.Buffer : "NULL");
+	  ret = 0;
+      }
+    gaiaOutBufferReset (&out1);
+    gaiaOutBufferReset (&out2);
+    return ret;
+}
+
+static int
+check_arena_decode (gaiaGeomArenaPtr arena, const unsigned char *blob,
+		    int size, const char *wkt)
+{
+/* decoding the same BLOB both from the heap and from the Arena */
+    int ret;
+    gaiaGeomCollPtr heap =
+	gaiaFromSpatiaLiteBlobWkbEx (blob, size, 0, 0);
+    gaiaGeomCollPtr arena_geom =
+	gaiaFromSpatiaLiteBlobWkbArena (arena, blob, size, 0, 0);
+    if (heap == NULL || arena_geom == NULL)
+      {
+	  fprintf (stderr, "%s: unable to decode\n", wkt);
+	  return 0;
+      }
+    ret = same_wkt (heap, arena_geom, wkt);
+    if (ret && heap->DeclaredType != arena_geom->DeclaredType)
+      {
+	  fprintf (stderr, "%s: mismatching DeclaredType\n", wkt);
+	  ret = 0;
+      }
+    gaiaFreeGeomColl (heap);
+    /* harmless no-op */
+    gaiaFreeGeomColl (arena_geom);
+    return ret;
+}
+
+static int
+check_arena_edit (gaiaGeomArenaPtr arena)
+{
+/* adding heap allocated items to an Arena Geometry */
+    gaiaGeomCollPtr geom;
+    gaiaGeomCollPtr expected;
+    gaiaLinestringPtr line;
+    gaiaPolygonPtr polyg;
+    gaiaRingPtr ring;
+    int ret;
+
+    geom = gaiaAllocGeomCollArena (arena, GAIA_XY);
+    line = gaiaAllocLinestring (2);
+    gaiaSetPoint (line->Coords, 0, 0.0, 0.0);
+    gaiaSetPoint (line->Coords, 1, 1.0, 1.0);
+    gaiaInsertLinestringInGeomColl (geom, line);
+
+    ring = gaiaAllocRing (4);
+    gaiaSetPoint (ring->Coords, 0, 0.0, 0.0);
+    gaiaSetPoint (ring->Coords, 1, 10.0, 0.0);
+    gaiaSetPoint (ring->Coords, 2, 10.0, 10.0);
+    gaiaSetPoint (ring->Coords, 3, 0.0, 0.0);
+    polyg = gaiaInsertPolygonInGeomColl (geom, ring);
+
+    ring = gaiaAllocRing (4);
+    gaiaSetPoint (ring->Coords, 0, 1.0, 1.0);
+    gaiaSetPoint (ring->Coords, 1, 2.0, 1.0);
+    gaiaSetPoint (ring->Coords, 2, 2.0, 2.0);
+    gaiaSetPoint (ring->Coords, 3, 1.0, 1.0);
+    gaiaInsertInteriorRing (polyg, ring);
+    gaiaInsertInteriorRing (polyg, ring);
+    gaiaFreeRing (ring);
+
+    ring = gaiaAllocRing (4);
+    gaiaSetPoint (ring->Coords, 0, 3.0, 3.0);
+    gaiaSetPoint (ring->Coords, 1, 4.0, 3.0);
+    gaiaSetPoint (ring->Coords, 2, 4.0, 4.0);
+    gaiaSetPoint (ring->Coords, 3, 3.0, 3.0);
+    gaiaAddRingToPolyg (polyg, ring);
+
+    expected =
+	gaiaParseWkt ((const unsigned char *)
+		      "GEOMETRYCOLLECTION(LINESTRING(0 0, 1 1), "
+		      "POLYGON((0 0, 10 0, 10 10, 0 0), (1 1, 2 1, 2 2, 1 1), "
+		      "(1 1, 2 1, 2 2, 1 1), (3 3, 4 3, 4 4, 3 3)))", -1);
+    ret = same_wkt (expected, geom, "ArenaEdit");
+    gaiaFreeGeomColl (expected);
+    gaiaFreeGeomColl (geom);
+    gaiaResetGeomArena (arena);
+    return ret;
+}
+
+static int
+check_sql (sqlite3 * handle, const char *sql, const char *expected)
+{
+/* checking the Text result of some SQL query */
+    int ret;
+    sqlite3_stmt *stmt;
+    const char *value;
+    int ok = 0;
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    while (1)
+      {
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW)
+	    {
+		ok = 0;
+		break;
+	    }
+	  value = (const char *) sqlite3_column_text (stmt, 0);
+	  if (value == NULL || strcmp (value, expected) != 0)
+	    {
+		fprintf (stderr, "%s: unexpected \"%s\" (expected \"%s\")\n",
+			 sql, value ? value : "NULL", expected);
+		ok = 0;
+		break;
+	    }
+	  ok = 1;
+      }
+    sqlite3_finalize (stmt);
+    return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    gaiaGeomCollPtr geom;
+    gaiaGeomArenaPtr arena;
+    gaiaLinestringPtr line;
+    unsigned char *blob;
+    int size;
+    int i;
+    const char *wkt;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    arena = gaiaCreateGeomArena ();
+    if (arena == NULL)
+      {
+	  fprintf (stderr, "unable to create an Arena\n");
+	  return -1;
+      }
+
+    for (i = 0; wkt_samples[i] != NULL; i++)
+      {
+	  wkt = wkt_samples[i];
+	  geom = gaiaParseWkt ((const unsigned char *) wkt, -1);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "unable to parse: %s\n", wkt);
+		return -2;
+	    }
+	  gaiaMbrGeometry (geom);
+
+	  /* plain BLOB-Geometry */
+	  gaiaToSpatiaLiteBlobWkb (geom, &blob, &size);
+	  ret = check_arena_decode (arena, blob, size, wkt);
+	  free (blob);
+	  if (!ret)
+	      return -3;
+
+	  /* compressed BLOB-Geometry */
+	  gaiaToCompressedBlobWkb (geom, &blob, &size);
+	  ret = check_arena_decode (arena, blob, size, wkt);
+	  free (blob);
+	  if (!ret)
+	      return -4;
+
+	  /* TinyPoint BLOB-Geometry [always heap allocated] */
+	  gaiaToSpatiaLiteBlobWkbEx2 (geom, &blob, &size, 0, 1);
+	  ret = check_arena_decode (arena, blob, size, wkt);
+	  free (blob);
+	  if (!ret)
+	      return -5;
+	  gaiaFreeGeomColl (geom);
+	  gaiaResetGeomArena (arena);
+      }
+
+/* an oversized Geometry requiring a dedicated Arena block */
+    geom = gaiaAllocGeomColl ();
+    line = gaiaAddLinestringToGeomColl (geom, 20000);
+    for (i = 0; i < line->Points; i++)
+	gaiaSetPoint (line->Coords, i, (double) i, (double) (i % 7));
+    gaiaMbrGeometry (geom);
+    gaiaToSpatiaLiteBlobWkb (geom, &blob, &size);
+    for (i = 0; i < 3; i++)
+      {
+	  ret = check_arena_decode (arena, blob, size, "LongLine");
+	  gaiaResetGeomArena (arena);
+	  if (!ret)
+	      return -6;
+      }
+    free (blob);
+    gaiaFreeGeomColl (geom);
+
+/* Arena Geometries adopting heap allocated items */
+    if (!check_arena_edit (arena))
+	return -7;
+
+/* a NULL Arena simply falls back to ordinary heap allocations */
+    geom = gaiaAllocGeomCollArena (NULL, GAIA_XY_Z);
+    if (geom == NULL || geom->DimensionModel != GAIA_XY_Z)
+      {
+	  fprintf (stderr, "gaiaAllocGeomCollArena: unexpected NULL Arena\n");
+	  return -8;
+      }
+    gaiaFreeGeomColl (geom);
+    gaiaFreeGeomArena (arena);
+
+/* SQL functions decoding into the connection's Arena */
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+    if (!check_sql
+	(handle,
+	 "SELECT AsText(GeomFromText('POLYGON((0 0, 10 0, 10 10, 0 0), "
+	 "(1 1, 2 1, 2 2, 1 1))'))",
+	 "POLYGON((0 0, 10 0, 10 10, 0 0), (1 1, 2 1, 2 2, 1 1))"))
+	return -9;
+    if (!check_sql
+	(handle,
+	 "SELECT AsWkt(CompressGeometry(GeomFromText("
+	 "'LINESTRING(0 0, 1 1, 2 2)')), 1)",
+	 "LINESTRING(0 0,1 1,2 2)"))
+	return -10;
+    if (!check_sql
+	(handle,
+	 "SELECT AsGeoJSON(GeomFromText('MULTIPOINT(1 2, 3 4)'))",
+	 "{\"type\":\"MultiPoint\",\"coordinates\":[[1,2],[3,4]]}"))
+	return -11;
+    if (!check_sql
+	(handle,
+	 "SELECT AsSvg(GeomFromText('LINESTRING(0 0, 1 1)'))",
+	 "M 0 0 L 1 -1"))
+	return -12;
+    if (!check_sql
+	(handle,
+	 "SELECT Hex(AsBinary(GeomFromText('POINT(1 2)')))",
+	 "0101000000000000000000F03F0000000000000040"))
+	return -13;
+    if (!check_sql
+	(handle,
+	 "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq "
+	 "WHERE n < 100) SELECT Max(AsText(MakeLine(MakePoint(n, 0), "
+	 "MakePoint(0, n)))) = AsText(MakeLine(MakePoint(99, 0), "
+	 "MakePoint(0, 99))) FROM seq", "1"))
+	return -14;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+
+ check_geos_cache.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    sqlite3_int64 value;
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+/* configuring the cache size */
+    if (!query_int64 (handle, "SELECT GetGeosCacheSize()", &value)
+	|| value != 64)
+	return -1;
+    if (!execute (handle, "SELECT SetGeosCacheSize(3)"))
+	return -2;
+    if (!query_int64 (handle, "SELECT GetGeosCacheSize()", &value)
+	|| value != 3)
+	return -3;
+    if (!execute (handle, "SELECT SetGeosCacheSize(1000000)"))
+	return -4;
+    if (!query_int64 (handle, "SELECT GetGeosCacheSize()", &value)
+	|| value != 16384)
+	return -5;
+    if (!execute (handle, "SELECT SetGeosCacheSize(-1)"))
+	return -6;
+    if (!query_int64 (handle, "SELECT GetGeosCacheSize()", &value)
+	|| value != 64)
+	return -7;
+    if (!execute (handle, "SELECT SetGeosCacheSize('abc')"))
+	return -8;
+    if (!query_int64 (handle, "SELECT GetGeosCacheSize()", &value)
+	|| value != 64)
+	return -9;
+    if (!query_int64 (handle, "SELECT GetGeosCacheHits()", &value)
+	|| value != 0)
+	return -10;
+    if (!query_int64 (handle, "SELECT GetGeosCacheMisses()", &value)
+	|| value != 0)
+	return -11;
+    if (!query_int64 (handle, "SELECT GetGeosCacheEvictions()", &value)
+	|| value != 0)
+	return -12;
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+/* a point-in-polygon join against more than two distinct polygons */
+    if (!execute
+	(handle,
+	 "CREATE TABLE zones AS WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL "
+	 "SELECT n + 1 FROM seq WHERE n < 9) SELECT n AS id, "
+	 "BuildMbr(n * 10, 0, n * 10 + 10, 10) AS geom FROM seq"))
+	return -13;
+    if (!execute
+	(handle,
+	 "CREATE TABLE pts AS WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL "
+	 "SELECT n + 1 FROM seq WHERE n < 999) SELECT n AS id, "
+	 "MakePoint((n * 37) % 100 + 0.5, (n * 13) % 10 + 0.5) AS geom "
+	 "FROM seq"))
+	return -14;
+    if (!query_int64
+	(handle,
+	 "SELECT Count(*) FROM zones AS z, pts AS p "
+	 "WHERE ST_Intersects(z.geom, p.geom) = 1", &value) || value != 1000)
+	return -15;
+    if (!query_int64 (handle, "SELECT GetGeosCacheHits()", &value)
+	|| value == 0)
+	return -16;
+    if (!query_int64 (handle, "SELECT GetGeosCacheEvictions()", &value)
+	|| value != 0)
+	return -17;
+
+/* shrinking the cache evicts the least recently used items */
+    if (!execute (handle, "SELECT SetGeosCacheSize(2)"))
+	return -18;
+    if (!query_int64 (handle, "SELECT GetGeosCacheEvictions()", &value)
+	|| value == 0)
+	return -19;
+    if (!execute (handle, "SELECT ResetGeosCacheStatistics()"))
+	return -20;
+    if (!query_int64 (handle, "SELECT GetGeosCacheHits()", &value)
+	|| value != 0)
+	return -21;
+
+/* a disabled cache always gives the same answers */
+    if (!execute (handle, "SELECT SetGeosCacheSize(0)"))
+	return -22;
+    if (!query_int64
+	(handle,
+	 "SELECT Count(*) FROM zones AS z, pts AS p "
+	 "WHERE ST_Intersects(z.geom, p.geom) = 1", &value) || value != 1000)
+	return -23;
+    if (!query_int64 (handle, "SELECT GetGeosCacheHits()", &value)
+	|| value != 0)
+	return -24;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
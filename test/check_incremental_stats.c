@@ -0,0 +1,266 @@
+/*
+
+ check_incremental_stats.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+check_stats (sqlite3 * handle, int *valid_extent)
+{
+/* 
+/ comparing the incrementally maintained statistics against
+/ the actual table content; an invalidated extent is accepted
+*/
+    int ret;
+    int ok = 0;
+    sqlite3_stmt *stmt;
+    const char *sql =
+	"SELECT s.row_count, (SELECT Count(*) FROM pts), "
+	"s.extent_min_x IS NOT NULL, "
+	"s.extent_min_x = (SELECT Min(MbrMinX(geom)) FROM pts) AND "
+	"s.extent_min_y = (SELECT Min(MbrMinY(geom)) FROM pts) AND "
+	"s.extent_max_x = (SELECT Max(MbrMaxX(geom)) FROM pts) AND "
+	"s.extent_max_y = (SELECT Max(MbrMaxY(geom)) FROM pts) "
+	"FROM geometry_columns_statistics AS s "
+	"WHERE s.f_table_name = 'pts' AND s.f_geometry_column = 'geom'";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW)
+      {
+	  if (sqlite3_column_int (stmt, 0) != sqlite3_column_int (stmt, 1))
+	      fprintf (stderr, "row_count mismatch: %d %d\n",
+		       sqlite3_column_int (stmt, 0),
+		       sqlite3_column_int (stmt, 1));
+	  else
+	    {
+		*valid_extent = sqlite3_column_int (stmt, 2);
+		if (*valid_extent && sqlite3_column_int (stmt, 3) != 1)
+		    fprintf (stderr, "extent mismatch\n");
+		else
+		    ok = 1;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    return ok;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    int value;
+    void *cache = spatialite_alloc_connection ();
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int valid;
+#endif
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+/* no metadata tables at all */
+    if (!query_int
+	(handle, "SELECT EnableIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 0)
+	return -1;
+    if (!query_int
+	(handle, "SELECT HasIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 0)
+	return -2;
+    if (!query_int
+	(handle, "SELECT HasIncrementalStatistics('pts', 1)", &value)
+	|| value != -1)
+	return -3;
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -10;
+    if (!execute
+	(handle, "CREATE TABLE pts (id INTEGER PRIMARY KEY, name TEXT)"))
+	return -11;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('pts', 'geom', 4326, 'POINT', 'XY')"))
+	return -12;
+    if (!execute
+	(handle,
+	 "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 "
+	 "FROM seq WHERE n < 100) INSERT INTO pts (id, name, geom) "
+	 "SELECT n, 'pt' || n, MakePoint(n % 10, n / 10, 4326) FROM seq"))
+	return -13;
+
+/* enabling the incremental mode */
+    if (!query_int
+	(handle, "SELECT EnableIncrementalStatistics('PTS', 'Geom')", &value)
+	|| value != 1)
+	return -14;
+    if (!query_int
+	(handle, "SELECT HasIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 1)
+	return -15;
+    if (!query_int
+	(handle, "SELECT EnableIncrementalStatistics('pts', 'name')", &value)
+	|| value != 0)
+	return -16;
+    if (!check_stats (handle, &valid) || !valid)
+	return -17;
+
+/* INSERT always keeps the extent up to date */
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (id, name, geom) VALUES "
+	 "(101, 'out', MakePoint(100, 50, 4326))"))
+	return -18;
+    if (!execute
+	(handle, "INSERT INTO pts (id, name, geom) VALUES (102, 'null', NULL)"))
+	return -19;
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (id, name, geom) VALUES "
+	 "(103, 'in', MakePoint(5, 5, 4326))"))
+	return -20;
+    if (!check_stats (handle, &valid) || !valid)
+	return -21;
+
+/* deleting or moving an interior Geometry preserves the extent */
+    if (!execute (handle, "DELETE FROM pts WHERE id IN (103, 102, 55)"))
+	return -22;
+    if (!execute
+	(handle, "UPDATE pts SET geom = MakePoint(-20, 3, 4326) WHERE id = 44"))
+	return -23;
+    if (!execute (handle, "UPDATE pts SET name = 'renamed' WHERE id = 1"))
+	return -24;
+    if (!check_stats (handle, &valid) || !valid)
+	return -25;
+
+/* deleting a Geometry on the boundary invalidates the extent */
+    if (!execute (handle, "DELETE FROM pts WHERE id = 101"))
+	return -26;
+    if (!check_stats (handle, &valid) || valid)
+	return -27;
+    if (!query_int
+	(handle,
+	 "SELECT MbrMaxX(GetLayerExtent('pts', 'geom')) = "
+	 "(SELECT Max(MbrMaxX(geom)) FROM pts)", &value) || value != 1)
+	return -28;
+    if (!check_stats (handle, &valid) || !valid)
+	return -29;
+
+/* the same for an UPDATE shrinking the extent */
+    if (!execute
+	(handle, "UPDATE pts SET geom = MakePoint(1, 1, 4326) WHERE id = 44"))
+	return -30;
+    if (!check_stats (handle, &valid) || valid)
+	return -31;
+    if (!execute (handle, "SELECT UpdateLayerStatistics('pts', 'geom')"))
+	return -32;
+    if (!check_stats (handle, &valid) || !valid)
+	return -33;
+
+/* regenerating the Geometry triggers preserves the incremental mode */
+    if (!execute (handle, "SELECT CreateSpatialIndex('pts', 'geom')"))
+	return -34;
+    if (!query_int
+	(handle, "SELECT HasIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 1)
+	return -35;
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (id, name, geom) VALUES "
+	 "(104, 'out', MakePoint(-50, -50, 4326))"))
+	return -36;
+    if (!check_stats (handle, &valid) || !valid)
+	return -37;
+
+/* disabling the incremental mode */
+    if (!query_int
+	(handle, "SELECT DisableIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 1)
+	return -38;
+    if (!query_int
+	(handle, "SELECT HasIncrementalStatistics('pts', 'geom')", &value)
+	|| value != 0)
+	return -39;
+    if (!execute (handle, "DELETE FROM pts WHERE id = 104"))
+	return -40;
+    if (!query_int
+	(handle,
+	 "SELECT row_count FROM geometry_columns_statistics "
+	 "WHERE f_table_name = 'pts'", &value) || value != 100)
+	return -41;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
@@ -0,0 +1,282 @@
+/*
+
+ check_knn_join.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* GEOS is supported */
+#ifndef OMIT_KNN		/* only if KNN is enabled */
+
+static int
+create_layer (sqlite3 * handle, const char *table, const char *type,
+	      int srid, int count, double scale, int indexed)
+{
+/* creating a layer of pseudo-random Points or Linestrings */
+    char *sql;
+    int ok = 0;
+
+    sql = sqlite3_mprintf ("CREATE TABLE %s (id INTEGER PRIMARY KEY)", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT AddGeometryColumn(%Q, 'geom', %d, %Q, 'XY')", table, srid,
+	 type);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    if (indexed)
+      {
+	  sql =
+	      sqlite3_mprintf ("SELECT CreateSpatialIndex(%Q, 'geom')", table);
+	  if (!execute (handle, sql))
+	      goto end;
+	  sqlite3_free (sql);
+      }
+    if (strcmp (type, "POINT") == 0)
+	sql =
+	    sqlite3_mprintf
+	    ("INSERT INTO %s (geom) WITH RECURSIVE "
+	     "seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < %d) "
+	     "SELECT MakePoint((n * 7919 %% 997) * %f - 179.9, "
+	     "(n * 104729 %% 991) * %f * 0.5 - 89.9, %d) FROM seq", table,
+	     count, scale, scale, srid);
+    else
+	sql =
+	    sqlite3_mprintf
+	    ("INSERT INTO %s (geom) WITH RECURSIVE "
+	     "seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < %d) "
+	     "SELECT MakeLine(MakePoint((n * 7919 %% 997) * %f, "
+	     "(n * 104729 %% 991) * %f, %d), MakePoint((n * 7919 %% 997) * %f "
+	     "+ n %% 13, (n * 104729 %% 991) * %f - n %% 7, %d)) FROM seq",
+	     table, count, scale, scale, srid, scale, scale, srid);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+/* a NULL geometry is never a probe nor a neighbour */
+    sql = sqlite3_mprintf ("INSERT INTO %s (geom) VALUES (NULL)", table);
+    if (!execute (handle, sql))
+	goto end;
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+
+static int
+check_knn_join (sqlite3 * handle, const char *table_a, const char *table_b,
+		int max_items, int geodesic)
+{
+/* comparing the KNN join against a nested-loop on ST_Distance */
+    int value;
+    int expected;
+    char *sql;
+    int ok = 0;
+    const char *use_ellipsoid = geodesic ? ", 1" : "";
+
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) * Min(%d, (SELECT Count(geom) FROM %s)) "
+	 "FROM %s WHERE geom IS NOT NULL", max_items, table_b, table_a);
+    if (!query_int (handle, sql, &expected) || expected == 0)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM KnnJoin WHERE table_a = %Q AND "
+	 "table_b = %Q AND max_items = %d", table_a, table_b, max_items);
+    if (!query_int (handle, sql, &value) || value != expected)
+	goto end;
+    sqlite3_free (sql);
+/* the Nth neighbour must be at the Nth smallest distance */
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM KnnJoin AS j JOIN %s AS x ON "
+	 "(x.id = j.rowid_a) WHERE j.table_a = %Q AND j.table_b = %Q AND "
+	 "j.max_items = %d AND ((SELECT Count(*) FROM %s AS y WHERE "
+	 "ST_Distance(x.geom, y.geom%s) < j.distance - 0.000001) >= j.pos OR "
+	 "(SELECT Count(*) FROM %s AS y WHERE ST_Distance(x.geom, y.geom%s) "
+	 "<= j.distance + 0.000001) < j.pos)", table_a, table_a, table_b,
+	 max_items, table_b, use_ellipsoid, table_b, use_ellipsoid);
+    if (!query_int (handle, sql, &value) || value != 0)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM KnnJoin AS j JOIN %s AS x ON "
+	 "(x.id = j.rowid_a) JOIN %s AS y ON (y.id = j.rowid_b) "
+	 "WHERE j.table_a = %Q AND j.table_b = %Q AND j.max_items = %d "
+	 "AND Abs(j.distance - ST_Distance(x.geom, y.geom%s)) > 0.000001",
+	 table_a, table_b, table_a, table_b, max_items, use_ellipsoid);
+    if (!query_int (handle, sql, &value) || value != 0)
+	goto end;
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+
+#endif /* end KNN conditional */
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+#ifndef OMIT_GEOS		/* GEOS is supported */
+#ifndef OMIT_KNN		/* only if KNN is enabled */
+    int value;
+#endif
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* GEOS is supported */
+#ifndef OMIT_KNN		/* only if KNN is enabled */
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+    if (!execute
+	(handle, "CREATE VIRTUAL TABLE KnnJoin USING VirtualKNNJoin()"))
+	return -2;
+    if (!create_layer (handle, "pt_a", "POINT", 3003, 200, 10.0, 0))
+	return -3;
+    if (!create_layer (handle, "pt_b", "POINT", 3003, 1500, 10.0, 1))
+	return -4;
+    if (!create_layer (handle, "ln_a", "LINESTRING", 3003, 100, 10.0, 0))
+	return -5;
+    if (!create_layer (handle, "ln_b", "LINESTRING", 3003, 1000, 10.0, 1))
+	return -6;
+    if (!create_layer (handle, "geo_a", "POINT", 4326, 100, 0.36, 0))
+	return -7;
+    if (!create_layer (handle, "geo_b", "POINT", 4326, 1000, 0.36, 1))
+	return -8;
+
+/* exact neighbours, serial and parallel */
+    if (!execute (handle, "SELECT SetMaxThreads(1)"))
+	return -9;
+    if (!check_knn_join (handle, "pt_a", "pt_b", 1, 0))
+	return -10;
+    if (!check_knn_join (handle, "pt_a", "ln_b", 4, 0))
+	return -11;
+    if (!check_knn_join (handle, "geo_a", "geo_b", 5, 1))
+	return -12;
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -13;
+    if (!check_knn_join (handle, "pt_a", "pt_b", 8, 0))
+	return -14;
+    if (!check_knn_join (handle, "ln_a", "pt_b", 3, 0))
+	return -15;
+    if (!check_knn_join (handle, "geo_a", "geo_b", 2, 1))
+	return -16;
+
+/* defaults, DB= prefix and degenerate requests */
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM KnnJoin WHERE table_a = 'DB=main.PT_A' AND "
+	 "geometry_a = 'Geom' AND table_b = 'DB=main.pt_b' AND "
+	 "geometry_b = 'geom'", &value) || value != 200 * 3)
+	return -17;
+    if (!query_int
+	(handle,
+	 "SELECT Max(pos) FROM KnnJoin WHERE table_a = 'pt_a' AND "
+	 "table_b = 'pt_b' AND max_items = 5000", &value) || value != 1024)
+	return -18;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM KnnJoin WHERE table_a = 'pt_a' AND "
+	 "table_b = 'pt_a'", &value) || value != 0)
+	return -19;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM KnnJoin WHERE table_a = 'pt_a' AND "
+	 "table_b = 'nothing'", &value) || value != 0)
+	return -20;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM KnnJoin WHERE table_a = 'pt_a'",
+	 &value) || value != 0)
+	return -21;
+    if (!expect_failure
+	(handle,
+	 "SELECT Count(*) FROM KnnJoin WHERE table_a = 'pt_a' AND "
+	 "table_b = 'geo_b'"))
+	return -22;
+#endif /* end KNN conditional */
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
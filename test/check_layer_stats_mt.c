@@ -0,0 +1,300 @@
+/*
+
+ check_layer_stats_mt.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static char *
+dump_table (sqlite3 * handle, const char *sql)
+{
+/* serializing the whole result set of some query */
+    char **results;
+    int rows;
+    int columns;
+    int i;
+    char *dump = sqlite3_mprintf ("%s", "");
+    char *prev;
+    int ret = sqlite3_get_table (handle, sql, &results, &rows, &columns, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  sqlite3_free (dump);
+	  return NULL;
+      }
+    for (i = columns; i < (rows + 1) * columns; i++)
+      {
+	  prev = dump;
+	  dump =
+	      sqlite3_mprintf ("%s%s|", prev,
+			       (results[i] == NULL) ? "NULL" : results[i]);
+	  sqlite3_free (prev);
+      }
+    sqlite3_free_table (results);
+    return dump;
+}
+
+static const char *stats_queries[] = {
+    "SELECT f_table_name, f_geometry_column, row_count, extent_min_x, "
+	"extent_min_y, extent_max_x, extent_max_y "
+	"FROM geometry_columns_statistics ORDER BY 1, 2",
+    "SELECT f_table_name, f_geometry_column, ordinal, column_name, "
+	"null_values, integer_values, double_values, text_values, "
+	"blob_values, max_size, integer_min, integer_max, double_min, "
+	"double_max FROM geometry_columns_field_infos ORDER BY 1, 2, 3",
+    "SELECT view_name, view_geometry, row_count, extent_min_x, "
+	"extent_min_y, extent_max_x, extent_max_y "
+	"FROM views_geometry_columns_statistics ORDER BY 1, 2",
+    "SELECT view_name, view_geometry, ordinal, column_name, null_values, "
+	"integer_values, double_values, text_values, blob_values, max_size, "
+	"integer_min, integer_max, double_min, double_max "
+	"FROM views_geometry_columns_field_infos ORDER BY 1, 2, 3",
+    NULL
+};
+
+static int
+populate (sqlite3 * handle)
+{
+/* creating a few layers; the first one is large enough to be chunked */
+    int i;
+    char *sql;
+    for (i = 0; i < 4; i++)
+      {
+	  sql =
+	      sqlite3_mprintf
+	      ("CREATE TABLE lyr%d (id INTEGER PRIMARY KEY, name TEXT, "
+	       "val, dbl DOUBLE, num INTEGER)", i);
+	  if (!execute (handle, sql))
+	      return 0;
+	  sqlite3_free (sql);
+	  sql =
+	      sqlite3_mprintf
+	      ("SELECT AddGeometryColumn('lyr%d', 'geom', 4326, 'POINT', 'XY')",
+	       i);
+	  if (!execute (handle, sql))
+	      return 0;
+	  sqlite3_free (sql);
+	  /* "val" contains a single TEXT value within a mostly INTEGER column */
+	  sql =
+	      sqlite3_mprintf
+	      ("WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 "
+	       "FROM seq WHERE n < %d) INSERT INTO lyr%d "
+	       "(id, name, val, dbl, num, geom) SELECT n, 'name' || (n %% 97), "
+	       "CASE WHEN n = %d THEN 'text' WHEN n %% 5 = 0 THEN NULL "
+	       "ELSE n * 3 - %d END, n * 0.5 - 7, "
+	       "CASE WHEN n %% 7 = 0 THEN NULL ELSE n %% 1000 END, "
+	       "CASE WHEN n %% 11 = 0 THEN NULL ELSE "
+	       "MakePoint(n %% 360 - 180.5, (n * 7) %% 170 - 85, 4326) END "
+	       "FROM seq", (i == 0) ? 200000 : 1000 * (i + 1), i,
+	       (i == 0) ? 100003 : 17, i);
+	  if (!execute (handle, sql))
+	      return 0;
+	  sqlite3_free (sql);
+      }
+    if (!execute
+	(handle,
+	 "CREATE VIEW lyr_view AS SELECT id AS rid, name, dbl, geom "
+	 "FROM lyr1 WHERE id % 3 = 0"))
+	return 0;
+    if (!execute
+	(handle,
+	 "INSERT INTO views_geometry_columns (view_name, view_geometry, "
+	 "view_rowid, f_table_name, f_geometry_column, read_only) "
+	 "VALUES ('lyr_view', 'geom', 'rid', 'lyr1', 'geom', 1)"))
+	return 0;
+    return 1;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    int value;
+    void *cache = spatialite_alloc_connection ();
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    const char *db_path = "./layer_stats_mt.sqlite";
+    char *serial[4];
+    char *parallel;
+    int i;
+#endif
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+/* configuring the worker threads */
+    if (!query_int (handle, "SELECT GetMaxThreads()", &value) || value != 1)
+	return -1;
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -2;
+    if (!query_int (handle, "SELECT GetMaxThreads()", &value) || value != 4)
+	return -3;
+    if (!execute (handle, "SELECT SetMaxThreads(0)"))
+	return -4;
+    if (!query_int (handle, "SELECT GetMaxThreads()", &value) || value != 1)
+	return -5;
+    if (!execute (handle, "SELECT SetMaxThreads(100000)"))
+	return -6;
+    if (!query_int (handle, "SELECT GetMaxThreads()", &value) || value != 64)
+	return -7;
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+/* the parallel mode requires a file-based DB */
+    unlink (db_path);
+    cache = spatialite_alloc_connection ();
+    ret =
+	sqlite3_open_v2 (db_path, &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open %s: %s\n", db_path,
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1001;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -10;
+    if (!execute (handle, "BEGIN"))
+	return -11;
+    if (!populate (handle))
+	return -12;
+    if (!execute (handle, "COMMIT"))
+	return -13;
+
+/* serial statistics */
+    if (!query_int (handle, "SELECT UpdateLayerStatistics()", &value)
+	|| value != 1)
+	return -14;
+    for (i = 0; stats_queries[i] != NULL; i++)
+      {
+	  serial[i] = dump_table (handle, stats_queries[i]);
+	  if (serial[i] == NULL)
+	      return -15;
+      }
+
+/* parallel statistics must be exactly the same */
+    if (!execute
+	(handle,
+	 "UPDATE geometry_columns_statistics SET row_count = NULL, "
+	 "extent_min_x = NULL, extent_max_y = NULL"))
+	return -16;
+    if (!execute (handle, "DELETE FROM geometry_columns_field_infos"))
+	return -17;
+    if (!execute (handle, "DELETE FROM views_geometry_columns_field_infos"))
+	return -18;
+    if (!execute
+	(handle, "UPDATE views_geometry_columns_statistics SET row_count = 0"))
+	return -19;
+    if (!execute (handle, "SELECT InvalidateLayerStatistics()"))
+	return -20;
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -21;
+    if (!query_int (handle, "SELECT UpdateLayerStatistics()", &value)
+	|| value != 1)
+	return -22;
+    for (i = 0; stats_queries[i] != NULL; i++)
+      {
+	  parallel = dump_table (handle, stats_queries[i]);
+	  if (parallel == NULL)
+	      return -23;
+	  if (strcmp (serial[i], parallel) != 0)
+	    {
+		fprintf (stderr, "parallel statistics mismatch:\n%s\n%s\n",
+			 serial[i], parallel);
+		return -24;
+	    }
+	  sqlite3_free (serial[i]);
+	  sqlite3_free (parallel);
+      }
+
+/* a single table, within a pending transaction (serial fallback) */
+    if (!execute (handle, "BEGIN"))
+	return -25;
+    if (!execute (handle, "DELETE FROM lyr0 WHERE id > 1000"))
+	return -26;
+    if (!query_int (handle, "SELECT UpdateLayerStatistics('lyr0')", &value)
+	|| value != 1)
+	return -27;
+    if (!execute (handle, "COMMIT"))
+	return -28;
+    if (!query_int
+	(handle,
+	 "SELECT row_count FROM geometry_columns_statistics "
+	 "WHERE f_table_name = 'lyr0'", &value) || value != 1000)
+	return -29;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    unlink (db_path);
+#endif /* end GEOS conditional */
+
+    spatialite_shutdown ();
+    return 0;
+}
@@ -0,0 +1,355 @@
+/*
+
+ check_mbrcache_shared.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+static unsigned int seed = 12345;
+
+static int
+next_random (int range)
+{
+/* a trivial deterministic pseudo-random generator */
+    seed = seed * 1103515245 + 12345;
+    return (int) ((seed >> 8) % range);
+}
+
+static int
+create_layer (sqlite3 * handle, int count)
+{
+/* creating a table of random rectangles and its MBR cache */
+    int i;
+    int ok = 1;
+    if (!execute (handle, "CREATE TABLE lyr (id INTEGER PRIMARY KEY, g BLOB)"))
+	return 0;
+    if (!execute (handle, "BEGIN"))
+	return 0;
+    for (i = 0; i < count && ok; i++)
+      {
+	  int x = next_random (1000);
+	  int y = next_random (1000);
+	  int w = next_random (30);
+	  int h = next_random (30);
+	  char *sql = sqlite3_mprintf ("INSERT INTO lyr (g) VALUES "
+				       "(BuildMbr(%d, %d, %d, %d))",
+				       x, y, x + w, y + h);
+	  ok = execute (handle, sql);
+	  sqlite3_free (sql);
+      }
+    if (!ok || !execute (handle, "COMMIT"))
+	return 0;
+/* the same triggers created by CreateMbrCache() */
+    if (!execute
+	(handle, "CREATE VIRTUAL TABLE cache_lyr_g USING MbrCache(lyr, g)"))
+	return 0;
+    if (!execute
+	(handle,
+	 "CREATE TRIGGER gci_lyr_g AFTER INSERT ON lyr FOR EACH ROW BEGIN "
+	 "INSERT INTO cache_lyr_g (rowid, mbr) VALUES (NEW.ROWID, "
+	 "BuildMbrFilter(MbrMinX(NEW.g), MbrMinY(NEW.g), "
+	 "MbrMaxX(NEW.g), MbrMaxY(NEW.g))); END"))
+	return 0;
+    if (!execute
+	(handle,
+	 "CREATE TRIGGER gcu_lyr_g AFTER UPDATE OF g ON lyr FOR EACH ROW BEGIN "
+	 "UPDATE cache_lyr_g SET mbr = BuildMbrFilter(MbrMinX(NEW.g), "
+	 "MbrMinY(NEW.g), MbrMaxX(NEW.g), MbrMaxY(NEW.g)) "
+	 "WHERE rowid = NEW.ROWID; END"))
+	return 0;
+    if (!execute
+	(handle,
+	 "CREATE TRIGGER gcd_lyr_g AFTER DELETE ON lyr FOR EACH ROW BEGIN "
+	 "DELETE FROM cache_lyr_g WHERE rowid = OLD.ROWID; END"))
+	return 0;
+    return 1;
+}
+
+static int
+modify_layer (sqlite3 * handle, int count)
+{
+/* randomly inserting, updating and deleting rows */
+    int i;
+    int ok = 1;
+    for (i = 0; i < count && ok; i++)
+      {
+	  char *sql;
+	  int x = next_random (1000);
+	  int y = next_random (1000);
+	  int w = next_random (30);
+	  int h = next_random (30);
+	  int id = 1 + next_random (3000);
+	  switch (next_random (3))
+	    {
+	    case 0:
+		sql =
+		    sqlite3_mprintf
+		    ("INSERT INTO lyr (g) VALUES (BuildMbr(%d, %d, %d, %d))",
+		     x, y, x + w, y + h);
+		break;
+	    case 1:
+		sql =
+		    sqlite3_mprintf
+		    ("UPDATE lyr SET g = BuildMbr(%d, %d, %d, %d) "
+		     "WHERE id = %d",
+		     x, y, x + w, y + h, id);
+		break;
+	    default:
+		sql = sqlite3_mprintf ("DELETE FROM lyr WHERE id = %d", id);
+		break;
+	    };
+	  ok = execute (handle, sql);
+	  sqlite3_free (sql);
+      }
+    return ok;
+}
+
+static int
+check_cache (sqlite3 * handle)
+{
+/* comparing the MBR cache against a brute force scan of the table */
+    const char *filters[3] =
+	{ "FilterMbrWithin", "FilterMbrIntersects", "FilterMbrContains" };
+    const char *relations[3] = {
+	"MbrMinX(g) >= %d AND MbrMaxX(g) <= %d AND "
+	    "MbrMinY(g) >= %d AND MbrMaxY(g) <= %d",
+	"MbrMaxX(g) >= %d AND MbrMinX(g) <= %d AND "
+	    "MbrMaxY(g) >= %d AND MbrMinY(g) <= %d",
+	"MbrMinX(g) <= %d AND MbrMaxX(g) >= %d AND "
+	    "MbrMinY(g) <= %d AND MbrMaxY(g) >= %d"
+    };
+    int i;
+    int expected;
+    int value;
+    for (i = 0; i < 30; i++)
+      {
+	  int mode = i % 3;
+	  int x = next_random (1000);
+	  int y = next_random (1000);
+	  int w = (mode == 2) ? next_random (5) : next_random (200);
+	  int h = (mode == 2) ? next_random (5) : next_random (200);
+	  char *where =
+	      sqlite3_mprintf (relations[mode], x, x + w, y, y + h);
+	  char *sql =
+	      sqlite3_mprintf ("SELECT Count(*) FROM lyr WHERE %s", where);
+	  int ok = query_int (handle, sql, &expected);
+	  sqlite3_free (sql);
+	  if (ok)
+	    {
+		sql =
+		    sqlite3_mprintf
+		    ("SELECT Count(*) FROM lyr WHERE %s AND ROWID IN "
+		     "(SELECT rowid FROM cache_lyr_g "
+		     "WHERE mbr = %s(%d, %d, %d, %d))",
+		     where, filters[mode], x, y, x + w, y + h);
+		ok = query_int (handle, sql, &value);
+		sqlite3_free (sql);
+		if (ok && value != expected)
+		  {
+		      fprintf (stderr, "%s: expected %d, found %d\n",
+			       filters[mode], expected, value);
+		      ok = 0;
+		  }
+	    }
+	  if (ok)
+	    {
+		sql =
+		    sqlite3_mprintf
+		    ("SELECT Count(*) FROM cache_lyr_g "
+		     "WHERE mbr = %s(%d, %d, %d, %d)",
+		     filters[mode], x, y, x + w, y + h);
+		ok = query_int (handle, sql, &value);
+		sqlite3_free (sql);
+		if (ok && value != expected)
+		  {
+		      fprintf (stderr, "%s: expected %d items, found %d\n",
+			       filters[mode], expected, value);
+		      ok = 0;
+		  }
+	    }
+	  sqlite3_free (where);
+	  if (!ok)
+	      return 0;
+      }
+/* full scan and direct access by ROWID */
+    if (!query_int (handle, "SELECT Count(*) FROM lyr", &expected))
+	return 0;
+    if (!query_int (handle, "SELECT Count(*) FROM cache_lyr_g", &value))
+	return 0;
+    if (value != expected)
+      {
+	  fprintf (stderr, "full scan: expected %d, found %d\n", expected,
+		   value);
+	  return 0;
+      }
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM lyr WHERE (SELECT Count(*) "
+	 "FROM cache_lyr_g AS c WHERE c.rowid = lyr.ROWID) <> 1", &value))
+	return 0;
+    if (value != 0)
+      {
+	  fprintf (stderr, "by ROWID: %d missing items\n", value);
+	  return 0;
+      }
+    return 1;
+}
+
+static sqlite3 *
+open_db (const char *path, void *cache)
+{
+/* opening a connection */
+    sqlite3 *handle;
+    int ret = sqlite3_open_v2 (path, &handle,
+			       SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+			       NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open %s: %s\n", path,
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return NULL;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    return handle;
+}
+
+int
+main (int argc, char *argv[])
+{
+    sqlite3 *handle;
+    sqlite3 *handle2;
+    void *cache = spatialite_alloc_connection ();
+    void *cache2;
+    const char *db_path = "./mbrcache_shared.sqlite";
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+/* a private cache on an in-memory DB */
+    handle = open_db (":memory:", cache);
+    if (handle == NULL)
+	return -1000;
+    if (!create_layer (handle, 3000))
+	return -1;
+    if (!check_cache (handle))
+	return -2;
+    if (!modify_layer (handle, 800))
+	return -3;
+    if (!check_cache (handle))
+	return -4;
+/* rolling back a transaction discards its changes */
+    if (!execute (handle, "BEGIN"))
+	return -5;
+    if (!modify_layer (handle, 300))
+	return -6;
+    if (!check_cache (handle))
+	return -7;
+    if (!execute (handle, "ROLLBACK"))
+	return -8;
+    if (!check_cache (handle))
+	return -9;
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+
+/* two connections on the same DB-file share a single cache */
+    unlink (db_path);
+    cache = spatialite_alloc_connection ();
+    handle = open_db (db_path, cache);
+    if (handle == NULL)
+	return -1001;
+    if (!create_layer (handle, 3000))
+	return -10;
+    cache2 = spatialite_alloc_connection ();
+    handle2 = open_db (db_path, cache2);
+    if (handle2 == NULL)
+	return -1002;
+    if (!check_cache (handle))
+	return -11;
+    if (!check_cache (handle2))
+	return -12;
+    if (!modify_layer (handle, 500))
+	return -13;
+    if (!check_cache (handle2))
+	return -14;
+    if (!modify_layer (handle2, 500))
+	return -15;
+    if (!check_cache (handle))
+	return -16;
+    if (!execute (handle, "BEGIN"))
+	return -17;
+    if (!modify_layer (handle, 200))
+	return -18;
+    if (!execute (handle, "ROLLBACK"))
+	return -19;
+    if (!check_cache (handle2))
+	return -20;
+    if (!execute (handle2, "BEGIN"))
+	return -21;
+    if (!modify_layer (handle2, 200))
+	return -22;
+    if (!execute (handle2, "COMMIT"))
+	return -23;
+    if (!check_cache (handle))
+	return -24;
+/* the cache survives the second connection being closed */
+    sqlite3_close (handle2);
+    spatialite_cleanup_ex (cache2);
+    if (!modify_layer (handle, 300))
+	return -25;
+    if (!check_cache (handle))
+	return -26;
+
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+    unlink (db_path);
+    spatialite_shutdown ();
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*
+
+ check_quantized_blob.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2011
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Brad Hards <bradh@frogmouth.net>
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include <spatialite/gaiageo.h>
+
+struct quantized_case
+{
+    const char *sql;
+    const char *expected;
+};
+
+static int
+check_text (sqlite3 * handle, const char *sql, const char *expected)
+{
+/* checking an SQL function expected to return a text string */
+    int ret;
+    int ok = 0;
+    const char *result = "NULL";
+    sqlite3_stmt *stmt;
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    if (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  if (sqlite3_column_type (stmt, 0) != SQLITE_NULL)
+	      result = (const char *) sqlite3_column_text (stmt, 0);
+	  if (strcmp (result, expected) == 0)
+	      ok = 1;
+	  else
+	      fprintf (stderr, "%s: expected %s, got %s\n", sql, expected,
+		       result);
+      }
+    sqlite3_finalize (stmt);
+    return ok;
+}
+
+static int
+check_cases (sqlite3 * handle)
+{
+/* testing the QuantizeGeometry() SQL function */
+    int i;
+    struct quantized_case cases[] = {
+	{"SELECT AsText(QuantizeGeometry(GeomFromText('LINESTRING(1.23456 "
+	 "2.34567, 3.45678 4.56789, -0.004 10)'), 2))",
+	 "LINESTRING(1.23 2.35, 3.46 4.57, 0 10)"},
+	{"SELECT AsText(QuantizeGeometry(GeomFromText('POLYGON Z((0 0 1.111, "
+	 "10 0 2.222, 10 10 3.333, 0 0 1.111), (1 1 0, 2 1 0, 2 2 0, "
+	 "1 1 0))'), 0, 1))",
+	 "POLYGON Z((0 0 1.1, 10 0 2.2, 10 10 3.3, 0 0 1.1), "
+	 "(1 1 0, 2 1 0, 2 2 0, 1 1 0))"},
+	{"SELECT AsText(QuantizeGeometry(GeomFromText('LINESTRING M(1234 "
+	 "5678 9.99, 1250 5650 10.01)'), -2, 0, 1))",
+	 "LINESTRING M(1200 5700 10, 1300 5700 10)"},
+	{"SELECT AsText(QuantizeGeometry(GeomFromText('GEOMETRYCOLLECTION ZM("
+	 "POINT ZM(1.111 2.222 3.333 4.444), LINESTRING ZM(0.05 0.05 0.05 "
+	 "0.05, 1.04 1.04 1.04 1.04), POLYGON ZM((0 0 0 0, 1 0 0 0, 1 1 0 0, "
+	 "0 0 0 0)))'), 1))",
+	 "GEOMETRYCOLLECTION ZM(POINT ZM(1.111 2.222 3.333 4.444), "
+	 "LINESTRING ZM(0.1 0.1 0.1 0.1, 1 1 1 1), POLYGON ZM((0 0 0 0, "
+	 "1 0 0 0, 1 1 0 0, 0 0 0 0)))"},
+	{"SELECT AsEWKT(QuantizeGeometry(GeomFromText('MULTILINESTRING((1 1, "
+	 "2.5 2.5), (-7.25 3, 4 4))', 4326), 1))",
+	 "SRID=4326;MULTILINESTRING((1 1,2.5 2.5),(-7.3 3,4 4))"},
+	{"SELECT AsText(QuantizeGeometry(GeomFromText('POINT(1.23456 7)'), 2))",
+	 "POINT(1.23456 7)"},
+	{"SELECT MbrMaxX(QuantizeGeometry(GeomFromText('LINESTRING(0.004 0, "
+	 "1.006 1)'), 2)) = 1.01", "1"},
+	{"SELECT IsCompressedGeometryBlob(QuantizeGeometry(GeomFromText("
+	 "'POLYGON((0 0, 1 0, 1 1, 0 0))'), 3))", "1"},
+	{"SELECT IsCompressedGeometryBlob(QuantizeGeometry(GeomFromText("
+	 "'MULTIPOLYGON(((0 0, 1 0, 1 1, 0 0)), ((5 5, 6 5, 6 6, 5 5)))'), 3))",
+	 "1"},
+	{"SELECT IsCompressedGeometryBlob(UncompressGeometry(QuantizeGeometry("
+	 "GeomFromText('LINESTRING(0 0, 1 1)'), 3)))", "0"},
+	{"SELECT ST_NPoints(QuantizeGeometry(GeomFromText('MULTIPOLYGON(((0 0, "
+	 "1 0, 1 1, 0 0)), ((5 5, 6 5, 6 6, 5 5), (5.1 5.1, 5.2 5.1, 5.2 5.2, "
+	 "5.1 5.1)))'), 6))", "12"},
+	{"SELECT QuantizeGeometry(GeomFromText('LINESTRING(0 0, 1 1)'), 16)",
+	 "NULL"},
+	{"SELECT QuantizeGeometry(GeomFromText('LINESTRING(1e10 0, 1 1)'), "
+	 "10)", "NULL"},
+	{"SELECT QuantizeGeometry(GeomFromText('LINESTRING(0 0, 1 1)'), '2')",
+	 "NULL"},
+	{NULL, NULL}
+    };
+
+    for (i = 0; cases[i].sql != NULL; i++)
+      {
+	  if (!check_text (handle, cases[i].sql, cases[i].expected))
+	      return -(10 + i);
+      }
+    return 0;
+}
+
+static int
+check_size ()
+{
+/* a long LINESTRING: quantized vs compressed BLOB size */
+    gaiaGeomCollPtr geom = gaiaAllocGeomColl ();
+    gaiaGeomCollPtr geom2;
+    gaiaLinestringPtr ln = gaiaAddLinestringToGeomColl (geom, 1000);
+    unsigned char *blob;
+    unsigned char *compressed;
+    int size;
+    int compressed_size;
+    int iv;
+    double x;
+    double y;
+    int ret = 0;
+
+    for (iv = 0; iv < 1000; iv++)
+	gaiaSetPoint (ln->Coords, iv, 11.0 + (iv * 0.000137),
+		      45.0 - (iv * 0.000071));
+    gaiaMbrGeometry (geom);
+    gaiaToCompressedBlobWkb (geom, &compressed, &compressed_size);
+    free (compressed);
+    if (!gaiaToQuantizedBlobWkb (geom, 6, 6, 6, &blob, &size))
+      {
+	  fprintf (stderr, "unable to build a quantized BLOB\n");
+	  gaiaFreeGeomColl (geom);
+	  return -1;
+      }
+    gaiaFreeGeomColl (geom);
+    if (size * 5 > compressed_size * 3)
+      {
+	  fprintf (stderr, "unexpected quantized size %d (compressed %d)\n",
+		   size, compressed_size);
+	  free (blob);
+	  return -2;
+      }
+    geom2 = gaiaFromSpatiaLiteBlobWkb (blob, size);
+    free (blob);
+    if (geom2 == NULL || geom2->FirstLinestring == NULL
+	|| geom2->FirstLinestring->Points != 1000)
+      {
+	  fprintf (stderr, "unable to decode a quantized BLOB\n");
+	  gaiaFreeGeomColl (geom2);
+	  return -3;
+      }
+    for (iv = 0; iv < 1000; iv++)
+      {
+	  gaiaGetPoint (geom2->FirstLinestring->Coords, iv, &x, &y);
+	  if (x < 11.0 + (iv * 0.000137) - 0.0000005
+	      || x > 11.0 + (iv * 0.000137) + 0.0000005
+	      || y < 45.0 - (iv * 0.000071) - 0.0000005
+	      || y > 45.0 - (iv * 0.000071) + 0.0000005)
+	    {
+		fprintf (stderr, "unexpected vertex #%d: %1.17g %1.17g\n", iv,
+			 x, y);
+		ret = -4;
+		break;
+	    }
+      }
+    gaiaFreeGeomColl (geom2);
+    return ret;
+}
+
+static int
+check_rings (gaiaGeomCollPtr geom)
+{
+/* checking that no decoded RING has less than 4 points */
+    gaiaPolygonPtr pg;
+    int ib;
+    if (geom == NULL)
+	return 1;
+    for (pg = geom->FirstPolygon; pg != NULL; pg = pg->Next)
+      {
+	  if (pg->Exterior->Points < 4)
+	      return 0;
+	  for (ib = 0; ib < pg->NumInteriors; ib++)
+	    {
+		if ((pg->Interiors + ib)->Points < 4)
+		    return 0;
+	    }
+      }
+    return 1;
+}
+
+static int
+check_truncated ()
+{
+/* truncated or damaged quantized BLOBs must be safely handled */
+    gaiaGeomCollPtr geom;
+    unsigned char *blob;
+    unsigned char *copy;
+    int size;
+    int len;
+    int i;
+    int ret = 0;
+    const char *wkt =
+	"GEOMETRYCOLLECTION Z(POINT Z(1 2 3), LINESTRING Z(0 0 0, "
+	"1000.5 -2000.25 7, 3 3 3), POLYGON Z((0 0 0, 10 0 0, 10 10 0, "
+	"0 0 0), (1 1 0, 2 1 0, 2 2 0, 1 1 0)))";
+
+    geom = gaiaParseWkt ((const unsigned char *) wkt, -1);
+    if (geom == NULL)
+	return -1;
+    if (!gaiaToQuantizedBlobWkb (geom, 2, 2, 2, &blob, &size))
+      {
+	  gaiaFreeGeomColl (geom);
+	  return -2;
+      }
+    gaiaFreeGeomColl (geom);
+    copy = malloc (size);
+    for (len = 45; len <= size; len++)
+      {
+	  memcpy (copy, blob, len);
+	  copy[len - 1] = GAIA_MARK_END;
+	  geom = gaiaFromSpatiaLiteBlobWkb (copy, len);
+	  if (!check_rings (geom))
+	    {
+		fprintf (stderr, "truncated BLOB (%d bytes): invalid ring\n",
+			 len);
+		ret = -3;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    for (i = 47; i < size - 1; i++)
+      {
+	  memcpy (copy, blob, size);
+	  copy[i] = 0xff;
+	  geom = gaiaFromSpatiaLiteBlobWkb (copy, size);
+	  if (!check_rings (geom))
+	    {
+		fprintf (stderr, "damaged BLOB (byte #%d): invalid ring\n", i);
+		ret = -4;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    free (copy);
+    free (blob);
+    return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret = check_size ();
+    if (ret != 0)
+	return ret;
+    ret = check_truncated ();
+    if (ret != 0)
+	return ret - 5;
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    ret = check_cases (handle);
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return ret;
+}
@@ -0,0 +1,392 @@
+/*
+
+ check_routing_ch.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+
+#define GRID_SIDE	12
+
+static int
+create_grid (sqlite3 * handle)
+{
+/* creating a grid-shaped input network with pseudo-random costs */
+    int ret;
+    int x;
+    int y;
+    int id = 0;
+    unsigned int seed = 12345;
+    sqlite3_stmt *stmt;
+    const char *sql;
+    if (!execute
+	(handle,
+	 "CREATE TABLE roads (id INTEGER PRIMARY KEY, node_from INTEGER, "
+	 "node_to INTEGER, cost DOUBLE, oneway_ft INTEGER, oneway_tf INTEGER, "
+	 "road_name TEXT)"))
+	return 0;
+    sql = "INSERT INTO roads VALUES (?, ?, ?, ?, ?, ?, 'road')";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    execute (handle, "BEGIN");
+    for (y = 0; y < GRID_SIDE; y++)
+      {
+	  for (x = 0; x < GRID_SIDE; x++)
+	    {
+		int node = (y * GRID_SIDE) + x + 1;
+		int dir;
+		for (dir = 0; dir < 2; dir++)
+		  {
+		      int next;
+		      int oneway;
+		      if (dir == 0 && x == GRID_SIDE - 1)
+			  continue;
+		      if (dir == 1 && y == GRID_SIDE - 1)
+			  continue;
+		      next = (dir == 0) ? node + 1 : node + GRID_SIDE;
+		      seed = (seed * 1103515245) + 12345;
+		      oneway = (seed >> 16) % 7;
+		      seed = (seed * 1103515245) + 12345;
+		      sqlite3_reset (stmt);
+		      sqlite3_clear_bindings (stmt);
+		      sqlite3_bind_int (stmt, 1, ++id);
+		      sqlite3_bind_int (stmt, 2, node);
+		      sqlite3_bind_int (stmt, 3, next);
+		      sqlite3_bind_double (stmt, 4,
+					   1.0 + ((seed >> 16) % 100) / 10.0);
+		      sqlite3_bind_int (stmt, 5, (oneway == 1) ? 0 : 1);
+		      sqlite3_bind_int (stmt, 6, (oneway == 2) ? 0 : 1);
+		      ret = sqlite3_step (stmt);
+		      if (ret != SQLITE_DONE)
+			{
+			    fprintf (stderr, "INSERT roads: %s\n",
+				     sqlite3_errmsg (handle));
+			    sqlite3_finalize (stmt);
+			    return 0;
+			}
+		  }
+	    }
+      }
+    sqlite3_finalize (stmt);
+    execute (handle, "COMMIT");
+    return 1;
+}
+
+static int
+route_cost (sqlite3_stmt * stmt, int from, int to, const char *algorithm,
+	    double *cost)
+{
+/* 
+/ querying a Shortest Path: returns the total cost (-1.0 if unreachable)
+/ after checking that it matches the cost of the returned links
+*/
+    int ret;
+    int first = 1;
+    double links = 0.0;
+    *cost = -1.0;
+    sqlite3_reset (stmt);
+    sqlite3_clear_bindings (stmt);
+    sqlite3_bind_int (stmt, 1, from);
+    sqlite3_bind_int (stmt, 2, to);
+    while (1)
+      {
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW)
+	      return 0;
+	  if (first)
+	    {
+		if (strcmp
+		    ((const char *) sqlite3_column_text (stmt, 0),
+		     algorithm) != 0)
+		  {
+		      fprintf (stderr, "unexpected Algorithm \"%s\"\n",
+			       sqlite3_column_text (stmt, 0));
+		      return 0;
+		  }
+		if (sqlite3_column_type (stmt, 2) == SQLITE_FLOAT)
+		    *cost = sqlite3_column_double (stmt, 2);
+		first = 0;
+	    }
+	  else
+	      links += sqlite3_column_double (stmt, 2);
+      }
+    if (*cost >= 0.0 && fabs (*cost - links) > 0.0000001)
+      {
+	  fprintf (stderr, "%d -> %d: total %1.6f links %1.6f\n", from, to,
+		   *cost, links);
+	  return 0;
+      }
+    return 1;
+}
+
+static double *
+reference_costs (sqlite3 * handle)
+{
+/* computing the exact all-pairs Shortest Path costs (Floyd-Warshall) */
+    int ret;
+    int i;
+    int j;
+    int k;
+    int n = GRID_SIDE * GRID_SIDE;
+    double *dist;
+    sqlite3_stmt *stmt;
+    const char *sql =
+	"SELECT node_from, node_to, cost, oneway_ft, oneway_tf FROM roads";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return NULL;
+      }
+    dist = malloc (sizeof (double) * n * n);
+    for (i = 0; i < n * n; i++)
+	dist[i] = -1.0;
+    for (i = 0; i < n; i++)
+	dist[(i * n) + i] = 0.0;
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  int from = sqlite3_column_int (stmt, 0) - 1;
+	  int to = sqlite3_column_int (stmt, 1) - 1;
+	  double cost = sqlite3_column_double (stmt, 2);
+	  if (sqlite3_column_int (stmt, 3))
+	      dist[(from * n) + to] = cost;
+	  if (sqlite3_column_int (stmt, 4))
+	      dist[(to * n) + from] = cost;
+      }
+    sqlite3_finalize (stmt);
+    for (k = 0; k < n; k++)
+      {
+	  for (i = 0; i < n; i++)
+	    {
+		if (dist[(i * n) + k] < 0.0)
+		    continue;
+		for (j = 0; j < n; j++)
+		  {
+		      double d;
+		      if (dist[(k * n) + j] < 0.0)
+			  continue;
+		      d = dist[(i * n) + k] + dist[(k * n) + j];
+		      if (dist[(i * n) + j] < 0.0 || d < dist[(i * n) + j])
+			  dist[(i * n) + j] = d;
+		  }
+	    }
+      }
+    return dist;
+}
+
+static int
+compare_routes (sqlite3 * handle)
+{
+/* comparing the CH Shortest Paths against the exact reference costs */
+    int ret;
+    int from;
+    int to;
+    int n = GRID_SIDE * GRID_SIDE;
+    double ch;
+    double expected;
+    int reachable = 0;
+    double *dist;
+    sqlite3_stmt *stmt;
+    const char *sql =
+	"SELECT Algorithm, LinkRowid, Cost FROM ch_route "
+	"WHERE NodeFrom = ? AND NodeTo = ?";
+    if (!execute (handle, "UPDATE ch_route SET Algorithm = 'CH'"))
+	return 0;
+    dist = reference_costs (handle);
+    if (dist == NULL)
+	return 0;
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  free (dist);
+	  return 0;
+      }
+    for (from = 1; from <= n; from += 3)
+      {
+	  for (to = 1; to <= n; to += 2)
+	    {
+		if (from == to)
+		    continue;
+		if (!route_cost (stmt, from, to, "CH", &ch))
+		    goto error;
+		expected = dist[((from - 1) * n) + (to - 1)];
+		if (fabs (expected - ch) > 0.0000001)
+		  {
+		      fprintf (stderr, "%d -> %d: expected %1.6f CH %1.6f\n",
+			       from, to, expected, ch);
+		      goto error;
+		  }
+		if (ch > 0.0)
+		    reachable++;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    free (dist);
+    if (reachable == 0)
+      {
+	  fprintf (stderr, "no reachable destination at all\n");
+	  return 0;
+      }
+    return 1;
+  error:
+    sqlite3_finalize (stmt);
+    free (dist);
+    return 0;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    char *err_msg = NULL;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    sqlite3_stmt *stmt;
+    double cost;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+/* invalid contraction-hierarchies argument */
+    ret =
+	sqlite3_exec (handle,
+		      "SELECT CreateRouting('ch_data', 'ch_route', 'roads', "
+		      "'node_from', 'node_to', NULL, 'cost', NULL, 0, 1, "
+		      "NULL, NULL, 0, 'yes')", NULL, NULL, &err_msg);
+    if (ret == SQLITE_OK)
+      {
+	  fprintf (stderr, "CreateRouting: invalid argument accepted\n");
+	  return -1;
+      }
+    sqlite3_free (err_msg);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!create_grid (handle))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT CreateRouting('plain_data', 'plain_route', 'roads', "
+	 "'node_from', 'node_to', NULL, 'cost', 'road_name', 0, 1, "
+	 "'oneway_ft', 'oneway_tf', 0, 0)"))
+	return -3;
+    if (!execute
+	(handle,
+	 "SELECT CreateRouting('ch_data', 'ch_route', 'roads', "
+	 "'node_from', 'node_to', NULL, 'cost', 'road_name', 0, 1, "
+	 "'oneway_ft', 'oneway_tf', 0, 1)"))
+	return -4;
+
+/* the CH blocks are stored next to the plain Nodes blocks */
+    ret =
+	sqlite3_prepare_v2 (handle,
+			    "SELECT (SELECT Count(*) FROM ch_data) > "
+			    "(SELECT Count(*) FROM plain_data)", -1, &stmt,
+			    NULL);
+    if (ret != SQLITE_OK)
+	return -5;
+    if (sqlite3_step (stmt) != SQLITE_ROW || sqlite3_column_int (stmt, 0) != 1)
+	return -6;
+    sqlite3_finalize (stmt);
+
+/* CH must always return the exact Shortest Path */
+    if (!compare_routes (handle))
+	return -7;
+
+/* a network without CH silently falls back to Dijkstra */
+    if (!execute (handle, "UPDATE plain_route SET Algorithm = 'CH'"))
+	return -8;
+    ret =
+	sqlite3_prepare_v2 (handle,
+			    "SELECT Algorithm, LinkRowid, Cost FROM plain_route "
+			    "WHERE NodeFrom = ? AND NodeTo = ?", -1, &stmt,
+			    NULL);
+    if (ret != SQLITE_OK)
+	return -9;
+    if (!route_cost (stmt, 1, GRID_SIDE * GRID_SIDE, "Dijkstra", &cost))
+	return -10;
+    sqlite3_finalize (stmt);
+    if (cost <= 0.0)
+	return -11;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
@@ -0,0 +1,455 @@
+/*
+
+ check_routing_graph_file.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+
+#define GRID_SIDE	10
+#define PLAIN_GRAPH	"routing_plain.graph"
+#define CH_GRAPH	"routing_ch.graph"
+#define PATCHED_GRAPH	"routing_patched.graph"
+#define BROKEN_GRAPH	"routing_broken.graph"
+
+static int
+create_grid (sqlite3 * handle)
+{
+/* creating a grid-shaped input network with pseudo-random costs */
+    int ret;
+    int x;
+    int y;
+    int id = 0;
+    unsigned int seed = 67890;
+    sqlite3_stmt *stmt;
+    const char *sql;
+    if (!execute
+	(handle,
+	 "CREATE TABLE roads (id INTEGER PRIMARY KEY, node_from INTEGER, "
+	 "node_to INTEGER, cost DOUBLE, road_name TEXT)"))
+	return 0;
+    sql = "INSERT INTO roads VALUES (?, ?, ?, ?, 'road')";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    execute (handle, "BEGIN");
+    for (y = 0; y < GRID_SIDE; y++)
+      {
+	  for (x = 0; x < GRID_SIDE; x++)
+	    {
+		int node = (y * GRID_SIDE) + x + 1;
+		int dir;
+		for (dir = 0; dir < 2; dir++)
+		  {
+		      if (dir == 0 && x == GRID_SIDE - 1)
+			  continue;
+		      if (dir == 1 && y == GRID_SIDE - 1)
+			  continue;
+		      seed = (seed * 1103515245) + 12345;
+		      sqlite3_reset (stmt);
+		      sqlite3_clear_bindings (stmt);
+		      sqlite3_bind_int (stmt, 1, ++id);
+		      sqlite3_bind_int (stmt, 2, node);
+		      sqlite3_bind_int (stmt, 3,
+					(dir == 0) ? node + 1 : node + GRID_SIDE);
+		      /* Link #1 (1 -> 2) gets a unique, recognizable cost */
+		      sqlite3_bind_double (stmt, 4,
+					   (id == 1) ? 123.456 : 1.0 +
+					   ((seed >> 16) % 100) / 10.0);
+		      ret = sqlite3_step (stmt);
+		      if (ret != SQLITE_DONE)
+			{
+			    fprintf (stderr, "INSERT roads: %s\n",
+				     sqlite3_errmsg (handle));
+			    sqlite3_finalize (stmt);
+			    return 0;
+			}
+		  }
+	    }
+      }
+    sqlite3_finalize (stmt);
+    execute (handle, "COMMIT");
+    return 1;
+}
+
+static int
+create_routing (sqlite3 * handle, const char *prefix, int ch, int overwrite)
+{
+/* creating a Routing Data table */
+    int ok;
+    char *sql =
+	sqlite3_mprintf ("SELECT CreateRouting('%s_data', '%s_route', "
+			 "'roads', 'node_from', 'node_to', NULL, 'cost', "
+			 "'road_name', 0, 1, NULL, NULL, %d, %d)", prefix,
+			 prefix, overwrite, ch);
+    ok = execute (handle, sql);
+    sqlite3_free (sql);
+    return ok;
+}
+
+static int
+route_cost (sqlite3 * handle, const char *table, const char *algorithm,
+	    int from, int to, double *cost)
+{
+/* querying the total cost of a Shortest Path (-1.0 if unreachable) */
+    int ret;
+    char *sql;
+    sqlite3_stmt *stmt;
+    *cost = -1.0;
+    sql = sqlite3_mprintf ("UPDATE \"%s\" SET Algorithm = '%s'", table,
+			   algorithm);
+    ret = execute (handle, sql);
+    sqlite3_free (sql);
+    if (!ret)
+	return 0;
+    sql =
+	sqlite3_mprintf ("SELECT Algorithm, Cost FROM \"%s\" "
+			 "WHERE NodeFrom = %d AND NodeTo = %d", table, from,
+			 to);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", table, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW)
+      {
+	  if (strcmp
+	      ((const char *) sqlite3_column_text (stmt, 0), algorithm) != 0)
+	    {
+		fprintf (stderr, "%s: unexpected Algorithm \"%s\"\n", table,
+			 sqlite3_column_text (stmt, 0));
+		sqlite3_finalize (stmt);
+		return 0;
+	    }
+	  if (sqlite3_column_type (stmt, 1) == SQLITE_FLOAT)
+	      *cost = sqlite3_column_double (stmt, 1);
+      }
+    sqlite3_finalize (stmt);
+    return (ret == SQLITE_ROW || ret == SQLITE_DONE) ? 1 : 0;
+}
+
+static int
+compare_routes (sqlite3 * handle, const char *decoded, const char *mapped,
+		const char *algorithm)
+{
+/* the mapped network must return exactly the same Shortest Paths */
+    int from;
+    int to;
+    int n = GRID_SIDE * GRID_SIDE;
+    double cost1;
+    double cost2;
+    for (from = 1; from <= n; from += 7)
+      {
+	  for (to = 1; to <= n; to += 3)
+	    {
+		if (from == to)
+		    continue;
+		if (!route_cost (handle, decoded, algorithm, from, to, &cost1))
+		    return 0;
+		if (!route_cost (handle, mapped, algorithm, from, to, &cost2))
+		    return 0;
+		if (cost1 <= 0.0 || cost1 != cost2)
+		  {
+		      fprintf (stderr, "%s %d -> %d: %1.6f %s %1.6f\n",
+			       algorithm, from, to, cost1, mapped, cost2);
+		      return 0;
+		  }
+	    }
+      }
+    return 1;
+}
+
+static unsigned char *
+read_file (const char *path, long *size)
+{
+/* loading a whole file in memory */
+    unsigned char *buf;
+    FILE *in = fopen (path, "rb");
+    if (in == NULL)
+	return NULL;
+    fseek (in, 0, SEEK_END);
+    *size = ftell (in);
+    fseek (in, 0, SEEK_SET);
+    buf = malloc (*size);
+    if (fread (buf, 1, *size, in) != (size_t) * size)
+      {
+	  free (buf);
+	  buf = NULL;
+      }
+    fclose (in);
+    return buf;
+}
+
+static int
+write_file (const char *path, const unsigned char *buf, long size)
+{
+/* storing a memory buffer into a file */
+    int ok;
+    FILE *out = fopen (path, "wb");
+    if (out == NULL)
+	return 0;
+    ok = (fwrite (buf, 1, size, out) == (size_t) size);
+    fclose (out);
+    return ok;
+}
+
+static int
+patch_graph (const char *path, const char *patched, const char *broken)
+{
+/* 
+/ creating a patched copy of a Routing Graph file (changing the cost of
+/ Link #1) and a truncated copy
+*/
+    long size;
+    long i;
+    int count = 0;
+    double old_cost = 123.456;
+    double new_cost = 0.5;
+    unsigned char *buf = read_file (path, &size);
+    if (buf == NULL)
+	return 0;
+    for (i = 0; i + 8 <= size; i++)
+      {
+	  if (memcmp (buf + i, &old_cost, 8) == 0)
+	    {
+		memcpy (buf + i, &new_cost, 8);
+		count++;
+	    }
+      }
+    if (count == 0 || !write_file (patched, buf, size)
+	|| !write_file (broken, buf, size / 2))
+      {
+	  free (buf);
+	  return 0;
+      }
+    free (buf);
+    return 1;
+}
+
+static void
+remove_graphs ()
+{
+/* removing all Routing Graph files */
+    remove (PLAIN_GRAPH);
+    remove (CH_GRAPH);
+    remove (PATCHED_GRAPH);
+    remove (BROKEN_GRAPH);
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    char *err_msg = NULL;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    double cost;
+    double decoded;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+/* writing files requires SPATIALITE_SECURITY=relaxed */
+    if (getenv ("SPATIALITE_SECURITY") == NULL)
+      {
+	  ret =
+	      sqlite3_exec (handle,
+			    "SELECT CreateRoutingGraphFile('net_data', "
+			    "'net.graph')", NULL, NULL, &err_msg);
+	  if (ret == SQLITE_OK)
+	    {
+		fprintf (stderr, "CreateRoutingGraphFile: unexpected success\n");
+		return -1;
+	    }
+	  sqlite3_free (err_msg);
+      }
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    remove_graphs ();
+    if (!create_grid (handle))
+	return -2;
+    if (!create_routing (handle, "plain", 0, 0))
+	return -3;
+    if (!create_routing (handle, "ch", 1, 0))
+	return -4;
+
+/* exporting the Routing Graph files */
+    if (gaia_create_routing_graph_file (handle, cache, "missing", PLAIN_GRAPH))
+      {
+	  fprintf (stderr, "missing Routing Data: unexpected success\n");
+	  return -5;
+      }
+    if (gaia_create_routing_get_last_error (cache) == NULL)
+	return -6;
+    if (!gaia_create_routing_graph_file (handle, cache, "plain_data",
+					 PLAIN_GRAPH))
+      {
+	  fprintf (stderr, "plain Graph file: %s\n",
+		   gaia_create_routing_get_last_error (cache));
+	  return -7;
+      }
+    if (!gaia_create_routing_graph_file (handle, cache, "ch_data", CH_GRAPH))
+      {
+	  fprintf (stderr, "CH Graph file: %s\n",
+		   gaia_create_routing_get_last_error (cache));
+	  return -8;
+      }
+
+/* the mapped network must behave exactly as the decoded one */
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE ch_mapped USING VirtualRouting(ch_data, '"
+	 CH_GRAPH "')"))
+	return -9;
+    if (!compare_routes (handle, "ch_route", "ch_mapped", "Dijkstra"))
+	return -10;
+    if (!compare_routes (handle, "ch_route", "ch_mapped", "CH"))
+	return -11;
+    if (!compare_routes (handle, "ch_route", "ch_mapped", "Dijkstra"))
+	return -12;
+
+/* queries are really served by the file content */
+    if (!patch_graph (PLAIN_GRAPH, PATCHED_GRAPH, BROKEN_GRAPH))
+	return -13;
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE patched USING VirtualRouting(plain_data, '"
+	 PATCHED_GRAPH "')"))
+	return -14;
+    if (!route_cost (handle, "patched", "Dijkstra", 1, 2, &cost))
+	return -15;
+    if (cost != 0.5)
+      {
+	  fprintf (stderr, "patched Graph file: unexpected cost %1.6f\n",
+		   cost);
+	  return -16;
+      }
+    if (!route_cost (handle, "plain_route", "Dijkstra", 1, 2, &decoded))
+	return -17;
+    if (decoded <= 0.5)
+	return -18;
+
+/* mismatching, truncated or missing files fall back to decoding */
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE mismatch USING VirtualRouting(ch_data, '"
+	 PATCHED_GRAPH "')"))
+	return -19;
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE broken USING VirtualRouting(ch_data, '"
+	 BROKEN_GRAPH "')"))
+	return -20;
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE nofile USING VirtualRouting(ch_data, "
+	 "'no_such_file.graph')"))
+	return -21;
+    if (!compare_routes (handle, "ch_route", "mismatch", "CH"))
+	return -22;
+    if (!compare_routes (handle, "ch_route", "broken", "CH"))
+	return -23;
+    if (!compare_routes (handle, "ch_route", "nofile", "Dijkstra"))
+	return -24;
+
+/* a rebuilt Routing Data table invalidates the file */
+    if (!execute (handle, "DROP TABLE patched"))
+	return -25;
+    if (!execute (handle, "UPDATE roads SET cost = 99.0 WHERE id = 1"))
+	return -26;
+    if (!create_routing (handle, "plain", 0, 1))
+	return -27;
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE patched USING VirtualRouting(plain_data, '"
+	 PATCHED_GRAPH "')"))
+	return -28;
+    if (!route_cost (handle, "patched", "Dijkstra", 1, 2, &cost))
+	return -29;
+    if (cost != decoded)
+      {
+	  fprintf (stderr, "stale Graph file: unexpected cost %1.6f\n", cost);
+	  return -30;
+      }
+    remove_graphs ();
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
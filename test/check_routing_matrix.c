@@ -0,0 +1,402 @@
+/*
+
+ check_routing_matrix.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+
+#define GRID_SIDE	12
+
+static int
+create_grid (sqlite3 * handle)
+{
+/* creating a grid-shaped input network with pseudo-random costs */
+    int ret;
+    int x;
+    int y;
+    int id = 0;
+    unsigned int seed = 12345;
+    sqlite3_stmt *stmt;
+    const char *sql;
+    if (!execute
+	(handle,
+	 "CREATE TABLE roads (id INTEGER PRIMARY KEY, node_from INTEGER, "
+	 "node_to INTEGER, cost DOUBLE, oneway_ft INTEGER, oneway_tf INTEGER, "
+	 "road_name TEXT)"))
+	return 0;
+    sql = "INSERT INTO roads VALUES (?, ?, ?, ?, ?, ?, 'road')";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    execute (handle, "BEGIN");
+    for (y = 0; y < GRID_SIDE; y++)
+      {
+	  for (x = 0; x < GRID_SIDE; x++)
+	    {
+		int node = (y * GRID_SIDE) + x + 1;
+		int dir;
+		for (dir = 0; dir < 2; dir++)
+		  {
+		      int next;
+		      int oneway;
+		      if (dir == 0 && x == GRID_SIDE - 1)
+			  continue;
+		      if (dir == 1 && y == GRID_SIDE - 1)
+			  continue;
+		      next = (dir == 0) ? node + 1 : node + GRID_SIDE;
+		      seed = (seed * 1103515245) + 12345;
+		      oneway = (seed >> 16) % 7;
+		      seed = (seed * 1103515245) + 12345;
+		      sqlite3_reset (stmt);
+		      sqlite3_clear_bindings (stmt);
+		      sqlite3_bind_int (stmt, 1, ++id);
+		      sqlite3_bind_int (stmt, 2, node);
+		      sqlite3_bind_int (stmt, 3, next);
+		      sqlite3_bind_double (stmt, 4,
+					   1.0 + ((seed >> 16) % 100) / 10.0);
+		      sqlite3_bind_int (stmt, 5, (oneway == 1) ? 0 : 1);
+		      sqlite3_bind_int (stmt, 6, (oneway == 2) ? 0 : 1);
+		      ret = sqlite3_step (stmt);
+		      if (ret != SQLITE_DONE)
+			{
+			    fprintf (stderr, "INSERT roads: %s\n",
+				     sqlite3_errmsg (handle));
+			    sqlite3_finalize (stmt);
+			    return 0;
+			}
+		  }
+	    }
+      }
+    sqlite3_finalize (stmt);
+    execute (handle, "COMMIT");
+    return 1;
+}
+
+static double *
+reference_costs (sqlite3 * handle)
+{
+/* computing the exact all-pairs Shortest Path costs (Floyd-Warshall) */
+    int ret;
+    int i;
+    int j;
+    int k;
+    int n = GRID_SIDE * GRID_SIDE;
+    double *dist;
+    sqlite3_stmt *stmt;
+    const char *sql =
+	"SELECT node_from, node_to, cost, oneway_ft, oneway_tf FROM roads";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return NULL;
+      }
+    dist = malloc (sizeof (double) * n * n);
+    for (i = 0; i < n * n; i++)
+	dist[i] = -1.0;
+    for (i = 0; i < n; i++)
+	dist[(i * n) + i] = 0.0;
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  int from = sqlite3_column_int (stmt, 0) - 1;
+	  int to = sqlite3_column_int (stmt, 1) - 1;
+	  double cost = sqlite3_column_double (stmt, 2);
+	  if (sqlite3_column_int (stmt, 3))
+	      dist[(from * n) + to] = cost;
+	  if (sqlite3_column_int (stmt, 4))
+	      dist[(to * n) + from] = cost;
+      }
+    sqlite3_finalize (stmt);
+    for (k = 0; k < n; k++)
+      {
+	  for (i = 0; i < n; i++)
+	    {
+		if (dist[(i * n) + k] < 0.0)
+		    continue;
+		for (j = 0; j < n; j++)
+		  {
+		      double d;
+		      if (dist[(k * n) + j] < 0.0)
+			  continue;
+		      d = dist[(i * n) + k] + dist[(k * n) + j];
+		      if (dist[(i * n) + j] < 0.0 || d < dist[(i * n) + j])
+			  dist[(i * n) + j] = d;
+		  }
+	    }
+      }
+    return dist;
+}
+
+static int
+compare_matrix (sqlite3 * handle, const char *table, const char *algorithm,
+		const double *dist)
+{
+/* comparing a Cost Matrix against the exact reference costs */
+    int ret;
+    int rows = 0;
+    int n = GRID_SIDE * GRID_SIDE;
+    int n_from = 0;
+    int n_to = 0;
+    int origins[GRID_SIDE * GRID_SIDE];
+    int destinations[GRID_SIDE * GRID_SIDE + 1];
+    char *from_list;
+    char *to_list;
+    char *sql;
+    char *prev;
+    int i;
+    sqlite3_stmt *stmt;
+
+/* preparing the origins and destinations lists */
+    from_list = sqlite3_mprintf ("");
+    for (i = 1; i <= n; i += 5)
+      {
+	  origins[n_from++] = i;
+	  prev = from_list;
+	  from_list = sqlite3_mprintf ("%s%s%d", prev, (i == 1) ? "" : ",", i);
+	  sqlite3_free (prev);
+      }
+    to_list = sqlite3_mprintf ("");
+    for (i = 2; i <= n; i += 3)
+      {
+	  destinations[n_to++] = i;
+	  prev = to_list;
+	  to_list = sqlite3_mprintf ("%s%s%d", prev, (i == 2) ? "" : ",", i);
+	  sqlite3_free (prev);
+      }
+/* an undefined destination */
+    destinations[n_to++] = 99999;
+    prev = to_list;
+    to_list = sqlite3_mprintf ("%s,99999", prev);
+    sqlite3_free (prev);
+
+    sql =
+	sqlite3_mprintf ("UPDATE \"%s\" SET Algorithm = '%s', "
+			 "Request = 'Matrix'", table, algorithm);
+    ret = execute (handle, sql);
+    sqlite3_free (sql);
+    if (!ret)
+	goto error;
+    sql =
+	sqlite3_mprintf ("SELECT Algorithm, Request, RouteId, RouteRow, "
+			 "NodeFrom, NodeTo, Cost, Role FROM \"%s\" "
+			 "WHERE NodeFrom = %Q AND NodeTo = %Q", table,
+			 from_list, to_list);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", table, sqlite3_errmsg (handle));
+	  goto error;
+      }
+    while (1)
+      {
+	  int route_id;
+	  int route_row;
+	  int from;
+	  int to;
+	  double expected;
+	  const char *role;
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW)
+	    {
+		fprintf (stderr, "%s: %s\n", table, sqlite3_errmsg (handle));
+		goto stmt_error;
+	    }
+	  if (rows == 0)
+	    {
+		if (strcmp
+		    ((const char *) sqlite3_column_text (stmt, 0),
+		     algorithm) != 0
+		    || strcmp ((const char *) sqlite3_column_text (stmt, 1),
+			       "Matrix") != 0)
+		  {
+		      fprintf (stderr, "%s: unexpected %s %s\n", table,
+			       sqlite3_column_text (stmt, 0),
+			       sqlite3_column_text (stmt, 1));
+		      goto stmt_error;
+		  }
+	    }
+	  route_id = sqlite3_column_int (stmt, 2);
+	  route_row = sqlite3_column_int (stmt, 3);
+	  from = sqlite3_column_int (stmt, 4);
+	  to = sqlite3_column_int (stmt, 5);
+	  role = (const char *) sqlite3_column_text (stmt, 7);
+	  if (route_id != rows / n_to || route_row != rows % n_to
+	      || from != origins[route_id] || to != destinations[route_row])
+	    {
+		fprintf (stderr, "%s: unexpected cell #%d (%d -> %d)\n", table,
+			 rows, from, to);
+		goto stmt_error;
+	    }
+	  rows++;
+	  if (to == 99999)
+	    {
+		if (strcmp (role, "Undefined NodeTo") != 0
+		    || sqlite3_column_type (stmt, 6) != SQLITE_NULL)
+		  {
+		      fprintf (stderr, "%s: %d -> %d unexpected %s\n", table,
+			       from, to, role);
+		      goto stmt_error;
+		  }
+		continue;
+	    }
+	  expected = dist[((from - 1) * n) + (to - 1)];
+	  if (expected < 0.0)
+	    {
+		if (strcmp (role, "Unreachable NodeTo") != 0
+		    || sqlite3_column_type (stmt, 6) != SQLITE_NULL)
+		  {
+		      fprintf (stderr, "%s: %d -> %d should be unreachable\n",
+			       table, from, to);
+		      goto stmt_error;
+		  }
+		continue;
+	    }
+	  if (strcmp (role, "Cost") != 0
+	      || fabs (sqlite3_column_double (stmt, 6) - expected) > 0.0000001)
+	    {
+		fprintf (stderr, "%s: %d -> %d expected %1.6f %s %1.6f\n",
+			 table, from, to, expected, algorithm,
+			 sqlite3_column_double (stmt, 6));
+		goto stmt_error;
+	    }
+      }
+    sqlite3_finalize (stmt);
+    sqlite3_free (from_list);
+    sqlite3_free (to_list);
+    if (rows != n_from * n_to)
+      {
+	  fprintf (stderr, "%s: unexpected # cells %d\n", table, rows);
+	  return 0;
+      }
+    return 1;
+
+  stmt_error:
+    sqlite3_finalize (stmt);
+  error:
+    sqlite3_free (from_list);
+    sqlite3_free (to_list);
+    return 0;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    double *dist;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!create_grid (handle))
+	return -1;
+    if (!execute
+	(handle,
+	 "SELECT CreateRouting('plain_data', 'plain_route', 'roads', "
+	 "'node_from', 'node_to', NULL, 'cost', 'road_name', 0, 1, "
+	 "'oneway_ft', 'oneway_tf', 0, 0)"))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT CreateRouting('ch_data', 'ch_route', 'roads', "
+	 "'node_from', 'node_to', NULL, 'cost', 'road_name', 0, 1, "
+	 "'oneway_ft', 'oneway_tf', 0, 1)"))
+	return -3;
+    dist = reference_costs (handle);
+    if (dist == NULL)
+	return -4;
+
+/* one-to-many Dijkstra searches */
+    if (!compare_matrix (handle, "plain_route", "Dijkstra", dist))
+	return -5;
+    if (!compare_matrix (handle, "ch_route", "Dijkstra", dist))
+	return -6;
+/* bucket-based Contraction Hierarchies */
+    if (!compare_matrix (handle, "ch_route", "CH", dist))
+	return -7;
+    free (dist);
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
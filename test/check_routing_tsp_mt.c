@@ -0,0 +1,471 @@
+/*
+
+ check_routing_tsp_mt.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+
+#define GRID_SIDE	12
+#define MAX_TARGETS	64
+
+static int
+create_grid (sqlite3 * handle)
+{
+/* creating a grid-shaped input network with pseudo-random costs */
+    int ret;
+    int x;
+    int y;
+    int id = 0;
+    unsigned int seed = 12345;
+    sqlite3_stmt *stmt;
+    const char *sql;
+    if (!execute
+	(handle,
+	 "CREATE TABLE roads (id INTEGER PRIMARY KEY, node_from INTEGER, "
+	 "node_to INTEGER, cost DOUBLE, oneway_ft INTEGER, oneway_tf INTEGER, "
+	 "road_name TEXT)"))
+	return 0;
+    sql = "INSERT INTO roads VALUES (?, ?, ?, ?, ?, ?, 'road')";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    execute (handle, "BEGIN");
+    for (y = 0; y < GRID_SIDE; y++)
+      {
+	  for (x = 0; x < GRID_SIDE; x++)
+	    {
+		int node = (y * GRID_SIDE) + x + 1;
+		int dir;
+		for (dir = 0; dir < 2; dir++)
+		  {
+		      int next;
+		      int oneway;
+		      if (dir == 0 && x == GRID_SIDE - 1)
+			  continue;
+		      if (dir == 1 && y == GRID_SIDE - 1)
+			  continue;
+		      next = (dir == 0) ? node + 1 : node + GRID_SIDE;
+		      seed = (seed * 1103515245) + 12345;
+		      oneway = (seed >> 16) % 7;
+		      seed = (seed * 1103515245) + 12345;
+		      sqlite3_reset (stmt);
+		      sqlite3_clear_bindings (stmt);
+		      sqlite3_bind_int (stmt, 1, ++id);
+		      sqlite3_bind_int (stmt, 2, node);
+		      sqlite3_bind_int (stmt, 3, next);
+		      sqlite3_bind_double (stmt, 4,
+					   1.0 + ((seed >> 16) % 100) / 10.0);
+		      sqlite3_bind_int (stmt, 5, (oneway == 1) ? 0 : 1);
+		      sqlite3_bind_int (stmt, 6, (oneway == 2) ? 0 : 1);
+		      ret = sqlite3_step (stmt);
+		      if (ret != SQLITE_DONE)
+			{
+			    fprintf (stderr, "INSERT roads: %s\n",
+				     sqlite3_errmsg (handle));
+			    sqlite3_finalize (stmt);
+			    return 0;
+			}
+		  }
+	    }
+      }
+    sqlite3_finalize (stmt);
+    execute (handle, "COMMIT");
+    return 1;
+}
+
+static double *
+reference_costs (sqlite3 * handle)
+{
+/* computing the exact all-pairs Shortest Path costs (Floyd-Warshall) */
+    int ret;
+    int i;
+    int j;
+    int k;
+    int n = GRID_SIDE * GRID_SIDE;
+    double *dist;
+    sqlite3_stmt *stmt;
+    const char *sql =
+	"SELECT node_from, node_to, cost, oneway_ft, oneway_tf FROM roads";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return NULL;
+      }
+    dist = malloc (sizeof (double) * n * n);
+    for (i = 0; i < n * n; i++)
+	dist[i] = -1.0;
+    for (i = 0; i < n; i++)
+	dist[(i * n) + i] = 0.0;
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  int from = sqlite3_column_int (stmt, 0) - 1;
+	  int to = sqlite3_column_int (stmt, 1) - 1;
+	  double cost = sqlite3_column_double (stmt, 2);
+	  if (sqlite3_column_int (stmt, 3))
+	      dist[(from * n) + to] = cost;
+	  if (sqlite3_column_int (stmt, 4))
+	      dist[(to * n) + from] = cost;
+      }
+    sqlite3_finalize (stmt);
+    for (k = 0; k < n; k++)
+      {
+	  for (i = 0; i < n; i++)
+	    {
+		if (dist[(i * n) + k] < 0.0)
+		    continue;
+		for (j = 0; j < n; j++)
+		  {
+		      double d;
+		      if (dist[(k * n) + j] < 0.0)
+			  continue;
+		      d = dist[(i * n) + k] + dist[(k * n) + j];
+		      if (dist[(i * n) + j] < 0.0 || d < dist[(i * n) + j])
+			  dist[(i * n) + j] = d;
+		  }
+	    }
+      }
+    return dist;
+}
+
+static double
+nn_tour_cost (const double *dist, int origin, const int *targets, int count)
+{
+/* computing the cost of the exact Nearest Neighbor tour */
+    int n = GRID_SIDE * GRID_SIDE;
+    char done[MAX_TARGETS];
+    int current = origin;
+    double total = 0.0;
+    int i;
+    int j;
+    memset (done, 0, sizeof (done));
+    for (i = 0; i < count; i++)
+      {
+	  int best = -1;
+	  for (j = 0; j < count; j++)
+	    {
+		if (done[j])
+		    continue;
+		if (best < 0
+		    || dist[((current - 1) * n) + targets[j] - 1] <
+		    dist[((current - 1) * n) + targets[best] - 1])
+		    best = j;
+	    }
+	  done[best] = 1;
+	  total += dist[((current - 1) * n) + targets[best] - 1];
+	  current = targets[best];
+      }
+    return total + dist[((current - 1) * n) + origin - 1];
+}
+
+static int
+check_tsp (sqlite3 * handle, int max_threads, int origin, const int *targets,
+	   int count, const double *dist)
+{
+/* checking a multi-threaded TSP GA solution against the reference costs */
+    int ret;
+    int i;
+    int n = GRID_SIDE * GRID_SIDE;
+    int rows = 0;
+    int current = origin;
+    char visited[MAX_TARGETS];
+    char *to_list;
+    char *prev;
+    char *sql;
+    double total = -1.0;
+    double legs = 0.0;
+    double nn;
+    sqlite3_stmt *stmt;
+
+    sql = sqlite3_mprintf ("SELECT SetMaxThreads(%d)", max_threads);
+    ret = execute (handle, sql);
+    sqlite3_free (sql);
+    if (!ret)
+	return 0;
+    if (!execute
+	(handle,
+	 "UPDATE plain_route SET Request = 'TSP GA MT', Options = 'No Links'"))
+	return 0;
+
+    to_list = sqlite3_mprintf ("");
+    for (i = 0; i < count; i++)
+      {
+	  prev = to_list;
+	  to_list =
+	      sqlite3_mprintf ("%s%s%d", prev, (i == 0) ? "" : ",", targets[i]);
+	  sqlite3_free (prev);
+      }
+    sql =
+	sqlite3_mprintf ("SELECT Request, Role, NodeFrom, NodeTo, Cost "
+			 "FROM plain_route WHERE NodeFrom = %d AND NodeTo = %Q",
+			 origin, to_list);
+    sqlite3_free (to_list);
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "TSP GA MT: %s\n", sqlite3_errmsg (handle));
+	  return 0;
+      }
+    memset (visited, 0, sizeof (visited));
+    while (1)
+      {
+	  const char *role;
+	  int from;
+	  int to;
+	  double cost;
+	  ret = sqlite3_step (stmt);
+	  if (ret == SQLITE_DONE)
+	      break;
+	  if (ret != SQLITE_ROW)
+	    {
+		fprintf (stderr, "TSP GA MT: %s\n", sqlite3_errmsg (handle));
+		goto error;
+	    }
+	  role = (const char *) sqlite3_column_text (stmt, 1);
+	  from = sqlite3_column_int (stmt, 2);
+	  to = sqlite3_column_int (stmt, 3);
+	  cost = sqlite3_column_double (stmt, 4);
+	  if (rows++ == 0)
+	    {
+		/* the TSP header */
+		if (strcmp
+		    ((const char *) sqlite3_column_text (stmt, 0),
+		     "TSP GA MT") != 0 || strcmp (role, "TSP Solution") != 0)
+		  {
+		      fprintf (stderr, "TSP GA MT: unexpected header %s\n",
+			       role);
+		      goto error;
+		  }
+		total = cost;
+		continue;
+	    }
+	  if (strcmp (role, "Route") != 0 || from != current)
+	    {
+		fprintf (stderr, "TSP GA MT: unexpected leg %s %d -> %d\n",
+			 role, from, to);
+		goto error;
+	    }
+	  for (i = 0; i < count; i++)
+	    {
+		if (targets[i] == to && !visited[i])
+		  {
+		      visited[i] = 1;
+		      break;
+		  }
+	    }
+	  if (i == count)
+	    {
+		fprintf (stderr, "TSP GA MT: unexpected City %d\n", to);
+		goto error;
+	    }
+	  if (fabs (cost - dist[((from - 1) * n) + to - 1]) > 0.0000001)
+	    {
+		fprintf (stderr,
+			 "TSP GA MT: %d -> %d expected %1.6f got %1.6f\n", from,
+			 to, dist[((from - 1) * n) + to - 1], cost);
+		goto error;
+	    }
+	  legs += cost;
+	  current = to;
+      }
+    sqlite3_finalize (stmt);
+
+    if (rows != count + 1)
+      {
+	  fprintf (stderr, "TSP GA MT: unexpected # rows %d\n", rows);
+	  return 0;
+      }
+/* the closing leg is only accounted into the total cost */
+    legs += dist[((current - 1) * n) + origin - 1];
+    if (fabs (total - legs) > 0.0000001)
+      {
+	  fprintf (stderr, "TSP GA MT: total cost %1.6f expected %1.6f\n",
+		   total, legs);
+	  return 0;
+      }
+    nn = nn_tour_cost (dist, origin, targets, count);
+    if (total > nn + 0.0000001)
+      {
+	  fprintf (stderr, "TSP GA MT: %1.6f worse than NN %1.6f\n", total,
+		   nn);
+	  return 0;
+      }
+    return 1;
+
+  error:
+    sqlite3_finalize (stmt);
+    return 0;
+}
+
+static int
+check_undefined (sqlite3 * handle)
+{
+/* a TSP GA MT request including an undefined target */
+    int ret;
+    int undefined = 0;
+    int route = 0;
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT Role FROM plain_route "
+	"WHERE NodeFrom = 1 AND NodeTo = '5,99999,77'";
+    ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+      {
+	  const char *role = (const char *) sqlite3_column_text (stmt, 0);
+	  if (strcmp (role, "Undefined NodeTo") == 0)
+	      undefined++;
+	  if (strcmp (role, "Route") == 0)
+	      route++;
+      }
+    sqlite3_finalize (stmt);
+    if (undefined != 1 || route != 0)
+      {
+	  fprintf (stderr, "TSP GA MT: undefined %d route %d\n", undefined,
+		   route);
+	  return 0;
+      }
+    return 1;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int i;
+    int targets[MAX_TARGETS];
+    double *dist;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!create_grid (handle))
+	return -1;
+    if (!execute
+	(handle,
+	 "SELECT CreateRouting('plain_data', 'plain_route', 'roads', "
+	 "'node_from', 'node_to', NULL, 'cost', 'road_name', 0, 1, "
+	 "'oneway_ft', 'oneway_tf', 0, 0)"))
+	return -2;
+    dist = reference_costs (handle);
+    if (dist == NULL)
+	return -3;
+    for (i = 0; i < GRID_SIDE * GRID_SIDE; i++)
+      {
+	  /* the grid is expected to be strongly connected */
+	  if (dist[i] < 0.0 || dist[i * GRID_SIDE * GRID_SIDE] < 0.0)
+	      return -4;
+      }
+
+/* a small tour: a single island */
+    targets[0] = 5;
+    targets[1] = 40;
+    targets[2] = 77;
+    targets[3] = 100;
+    targets[4] = 144;
+    targets[5] = 13;
+    if (!check_tsp (handle, 1, 1, targets, 6, dist))
+	return -5;
+    if (!check_tsp (handle, 4, 1, targets, 6, dist))
+	return -6;
+
+/* a larger tour: several islands bred in parallel */
+    for (i = 0; i < 60; i++)
+	targets[i] = 2 + (i * 7) % (GRID_SIDE * GRID_SIDE - 1);
+    if (!check_tsp (handle, 1, 1, targets, 60, dist))
+	return -7;
+    if (!check_tsp (handle, 4, 1, targets, 60, dist))
+	return -8;
+    if (!check_tsp (handle, 64, 1, targets, 60, dist))
+	return -9;
+
+    if (!check_undefined (handle))
+	return -10;
+    free (dist);
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1002;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+
+ check_rtree_bulk.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <spatialite/gaiaconfig.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+check_rtree (sqlite3 * handle, int expected_rows)
+{
+/* checking the R*Tree integrity and its query results */
+    int ret;
+    sqlite3_stmt *stmt;
+    int rows;
+    int i;
+    int value;
+    int value2;
+    char sql[1024];
+
+    ret =
+	sqlite3_prepare_v2 (handle, "SELECT rtreecheck('idx_roads_geom')", -1,
+			    &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "rtreecheck: %s\n", sqlite3_errmsg (handle));
+	  return 0;
+      }
+    ret = sqlite3_step (stmt);
+    if (ret != SQLITE_ROW
+	|| strcmp ((const char *) sqlite3_column_text (stmt, 0), "ok") != 0)
+      {
+	  fprintf (stderr, "rtreecheck: %s\n",
+		   (const char *) sqlite3_column_text (stmt, 0));
+	  sqlite3_finalize (stmt);
+	  return 0;
+      }
+    sqlite3_finalize (stmt);
+
+    if (!query_int (handle, "SELECT Count(*) FROM idx_roads_geom", &rows))
+	return 0;
+    if (rows != expected_rows)
+      {
+	  fprintf (stderr, "unexpected R*Tree rows: %d (expected %d)\n", rows,
+		   expected_rows);
+	  return 0;
+      }
+
+    for (i = 0; i < 10; i++)
+      {
+	  /* comparing window queries against a full table scan */
+	  int x = (i * 97) % 900;
+	  int y = (i * 53) % 900;
+	  sprintf (sql,
+		   "SELECT Count(*) FROM idx_roads_geom WHERE xmin <= %d "
+		   "AND xmax >= %d AND ymin <= %d AND ymax >= %d", x + 100, x,
+		   y + 100, y);
+	  if (!query_int (handle, sql, &value))
+	      return 0;
+	  sprintf (sql,
+		   "SELECT Count(*) FROM roads WHERE geom IS NOT NULL AND "
+		   "MbrMinX(geom) <= %d AND MbrMaxX(geom) >= %d AND "
+		   "MbrMinY(geom) <= %d AND MbrMaxY(geom) >= %d", x + 100, x,
+		   y + 100, y);
+	  if (!query_int (handle, sql, &value2))
+	      return 0;
+	  if (value != value2)
+	    {
+		fprintf (stderr, "window #%d: R*Tree %d, table %d\n", i, value,
+			 value2);
+		return 0;
+	    }
+      }
+    return 1;
+}
+#endif
+
+int
+main (int argc, char *argv[])
+{
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int ret;
+    sqlite3 *handle;
+    int value;
+    int node_size;
+    int max_cells;
+    int leaves;
+    int nodes;
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+    if (!execute (handle, "CREATE TABLE roads (id INTEGER PRIMARY KEY)"))
+	return -2;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('roads', 'geom', 4326, 'LINESTRING', 'XY')"))
+	return -3;
+    if (!execute
+	(handle,
+	 "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq "
+	 "WHERE n < 20000) INSERT INTO roads (id, geom) SELECT n, "
+	 "CASE WHEN n % 101 = 0 THEN NULL ELSE "
+	 "MakeLine(MakePoint((n * 7919) % 1000, (n * 104729) % 1000, 4326), "
+	 "MakePoint((n * 7919) % 1000 + n % 7, (n * 104729) % 1000 + n % 5, "
+	 "4326)) END FROM seq"))
+	return -4;
+
+/* bulk loading a packed R*Tree */
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('roads', 'geom')", &value)
+	|| value != 1)
+	return -5;
+    if (!check_rtree (handle, 20000 - (20000 / 101)))
+	return -6;
+
+/* a packed tree: every node but the last one of each level is full */
+    if (!query_int
+	(handle,
+	 "SELECT length(data) FROM idx_roads_geom_node WHERE nodeno = 1",
+	 &node_size))
+	return -7;
+    max_cells = (node_size - 4) / 24;
+    leaves = (20000 - (20000 / 101) + max_cells - 1) / max_cells;
+    nodes = 1;
+    while (leaves > 1)
+      {
+	  nodes += leaves;
+	  leaves = (leaves + max_cells - 1) / max_cells;
+      }
+    if (!query_int
+	(handle, "SELECT Count(*) FROM idx_roads_geom_node", &value)
+	|| value != nodes)
+      {
+	  fprintf (stderr, "unexpected R*Tree nodes: %d (expected %d)\n",
+		   value, nodes);
+	  return -8;
+      }
+
+/* the packed R*Tree must support ordinary updates */
+    if (!execute (handle, "DELETE FROM roads WHERE id % 3 = 0"))
+	return -9;
+    if (!execute
+	(handle,
+	 "UPDATE roads SET geom = MakeLine(MakePoint(id % 50, id % 70, 4326), "
+	 "MakePoint(id % 50 + 10, id % 70 + 10, 4326)) WHERE id % 5 = 0"))
+	return -10;
+    if (!execute
+	(handle,
+	 "INSERT INTO roads (id, geom) VALUES (30000, "
+	 "GeomFromText('LINESTRING(1 1, 999 999)', 4326))"))
+	return -11;
+    if (!query_int
+	(handle, "SELECT Count(*) FROM roads WHERE geom IS NOT NULL", &value))
+	return -12;
+    if (!check_rtree (handle, value))
+	return -13;
+    if (!query_int
+	(handle, "SELECT CheckSpatialIndex('roads', 'geom')", &value)
+	|| value != 1)
+	return -14;
+
+/* rebuilding the R*Tree from scratch */
+    if (!query_int
+	(handle, "SELECT RecoverSpatialIndex('roads', 'geom')", &value)
+	|| value != 1)
+	return -15;
+    if (!query_int
+	(handle, "SELECT Count(*) FROM roads WHERE geom IS NOT NULL", &value))
+	return -16;
+    if (!check_rtree (handle, value))
+	return -17;
+
+/* an empty table */
+    if (!execute (handle, "DELETE FROM roads"))
+	return -18;
+    if (!query_int
+	(handle, "SELECT RecoverSpatialIndex('roads', 'geom')", &value)
+	|| value != 1)
+	return -19;
+    if (!check_rtree (handle, 0))
+	return -20;
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+#endif
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    return 0;
+}
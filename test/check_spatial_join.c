@@ -0,0 +1,342 @@
+/*
+
+ check_spatial_join.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+static int
+create_layer (sqlite3 * handle, const char *table, int count, int size)
+{
+/* creating a spatially indexed layer of squares */
+    char *sql;
+    int ok = 0;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    sql = sqlite3_mprintf ("CREATE TABLE %s (id INTEGER PRIMARY KEY)", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT AddGeometryColumn(%Q, 'geom', 4326, 'POLYGON', 'XY')", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    sql = sqlite3_mprintf ("SELECT CreateSpatialIndex(%Q, 'geom')", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+#else
+/* just the bare minimum required by VirtualSpatialJoin */
+    sql =
+	sqlite3_mprintf ("CREATE TABLE %s (id INTEGER PRIMARY KEY, geom BLOB)",
+			 table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("INSERT INTO geometry_columns VALUES (%Q, 'geom', 1)", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("CREATE VIRTUAL TABLE idx_%s_geom USING rtree(pkid, xmin, xmax, "
+	 "ymin, ymax)", table);
+    if (!execute (handle, sql))
+	goto end;
+    sqlite3_free (sql);
+#endif
+/* pseudo-random squares sharing integer coordinates */
+    sql =
+	sqlite3_mprintf
+	("INSERT INTO %s (geom) WITH RECURSIVE "
+	 "seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < %d) "
+	 "SELECT BuildMbr(n * 7919 %% 997, n * 104729 %% 991, "
+	 "n * 7919 %% 997 + %d, n * 104729 %% 991 + %d, 4326) FROM seq",
+	 table, count, size, size);
+    if (!execute (handle, sql))
+	goto end;
+#ifdef OMIT_GEOS		/* GEOS is not enabled */
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("INSERT INTO idx_%s_geom SELECT id, MbrMinX(geom), MbrMaxX(geom), "
+	 "MbrMinY(geom), MbrMaxY(geom) FROM %s", table, table);
+    if (!execute (handle, sql))
+	goto end;
+#endif
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+
+static int
+check_candidates (sqlite3 * handle, const char *table_a, const char *table_b)
+{
+/* comparing the candidate pairs against a nested-loop over both R*Trees */
+    int value;
+    int expected;
+    char *sql;
+    int ok = 0;
+
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM idx_%s_geom AS x, idx_%s_geom AS y "
+	 "WHERE x.xmin <= y.xmax AND x.xmax >= y.xmin AND "
+	 "x.ymin <= y.ymax AND x.ymax >= y.ymin", table_a, table_b);
+    if (!query_int (handle, sql, &expected) || expected == 0)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM SpatialJoin WHERE table_a = %Q AND "
+	 "table_b = %Q", table_a, table_b);
+    if (!query_int (handle, sql, &value) || value != expected)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM (SELECT x.pkid, y.pkid FROM idx_%s_geom AS x, "
+	 "idx_%s_geom AS y WHERE x.xmin <= y.xmax AND x.xmax >= y.xmin AND "
+	 "x.ymin <= y.ymax AND x.ymax >= y.ymin EXCEPT SELECT rowid_a, rowid_b "
+	 "FROM SpatialJoin WHERE table_a = %Q AND table_b = %Q AND "
+	 "predicate = 'MBR')", table_a, table_b, table_a, table_b);
+    if (!query_int (handle, sql, &value) || value != 0)
+	goto end;
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+check_predicate (sqlite3 * handle, const char *predicate,
+		 const char *function)
+{
+/* comparing the refined pairs against a nested-loop on SpatialIndex */
+    int value;
+    int expected;
+    char *sql;
+    int ok = 0;
+
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM small AS x, large AS y WHERE y.ROWID IN ("
+	 "SELECT ROWID FROM SpatialIndex WHERE f_table_name = 'large' AND "
+	 "search_frame = x.geom) AND %s(x.geom, y.geom) = 1", function);
+    if (!query_int (handle, sql, &expected) || expected == 0)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "table_b = 'large' AND predicate = %Q", predicate);
+    if (!query_int (handle, sql, &value) || value != expected)
+	goto end;
+    sqlite3_free (sql);
+    sql =
+	sqlite3_mprintf
+	("SELECT Count(*) FROM SpatialJoin AS j JOIN small AS x ON "
+	 "(x.id = j.rowid_a) JOIN large AS y ON (y.id = j.rowid_b) "
+	 "WHERE j.table_a = 'small' AND j.table_b = 'large' AND "
+	 "j.predicate = %Q AND %s(x.geom, y.geom) = 1", predicate, function);
+    if (!query_int (handle, sql, &value) || value != expected)
+	goto end;
+    ok = 1;
+
+  end:
+    sqlite3_free (sql);
+    return ok;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    int value;
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -1;
+#else
+    if (!execute
+	(handle,
+	 "CREATE TABLE geometry_columns (f_table_name TEXT, "
+	 "f_geometry_column TEXT, spatial_index_enabled INTEGER)"))
+	return -1;
+#endif
+    if (!execute
+	(handle, "CREATE VIRTUAL TABLE SpatialJoin USING VirtualSpatialJoin()"))
+	return -2;
+/* two R*Trees of different depth */
+    if (!create_layer (handle, "small", 5000, 3))
+	return -3;
+    if (!create_layer (handle, "large", 400, 100))
+	return -4;
+    if (!execute (handle, "CREATE TABLE empty (id INTEGER PRIMARY KEY)"))
+	return -5;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('empty', 'geom', 4326, 'POLYGON', 'XY')"))
+	return -6;
+    if (!execute (handle, "SELECT CreateSpatialIndex('empty', 'geom')"))
+	return -7;
+#else
+    if (!execute
+	(handle,
+	 "INSERT INTO geometry_columns VALUES ('empty', 'geom', 1)"))
+	return -6;
+    if (!execute
+	(handle,
+	 "CREATE VIRTUAL TABLE idx_empty_geom USING rtree(pkid, xmin, xmax, "
+	 "ymin, ymax)"))
+	return -7;
+#endif
+
+/* candidate pairs (MBR only) */
+    if (!check_candidates (handle, "small", "large"))
+	return -8;
+    if (!check_candidates (handle, "large", "small"))
+	return -9;
+    if (!check_candidates (handle, "large", "large"))
+	return -10;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'SMALL' AND "
+	 "geometry_a = 'Geom' AND table_b = 'large' AND geometry_b = 'geom' "
+	 "AND rowid_a = 1", &value) || value == 0)
+	return -11;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "table_b = 'empty'", &value) || value != 0)
+	return -12;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "table_b = 'nothing'", &value) || value != 0)
+	return -13;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "geometry_a = 'none' AND table_b = 'large'", &value) || value != 0)
+	return -14;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small'",
+	 &value) || value != 0)
+	return -15;
+    if (!expect_failure
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "table_b = 'large' AND predicate = 'nearby'"))
+	return -16;
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+/* refined pairs */
+    if (!execute (handle, "SELECT SetMaxThreads(1)"))
+	return -17;
+    if (!check_predicate (handle, "intersects", "ST_Intersects"))
+	return -18;
+    if (!check_predicate (handle, "Touches", "ST_Touches"))
+	return -19;
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -20;
+    if (!check_predicate (handle, "within", "ST_Within"))
+	return -21;
+    if (!check_predicate (handle, "coveredby", "ST_CoveredBy"))
+	return -22;
+    if (!check_predicate (handle, "touches", "ST_Touches"))
+	return -23;
+    if (!check_predicate (handle, "overlaps", "ST_Overlaps"))
+	return -24;
+#else
+    if (!expect_failure
+	(handle,
+	 "SELECT Count(*) FROM SpatialJoin WHERE table_a = 'small' AND "
+	 "table_b = 'large' AND predicate = 'touches'"))
+	return -17;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
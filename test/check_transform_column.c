@@ -0,0 +1,253 @@
+/*
+
+ check_transform_column.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    int value;
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+/* not a registered Geometry Column */
+    if (!expect_failure
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 3003)"))
+	return -1;
+    if (!query_int
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 3003, 1)",
+	 &value) || value != 0)
+	return -2;
+    if (!expect_failure
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 'abc')"))
+	return -3;
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+#ifndef OMIT_PROJ		/* only if PROJ is enabled */
+    if (!execute (handle, "SELECT InitSpatialMetadata(1)"))
+	return -4;
+    if (!execute
+	(handle, "CREATE TABLE pts (id INTEGER PRIMARY KEY, name TEXT)"))
+	return -5;
+    if (!execute
+	(handle, "SELECT AddGeometryColumn('pts', 'geom', 4326, 'POINT', 'XY')"))
+	return -6;
+    if (!execute (handle, "SELECT CreateSpatialIndex('pts', 'geom')"))
+	return -7;
+/* many batches of points, plus a NULL Geometry */
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (id, name, geom) WITH RECURSIVE seq(n) AS "
+	 "(SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < 20000) "
+	 "SELECT n, 'pt' || n, MakePoint(7.0 + (n % 113) * 0.1, "
+	 "37.0 + (n % 97) * 0.09, 4326) FROM seq"))
+	return -8;
+    if (!execute (handle, "INSERT INTO pts (id, name) VALUES (20001, 'none')"))
+	return -9;
+    if (!execute
+	(handle,
+	 "CREATE TABLE ref AS SELECT id, ST_Transform(geom, 3003) AS geom "
+	 "FROM pts"))
+	return -10;
+
+/* parallel reprojection */
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -11;
+    if (!query_int
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 3003)",
+	 &value) || value != 1)
+	return -12;
+    if (!query_int
+	(handle,
+	 "SELECT srid FROM geometry_columns WHERE f_table_name = 'pts'",
+	 &value) || value != 3003)
+	return -13;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts AS p JOIN ref AS r ON (p.id = r.id) "
+	 "WHERE p.geom IS r.geom", &value) || value != 20001)
+	return -14;
+    if (!query_int
+	(handle, "SELECT CheckSpatialIndex('pts', 'geom')", &value)
+	|| value != 1)
+	return -15;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM sqlite_master WHERE type = 'trigger' "
+	 "AND name = 'giu_pts_geom'", &value) || value != 1)
+	return -16;
+    if (!query_int
+	(handle,
+	 "SELECT row_count FROM geometry_columns_statistics "
+	 "WHERE f_table_name = 'pts'", &value) || value != 20001)
+	return -17;
+/* the geometry constraints now expect the new SRID */
+    if (!execute
+	(handle,
+	 "INSERT INTO pts (id, geom) VALUES (20002, "
+	 "MakePoint(1500000, 4800000, 3003))"))
+	return -18;
+    if (!expect_failure
+	(handle,
+	 "INSERT INTO pts (id, geom) VALUES (20003, MakePoint(11, 43, 4326))"))
+	return -19;
+
+/* failures leave everything untouched */
+    if (!expect_failure
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 999999)"))
+	return -20;
+    if (!query_int
+	(handle,
+	 "SELECT srid FROM geometry_columns WHERE f_table_name = 'pts'",
+	 &value) || value != 3003)
+	return -21;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts AS p JOIN ref AS r ON (p.id = r.id) "
+	 "WHERE p.geom IS r.geom", &value) || value != 20001)
+	return -22;
+    if (!query_int
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 3003)",
+	 &value) || value != 1)
+	return -23;
+
+/* serial reprojection, back to the original SRID */
+    if (!execute (handle, "DELETE FROM pts WHERE id = 20002"))
+	return -24;
+    if (!execute (handle, "SELECT SetMaxThreads(1)"))
+	return -25;
+    if (!query_int
+	(handle, "SELECT TransformGeometryColumn('pts', 'geom', 4326)",
+	 &value) || value != 1)
+	return -26;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts AS p JOIN ref AS r ON (p.id = r.id) "
+	 "WHERE p.geom IS ST_Transform(r.geom, 4326)", &value)
+	|| value != 20001)
+	return -27;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts WHERE ROWID IN (SELECT ROWID FROM "
+	 "SpatialIndex WHERE f_table_name = 'pts' AND search_frame = "
+	 "BuildMbr(7.05, 37.05, 9.05, 39.05, 4326))", &value))
+	return -28;
+    ret = value;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM pts WHERE MbrIntersects(geom, "
+	 "BuildMbr(7.05, 37.05, 9.05, 39.05, 4326)) = 1", &value) || value != ret)
+	return -29;
+
+#if SQLITE_VERSION_NUMBER >= 3024000	/* R*Tree auxiliary columns */
+/* a covering SpatialIndex keeps its auxiliary columns */
+    if (!execute
+	(handle, "CREATE TABLE cpts (id INTEGER PRIMARY KEY, name TEXT)"))
+	return -30;
+    if (!execute
+	(handle,
+	 "SELECT AddGeometryColumn('cpts', 'geom', 4326, 'POINT', 'XY')"))
+	return -31;
+    if (!query_int
+	(handle, "SELECT CreateSpatialIndex('cpts', 'geom', 'name')", &value)
+	|| value != 1)
+	return -32;
+    if (!execute
+	(handle,
+	 "INSERT INTO cpts (id, name, geom) SELECT id, name, geom FROM pts "
+	 "WHERE id <= 500"))
+	return -33;
+    if (!query_int
+	(handle, "SELECT TransformGeometryColumn('cpts', 'geom', 3003)",
+	 &value) || value != 1)
+	return -34;
+    if (!query_int
+	(handle, "SELECT Count(*) FROM pragma_table_info('idx_cpts_geom')",
+	 &value) || value != 8)
+	return -35;
+    if (!query_int
+	(handle,
+	 "SELECT Count(*) FROM cpts AS p JOIN idx_cpts_geom AS i "
+	 "ON (i.pkid = p.ROWID) WHERE i.name = p.name AND "
+	 "i.point_x = ST_X(p.geom) AND i.point_y = ST_Y(p.geom) AND "
+	 "ST_Srid(p.geom) = 3003", &value) || value != 500)
+	return -36;
+#endif /* end R*Tree auxiliary columns */
+#endif /* end PROJ conditional */
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
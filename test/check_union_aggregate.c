@@ -0,0 +1,173 @@
+/*
+
+ check_union_aggregate.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2021
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+
+#include "test_helpers.h"
+
+#include <spatialite/gaiaconfig.h>
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+static int
+check_grid (sqlite3 * handle)
+{
+/* uniting 100 x 50 adjacent unit squares: many batches are needed */
+    int value;
+    if (!query_int
+	(handle,
+	 "SELECT ST_Area(ST_Union(geom)) = 5000 FROM grid", &value)
+	|| value != 1)
+	return 0;
+    if (!query_int
+	(handle,
+	 "SELECT GeometryType(ST_Union(geom)) = 'POLYGON' FROM grid", &value)
+	|| value != 1)
+	return 0;
+    if (!query_int
+	(handle,
+	 "SELECT ST_Equals(ST_Union(geom), BuildMbr(0, 0, 100, 50)) "
+	 "FROM grid", &value) || value != 1)
+	return 0;
+/* rows ordered so that every batch is scattered all over the grid */
+    if (!query_int
+	(handle,
+	 "SELECT ST_Equals(ST_Union(geom), BuildMbr(0, 0, 100, 50)) "
+	 "FROM (SELECT geom FROM grid ORDER BY (x * 7919 + y * 104729) % 5003)",
+	 &value) || value != 1)
+	return 0;
+    if (!query_int
+	(handle,
+	 "SELECT Sum(ok) FROM (SELECT ST_Equals(ST_Union(geom), "
+	 "BuildMbr(0, y / 25 * 25, 100, y / 25 * 25 + 25)) AS ok "
+	 "FROM grid GROUP BY y / 25)", &value) || value != 2)
+	return 0;
+    return 1;
+}
+#endif /* end GEOS conditional */
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    int value;
+#endif
+    void *cache = spatialite_alloc_connection ();
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory db: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -1000;
+      }
+
+    spatialite_init_ex (handle, cache, 0);
+
+#ifndef OMIT_GEOS		/* only if GEOS is enabled */
+    if (!execute
+	(handle,
+	 "CREATE TABLE grid AS WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL "
+	 "SELECT n + 1 FROM seq WHERE n < 4999) SELECT n % 100 AS x, "
+	 "n / 100 AS y, BuildMbr(n % 100, n / 100, n % 100 + 1, n / 100 + 1) "
+	 "AS geom FROM seq"))
+	return -1;
+
+/* trivial cases */
+    if (!query_int
+	(handle,
+	 "SELECT ST_Union(geom) IS NULL FROM grid WHERE x < 0", &value)
+	|| value != 1)
+	return -2;
+    if (!query_int
+	(handle,
+	 "SELECT ST_Union(g) IS NULL FROM (SELECT NULL AS g UNION ALL "
+	 "SELECT GeomFromText('GEOMETRYCOLLECTION EMPTY'))", &value)
+	|| value != 1)
+	return -3;
+    if (!query_int
+	(handle,
+	 "SELECT ST_Area(ST_Union(g)) = 7 FROM (SELECT BuildMbr(0, 0, 2, 2) "
+	 "AS g UNION ALL SELECT GeomFromText('GEOMETRYCOLLECTION EMPTY') "
+	 "UNION ALL SELECT BuildMbr(1, 1, 3, 3))", &value) || value != 1)
+	return -4;
+    if (!query_int
+	(handle,
+	 "SELECT NumGeometries(ST_Union(MakePoint(x, 0))) = 100 FROM grid",
+	 &value) || value != 1)
+	return -5;
+
+/* serial reduction */
+    if (!execute (handle, "SELECT SetMaxThreads(1)"))
+	return -6;
+    if (!check_grid (handle))
+	return -7;
+
+/* batches reduced by worker threads */
+    if (!execute (handle, "SELECT SetMaxThreads(4)"))
+	return -8;
+    if (!check_grid (handle))
+	return -9;
+#endif /* end GEOS conditional */
+
+    ret = sqlite3_close (handle);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "sqlite3_close() error: %s\n",
+		   sqlite3_errmsg (handle));
+	  return -1001;
+      }
+
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+
+    return 0;
+}
@@ -44,6 +44,7 @@ the terms of any one of the MPL, the GPL or the LGPL.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include <spatialite/gaiaconfig.h>
 
@@ -429,6 +430,222 @@ test_knn (sqlite3 * sqlite, int mode)
     return 0;
 }
 
+static int
+test_knn_exact (sqlite3 * sqlite)
+{
+/* checking the KNN distances against a brute-force scan */
+    int ret;
+    const char *sql;
+    sqlite3_stmt *stmt_knn = NULL;
+    sqlite3_stmt *stmt_ref = NULL;
+    double x;
+    double y;
+    double dist;
+    double prev;
+    int rows;
+
+    sql =
+	"SELECT distance FROM knn WHERE f_table_name = 'points' "
+	"AND f_geometry_column = 'geom' AND ref_geometry = MakePoint(?, ?) "
+	"AND max_items = 25";
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_knn, NULL);
+    if (ret != SQLITE_OK)
+	goto error;
+    sql =
+	"SELECT ST_Distance(MakePoint(?, ?, 32632), geom) AS d FROM points "
+	"ORDER BY d LIMIT 25";
+    ret = sqlite3_prepare_v2 (sqlite, sql, strlen (sql), &stmt_ref, NULL);
+    if (ret != SQLITE_OK)
+	goto error;
+
+    for (y = 3999000.5; y < 4002000.0; y += 777.7)
+      {
+	  for (x = 99000.5; x < 102000.0; x += 777.7)
+	    {
+		sqlite3_reset (stmt_knn);
+		sqlite3_clear_bindings (stmt_knn);
+		sqlite3_bind_double (stmt_knn, 1, x);
+		sqlite3_bind_double (stmt_knn, 2, y);
+		sqlite3_reset (stmt_ref);
+		sqlite3_clear_bindings (stmt_ref);
+		sqlite3_bind_double (stmt_ref, 1, x);
+		sqlite3_bind_double (stmt_ref, 2, y);
+		rows = 0;
+		prev = 0.0;
+		while (1)
+		  {
+		      /* both result sets must return the same distances */
+		      ret = sqlite3_step (stmt_ref);
+		      if (ret == SQLITE_DONE)
+			  break;
+		      if (ret != SQLITE_ROW)
+			  goto error;
+		      if (sqlite3_step (stmt_knn) != SQLITE_ROW)
+			  goto error;
+		      dist = sqlite3_column_double (stmt_knn, 0);
+		      if (dist < prev)
+			  goto error;
+		      if (fabs (dist - sqlite3_column_double (stmt_ref, 0)) >
+			  0.000001)
+			  goto error;
+		      prev = dist;
+		      rows++;
+		  }
+		if (rows != 25)
+		    goto error;
+		if (sqlite3_step (stmt_knn) != SQLITE_DONE)
+		    goto error;
+	    }
+      }
+    sqlite3_finalize (stmt_knn);
+    sqlite3_finalize (stmt_ref);
+    return 1;
+
+  error:
+    if (stmt_knn != NULL)
+	sqlite3_finalize (stmt_knn);
+    if (stmt_ref != NULL)
+	sqlite3_finalize (stmt_ref);
+    return 0;
+}
+
+static int
+test_knn_filtered (sqlite3 * sqlite, int mode)
+{
+/* checking the filtered KNN distances against a brute-force scan */
+    int ret;
+    const char *sql_knn;
+    const char *sql_ref;
+    sqlite3_stmt *stmt_knn = NULL;
+    sqlite3_stmt *stmt_ref = NULL;
+    double x;
+    double y;
+    double dist;
+    int rows;
+
+    switch (mode)
+      {
+      case 0:
+	  sql_knn =
+	      "SELECT distance, fid FROM knn WHERE f_table_name = 'points' "
+	      "AND ref_geometry = MakePoint(?, ?) AND max_items = 25 "
+	      "AND filter = 'id % 7 = 3'";
+	  sql_ref =
+	      "SELECT ST_Distance(MakePoint(?, ?, 32632), geom) AS d, id "
+	      "FROM points WHERE id % 7 = 3 ORDER BY d LIMIT 25";
+	  break;
+      case 1:
+	  sql_knn =
+	      "SELECT distance, fid FROM knn WHERE f_table_name = 'points' "
+	      "AND ref_geometry = MakePoint(?, ?) AND max_items = 25 "
+	      "AND fid IN (SELECT id FROM points WHERE id % 5 = 1)";
+	  sql_ref =
+	      "SELECT ST_Distance(MakePoint(?, ?, 32632), geom) AS d, id "
+	      "FROM points WHERE id % 5 = 1 ORDER BY d LIMIT 25";
+	  break;
+      default:
+	  sql_knn =
+	      "SELECT distance, fid FROM knn WHERE f_table_name = 'points' "
+	      "AND f_geometry_column = 'geom' AND filter = 'id % 2 = 0' "
+	      "AND ref_geometry = MakePoint(?, ?) AND max_items = 25 "
+	      "AND fid IN (SELECT id FROM points WHERE id % 3 = 0)";
+	  sql_ref =
+	      "SELECT ST_Distance(MakePoint(?, ?, 32632), geom) AS d, id "
+	      "FROM points WHERE id % 6 = 0 ORDER BY d LIMIT 25";
+	  break;
+      };
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_knn, strlen (sql_knn), &stmt_knn,
+			    NULL);
+    if (ret != SQLITE_OK)
+	goto error;
+    ret =
+	sqlite3_prepare_v2 (sqlite, sql_ref, strlen (sql_ref), &stmt_ref,
+			    NULL);
+    if (ret != SQLITE_OK)
+	goto error;
+
+    for (y = 3999000.5; y < 4002000.0; y += 777.7)
+      {
+	  for (x = 99000.5; x < 102000.0; x += 777.7)
+	    {
+		sqlite3_reset (stmt_knn);
+		sqlite3_clear_bindings (stmt_knn);
+		sqlite3_bind_double (stmt_knn, 1, x);
+		sqlite3_bind_double (stmt_knn, 2, y);
+		sqlite3_reset (stmt_ref);
+		sqlite3_clear_bindings (stmt_ref);
+		sqlite3_bind_double (stmt_ref, 1, x);
+		sqlite3_bind_double (stmt_ref, 2, y);
+		rows = 0;
+		while (1)
+		  {
+		      /* exactly 25 qualifying items are expected */
+		      ret = sqlite3_step (stmt_ref);
+		      if (ret == SQLITE_DONE)
+			  break;
+		      if (ret != SQLITE_ROW)
+			  goto error;
+		      if (sqlite3_step (stmt_knn) != SQLITE_ROW)
+			  goto error;
+		      dist = sqlite3_column_double (stmt_knn, 0);
+		      if (fabs (dist - sqlite3_column_double (stmt_ref, 0)) >
+			  0.000001)
+			  goto error;
+		      ret = sqlite3_column_int (stmt_knn, 1);
+		      if (mode == 0 && ret % 7 != 3)
+			  goto error;
+		      if (mode == 1 && ret % 5 != 1)
+			  goto error;
+		      if (mode == 2 && ret % 6 != 0)
+			  goto error;
+		      rows++;
+		  }
+		if (rows != 25)
+		    goto error;
+		if (sqlite3_step (stmt_knn) != SQLITE_DONE)
+		    goto error;
+	    }
+      }
+    sqlite3_finalize (stmt_knn);
+    sqlite3_finalize (stmt_ref);
+    return 1;
+
+  error:
+    if (stmt_knn != NULL)
+	sqlite3_finalize (stmt_knn);
+    if (stmt_ref != NULL)
+	sqlite3_finalize (stmt_ref);
+    return 0;
+}
+
+static int
+test_knn_bad_filter (sqlite3 * sqlite, const char *filter)
+{
+/* checking a filter expected to return nothing or to raise an error */
+    int ret;
+    char *sql;
+    char *err_msg = NULL;
+    int rows;
+    int columns;
+    char **results;
+
+    sql =
+	sqlite3_mprintf
+	("SELECT fid FROM knn WHERE f_table_name = 'points' "
+	 "AND ref_geometry = MakePoint(100500, 4000500) AND filter = %Q",
+	 filter);
+    ret = sqlite3_get_table (sqlite, sql, &results, &rows, &columns, &err_msg);
+    sqlite3_free (sql);
+    if (ret != SQLITE_OK)
+      {
+	  sqlite3_free (err_msg);
+	  return 1;
+      }
+    sqlite3_free_table (results);
+    return (rows == 0) ? 1 : 0;
+}
+
 #endif
 #endif
 
@@ -620,6 +837,57 @@ main (int argc, char *argv[])
 	  return -19;
       }
 
+/* Testing KNN - #11 */
+    ret = test_knn_exact (db_handle);
+    if (!ret)
+      {
+	  fprintf (stderr, "Check KNN #11: unexpected failure\n");
+	  sqlite3_close (db_handle);
+	  return -20;
+      }
+
+/* Testing KNN - #12 */
+    ret = test_knn_filtered (db_handle, 0);
+    if (!ret)
+      {
+	  fprintf (stderr, "Check KNN #12: unexpected failure\n");
+	  sqlite3_close (db_handle);
+	  return -21;
+      }
+
+#if SQLITE_VERSION_NUMBER >= 3038000
+/* Testing KNN - #13 */
+    ret = test_knn_filtered (db_handle, 1);
+    if (!ret)
+      {
+	  fprintf (stderr, "Check KNN #13: unexpected failure\n");
+	  sqlite3_close (db_handle);
+	  return -22;
+      }
+
+/* Testing KNN - #14 */
+    ret = test_knn_filtered (db_handle, 2);
+    if (!ret)
+      {
+	  fprintf (stderr, "Check KNN #14: unexpected failure\n");
+	  sqlite3_close (db_handle);
+	  return -23;
+      }
+#endif
+
+/* Testing KNN - #15 */
+    if (!test_knn_bad_filter (db_handle, "id < 0")
+	|| !test_knn_bad_filter (db_handle, "no_such_column = 1")
+	|| !test_knn_bad_filter (db_handle, "1); SELECT (1")
+	|| !test_knn_bad_filter (db_handle, "id < 0) OR (1")
+	|| !test_knn_bad_filter (db_handle, "/*(*/id < 0) OR (1/*)*/")
+	|| !test_knn_bad_filter (db_handle, "id < 0 --)) OR ((1"))
+      {
+	  fprintf (stderr, "Check KNN #15: unexpected failure\n");
+	  sqlite3_close (db_handle);
+	  return -24;
+      }
+
 #endif /* end KNN conditional */
 #endif /* end GEOS conditional */
 
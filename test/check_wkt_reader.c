@@ -0,0 +1,482 @@
+/*
+
+ check_wkt_reader.c -- SpatiaLite Test Case
+
+ Author: Sandro Furieri <a.furieri@lqt.it>
+
+ ------------------------------------------------------------------------------
+ 
+ Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ 
+ The contents of this file are subject to the Mozilla Public License Version
+ 1.1 (the "License"); you may not use this file except in compliance with
+ the License. You may obtain a copy of the License at
+ http://www.mozilla.org/MPL/
+ 
+Software distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+for the specific language governing rights and limitations under the
+License.
+
+The Original Code is the SpatiaLite library
+
+The Initial Developer of the Original Code is Alessandro Furieri
+ 
+Portions created by the Initial Developer are Copyright (C) 2011
+the Initial Developer. All Rights Reserved.
+
+Contributor(s):
+Brad Hards <bradh@frogmouth.net>
+
+Alternatively, the contents of this file may be used under the terms of
+either the GNU General Public License Version 2 or later (the "GPL"), or
+the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+in which case the provisions of the GPL or the LGPL are applicable instead
+of those above. If you wish to allow use of your version of this file only
+under the terms of either the GPL or the LGPL, and not to allow others to
+use your version of this file under the terms of the MPL, indicate your
+decision by deleting the provisions above and replace them with the notice
+and other provisions required by the GPL or the LGPL. If you do not delete
+the provisions above, a recipient may use your version of this file under
+the terms of any one of the MPL, the GPL or the LGPL.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sqlite3.h"
+#include "spatialite.h"
+#include <spatialite/gaiageo.h>
+
+struct wkt_case
+{
+    const char *text;
+    int ewkt;
+    int type;
+    int model;
+    int srid;
+    int points;
+    int lines;
+    int polygons;
+    double x;
+    double y;
+};
+
+static int
+count_entities (gaiaGeomCollPtr geom, int *lines, int *polygons)
+{
+/* counting POINTs, LINESTRINGs and POLYGONs */
+    int points = 0;
+    gaiaPointPtr pt;
+    gaiaLinestringPtr ln;
+    gaiaPolygonPtr pg;
+    *lines = 0;
+    *polygons = 0;
+    for (pt = geom->FirstPoint; pt != NULL; pt = pt->Next)
+	points++;
+    for (ln = geom->FirstLinestring; ln != NULL; ln = ln->Next)
+	*lines += 1;
+    for (pg = geom->FirstPolygon; pg != NULL; pg = pg->Next)
+	*polygons += 1;
+    return points;
+}
+
+static int
+check_cases ()
+{
+/* testing well known WKT and EWKT strings */
+    gaiaGeomCollPtr geom;
+    int i;
+    int points;
+    int lines;
+    int polygons;
+    struct wkt_case cases[] = {
+	{"POINT(1 2)", 0, GAIA_POINT, GAIA_XY, 0, 1, 0, 0, 1.0, 2.0},
+	{" point ( -1.5 +2. ) ", 0, GAIA_POINT, GAIA_XY, 0, 1, 0, 0, -1.5,
+	 2.0},
+	{"POINT Z(1 2 3)", 0, GAIA_POINTZ, GAIA_XY_Z, 0, 1, 0, 0, 1.0, 2.0},
+	{"POINT\t\n zm (1e3 .5E-1 3 4)", 0, GAIA_POINTZM, GAIA_XY_Z_M, 0, 1,
+	 0, 0, 1000.0, 0.05},
+	{"PointM(1 2 3)", 0, GAIA_POINTM, GAIA_XY_M, 0, 1, 0, 0, 1.0, 2.0},
+	{"LINESTRING(1 2,3 4,5 6)", 0, GAIA_LINESTRING, GAIA_XY, 0, 0, 1, 0,
+	 0.0, 0.0},
+	{"POLYGON((0 0,10 0,10 10,0 0),(1 1,2 1,2 2,1 1))", 0, GAIA_POLYGON,
+	 GAIA_XY, 0, 0, 0, 1, 0.0, 0.0},
+	{"MULTIPOINT(1 2,3 4)", 0, GAIA_MULTIPOINT, GAIA_XY, 0, 2, 0, 0, 1.0,
+	 2.0},
+	{"MULTIPOINT Z((1 2 3), (4 5 6))", 0, GAIA_MULTIPOINT, GAIA_XY_Z, 0,
+	 2, 0, 0, 1.0, 2.0},
+	{"MULTILINESTRING M((1 2 3,4 5 6),(7 8 9,1 2 3))", 0,
+	 GAIA_MULTILINESTRING, GAIA_XY_M, 0, 0, 2, 0, 0.0, 0.0},
+	{"MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((5 5,6 5,6 6,5 5)))", 0,
+	 GAIA_MULTIPOLYGON, GAIA_XY, 0, 0, 0, 2, 0.0, 0.0},
+	{"GEOMETRYCOLLECTION(POINT(1 2),GEOMETRYCOLLECTION(LINESTRING(0 0,1 1)"
+	 ",POLYGON((0 0,1 0,1 1,0 0))))", 0, GAIA_GEOMETRYCOLLECTION, GAIA_XY,
+	 0, 1, 1, 1, 1.0, 2.0},
+	{"POINT(1e 7)", 0, GAIA_POINT, GAIA_XY, 0, 1, 0, 0, 1.0, 7.0},
+	{"POINT(1-2)", 0, GAIA_POINT, GAIA_XY, 0, 1, 0, 0, 1.0, -2.0},
+	{"POINT(1 2)", 1, GAIA_POINT, GAIA_XY, -1, 1, 0, 0, 1.0, 2.0},
+	{"SRID=4326;POINT(1 2 3)", 1, GAIA_POINTZ, GAIA_XY_Z, 4326, 1, 0, 0,
+	 1.0, 2.0},
+	{" srid = 32632 ; POINTM(1 2 3)", 1, GAIA_POINTM, GAIA_XY_M, 32632, 1,
+	 0, 0, 1.0, 2.0},
+	{"SRID=3003;LINESTRING(1 2 3 4,5 6 7 8)", 1, GAIA_LINESTRING,
+	 GAIA_XY_Z_M, 3003, 0, 1, 0, 0.0, 0.0},
+	{"GEOMETRYCOLLECTION(POINT(1 2 3),GEOMETRYCOLLECTION(MULTIPOINT(4 5 6)"
+	 "))", 1, GAIA_GEOMETRYCOLLECTION, GAIA_XY_Z, -1, 2, 0, 0, 1.0, 2.0},
+	{"GEOMETRYCOLLECTIONM(POINTM(1 2 3),LINESTRINGM(0 0 0,1 1 1))", 1,
+	 GAIA_GEOMETRYCOLLECTION, GAIA_XY_M, -1, 1, 1, 0, 1.0, 2.0},
+	{NULL, 0, 0, 0, 0, 0, 0, 0, 0.0, 0.0}
+    };
+
+    for (i = 0; cases[i].text != NULL; i++)
+      {
+	  if (cases[i].ewkt)
+	      geom = gaiaParseEWKT ((const unsigned char *) cases[i].text);
+	  else
+	      geom = gaiaParseWkt ((const unsigned char *) cases[i].text, -1);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "case #%d: unexpected NULL\n", i);
+		return -1;
+	    }
+	  points = count_entities (geom, &lines, &polygons);
+	  if (geom->DeclaredType != cases[i].type
+	      || geom->DimensionModel != cases[i].model
+	      || geom->Srid != cases[i].srid || points != cases[i].points
+	      || lines != cases[i].lines || polygons != cases[i].polygons)
+	    {
+		fprintf (stderr,
+			 "case #%d: unexpected type=%d model=%d srid=%d "
+			 "entities=%d/%d/%d\n", i, geom->DeclaredType,
+			 geom->DimensionModel, geom->Srid, points, lines,
+			 polygons);
+		gaiaFreeGeomColl (geom);
+		return -2;
+	    }
+	  if (points > 0
+	      && (geom->FirstPoint->X != cases[i].x
+		  || geom->FirstPoint->Y != cases[i].y))
+	    {
+		fprintf (stderr, "case #%d: unexpected POINT %1.17g %1.17g\n",
+			 i, geom->FirstPoint->X, geom->FirstPoint->Y);
+		gaiaFreeGeomColl (geom);
+		return -3;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    return 0;
+}
+
+static int
+check_invalid ()
+{
+/* testing malformed or degenerated WKT and EWKT strings */
+    gaiaGeomCollPtr geom;
+    int i;
+    const char *wkt[] = {
+	"", "POINT", "POINT(1 2", "POINT(1 2)x", "POINT(1,2)", "POINT(1 2 3)",
+	"POINT(1\r2)", "POINT Z M(1 2 3 4)", "POINTMZ(1 2 3 4)",
+	"POINT(1.e5 2)", "POINT(0x10 2)", "POINT EMPTY", "LINESTRING(1 2)",
+	"POLYGON((0 0,1 0,0 0))", "POLYGON((0 0,1 0,1 1,0 0),(1 1,2 2))",
+	"MULTIPOINT((1 2),3 4)", "GEOMETRYCOLLECTION()",
+	"GEOMETRYCOLLECTION Z(GEOMETRYCOLLECTION(POINT Z(1 2 3)))",
+	"POINT(1 2)\nPOINT(3 4)", NULL
+    };
+    const char *ewkt[] = {
+	"POINTZ(1 2 3)", "POINT M(1 2 3)", "POINTM(1 2)", "POINT(1 2 3 4 5)",
+	"LINESTRING(1 2 3,4 5)", "GEOMETRYCOLLECTION(POINT(1 2 3),POINT(1 2))",
+	"GEOMETRYCOLLECTIONM(POINT(1 2))", "SRID=x;POINT(1 2)", "SRID=4326;",
+	NULL
+    };
+
+    for (i = 0; wkt[i] != NULL; i++)
+      {
+	  geom = gaiaParseWkt ((const unsigned char *) wkt[i], -1);
+	  if (geom != NULL)
+	    {
+		fprintf (stderr, "WKT #%d: unexpected success\n", i);
+		gaiaFreeGeomColl (geom);
+		return -10;
+	    }
+      }
+    for (i = 0; ewkt[i] != NULL; i++)
+      {
+	  geom = gaiaParseEWKT ((const unsigned char *) ewkt[i]);
+	  if (geom != NULL)
+	    {
+		fprintf (stderr, "EWKT #%d: unexpected success\n", i);
+		gaiaFreeGeomColl (geom);
+		return -11;
+	    }
+      }
+
+/* restricting the Geometry class */
+    geom = gaiaParseWkt ((const unsigned char *) "POINT Z(1 2 3)", GAIA_POINTZ);
+    if (geom == NULL)
+      {
+	  fprintf (stderr, "unexpected NULL POINTZ\n");
+	  return -12;
+      }
+    gaiaFreeGeomColl (geom);
+    geom = gaiaParseWkt ((const unsigned char *) "POINT Z(1 2 3)", GAIA_POINT);
+    if (geom != NULL)
+      {
+	  fprintf (stderr, "unexpected POINT class\n");
+	  gaiaFreeGeomColl (geom);
+	  return -13;
+      }
+    return 0;
+}
+
+static int
+check_numbers ()
+{
+/* all numbers must exactly match strtod() */
+    gaiaGeomCollPtr geom;
+    char wkt[256];
+    double expected;
+    int i;
+    const char *numbers[] = {
+	"0.1", "-0.3", "123456.789", "1e22", "1e23", "9007199254740993",
+	"0.30000000000000004", "47.025800000000004", "-1.5E-05", "+.5e+1",
+	"2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+	"123456789012345678901234567890", "0.000000000000000000000000001",
+	"-0", "1e400", "00012.50", NULL
+    };
+
+    for (i = 0; numbers[i] != NULL; i++)
+      {
+	  sprintf (wkt, "POINT(%s 1)", numbers[i]);
+	  geom = gaiaParseWkt ((const unsigned char *) wkt, -1);
+	  if (geom == NULL)
+	    {
+		fprintf (stderr, "number \"%s\": unexpected NULL\n",
+			 numbers[i]);
+		return -20;
+	    }
+	  expected = strtod (numbers[i], NULL);
+	  if (memcmp (&(geom->FirstPoint->X), &expected, sizeof (double)) !=
+	      0)
+	    {
+		fprintf (stderr, "number \"%s\": unexpected %1.17g\n",
+			 numbers[i], geom->FirstPoint->X);
+		gaiaFreeGeomColl (geom);
+		return -21;
+	    }
+	  gaiaFreeGeomColl (geom);
+      }
+    return 0;
+}
+
+static int
+check_polygon ()
+{
+/* a large POLYGON with holes, printed with full precision */
+    gaiaGeomCollPtr geom;
+    gaiaPolygonPtr pg;
+    gaiaRingPtr rng;
+    char *wkt = malloc (64 * 3000);
+    char *p = wkt;
+    double x;
+    double y;
+    double z;
+    int ib;
+    int iv;
+    int ret = 0;
+
+    p += sprintf (p, "POLYGON Z(");
+    for (ib = 0; ib < 3; ib++)
+      {
+	  p += sprintf (p, "%s(", (ib == 0) ? "" : ", ");
+	  for (iv = 0; iv < 999; iv++)
+	    {
+		x = (ib * 1000 + iv) / 7.0;
+		p += sprintf (p, "%s%1.17g %1.17g %d", (iv == 0) ? "" : ",",
+			      x, -x / 3.0, iv);
+	    }
+	  p += sprintf (p, ",%1.17g %1.17g 0)", (ib * 1000) / 7.0,
+			-((ib * 1000) / 7.0) / 3.0);
+      }
+    strcpy (p, ")");
+
+    geom = gaiaParseWkt ((const unsigned char *) wkt, GAIA_POLYGON);
+    free (wkt);
+    if (geom == NULL)
+      {
+	  fprintf (stderr, "unexpected NULL POLYGON\n");
+	  return -30;
+      }
+    pg = geom->FirstPolygon;
+    if (pg == NULL || pg->Next != NULL || pg->NumInteriors != 2
+	|| geom->DimensionModel != GAIA_XY_Z)
+      {
+	  fprintf (stderr, "unexpected POLYGON layout\n");
+	  ret = -31;
+	  goto end;
+      }
+    for (ib = 0; ib < 3; ib++)
+      {
+	  rng = (ib == 0) ? pg->Exterior : pg->Interiors + (ib - 1);
+	  if (rng->Points != 1000 || rng->DimensionModel != GAIA_XY_Z)
+	    {
+		fprintf (stderr, "ring #%d: unexpected %d vertices\n", ib,
+			 rng->Points);
+		ret = -32;
+		goto end;
+	    }
+	  for (iv = 0; iv < 999; iv++)
+	    {
+		gaiaGetPointXYZ (rng->Coords, iv, &x, &y, &z);
+		if (x != (ib * 1000 + iv) / 7.0 || y != -x / 3.0 || z != iv)
+		  {
+		      fprintf (stderr, "ring #%d: unexpected vertex #%d\n",
+			       ib, iv);
+		      ret = -33;
+		      goto end;
+		  }
+	    }
+      }
+    if (geom->MinX != 0.0 || geom->MaxX != 998 / 7.0)
+      {
+	  fprintf (stderr, "unexpected MBR %1.17g %1.17g\n", geom->MinX,
+		   geom->MaxX);
+	  ret = -34;
+      }
+  end:
+    gaiaFreeGeomColl (geom);
+    return ret;
+}
+
+static int
+check_nesting ()
+{
+/* deeply nested GEOMETRYCOLLECTIONs */
+    gaiaGeomCollPtr geom;
+    char *wkt = malloc (32 * 200);
+    char *p = wkt;
+    int i;
+    int lines;
+    int polygons;
+    int points;
+
+    for (i = 0; i < 200; i++)
+	p += sprintf (p, "GEOMETRYCOLLECTION(");
+    p += sprintf (p, "POINT(1 2)");
+    for (i = 0; i < 200; i++)
+	*p++ = ')';
+    *p = '\0';
+    geom = gaiaParseWkt ((const unsigned char *) wkt, -1);
+    free (wkt);
+    if (geom == NULL)
+      {
+	  fprintf (stderr, "unexpected NULL nested GEOMETRYCOLLECTION\n");
+	  return -40;
+      }
+    points = count_entities (geom, &lines, &polygons);
+    gaiaFreeGeomColl (geom);
+    if (points != 1 || lines != 0 || polygons != 0)
+      {
+	  fprintf (stderr, "unexpected nested GEOMETRYCOLLECTION\n");
+	  return -41;
+      }
+    return 0;
+}
+
+static int
+check_sql (sqlite3 * handle)
+{
+/* testing the SQL functions */
+    char **results;
+    int rows;
+    int columns;
+    int ret;
+    char *err_msg = NULL;
+    const char *sql =
+	"SELECT AsEWKT(GeomFromEWKT('SRID=4326;MULTIPOINT((1 2),(3 4))')), "
+	"AsText(GeomFromText('LINESTRING Z(1 2 3, 4 5 6)', 3003)), "
+	"ST_Srid(GeomFromText('POLYGON((0 0,1 0,1 1,0 0))', 32632)), "
+	"GeomFromText('POINT(1 2', 4326)";
+
+    ret = sqlite3_get_table (handle, sql, &results, &rows, &columns, &err_msg);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "Error: %s\n", err_msg);
+	  sqlite3_free (err_msg);
+	  return -50;
+      }
+    if (rows != 1 || columns != 4)
+      {
+	  fprintf (stderr, "unexpected %d rows / %d columns\n", rows, columns);
+	  ret = -51;
+      }
+    else if (strcmp (results[4], "SRID=4326;MULTIPOINT(1 2,3 4)") != 0)
+      {
+	  fprintf (stderr, "unexpected EWKT: %s\n", results[4]);
+	  ret = -52;
+      }
+    else if (strcmp (results[5], "LINESTRING Z(1 2 3, 4 5 6)") != 0)
+      {
+	  fprintf (stderr, "unexpected WKT: %s\n", results[5]);
+	  ret = -53;
+      }
+    else if (strcmp (results[6], "32632") != 0)
+      {
+	  fprintf (stderr, "unexpected SRID: %s\n", results[6]);
+	  ret = -54;
+      }
+    else if (results[7] != NULL)
+      {
+	  fprintf (stderr, "unexpected malformed WKT result\n");
+	  ret = -55;
+      }
+    else
+	ret = 0;
+    sqlite3_free_table (results);
+    return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int ret;
+    sqlite3 *handle;
+    void *cache = spatialite_alloc_connection ();
+
+    if (argc > 1 || argv[0] == NULL)
+	argc = 1;		/* silencing stupid compiler warnings */
+
+    ret = check_cases ();
+    if (ret != 0)
+	return ret;
+    ret = check_invalid ();
+    if (ret != 0)
+	return ret;
+    ret = check_numbers ();
+    if (ret != 0)
+	return ret;
+    ret = check_polygon ();
+    if (ret != 0)
+	return ret;
+    ret = check_nesting ();
+    if (ret != 0)
+	return ret;
+
+    ret =
+	sqlite3_open_v2 (":memory:", &handle,
+			 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "cannot open in-memory database: %s\n",
+		   sqlite3_errmsg (handle));
+	  sqlite3_close (handle);
+	  return -60;
+      }
+    spatialite_init_ex (handle, cache, 0);
+    ret = check_sql (handle);
+    sqlite3_close (handle);
+    spatialite_cleanup_ex (cache);
+    spatialite_shutdown ();
+    return ret;
+}
@@ -6,6 +6,87 @@
 
 #include <ctype.h>
 
+/*
+ * common SQL helpers: a diagnostic message is printed on failure
+ */
+static int UNUSED
+query_int (sqlite3 * handle, const char *sql, int *value)
+{
+/* executing an SQL query returning a single integer */
+    sqlite3_stmt *stmt;
+    int ok = 0;
+    int ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW && sqlite3_column_type (stmt, 0) == SQLITE_INTEGER)
+      {
+	  *value = sqlite3_column_int (stmt, 0);
+	  ok = 1;
+      }
+    else
+	fprintf (stderr, "%s: unexpected result\n", sql);
+    sqlite3_finalize (stmt);
+    return ok;
+}
+
+static int UNUSED
+query_int64 (sqlite3 * handle, const char *sql, sqlite3_int64 * value)
+{
+/* executing an SQL query returning a single 64 bit integer */
+    sqlite3_stmt *stmt;
+    int ok = 0;
+    int ret = sqlite3_prepare_v2 (handle, sql, strlen (sql), &stmt, NULL);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, sqlite3_errmsg (handle));
+	  return 0;
+      }
+    ret = sqlite3_step (stmt);
+    if (ret == SQLITE_ROW && sqlite3_column_type (stmt, 0) == SQLITE_INTEGER)
+      {
+	  *value = sqlite3_column_int64 (stmt, 0);
+	  ok = 1;
+      }
+    else
+	fprintf (stderr, "%s: unexpected result\n", sql);
+    sqlite3_finalize (stmt);
+    return ok;
+}
+
+static int UNUSED
+execute (sqlite3 * handle, const char *sql)
+{
+/* executing an SQL statement */
+    char *err_msg = NULL;
+    int ret = sqlite3_exec (handle, sql, NULL, NULL, &err_msg);
+    if (ret != SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: %s\n", sql, err_msg);
+	  sqlite3_free (err_msg);
+	  return 0;
+      }
+    return 1;
+}
+
+static int UNUSED
+expect_failure (sqlite3 * handle, const char *sql)
+{
+/* executing an SQL statement expected to raise an exception */
+    char *err_msg = NULL;
+    int ret = sqlite3_exec (handle, sql, NULL, NULL, &err_msg);
+    if (ret == SQLITE_OK)
+      {
+	  fprintf (stderr, "%s: unexpected success\n", sql);
+	  return 0;
+      }
+    sqlite3_free (err_msg);
+    return 1;
+}
+
 #ifdef __WIN32
 /*
  * Windows replacement for strcastr